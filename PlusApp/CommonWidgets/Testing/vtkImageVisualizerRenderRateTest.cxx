@@ -0,0 +1,199 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkImageVisualizerRenderRateTest.cxx
+  \brief This program displays the frames of a fast simulated video source with vtkImageVisualizer in an offscreen
+  render window, with and without limiting the render rate. It reports the number of rendered frames and the CPU time
+  per second, and verifies that the render rate is limited and the displayed image buffer is updated in place.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkAccurateTimer.h"
+#include "vtkImageVisualizer.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkRenderWindow.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Acquire frames with the given frame rate and display them for the given time. Returns the number of errors.
+  int DisplayFrames(const int frameSize[2], double acquisitionRate, double maximumRenderRate, double testTimeSec,
+    double &renderedFramesPerSec, double &cpuTimePerSec)
+  {
+    vtkSmartPointer<vtkPlusDataSource> videoSource = vtkSmartPointer<vtkPlusDataSource>::New();
+    videoSource->SetSourceId("Video");
+    videoSource->SetType(DATA_SOURCE_TYPE_VIDEO);
+    vtkPlusBuffer* buffer = videoSource->GetBuffer();
+    buffer->SetImageOrientation(US_IMG_ORIENT_MF);
+    buffer->SetImageType(US_IMG_BRIGHTNESS);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(1);
+    buffer->SetFrameSize(frameSize[0], frameSize[1]);
+    buffer->SetBufferSize(50);
+
+    vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+    channel->SetVideoSource(videoSource);
+
+    vtkSmartPointer<vtkImageVisualizer> imageVisualizer = vtkSmartPointer<vtkImageVisualizer>::New();
+    imageVisualizer->SetMaximumRenderRate(maximumRenderRate);
+
+    vtkSmartPointer<vtkRenderWindow> renderWindow = vtkSmartPointer<vtkRenderWindow>::New();
+    renderWindow->OffScreenRenderingOn();
+    renderWindow->SetSize(frameSize[0], frameSize[1]);
+    renderWindow->AddRenderer(imageVisualizer->GetCanvasRenderer());
+    imageVisualizer->SetChannel(channel);
+
+    int numberOfErrors = 0;
+    std::vector<unsigned char> image(frameSize[0]*frameSize[1]);
+    long frameNumber = 0;
+    int numberOfRenderedFrames = 0;
+    void* displayedImageBuffer = NULL;
+    unsigned char displayedPixelValue = 0;
+
+    double startCpuTimeSec = PlusCommon::GetProcessCpuTimeSec();
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    double currentTimeSec = startTimeSec;
+    while ( currentTimeSec - startTimeSec < testTimeSec )
+    {
+      // Simulated acquisition: add all the frames that are due since the previous iteration
+      while ( frameNumber < (currentTimeSec - startTimeSec) * acquisitionRate )
+      {
+        std::fill(image.begin(), image.end(), static_cast<unsigned char>(frameNumber & 0xFF));
+        double timestamp = startTimeSec + frameNumber / acquisitionRate;
+        if ( buffer->AddItem(&image[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, frameNumber, timestamp, timestamp) != PLUS_SUCCESS )
+        {
+          LOG_ERROR("Failed to add frame " << frameNumber << " to the buffer");
+          return numberOfErrors + 1;
+        }
+        displayedPixelValue = static_cast<unsigned char>(frameNumber & 0xFF);
+        frameNumber++;
+      }
+
+      bool imageUpdated = false;
+      if ( imageVisualizer->UpdateDisplayedImage(imageUpdated) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to update the displayed image");
+        numberOfErrors++;
+      }
+      if ( imageUpdated )
+      {
+        renderWindow->Render();
+        numberOfRenderedFrames++;
+
+        vtkImageData* displayedImage = imageVisualizer->GetDisplayedImage();
+        if ( static_cast<unsigned char*>(displayedImage->GetScalarPointer())[0] != displayedPixelValue )
+        {
+          LOG_ERROR("The displayed image does not contain the latest frame");
+          numberOfErrors++;
+        }
+        // All frames have the same size, so the buffer of the displayed image shall not be reallocated
+        if ( displayedImageBuffer != NULL && displayedImage->GetScalarPointer() != displayedImageBuffer )
+        {
+          LOG_ERROR("The buffer of the displayed image was reallocated");
+          numberOfErrors++;
+        }
+        displayedImageBuffer = displayedImage->GetScalarPointer();
+      }
+
+      vtkAccurateTimer::Delay(0.001);
+      currentTimeSec = vtkAccurateTimer::GetSystemTime();
+    }
+    double elapsedTimeSec = currentTimeSec - startTimeSec;
+    cpuTimePerSec = (PlusCommon::GetProcessCpuTimeSec() - startCpuTimeSec) / elapsedTimeSec;
+    renderedFramesPerSec = numberOfRenderedFrames / elapsedTimeSec;
+
+    LOG_INFO("Maximum render rate: " << maximumRenderRate << " fps, acquired frames: " << frameNumber << ", rendered frames per sec: " << std::fixed << renderedFramesPerSec
+      << ", CPU time per sec: " << cpuTimePerSec << " sec");
+
+    if ( numberOfRenderedFrames == 0 )
+    {
+      LOG_ERROR("No frames were rendered");
+      numberOfErrors++;
+    }
+    // Allow one extra frame for the first update
+    if ( maximumRenderRate > 0 && numberOfRenderedFrames > maximumRenderRate * elapsedTimeSec + 1 )
+    {
+      LOG_ERROR("Rendered frames per sec (" << renderedFramesPerSec << ") exceeds the maximum render rate (" << maximumRenderRate << ")");
+      numberOfErrors++;
+    }
+
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  double acquisitionRate(200.0);
+  double maximumRenderRate(30.0);
+  double testTimeSec(2.0);
+  int frameSize[2] = {640, 480};
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--acquisition-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionRate, "Frame rate of the simulated video source (Default: 200).");
+  args.AddArgument("--maximum-render-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maximumRenderRate, "Maximum render rate of the image visualizer (Default: 30).");
+  args.AddArgument("--test-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &testTimeSec, "Duration of displaying the frames in each test (Default: 2.0).");
+  args.AddArgument("--frame-width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[0], "Frame width in pixels (Default: 640).");
+  args.AddArgument("--frame-height", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[1], "Frame height in pixels (Default: 480).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( acquisitionRate <= 0 || maximumRenderRate <= 0 || testTimeSec <= 0 || frameSize[0] < 1 || frameSize[1] < 1 )
+  {
+    std::cerr << "Invalid arguments" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+
+  // Every acquired frame is displayed
+  double unlimitedFramesPerSec = 0;
+  double unlimitedCpuTimePerSec = 0;
+  numberOfErrors += DisplayFrames(frameSize, acquisitionRate, 0, testTimeSec, unlimitedFramesPerSec, unlimitedCpuTimePerSec);
+
+  // The frames are coalesced to the maximum render rate
+  double limitedFramesPerSec = 0;
+  double limitedCpuTimePerSec = 0;
+  numberOfErrors += DisplayFrames(frameSize, acquisitionRate, maximumRenderRate, testTimeSec, limitedFramesPerSec, limitedCpuTimePerSec);
+
+  LOG_INFO("Limiting the render rate to " << maximumRenderRate << " fps changed the rendered frames per sec from " << std::fixed << unlimitedFramesPerSec
+    << " to " << limitedFramesPerSec << " and the CPU time per sec from " << unlimitedCpuTimePerSec << " sec to " << limitedCpuTimePerSec << " sec");
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("vtkImageVisualizerRenderRateTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkImageVisualizerRenderRateTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -4,11 +4,16 @@ Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
 See License.txt for details.
 =========================================================Plus=header=end*/ 
 
+#include "vtkAccurateTimer.h"
 #include "vtkConeSource.h"
+#include "vtkDataArray.h"
 #include "vtkImageVisualizer.h"
 #include "vtkLineSource.h"
 #include "vtkObjectFactory.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDataSource.h"
 #include "vtkPlusDevice.h"
+#include "vtkPointData.h"
 #include "vtkPolyDataMapper.h"
 #include "vtkProperty.h"
 #include "vtkRenderWindow.h"
@@ -29,6 +34,7 @@ static double ORIENTATION_MARKER_SIZE = 51.0;
 static double ORIENTATION_MARKER_ASSEMBLY_POSITION[3] = {12.0, 12.0, -1.0};
 static const double ORIENTATION_MARKER_CONE_RADIUS = 5.0;
 static const double ORIENTATION_MARKER_CONE_HEIGHT = 15.0;
+static const double DEFAULT_MAXIMUM_RENDER_RATE = 30.0;
 
 //-----------------------------------------------------------------------------
 
@@ -51,6 +57,10 @@ vtkImageVisualizer::vtkImageVisualizer()
 , RightLineSource(NULL)
 , BottomLineSource(NULL)
 , SelectedChannel(NULL)
+, DisplayedImage(NULL)
+, MaximumRenderRate(DEFAULT_MAXIMUM_RENDER_RATE)
+, DisplayedFrameTimestamp(UNDEFINED_TIMESTAMP)
+, LastDisplayedImageUpdateTimeSec(0.0)
 {
   this->RegionOfInterest[0] = this->RegionOfInterest[1] = this->RegionOfInterest[2] = this->RegionOfInterest[3] = -1;
 
@@ -82,6 +92,10 @@ vtkImageVisualizer::vtkImageVisualizer()
   vtkSmartPointer<vtkImageActor> imageActor = vtkSmartPointer<vtkImageActor>::New();
   this->SetImageActor(imageActor);
 
+  // Create the displayed image, it is allocated when the first frame is copied into it
+  vtkSmartPointer<vtkImageData> displayedImage = vtkSmartPointer<vtkImageData>::New();
+  this->SetDisplayedImage(displayedImage);
+
   // Add actors to the renderer
   this->CanvasRenderer->AddActor(this->ResultActor);
   this->CanvasRenderer->AddActor(this->ImageActor);
@@ -102,6 +116,7 @@ vtkImageVisualizer::~vtkImageVisualizer()
   this->SetResultActor(NULL);
   this->SetCanvasRenderer(NULL);
   this->SetImageActor(NULL);
+  this->SetDisplayedImage(NULL);
   this->SetImageCamera(NULL);
   this->SetHorizontalOrientationTextActor(NULL);
   this->SetVerticalOrientationTextActor(NULL);
@@ -462,6 +477,97 @@ void vtkImageVisualizer::SetInputData(vtkImageData* aImage )
   this->GetImageActor()->SetInputData_vtk5compatible(aImage);
 }
 
+//-----------------------------------------------------------------------------
+
+PlusStatus vtkImageVisualizer::UpdateDisplayedImage(bool& imageUpdated)
+{
+  imageUpdated = false;
+
+  if( this->SelectedChannel == NULL || !this->SelectedChannel->HasVideoSource() || this->ImageActor->GetVisibility() == 0 )
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // The input of the image actor may have been changed by SetInputData
+  if( this->ImageActor->GetInput() != this->DisplayedImage )
+  {
+    this->ImageActor->SetInputData_vtk5compatible(this->DisplayedImage);
+    imageUpdated = true;
+  }
+
+  double currentTimeSec = vtkAccurateTimer::GetSystemTime();
+  if( this->MaximumRenderRate > 0 && currentTimeSec - this->LastDisplayedImageUpdateTimeSec < 1.0 / this->MaximumRenderRate )
+  {
+    // The frames that are acquired until the next update are not displayed
+    return PLUS_SUCCESS;
+  }
+
+  vtkPlusDataSource* videoSource = NULL;
+  double latestTimestamp = UNDEFINED_TIMESTAMP;
+  if( this->SelectedChannel->GetVideoSource(videoSource) != PLUS_SUCCESS || videoSource->GetBuffer()->GetLatestTimeStamp(latestTimestamp) != ITEM_OK )
+  {
+    LOG_TRACE("No video data available yet");
+    return PLUS_SUCCESS;
+  }
+  if( latestTimestamp == this->DisplayedFrameTimestamp )
+  {
+    // No new frame, the pipeline is not modified
+    return PLUS_SUCCESS;
+  }
+
+  vtkImageData* brightnessImage = this->SelectedChannel->GetBrightnessOutput();
+  if( brightnessImage == NULL || brightnessImage->GetPointData()->GetScalars() == NULL )
+  {
+    LOG_DEBUG("The latest frame cannot be displayed as a brightness image");
+    return PLUS_SUCCESS;
+  }
+  this->DisplayedFrameTimestamp = latestTimestamp;
+  this->LastDisplayedImageUpdateTimeSec = currentTimeSec;
+  imageUpdated = true;
+
+  if( this->CopyToDisplayedImage(brightnessImage) && this->CanvasRenderer->GetRenderWindow() != NULL )
+  {
+    // The frame size has changed, the camera has to be adjusted
+    return this->UpdateCameraPose();
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+
+bool vtkImageVisualizer::CopyToDisplayedImage(vtkImageData* aImage)
+{
+  int* extent = aImage->GetExtent();
+  int* displayedExtent = this->DisplayedImage->GetExtent();
+  double* spacing = aImage->GetSpacing();
+  double* displayedSpacing = this->DisplayedImage->GetSpacing();
+  double* origin = aImage->GetOrigin();
+  double* displayedOrigin = this->DisplayedImage->GetOrigin();
+  bool geometryChanged = this->DisplayedImage->GetPointData()->GetScalars() == NULL
+    || aImage->GetScalarType() != this->DisplayedImage->GetScalarType()
+    || aImage->GetNumberOfScalarComponents() != this->DisplayedImage->GetNumberOfScalarComponents();
+  for( int i = 0; i < 3 && !geometryChanged; ++i )
+  {
+    geometryChanged = extent[2*i] != displayedExtent[2*i] || extent[2*i+1] != displayedExtent[2*i+1]
+      || spacing[i] != displayedSpacing[i] || origin[i] != displayedOrigin[i];
+  }
+
+  if( geometryChanged )
+  {
+    this->DisplayedImage->DeepCopy(aImage);
+    return true;
+  }
+
+  // Only the pixels have changed, reuse the existing buffer (and texture size) of the displayed image
+  memcpy(this->DisplayedImage->GetScalarPointer(), aImage->GetScalarPointer(),
+    aImage->GetNumberOfPoints() * aImage->GetNumberOfScalarComponents() * aImage->GetScalarSize());
+  this->DisplayedImage->GetPointData()->GetScalars()->Modified();
+  this->DisplayedImage->Modified();
+
+  return false;
+}
+
 //-----------------------------------------------------------------------------
 void vtkImageVisualizer::SetResultPolyData(vtkPolyData* aResultPolyData )
 {
@@ -661,6 +767,18 @@ PlusStatus vtkImageVisualizer::ReadConfiguration( vtkXMLDataElement* aConfig )
   }
   this->CurrentMarkerOrientation = orientationValue;
 
+  // Maximum render rate (optional)
+  double maximumRenderRate = DEFAULT_MAXIMUM_RENDER_RATE;
+  if( xmlElement->GetScalarAttribute("MaximumRenderRate", maximumRenderRate) )
+  {
+    if( maximumRenderRate < 0 )
+    {
+      LOG_WARNING("Invalid MaximumRenderRate attribute in the Rendering element: " << maximumRenderRate << ". Using the default value (" << DEFAULT_MAXIMUM_RENDER_RATE << ").");
+      maximumRenderRate = DEFAULT_MAXIMUM_RENDER_RATE;
+    }
+  }
+  this->SetMaximumRenderRate(maximumRenderRate);
+
   //Find segmentation parameters element
   vtkXMLDataElement* segmentationParameters = aConfig->FindNestedElementWithName("Segmentation");
   if (segmentationParameters == NULL)
@@ -1000,7 +1118,9 @@ void vtkImageVisualizer::SetChannel(vtkPlusChannel *channel)
 
   if( this->SelectedChannel != NULL && this->SelectedChannel->GetBrightnessOutput() != NULL )
   {
-    this->ImageActor->SetInputData_vtk5compatible( this->SelectedChannel->GetBrightnessOutput() );
+    this->CopyToDisplayedImage( this->SelectedChannel->GetBrightnessOutput() );
+    this->DisplayedFrameTimestamp = UNDEFINED_TIMESTAMP;
+    this->ImageActor->SetInputData_vtk5compatible( this->DisplayedImage );
     this->ImageActor->VisibilityOn();
   }
   else
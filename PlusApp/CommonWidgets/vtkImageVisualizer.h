@@ -73,6 +73,14 @@ public:
   */
   void SetInputData( vtkImageData* aImage );
 
+  /*!
+  * Copy the latest frame of the selected channel to the displayed image. Nothing is done if there is no new frame
+  * or the previous frame was displayed less than 1/MaximumRenderRate sec ago (the frames acquired in the meantime are skipped).
+  * The displayed image is updated in place and the camera is only updated if the frame size changes.
+  * \param imageUpdated Set to true if the displayed image has changed (the canvas has to be rendered)
+  */
+  PlusStatus UpdateDisplayedImage(bool& imageUpdated);
+
   void SetResultPolyData(vtkPolyData* aResultPolyData );
 
   /*!
@@ -146,6 +154,11 @@ public:
   vtkGetObjectMacro(ScreenAlignedProps, vtkProp3DCollection);
   vtkGetObjectMacro(VerticalOrientationTextActor, vtkTextActor3D);
   vtkSetObjectMacro(CanvasRenderer, vtkRenderer);
+  vtkGetObjectMacro(DisplayedImage, vtkImageData);
+
+  /*! Maximum number of displayed image updates per second (0 means no limit) */
+  vtkSetMacro(MaximumRenderRate, double);
+  vtkGetMacro(MaximumRenderRate, double);
 
   void SetChannel(vtkPlusChannel *channel);
 
@@ -176,6 +189,14 @@ protected:
   vtkSetObjectMacro(ResultGlyph, vtkGlyph3D);
   vtkSetObjectMacro(VerticalOrientationTextActor, vtkTextActor3D);
   vtkGetObjectMacro(ResultGlyph, vtkGlyph3D);
+  vtkSetObjectMacro(DisplayedImage, vtkImageData);
+
+  /*!
+  * Copy an image to the displayed image. If the frame geometry is unchanged then the pixels are copied
+  * into the existing buffer, otherwise the displayed image is reallocated.
+  * \return True if the frame geometry has changed
+  */
+  bool CopyToDisplayedImage(vtkImageData* aImage);
 
   /*!
   * Initialize Orientation 3D Actors
@@ -281,6 +302,18 @@ protected:
 
   /*! Vector to hold the actors for each wire */
   std::vector<vtkTextActor3D*>  WireActors;
+
+  /*! Image shown by the image actor when a channel is selected, it is updated in place with the latest frame */
+  vtkImageData*                 DisplayedImage;
+
+  /*! Maximum number of displayed image updates per second (0 means no limit) */
+  double                        MaximumRenderRate;
+
+  /*! Timestamp of the frame that is copied to the displayed image */
+  double                        DisplayedFrameTimestamp;
+
+  /*! System time of the last update of the displayed image */
+  double                        LastDisplayedImageUpdateTimeSec;
 };
 
 #endif
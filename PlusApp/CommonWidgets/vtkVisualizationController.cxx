@@ -42,6 +42,8 @@ vtkVisualizationController::vtkVisualizationController()
 , TransformRepository(NULL)
 , SelectedChannel(NULL)
 , DataCollector(NULL)
+, RenderRequested(true)
+, RenderedPolyDataMTime(0)
 {
   // Create transform repository
   this->ClearTransformRepository();
@@ -203,6 +205,8 @@ PlusStatus vtkVisualizationController::SetVisualizationMode( DISPLAY_MODE aMode
 {
   LOG_TRACE("vtkVisualizationController::SetVisualizationMode( DISPLAY_MODE " << (aMode?"true":"false") << ")");
 
+  this->RenderRequested = true;
+
   if (this->GetDataCollector() == NULL)
   {
     LOG_DEBUG("Data collector has not been initialized when visualization mode was changed.");
@@ -405,13 +409,28 @@ PlusStatus vtkVisualizationController::Update()
   if( this->PerspectiveVisualizer != NULL && CurrentMode == DISPLAY_MODE_3D)
   {
     this->PerspectiveVisualizer->Update();
+    // The tools may have moved
+    this->RenderRequested = true;
   }
 
   // Force update of the brightness image in the DataCollector,
   // because it is the image that the image actors show
   if( this->SelectedChannel != NULL && this->GetImageActor() != NULL )
   {
-    this->GetImageActor()->SetInputData_vtk5compatible( this->SelectedChannel->GetBrightnessOutput() );
+    if( this->CurrentMode == DISPLAY_MODE_2D )
+    {
+      // The displayed image is only modified if there is a new frame (at most with the maximum render rate of the image visualizer)
+      bool imageUpdated = false;
+      this->ImageVisualizer->UpdateDisplayedImage(imageUpdated);
+      if( imageUpdated )
+      {
+        this->RenderRequested = true;
+      }
+    }
+    else
+    {
+      this->GetImageActor()->SetInputData_vtk5compatible( this->SelectedChannel->GetBrightnessOutput() );
+    }
   }
 
   return PLUS_SUCCESS;
@@ -419,6 +438,26 @@ PlusStatus vtkVisualizationController::Update()
 
 //-----------------------------------------------------------------------------
 
+bool vtkVisualizationController::IsRenderRequested()
+{
+  if( this->RenderRequested )
+  {
+    return true;
+  }
+  // Points may be added or removed without a new frame (e.g., when the segmentation results are cleared)
+  return this->InputPolyData->GetMTime() > this->RenderedPolyDataMTime || this->ResultPolyData->GetMTime() > this->RenderedPolyDataMTime;
+}
+
+//-----------------------------------------------------------------------------
+
+void vtkVisualizationController::ClearRenderRequest()
+{
+  this->RenderRequested = false;
+  this->RenderedPolyDataMTime = std::max(this->InputPolyData->GetMTime(), this->ResultPolyData->GetMTime());
+}
+
+//-----------------------------------------------------------------------------
+
 vtkRenderer* vtkVisualizationController::GetCanvasRenderer()
 {
   if( this->CurrentMode == DISPLAY_MODE_3D && this->PerspectiveVisualizer != NULL)
@@ -598,7 +637,14 @@ PlusStatus vtkVisualizationController::ConnectInput()
   vtkPlusChannel* aChannel(NULL);
   if( this->GetImageActor() != NULL && this->SelectedChannel != NULL )
   {
-    this->GetImageActor()->SetInputData_vtk5compatible( this->SelectedChannel->GetBrightnessOutput() );
+    if( this->CurrentMode == DISPLAY_MODE_2D )
+    {
+      this->GetImageActor()->SetInputData_vtk5compatible( this->ImageVisualizer->GetDisplayedImage() );
+    }
+    else
+    {
+      this->GetImageActor()->SetInputData_vtk5compatible( this->SelectedChannel->GetBrightnessOutput() );
+    }
   }
 
   return PLUS_SUCCESS;
@@ -259,6 +259,14 @@ public:
 
   vtkRenderer* GetCanvasRenderer();
 
+  /*!
+    Returns true if the displayed content has changed since ClearRenderRequest was called, so the canvas has to be rendered.
+    In 2D mode only new frames (limited to the maximum render rate of the image visualizer) and modified points request rendering.
+  */
+  bool IsRenderRequested();
+  /*! Call after the canvas is rendered */
+  void ClearRenderRequest();
+
   bool Is2DMode();
   bool Is3DMode();
 
@@ -321,6 +329,12 @@ protected:
 
   vtkPlusChannel* SelectedChannel;
   vtkDataCollector* DataCollector;
+
+  /*! True if the displayed content has changed since the canvas was rendered */
+  bool RenderRequested;
+
+  /*! Modification time of the input and result points when the canvas was rendered */
+  unsigned long RenderedPolyDataMTime;
 };
 
 #endif  // __vtkVisualizationController_h
@@ -540,11 +540,16 @@ void StylusCalibrationToolbox::AddStylusPositionToCalibration()
         m_ParentMainWindow->GetVisualizationController()->GetCanvasRenderer()->ResetCamera();
       }
 
-      // If enough points have been acquired, stop
+      // If enough points have been acquired or the pivot point position does not change anymore, stop
       if (m_CurrentPointNumber >= m_NumberOfPoints)
       {
         Stop();
       }
+      else if (m_PivotCalibration->IsConverged())
+      {
+        LOG_INFO("Pivot calibration converged after " << m_CurrentPointNumber << " points, acquisition is stopped");
+        Stop();
+      }
       else
       {
         m_PreviousStylusToReferenceTransformMatrix->DeepCopy(stylusToReferenceTransformMatrix);
@@ -419,7 +419,12 @@ void fCalMainWindow::UpdateGUI()
     }
   }
 
-  ui.canvas->update();
+  // Only render if the displayed content has changed, new frames are displayed at most with the maximum render rate of the image visualizer
+  if (m_VisualizationController->IsRenderRequested())
+  {
+    ui.canvas->update();
+    m_VisualizationController->ClearRenderRequest();
+  }
 }
 
 //-----------------------------------------------------------------------------
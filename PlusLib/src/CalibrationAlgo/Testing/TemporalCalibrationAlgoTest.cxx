@@ -309,11 +309,15 @@ int main(int argc, char **argv)
   vtkTemporalCalibrationAlgo::TEMPORAL_CALIBRATION_ERROR error(vtkTemporalCalibrationAlgo::TEMPORAL_CALIBRATION_ERROR_NONE);
 
   //  Calculate the time-offset
+  double computationStartTimeSec = vtkAccurateTimer::GetSystemTime();
   if (testTemporalCalibrationObject->Update(error) != PLUS_SUCCESS)
   {
     LOG_ERROR("Cannot determine tracker lag, temporal calibration failed");
     exit(EXIT_FAILURE);
   }
+  double computationTimeSec = vtkAccurateTimer::GetSystemTime() - computationStartTimeSec;
+  LOG_INFO("Temporal calibration computation time: " << computationTimeSec << " sec (" << fixedFrames->GetNumberOfTrackedFrames() << " fixed and "
+    << movingFrames->GetNumberOfTrackedFrames() << " moving frames)");
 
   // Display results
   TemporalCalibrationResult calibResult;
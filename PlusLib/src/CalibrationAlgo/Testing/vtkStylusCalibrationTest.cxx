@@ -44,6 +44,7 @@ int main (int argc, char* argv[])
   int numberOfPointsToAcquire=100;
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
   double outlierGenerationProbability=0.0;
+  bool useRansac=false;
 
   vtksys::CommandLineArguments cmdargs;
   cmdargs.Initialize(argc, argv);
@@ -52,6 +53,7 @@ int main (int argc, char* argv[])
   cmdargs.AddArgument("--baseline-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBaselineFileName, "Name of file storing baseline calibration results");
   cmdargs.AddArgument("--number-of-points-to-acquire", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfPointsToAcquire, "Number of acquired points during the pivot calibration (default: 100)");
   cmdargs.AddArgument("--outlier-generation-probability", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outlierGenerationProbability, "Probability for a point being an outlier. If this number is larger than 0 then some valid measurement points are replaced by randomly generated samples to test the robustness of the algorithm. (range: 0.0-1.0; default: 0.0)");
+  cmdargs.AddArgument("--use-ransac", vtksys::CommandLineArguments::NO_ARGUMENT, &useRansac, "Use RANSAC for rejecting outliers instead of the robust least squares method");
   cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");  
 
   if ( !cmdargs.Parse() )
@@ -128,6 +130,10 @@ int main (int argc, char* argv[])
     LOG_ERROR("Unable to read pivot calibration configuration!");
     exit(EXIT_FAILURE);
   }
+  if (useRansac)
+  {
+    pivotCalibration->UseRansacOn();
+  }
 
   // Create and initialize transform repository
   TrackedFrame trackedFrame;
@@ -215,6 +221,12 @@ int main (int argc, char* argv[])
     exit(EXIT_FAILURE);
   }
 
+  if (pivotCalibration->GetLiveEstimateValid())
+  {
+    // The live estimate is computed without outlier rejection, so it is only informative
+    LOG_INFO("Live estimate calibration error (without outlier rejection): "<<pivotCalibration->GetLiveCalibrationError()<<" mm");
+  }
+
   LOG_INFO("Number of detected outliers: "<<pivotCalibration->GetNumberOfDetectedOutliers());
   LOG_INFO("Mean calibration error: "<<pivotCalibration->GetCalibrationError()<<" mm");
 
@@ -0,0 +1,306 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkVirtualTemporalCalibrationMonitorTest.cxx
+\brief This test runs the temporal calibration monitor on simulated devices
+
+A video device images a horizontal line and a tracker device reports the position of the probe
+that moves periodically. The tracker reports the position with a known delay. The test checks that
+the monitor estimates the delay and compensates it by changing the local time offset of the tracker.
+*/
+
+#include "PlusConfigure.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include "vtkAccurateTimer.h"
+#include "vtkMath.h"
+#include "vtkMatrix4x4.h"
+#include "vtkObjectFactory.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkTemporalCalibrationAlgoEstimator.h"
+#include "vtkVirtualTemporalCalibrationMonitor.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+
+const double MOTION_PERIOD_SEC=2.0;
+const double LINE_MOTION_AMPLITUDE_PIXEL=40.0;
+const double LINE_HALF_WIDTH_PIXEL=5.0;
+const double PROBE_MOTION_AMPLITUDE_MM=20.0;
+const int FRAME_SIZE[2]={160, 120};
+const double ACQUISITION_RATE=30.0;
+const double MAX_TIME_OFFSET_ERROR_SEC=0.02;
+
+const char* MONITOR_CONFIG=
+  "<PlusConfiguration>"
+  "  <DataCollection>"
+  "    <Device Id=\"TemporalCalibrationMonitor\" Type=\"VirtualTemporalCalibrationMonitor\""
+  "      MovingProbeToReferenceTransformName=\"ProbeToTracker\""
+  "      WindowSec=\"6\" UpdatePeriodSec=\"1\" MaximumMovingLagSec=\"0.5\" ApplyTimeOffset=\"TRUE\" />"
+  "  </DataCollection>"
+  "</PlusConfiguration>";
+
+//----------------------------------------------------------------------------
+// Device that generates the image of a line or the pose of a probe that moves periodically.
+// The motion is delayed by MotionDelaySec compared to the common motion start time.
+class vtkPeriodicMotionTestDevice : public vtkPlusDevice
+{
+public:
+  static vtkPeriodicMotionTestDevice *New();
+  vtkTypeRevisionMacro(vtkPeriodicMotionTestDevice, vtkPlusDevice);
+
+  virtual bool IsTracker() const { return !this->Tools.empty(); }
+
+  vtkSetMacro(MotionStartTime, double);
+  vtkSetMacro(MotionDelaySec, double);
+
+protected:
+  vtkPeriodicMotionTestDevice()
+    : MotionStartTime(0)
+    , MotionDelaySec(0)
+    , NextFrameTime(0)
+    , ToolMatrix(vtkMatrix4x4::New())
+  {
+    this->StartThreadForInternalUpdates = true;
+    this->AcquisitionRate = ACQUISITION_RATE;
+  }
+
+  virtual ~vtkPeriodicMotionTestDevice()
+  {
+    DELETE_IF_NOT_NULL(this->ToolMatrix);
+  }
+
+  virtual PlusStatus InternalConnect()
+  {
+    for ( DataSourceContainerConstIterator it = this->GetVideoIteratorBegin(); it != this->GetVideoIteratorEnd(); ++it )
+    {
+      vtkPlusBuffer* buffer = it->second->GetBuffer();
+      buffer->Clear();
+      buffer->SetFrameSize(FRAME_SIZE[0], FRAME_SIZE[1]);
+      buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+      buffer->SetNumberOfScalarComponents(1);
+      buffer->SetImageType(US_IMG_BRIGHTNESS);
+    }
+    this->FrameData.resize(FRAME_SIZE[0]*FRAME_SIZE[1]);
+    return PLUS_SUCCESS;
+  }
+
+  virtual PlusStatus InternalStartRecording()
+  {
+    this->NextFrameTime = vtkAccurateTimer::GetSystemTime();
+    return PLUS_SUCCESS;
+  }
+
+  virtual PlusStatus InternalUpdate()
+  {
+    // Generate all the frames that are due since the previous call
+    PlusStatus status = PLUS_SUCCESS;
+    const double currentTime = vtkAccurateTimer::GetSystemTime();
+    while ( this->NextFrameTime <= currentTime )
+    {
+      if ( this->GenerateFrame(this->NextFrameTime) != PLUS_SUCCESS )
+      {
+        status = PLUS_FAIL;
+      }
+      this->NextFrameTime += 1.0 / this->AcquisitionRate;
+    }
+    this->Modified();
+    return status;
+  }
+
+  PlusStatus GenerateFrame(double timestamp)
+  {
+    this->FrameNumber++;
+    const double motionPhase = sin(2.0 * vtkMath::Pi() * (timestamp - this->MotionStartTime - this->MotionDelaySec) / MOTION_PERIOD_SEC);
+
+    // Horizontal bright line with a triangular intensity profile
+    const double linePositionPixel = FRAME_SIZE[1] / 2 + LINE_MOTION_AMPLITUDE_PIXEL * motionPhase;
+    for ( int y = 0; y < FRAME_SIZE[1]; y++ )
+    {
+      double intensity = 255.0 * (1.0 - fabs(y - linePositionPixel) / LINE_HALF_WIDTH_PIXEL);
+      unsigned char pixelValue = static_cast<unsigned char>(intensity > 0 ? intensity : 0);
+      for ( int x = 0; x < FRAME_SIZE[0]; x++ )
+      {
+        this->FrameData[y*FRAME_SIZE[0]+x] = pixelValue;
+      }
+    }
+    for ( DataSourceContainerConstIterator it = this->GetVideoIteratorBegin(); it != this->GetVideoIteratorEnd(); ++it )
+    {
+      vtkPlusDataSource* videoSource = it->second;
+      if ( videoSource->GetBuffer()->AddItem(&this->FrameData[0], videoSource->GetPortImageOrientation(), FRAME_SIZE, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0,
+        this->FrameNumber, timestamp, timestamp) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to add generated frame to the buffer of " << videoSource->GetSourceId());
+        return PLUS_FAIL;
+      }
+    }
+
+    // Probe moves along the Z axis
+    this->ToolMatrix->Identity();
+    this->ToolMatrix->SetElement(2, 3, PROBE_MOTION_AMPLITUDE_MM * motionPhase);
+    for ( DataSourceContainerConstIterator it = this->GetToolIteratorBegin(); it != this->GetToolIteratorEnd(); ++it )
+    {
+      if ( this->ToolTimeStampedUpdateWithoutFiltering(it->second->GetSourceId(), this->ToolMatrix, TOOL_OK, timestamp, timestamp) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to add generated transform to the buffer of " << it->second->GetSourceId());
+        return PLUS_FAIL;
+      }
+    }
+
+    return PLUS_SUCCESS;
+  }
+
+  double MotionStartTime;
+  double MotionDelaySec;
+  double NextFrameTime;
+  vtkMatrix4x4* ToolMatrix;
+  std::vector<unsigned char> FrameData;
+
+private:
+  vtkPeriodicMotionTestDevice(const vtkPeriodicMotionTestDevice&);  // Not implemented.
+  void operator=(const vtkPeriodicMotionTestDevice&);  // Not implemented.
+};
+
+vtkCxxRevisionMacro(vtkPeriodicMotionTestDevice, "$Revision: 1.0$");
+vtkStandardNewMacro(vtkPeriodicMotionTestDevice);
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  double lagSec(0.1);
+  double testTimeSec(20.0);
+  int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--lag-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &lagSec, "Delay of the tracker data compared to the video data (Default: 0.1).");
+  args.AddArgument("--test-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &testTimeSec, "Duration of the data acquisition (Default: 20.0).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  const double motionStartTime = vtkAccurateTimer::GetSystemTime();
+
+  // Video (fixed) device
+  vtkSmartPointer<vtkPeriodicMotionTestDevice> videoDevice = vtkSmartPointer<vtkPeriodicMotionTestDevice>::New();
+  videoDevice->SetDeviceId("VideoDevice");
+  videoDevice->SetMotionStartTime(motionStartTime);
+  vtkSmartPointer<vtkPlusDataSource> videoSource = vtkSmartPointer<vtkPlusDataSource>::New();
+  videoSource->SetSourceId("Video");
+  videoSource->SetType(DATA_SOURCE_TYPE_VIDEO);
+  videoSource->SetPortImageOrientation(US_IMG_ORIENT_MF);
+  videoSource->GetBuffer()->SetImageOrientation(US_IMG_ORIENT_MF);
+  videoSource->GetBuffer()->SetBufferSize(200);
+  videoDevice->AddVideo(videoSource);
+  vtkSmartPointer<vtkPlusChannel> videoChannel = vtkSmartPointer<vtkPlusChannel>::New();
+  videoChannel->SetChannelId("VideoStream");
+  videoChannel->SetOwnerDevice(videoDevice);
+  videoChannel->SetVideoSource(videoSource);
+  videoDevice->AddOutputChannel(videoChannel);
+
+  // Tracker (moving) device, the probe pose is reported with a delay
+  vtkSmartPointer<vtkPeriodicMotionTestDevice> trackerDevice = vtkSmartPointer<vtkPeriodicMotionTestDevice>::New();
+  trackerDevice->SetDeviceId("TrackerDevice");
+  trackerDevice->SetToolReferenceFrameName("Tracker");
+  trackerDevice->SetMotionStartTime(motionStartTime);
+  trackerDevice->SetMotionDelaySec(lagSec);
+  vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+  tool->SetSourceId("ProbeToTracker");
+  tool->SetPortName("0");
+  tool->SetType(DATA_SOURCE_TYPE_TOOL);
+  tool->GetBuffer()->SetBufferSize(500);
+  trackerDevice->AddTool(tool);
+  vtkSmartPointer<vtkPlusChannel> trackerChannel = vtkSmartPointer<vtkPlusChannel>::New();
+  trackerChannel->SetChannelId("TrackerStream");
+  trackerChannel->SetOwnerDevice(trackerDevice);
+  trackerChannel->AddTool(tool);
+  trackerDevice->AddOutputChannel(trackerChannel);
+
+  // Monitor is declared after the input devices, so it is deleted first
+  vtkSmartPointer<vtkVirtualTemporalCalibrationMonitor> monitor = vtkSmartPointer<vtkVirtualTemporalCalibrationMonitor>::New();
+  monitor->SetDeviceId("TemporalCalibrationMonitor");
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(MONITOR_CONFIG));
+  if ( configRootElement == NULL || monitor->ReadConfiguration(configRootElement) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to read temporal calibration monitor configuration");
+    exit(EXIT_FAILURE);
+  }
+  monitor->AddInputChannel(videoChannel);
+  monitor->AddInputChannel(trackerChannel);
+  if ( monitor->NotifyConfigured() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Invalid temporal calibration monitor configuration");
+    exit(EXIT_FAILURE);
+  }
+  vtkSmartPointer<vtkTemporalCalibrationAlgoEstimator> estimator = vtkSmartPointer<vtkTemporalCalibrationAlgoEstimator>::New();
+  monitor->SetEstimator(estimator);
+
+  if ( videoDevice->StartRecording() != PLUS_SUCCESS || trackerDevice->StartRecording() != PLUS_SUCCESS || monitor->StartRecording() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to start recording");
+    exit(EXIT_FAILURE);
+  }
+
+  LOG_INFO("Acquire data for " << testTimeSec << " sec with a tracker lag of " << lagSec << " sec");
+  vtkAccurateTimer::Delay(testTimeSec);
+
+  monitor->StopRecording();
+  trackerDevice->StopRecording();
+  videoDevice->StopRecording();
+
+  int numberOfFailures = 0;
+
+  int numberOfEstimates = monitor->GetNumberOfEstimates();
+  LOG_INFO("Number of estimates: " << numberOfEstimates);
+  if ( numberOfEstimates < 1 )
+  {
+    LOG_ERROR("The temporal calibration monitor did not compute any estimate");
+    numberOfFailures++;
+  }
+
+  // The tracker lags by lagSec, so its timestamps shall be decreased by lagSec
+  double trackerTimeOffsetSec = trackerDevice->GetLocalTimeOffsetSec();
+  LOG_INFO("Tracker local time offset: " << trackerTimeOffsetSec << " sec (expected: " << -lagSec << " sec)");
+  if ( fabs(trackerTimeOffsetSec + lagSec) > MAX_TIME_OFFSET_ERROR_SEC )
+  {
+    LOG_ERROR("Tracker local time offset error is too large: " << fabs(trackerTimeOffsetSec + lagSec) << " sec (maximum allowed: " << MAX_TIME_OFFSET_ERROR_SEC << " sec)");
+    numberOfFailures++;
+  }
+
+  double videoTimeOffsetSec = videoDevice->GetLocalTimeOffsetSec();
+  if ( videoTimeOffsetSec != 0 )
+  {
+    LOG_ERROR("Video local time offset is changed to " << videoTimeOffsetSec << " sec, it shall not be modified");
+    numberOfFailures++;
+  }
+
+  if ( numberOfFailures > 0 )
+  {
+    LOG_ERROR("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -21,8 +21,10 @@ See License.txt for details.
 #include "vtkContextScene.h"
 #include "vtkContextView.h"
 #include "vtkDoubleArray.h"
+#include "vtkImageData.h"
 #include "vtkIntArray.h"
 #include "vtkLineSegmentationAlgo.h"
+#include "vtkMultiThreader.h"
 #include "vtkObjectFactory.h"
 #include "vtkPen.h"
 #include "vtkPlot.h"
@@ -64,7 +66,9 @@ vtkLineSegmentationAlgo::vtkLineSegmentationAlgo()
 , m_IntermediateFilesOutputDirectory("")
 , m_SignalTimeRangeMin(0.0)
 , m_SignalTimeRangeMax(-1.0)
+, m_NumberOfThreads(0)
 {  
+  m_Threader = vtkSmartPointer<vtkMultiThreader>::New();
   m_ClipRectangleOrigin[0] = 0;
   m_ClipRectangleOrigin[1] = 0;
   m_ClipRectangleSize[0] = 0;
@@ -89,6 +93,12 @@ void vtkLineSegmentationAlgo::SetSignalTimeRange(double rangeMin, double rangeMa
   m_SignalTimeRangeMax = rangeMax;
 }
 
+//-----------------------------------------------------------------------------
+void vtkLineSegmentationAlgo::SetNumberOfThreads(int numberOfThreads)
+{
+  m_NumberOfThreads = numberOfThreads;
+}
+
 //-----------------------------------------------------------------------------
 void vtkLineSegmentationAlgo::SetSaveIntermediateImages(bool saveIntermediateImages)
 {
@@ -184,219 +194,272 @@ PlusStatus vtkLineSegmentationAlgo::ComputeVideoPositionMetric()
   nonDetectedLineParams.lineOriginPoint_Image[1]=0;
   nonDetectedLineParams.lineDirectionVector_Image[0]=0;
   nonDetectedLineParams.lineDirectionVector_Image[1]=1;
-  m_LineParameters.assign(m_TrackedFrameList->GetNumberOfTrackedFrames(), nonDetectedLineParams);
+  int numberOfFrames=m_TrackedFrameList->GetNumberOfTrackedFrames();
+  m_LineParameters.assign(numberOfFrames, nonDetectedLineParams);
+  m_FrameSignalValues.assign(numberOfFrames, 0.0);
 
   //  For each video frame, detect line and extract mindpoint and slope parameters
-  int numberOfSuccessfulLineSegmentations=0;
-  bool signalTimeRangeDefined=(m_SignalTimeRangeMin<=m_SignalTimeRangeMax);
-  for(unsigned int frameNumber = 0; frameNumber < m_TrackedFrameList->GetNumberOfTrackedFrames(); ++frameNumber)
+  // Frames are processed independently, so they are distributed among multiple threads. Saving of intermediate images and
+  // plotting of intensity profiles is not thread-safe, therefore if any of them is enabled then all frames are processed in this thread.
+  bool plotIntensityProfile = vtkPlusLogger::Instance()->GetLogLevel()>=vtkPlusLogger::LOG_LEVEL_TRACE;
+  if (m_SaveIntermediateImages || plotIntensityProfile)
   {
-    LOG_TRACE("Calculating video position metric for frame " << frameNumber);
-    TrackedFrame* trackedFrame=m_TrackedFrameList->GetTrackedFrame(frameNumber);
-    if (signalTimeRangeDefined && (trackedFrame->GetTimestamp()<m_SignalTimeRangeMin || trackedFrame->GetTimestamp()>m_SignalTimeRangeMax))
+    SegmentFrames(0, numberOfFrames-1);
+  }
+  else
+  {
+    if (m_NumberOfThreads>0)
     {
-      // frame is out of the specified signal range
-      LOG_TRACE("Skip frame, it is out of the valid signal range");
-      continue;
+      m_Threader->SetNumberOfThreads(m_NumberOfThreads);
     }
+    m_Threader->SetSingleMethod(SegmentFramesThreadFunction, this);
+    m_Threader->SingleMethodExecute();
+  }
 
-    typedef float floatPixelType; //  The type of pixel used for the Hough accumulator
-
-    // Get current image
-    if ( trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
-    {
-      LOG_ERROR("vtkLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images"); 
-      continue;
-    }
-    CharImageType::Pointer localImage = CharImageType::New(); 
-    PlusVideoFrame::DeepCopyVtkImageToItkImage<CharPixelType>(trackedFrame->GetImageData()->GetImage(), localImage);
-    if(localImage.IsNull())
+  // Collect the results in the order of the frames
+  int numberOfSuccessfulLineSegmentations=0;
+  for(int frameNumber = 0; frameNumber < numberOfFrames; ++frameNumber)
+  {
+    if (!m_LineParameters[frameNumber].lineDetected)
     {
-      // Dropped frame
-      LOG_ERROR("vtkLineSegmentationAlgo::ComputeVideoPositionMetric failed to retrieve image data from frame"); 
       continue;
     }
+    ++numberOfSuccessfulLineSegmentations;
+    m_SignalValues.push_back(m_FrameSignalValues[frameNumber]);
+    m_SignalTimestamps.push_back(m_TrackedFrameList->GetTrackedFrame(frameNumber)->GetTimestamp());
+  }
 
-    // Create an image duplicator to copy the original image
-    typedef itk::ImageDuplicator<CharImageType> DuplicatorType;
-    DuplicatorType::Pointer duplicator = DuplicatorType::New();
-    CharImageType::Pointer scanlineImage;
-    if(m_SaveIntermediateImages == true)
-    {
-      duplicator->SetInputImage(localImage);
-      duplicator->Update();
+  double segmentationSuccessRate=double(numberOfSuccessfulLineSegmentations)/m_TrackedFrameList->GetNumberOfTrackedFrames();
+  if (segmentationSuccessRate<EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  {
+    LOG_WARNING("Line segmentation success rate is very low ("<<segmentationSuccessRate*100<<"%): a line could only be detected on "<<numberOfSuccessfulLineSegmentations<<" frames out of "<<m_TrackedFrameList->GetNumberOfTrackedFrames());
+  }
 
-      // Create an image copy to draw the scanlines on
-      scanlineImage = duplicator->GetOutput();
-    }
+  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel()>=vtkPlusLogger::LOG_LEVEL_TRACE;
+  if (plotVideoMetric)
+  {
+    PlotDoubleArray(m_SignalValues);
+  }
 
-    std::vector<itk::Point<double,2> > intensityPeakPositions;
-    CharImageType::RegionType region = localImage->GetLargestPossibleRegion();
-    LimitToClipRegion(region);
+  return PLUS_SUCCESS;
 
-    int numOfValidScanlines = 0;
+} //  End LineDetection
 
-    for(int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
-    {
-      // Set the scanline start pixel
-      CharImageType::IndexType startPixel;
-      double scanlineSpacingPix = static_cast<double>(region.GetSize()[0]-1) / (NUMBER_OF_SCANLINES - 1);
-      startPixel[0] = region.GetIndex()[0]+scanlineSpacingPix * (currScanlineNum);
-      startPixel[1] = region.GetIndex()[1];
-
-      // Set the scanline end pixel
-      CharImageType::IndexType endPixel;
-      endPixel[0] = startPixel[0];
-      endPixel[1] = startPixel[1]+region.GetSize()[1] - 1;
-
-      std::deque<int> intensityProfile; // Holds intensity profile of the line
-      itk::LineIterator<CharImageType> it(localImage, startPixel, endPixel); 
-      it.GoToBegin();
-
-      itk::LineIterator<CharImageType> *itScanlineImage = NULL;
-      if(m_SaveIntermediateImages == true)
-      {
-        // Iterator for the scanline image copy
-        // it's time-consuming to instantiate this iterator, so only do it if intermediate image saving is requested
-        itScanlineImage = new itk::LineIterator<CharImageType>(scanlineImage, startPixel, endPixel);
-        itScanlineImage->GoToBegin();
-      }
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkLineSegmentationAlgo::SegmentFramesThreadFunction( void *arg )
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+  vtkLineSegmentationAlgo *self = static_cast<vtkLineSegmentationAlgo*>(threadInfo->UserData);
 
-      while (!it.IsAtEnd())
-      {
-        intensityProfile.push_back((int)it.Get());
-        if(m_SaveIntermediateImages == true)
-        {
-          // Set the pixels on the scanline image copy to white
-          itScanlineImage->Set(255);
-          ++(*itScanlineImage);
-        }
-        ++it;
-      }
+  // Each thread processes a contiguous range of frames
+  int numberOfFrames = self->m_TrackedFrameList->GetNumberOfTrackedFrames();
+  int firstFrameNumber = (numberOfFrames * threadInfo->ThreadID) / threadInfo->NumberOfThreads;
+  int lastFrameNumber = (numberOfFrames * (threadInfo->ThreadID+1)) / threadInfo->NumberOfThreads - 1;
+  self->SegmentFrames(firstFrameNumber, lastFrameNumber);
 
-      // Delete the iterator declared with new()
-      if(itScanlineImage != NULL)
-      {
-        delete itScanlineImage;
-        itScanlineImage = NULL;
-      }
+  return VTK_THREAD_RETURN_VALUE;
+}
 
-      bool plotIntensityProfile = vtkPlusLogger::Instance()->GetLogLevel()>=vtkPlusLogger::LOG_LEVEL_TRACE;
-      if(plotIntensityProfile)
-      {
-        // Plot the intensity profile
-        PlotIntArray(intensityProfile);
-      }
+//-----------------------------------------------------------------------------
+void vtkLineSegmentationAlgo::SegmentFrames(int firstFrameNumber, int lastFrameNumber)
+{
+  // Buffers are allocated only once and reused for all the frames that are processed in this thread
+  std::vector<int> intensityProfile;
+  std::vector<itk::Point<double,2> > intensityPeakPositions;
+  intensityPeakPositions.reserve(NUMBER_OF_SCANLINES);
 
-      // Find the max intensity value from the peak with the largest area
-      int maxFromLargestArea = -1;
-      int maxFromLargestAreaIndex = -1;
-      int startOfMaxArea = -1;
-      if(FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
-      {
-        double currPeakPos_y = -1; 
-        switch (PEAK_POS_METRIC)
-        {
-        case PEAK_POS_COG:
-          {
-            /* Use center-of-gravity (COG) as peak-position metric*/
-            if(ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-            {
-              // unable to compute center-of-gravity; this scanline is invalid
-              continue;
-            }
-            break;
-          }
-        case PEAK_POS_START:
-          {
-            /* Use peak start as peak-position metric*/
-            if(FindPeakStart(intensityProfile,maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-            {
-              // unable to compute peak start; this scanline is invalid
-              continue;
-            }
-            break;
-          }
-        }
+  for(int frameNumber = firstFrameNumber; frameNumber <= lastFrameNumber; ++frameNumber)
+  {
+    SegmentFrame(frameNumber, intensityProfile, intensityPeakPositions);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLineSegmentationAlgo::SegmentFrame(int frameNumber, std::vector<int> &intensityProfile, std::vector<itk::Point<double,2> > &intensityPeakPositions)
+{
+  LOG_TRACE("Calculating video position metric for frame " << frameNumber);
+  TrackedFrame* trackedFrame=m_TrackedFrameList->GetTrackedFrame(frameNumber);
+  bool signalTimeRangeDefined=(m_SignalTimeRangeMin<=m_SignalTimeRangeMax);
+  if (signalTimeRangeDefined && (trackedFrame->GetTimestamp()<m_SignalTimeRangeMin || trackedFrame->GetTimestamp()>m_SignalTimeRangeMax))
+  {
+    // frame is out of the specified signal range
+    LOG_TRACE("Skip frame, it is out of the valid signal range");
+    return;
+  }
+
+  // Get current image
+  if ( trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
+  {
+    LOG_ERROR("vtkLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images"); 
+    return;
+  }
+  vtkImageData* frameImage = trackedFrame->GetImageData()->GetImage();
+  if (frameImage == NULL)
+  {
+    // Dropped frame
+    LOG_ERROR("vtkLineSegmentationAlgo::ComputeVideoPositionMetric failed to retrieve image data from frame"); 
+    return;
+  }
+  if (frameImage->GetNumberOfScalarComponents() != 1)
+  {
+    LOG_ERROR("vtkLineSegmentationAlgo::ComputeVideoPositionMetric only supports single-component images"); 
+    return;
+  }
+  int frameSize[3]={0,0,0};
+  frameImage->GetDimensions(frameSize);
+  // The scanlines are read directly from the frame buffer, no ITK image is created (unless it is needed for saving intermediate images)
+  const unsigned char* framePixels = static_cast<const unsigned char*>(frameImage->GetScalarPointer());
+
+  CharImageType::Pointer scanlineImage;
+  if(m_SaveIntermediateImages == true)
+  {
+    // Create an image copy to draw the scanlines on
+    scanlineImage = CharImageType::New();
+    PlusVideoFrame::DeepCopyVtkImageToItkImage<CharPixelType>(frameImage, scanlineImage);
+  }
 
-        itk::Point<double, 2> currPeakPos;
-        currPeakPos[0] = static_cast<double>(startPixel[0]);
-        currPeakPos[1] = startPixel[1]+currPeakPos_y;
-        intensityPeakPositions.push_back(currPeakPos);
-        ++numOfValidScanlines;
+  CharImageType::IndexType frameIndex;
+  frameIndex[0] = 0;
+  frameIndex[1] = 0;
+  CharImageType::SizeType frameRegionSize;
+  frameRegionSize[0] = frameSize[0];
+  frameRegionSize[1] = frameSize[1];
+  CharImageType::RegionType region;
+  region.SetIndex(frameIndex);
+  region.SetSize(frameRegionSize);
+  LimitToClipRegion(region);
 
-      } // end if() found intensity peak
+  intensityPeakPositions.clear();
+  int numOfValidScanlines = 0;
 
-    } // end currScanlineNum loop
+  bool plotIntensityProfile = vtkPlusLogger::Instance()->GetLogLevel()>=vtkPlusLogger::LOG_LEVEL_TRACE;
+  double scanlineSpacingPix = static_cast<double>(region.GetSize()[0]-1) / (NUMBER_OF_SCANLINES - 1);
+  int scanlineStartY = region.GetIndex()[1];
+  int scanlineLength = region.GetSize()[1];
+  intensityProfile.resize(scanlineLength); // Holds intensity profile of the line
 
-    if(numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
+  for(int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
+  {
+    // Scanlines are vertical, from the top to the bottom of the region
+    int scanlineX = static_cast<int>(region.GetIndex()[0]+scanlineSpacingPix * (currScanlineNum));
+
+    const unsigned char* pixel = framePixels + scanlineStartY * frameSize[0] + scanlineX;
+    for (int pixelLoc = 0; pixelLoc < scanlineLength; ++pixelLoc, pixel += frameSize[0])
     {
-      //TODO: drop the frame from the analysis
-      LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame" << frameNumber);
+      intensityProfile[pixelLoc] = (*pixel);
     }
 
-    LineParameters params;
-    ComputeLineParameters(intensityPeakPositions, params);
-    if( !params.lineDetected )
+    if(m_SaveIntermediateImages == true)
     {
-      LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
-      continue;
+      // Set the pixels on the scanline image copy to white
+      CharImageType::IndexType scanlinePixel;
+      scanlinePixel[0] = scanlineX;
+      for (int y = scanlineStartY; y < scanlineStartY + scanlineLength; ++y)
+      {
+        scanlinePixel[1] = y;
+        scanlineImage->SetPixel(scanlinePixel, 255);
+      }
     }
-    if( params.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+
+    if(plotIntensityProfile)
     {
-      // Line is close to vertical, skip frame because intersection of 
-      // line with image's horizontal half point is unstable
-      LOG_TRACE("Line on frame "<<frameNumber<<" is too close to vertical, skip the frame");
-      continue;
+      // Plot the intensity profile
+      PlotIntArray(intensityProfile);
     }
 
-    ++numberOfSuccessfulLineSegmentations;
-    m_LineParameters[frameNumber]=params;
-
-    // Store the y-value of the line, when the line's x-value is half of the image's width
-    double t = ( region.GetIndex()[0] + 0.5 * region.GetSize()[0] - params.lineOriginPoint_Image[0] ) / params.lineDirectionVector_Image[0]; 
-    m_SignalValues.push_back( std::abs( params.lineOriginPoint_Image[1] + t * params.lineDirectionVector_Image[1] ) );
+    // Find the max intensity value from the peak with the largest area
+    int maxFromLargestArea = -1;
+    int maxFromLargestAreaIndex = -1;
+    int startOfMaxArea = -1;
+    if(FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
+    {
+      double currPeakPos_y = -1; 
+      switch (PEAK_POS_METRIC)
+      {
+      case PEAK_POS_COG:
+        {
+          /* Use center-of-gravity (COG) as peak-position metric*/
+          if(ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+          {
+            // unable to compute center-of-gravity; this scanline is invalid
+            continue;
+          }
+          break;
+        }
+      case PEAK_POS_START:
+        {
+          /* Use peak start as peak-position metric*/
+          if(FindPeakStart(intensityProfile,maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+          {
+            // unable to compute peak start; this scanline is invalid
+            continue;
+          }
+          break;
+        }
+      }
 
-    //  Store timestamp for image frame
-    m_SignalTimestamps.push_back(m_TrackedFrameList->GetTrackedFrame(frameNumber)->GetTimestamp());
+      itk::Point<double, 2> currPeakPos;
+      currPeakPos[0] = static_cast<double>(scanlineX);
+      currPeakPos[1] = scanlineStartY+currPeakPos_y;
+      intensityPeakPositions.push_back(currPeakPos);
+      ++numOfValidScanlines;
 
-    if(m_SaveIntermediateImages == true)
-    {
-      SaveIntermediateImage(frameNumber, scanlineImage, 
-        params.lineOriginPoint_Image[0], params.lineOriginPoint_Image[1], params.lineDirectionVector_Image[0], params.lineDirectionVector_Image[1], 
-        numOfValidScanlines, intensityPeakPositions);
-    }
+    } // end if() found intensity peak
 
-  } // end frameNum loop
+  } // end currScanlineNum loop
 
-  double segmentationSuccessRate=double(numberOfSuccessfulLineSegmentations)/m_TrackedFrameList->GetNumberOfTrackedFrames();
-  if (segmentationSuccessRate<EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  if(numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
   {
-    LOG_WARNING("Line segmentation success rate is very low ("<<segmentationSuccessRate*100<<"%): a line could only be detected on "<<numberOfSuccessfulLineSegmentations<<" frames out of "<<m_TrackedFrameList->GetNumberOfTrackedFrames());
+    //TODO: drop the frame from the analysis
+    LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame" << frameNumber);
   }
 
-  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel()>=vtkPlusLogger::LOG_LEVEL_TRACE;
-  if (plotVideoMetric)
+  LineParameters params;
+  ComputeLineParameters(intensityPeakPositions, params);
+  if( !params.lineDetected )
   {
-    PlotDoubleArray(m_SignalValues);
+    LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
+    return;
+  }
+  if( params.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+  {
+    // Line is close to vertical, skip frame because intersection of 
+    // line with image's horizontal half point is unstable
+    LOG_TRACE("Line on frame "<<frameNumber<<" is too close to vertical, skip the frame");
+    return;
   }
 
-  return PLUS_SUCCESS;
+  m_LineParameters[frameNumber]=params;
 
-} //  End LineDetection
+  // Store the y-value of the line, when the line's x-value is half of the image's width
+  double t = ( region.GetIndex()[0] + 0.5 * region.GetSize()[0] - params.lineOriginPoint_Image[0] ) / params.lineDirectionVector_Image[0]; 
+  m_FrameSignalValues[frameNumber] = std::abs( params.lineOriginPoint_Image[1] + t * params.lineDirectionVector_Image[1] );
+
+  if(m_SaveIntermediateImages == true)
+  {
+    SaveIntermediateImage(frameNumber, scanlineImage, 
+      params.lineOriginPoint_Image[0], params.lineOriginPoint_Image[1], params.lineDirectionVector_Image[0], params.lineDirectionVector_Image[1], 
+      numOfValidScanlines, intensityPeakPositions);
+  }
+}
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkLineSegmentationAlgo::FindPeakStart(std::deque<int> &intensityProfile,int maxFromLargestArea, int startOfMaxArea, double &startOfPeak)
+PlusStatus vtkLineSegmentationAlgo::FindPeakStart(const std::vector<int> &intensityProfile,int maxFromLargestArea, int startOfMaxArea, double &startOfPeak)
 {
   // Start of peak is defined as the location at which it reaches 50% of its maximum value.
   double startPeakValue = maxFromLargestArea * 0.5;
 
   int pixelIndex = startOfMaxArea;
+  int profileLength = intensityProfile.size();
 
-  while( intensityProfile.at(pixelIndex) <= startPeakValue)
+  while( pixelIndex < profileLength && intensityProfile[pixelIndex] <= startPeakValue)
   {
     ++pixelIndex;
   }
+  if (pixelIndex >= profileLength)
+  {
+    return PLUS_FAIL;
+  }
 
   startOfPeak = --pixelIndex;
 
@@ -404,7 +467,21 @@ PlusStatus vtkLineSegmentationAlgo::FindPeakStart(std::deque<int> &intensityProf
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkLineSegmentationAlgo::FindLargestPeak(std::deque<int> &intensityProfile,int &maxFromLargestArea, int &maxFromLargestAreaIndex, int &startOfMaxArea)
+int vtkLineSegmentationAlgo::GetMaximumIntensity(const std::vector<int> &intensityProfile)
+{
+  // Simple reduction on a contiguous array without early exit, so that the compiler can vectorize it
+  const int* values = &intensityProfile[0];
+  int profileLength = intensityProfile.size();
+  int intensityMax = values[0];
+  for(int pixelLoc = 1; pixelLoc < profileLength; ++pixelLoc)
+  {
+    intensityMax = (values[pixelLoc] > intensityMax) ? values[pixelLoc] : intensityMax;
+  }
+  return intensityMax;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkLineSegmentationAlgo::FindLargestPeak(const std::vector<int> &intensityProfile,int &maxFromLargestArea, int &maxFromLargestAreaIndex, int &startOfMaxArea)
 {
   int currentLargestArea = 0;
   int currentArea = 0;
@@ -422,40 +499,36 @@ PlusStatus vtkLineSegmentationAlgo::FindLargestPeak(std::deque<int> &intensityPr
     return PLUS_FAIL;
   }
 
-  double intensityMax = intensityProfile.at(0);
-  for(unsigned int pixelLoc = 1; pixelLoc < intensityProfile.size(); ++pixelLoc)
-  {
-    if(intensityProfile.at(pixelLoc) > intensityMax)
-    {
-      intensityMax = intensityProfile.at(pixelLoc);
-    }
-  }
+  double intensityMax = GetMaximumIntensity(intensityProfile);
 
   double peakIntensityThreshold = intensityMax * INTESNITY_THRESHOLD_PERCENTAGE_OF_PEAK; 
 
-  for(int pixelLoc = 0; pixelLoc < intensityProfile.size(); ++pixelLoc)
+  const int* values = &intensityProfile[0];
+  int profileLength = intensityProfile.size();
+  for(int pixelLoc = 0; pixelLoc < profileLength; ++pixelLoc)
   {
-    if(intensityProfile.at(pixelLoc) > peakIntensityThreshold  && !underPeak)
+    int value = values[pixelLoc];
+    if(value > peakIntensityThreshold  && !underPeak)
     {
       // reached start of the peak
       underPeak = true;
-      currentMax = intensityProfile.at(pixelLoc);
+      currentMax = value;
       currentMaxIndex = pixelLoc;
-      currentArea = intensityProfile.at(pixelLoc);
+      currentArea = value;
       currentStart = pixelLoc;
     }
-    else if(intensityProfile.at(pixelLoc) > peakIntensityThreshold  && underPeak)
+    else if(value > peakIntensityThreshold  && underPeak)
     {
       // still under the the peak, cumulate the area
-      currentArea += intensityProfile.at(pixelLoc);
+      currentArea += value;
 
-      if(intensityProfile.at(pixelLoc) > currentMax)
+      if(value > currentMax)
       {
-        currentMax = intensityProfile.at(pixelLoc);
+        currentMax = value;
         currentMaxIndex = pixelLoc;
       }
     }
-    else if(intensityProfile.at(pixelLoc) < peakIntensityThreshold && underPeak)
+    else if(value < peakIntensityThreshold && underPeak)
     {
       // exited the peak area
       underPeak = false;
@@ -483,32 +556,32 @@ PlusStatus vtkLineSegmentationAlgo::FindLargestPeak(std::deque<int> &intensityPr
 }
 //-----------------------------------------------------------------------------
 
-PlusStatus vtkLineSegmentationAlgo::ComputeCenterOfGravity(std::deque<int> &intensityProfile, int startOfMaxArea, double &centerOfGravity)
+PlusStatus vtkLineSegmentationAlgo::ComputeCenterOfGravity(const std::vector<int> &intensityProfile, int startOfMaxArea, double &centerOfGravity)
 {
   if(intensityProfile.size() == 0)
   {
     return PLUS_FAIL;
   }
 
-  double intensityMax = intensityProfile.at(0);
-  for(unsigned int pixelLoc = 1; pixelLoc < intensityProfile.size(); ++pixelLoc)
-  {
-    if(intensityProfile.at(pixelLoc) > intensityMax)
-    {
-      intensityMax = intensityProfile.at(pixelLoc);
-    }
-  }
+  double intensityMax = GetMaximumIntensity(intensityProfile);
 
   double peakIntensityThreshold = intensityMax * INTESNITY_THRESHOLD_PERCENTAGE_OF_PEAK; 
 
-  int pixelLoc = startOfMaxArea;
-  int pointsInPeak = 0;
+  // Find the end of the peak first, then compute the weighted sum in a separate loop that the compiler can vectorize
+  const int* values = &intensityProfile[0];
+  int profileLength = intensityProfile.size();
+  int endOfPeak = startOfMaxArea;
+  while(endOfPeak < profileLength && values[endOfPeak] > peakIntensityThreshold)
+  {
+    ++endOfPeak;
+  }
+
   double intensitySum = 0;
-  while(intensityProfile.at(pixelLoc) > peakIntensityThreshold)
+  int pointsInPeak = 0;
+  for(int pixelLoc = startOfMaxArea; pixelLoc < endOfPeak; ++pixelLoc)
   {
-    intensitySum += pixelLoc * intensityProfile.at(pixelLoc);
-    pointsInPeak += intensityProfile.at(pixelLoc);
-    ++pixelLoc;
+    intensitySum += pixelLoc * values[pixelLoc];
+    pointsInPeak += values[pixelLoc];
   }
 
   if(pointsInPeak == 0)
@@ -715,7 +788,7 @@ PlusStatus vtkLineSegmentationAlgo::Update()
 }
 
 //-----------------------------------------------------------------------------
-void vtkLineSegmentationAlgo::PlotIntArray(const std::deque<int> &intensityValues)
+void vtkLineSegmentationAlgo::PlotIntArray(const std::vector<int> &intensityValues)
 {
   //  Create table
   vtkSmartPointer<vtkTable> table = vtkSmartPointer<vtkTable>::New();
@@ -939,6 +1012,7 @@ PlusStatus vtkLineSegmentationAlgo::Reset()
   m_SignalValues.clear();
   m_SignalTimestamps.clear();
   m_LineParameters.clear();
+  m_FrameSignalValues.clear();
 
   return PLUS_SUCCESS;
 }
@@ -8,8 +8,10 @@
 #define __vtkLineSegmentationAlgo_h
 
 #include "itkImage.h"
+#include "vtkMultiThreader.h"
 #include "vtkObject.h"
 #include <deque>
+#include <vector>
 
 class vtkTrackedFrameList;
 
@@ -72,6 +74,9 @@ public:
   
   void SetIntermediateFilesOutputDirectory(const std::string &outputDirectory);
 
+  /*! Set the number of threads used for processing the frames. If 0 (default) then the number of threads is determined automatically. */
+  void SetNumberOfThreads(int numberOfThreads);
+
   PlusStatus Reset();
 
 protected:
@@ -82,15 +87,30 @@ protected:
 
   PlusStatus ComputeVideoPositionMetric();
 
-  PlusStatus FindPeakStart(std::deque<int> &intensityProfile,int maxFromLargestArea, int startOfMaxArea, double &startOfPeak);
+  /*! Thread function for processing a range of frames. Called by vtkMultiThreader, the user data is the algorithm object. */
+  static VTK_THREAD_RETURN_TYPE SegmentFramesThreadFunction( void *arg );
+
+  /*! Detect the line on the frames between firstFrameNumber and lastFrameNumber (inclusive) */
+  void SegmentFrames(int firstFrameNumber, int lastFrameNumber);
+
+  /*!
+    Detect the line on one frame and store the results in m_LineParameters and m_FrameSignalValues.
+    The intensityProfile and intensityPeakPositions buffers are only used for temporary storage, they are passed as parameters so that they can be reused.
+  */
+  void SegmentFrame(int frameNumber, std::vector<int> &intensityProfile, std::vector<itk::Point<double,2> > &intensityPeakPositions);
+
+  PlusStatus FindPeakStart(const std::vector<int> &intensityProfile,int maxFromLargestArea, int startOfMaxArea, double &startOfPeak);
+
+  PlusStatus FindLargestPeak(const std::vector<int> &intensityProfile,int &maxFromLargestArea, int &maxFromLargestAreaIndex, int &startOfMaxArea);
 
-  PlusStatus FindLargestPeak(std::deque<int> &intensityProfile,int &maxFromLargestArea, int &maxFromLargestAreaIndex, int &startOfMaxArea);
+  PlusStatus ComputeCenterOfGravity(const std::vector<int> &intensityProfile, int startOfMaxArea, double &centerOfGravity);
 
-  PlusStatus ComputeCenterOfGravity(std::deque<int> &intensityProfile, int startOfMaxArea, double &centerOfGravity);
+  /*! Get the maximum value of a (non-empty) intensity profile */
+  static int GetMaximumIntensity(const std::vector<int> &intensityProfile);
 
   void ComputeLineParameters(std::vector<itk::Point<double,2> > &data, LineParameters& outputParameters );
 
-  void PlotIntArray(const std::deque<int> &intensityValues);
+  void PlotIntArray(const std::vector<int> &intensityValues);
 
   void PlotDoubleArray(const std::deque<double> &intensityValues);
 
@@ -106,6 +126,9 @@ protected:
   std::deque<double> m_SignalTimestamps;
   std::vector<LineParameters> m_LineParameters;
 
+  /*! Line position for each input frame (only valid if the line is detected on the frame) */
+  std::vector<double> m_FrameSignalValues;
+
   /*! If "true" then images of intermediate steps (i.e. scanlines used, detected lines) are saved in local directory */
   bool m_SaveIntermediateImages;
 
@@ -121,6 +144,12 @@ protected:
   /*! Clip rectangle origin for the processing (in pixels). Everything outside the rectangle is ignored. */
   int m_ClipRectangleSize[2]; 
 
+  /*! Threader for processing the frames in parallel */
+  vtkSmartPointer<vtkMultiThreader> m_Threader;
+
+  /*! Number of threads used for processing the frames (0 means that the default number of threads is used) */
+  int m_NumberOfThreads;
+
 private:
   vtkLineSegmentationAlgo(const vtkLineSegmentationAlgo&);
   void operator=(const vtkLineSegmentationAlgo&);
@@ -0,0 +1,170 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PivotParametersEstimator.h"
+#include <vnl/algo/vnl_svd.h>
+
+namespace itk {
+
+// Minimum number of poses for computing the pivot point. In theory 2 poses are enough, but with 3 poses
+// it is less likely that a randomly selected subset is degenerate (rotation around the same axis).
+static const unsigned int MINIMUM_NUMBER_OF_POSES_FOR_ESTIMATE = 3;
+
+// If the ratio of the smallest and largest singular value of the normal matrix is smaller than this then
+// the poses are considered to be degenerate (not enough rotation).
+static const double MINIMUM_NORMAL_MATRIX_CONDITION_RECIPROCAL = 1e-8;
+
+//----------------------------------------------------------------------------
+PivotParametersEstimator::PivotParametersEstimator()
+{
+  this->deltaSquared = 1.0;
+  this->minForEstimate = MINIMUM_NUMBER_OF_POSES_FOR_ESTIMATE;
+}
+
+//----------------------------------------------------------------------------
+PivotParametersEstimator::~PivotParametersEstimator()
+{
+}
+
+//----------------------------------------------------------------------------
+void PivotParametersEstimator::SetDelta( double delta )
+{
+  this->deltaSquared = delta*delta;
+}
+
+//----------------------------------------------------------------------------
+double PivotParametersEstimator::GetDelta()
+{
+  return sqrt( this->deltaSquared );
+}
+
+//----------------------------------------------------------------------------
+void PivotParametersEstimator::Estimate( std::vector< PoseType *> &data, std::vector<double> &parameters )
+{
+  // The exact estimate from the minimal number of poses is also a least squares problem (3 equations per pose, 6 unknowns)
+  LeastSquaresEstimate( data, parameters );
+}
+
+//----------------------------------------------------------------------------
+void PivotParametersEstimator::Estimate( std::vector< PoseType > &data, std::vector<double> &parameters )
+{
+  std::vector< PoseType *> usedData;
+  for( unsigned int i=0; i<data.size(); i++ )
+  {
+    usedData.push_back( &(data[i]) );
+  }
+  Estimate( usedData, parameters );
+}
+
+//----------------------------------------------------------------------------
+void PivotParametersEstimator::LeastSquaresEstimate( std::vector< PoseType *> &data, std::vector<double> &parameters )
+{
+  parameters.clear();
+  if( data.size() < this->minForEstimate )
+  {
+    return;
+  }
+
+  NormalMatrixType normalMatrix(0.0);
+  NormalVectorType normalVector(0.0);
+  double sumOfSquaredTranslations = 0;
+  double pose[4][4];
+  for( unsigned int i=0; i<data.size(); i++ )
+  {
+    for( int row=0; row<4; row++ )
+    {
+      for( int col=0; col<4; col++ )
+      {
+        pose[row][col] = (*data[i])(row,col);
+      }
+    }
+    AddPoseToNormalEquations( pose, normalMatrix, normalVector, sumOfSquaredTranslations );
+  }
+
+  NormalVectorType solution;
+  if( !SolveNormalEquations( normalMatrix, normalVector, solution ) )
+  {
+    return;
+  }
+  for( int i=0; i<6; i++ )
+  {
+    parameters.push_back( solution[i] );
+  }
+}
+
+//----------------------------------------------------------------------------
+void PivotParametersEstimator::LeastSquaresEstimate( std::vector< PoseType > &data, std::vector<double> &parameters )
+{
+  std::vector< PoseType *> usedData;
+  for( unsigned int i=0; i<data.size(); i++ )
+  {
+    usedData.push_back( &(data[i]) );
+  }
+  LeastSquaresEstimate( usedData, parameters );
+}
+
+//----------------------------------------------------------------------------
+bool PivotParametersEstimator::Agree( std::vector<double> &parameters, PoseType &data )
+{
+  double distanceSquared = 0;
+  for( int row=0; row<3; row++ )
+  {
+    // PivotPoint_Reference computed from the pose: MarkerToReference * PivotPoint_Marker
+    double pivotPointFromPose_Reference = data(row,0)*parameters[0] + data(row,1)*parameters[1] + data(row,2)*parameters[2] + data(row,3);
+    double diff = pivotPointFromPose_Reference - parameters[3+row];
+    distanceSquared += diff*diff;
+  }
+  return ( distanceSquared < this->deltaSquared );
+}
+
+//----------------------------------------------------------------------------
+/*
+Each pose adds the following equations (see vtkPivotCalibrationAlgo::GetPivotPointPosition):
+ Ai = [ R | -Identity3x3 ], bi = [ -t ]
+where R is the rotation and t is the translation part of the MarkerToReference transform. The contribution to the normal equations:
+ Ai'Ai = [ R'R  -R' ]    Ai'bi = [ -R't ]    bi'bi = t't
+         [ -R     I ]            [    t ]
+*/
+void PivotParametersEstimator::AddPoseToNormalEquations( const double pose[4][4], NormalMatrixType &normalMatrix, NormalVectorType &normalVector, double &sumOfSquaredTranslations )
+{
+  for( int i=0; i<3; i++ )
+  {
+    for( int j=0; j<3; j++ )
+    {
+      // R'R
+      normalMatrix(i,j) += pose[0][i]*pose[0][j] + pose[1][i]*pose[1][j] + pose[2][i]*pose[2][j];
+      // -R' and -R
+      normalMatrix(i,3+j) -= pose[j][i];
+      normalMatrix(3+i,j) -= pose[i][j];
+    }
+    normalMatrix(3+i,3+i) += 1.0;
+
+    normalVector(i) -= pose[0][i]*pose[0][3] + pose[1][i]*pose[1][3] + pose[2][i]*pose[2][3];
+    normalVector(3+i) += pose[i][3];
+
+    sumOfSquaredTranslations += pose[i][3]*pose[i][3];
+  }
+}
+
+//----------------------------------------------------------------------------
+bool PivotParametersEstimator::SolveNormalEquations( const NormalMatrixType &normalMatrix, const NormalVectorType &normalVector, NormalVectorType &solution )
+{
+  vnl_matrix<double> a( normalMatrix.data_block(), 6, 6 );
+  vnl_svd<double> svd( a );
+  if( svd.sigma_max() <= 0 || svd.sigma_min() < MINIMUM_NORMAL_MATRIX_CONDITION_RECIPROCAL * svd.sigma_max() )
+  {
+    return false;
+  }
+  vnl_vector<double> b( normalVector.data_block(), 6 );
+  vnl_vector<double> x = svd.solve( b );
+  for( int i=0; i<6; i++ )
+  {
+    solution[i] = x[i];
+  }
+  return true;
+}
+
+} // end namespace itk
@@ -0,0 +1,98 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef _PIVOT_PARAM_ESTIMATOR_H_
+#define _PIVOT_PARAM_ESTIMATOR_H_
+
+#include "ParametersEstimator.h"
+#include <itkObjectFactory.h>
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/vnl_vector_fixed.h>
+
+namespace itk {
+
+/*!
+  \class PivotParametersEstimator
+  \brief Estimates the pivot point from marker poses, for robust pivot calibration with the RANSAC class
+
+  Each data object is a MarkerToReference transform (4x4 homogeneous matrix). The parameters
+  are [PivotPoint_Marker_x, PivotPoint_Marker_y, PivotPoint_Marker_z, PivotPoint_Reference_x, PivotPoint_Reference_y, PivotPoint_Reference_z].
+  The parameters are computed by solving the normal equations of the pivot calibration linear least squares problem
+  (see vtkPivotCalibrationAlgo). The same normal equations can be accumulated incrementally by the AddPoseToNormalEquations
+  and solved by SolveNormalEquations methods.
+
+  \ingroup PlusLibCalibrationAlgorithm
+*/
+class PivotParametersEstimator : public ParametersEstimator< vnl_matrix_fixed<double,4,4>, double >
+{
+public:
+  typedef vnl_matrix_fixed<double,4,4>              PoseType;
+  typedef vnl_matrix_fixed<double,6,6>              NormalMatrixType;
+  typedef vnl_vector_fixed<double,6>                NormalVectorType;
+
+  typedef PivotParametersEstimator                  Self;
+  typedef ParametersEstimator< PoseType, double >   Superclass;
+  typedef SmartPointer<Self>                        Pointer;
+  typedef SmartPointer<const Self>                  ConstPointer;
+
+  itkTypeMacro( PivotParametersEstimator, ParametersEstimator );
+  /** New method for creating an object using a factory. */
+  itkNewMacro( Self )
+
+  /*!
+    Compute the pivot point from the minimal number of poses.
+    If the poses are in a degenerate configuration (e.g., all have the same orientation) then the parameters vector is empty.
+  */
+  virtual void Estimate( std::vector< PoseType *> &data, std::vector<double> &parameters );
+  virtual void Estimate( std::vector< PoseType > &data, std::vector<double> &parameters );
+
+  /*!
+    Compute the least squares estimate of the pivot point from all the poses.
+    If the poses are in a degenerate configuration (e.g., all have the same orientation) then the parameters vector is empty.
+  */
+  virtual void LeastSquaresEstimate( std::vector< PoseType *> &data, std::vector<double> &parameters );
+  virtual void LeastSquaresEstimate( std::vector< PoseType > &data, std::vector<double> &parameters );
+
+  /*!
+    Return true if the distance between the pivot point position in the Reference coordinate system and the
+    pivot point (defined in the Marker coordinate system) transformed by the pose is smaller than 'delta'
+  */
+  virtual bool Agree( std::vector<double> &parameters, PoseType &data );
+
+  /*! Set the maximum distance (in mm) between the pivot point positions for a pose to be considered as an inlier */
+  void SetDelta( double delta );
+  double GetDelta();
+
+  /*!
+    Add the equations of one MarkerToReference pose to the normal equations.
+    \param pose MarkerToReference transform matrix
+    \param normalMatrix A'A matrix of the least squares problem, the contribution of the pose is added to it
+    \param normalVector A'b vector of the least squares problem, the contribution of the pose is added to it
+    \param sumOfSquaredTranslations b'b value of the least squares problem (sum of squared translation lengths), the contribution of the pose is added to it
+  */
+  static void AddPoseToNormalEquations( const double pose[4][4], NormalMatrixType &normalMatrix, NormalVectorType &normalVector, double &sumOfSquaredTranslations );
+
+  /*!
+    Solve the normal equations. Returns false if the system is ill-conditioned (the poses do not contain enough rotation).
+    \param solution Pivot point position in the Marker (first 3 elements) and Reference (last 3 elements) coordinate systems
+  */
+  static bool SolveNormalEquations( const NormalMatrixType &normalMatrix, const NormalVectorType &normalVector, NormalVectorType &solution );
+
+protected:
+  PivotParametersEstimator();
+  ~PivotParametersEstimator();
+
+private:
+  PivotParametersEstimator(const Self& ); //purposely not implemented
+  void operator=(const Self& ); //purposely not implemented
+
+  /*! Squared distance threshold for considering a pose as an inlier */
+  double deltaSquared;
+};
+
+} // end namespace itk
+
+#endif //_PIVOT_PARAM_ESTIMATOR_H_
@@ -7,6 +7,7 @@
 #include "vtkPivotCalibrationAlgo.h"
 #include "vtkTransformRepository.h"
 #include "PlusMath.h"
+#include "RANSAC.h"
 
 #include "vtkObjectFactory.h"
 #include "vtkTransform.h"
@@ -17,6 +18,10 @@
 vtkCxxRevisionMacro(vtkPivotCalibrationAlgo, "$Revision: 1.0 $");
 vtkStandardNewMacro(vtkPivotCalibrationAlgo);
 
+static const double DEFAULT_RANSAC_MAXIMUM_DISTANCE_MM = 1.0;
+static const int DEFAULT_CONVERGENCE_WINDOW_SIZE = 100;
+static const double RANSAC_DESIRED_PROBABILITY_FOR_NO_OUTLIERS = 0.999;
+
 //-----------------------------------------------------------------------------
 vtkPivotCalibrationAlgo::vtkPivotCalibrationAlgo()
 {
@@ -30,6 +35,13 @@ vtkPivotCalibrationAlgo::vtkPivotCalibrationAlgo()
   this->PivotPointPosition_Reference[1] = 0.0;
   this->PivotPointPosition_Reference[2] = 0.0;
   this->PivotPointPosition_Reference[3] = 1.0;
+
+  this->UseRansac = false;
+  this->RansacMaximumDistanceMm = DEFAULT_RANSAC_MAXIMUM_DISTANCE_MM;
+  this->ConvergenceThresholdMm = 0.0;
+  this->ConvergenceWindowSize = DEFAULT_CONVERGENCE_WINDOW_SIZE;
+
+  this->RemoveAllCalibrationPoints();
 }
 
 //-----------------------------------------------------------------------------
@@ -49,6 +61,22 @@ void vtkPivotCalibrationAlgo::RemoveAllCalibrationPoints()
   }
   this->MarkerToReferenceTransformMatrixArray.clear();
   this->OutlierIndices.clear();
+
+  this->NormalMatrix.fill(0.0);
+  this->NormalVector.fill(0.0);
+  this->SumOfSquaredTranslations = 0.0;
+
+  this->LiveEstimateValid = false;
+  this->LiveCalibrationError = -1.0;
+  for (int i=0; i<3; i++)
+  {
+    this->LivePivotPointPosition_Marker[i] = 0.0;
+    this->LivePivotPointPosition_Reference[i] = 0.0;
+    this->ConvergenceCheckPivotPointPosition_Marker[i] = 0.0;
+  }
+  this->NumberOfPointsSinceConvergenceCheck = 0;
+  this->ConvergenceCheckPivotPointPositionValid = false;
+  this->Converged = false;
 }
 
 //----------------------------------------------------------------------------
@@ -57,9 +85,64 @@ PlusStatus vtkPivotCalibrationAlgo::InsertNextCalibrationPoint(vtkMatrix4x4* aMa
   vtkMatrix4x4* markerToReferenceTransformMatrixCopy = vtkMatrix4x4::New();
   markerToReferenceTransformMatrixCopy->DeepCopy(aMarkerToReferenceTransformMatrix);
   this->MarkerToReferenceTransformMatrixArray.push_back(markerToReferenceTransformMatrixCopy);  
+
+  // Update the normal equations, this is cheap (independent from the number of already inserted points)
+  itk::PivotParametersEstimator::AddPoseToNormalEquations(aMarkerToReferenceTransformMatrix->Element, this->NormalMatrix, this->NormalVector, this->SumOfSquaredTranslations);
+  UpdateLiveEstimate();
+
   return PLUS_SUCCESS; 
 }
 
+//----------------------------------------------------------------------------
+void vtkPivotCalibrationAlgo::UpdateLiveEstimate()
+{
+  itk::PivotParametersEstimator::NormalVectorType solution;
+  if (!itk::PivotParametersEstimator::SolveNormalEquations(this->NormalMatrix, this->NormalVector, solution))
+  {
+    // not enough points or not enough rotation yet
+    this->LiveEstimateValid = false;
+    return;
+  }
+  this->LiveEstimateValid = true;
+  for (int i=0; i<3; i++)
+  {
+    this->LivePivotPointPosition_Marker[i] = solution[i];
+    this->LivePivotPointPosition_Reference[i] = solution[3+i];
+  }
+
+  // Sum of squared residuals: |Ax-b|^2 = x'A'Ax - 2x'A'b + b'b
+  double sumOfSquaredResiduals = dot_product(solution, this->NormalMatrix*solution) - 2*dot_product(solution, this->NormalVector) + this->SumOfSquaredTranslations;
+  if (sumOfSquaredResiduals < 0)
+  {
+    // may happen due to numerical errors when the residuals are very small
+    sumOfSquaredResiduals = 0;
+  }
+  this->LiveCalibrationError = sqrt(sumOfSquaredResiduals / this->MarkerToReferenceTransformMatrixArray.size());
+
+  // Check convergence
+  if (this->ConvergenceThresholdMm <= 0)
+  {
+    return;
+  }
+  this->NumberOfPointsSinceConvergenceCheck++;
+  if (this->NumberOfPointsSinceConvergenceCheck < this->ConvergenceWindowSize)
+  {
+    return;
+  }
+  if (this->ConvergenceCheckPivotPointPositionValid)
+  {
+    double positionChangeMm = sqrt(vtkMath::Distance2BetweenPoints(this->ConvergenceCheckPivotPointPosition_Marker, this->LivePivotPointPosition_Marker));
+    this->Converged = (positionChangeMm < this->ConvergenceThresholdMm);
+    LOG_DEBUG("Pivot point position changed by "<<positionChangeMm<<" mm during the last "<<this->NumberOfPointsSinceConvergenceCheck<<" points"<<(this->Converged?", calibration converged":""));
+  }
+  for (int i=0; i<3; i++)
+  {
+    this->ConvergenceCheckPivotPointPosition_Marker[i] = this->LivePivotPointPosition_Marker[i];
+  }
+  this->ConvergenceCheckPivotPointPositionValid = true;
+  this->NumberOfPointsSinceConvergenceCheck = 0;
+}
+
 //----------------------------------------------------------------------------
 /*
 In homogeneous coordinates:
@@ -154,6 +237,62 @@ PlusStatus vtkPivotCalibrationAlgo::GetPivotPointPosition(double* pivotPoint_Mar
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPivotCalibrationAlgo::GetPivotPointPositionRansac(double* pivotPoint_Marker, double* pivotPoint_Reference)
+{
+  std::vector<itk::PivotParametersEstimator::PoseType> markerToReferenceTransforms;
+  markerToReferenceTransforms.reserve(this->MarkerToReferenceTransformMatrixArray.size());
+  for (std::list< vtkMatrix4x4* >::iterator markerToReferenceTransformIt=this->MarkerToReferenceTransformMatrixArray.begin();
+    markerToReferenceTransformIt!=this->MarkerToReferenceTransformMatrixArray.end(); ++markerToReferenceTransformIt)
+  {
+    itk::PivotParametersEstimator::PoseType markerToReferenceTransform;
+    markerToReferenceTransform.copy_in(&((*markerToReferenceTransformIt)->Element[0][0]));
+    markerToReferenceTransforms.push_back(markerToReferenceTransform);
+  }
+
+  typedef itk::RANSAC<itk::PivotParametersEstimator::PoseType, double> RANSACType;
+  itk::PivotParametersEstimator::Pointer pivotEstimator = itk::PivotParametersEstimator::New();
+  pivotEstimator->SetDelta(this->RansacMaximumDistanceMm);
+  RANSACType::Pointer ransacEstimator = RANSACType::New();
+
+  std::vector<double> ransacParameterResult;
+  try
+  {
+    ransacEstimator->SetData(markerToReferenceTransforms);
+    ransacEstimator->SetParametersEstimator(pivotEstimator.GetPointer());
+    double inlierRatio = ransacEstimator->Compute(ransacParameterResult, RANSAC_DESIRED_PROBABILITY_FOR_NO_OUTLIERS);
+    LOG_DEBUG("RANSAC pivot calibration inlier ratio: "<<inlierRatio);
+  }
+  catch( std::exception& e)
+  {
+    LOG_ERROR("vtkPivotCalibrationAlgo failed: RANSAC error: "<<e.what()); 
+    return PLUS_FAIL;
+  }
+
+  if (ransacParameterResult.empty())
+  {
+    LOG_ERROR("vtkPivotCalibrationAlgo failed: RANSAC could not compute pivot point (not enough points or not enough rotation)"); 
+    return PLUS_FAIL;
+  }
+
+  this->OutlierIndices.clear();
+  for (unsigned int sampleIndex=0; sampleIndex<markerToReferenceTransforms.size(); sampleIndex++)
+  {
+    if (!pivotEstimator->Agree(ransacParameterResult, markerToReferenceTransforms[sampleIndex]))
+    {
+      this->OutlierIndices.insert(sampleIndex);
+    }
+  }
+
+  for (int i=0; i<3; i++)
+  {
+    pivotPoint_Marker[i]=ransacParameterResult[i];
+    pivotPoint_Reference[i]=ransacParameterResult[3+i];
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPivotCalibrationAlgo::DoPivotCalibration(vtkTransformRepository* aTransformRepository/* = NULL*/)
 {
@@ -165,10 +304,20 @@ PlusStatus vtkPivotCalibrationAlgo::DoPivotCalibration(vtkTransformRepository* a
 
   double pivotPoint_Marker[4]={0,0,0,1};
   double pivotPoint_Reference[4]={0,0,0,1};
-  if (GetPivotPointPosition(pivotPoint_Marker, pivotPoint_Reference)!=PLUS_SUCCESS)
+  if (this->UseRansac)
   {
-    return PLUS_FAIL;
-  }    
+    if (GetPivotPointPositionRansac(pivotPoint_Marker, pivotPoint_Reference)!=PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+  else
+  {
+    if (GetPivotPointPosition(pivotPoint_Marker, pivotPoint_Reference)!=PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
 
   // Get the result (tooltip to tool transform)
   double x = pivotPoint_Marker[0];
@@ -319,6 +468,38 @@ PlusStatus vtkPivotCalibrationAlgo::ReadConfiguration(vtkXMLDataElement* aConfig
   }
   this->SetObjectPivotPointCoordinateFrame(objectPivotPointCoordinateFrame);
 
+  // Optional parameters
+  const char* useRansac = pivotCalibrationElement->GetAttribute("UseRansac");
+  if (useRansac != NULL)
+  {
+    this->UseRansac = (STRCASECMP(useRansac, "TRUE") == 0);
+  }
+
+  double ransacMaximumDistanceMm = 0;
+  if (pivotCalibrationElement->GetScalarAttribute("RansacMaximumDistanceMm", ransacMaximumDistanceMm))
+  {
+    this->RansacMaximumDistanceMm = ransacMaximumDistanceMm;
+  }
+
+  double convergenceThresholdMm = 0;
+  if (pivotCalibrationElement->GetScalarAttribute("ConvergenceThresholdMm", convergenceThresholdMm))
+  {
+    this->ConvergenceThresholdMm = convergenceThresholdMm;
+  }
+
+  int convergenceWindowSize = 0;
+  if (pivotCalibrationElement->GetScalarAttribute("ConvergenceWindowSize", convergenceWindowSize))
+  {
+    if (convergenceWindowSize > 0)
+    {
+      this->ConvergenceWindowSize = convergenceWindowSize;
+    }
+    else
+    {
+      LOG_WARNING("Invalid ConvergenceWindowSize ("<<convergenceWindowSize<<") in vtkPivotCalibrationAlgo element, it must be positive. Using default value: "<<this->ConvergenceWindowSize);
+    }
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -363,3 +544,15 @@ int vtkPivotCalibrationAlgo::GetNumberOfDetectedOutliers()
 {
   return this->OutlierIndices.size();
 }
+
+//-----------------------------------------------------------------------------
+int vtkPivotCalibrationAlgo::GetNumberOfCalibrationPoints()
+{
+  return this->MarkerToReferenceTransformMatrixArray.size();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPivotCalibrationAlgo::IsConverged()
+{
+  return (this->ConvergenceThresholdMm > 0) && this->Converged;
+}
@@ -12,6 +12,8 @@ See License.txt for details.
 #include "vtkObject.h"
 #include "vtkMatrix4x4.h"
 
+#include "PivotParametersEstimator.h"
+
 #include <list>
 #include <set>
 
@@ -33,7 +35,14 @@ class vtkXMLDataElement;
   of the PivotPoint coordinate system is chosen to be the cross product of the X and Y axes.
   
   The method detects outlier points (points that have larger than 3x error than the standard deviation) and ignores them when computing the pivot point
-  coordinates and the calibration error.
+  coordinates and the calibration error. Optionally, RANSAC can be used for outlier rejection (UseRansac), which is more robust if there are
+  many outliers.
+
+  The normal equations of the least squares problem are also accumulated incrementally as the points are inserted, which allows computing
+  a live estimate of the pivot point position and error at negligible cost after each inserted point (the live estimate does not reject
+  outliers). The live estimate is used for detecting if the calibration converged: if ConvergenceThresholdMm is set, the calibration is
+  considered converged when the live pivot point position changes less than ConvergenceThresholdMm during the last ConvergenceWindowSize
+  inserted points. This allows the user interface to stop the acquisition automatically.
   
   \ingroup PlusLibCalibrationAlgorithm
 */
@@ -81,6 +90,15 @@ public:
   */
   int GetNumberOfDetectedOutliers();
 
+  /*! Get the number of inserted calibration points */
+  int GetNumberOfCalibrationPoints();
+
+  /*!
+    Returns true if the live estimate of the pivot point position has not changed significantly recently.
+    Always false if ConvergenceThresholdMm is not positive.
+  */
+  bool IsConverged();
+
 public:
 
   vtkGetMacro(CalibrationError, double);
@@ -93,6 +111,35 @@ public:
   vtkGetStringMacro(ReferenceCoordinateFrame);
   vtkGetStringMacro(ObjectPivotPointCoordinateFrame);
 
+  /*! True if the live (incrementally computed) estimate is available, i.e., enough points with sufficient rotation have been inserted */
+  vtkGetMacro(LiveEstimateValid, bool);
+
+  /*! Live estimate of the pivot point position in the Marker coordinate system, updated after each inserted point */
+  vtkGetVector3Macro(LivePivotPointPosition_Marker, double);
+
+  /*! Live estimate of the pivot point position in the Reference coordinate system, updated after each inserted point */
+  vtkGetVector3Macro(LivePivotPointPosition_Reference, double);
+
+  /*! Live estimate of the RMS calibration error (in mm), updated after each inserted point */
+  vtkGetMacro(LiveCalibrationError, double);
+
+  /*! If enabled, outliers are rejected by RANSAC in DoPivotCalibration (instead of the robust LSQR method) */
+  vtkSetMacro(UseRansac, bool);
+  vtkGetMacro(UseRansac, bool);
+  vtkBooleanMacro(UseRansac, bool);
+
+  /*! Points where the pivot point position error is larger than this value (in mm) are considered as outliers by RANSAC */
+  vtkSetMacro(RansacMaximumDistanceMm, double);
+  vtkGetMacro(RansacMaximumDistanceMm, double);
+
+  /*! Maximum change of the live pivot point position (in mm) during the convergence window for considering the calibration converged. If not positive then convergence is not checked. */
+  vtkSetMacro(ConvergenceThresholdMm, double);
+  vtkGetMacro(ConvergenceThresholdMm, double);
+
+  /*! Number of inserted points between two convergence checks */
+  vtkSetMacro(ConvergenceWindowSize, int);
+  vtkGetMacro(ConvergenceWindowSize, int);
+
 protected:
 
   vtkSetObjectMacro(PivotPointToMarkerTransformMatrix, vtkMatrix4x4);
@@ -111,6 +158,12 @@ protected:
 
   PlusStatus GetPivotPointPosition(double* pivotPoint_Marker, double* pivotPoint_Reference);
 
+  /*! Compute the pivot point position using RANSAC for outlier rejection */
+  PlusStatus GetPivotPointPositionRansac(double* pivotPoint_Marker, double* pivotPoint_Reference);
+
+  /*! Update the live estimate from the accumulated normal equations and check convergence */
+  void UpdateLiveEstimate();
+
 protected:
   /*! Pivot point to marker transform (eg. stylus tip to stylus) - the result of the calibration */
   vtkMatrix4x4*        PivotPointToMarkerTransformMatrix;
@@ -135,6 +188,28 @@ protected:
 
   /*! List of outlier sample indices */
   std::set<unsigned int> OutlierIndices;
+
+  /*! Normal equations of the least squares problem, accumulated incrementally from the inserted points */
+  itk::PivotParametersEstimator::NormalMatrixType NormalMatrix;
+  itk::PivotParametersEstimator::NormalVectorType NormalVector;
+  double SumOfSquaredTranslations;
+
+  bool LiveEstimateValid;
+  double LivePivotPointPosition_Marker[3];
+  double LivePivotPointPosition_Reference[3];
+  double LiveCalibrationError;
+
+  bool UseRansac;
+  double RansacMaximumDistanceMm;
+
+  double ConvergenceThresholdMm;
+  int ConvergenceWindowSize;
+  /*! Number of points inserted since the last convergence check */
+  int NumberOfPointsSinceConvergenceCheck;
+  /*! Live pivot point position at the last convergence check */
+  double ConvergenceCheckPivotPointPosition_Marker[3];
+  bool ConvergenceCheckPivotPointPositionValid;
+  bool Converged;
 };
 
 #endif
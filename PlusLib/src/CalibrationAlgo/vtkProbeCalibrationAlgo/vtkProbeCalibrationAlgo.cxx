@@ -49,7 +49,6 @@ vtkProbeCalibrationAlgo::vtkProbeCalibrationAlgo()
 , ErrorConfidenceLevel(DEFAULT_ERROR_CONFIDENCE_INTERVAL)
 {
   this->Optimizer = vtkProbeCalibrationOptimizerAlgo::New();
-  this->Optimizer->SetProbeCalibrationAlgo(this);
 }
 
 //----------------------------------------------------------------------------
@@ -335,6 +334,16 @@ PlusStatus vtkProbeCalibrationAlgo::Calibrate( vtkTrackedFrameList* validationTr
   {
     LOG_INFO("Additional calibration optimization is requested");
     UpdateNonOutlierData(outliers);
+    this->Optimizer->ClearInputData();
+    for (std::vector<NWirePositionType>::iterator framePositionIt=this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].FramePositions.begin();
+      framePositionIt!=this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].FramePositions.end(); ++framePositionIt)
+    {
+      if (this->Optimizer->AddInputFrame(framePositionIt->AllWiresIntersectionPointsPos_Image, framePositionIt->MiddleWireIntersectionPointsPos_Probe, framePositionIt->ProbeToPhantomTransform, this->NWires)!=PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to set optimizer input data");
+        return PLUS_FAIL;
+      }
+    }
     this->Optimizer->SetImageToProbeSeedTransform(imageToProbeTransformMatrix);
     this->Optimizer->Update();
     imageToProbeTransformMatrix = this->Optimizer->GetOptimizedImageToProbeTransformMatrix();
@@ -1118,11 +1127,13 @@ void vtkProbeCalibrationAlgo::ComputeError2d(PreProcessedWirePositionIdType data
     reprojectionError2Ds->resize(this->NWires.size()*3);
   }
 
+  vnl_matrix_fixed<double,4,4> probeToImageTransform_vnl = vnl_inverse(imageToProbeMatrix);
+  vtkSmartPointer<vtkMatrix4x4> phantomToImageTransform=vtkSmartPointer<vtkMatrix4x4>::New();
+
   for(int frameIndex=0;frameIndex<numberOfFrames;frameIndex++) // for each frame
   {
-    vnl_matrix_fixed<double,4,4> probeToPhantomTransform_vnl = this->PreProcessedWirePositions[datasetType].FramePositions[frameIndex].ProbeToPhantomTransform;
-    vnl_matrix_fixed<double,4,4> phantomToImageTransform_vnl = vnl_inverse(imageToProbeMatrix)*vnl_inverse(probeToPhantomTransform_vnl);
-    vtkSmartPointer<vtkMatrix4x4> phantomToImageTransform=vtkSmartPointer<vtkMatrix4x4>::New();
+    const vnl_matrix_fixed<double,4,4> &probeToPhantomTransform_vnl = this->PreProcessedWirePositions[datasetType].FramePositions[frameIndex].ProbeToPhantomTransform;
+    vnl_matrix_fixed<double,4,4> phantomToImageTransform_vnl = probeToImageTransform_vnl*vnl_inverse(probeToPhantomTransform_vnl);
     PlusMath::ConvertVnlMatrixToVtkMatrix(phantomToImageTransform_vnl, phantomToImageTransform);
 
     double normalVector[3] = { 0.0, 0.0, 1.0 };
@@ -1133,7 +1144,7 @@ void vtkProbeCalibrationAlgo::ComputeError2d(PreProcessedWirePositionIdType data
       for (int wireIndex=0;wireIndex<3;wireIndex++)  // for each segmented point
       {
         // Compute the wire intersection point position in the image
-        Wire wire = this->NWires[nWireIndex].Wires[wireIndex];
+        const Wire &wire = this->NWires[nWireIndex].Wires[wireIndex];
         double wireEndPointFrontInPhantomFrame[4] = { wire.EndPointFront[0], wire.EndPointFront[1], wire.EndPointFront[2], 1.0 };
         double wireEndPointBackInPhantomFrame[4] = { wire.EndPointBack[0], wire.EndPointBack[1], wire.EndPointBack[2], 1.0 };
         double wireEndPointFrontInImageFrame[4]={0};
@@ -1158,7 +1169,7 @@ void vtkProbeCalibrationAlgo::ComputeError2d(PreProcessedWirePositionIdType data
         }
 
         // Get the segmented intersection position in the image
-        vnl_vector_fixed<double,4> segmentedPoint_Image=this->PreProcessedWirePositions[datasetType].FramePositions[frameIndex].AllWiresIntersectionPointsPos_Image[3*nWireIndex+wireIndex];
+        const vnl_vector_fixed<double,4> &segmentedPoint_Image=this->PreProcessedWirePositions[datasetType].FramePositions[frameIndex].AllWiresIntersectionPointsPos_Image[3*nWireIndex+wireIndex];
 
         vnl_vector_fixed<double,2> reprojectionError2D;
         reprojectionError2D[0] = segmentedPoint_Image[0] - computedPositionInImagePlane[0];
@@ -5,7 +5,6 @@ See License.txt for details.
 =========================================================Plus=header=end*/ 
 
 #include "vtkProbeCalibrationOptimizerAlgo.h"
-#include "vtkProbeCalibrationAlgo.h"
 #include "vtkTransformRepository.h"
 
 #include "vtkObjectFactory.h"
@@ -18,6 +17,14 @@ See License.txt for details.
 
 typedef  itk::PowellOptimizer  OptimizerType;
 
+// The cost function is evaluated many times during the optimization and the computation for one point is very
+// fast, therefore threads are only worth to be used if there are many points (otherwise the overhead of starting the
+// threads is larger than the gain)
+static const int MINIMUM_NUMBER_OF_POINTS_PER_THREAD = 5000;
+
+// If the wire and the image plane are closer to parallel than this then the intersection is not computed (same tolerance as in vtkPlane)
+static const double PARALLEL_WIRE_TOLERANCE = 1e-6;
+
 //-----------------------------------------------------------------------------
 class DistanceToWiresCostFunction : public itk::SingleValuedCostFunction 
 {
@@ -160,8 +167,16 @@ vtkStandardNewMacro(vtkProbeCalibrationOptimizerAlgo);
 //-----------------------------------------------------------------------------
 vtkProbeCalibrationOptimizerAlgo::vtkProbeCalibrationOptimizerAlgo()
 : IsotropicPixelSpacing(true)
-, ProbeCalibrationAlgo(NULL)
+, NumberOfThreads(0)
 {  
+  this->Threader = vtkSmartPointer<vtkMultiThreader>::New();
+  for (int row=0; row<3; row++)
+  {
+    for (int col=0; col<4; col++)
+    {
+      this->CurrentErrorTransform[row][col] = (row==col ? 1.0 : 0.0);
+    }
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -170,25 +185,265 @@ vtkProbeCalibrationOptimizerAlgo::~vtkProbeCalibrationOptimizerAlgo()
 }
 
 //-----------------------------------------------------------------------------
-void vtkProbeCalibrationOptimizerAlgo::SetProbeCalibrationAlgo(vtkProbeCalibrationAlgo* probeCalibrationAlgo)
+void vtkProbeCalibrationOptimizerAlgo::ClearInputData()
 {
-  this->ProbeCalibrationAlgo=probeCalibrationAlgo;
+  this->WireFrontPointX_Probe.clear();
+  this->WireFrontPointY_Probe.clear();
+  this->WireFrontPointZ_Probe.clear();
+  this->WireBackPointX_Probe.clear();
+  this->WireBackPointY_Probe.clear();
+  this->WireBackPointZ_Probe.clear();
+  this->SegmentedPointX_Image.clear();
+  this->SegmentedPointY_Image.clear();
+
+  this->MiddleWireSegmentedPointX_Image.clear();
+  this->MiddleWireSegmentedPointY_Image.clear();
+  this->MiddleWireSegmentedPointZ_Image.clear();
+  this->MiddleWirePointX_Probe.clear();
+  this->MiddleWirePointY_Probe.clear();
+  this->MiddleWirePointZ_Probe.clear();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkProbeCalibrationOptimizerAlgo::AddInputFrame(const std::vector< vnl_vector_fixed<double,4> > &allWiresIntersectionPointsPos_Image, const std::vector< vnl_vector_fixed<double,4> > &middleWireIntersectionPointsPos_Probe, const vnl_matrix_fixed<double,4,4> &probeToPhantomTransform, const std::vector<NWire> &nWires)
+{
+  int numberOfNWires = nWires.size();
+  if (allWiresIntersectionPointsPos_Image.size() != numberOfNWires*3 || middleWireIntersectionPointsPos_Probe.size() != numberOfNWires)
+  {
+    LOG_ERROR("vtkProbeCalibrationOptimizerAlgo::AddInputFrame failed: number of intersection points does not match the number of NWires");
+    return PLUS_FAIL;
+  }
+
+  // The phantom to probe transform does not depend on the optimization parameters, so the wire endpoints
+  // can be transformed to the probe coordinate system right now
+  vnl_matrix_fixed<double,4,4> phantomToProbeTransform = vnl_inverse(probeToPhantomTransform);
+
+  for (int nWireIndex=0; nWireIndex<numberOfNWires; nWireIndex++)
+  {
+    for (int wireIndex=0; wireIndex<3; wireIndex++)
+    {
+      const Wire &wire = nWires[nWireIndex].Wires[wireIndex];
+      vnl_vector_fixed<double,4> wireFrontPoint_Phantom(wire.EndPointFront[0], wire.EndPointFront[1], wire.EndPointFront[2], 1.0);
+      vnl_vector_fixed<double,4> wireBackPoint_Phantom(wire.EndPointBack[0], wire.EndPointBack[1], wire.EndPointBack[2], 1.0);
+      vnl_vector_fixed<double,4> wireFrontPoint_Probe = phantomToProbeTransform * wireFrontPoint_Phantom;
+      vnl_vector_fixed<double,4> wireBackPoint_Probe = phantomToProbeTransform * wireBackPoint_Phantom;
+
+      this->WireFrontPointX_Probe.push_back(wireFrontPoint_Probe[0]);
+      this->WireFrontPointY_Probe.push_back(wireFrontPoint_Probe[1]);
+      this->WireFrontPointZ_Probe.push_back(wireFrontPoint_Probe[2]);
+      this->WireBackPointX_Probe.push_back(wireBackPoint_Probe[0]);
+      this->WireBackPointY_Probe.push_back(wireBackPoint_Probe[1]);
+      this->WireBackPointZ_Probe.push_back(wireBackPoint_Probe[2]);
+
+      const vnl_vector_fixed<double,4> &segmentedPoint_Image = allWiresIntersectionPointsPos_Image[nWireIndex*3+wireIndex];
+      this->SegmentedPointX_Image.push_back(segmentedPoint_Image[0]);
+      this->SegmentedPointY_Image.push_back(segmentedPoint_Image[1]);
+    }
+
+    const vnl_vector_fixed<double,4> &middleWireSegmentedPoint_Image = allWiresIntersectionPointsPos_Image[nWireIndex*3+1];
+    this->MiddleWireSegmentedPointX_Image.push_back(middleWireSegmentedPoint_Image[0]);
+    this->MiddleWireSegmentedPointY_Image.push_back(middleWireSegmentedPoint_Image[1]);
+    this->MiddleWireSegmentedPointZ_Image.push_back(middleWireSegmentedPoint_Image[2]);
+    this->MiddleWirePointX_Probe.push_back(middleWireIntersectionPointsPos_Probe[nWireIndex][0]);
+    this->MiddleWirePointY_Probe.push_back(middleWireIntersectionPointsPos_Probe[nWireIndex][1]);
+    this->MiddleWirePointZ_Probe.push_back(middleWireIntersectionPointsPos_Probe[nWireIndex][2]);
+  }
+
+  return PLUS_SUCCESS;
 }
 
 //--------------------------------------------------------------------------------
 void vtkProbeCalibrationOptimizerAlgo::ComputeError(const vnl_matrix_fixed<double,4,4> &imageToProbeTransformationMatrix, double &errorMean, double &errorStDev, double &errorRms)
 {
+  errorMean=0.0;
+  errorStDev=0.0;
+  errorRms=0.0;
+
+  int numberOfPoints=0;
+  vnl_matrix_fixed<double,4,4> errorTransform;
   switch (this->OptimizationMethod)
   {
   case MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D:
-    this->ProbeCalibrationAlgo->ComputeError3d(imageToProbeTransformationMatrix, errorMean, errorStDev, errorRms);
+    numberOfPoints=this->MiddleWirePointX_Probe.size();
+    errorTransform=imageToProbeTransformationMatrix;
     break;
   case MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D:
-    this->ProbeCalibrationAlgo->ComputeError2d(imageToProbeTransformationMatrix, errorMean, errorStDev, errorRms);
+    numberOfPoints=this->WireFrontPointX_Probe.size();
+    errorTransform=vnl_inverse(imageToProbeTransformationMatrix);
     break;
   default:
     LOG_ERROR("Invalid cost function");
+    return;
+  }
+  if (numberOfPoints==0)
+  {
+    LOG_ERROR("vtkProbeCalibrationOptimizerAlgo::ComputeError failed: no input data");
+    return;
+  }
+
+  for (int row=0; row<3; row++)
+  {
+    for (int col=0; col<4; col++)
+    {
+      this->CurrentErrorTransform[row][col]=errorTransform(row,col);
+    }
+  }
+
+  int numberOfThreads=(this->NumberOfThreads>0 ? this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads());
+  int maximumUsefulNumberOfThreads=numberOfPoints/MINIMUM_NUMBER_OF_POINTS_PER_THREAD;
+  if (numberOfThreads>maximumUsefulNumberOfThreads)
+  {
+    numberOfThreads=maximumUsefulNumberOfThreads;
+  }
+  if (numberOfThreads<1)
+  {
+    numberOfThreads=1;
+  }
+
+  this->ThreadErrorSums.resize(numberOfThreads);
+  if (numberOfThreads==1)
+  {
+    if (this->OptimizationMethod==MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D)
+    {
+      ComputeError2dInRange(0, numberOfPoints-1, this->ThreadErrorSums[0]);
+    }
+    else
+    {
+      ComputeError3dInRange(0, numberOfPoints-1, this->ThreadErrorSums[0]);
+    }
+  }
+  else
+  {
+    this->Threader->SetNumberOfThreads(numberOfThreads);
+    this->Threader->SetSingleMethod(ComputeErrorThreadFunction, this);
+    this->Threader->SingleMethodExecute();
+  }
+
+  // Combine the results in a fixed order to make the result independent from the thread scheduling
+  double sum=0;
+  double sumOfSquares=0;
+  int numberOfValidPoints=0;
+  for (int threadIndex=0; threadIndex<numberOfThreads; threadIndex++)
+  {
+    sum+=this->ThreadErrorSums[threadIndex].Sum;
+    sumOfSquares+=this->ThreadErrorSums[threadIndex].SumOfSquares;
+    numberOfValidPoints+=this->ThreadErrorSums[threadIndex].NumberOfPoints;
+  }
+  if (numberOfValidPoints==0)
+  {
+    LOG_ERROR("vtkProbeCalibrationOptimizerAlgo::ComputeError failed: the error could not be computed for any of the points");
+    return;
+  }
+
+  errorMean=sum/numberOfValidPoints;
+  double meanSquares=sumOfSquares/numberOfValidPoints;
+  double variance=meanSquares-errorMean*errorMean;
+  errorStDev=(variance>0 ? sqrt(variance) : 0.0);
+  errorRms=sqrt(meanSquares);
+}
+
+//--------------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkProbeCalibrationOptimizerAlgo::ComputeErrorThreadFunction( void *arg )
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+  vtkProbeCalibrationOptimizerAlgo* self = static_cast<vtkProbeCalibrationOptimizerAlgo*>(threadInfo->UserData);
+
+  bool compute2dError = (self->OptimizationMethod==MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D);
+  int numberOfPoints = compute2dError ? self->WireFrontPointX_Probe.size() : self->MiddleWirePointX_Probe.size();
+  int firstPointIndex = (numberOfPoints * threadInfo->ThreadID) / threadInfo->NumberOfThreads;
+  int lastPointIndex = (numberOfPoints * (threadInfo->ThreadID+1)) / threadInfo->NumberOfThreads - 1;
+
+  ErrorSumType &errorSum = self->ThreadErrorSums[threadInfo->ThreadID];
+  if (compute2dError)
+  {
+    self->ComputeError2dInRange(firstPointIndex, lastPointIndex, errorSum);
   }
+  else
+  {
+    self->ComputeError3dInRange(firstPointIndex, lastPointIndex, errorSum);
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//--------------------------------------------------------------------------------
+void vtkProbeCalibrationOptimizerAlgo::ComputeError2dInRange(int firstPointIndex, int lastPointIndex, ErrorSumType &errorSum)
+{
+  // Only the first 3 rows of the transform are used (the transform is affine)
+  const double (&m)[3][4] = this->CurrentErrorTransform;
+
+  const double* frontX = this->WireFrontPointX_Probe.empty() ? NULL : &(this->WireFrontPointX_Probe[0]);
+  const double* frontY = this->WireFrontPointY_Probe.empty() ? NULL : &(this->WireFrontPointY_Probe[0]);
+  const double* frontZ = this->WireFrontPointZ_Probe.empty() ? NULL : &(this->WireFrontPointZ_Probe[0]);
+  const double* backX = this->WireBackPointX_Probe.empty() ? NULL : &(this->WireBackPointX_Probe[0]);
+  const double* backY = this->WireBackPointY_Probe.empty() ? NULL : &(this->WireBackPointY_Probe[0]);
+  const double* backZ = this->WireBackPointZ_Probe.empty() ? NULL : &(this->WireBackPointZ_Probe[0]);
+  const double* segmentedX = this->SegmentedPointX_Image.empty() ? NULL : &(this->SegmentedPointX_Image[0]);
+  const double* segmentedY = this->SegmentedPointY_Image.empty() ? NULL : &(this->SegmentedPointY_Image[0]);
+
+  double sum=0;
+  double sumOfSquares=0;
+  int numberOfPoints=0;
+  for (int i=firstPointIndex; i<=lastPointIndex; i++)
+  {
+    // Wire endpoints in the image coordinate system
+    double frontImageX = m[0][0]*frontX[i] + m[0][1]*frontY[i] + m[0][2]*frontZ[i] + m[0][3];
+    double frontImageY = m[1][0]*frontX[i] + m[1][1]*frontY[i] + m[1][2]*frontZ[i] + m[1][3];
+    double frontImageZ = m[2][0]*frontX[i] + m[2][1]*frontY[i] + m[2][2]*frontZ[i] + m[2][3];
+    double backImageX = m[0][0]*backX[i] + m[0][1]*backY[i] + m[0][2]*backZ[i] + m[0][3];
+    double backImageY = m[1][0]*backX[i] + m[1][1]*backY[i] + m[1][2]*backZ[i] + m[1][3];
+    double backImageZ = m[2][0]*backX[i] + m[2][1]*backY[i] + m[2][2]*backZ[i] + m[2][3];
+
+    // Intersection of the wire with the image plane (z=0)
+    double wireDirectionZ = backImageZ - frontImageZ;
+    if (fabs(wireDirectionZ) <= fabs(frontImageZ)*PARALLEL_WIRE_TOLERANCE)
+    {
+      // image plane and wire are parallel, the intersection cannot be computed
+      continue;
+    }
+    double t = -frontImageZ / wireDirectionZ;
+    double errorX = segmentedX[i] - (frontImageX + t*(backImageX-frontImageX));
+    double errorY = segmentedY[i] - (frontImageY + t*(backImageY-frontImageY));
+
+    double errorSquared = errorX*errorX + errorY*errorY;
+    sum += sqrt(errorSquared);
+    sumOfSquares += errorSquared;
+    numberOfPoints++;
+  }
+
+  errorSum.Sum=sum;
+  errorSum.SumOfSquares=sumOfSquares;
+  errorSum.NumberOfPoints=numberOfPoints;
+}
+
+//--------------------------------------------------------------------------------
+void vtkProbeCalibrationOptimizerAlgo::ComputeError3dInRange(int firstPointIndex, int lastPointIndex, ErrorSumType &errorSum)
+{
+  // Only the first 3 rows of the transform are used (the transform is affine)
+  const double (&m)[3][4] = this->CurrentErrorTransform;
+
+  const double* segmentedX = this->MiddleWireSegmentedPointX_Image.empty() ? NULL : &(this->MiddleWireSegmentedPointX_Image[0]);
+  const double* segmentedY = this->MiddleWireSegmentedPointY_Image.empty() ? NULL : &(this->MiddleWireSegmentedPointY_Image[0]);
+  const double* segmentedZ = this->MiddleWireSegmentedPointZ_Image.empty() ? NULL : &(this->MiddleWireSegmentedPointZ_Image[0]);
+  const double* probeX = this->MiddleWirePointX_Probe.empty() ? NULL : &(this->MiddleWirePointX_Probe[0]);
+  const double* probeY = this->MiddleWirePointY_Probe.empty() ? NULL : &(this->MiddleWirePointY_Probe[0]);
+  const double* probeZ = this->MiddleWirePointZ_Probe.empty() ? NULL : &(this->MiddleWirePointZ_Probe[0]);
+
+  double sum=0;
+  double sumOfSquares=0;
+  for (int i=firstPointIndex; i<=lastPointIndex; i++)
+  {
+    double errorX = m[0][0]*segmentedX[i] + m[0][1]*segmentedY[i] + m[0][2]*segmentedZ[i] + m[0][3] - probeX[i];
+    double errorY = m[1][0]*segmentedX[i] + m[1][1]*segmentedY[i] + m[1][2]*segmentedZ[i] + m[1][3] - probeY[i];
+    double errorZ = m[2][0]*segmentedX[i] + m[2][1]*segmentedY[i] + m[2][2]*segmentedZ[i] + m[2][3] - probeZ[i];
+    double errorSquared = errorX*errorX + errorY*errorY + errorZ*errorZ;
+    sum += sqrt(errorSquared);
+    sumOfSquares += errorSquared;
+  }
+
+  errorSum.Sum=sum;
+  errorSum.SumOfSquares=sumOfSquares;
+  errorSum.NumberOfPoints=lastPointIndex-firstPointIndex+1;
 }
 
 //-----------------------------------------------------------------------------
@@ -12,6 +12,7 @@ See License.txt for details.
 #include "vtkObject.h"
 #include "vtkDoubleArray.h"
 #include "vtkMatrix4x4.h"
+#include "vtkMultiThreader.h"
 
 #include "vnl/vnl_matrix.h"
 #include <vnl/vnl_double_3x3.h>
@@ -38,7 +39,6 @@ See License.txt for details.
 
 class vtkTransformRepository;
 class vtkXMLDataElement;
-class vtkProbeCalibrationAlgo;
 
 //-----------------------------------------------------------------------------
 
@@ -53,6 +53,10 @@ class vtkProbeCalibrationAlgo;
   it is more accurate to optimize the in-plane (2D) error. Also this optimizer enforces orthogonality of the image to
   probe matrix and optionally it can enforce isotropic image pixel spacing.
 
+  The input points are stored in contiguous arrays (one array for each coordinate) and all the parameter-independent
+  computations (such as transforming the wire endpoints to the probe coordinate system) are performed only once, when
+  the input data is added. The cost function is evaluated on multiple threads if the number of points is large enough.
+
   \ingroup PlusLibCalibrationAlgo
 */
 class vtkProbeCalibrationOptimizerAlgo : public vtkObject
@@ -79,11 +83,17 @@ public:
   /*! Calibrate (call the minimizer) */
   PlusStatus Update();
 
-  /*! Provides to the class the information necessary make the optimization */
-  PlusStatus SetInputDataForMiddlePointMethod(std::vector< vnl_vector<double> > *calibrationMiddleWireIntersectionPointsPos_Image, std::vector< vnl_vector<double> > *calibrationMiddleWireIntersectionPointsPos_Probe, vnl_matrix_fixed<double,4,4> *imageToProbeTransformMatrix, std::set<int>* outliers);
+  /*! Remove all the input data that was added by AddInputFrame */
+  void ClearInputData();
 
-  /*! Provides to the class the information necessary make the optimization */
-  PlusStatus SetOptimizerDataUsingNWires(std::vector< vnl_vector<double> > *calibrationAllWiresIntersectionPointsPos_Image, std::vector<NWire> *nWires, std::vector< vnl_matrix_fixed<double,4,4> > *probeToPhantomTransforms, vnl_matrix_fixed<double,4,4> *imageToProbeTransformMatrix, std::set<int>* outliers);
+  /*!
+    Add the input data of one frame for the optimization
+    \param allWiresIntersectionPointsPos_Image Positions of the segmented points in the image frame (3 points for each NWire)
+    \param middleWireIntersectionPointsPos_Probe Positions of the middle wire intersection points in the probe frame (1 point for each NWire)
+    \param probeToPhantomTransform Probe to phantom transform of the frame
+    \param nWires NWire definitions (endpoints of the wires in the phantom frame)
+  */
+  PlusStatus AddInputFrame(const std::vector< vnl_vector_fixed<double,4> > &allWiresIntersectionPointsPos_Image, const std::vector< vnl_vector_fixed<double,4> > &middleWireIntersectionPointsPos_Probe, const vnl_matrix_fixed<double,4,4> &probeToPhantomTransform, const std::vector<NWire> &nWires);
 
   /*! Get optimized Image to Probe matrix */
   vnl_matrix_fixed<double,4,4> GetOptimizedImageToProbeTransformMatrix();
@@ -99,11 +109,30 @@ public:
 
   void SetImageToProbeSeedTransform(const vnl_matrix_fixed<double,4,4> &imageToProbeTransformMatrix);
 
-  void SetProbeCalibrationAlgo(vtkProbeCalibrationAlgo* probeCalibrationAlgo);
+  /*! Set the maximum number of threads used for the cost function evaluation. If 0 then the default number of threads is used. */
+  void SetNumberOfThreads(int numberOfThreads) { this->NumberOfThreads=numberOfThreads; }
+  int GetNumberOfThreads() { return this->NumberOfThreads; }
 
 protected:
 
   PlusStatus ShowTransformation(const vnl_matrix_fixed<double,4,4> &transformationMatrix);
+
+  /*! Sum of the errors of a range of points, computed by one thread */
+  struct ErrorSumType
+  {
+    double Sum;
+    double SumOfSquares;
+    int NumberOfPoints;
+  };
+
+  /*! Compute the 2D (in-plane) errors of the points in the [firstPointIndex, lastPointIndex] range using the current probe to image transform */
+  void ComputeError2dInRange(int firstPointIndex, int lastPointIndex, ErrorSumType &errorSum);
+
+  /*! Compute the 3D errors of the points in the [firstPointIndex, lastPointIndex] range using the current image to probe transform */
+  void ComputeError3dInRange(int firstPointIndex, int lastPointIndex, ErrorSumType &errorSum);
+
+  /*! Thread function for computing the errors in a range of points. Called by vtkMultiThreader, the user data is the algorithm object. */
+  static VTK_THREAD_RETURN_TYPE ComputeErrorThreadFunction( void *arg );
   
   vtkProbeCalibrationOptimizerAlgo();
   virtual  ~vtkProbeCalibrationOptimizerAlgo();
@@ -120,8 +149,41 @@ protected:
 
   /*! Store the result of the optimization process */
   vnl_matrix_fixed<double,4,4> ImageToProbeTransformMatrix;
-   
-  vtkProbeCalibrationAlgo* ProbeCalibrationAlgo;
+
+  /*! 
+    Input data for the 2D error computation, one element for each wire of each frame (index: frame*numberOfNWires*3+nWire*3+wire).
+    Endpoints of the wires in the probe coordinate system and the segmented positions in the image coordinate system.
+  */
+  std::vector<double> WireFrontPointX_Probe;
+  std::vector<double> WireFrontPointY_Probe;
+  std::vector<double> WireFrontPointZ_Probe;
+  std::vector<double> WireBackPointX_Probe;
+  std::vector<double> WireBackPointY_Probe;
+  std::vector<double> WireBackPointZ_Probe;
+  std::vector<double> SegmentedPointX_Image;
+  std::vector<double> SegmentedPointY_Image;
+
+  /*! 
+    Input data for the 3D error computation, one element for each NWire of each frame (index: frame*numberOfNWires+nWire).
+    Segmented positions of the middle wire in the image coordinate system and the computed positions in the probe coordinate system.
+  */
+  std::vector<double> MiddleWireSegmentedPointX_Image;
+  std::vector<double> MiddleWireSegmentedPointY_Image;
+  std::vector<double> MiddleWireSegmentedPointZ_Image;
+  std::vector<double> MiddleWirePointX_Probe;
+  std::vector<double> MiddleWirePointY_Probe;
+  std::vector<double> MiddleWirePointZ_Probe;
+
+  /*! Transform that is used in the current error computation (probe to image for 2D, image to probe for 3D error), shared by all the threads */
+  double CurrentErrorTransform[3][4];
+
+  /*! Error sums computed by each thread */
+  std::vector<ErrorSumType> ThreadErrorSums;
+
+  vtkSmartPointer<vtkMultiThreader> Threader;
+
+  /*! Maximum number of threads used for computing the cost function, 0 means default */
+  int NumberOfThreads;
 
 };
 
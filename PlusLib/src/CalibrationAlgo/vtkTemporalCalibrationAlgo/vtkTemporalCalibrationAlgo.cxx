@@ -156,6 +156,22 @@ void vtkTemporalCalibrationAlgo::SetMovingProbeToReferenceTransformName(const st
   this->MovingSignal.probeToReferenceTransformName = probeToReferenceTransformName;
 }
 
+//-----------------------------------------------------------------------------
+void vtkTemporalCalibrationAlgo::SetFixedSignal(const std::deque<double> &signalTimestamps, const std::deque<double> &signalValues)
+{
+  this->FixedSignal.precomputedSignalTimestamps=signalTimestamps;
+  this->FixedSignal.precomputedSignalValues=signalValues;
+  this->FixedSignal.frameType=FRAME_TYPE_SIGNAL;
+}
+
+//-----------------------------------------------------------------------------
+void vtkTemporalCalibrationAlgo::SetMovingSignal(const std::deque<double> &signalTimestamps, const std::deque<double> &signalValues)
+{
+  this->MovingSignal.precomputedSignalTimestamps=signalTimestamps;
+  this->MovingSignal.precomputedSignalValues=signalValues;
+  this->MovingSignal.frameType=FRAME_TYPE_SIGNAL;
+}
+
 //-----------------------------------------------------------------------------
 void vtkTemporalCalibrationAlgo::SetSamplingResolutionSec(double samplingResolutionSec)
 {
@@ -179,6 +195,12 @@ void vtkTemporalCalibrationAlgo::SetIntermediateFilesOutputDirectory(const std::
   this->IntermediateFilesOutputDirectory = outputDirectory;
 }
 
+//-----------------------------------------------------------------------------
+double vtkTemporalCalibrationAlgo::GetMinimumVideoSignalPeakToPeakPixel()
+{
+  return MINIMUM_VIDEO_SIGNAL_PEAK_TO_PEAK_PIXEL;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkTemporalCalibrationAlgo::GetMovingLagSec(double &lag)
 {
@@ -614,30 +636,80 @@ PlusStatus vtkTemporalCalibrationAlgo::ComputePositionSignalValues(SignalType &s
       }
       return PLUS_SUCCESS;
     }
+  case FRAME_TYPE_SIGNAL:
+    {
+      // Signal values are already computed, just crop them to the requested time range
+      signal.signalTimestamps.clear();
+      signal.signalValues.clear();
+      if (signal.precomputedSignalTimestamps.size() != signal.precomputedSignalValues.size())
+      {
+        LOG_ERROR("Compute position signal value failed. Number of timestamps ("<<signal.precomputedSignalTimestamps.size()
+          <<") and values ("<<signal.precomputedSignalValues.size()<<") do not match");
+        return PLUS_FAIL;
+      }
+      bool signalTimeRangeDefined=(signal.signalTimeRangeMin<=signal.signalTimeRangeMax);
+      for (unsigned int i=0; i<signal.precomputedSignalTimestamps.size(); ++i)
+      {
+        double timestamp=signal.precomputedSignalTimestamps[i];
+        if (signalTimeRangeDefined && (timestamp<signal.signalTimeRangeMin || timestamp>signal.signalTimeRangeMax))
+        {
+          continue;
+        }
+        signal.signalTimestamps.push_back(timestamp);
+        signal.signalValues.push_back(signal.precomputedSignalValues[i]);
+      }
+      if (signal.signalValues.empty())
+      {
+        LOG_ERROR("Compute position signal value failed. No signal values in the common time range");
+        return PLUS_FAIL;
+      }
+      return PLUS_SUCCESS;
+    }
   default:
     LOG_ERROR("Compute position signal value failed. Unknown frame type: " << signal.frameType);
     return PLUS_FAIL;
   }
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkTemporalCalibrationAlgo::GetInputTimeRange(const SignalType &signal, double &timestampMin, double &timestampMax)
+{
+  if (signal.frameType == FRAME_TYPE_SIGNAL)
+  {
+    if (signal.precomputedSignalTimestamps.empty())
+    {
+      return PLUS_FAIL;
+    }
+    timestampMin = signal.precomputedSignalTimestamps.front();
+    timestampMax = signal.precomputedSignalTimestamps.back();
+    return PLUS_SUCCESS;
+  }
+  if (signal.frameList == NULL || signal.frameList->GetNumberOfTrackedFrames()<1)
+  {
+    return PLUS_FAIL;
+  }
+  timestampMin = signal.frameList->GetTrackedFrame(0)->GetTimestamp();
+  timestampMax = signal.frameList->GetTrackedFrame(signal.frameList->GetNumberOfTrackedFrames()-1)->GetTimestamp();
+  return PLUS_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkTemporalCalibrationAlgo::ComputeCommonTimeRange()
 {
-  if (this->FixedSignal.frameList->GetNumberOfTrackedFrames()<1)
+  double fixedTimestampMin = 0;
+  double fixedTimestampMax = 0;
+  if (GetInputTimeRange(this->FixedSignal, fixedTimestampMin, fixedTimestampMax) != PLUS_SUCCESS)
   {
     LOG_ERROR("Fixed signal frame list are empty");
     return PLUS_FAIL;
   }
-  if (this->MovingSignal.frameList->GetNumberOfTrackedFrames()<1)
+  double movingTimestampMin = 0;
+  double movingTimestampMax = 0;
+  if (GetInputTimeRange(this->MovingSignal, movingTimestampMin, movingTimestampMax) != PLUS_SUCCESS)
   {
     LOG_ERROR("Moving signal frame list are empty");
     return PLUS_FAIL;
   }
-
-  double fixedTimestampMin = this->FixedSignal.frameList->GetTrackedFrame(0)->GetTimestamp();
-  double fixedTimestampMax = this->FixedSignal.frameList->GetTrackedFrame(this->FixedSignal.frameList->GetNumberOfTrackedFrames()-1)->GetTimestamp();;
-  double movingTimestampMin = this->MovingSignal.frameList->GetTrackedFrame(0)->GetTimestamp();
-  double movingTimestampMax = this->MovingSignal.frameList->GetTrackedFrame(this->MovingSignal.frameList->GetNumberOfTrackedFrames()-1)->GetTimestamp();;
   
   double commonRangeMin = std::max(fixedTimestampMin, movingTimestampMin); 
   double commonRangeMax = std::min(fixedTimestampMax, movingTimestampMax);
@@ -917,3 +989,12 @@ void vtkTemporalCalibrationAlgo::SetVideoClipRectangle( int* clipRectOriginIntVe
   this->LineSegmentationClipRectangleSize[0] = clipRectSizeIntVec[0];
   this->LineSegmentationClipRectangleSize[1] = clipRectSizeIntVec[1];
 }
+
+//-----------------------------------------------------------------------------
+void vtkTemporalCalibrationAlgo::GetVideoClipRectangle( int* clipRectOriginIntVec, int* clipRectSizeIntVec )
+{
+  clipRectOriginIntVec[0] = this->LineSegmentationClipRectangleOrigin[0];
+  clipRectOriginIntVec[1] = this->LineSegmentationClipRectangleOrigin[1];
+  clipRectSizeIntVec[0] = this->LineSegmentationClipRectangleSize[0];
+  clipRectSizeIntVec[1] = this->LineSegmentationClipRectangleSize[1];
+}
@@ -78,8 +78,9 @@ public:
   enum FRAME_TYPE {
     FRAME_TYPE_NONE,
     FRAME_TYPE_TRACKER, // The tracked frame list contains tracker data
-    FRAME_TYPE_VIDEO    // The tracked frame list contains US video data of a plane 
+    FRAME_TYPE_VIDEO,   // The tracked frame list contains US video data of a plane 
                         // (e.g., bottom of water tank)
+    FRAME_TYPE_SIGNAL   // No frame list is used, the position signal is provided directly (e.g., computed incrementally from live data)
   };
 
   struct SignalType
@@ -99,6 +100,10 @@ public:
     double signalTimeRangeMin;
     /*! End of the time range that contains the frames that should be used for signal generation */
     double signalTimeRangeMax;
+    /*! Position signal metric values that are provided directly (only used if frameType is FRAME_TYPE_SIGNAL) */
+    std::deque<double> precomputedSignalValues;
+    /*! Position signal timestamps that are provided directly (only used if frameType is FRAME_TYPE_SIGNAL) */
+    std::deque<double> precomputedSignalTimestamps;
   };
 
   PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
@@ -122,6 +127,19 @@ public:
   /*! Sets ProbeToReferenceTransform name (in the format of "CoordinateSystem1ToCoordinateSystem2") for the moving signal. Only used if the moving signal type is TRACKER_FRAME. */  
   void SetMovingProbeToReferenceTransformName(const std::string &probeToReferenceTransformName); 
 
+  /*!
+    Sets an already computed position signal as fixed signal (frame type is set to FRAME_TYPE_SIGNAL).
+    It allows reusing position metric values that have been computed earlier, for example when the signal is computed incrementally from live data.
+    Timestamps must be in ascending order.
+  */  
+  void SetFixedSignal(const std::deque<double> &signalTimestamps, const std::deque<double> &signalValues); 
+
+  /*!
+    Sets an already computed position signal as moving signal (frame type is set to FRAME_TYPE_SIGNAL).
+    Timestamps must be in ascending order.
+  */  
+  void SetMovingSignal(const std::deque<double> &signalTimestamps, const std::deque<double> &signalValues); 
+
   /*! Sets the maximum allowable time lag between the corresponding tracker and video frames. Default is 2 seconds */  
   void SetMaximumMovingLagSec(double maxLagSec);
 
@@ -131,6 +149,7 @@ public:
   void SetIntermediateFilesOutputDirectory(const std::string &outputDirectory);
 
   void SetVideoClipRectangle( int* clipRectOriginIntVec, int* clipRectSizeIntVec );
+  void GetVideoClipRectangle( int* clipRectOriginIntVec, int* clipRectSizeIntVec );
 
   /*! Compute the tracker lag */  
   PlusStatus Update(TEMPORAL_CALIBRATION_ERROR &error); 
@@ -158,9 +177,14 @@ public:
   PlusStatus GetBestCorrelation(double &videoCorrelation);
   PlusStatus GetMaxCalibrationError(double &maxCalibrationError);
 
+  /*! The calibration fails if the position metric computed from the video varies less than this (in pixels) */
+  static double GetMinimumVideoSignalPeakToPeakPixel();
+
 protected:   
   PlusStatus ComputeMovingSignalLagSec(TEMPORAL_CALIBRATION_ERROR& error);
   PlusStatus ComputePositionSignalValues(SignalType &signal);
+  /*! Get the time range covered by the input frames or the precomputed signal */
+  PlusStatus GetInputTimeRange(const SignalType &signal, double &timestampMin, double &timestampMax);
   PlusStatus GetSignalRange(const std::deque<double> &signal, int startIndex, int stopIndex, double &minValue, double &maxValue);
   PlusStatus VerifyTrackerInput(vtkTrackedFrameList *trackerFrames, TEMPORAL_CALIBRATION_ERROR &error);
 
@@ -0,0 +1,109 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/ 
+
+#include "PlusConfigure.h"
+
+#include "vtkObjectFactory.h"
+
+#include "vtkLineSegmentationAlgo.h"
+#include "vtkTemporalCalibrationAlgo.h"
+#include "vtkTemporalCalibrationAlgoEstimator.h"
+#include "vtkTrackedFrameList.h"
+
+//-----------------------------------------------------------------------------
+vtkCxxRevisionMacro(vtkTemporalCalibrationAlgoEstimator, "$Revision: 1.0 $");
+vtkStandardNewMacro(vtkTemporalCalibrationAlgoEstimator);
+
+//-----------------------------------------------------------------------------
+vtkTemporalCalibrationAlgoEstimator::vtkTemporalCalibrationAlgoEstimator()
+{
+  this->ClipRectangleOrigin[0]=0;
+  this->ClipRectangleOrigin[1]=0;
+  this->ClipRectangleSize[0]=0;
+  this->ClipRectangleSize[1]=0;
+
+  this->LineSegmenter=vtkLineSegmentationAlgo::New();
+  this->TemporalCalibrationAlgo=vtkTemporalCalibrationAlgo::New();
+}
+
+//-----------------------------------------------------------------------------
+vtkTemporalCalibrationAlgoEstimator::~vtkTemporalCalibrationAlgoEstimator()
+{
+  DELETE_IF_NOT_NULL(this->LineSegmenter);
+  DELETE_IF_NOT_NULL(this->TemporalCalibrationAlgo);
+}
+
+//----------------------------------------------------------------------------
+void vtkTemporalCalibrationAlgoEstimator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "ClipRectangleOrigin: " << this->ClipRectangleOrigin[0] << " " << this->ClipRectangleOrigin[1] << std::endl;
+  os << indent << "ClipRectangleSize: " << this->ClipRectangleSize[0] << " " << this->ClipRectangleSize[1] << std::endl;
+} 
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkTemporalCalibrationAlgoEstimator::ReadConfiguration(vtkXMLDataElement* deviceConfig)
+{
+  if (this->TemporalCalibrationAlgo->ReadConfiguration(deviceConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->TemporalCalibrationAlgo->GetVideoClipRectangle(this->ClipRectangleOrigin, this->ClipRectangleSize);
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkTemporalCalibrationAlgoEstimator::ComputeFixedSignal(vtkTrackedFrameList* fixedFrames, std::deque<double> &signalTimestamps, std::deque<double> &signalValues)
+{
+  this->LineSegmenter->SetTrackedFrameList(fixedFrames);
+  this->LineSegmenter->SetClipRectangle(this->ClipRectangleOrigin, this->ClipRectangleSize);
+  this->LineSegmenter->SetSignalTimeRange(1, 0); // use all frames
+  if ( this->LineSegmenter->Update() != PLUS_SUCCESS )
+  {
+    return PLUS_FAIL;
+  }
+
+  std::deque<double> timestamps;
+  std::deque<double> positions;
+  this->LineSegmenter->GetDetectedTimestamps(timestamps);
+  this->LineSegmenter->GetDetectedPositions(positions);
+  signalTimestamps.insert(signalTimestamps.end(), timestamps.begin(), timestamps.end());
+  signalValues.insert(signalValues.end(), positions.begin(), positions.end());
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkTemporalCalibrationAlgoEstimator::EstimateMovingLag(const std::deque<double> &fixedSignalTimestamps, const std::deque<double> &fixedSignalValues,
+  vtkTrackedFrameList* movingFrames, const char* movingProbeToReferenceTransformName, double maximumMovingLagSec,
+  double &movingLagSec, double &calibrationError)
+{
+  if (movingProbeToReferenceTransformName == NULL)
+  {
+    LOG_ERROR("vtkTemporalCalibrationAlgoEstimator::EstimateMovingLag failed: moving probe to reference transform name is not specified");
+    return PLUS_FAIL;
+  }
+
+  this->TemporalCalibrationAlgo->SetFixedSignal(fixedSignalTimestamps, fixedSignalValues);
+  this->TemporalCalibrationAlgo->SetMovingFrames(movingFrames, vtkTemporalCalibrationAlgo::FRAME_TYPE_TRACKER);
+  this->TemporalCalibrationAlgo->SetMovingProbeToReferenceTransformName(movingProbeToReferenceTransformName);
+  this->TemporalCalibrationAlgo->SetMaximumMovingLagSec(maximumMovingLagSec);
+
+  vtkTemporalCalibrationAlgo::TEMPORAL_CALIBRATION_ERROR error = vtkTemporalCalibrationAlgo::TEMPORAL_CALIBRATION_ERROR_NONE;
+  if (this->TemporalCalibrationAlgo->Update(error) != PLUS_SUCCESS)
+  {
+    LOG_DEBUG("Temporal calibration failed (error code: "<<error<<")");
+    return PLUS_FAIL;
+  }
+  this->TemporalCalibrationAlgo->GetMovingLagSec(movingLagSec);
+  this->TemporalCalibrationAlgo->GetCalibrationError(calibrationError);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+double vtkTemporalCalibrationAlgoEstimator::GetMinimumFixedSignalPeakToPeak()
+{
+  return vtkTemporalCalibrationAlgo::GetMinimumVideoSignalPeakToPeakPixel();
+}
@@ -0,0 +1,62 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/ 
+
+#ifndef __vtkTemporalCalibrationAlgoEstimator_h
+#define __vtkTemporalCalibrationAlgoEstimator_h
+
+#include "vtkTemporalCalibrationEstimator.h"
+
+class vtkLineSegmentationAlgo;
+class vtkTemporalCalibrationAlgo;
+
+/*!
+  \class vtkTemporalCalibrationAlgoEstimator
+  \brief Time offset estimator for vtkVirtualTemporalCalibrationMonitor, using the same algorithms as fCal temporal calibration
+
+  The fixed signal is computed from the video frames by vtkLineSegmentationAlgo, the lag is computed by
+  vtkTemporalCalibrationAlgo from the precomputed fixed signal and the tracker frames.
+  The two steps use separate algorithm instances, as they are called from different threads.
+  The video clip rectangle is read from the vtkTemporalCalibrationAlgo element, the same way as in fCal.
+
+  \ingroup PlusLibCalibrationAlgorithm
+*/
+class vtkTemporalCalibrationAlgoEstimator : public vtkTemporalCalibrationEstimator
+{
+public:
+  static vtkTemporalCalibrationAlgoEstimator* New();
+  vtkTypeRevisionMacro(vtkTemporalCalibrationAlgoEstimator, vtkTemporalCalibrationEstimator);
+  virtual void PrintSelf(ostream& os, vtkIndent indent); 
+
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* deviceConfig);
+
+  virtual PlusStatus ComputeFixedSignal(vtkTrackedFrameList* fixedFrames, std::deque<double> &signalTimestamps, std::deque<double> &signalValues);
+
+  virtual PlusStatus EstimateMovingLag(const std::deque<double> &fixedSignalTimestamps, const std::deque<double> &fixedSignalValues,
+    vtkTrackedFrameList* movingFrames, const char* movingProbeToReferenceTransformName, double maximumMovingLagSec,
+    double &movingLagSec, double &calibrationError);
+
+  virtual double GetMinimumFixedSignalPeakToPeak();
+
+protected:
+  vtkTemporalCalibrationAlgoEstimator();
+  virtual ~vtkTemporalCalibrationAlgoEstimator();
+
+  /*! Clip rectangle used for line detection on the video frames */
+  int ClipRectangleOrigin[2];
+  int ClipRectangleSize[2];
+
+  /*! Only used by ComputeFixedSignal */
+  vtkLineSegmentationAlgo* LineSegmenter;
+
+  /*! Only used by EstimateMovingLag */
+  vtkTemporalCalibrationAlgo* TemporalCalibrationAlgo;
+
+private:
+  vtkTemporalCalibrationAlgoEstimator(const vtkTemporalCalibrationAlgoEstimator&);
+  void operator=(const vtkTemporalCalibrationAlgoEstimator&);
+};
+
+#endif //  __vtkTemporalCalibrationAlgoEstimator_h 
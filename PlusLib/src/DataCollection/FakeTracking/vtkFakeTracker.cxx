@@ -23,6 +23,7 @@ vtkFakeTracker::vtkFakeTracker()
 , RandomSeed(0)
 , Counter(-1)
 , PhantomLandmarks(NULL)
+, ConnectionDelaySec(0.0)
 {
   vtkSmartPointer<vtkPoints> phantomLandmarks = vtkSmartPointer<vtkPoints>::New();
   this->SetPhantomLandmarks(phantomLandmarks);
@@ -64,6 +65,12 @@ PlusStatus vtkFakeTracker::InternalConnect()
 {
   LOG_TRACE("vtkFakeTracker::InternalConnect"); 
 
+  if (this->ConnectionDelaySec > 0)
+  {
+    // Simulate the connection latency of a real tracker
+    vtkAccurateTimer::Delay(this->ConnectionDelaySec);
+  }
+
   vtkPlusDataSource* tool = NULL; 
   switch (this->Mode)
   {
@@ -605,6 +612,12 @@ PlusStatus vtkFakeTracker::ReadConfiguration(vtkXMLDataElement* config)
       }
     }
 
+    double connectionDelaySec = 0.0;
+    if ( trackerConfig->GetScalarAttribute("ConnectionDelaySec", connectionDelaySec) )
+    {
+      this->SetConnectionDelaySec(connectionDelaySec);
+    }
+
     // Read landmarks for RecordPhantomLandmarks mode
     bool phantomLandmarksFound = true;
     vtkXMLDataElement* landmarks = NULL;
@@ -68,6 +68,11 @@ public:
   /*! Get the phantom landmark points positions */
   vtkGetObjectMacro(PhantomLandmarks, vtkPoints);
 
+  /*! Set simulated connection latency (for testing device startup) */
+  vtkSetMacro(ConnectionDelaySec, double);
+  /*! Get simulated connection latency */
+  vtkGetMacro(ConnectionDelaySec, double);
+
 protected:
   /*! Set the phantom landmark points positions */
   vtkSetObjectMacro(PhantomLandmarks, vtkPoints);
@@ -109,6 +114,9 @@ protected:
     Need for setting up RecordPhantomLandmarks mode
   */
   vtkPoints* PhantomLandmarks;
+
+  /*! Time spent in InternalConnect, for simulating the connection latency of real devices */
+  double ConnectionDelaySec;
 };
 
 
@@ -0,0 +1,346 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkLoadGeneratorSource.h"
+#include "vtkMath.h"
+#include "vtkMatrix4x4.h"
+#include "vtkObjectFactory.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDataSource.h"
+#include "vtkXMLDataElement.h"
+#include <algorithm>
+#include <sstream>
+
+vtkCxxRevisionMacro(vtkLoadGeneratorSource, "$Revision: 1.0$");
+vtkStandardNewMacro(vtkLoadGeneratorSource);
+
+namespace
+{
+  const int DEFAULT_FRAME_SIZE[2] = {640, 480};
+
+  // The tools are moved back and forth along the Z axis with this amplitude and period
+  const double TOOL_SWEEP_AMPLITUDE_MM = 20.0;
+  const double TOOL_SWEEP_PERIOD_SEC = 4.0;
+  // Distance between the tools along the X axis
+  const double TOOL_SPACING_MM = 20.0;
+
+  struct PixelTypeName
+  {
+    PlusCommon::VTKScalarPixelType PixelType;
+    const char* Name;
+  };
+  const PixelTypeName PIXEL_TYPE_NAMES[] =
+  {
+    { VTK_UNSIGNED_CHAR, "UnsignedChar" },
+    { VTK_CHAR, "Char" },
+    { VTK_UNSIGNED_SHORT, "UnsignedShort" },
+    { VTK_SHORT, "Short" },
+    { VTK_FLOAT, "Float" }
+  };
+  const int NUMBER_OF_PIXEL_TYPES = sizeof(PIXEL_TYPE_NAMES) / sizeof(PIXEL_TYPE_NAMES[0]);
+
+  //----------------------------------------------------------------------------
+  // Set all the pixels of the frame to the same value
+  template<typename PixelType> void FillFrame(std::vector<unsigned char>& frameData, PixelType value)
+  {
+    PixelType* pixels = reinterpret_cast<PixelType*>(&frameData[0]);
+    std::fill(pixels, pixels + frameData.size() / sizeof(PixelType), value);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkLoadGeneratorSource::vtkLoadGeneratorSource()
+: PixelType(VTK_UNSIGNED_CHAR)
+, NumberOfCustomFields(0)
+, TimestampJitterSec(0)
+, ToolMatrix(vtkMatrix4x4::New())
+, RecordingStartTime(0)
+, NextFrameTime(0)
+, NumberOfGeneratedFrames(0)
+{
+  this->FrameSize[0] = DEFAULT_FRAME_SIZE[0];
+  this->FrameSize[1] = DEFAULT_FRAME_SIZE[1];
+
+  // No callback function provided by the device, so the data capture thread will be used to generate the frames
+  this->StartThreadForInternalUpdates = true;
+}
+
+//----------------------------------------------------------------------------
+vtkLoadGeneratorSource::~vtkLoadGeneratorSource()
+{
+  DELETE_IF_NOT_NULL(this->ToolMatrix);
+}
+
+//----------------------------------------------------------------------------
+void vtkLoadGeneratorSource::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "Frame size: " << this->FrameSize[0] << "x" << this->FrameSize[1] << "\n";
+  os << indent << "Pixel type: " << vtkImageScalarTypeNameMacro(this->PixelType) << "\n";
+  os << indent << "Number of custom fields: " << this->NumberOfCustomFields << "\n";
+  os << indent << "Timestamp jitter: " << this->TimestampJitterSec << " sec\n";
+  os << indent << "Number of generated frames: " << this->NumberOfGeneratedFrames << "\n";
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkLoadGeneratorSource::InternalConnect()
+{
+  LOG_TRACE("vtkLoadGeneratorSource::InternalConnect");
+
+  for ( DataSourceContainerConstIterator it = this->GetVideoIteratorBegin(); it != this->GetVideoIteratorEnd(); ++it )
+  {
+    vtkPlusBuffer* buffer = it->second->GetBuffer();
+    buffer->Clear();
+    buffer->SetFrameSize(this->FrameSize);
+    buffer->SetPixelType(this->PixelType);
+    buffer->SetNumberOfScalarComponents(1);
+    buffer->SetImageType(US_IMG_BRIGHTNESS);
+  }
+
+  this->FrameData.resize(this->FrameSize[0] * this->FrameSize[1] * PlusVideoFrame::GetNumberOfBytesPerScalar(this->PixelType));
+
+  this->CustomFields.clear();
+  for ( int i = 0; i < this->NumberOfCustomFields; i++ )
+  {
+    std::ostringstream fieldName;
+    fieldName << "LoadGeneratorField" << i;
+    this->CustomFields[fieldName.str()] = "0";
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkLoadGeneratorSource::InternalDisconnect()
+{
+  LOG_TRACE("vtkLoadGeneratorSource::InternalDisconnect");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkLoadGeneratorSource::InternalStartRecording()
+{
+  this->NumberOfGeneratedFrames = 0;
+  this->RecordingStartTime = vtkAccurateTimer::GetSystemTime();
+  this->NextFrameTime = this->RecordingStartTime;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkLoadGeneratorSource::InternalUpdate()
+{
+  if ( this->AcquisitionRate <= 0 )
+  {
+    LOG_ERROR("Unable to generate frames, acquisition rate is invalid: " << this->AcquisitionRate);
+    return PLUS_FAIL;
+  }
+
+  // The data capture thread calls this method with the acquisition rate, but the calls are not exactly periodic,
+  // so all the frames are generated that are due since the previous call
+  PlusStatus status = PLUS_SUCCESS;
+  const double currentTime = vtkAccurateTimer::GetSystemTime();
+  while ( this->NextFrameTime <= currentTime )
+  {
+    if ( this->GenerateFrame(this->NextFrameTime) != PLUS_SUCCESS )
+    {
+      status = PLUS_FAIL;
+    }
+    this->NumberOfGeneratedFrames++;
+
+    // The frame is delayed by a random time compared to its nominal time
+    double jitterSec = ( this->TimestampJitterSec > 0 ) ? vtkMath::Random(0.0, this->TimestampJitterSec) : 0.0;
+    this->NextFrameTime = this->RecordingStartTime + this->NumberOfGeneratedFrames / this->AcquisitionRate + jitterSec;
+  }
+
+  this->Modified();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkLoadGeneratorSource::GenerateFrame(double timestamp)
+{
+  this->FrameNumber++;
+  PlusStatus status = PLUS_SUCCESS;
+
+  if ( this->GetVideoIteratorBegin() != this->GetVideoIteratorEnd() )
+  {
+    // The pixel values change with each frame, so that the frames are not identical
+    switch ( this->PixelType )
+    {
+    case VTK_CHAR: FillFrame<char>(this->FrameData, static_cast<char>(this->FrameNumber & 0x7F)); break;
+    case VTK_UNSIGNED_SHORT: FillFrame<unsigned short>(this->FrameData, static_cast<unsigned short>(this->FrameNumber & 0xFFFF)); break;
+    case VTK_SHORT: FillFrame<short>(this->FrameData, static_cast<short>(this->FrameNumber & 0x7FFF)); break;
+    case VTK_FLOAT: FillFrame<float>(this->FrameData, static_cast<float>(this->FrameNumber & 0xFF)); break;
+    default: FillFrame<unsigned char>(this->FrameData, static_cast<unsigned char>(this->FrameNumber & 0xFF)); break;
+    }
+
+    if ( !this->CustomFields.empty() )
+    {
+      std::ostringstream fieldValue;
+      fieldValue << this->FrameNumber;
+      for ( TrackedFrame::FieldMapType::iterator fieldIt = this->CustomFields.begin(); fieldIt != this->CustomFields.end(); ++fieldIt )
+      {
+        fieldIt->second = fieldValue.str();
+      }
+    }
+
+    for ( DataSourceContainerConstIterator it = this->GetVideoIteratorBegin(); it != this->GetVideoIteratorEnd(); ++it )
+    {
+      vtkPlusDataSource* videoSource = it->second;
+      if ( videoSource->GetBuffer()->AddItem(&this->FrameData[0], videoSource->GetPortImageOrientation(), this->FrameSize, this->PixelType, 1, US_IMG_BRIGHTNESS, 0,
+        this->FrameNumber, timestamp, timestamp, this->CustomFields.empty() ? NULL : &this->CustomFields) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to add generated frame to the buffer of " << videoSource->GetSourceId());
+        status = PLUS_FAIL;
+      }
+    }
+  }
+
+  // Each tool moves back and forth along the Z axis, the tools are placed next to each other along the X axis
+  const double sweepPosition = TOOL_SWEEP_AMPLITUDE_MM * sin(2.0 * vtkMath::Pi() * (timestamp - this->RecordingStartTime) / TOOL_SWEEP_PERIOD_SEC);
+  int toolIndex = 0;
+  for ( DataSourceContainerConstIterator it = this->GetToolIteratorBegin(); it != this->GetToolIteratorEnd(); ++it, ++toolIndex )
+  {
+    this->ToolMatrix->Identity();
+    this->ToolMatrix->SetElement(0, 3, toolIndex * TOOL_SPACING_MM);
+    this->ToolMatrix->SetElement(2, 3, sweepPosition);
+    if ( this->ToolTimeStampedUpdateWithoutFiltering(it->second->GetSourceId(), this->ToolMatrix, TOOL_OK, timestamp, timestamp) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to add generated transform to the buffer of " << it->second->GetSourceId());
+      status = PLUS_FAIL;
+    }
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkLoadGeneratorSource::ReadConfiguration(vtkXMLDataElement* config)
+{
+  LOG_TRACE("vtkLoadGeneratorSource::ReadConfiguration");
+
+  if ( config == NULL )
+  {
+    LOG_ERROR("Unable to configure load generator! (XML data element is NULL)");
+    return PLUS_FAIL;
+  }
+
+  // Read superclass configuration
+  if ( Superclass::ReadConfiguration(config) != PLUS_SUCCESS )
+  {
+    return PLUS_FAIL;
+  }
+
+  vtkXMLDataElement* deviceConfig = this->FindThisDeviceElement(config);
+  if (deviceConfig == NULL)
+  {
+    LOG_ERROR("Unable to find LoadGenerator device element in configuration XML structure!");
+    return PLUS_FAIL;
+  }
+
+  int frameSize[2] = {0, 0};
+  if ( deviceConfig->GetVectorAttribute("FrameSize", 2, frameSize) )
+  {
+    if ( frameSize[0] < 1 || frameSize[1] < 1 )
+    {
+      LOG_ERROR("Invalid FrameSize: " << frameSize[0] << "x" << frameSize[1]);
+      return PLUS_FAIL;
+    }
+    this->SetFrameSize(frameSize);
+  }
+
+  const char* pixelType = deviceConfig->GetAttribute("PixelType");
+  if ( pixelType != NULL )
+  {
+    bool pixelTypeFound = false;
+    for ( int i = 0; i < NUMBER_OF_PIXEL_TYPES; i++ )
+    {
+      if ( STRCASECMP(pixelType, PIXEL_TYPE_NAMES[i].Name) == 0 )
+      {
+        this->SetPixelType(PIXEL_TYPE_NAMES[i].PixelType);
+        pixelTypeFound = true;
+        break;
+      }
+    }
+    if ( !pixelTypeFound )
+    {
+      LOG_ERROR("Unsupported PixelType: " << pixelType << " (supported: UnsignedChar, Char, UnsignedShort, Short, Float)");
+      return PLUS_FAIL;
+    }
+  }
+
+  int numberOfCustomFields = 0;
+  if ( deviceConfig->GetScalarAttribute("NumberOfCustomFields", numberOfCustomFields) )
+  {
+    this->SetNumberOfCustomFields(numberOfCustomFields);
+  }
+
+  double timestampJitterSec = 0;
+  if ( deviceConfig->GetScalarAttribute("TimestampJitterSec", timestampJitterSec) )
+  {
+    this->SetTimestampJitterSec(timestampJitterSec);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkLoadGeneratorSource::WriteConfiguration(vtkXMLDataElement* config)
+{
+  if ( Superclass::WriteConfiguration(config) != PLUS_SUCCESS )
+  {
+    return PLUS_FAIL;
+  }
+
+  vtkXMLDataElement* deviceConfig = this->FindThisDeviceElement(config);
+  if (deviceConfig == NULL)
+  {
+    LOG_ERROR("Unable to find LoadGenerator device element in configuration XML structure!");
+    return PLUS_FAIL;
+  }
+
+  deviceConfig->SetVectorAttribute("FrameSize", 2, this->FrameSize);
+  for ( int i = 0; i < NUMBER_OF_PIXEL_TYPES; i++ )
+  {
+    if ( PIXEL_TYPE_NAMES[i].PixelType == this->PixelType )
+    {
+      deviceConfig->SetAttribute("PixelType", PIXEL_TYPE_NAMES[i].Name);
+      break;
+    }
+  }
+  deviceConfig->SetIntAttribute("NumberOfCustomFields", this->NumberOfCustomFields);
+  deviceConfig->SetDoubleAttribute("TimestampJitterSec", this->TimestampJitterSec);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkLoadGeneratorSource::NotifyConfigured()
+{
+  if ( this->GetVideoIteratorBegin() == this->GetVideoIteratorEnd() && this->GetToolIteratorBegin() == this->GetToolIteratorEnd() )
+  {
+    LOG_ERROR("vtkLoadGeneratorSource requires at least one video or tool data source. Cannot proceed.");
+    this->SetCorrectlyConfigured(false);
+    return PLUS_FAIL;
+  }
+
+  if ( this->NumberOfCustomFields < 0 )
+  {
+    LOG_ERROR("Invalid NumberOfCustomFields: " << this->NumberOfCustomFields);
+    this->SetCorrectlyConfigured(false);
+    return PLUS_FAIL;
+  }
+
+  if ( this->TimestampJitterSec < 0 || (this->AcquisitionRate > 0 && this->TimestampJitterSec >= 1.0 / this->AcquisitionRate) )
+  {
+    LOG_ERROR("Invalid TimestampJitterSec: " << this->TimestampJitterSec << ". It shall be non-negative and less than the frame period (" << 1.0 / this->AcquisitionRate << " sec).");
+    this->SetCorrectlyConfigured(false);
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,126 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkLoadGeneratorSource_h
+#define __vtkLoadGeneratorSource_h
+
+#include "vtkPlusDevice.h"
+#include <vector>
+
+class vtkMatrix4x4;
+
+/*!
+\class vtkLoadGeneratorSource
+\brief Synthetic device that generates image frames and tool transforms with a configurable data rate
+
+The device generates frames of the configured size and pixel type with the acquisition rate, and a transform for each
+tool at the time of each frame. The tools are translated back and forth along the Z axis, so the frames sweep a volume.
+Custom fields can be added to the frames and the time of the frames can be jittered to simulate irregular acquisition.
+The device does not need any hardware or input file, so it can be used for measuring the throughput and latency
+of the data collection and the processing pipelines (recording, volume reconstruction, broadcasting).
+
+Example configuration:
+  <Device Id="LoadGeneratorDevice" Type="LoadGenerator" AcquisitionRate="30" ToolReferenceFrame="Reference"
+    FrameSize="640 480" PixelType="UnsignedChar" NumberOfCustomFields="2" TimestampJitterSec="0.005" >
+    <DataSources>
+      <DataSource Type="Video" Id="Video" PortUsImageOrientation="MF" BufferSize="100" />
+      <DataSource Type="Tool" Id="Probe" PortName="0" BufferSize="100" />
+    </DataSources>
+    <OutputChannels>
+      <OutputChannel Id="TrackedVideoStream" VideoDataSourceId="Video" >
+        <DataSource Id="Probe"/>
+      </OutputChannel>
+    </OutputChannels>
+  </Device>
+
+\ingroup PlusLibDataCollection
+*/
+class VTK_EXPORT vtkLoadGeneratorSource : public vtkPlusDevice
+{
+public:
+  static vtkLoadGeneratorSource *New();
+  vtkTypeRevisionMacro(vtkLoadGeneratorSource, vtkPlusDevice);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /*! Read configuration from xml data */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* config);
+
+  /*! Write configuration to xml data */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement* config);
+
+  virtual bool IsTracker() const { return !this->Tools.empty(); }
+
+  /*! Set the size of the generated frames in pixels */
+  vtkSetVector2Macro(FrameSize, int);
+  /*! Get the size of the generated frames in pixels */
+  vtkGetVector2Macro(FrameSize, int);
+
+  /*! Set the pixel type of the generated frames (VTK_UNSIGNED_CHAR, VTK_CHAR, VTK_UNSIGNED_SHORT, VTK_SHORT or VTK_FLOAT) */
+  vtkSetMacro(PixelType, PlusCommon::VTKScalarPixelType);
+  /*! Get the pixel type of the generated frames */
+  vtkGetMacro(PixelType, PlusCommon::VTKScalarPixelType);
+
+  /*! Set the number of custom fields that are added to each frame */
+  vtkSetMacro(NumberOfCustomFields, int);
+  /*! Get the number of custom fields that are added to each frame */
+  vtkGetMacro(NumberOfCustomFields, int);
+
+  /*!
+    Set the maximum random delay of the frames compared to the nominal frame times, in seconds.
+    It shall be less than the frame period (1/AcquisitionRate), so that the frame times remain increasing.
+  */
+  vtkSetMacro(TimestampJitterSec, double);
+  /*! Get the maximum random delay of the frames compared to the nominal frame times, in seconds */
+  vtkGetMacro(TimestampJitterSec, double);
+
+  /*! Get the number of frames that have been generated since the recording was started */
+  vtkGetMacro(NumberOfGeneratedFrames, long);
+
+  /*! Verify the device is correctly configured */
+  virtual PlusStatus NotifyConfigured();
+
+protected:
+  vtkLoadGeneratorSource();
+  virtual ~vtkLoadGeneratorSource();
+
+  virtual PlusStatus InternalConnect();
+  virtual PlusStatus InternalDisconnect();
+  virtual PlusStatus InternalStartRecording();
+
+  /*! Generate all the frames that are due since the previous update */
+  virtual PlusStatus InternalUpdate();
+
+  /*! Add a frame and the tool transforms with the given timestamp */
+  PlusStatus GenerateFrame(double timestamp);
+
+  int FrameSize[2];
+  PlusCommon::VTKScalarPixelType PixelType;
+  int NumberOfCustomFields;
+  double TimestampJitterSec;
+
+  /*! Pixel data of the generated frame, allocated once at connect */
+  std::vector<unsigned char> FrameData;
+
+  /*! Custom fields that are added to each frame, the field names are generated at connect */
+  TrackedFrame::FieldMapType CustomFields;
+
+  /*! Matrix of the generated tool transforms */
+  vtkMatrix4x4* ToolMatrix;
+
+  /*! System time when the recording was started, the frame times are computed from it */
+  double RecordingStartTime;
+
+  /*! Time of the next frame to be generated, including the jitter */
+  double NextFrameTime;
+
+  long NumberOfGeneratedFrames;
+
+private:
+  vtkLoadGeneratorSource(const vtkLoadGeneratorSource&);  // Not implemented.
+  void operator=(const vtkLoadGeneratorSource&);  // Not implemented.
+};
+
+#endif
@@ -14,8 +14,10 @@
 #include "vtkObjectFactory.h"
 #include "vtkOpenIGTLinkTracker.h"
 #include "vtkPlusIgtlMessageCommon.h"
+#include "vtkPlusIgtlMessageReceiver.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusDataSource.h"
+#include "vtkRecursiveCriticalSection.h"
 #include "vtkTransform.h"
 #include "vtkXMLDataElement.h"
 #include "vtksys/SystemTools.hxx"
@@ -23,13 +25,11 @@
 #include <set>
 
 static const int CLIENT_SOCKET_TIMEOUT_MSEC = 500; 
+// If no message is received for this many socket timeouts then the server is considered to be disconnected
+static const int RECEIVE_TIMEOUT_NUMBER_OF_SOCKET_TIMEOUTS = 10;
 
 vtkStandardNewMacro(vtkOpenIGTLinkTracker);
 
-#ifdef _WIN32
-  #include <Winsock2.h>
-#endif
-
 //----------------------------------------------------------------------------
 vtkOpenIGTLinkTracker::vtkOpenIGTLinkTracker()
 : MessageType(NULL)
@@ -39,6 +39,9 @@ vtkOpenIGTLinkTracker::vtkOpenIGTLinkTracker()
 , DelayBetweenRetryAttemptsSec(0.100) // there is already a delay with a CLIENT_SOCKET_TIMEOUT_MSEC timeout, so we just add a little extra idle delay
 , IgtlMessageCrcCheckEnabled(0)
 , ClientSocket(igtl::ClientSocket::New())
+, MessageReceiver(vtkPlusIgtlMessageReceiver::New())
+, ToolUpdateMutex(vtkRecursiveCriticalSection::New())
+, ReceiveTimeoutReported(false)
 , ReconnectOnReceiveTimeout(true)
 , TrackerInternalCoordinateSystemName(NULL)
 , UseLastTransformsOnReceiveTimeout(false)
@@ -55,7 +58,13 @@ vtkOpenIGTLinkTracker::vtkOpenIGTLinkTracker()
   this->TrackerInternalCoordinateSystemName=NULL;
   SetTrackerInternalCoordinateSystemName("Reference");
 
-  // No callback function provided by the device, so the data capture thread will be used to poll the hardware and add new items to the buffer
+  this->MessageReceiver->SetSocket(this->ClientSocket);
+  this->MessageReceiver->SetMessageHandler(&vtkOpenIGTLinkTracker::ProcessReceivedMessage, this);
+  this->MessageReceiver->AddAcceptedMessageType("TRANSFORM", (vtkPlusIgtlMessageFactory::PointerToMessageBaseNew)&igtl::TransformMessage::New);
+  this->MessageReceiver->AddAcceptedMessageType("POSITION", (vtkPlusIgtlMessageFactory::PointerToMessageBaseNew)&igtl::PositionMessage::New);
+  this->MessageReceiver->AddAcceptedMessageType("TDATA", (vtkPlusIgtlMessageFactory::PointerToMessageBaseNew)&igtl::TrackingDataMessage::New);
+
+  // The messages are added to the buffers by the message receiver, the data capture thread is used for handling the socket errors and receive timeouts
   this->StartThreadForInternalUpdates=true;
 }
 
@@ -66,6 +75,9 @@ vtkOpenIGTLinkTracker::~vtkOpenIGTLinkTracker()
   {
     this->StopRecording();
   }
+  this->MessageReceiver->Stop();
+  DELETE_IF_NOT_NULL(this->MessageReceiver);
+  DELETE_IF_NOT_NULL(this->ToolUpdateMutex);
   SetTrackerInternalCoordinateSystemName(NULL);
 }
 
@@ -104,6 +116,9 @@ PlusStatus vtkOpenIGTLinkTracker::InternalDisconnect()
 {
   LOG_TRACE( "vtkOpenIGTLinkTracker::Disconnect" ); 
 
+  // Stop receiving before the socket is used for sending and closed
+  this->MessageReceiver->Stop();
+
   // If we need TDATA, request server to stop streaming.
   if ( std::string( this->MessageType ).compare( "TDATA" ) == 0 )
   {
@@ -151,7 +166,13 @@ PlusStatus vtkOpenIGTLinkTracker::InternalStartRecording()
     return PLUS_SUCCESS;
   }
 
-  return this->Connect(); 
+  if ( this->Connect() != PLUS_SUCCESS )
+  {
+    return PLUS_FAIL;
+  }
+
+  this->ReceiveTimeoutReported = false;
+  return this->MessageReceiver->Start(); 
 }
 
 //----------------------------------------------------------------------------
@@ -159,6 +180,7 @@ PlusStatus vtkOpenIGTLinkTracker::InternalStopRecording()
 {
   LOG_TRACE( "vtkOpenIGTLinkTracker::InternalStopRecording" ); 
   
+  this->MessageReceiver->Stop();
   return PLUS_SUCCESS;
 }
 
@@ -173,64 +195,62 @@ PlusStatus vtkOpenIGTLinkTracker::InternalUpdate()
     return PLUS_FAIL;
   }
 
-  igtl::MessageHeader::Pointer headerMsg;
-  PlusStatus socketStatus=ReceiveMessageHeader(headerMsg);
-  if (socketStatus==PLUS_FAIL)
+  // The received messages are added to the buffers by the message receiver threads,
+  // only the socket errors and the receive timeouts are handled here
+  if ( this->MessageReceiver->GetSocketError() )
   {
     // There is a socket error
     if (this->GetReconnectOnReceiveTimeout())
     {
       LOG_ERROR("Socket error in device "<<this->GetDeviceId()<<": failed to receive OpenIGTLink transforms. Attempt to reconnect.");
-      ClientSocketReconnect();
-    }
-    else
-    {
-      LOG_ERROR("Socket error in device "<<this->GetDeviceId()<<": failed to receive OpenIGTLink transforms");
+      return ClientSocketReconnect();
     }
+    LOG_ERROR("Socket error in device "<<this->GetDeviceId()<<": failed to receive OpenIGTLink transforms");
+    return PLUS_FAIL;
   }
-  if (headerMsg.IsNull())
+
+  double currentTime = vtkAccurateTimer::GetSystemTime();
+  double timeSinceLastMessageSec = currentTime - this->MessageReceiver->GetLastMessageReceiveTimestamp();
+  if (this->UseLastTransformsOnReceiveTimeout)
   {
-    // Has not received data
-    if (this->UseLastTransformsOnReceiveTimeout)
+    if (timeSinceLastMessageSec > CLIENT_SOCKET_TIMEOUT_MSEC/1000.0)
     {
       // The server only sends update if a transform is modified, it's not an error
       LOG_TRACE("No OpenIGTLink message has been received in device "<<this->GetDeviceId());
       // Store the last known transform values (useful when the server only notifies about transform changes
-      double unfilteredTimestamp = vtkAccurateTimer::GetSystemTime();
-      StoreMostRecentTransformValues(unfilteredTimestamp);
-      return PLUS_SUCCESS;
-    }
-    else
-    {
-      if (this->GetReconnectOnReceiveTimeout())
-      {
-        LOG_WARNING("No OpenIGTLink message has been received in device "<<this->GetDeviceId()<<": failed to receive OpenIGTLink transforms. Attempt to reconnect.");
-        ClientSocketReconnect();
-      }
-      else
-      {
-        LOG_WARNING("No OpenIGTLink message has been received in device "<<this->GetDeviceId());
-      }
-      return PLUS_FAIL;
+      StoreMostRecentTransformValues(currentTime);
     }
+    return PLUS_SUCCESS;
   }
 
-  // We've received valid header data
-  headerMsg->Unpack(this->IgtlMessageCrcCheckEnabled);
-  if (strcmp( headerMsg->GetDeviceType(), "TDATA" ) == 0 )
+  if (timeSinceLastMessageSec <= RECEIVE_TIMEOUT_NUMBER_OF_SOCKET_TIMEOUTS*CLIENT_SOCKET_TIMEOUT_MSEC/1000.0)
   {
-    // TDATA message
-    return ProcessTDataMessage(headerMsg);
+    this->ReceiveTimeoutReported = false;
+    return PLUS_SUCCESS;
   }
-  
-  // TRANSFORM or POSITION message
-  return ProcessTransformMessage(headerMsg);
+
+  // Has not received data
+  if (this->GetReconnectOnReceiveTimeout())
+  {
+    LOG_WARNING("No OpenIGTLink message has been received in device "<<this->GetDeviceId()<<": failed to receive OpenIGTLink transforms. Attempt to reconnect.");
+    ClientSocketReconnect();
+    return PLUS_FAIL;
+  }
+  if (!this->ReceiveTimeoutReported)
+  {
+    LOG_WARNING("No OpenIGTLink message has been received in device "<<this->GetDeviceId());
+    this->ReceiveTimeoutReported = true;
+  }
+  return PLUS_FAIL;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkOpenIGTLinkTracker::ClientSocketReconnect()
 { 
   LOG_DEBUG("Attempt to connect to client socket in device "<<this->GetDeviceId());
+
+  // Stop receiving before the socket is used for sending and closed, it is restarted after connection if recording is active
+  this->MessageReceiver->Stop();
   
   if ( this->ClientSocket->GetConnected() )
   {
@@ -320,75 +340,21 @@ PlusStatus vtkOpenIGTLinkTracker::ClientSocketReconnect()
     }
   }
 
-  return PLUS_SUCCESS;
-}
-
-//----------------------------------------------------------------------------
-PlusStatus vtkOpenIGTLinkTracker::ReceiveMessageHeader(igtl::MessageHeader::Pointer &headerMsg)
-{  
-  headerMsg = igtl::MessageHeader::New();
-  headerMsg->InitPack();
-
-  int numOfBytesReceived = 0;
-  RETRY_UNTIL_TRUE(
-    (numOfBytesReceived = this->ClientSocket->Receive( headerMsg->GetPackPointer(), headerMsg->GetPackSize() ))!=0,
-    this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
-
-  if ( numOfBytesReceived > 0)
-  {
-    // Data is received
-    if ( numOfBytesReceived != headerMsg->GetPackSize() )
-    {
-      // Received data is not as we expected
-      LOG_ERROR("Couldn't receive data from OpenIGTLink tracker (unexpected header size)"); 
-      headerMsg=NULL;
-      return PLUS_FAIL; 
-    }
-    return PLUS_SUCCESS;
-  }
-   
-  // No data has been received
-  headerMsg=NULL; // this will indicate the caller that no data has been read
-
-  bool socketError = numOfBytesReceived<0; /* -1 == SOCKET_ERROR */
-#ifdef _WIN32
-  // On Windows try to get some more details about the socket error
-  if (socketError)
-  {     
-    int socketErrorCode=WSAGetLastError();
-    if (socketErrorCode==WSAETIMEDOUT)
-    {
-      // timeout, it just means that no data was received, no need to reconnect
-      LOG_TRACE("No data coming from OpenIGTLink Tracker (timeout)");
-      socketError=false;
-    }
-    else
-    {
-      LPTSTR errorMsgPtr = 0;
-      if(FormatMessage( FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM, NULL, socketErrorCode, 0, (LPTSTR)&errorMsgPtr, 0, NULL) != 0)
-      {
-        LOG_DEBUG("No data coming from OpenIGTLink Tracker (socket error: "<<errorMsgPtr<<")");
-      }
-      else
-      {
-        LOG_DEBUG("No data coming from OpenIGTLink Tracker (unknown socket error)");
-      }
-    }
-  }
-  else
+  if ( this->Recording )
   {
-    LOG_DEBUG("No data coming from OpenIGTLink Tracker");
+    this->ReceiveTimeoutReported = false;
+    return this->MessageReceiver->Start();
   }
-#else
-  LOG_DEBUG("No data coming from OpenIGTLink Tracker");
-#endif  
-   
-  return socketError ? PLUS_FAIL : PLUS_SUCCESS;
+
+  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkOpenIGTLinkTracker::StoreMostRecentTransformValues(double unfilteredTimestamp)
 {
+  // Called from both the data capture thread (receive timeout) and the message receiver worker thread,
+  // the latest item must not change between it is read and the new item is added
+  PlusLockGuard<vtkRecursiveCriticalSection> toolUpdateGuardedLock(this->ToolUpdateMutex);
   PlusStatus status=PLUS_SUCCESS;
   // Set status for tools with non-detected markers
   for ( DataSourceContainerConstIterator it = this->GetToolIteratorBegin(); it != this->GetToolIteratorEnd(); ++it)
@@ -429,13 +395,51 @@ PlusStatus vtkOpenIGTLinkTracker::StoreMostRecentTransformValues(double unfilter
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkOpenIGTLinkTracker::ProcessTDataMessage(igtl::MessageHeader::Pointer headerMsg)
+// static
+PlusStatus vtkOpenIGTLinkTracker::ProcessReceivedMessage(igtl::MessageBase::Pointer message, double receiveTimestamp, void* clientData)
+{
+  vtkOpenIGTLinkTracker* self = static_cast<vtkOpenIGTLinkTracker*>(clientData);
+  // Not the device UpdateMutex: the data capture thread holds that while it stops the receiver on reconnect
+  PlusLockGuard<vtkRecursiveCriticalSection> toolUpdateGuardedLock(self->ToolUpdateMutex);
+  if (strcmp( message->GetDeviceType(), "TDATA" ) == 0 )
+  {
+    // TDATA message
+    return self->ProcessTDataMessage(dynamic_cast<igtl::TrackingDataMessage*>(message.GetPointer()), receiveTimestamp);
+  }
+
+  // TRANSFORM or POSITION message
+  return self->ProcessTransformMessage(message, receiveTimestamp);
+}
+
+//----------------------------------------------------------------------------
+double vtkOpenIGTLinkTracker::GetUnfilteredTimestamp(igtl::MessageBase* message, double receiveTimestamp)
+{
+  if (!this->UseReceivedTimestamps)
+  {
+    return receiveTimestamp;
+  }
+  igtl::TimeStamp::Pointer igtlTimestamp = igtl::TimeStamp::New(); 
+  message->GetTimeStamp(igtlTimestamp); 
+  double unfilteredTimestampUtc = igtlTimestamp->GetTimeStamp();  
+  if (unfilteredTimestampUtc <= 0)
+  {
+    // The sender has not set the timestamp
+    return receiveTimestamp;
+  }
+  // Use the timestamp in the OpenIGTLink message
+  // The received timestamp is in UTC and timestampts in the buffer are in system time, so conversion is needed
+  return vtkAccurateTimer::GetSystemTimeFromUniversalTime(unfilteredTimestampUtc); 
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkOpenIGTLinkTracker::ProcessTDataMessage(igtl::TrackingDataMessage* tdataMsg, double receiveTimestamp)
 {
-  igtl::TrackingDataMessage::Pointer tdataMsg = igtl::TrackingDataMessage::New();
-  tdataMsg->SetMessageHeader( headerMsg );
-  tdataMsg->AllocatePack();
+  if ( tdataMsg == NULL )
+  {
+    LOG_ERROR( "Unable to process TDATA message - message is NULL!" );
+    return PLUS_FAIL;
+  }
 
-  this->ClientSocket->Receive( tdataMsg->GetPackBodyPointer(), tdataMsg->GetPackBodySize() );
   int c = tdataMsg->Unpack( this->IgtlMessageCrcCheckEnabled );
   if ( ! ( c & igtl::MessageHeader::UNPACK_BODY ) )
   {
@@ -443,8 +447,7 @@ PlusStatus vtkOpenIGTLinkTracker::ProcessTDataMessage(igtl::MessageHeader::Point
     return PLUS_FAIL;
   }
 
-  // for now just use system time, all coordinates will be sequential.
-  double unfilteredTimestamp = vtkAccurateTimer::GetSystemTime();
+  double unfilteredTimestamp = GetUnfilteredTimestamp(tdataMsg, receiveTimestamp);
   double filteredTimestamp = unfilteredTimestamp; // No need to filter already filtered timestamped items received over OpenIGTLink 
   // We store the list of identified tools (tools we get information about from the tracker).
   // The tools that are missing from the tracker message are assumed to be out of view. 
@@ -466,11 +469,6 @@ PlusStatus vtkOpenIGTLinkTracker::ProcessTDataMessage(igtl::MessageHeader::Point
       }
     }
 
-    // Get timestamp 
-    igtl::TimeStamp::Pointer igtlTimestamp = igtl::TimeStamp::New(); 
-    tdataMsg->GetTimeStamp(igtlTimestamp); 
-    double unfilteredTimestampUtc = igtlTimestamp->GetTimeStamp();  
-
     // Get igtl transform name 
     std::string igtlTransformName = tdataElem->GetName();
 
@@ -504,24 +502,24 @@ PlusStatus vtkOpenIGTLinkTracker::ProcessTDataMessage(igtl::MessageHeader::Point
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkOpenIGTLinkTracker::ProcessTransformMessage(igtl::MessageHeader::Pointer headerMsg)
+PlusStatus vtkOpenIGTLinkTracker::ProcessTransformMessage(igtl::MessageBase::Pointer message, double receiveTimestamp)
 {
   double unfilteredTimestampUtc = 0; 
   vtkSmartPointer<vtkMatrix4x4> toolMatrix = vtkSmartPointer<vtkMatrix4x4>::New(); 
   std::string igtlTransformName; 
   
-  if (strcmp(headerMsg->GetDeviceType(), "TRANSFORM") == 0)
+  if (strcmp(message->GetDeviceType(), "TRANSFORM") == 0)
   {
-    if ( vtkPlusIgtlMessageCommon::UnpackTransformMessage(headerMsg, this->ClientSocket.GetPointer(), toolMatrix, igtlTransformName, unfilteredTimestampUtc, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS )
+    if ( vtkPlusIgtlMessageCommon::UnpackTransformMessage(dynamic_cast<igtl::TransformMessage*>(message.GetPointer()), toolMatrix, igtlTransformName, unfilteredTimestampUtc, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS )
     {
       LOG_ERROR("Couldn't receive transform message from server!"); 
       return PLUS_FAIL;
     }
   }
-  else if (strcmp(headerMsg->GetDeviceType(), "POSITION") == 0)
+  else if (strcmp(message->GetDeviceType(), "POSITION") == 0)
   {
     float position[3] = {0}; 
-    if ( vtkPlusIgtlMessageCommon::UnpackPositionMessage(headerMsg, this->ClientSocket.GetPointer(), position, igtlTransformName, unfilteredTimestampUtc, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS )
+    if ( vtkPlusIgtlMessageCommon::UnpackPositionMessage(dynamic_cast<igtl::PositionMessage*>(message.GetPointer()), position, igtlTransformName, unfilteredTimestampUtc, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS )
     {
       LOG_ERROR("Couldn't receive position message from server!"); 
       return PLUS_FAIL;
@@ -533,9 +531,9 @@ PlusStatus vtkOpenIGTLinkTracker::ProcessTransformMessage(igtl::MessageHeader::P
   }
   else
   {
-    // if the data type is unknown, skip reading. 
-    this->ClientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
-    return PLUS_SUCCESS; 
+    // Only the accepted message types are received
+    LOG_ERROR("Unexpected OpenIGTLink message type: " << message->GetDeviceType());
+    return PLUS_FAIL; 
   }
 
   // Set transform name
@@ -546,17 +544,7 @@ PlusStatus vtkOpenIGTLinkTracker::ProcessTransformMessage(igtl::MessageHeader::P
     return PLUS_FAIL; 
   }
     
-  double unfilteredTimestamp = 0;
-  if (this->UseReceivedTimestamps)
-  {
-    // Use the timestamp in the OpenIGTLink message
-    // The received timestamp is in UTC and timestampts in the buffer are in system time, so conversion is needed
-    unfilteredTimestamp = vtkAccurateTimer::GetSystemTimeFromUniversalTime(unfilteredTimestampUtc); 
-  }
-  else
-  {
-    unfilteredTimestamp = vtkAccurateTimer::GetSystemTime();
-  }  
+  double unfilteredTimestamp = GetUnfilteredTimestamp(message, receiveTimestamp);
 
   // No need to filter already filtered timestamped items received over OpenIGTLink 
   // If the original timestamps are not used it's still safer not to use filtering, as filtering assumes uniform framerate, which is not guaranteed
@@ -12,10 +12,21 @@
 #include "igtlClientSocket.h"
 #include "igtlMessageBase.h"
 
+class vtkPlusIgtlMessageReceiver;
+class vtkRecursiveCriticalSection;
+namespace igtl
+{
+  class TrackingDataMessage;
+}
+
 /*!
 \class vtkOpenIGTLinkTracker 
 \brief OpenIGTLink tracker client  
 
+The messages are received on a dedicated thread and unpacked and added to the buffers on a worker thread
+(see vtkPlusIgtlMessageReceiver), so the receiving is not limited by the acquisition rate.
+The data capture thread only handles the socket errors and the receive timeouts.
+
 \ingroup PlusLibDataCollection
 */
 class VTK_EXPORT vtkOpenIGTLinkTracker : public vtkPlusDevice
@@ -96,23 +107,26 @@ protected:
   /*! Reconnect the client socket. Used when the connection is established or there is a socket error. */
   PlusStatus ClientSocketReconnect();
 
-  /*!
-    Receive an OpenITGLink message header.
-    Returns PLUS_FAIL if there was a socket error.
-    The headerMsg is NULL is no data is received.
-  */
-  PlusStatus ReceiveMessageHeader(igtl::MessageHeader::Pointer &headerMsg);
+  /*! Process a received message, called by the message receiver from its worker thread */
+  static PlusStatus ProcessReceivedMessage(igtl::MessageBase::Pointer message, double receiveTimestamp, void* clientData);
 
   /*! Process a TRANSFORM or POSITION message (add the received transform to the buffer) */
-  PlusStatus ProcessTransformMessage(igtl::MessageHeader::Pointer headerMsg);
+  PlusStatus ProcessTransformMessage(igtl::MessageBase::Pointer message, double receiveTimestamp);
 
   /*! Process a TDATA message (add all the received transforms to the buffers) */
-  PlusStatus ProcessTDataMessage(igtl::MessageHeader::Pointer headerMsg);
+  PlusStatus ProcessTDataMessage(igtl::TrackingDataMessage* tdataMsg, double receiveTimestamp);
+
+  /*!
+    Get the timestamp of the received data in system time: the timestamp embedded in the message if UseReceivedTimestamps
+    is enabled and the message has a timestamp, otherwise the time of reception
+  */
+  double GetUnfilteredTimestamp(igtl::MessageBase* message, double receiveTimestamp);
 
   /*!
     Store the latest transforms again in the buffers with the provided timestamp.
     If no transforms are defined then identity transform will be stored.
     If there is a transform defined already with the same timestamp then it will not be overwritten.
+    The tool buffers are updated under ToolUpdateMutex, so it can be called from any thread.
   */
   PlusStatus StoreMostRecentTransformValues(double unfilteredTimestamp);
 
@@ -140,6 +154,18 @@ protected:
   /*! OpenIGTLink client socket */ 
   igtl::ClientSocket::Pointer ClientSocket;
 
+  /*! Receives the messages from the client socket and processes them on a worker thread */
+  vtkPlusIgtlMessageReceiver* MessageReceiver;
+
+  /*!
+    Serializes the tool buffer updates of the message receiver worker thread and the re-storing of the
+    last transforms on the data capture thread (see UseLastTransformsOnReceiveTimeout)
+  */
+  vtkRecursiveCriticalSection* ToolUpdateMutex;
+
+  /*! True if the missing messages have been reported already (it is reset when a message is received) */
+  bool ReceiveTimeoutReported;
+
   /*! Attempt a reconnection if no data is received */
   bool ReconnectOnReceiveTimeout;
 
@@ -16,6 +16,7 @@ See License.txt for details.
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusIgtlMessageCommon.h"
+#include "vtkPlusIgtlMessageReceiver.h"
 #include "vtkPlusBuffer.h"
 #include "vtksys/SystemTools.hxx"
 
@@ -23,6 +24,8 @@ See License.txt for details.
 #include <string>
 
 static const int CLIENT_SOCKET_TIMEOUT_MSEC = 500; 
+// If no message is received for this many socket timeouts then the server is considered to be disconnected
+static const int RECEIVE_TIMEOUT_NUMBER_OF_SOCKET_TIMEOUTS = 10;
 
 vtkCxxRevisionMacro(vtkOpenIGTLinkVideoSource, "$Revision: 1.0$");
 vtkStandardNewMacro(vtkOpenIGTLinkVideoSource);
@@ -35,6 +38,11 @@ vtkOpenIGTLinkVideoSource::vtkOpenIGTLinkVideoSource()
   this->ServerPort = -1; 
   this->IgtlMessageCrcCheckEnabled = 0; 
   this->ClientSocket = igtl::ClientSocket::New(); 
+  this->MessageReceiver = vtkPlusIgtlMessageReceiver::New();
+  this->MessageReceiver->SetSocket(this->ClientSocket);
+  this->MessageReceiver->SetMessageHandler(&vtkOpenIGTLinkVideoSource::ProcessReceivedMessage, this);
+  this->MessageReceiver->AddAcceptedMessageType("IMAGE", (vtkPlusIgtlMessageFactory::PointerToMessageBaseNew)&igtl::ImageMessage::New);
+  this->MessageReceiver->AddAcceptedMessageType("TRACKEDFRAME", (vtkPlusIgtlMessageFactory::PointerToMessageBaseNew)&igtl::PlusTrackedFrameMessage::New);
   this->NumberOfRetryAttempts = 10; 
   this->DelayBetweenRetryAttemptsSec = 0.100; // there is already a delay with a CLIENT_SOCKET_TIMEOUT_MSEC timeout, so we just add a little extra idle delay
 
@@ -46,7 +54,7 @@ vtkOpenIGTLinkVideoSource::vtkOpenIGTLinkVideoSource()
   this->RequireUsImageOrientationInDeviceSetConfiguration = true;
   this->RequireRfElementInDeviceSetConfiguration = false;
 
-  // No callback function provided by the device, so the data capture thread will be used to poll the hardware and add new items to the buffer
+  // The frames are added to the buffer by the message receiver, the data capture thread is used for handling the socket errors and receive timeouts
   this->StartThreadForInternalUpdates=true;
 }
 
@@ -57,6 +65,8 @@ vtkOpenIGTLinkVideoSource::~vtkOpenIGTLinkVideoSource()
   {
     this->Disconnect();
   }
+  this->MessageReceiver->Stop();
+  DELETE_IF_NOT_NULL(this->MessageReceiver);
 }
 
 //----------------------------------------------------------------------------
@@ -92,6 +102,22 @@ PlusStatus vtkOpenIGTLinkVideoSource::InternalConnect()
     return PLUS_SUCCESS; 
   }
 
+  return ClientSocketReconnect();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkOpenIGTLinkVideoSource::ClientSocketReconnect()
+{
+  LOG_DEBUG("Attempt to connect to client socket in device "<<this->GetDeviceId());
+
+  // Stop receiving before the socket is used for sending and closed, it is restarted after connection if recording is active
+  this->MessageReceiver->Stop();
+
+  if ( this->ClientSocket->GetConnected() )
+  {
+    this->ClientSocket->CloseSocket();  
+  }
+
   if ( this->ServerAddress == NULL )
   {
     LOG_ERROR("Unable to connect OpenIGTLink server - server address is undefined" ); 
@@ -155,12 +181,19 @@ PlusStatus vtkOpenIGTLinkVideoSource::InternalConnect()
       return PLUS_FAIL; 
     }
   }
+
+  if ( this->Recording )
+  {
+    return this->MessageReceiver->Start();
+  }
+
   return PLUS_SUCCESS; 
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkOpenIGTLinkVideoSource::InternalDisconnect()
 {
+  this->MessageReceiver->Stop();
   this->ClientSocket->CloseSocket(); 
   return this->StopRecording();
 }
@@ -174,7 +207,21 @@ PlusStatus vtkOpenIGTLinkVideoSource::InternalStartRecording()
     return PLUS_SUCCESS;
   }
 
-  return this->Connect(); 
+  if ( this->Connect() != PLUS_SUCCESS )
+  {
+    return PLUS_FAIL;
+  }
+
+  return this->MessageReceiver->Start(); 
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkOpenIGTLinkVideoSource::InternalStopRecording()
+{
+  LOG_TRACE( "vtkOpenIGTLinkVideoSource::InternalStopRecording" ); 
+
+  this->MessageReceiver->Stop();
+  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
@@ -182,49 +229,42 @@ PlusStatus vtkOpenIGTLinkVideoSource::InternalUpdate()
 {
   if (!this->Recording)
   {
-    // drop the frame, we are not recording data now
+    // we are not recording data now
     return PLUS_SUCCESS;
   }
 
-  igtl::MessageHeader::Pointer headerMsg;
-  headerMsg = igtl::MessageHeader::New();
-  headerMsg->InitPack();
-
-  int numOfBytesReceived = 0;
-  RETRY_UNTIL_TRUE( 
-    (numOfBytesReceived = this->ClientSocket->Receive( headerMsg->GetPackPointer(), headerMsg->GetPackSize()))!=0,
-    this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
-
-  if( numOfBytesReceived == -1 )
-  {
-    this->ClientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
-    return PLUS_SUCCESS; 
-  }
-
-  if ( numOfBytesReceived == 0 ) 
+  // The received frames are added to the buffer by the message receiver threads,
+  // only the socket errors and the receive timeouts are handled here
+  double timeSinceLastMessageSec = vtkAccurateTimer::GetSystemTime() - this->MessageReceiver->GetLastMessageReceiveTimestamp();
+  if ( this->MessageReceiver->GetSocketError() || timeSinceLastMessageSec > RECEIVE_TIMEOUT_NUMBER_OF_SOCKET_TIMEOUTS*CLIENT_SOCKET_TIMEOUT_MSEC/1000.0 )
   {
     // No message received - server disconnected 
     LOG_ERROR("OpenIGTLink video source connection lost with server - try to reconnect!");
-    this->Connected = 0; 
-    this->ClientSocket->CloseSocket(); 
-    return this->Connect();
+    return ClientSocketReconnect();
   }
-  
-  headerMsg->Unpack(this->IgtlMessageCrcCheckEnabled);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// static
+PlusStatus vtkOpenIGTLinkVideoSource::ProcessReceivedMessage(igtl::MessageBase::Pointer message, double receiveTimestamp, void* clientData)
+{
+  vtkOpenIGTLinkVideoSource* self = static_cast<vtkOpenIGTLinkVideoSource*>(clientData);
 
   TrackedFrame trackedFrame;
 
-  if (strcmp(headerMsg->GetDeviceType(), "IMAGE") == 0)
+  if (strcmp(message->GetDeviceType(), "IMAGE") == 0)
   {      
-    if (vtkPlusIgtlMessageCommon::UnpackImageMessage( headerMsg, this->ClientSocket, trackedFrame, this->ImageMessageEmbeddedTransformName, this->IgtlMessageCrcCheckEnabled)!=PLUS_SUCCESS)
+    if (vtkPlusIgtlMessageCommon::UnpackImageMessage( dynamic_cast<igtl::ImageMessage*>(message.GetPointer()), trackedFrame, self->ImageMessageEmbeddedTransformName, self->IgtlMessageCrcCheckEnabled)!=PLUS_SUCCESS)
     {
       LOG_ERROR("Couldn't get image from OpenIGTLink server!"); 
       return PLUS_FAIL;
     }
   }
-  else if (strcmp(headerMsg->GetDeviceType(), "TRACKEDFRAME") == 0)
+  else if (strcmp(message->GetDeviceType(), "TRACKEDFRAME") == 0)
   {
-    if ( vtkPlusIgtlMessageCommon::UnpackTrackedFrameMessage( headerMsg, this->ClientSocket, trackedFrame, this->IgtlMessageCrcCheckEnabled ) != PLUS_SUCCESS )
+    if ( vtkPlusIgtlMessageCommon::UnpackTrackedFrameMessage( dynamic_cast<igtl::PlusTrackedFrameMessage*>(message.GetPointer()), trackedFrame, self->IgtlMessageCrcCheckEnabled ) != PLUS_SUCCESS )
     {
       LOG_ERROR("Couldn't get tracked frame from OpenIGTLink server!"); 
       return PLUS_FAIL; 
@@ -232,21 +272,26 @@ PlusStatus vtkOpenIGTLinkVideoSource::InternalUpdate()
   }
   else
   {
-    // if the data type is unknown, skip reading. 
-    this->ClientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
-    return PLUS_SUCCESS; 
+    // Only the accepted message types are received
+    LOG_ERROR("Unexpected OpenIGTLink message type: " << message->GetDeviceType());
+    return PLUS_FAIL; 
   }
 
   // Set unfiltered and filtered timestamp by converting UTC to system timestamp
-  double unfilteredTimestamp = vtkAccurateTimer::GetSystemTimeFromUniversalTime(trackedFrame.GetTimestamp());  
+  // If the sender has not set the timestamp then the time of reception is used
+  double unfilteredTimestamp = receiveTimestamp;
+  if ( trackedFrame.GetTimestamp() > 0 )
+  {
+    unfilteredTimestamp = vtkAccurateTimer::GetSystemTimeFromUniversalTime(trackedFrame.GetTimestamp());  
+  }
   double filteredTimestamp = unfilteredTimestamp;  
 
   // The timestamps are already defined, so we don't need to filter them, 
   // for simplicity, we increase frame number always by 1.
-  this->FrameNumber++;
+  self->FrameNumber++;
 
   vtkPlusDataSource* aSource=NULL;
-  if( this->GetFirstActiveOutputVideoSource(aSource) != PLUS_SUCCESS )
+  if( self->GetFirstActiveOutputVideoSource(aSource) != PLUS_SUCCESS )
   {
     LOG_ERROR("Unable to retrieve the video source in the OpenIGTLinkVideo device.");
     return PLUS_FAIL;
@@ -267,8 +312,8 @@ PlusStatus vtkOpenIGTLinkVideoSource::InternalUpdate()
     aSource->GetBuffer()->SetFrameSize( trackedFrame.GetFrameSize() );
   }
   TrackedFrame::FieldMapType customFields=trackedFrame.GetCustomFields();
-  PlusStatus status = aSource->GetBuffer()->AddItem( trackedFrame.GetImageData(), this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &customFields); 
-  this->Modified();
+  PlusStatus status = aSource->GetBuffer()->AddItem( trackedFrame.GetImageData(), self->FrameNumber, unfilteredTimestamp, filteredTimestamp, &customFields); 
+  self->Modified();
 
   return status;
 }
@@ -10,8 +10,10 @@
 #include "PlusConfigure.h"
 #include "vtkPlusDevice.h"
 #include "igtlClientSocket.h"
+#include "igtlMessageBase.h"
 
 class VTK_EXPORT vtkOpenIGTLinkVideoSource;
+class vtkPlusIgtlMessageReceiver;
 
 /*!
   \class vtkOpenIGTLinkVideoSource 
@@ -19,6 +21,10 @@ class VTK_EXPORT vtkOpenIGTLinkVideoSource;
 
   vtkOpenIGTLinkVideoSource is a class for providing video input interfaces between VTK and OpenIGTLink ready video device. 
 
+  The messages are received on a dedicated thread and unpacked and added to the buffer on a worker thread
+  (see vtkPlusIgtlMessageReceiver), so the receiving is not limited by the acquisition rate.
+  The data capture thread only handles the socket errors and the receive timeouts.
+
   \ingroup PlusLibDataCollection
 */ 
 class VTK_EXPORT vtkOpenIGTLinkVideoSource : public vtkPlusDevice
@@ -77,9 +83,18 @@ protected:
   */
   virtual PlusStatus InternalStartRecording(); 
 
-  /*! The internal function which actually does the grab.  */
+  /*! Called at the end of StopRecording to stop receiving the messages */
+  virtual PlusStatus InternalStopRecording(); 
+
+  /*! Handle the socket errors and the receive timeouts. The frames are added to the buffer by the message receiver. */
   PlusStatus InternalUpdate();
 
+  /*! Reconnect the client socket after a socket error or receive timeout */
+  PlusStatus ClientSocketReconnect();
+
+  /*! Process a received IMAGE or TRACKEDFRAME message (add the frame to the buffer), called by the message receiver from its worker thread */
+  static PlusStatus ProcessReceivedMessage(igtl::MessageBase::Pointer message, double receiveTimestamp, void* clientData);
+
   /*! OpenIGTLink message type */
   char* MessageType; 
 
@@ -101,6 +116,9 @@ protected:
   /*! OpenIGTLink client socket */ 
   igtl::ClientSocket::Pointer ClientSocket;
 
+  /*! Receives the messages from the client socket and processes them on a worker thread */
+  vtkPlusIgtlMessageReceiver* MessageReceiver;
+
   /*! Name of the transform that is supplied with the IMAGE OpenIGTLink message */ 
   PlusTransformName ImageMessageEmbeddedTransformName;
     
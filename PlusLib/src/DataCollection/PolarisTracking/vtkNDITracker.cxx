@@ -71,6 +71,8 @@ vtkNDITracker::vtkNDITracker()
   this->SerialPort = -1; // default is to probe
   this->SerialDevice = 0;
   this->BaudRate = 9600;
+  this->UseBinaryReply = false;
+  this->PipelinedPolling = false;
 
   for (int i = 0; i < VTK_NDI_NTOOLS; i++)
   {
@@ -405,6 +407,12 @@ PlusStatus vtkNDITracker::InternalStartRecording()
   }
   this->EnableToolPorts();
 
+  if (this->PipelinedPolling)
+  {
+    // the tracking data requests will be sent by the thread as soon as tracking is started
+    ndiSetThreadMode(this->Device, 1);
+  }
+
   ndiCommand(this->Device,"TSTART:");
 
   errnum = ndiGetError(this->Device);
@@ -526,7 +534,14 @@ PlusStatus vtkNDITracker::InternalUpdate()
   }
 
   // get the transforms for all tools from the NDI
-  ndiCommand(this->Device,"TX:0801");
+  if (this->UseBinaryReply)
+  {
+    ndiCommand(this->Device,"BX:0801");
+  }
+  else
+  {
+    ndiCommand(this->Device,"TX:0801");
+  }
   errnum = ndiGetError(this->Device);
 
   if (errnum)
@@ -554,9 +569,18 @@ PlusStatus vtkNDITracker::InternalUpdate()
       continue;
     }
 
-    absent[tool] = ndiGetTXTransform(this->Device, ph, transform[tool]);
-    status[tool] = ndiGetTXPortStatus(this->Device, ph);
-    frame[tool] = ndiGetTXFrame(this->Device, ph);
+    if (this->UseBinaryReply)
+    {
+      absent[tool] = ndiGetBXTransform(this->Device, ph, transform[tool]);
+      status[tool] = ndiGetBXPortStatus(this->Device, ph);
+      frame[tool] = ndiGetBXFrame(this->Device, ph);
+    }
+    else
+    {
+      absent[tool] = ndiGetTXTransform(this->Device, ph, transform[tool]);
+      status[tool] = ndiGetTXPortStatus(this->Device, ph);
+      frame[tool] = ndiGetTXFrame(this->Device, ph);
+    }
     if (!absent[tool] && frame[tool] > nextcount)
     { // 'nextcount' is max frame number returned
       nextcount = frame[tool];
@@ -578,7 +602,8 @@ PlusStatus vtkNDITracker::InternalUpdate()
   const double unfilteredTimestamp = vtkAccurateTimer::GetSystemTime();
 
   // check to see if any tools have been plugged in
-  if (ndiGetTXSystemStatus(this->Device) & NDI_PORT_OCCUPIED)
+  int systemStatus = this->UseBinaryReply ? ndiGetBXSystemStatus(this->Device) : ndiGetTXSystemStatus(this->Device);
+  if (systemStatus & NDI_PORT_OCCUPIED)
   { // re-configure, a new tool has been plugged in
     this->EnableToolPorts();
   }
@@ -1383,6 +1408,18 @@ PlusStatus vtkNDITracker::ReadConfiguration(vtkXMLDataElement* config)
     this->BaudRate=baudRate; 
   } 
 
+  const char* useBinaryReply = trackerConfig->GetAttribute("UseBinaryReply");
+  if ( useBinaryReply != NULL )
+  {
+    this->UseBinaryReply = STRCASECMP(useBinaryReply, "TRUE") == 0;
+  }
+
+  const char* pipelinedPolling = trackerConfig->GetAttribute("PipelinedPolling");
+  if ( pipelinedPolling != NULL )
+  {
+    this->PipelinedPolling = STRCASECMP(pipelinedPolling, "TRUE") == 0;
+  }
+
   // Read ROM files for tools
   vtkXMLDataElement* dataSourcesElement = trackerConfig->FindNestedElementWithName("DataSources");
   if( dataSourcesElement == NULL )
@@ -1465,5 +1502,9 @@ PlusStatus vtkNDITracker::WriteConfiguration(vtkXMLDataElement* config)
 
   trackerConfig->SetIntAttribute("BaudRate", this->BaudRate );
 
+  trackerConfig->SetAttribute("UseBinaryReply", this->UseBinaryReply ? "TRUE" : "FALSE" );
+
+  trackerConfig->SetAttribute("PipelinedPolling", this->PipelinedPolling ? "TRUE" : "FALSE" );
+
   return PLUS_SUCCESS;
 }
@@ -117,6 +117,21 @@ public:
   vtkSetMacro(BaudRate, int);
   vtkGetMacro(BaudRate, int);
 
+  /*!
+    Request the tool transforms with the binary BX command instead of the TX command.
+    The binary reply is shorter and it is decoded without parsing text.  Default: false.
+  */
+  vtkSetMacro(UseBinaryReply, bool);
+  vtkGetMacro(UseBinaryReply, bool);
+
+  /*!
+    Keep the next tracking data request in flight while the previous reply is processed.
+    The NDI library resends the request from a background thread as soon as a reply
+    arrives, and each update uses the latest reply.  Default: false.
+  */
+  vtkSetMacro(PipelinedPolling, bool);
+  vtkGetMacro(PipelinedPolling, bool);
+
   /*!
     Enable a passive tool by uploading a virtual SROM for that
     tool, where 'tool' is a number between 0 and 5.
@@ -214,6 +229,11 @@ protected:
   int BaudRate;
   int IsDeviceTracking;
 
+  /*! Use the binary BX command for reading the tool transforms */
+  bool UseBinaryReply;
+  /*! Send the tracking data requests from the background thread of the NDI library */
+  bool PipelinedPolling;
+
   int PortEnabled[VTK_NDI_NTOOLS];
   int PortHandle[VTK_NDI_NTOOLS];
   unsigned char *VirtualSROM[VTK_NDI_NTOOLS];
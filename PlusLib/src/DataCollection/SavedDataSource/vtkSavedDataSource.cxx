@@ -6,10 +6,13 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "vtkImageData.h"
+#include "vtkMatrix4x4.h"
+#include "vtkMetaImageSequenceIO.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusBuffer.h"
+#include "vtkRecursiveCriticalSection.h"
 #include "vtkSavedDataSource.h"
 #include "vtkTrackedFrameList.h"
 #include "vtksys/SystemTools.hxx"
@@ -17,6 +20,9 @@ See License.txt for details.
 vtkCxxRevisionMacro(vtkSavedDataSource, "$Revision: 1.0$");
 vtkStandardNewMacro(vtkSavedDataSource);
 
+// Delay of the prefetch thread when all the frames in the prefetch window are already read
+static const double PREFETCH_IDLE_DELAY_SEC = 0.005;
+
 //----------------------------------------------------------------------------
 vtkSavedDataSource::vtkSavedDataSource()
 {
@@ -33,6 +39,17 @@ vtkSavedDataSource::vtkSavedDataSource()
   this->LoopFirstFrameUid=0;
   this->LoopLastFrameUid=0;
   this->SimulatedStream=VIDEO_STREAM;
+  this->StreamingPlayback=false;
+  this->PrefetchWindowSize=30;
+  this->StreamingReader=NULL;
+  this->StreamingReaderMutex=vtkRecursiveCriticalSection::New();
+  this->StreamedFramesFirstUid=0;
+  this->PrefetchNextPosition=0;
+  this->PrefetchGeneration=0;
+  this->PrefetchMutex=vtkRecursiveCriticalSection::New();
+  this->NumberOfPrefetchMisses=0;
+  this->PrefetchThreadActive=false;
+  this->PrefetchThreadAlive=false;
 
   this->RequireFrameBufferSizeInDeviceSetConfiguration = false; // was true for tracker
   this->RequireToolAveragedItemsForFilteringInDeviceSetConfiguration = false; // was true for tracker
@@ -54,7 +71,11 @@ vtkSavedDataSource::~vtkSavedDataSource()
   {
     this->Disconnect();
   }
+  StopPrefetchThread();
+  CloseStreamingReader();
   DeleteLocalBuffers();
+  DELETE_IF_NOT_NULL(this->StreamingReaderMutex);
+  DELETE_IF_NOT_NULL(this->PrefetchMutex);
 }
 
 //----------------------------------------------------------------------------
@@ -174,12 +195,13 @@ PlusStatus vtkSavedDataSource::InternalUpdateOriginalTimestamp(BufferItemUidType
     {
     case VIDEO_STREAM:
       {            
+        PlusVideoFrame* frame=NULL;
         StreamBufferItem::FieldMapType fieldMap;
-        if (this->UseAllFrameFields)
+        if (GetVideoFrameToBeAdded(dataBufferItemToBeAdded, frameToBeAddedUid, frameToBeAddedLoopIndex, frame, fieldMap)!=PLUS_SUCCESS)
         {
-          fieldMap = dataBufferItemToBeAdded.GetCustomFrameFieldMap();    
+          status=PLUS_FAIL;
         }
-        if (this->GetOutputBuffer()->AddItem(&(dataBufferItemToBeAdded.GetFrame()), this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &fieldMap)==PLUS_FAIL)
+        else if (this->GetOutputBuffer()->AddItem(frame, this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &fieldMap)==PLUS_FAIL)
         {
           status=PLUS_FAIL;
         }  
@@ -277,12 +299,13 @@ PlusStatus vtkSavedDataSource::InternalUpdateCurrentTimestamp(BufferItemUidType
   {
   case VIDEO_STREAM:
     {            
+      PlusVideoFrame* frame=NULL;
       StreamBufferItem::FieldMapType fieldMap;
-      if (this->UseAllFrameFields)
+      if (GetVideoFrameToBeAdded(dataBufferItemToBeAdded, frameToBeAddedUid, frameToBeAddedLoopIndex, frame, fieldMap)!=PLUS_SUCCESS)
       {
-        fieldMap = dataBufferItemToBeAdded.GetCustomFrameFieldMap();    
-      }        
-      if (this->GetOutputBuffer()->AddItem(&(dataBufferItemToBeAdded.GetFrame()), this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &fieldMap)!=PLUS_SUCCESS) // UNDEFINED_TIMESTAMP => use current timestamp
+        status=PLUS_FAIL;
+      }
+      else if (this->GetOutputBuffer()->AddItem(frame, this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &fieldMap)!=PLUS_SUCCESS) // UNDEFINED_TIMESTAMP => use current timestamp
       {
         status=PLUS_FAIL;
       }
@@ -379,13 +402,24 @@ PlusStatus vtkSavedDataSource::InternalConnect()
     return PLUS_FAIL; 
   }
 
-  vtkSmartPointer<vtkTrackedFrameList> savedDataBuffer = vtkSmartPointer<vtkTrackedFrameList>::New(); 
+  StopPrefetchThread();
+  CloseStreamingReader();
 
-  // Read metafile
-  if ( savedDataBuffer->ReadFromSequenceMetafile(this->SequenceMetafile) != PLUS_SUCCESS )
+  vtkSmartPointer<vtkTrackedFrameList> savedDataBuffer;
+  if (this->StreamingPlayback && OpenStreamingReader()==PLUS_SUCCESS)
   {
-    LOG_ERROR("Failed to read video buffer from sequence metafile: "<<this->SequenceMetafile); 
-    return PLUS_FAIL; 
+    // Only the header (and the first frame) is read now, the frames are read from the file during playback
+    savedDataBuffer = this->StreamingReader->GetTrackedFrameList();
+  }
+  else
+  {
+    // Read metafile
+    savedDataBuffer = vtkSmartPointer<vtkTrackedFrameList>::New(); 
+    if ( savedDataBuffer->ReadFromSequenceMetafile(this->SequenceMetafile) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to read video buffer from sequence metafile: "<<this->SequenceMetafile); 
+      return PLUS_FAIL; 
+    }
   }
 
   if ( savedDataBuffer->GetNumberOfTrackedFrames() < 1 ) 
@@ -457,6 +491,19 @@ PlusStatus vtkSavedDataSource::InternalConnect()
   this->LastAddedFrameUid=this->LoopFirstFrameUid-1;
   this->LastAddedLoopIndex=0;
 
+  if (this->StreamingReader!=NULL)
+  {
+    if (this->SimulatedStream==VIDEO_STREAM)
+    {
+      StartPrefetchThread();
+    }
+    else
+    {
+      // Only the frame fields are needed for replaying tracking data, they are already copied into the local buffers
+      CloseStreamingReader();
+    }
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -509,6 +556,19 @@ PlusStatus vtkSavedDataSource::InternalConnectVideo(vtkTrackedFrameList* savedDa
 
   // Set up a new local buffer
   DeleteLocalBuffers();
+
+  if (this->StreamingReader!=NULL)
+  {
+    // Streaming playback: the local buffer only stores the timestamps, images are read from the file during playback
+    if (CreateStreamingLocalVideoBuffer(savedDataBuffer)!=PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    this->GetOutputBuffer()->Clear();
+    this->GetOutputBuffer()->SetPixelType( savedDataBuffer->GetTrackedFrame(0)->GetImageData()->GetVTKScalarPixelType() ); 
+    return PLUS_SUCCESS;
+  }
+
   this->LocalVideoBuffer = vtkPlusBuffer::New(); 
   
   // Copy all the settings from the video buffer 
@@ -592,6 +652,8 @@ PlusStatus vtkSavedDataSource::InternalConnectTracker(vtkTrackedFrameList* saved
 //----------------------------------------------------------------------------
 PlusStatus vtkSavedDataSource::InternalDisconnect()
 {
+  StopPrefetchThread();
+  CloseStreamingReader();
   DeleteLocalBuffers();
   return PLUS_SUCCESS;
 }
@@ -708,6 +770,35 @@ PlusStatus vtkSavedDataSource::ReadConfiguration(vtkXMLDataElement* config)
     }
   }
 
+  const char* streamingPlayback = imageAcquisitionConfig->GetAttribute("StreamingPlayback"); 
+  if ( streamingPlayback != NULL ) 
+  {
+    if ( STRCASECMP("TRUE", streamingPlayback ) == 0 )
+    {
+      this->StreamingPlayback = true; 
+    }
+    else if ( STRCASECMP("FALSE", streamingPlayback ) == 0 )
+    {
+      this->StreamingPlayback = false; 
+    }
+    else
+    {
+      LOG_WARNING("Unable to recognize StreamingPlayback attribute: " << streamingPlayback << " - changed to false by default!"); 
+      this->StreamingPlayback = false; 
+    }
+  }
+
+  int prefetchWindowSize=0;
+  if ( imageAcquisitionConfig->GetScalarAttribute("PrefetchWindowSize", prefetchWindowSize) )
+  {
+    if ( prefetchWindowSize < 1 )
+    {
+      LOG_WARNING("Invalid PrefetchWindowSize attribute: " << prefetchWindowSize << " - at least one frame is read ahead");
+      prefetchWindowSize = 1;
+    }
+    this->PrefetchWindowSize = prefetchWindowSize;
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -768,6 +859,16 @@ PlusStatus vtkSavedDataSource::WriteConfiguration(vtkXMLDataElement* config)
     imageAcquisitionConfig->SetAttribute("UseOriginalTimestamps", "FALSE");
   }
 
+  if (this->StreamingPlayback)
+  {
+    imageAcquisitionConfig->SetAttribute("StreamingPlayback", "TRUE");
+  }
+  else
+  {
+    imageAcquisitionConfig->SetAttribute("StreamingPlayback", "FALSE");
+  }
+  imageAcquisitionConfig->SetIntAttribute("PrefetchWindowSize", this->PrefetchWindowSize);
+
   return PLUS_SUCCESS;
 }
 
@@ -819,6 +920,8 @@ void vtkSavedDataSource::GetLoopTimeRange(double& loopStartTime, double& loopSto
 //-----------------------------------------------------------------------------
 void vtkSavedDataSource::SetLoopTimeRange(double loopStartTime, double loopStopTime)
 {
+  // The loop range is used by the prefetch thread as well
+  PlusLockGuard<vtkRecursiveCriticalSection> prefetchGuardedLock(this->PrefetchMutex);
   this->LoopStartTime_Local=loopStartTime;
   this->LoopStopTime_Local=loopStopTime;
 
@@ -827,6 +930,9 @@ void vtkSavedDataSource::SetLoopTimeRange(double loopStartTime, double loopStopT
 
   this->LastAddedFrameUid=this->LoopFirstFrameUid-1;
   this->LastAddedLoopIndex=0;  
+
+  // Playback positions of the prefetched frames are relative to the loop start
+  ResetPrefetchedFrames();
 }
 
 //----------------------------------------------------------------------------
@@ -1008,3 +1114,343 @@ bool vtkSavedDataSource::IsTracker() const
 
   return false;
 }
+
+//----------------------------------------------------------------------------
+PlusStatus vtkSavedDataSource::GetVideoFrameToBeAdded(StreamBufferItem& localBufferItem, BufferItemUidType frameUid, int loopIndex, PlusVideoFrame*& frame, StreamBufferItem::FieldMapType& fieldMap)
+{
+  if (this->StreamingReader==NULL)
+  {
+    // The whole sequence is loaded into the local buffer
+    frame=&(localBufferItem.GetFrame());
+    if (this->UseAllFrameFields)
+    {
+      fieldMap = localBufferItem.GetCustomFrameFieldMap();    
+    }
+    return PLUS_SUCCESS;
+  }
+
+  if (GetStreamedFrame(frameUid, loopIndex)!=PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  frame=&(this->StreamedFrame);
+
+  if (this->UseAllFrameFields)
+  {
+    // Frame fields are kept in memory in the tracked frame list of the reader (only the pixel data is read during playback)
+    TrackedFrame* trackedFrame=this->StreamingReader->GetTrackedFrameList()->GetTrackedFrame(this->StreamedFrameIndexes[frameUid-this->StreamedFramesFirstUid]);
+    const StreamBufferItem::FieldMapType& sourceCustomFields = trackedFrame->GetCustomFields();
+    for (StreamBufferItem::FieldMapType::const_iterator fieldIterator = sourceCustomFields.begin(); fieldIterator != sourceCustomFields.end(); ++fieldIterator)
+    {
+      // skip special fields (same as in vtkPlusBuffer::CopyImagesFromTrackedFrameList)
+      if (fieldIterator->first.compare("TimeStamp")==0) { continue; }
+      if (fieldIterator->first.compare("UnfilteredTimestamp")==0) { continue; }
+      if (fieldIterator->first.compare("FrameNumber")==0) { continue; }
+      if (fieldIterator->first.compare("ImageStatus")==0) { continue; }
+      fieldMap[fieldIterator->first]=fieldIterator->second;
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkSavedDataSource::OpenStreamingReader()
+{
+  CloseStreamingReader();
+
+  PlusLockGuard<vtkRecursiveCriticalSection> readerGuardedLock(this->StreamingReaderMutex);
+  this->StreamingReader=vtkMetaImageSequenceIO::New();
+  this->StreamingReader->SetFileName(this->SequenceMetafile);
+  if (this->StreamingReader->ReadHeader()!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read the header of sequence metafile: "<<this->SequenceMetafile);
+    CloseStreamingReader();
+    return PLUS_FAIL;
+  }
+
+  vtkTrackedFrameList* savedDataBuffer=this->StreamingReader->GetTrackedFrameList();
+  if (this->SimulatedStream==TRACKER_STREAM || savedDataBuffer->GetNumberOfTrackedFrames()<1)
+  {
+    // Only the frame fields are needed for replaying tracking data, they are all in the header
+    // (if there are no frames then the caller reports the error)
+    return PLUS_SUCCESS;
+  }
+
+  int* dimensions=this->StreamingReader->GetDimensions();
+  if (dimensions[0]<=0 || dimensions[1]<=0)
+  {
+    LOG_WARNING("Sequence metafile "<<this->SequenceMetafile<<" contains no image data, streaming playback is not used");
+    CloseStreamingReader();
+    return PLUS_FAIL;
+  }
+
+  if (!this->StreamingReader->CanReadFramePixels())
+  {
+    LOG_WARNING("Frames of sequence metafile "<<this->SequenceMetafile<<" cannot be read individually (pixel data is compressed), the whole sequence is loaded into memory instead of streaming playback");
+    CloseStreamingReader();
+    return PLUS_FAIL;
+  }
+
+  // The video format (frame size, pixel type, image type and orientation) is determined from the first frame
+  if (this->StreamingReader->ReadFramePixels(0, *savedDataBuffer->GetTrackedFrame(0)->GetImageData())!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read the first frame of sequence metafile: "<<this->SequenceMetafile);
+    CloseStreamingReader();
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkSavedDataSource::CloseStreamingReader()
+{
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> readerGuardedLock(this->StreamingReaderMutex);
+    DELETE_IF_NOT_NULL(this->StreamingReader);
+    this->StreamedFrameIndexes.clear();
+  }
+  PlusLockGuard<vtkRecursiveCriticalSection> prefetchGuardedLock(this->PrefetchMutex);
+  this->PrefetchedFrames.clear();
+  this->PrefetchedFramePositions.clear();
+  this->PrefetchReadFrame=PlusVideoFrame();
+  this->StreamedFrame=PlusVideoFrame();
+  this->PrefetchNextPosition=0;
+  this->PrefetchGeneration++;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkSavedDataSource::CreateStreamingLocalVideoBuffer(vtkTrackedFrameList* savedDataBuffer)
+{
+  const int numberOfFrames=savedDataBuffer->GetNumberOfTrackedFrames();
+
+  // The frame size of the local buffer is 0, so no memory is allocated for images
+  this->LocalVideoBuffer = vtkPlusBuffer::New();
+  this->LocalVideoBuffer->SetLocalTimeOffsetSec(0.0);
+  if ( this->LocalVideoBuffer->SetBufferSize(numberOfFrames) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to set local video buffer size!"); 
+    return PLUS_FAIL;
+  }
+
+  this->StreamedFrameIndexes.clear();
+  this->StreamedFrameIndexes.reserve(numberOfFrames);
+  vtkSmartPointer<vtkMatrix4x4> identityMatrix=vtkSmartPointer<vtkMatrix4x4>::New();
+  for ( int frameNumber = 0; frameNumber < numberOfFrames; frameNumber++ )
+  {
+    TrackedFrame* trackedFrame=savedDataBuffer->GetTrackedFrame(frameNumber);
+
+    // Frames with invalid image data are not replayed
+    const char* imgStatus = trackedFrame->GetCustomFrameField("ImageStatus"); 
+    if ( imgStatus != NULL && STRCASECMP(imgStatus, "OK") != 0 )
+    {
+      LOG_DEBUG("Frame #" << frameNumber << " image data is invalid, it is not replayed"); 
+      continue;
+    }
+
+    double timestamp(0); 
+    const char* strTimestamp = trackedFrame->GetCustomFrameField("Timestamp");
+    if ( strTimestamp == NULL || PlusCommon::StringToDouble(strTimestamp, timestamp) != PLUS_SUCCESS )
+    {
+      // the frame is skipped, as in vtkPlusBuffer::CopyImagesFromTrackedFrameList
+      LOG_ERROR("Unable to read Timestamp field of frame #" << frameNumber); 
+      continue; 
+    }
+
+    // The item index is the frame index in the file
+    if ( this->LocalVideoBuffer->AddTimeStampedItem(identityMatrix, TOOL_OK, frameNumber, timestamp, timestamp) != PLUS_SUCCESS )
+    {
+      LOG_WARNING("Failed to add video frame to buffer from sequence metafile with frame #" << frameNumber ); 
+      continue;
+    }
+    this->StreamedFrameIndexes.push_back(frameNumber);
+  }
+
+  if (this->StreamedFrameIndexes.empty())
+  {
+    LOG_ERROR("No frames can be replayed from sequence metafile: "<<this->SequenceMetafile);
+    return PLUS_FAIL;
+  }
+  this->StreamedFramesFirstUid=this->LocalVideoBuffer->GetOldestItemUidInBuffer();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkSavedDataSource::ReadStreamedFrame(BufferItemUidType frameUid, PlusVideoFrame& frame)
+{
+  PlusLockGuard<vtkRecursiveCriticalSection> readerGuardedLock(this->StreamingReaderMutex);
+  if (this->StreamingReader==NULL)
+  {
+    LOG_ERROR("Streaming reader is not available");
+    return PLUS_FAIL;
+  }
+  if (frameUid<this->StreamedFramesFirstUid || frameUid-this->StreamedFramesFirstUid>=this->StreamedFrameIndexes.size())
+  {
+    LOG_ERROR("vtkSavedDataSource: Invalid frame UID: " << frameUid);
+    return PLUS_FAIL;
+  }
+  int frameIndex=this->StreamedFrameIndexes[frameUid-this->StreamedFramesFirstUid];
+  if (this->StreamingReader->ReadFramePixels(frameIndex, frame)!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkSavedDataSource: Failed to read frame "<<frameIndex<<" from "<<this->SequenceMetafile);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkSavedDataSource::GetStreamedFrame(BufferItemUidType frameUid, int loopIndex)
+{
+  const long numberOfFramesInTheLoop=this->LoopLastFrameUid-this->LoopFirstFrameUid+1;
+  const long position=loopIndex*numberOfFramesInTheLoop+static_cast<long>(frameUid-this->LoopFirstFrameUid);
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> prefetchGuardedLock(this->PrefetchMutex);
+    // The frames after this one will be read ahead
+    this->PrefetchNextPosition=position+1;
+    if (!this->PrefetchedFrames.empty())
+    {
+      const int slot=position%this->PrefetchedFrames.size();
+      if (this->PrefetchedFramePositions[slot]==position)
+      {
+        // The output frame is swapped with the prefetched frame, so the image buffer of the previous output frame is reused for reading ahead
+        this->PrefetchedFrames[slot].Swap(this->StreamedFrame);
+        this->PrefetchedFramePositions[slot]=-1;
+        if (this->StreamedFrame.IsImageValid())
+        {
+          return PLUS_SUCCESS;
+        }
+        // reading of the frame failed in the prefetch thread, try it again (and report the error)
+      }
+    }
+    this->NumberOfPrefetchMisses++;
+  }
+
+  // The frame has not been read ahead, read it now
+  return ReadStreamedFrame(frameUid, this->StreamedFrame);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSavedDataSource::PrefetchNextFrame()
+{
+  long positionToRead=-1;
+  BufferItemUidType frameUidToRead=0;
+  int generation=0;
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> prefetchGuardedLock(this->PrefetchMutex);
+    const long numberOfSlots=this->PrefetchedFrames.size();
+    const long numberOfFramesInTheLoop=this->LoopLastFrameUid-this->LoopFirstFrameUid+1;
+    if (numberOfSlots<1 || numberOfFramesInTheLoop<1)
+    {
+      return false;
+    }
+    for (long position=this->PrefetchNextPosition; position<this->PrefetchNextPosition+numberOfSlots; ++position)
+    {
+      if (!this->RepeatEnabled && position>=numberOfFramesInTheLoop)
+      {
+        // the sequence is played only once, there are no more frames to read
+        break;
+      }
+      if (this->PrefetchedFramePositions[position%numberOfSlots]!=position)
+      {
+        positionToRead=position;
+        break;
+      }
+    }
+    if (positionToRead<0)
+    {
+      // all the frames in the prefetch window are already read
+      return false;
+    }
+    frameUidToRead=this->LoopFirstFrameUid+positionToRead%numberOfFramesInTheLoop;
+    generation=this->PrefetchGeneration;
+  }
+
+  // Read without locking the prefetched frames, so that the acquisition thread can get the frames that are already read
+  if (ReadStreamedFrame(frameUidToRead, this->PrefetchReadFrame)!=PLUS_SUCCESS)
+  {
+    // store an empty frame, the error will be reported when the frame is played
+    this->PrefetchReadFrame=PlusVideoFrame();
+  }
+
+  PlusLockGuard<vtkRecursiveCriticalSection> prefetchGuardedLock(this->PrefetchMutex);
+  if (generation!=this->PrefetchGeneration || this->PrefetchedFrames.empty())
+  {
+    // the prefetched frames have been discarded while the frame was being read
+    return true;
+  }
+  const int slot=positionToRead%this->PrefetchedFrames.size();
+  this->PrefetchedFrames[slot].Swap(this->PrefetchReadFrame);
+  this->PrefetchedFramePositions[slot]=positionToRead;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSavedDataSource::ResetPrefetchedFrames()
+{
+  PlusLockGuard<vtkRecursiveCriticalSection> prefetchGuardedLock(this->PrefetchMutex);
+  for (unsigned int i=0; i<this->PrefetchedFramePositions.size(); i++)
+  {
+    this->PrefetchedFramePositions[i]=-1;
+  }
+  this->PrefetchNextPosition=0;
+  this->PrefetchGeneration++;
+}
+
+//----------------------------------------------------------------------------
+void vtkSavedDataSource::StartPrefetchThread()
+{
+  StopPrefetchThread();
+
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> prefetchGuardedLock(this->PrefetchMutex);
+    // There is no need to read ahead more frames than the number of frames in the sequence
+    int numberOfSlots=this->PrefetchWindowSize;
+    if (numberOfSlots>static_cast<int>(this->StreamedFrameIndexes.size()))
+    {
+      numberOfSlots=this->StreamedFrameIndexes.size();
+    }
+    if (numberOfSlots<1)
+    {
+      numberOfSlots=1;
+    }
+    this->PrefetchedFrames.clear();
+    this->PrefetchedFrames.resize(numberOfSlots);
+    this->PrefetchedFramePositions.assign(numberOfSlots, -1);
+    this->PrefetchNextPosition=(this->LastAddedLoopIndex*(this->LoopLastFrameUid-this->LoopFirstFrameUid+1))+static_cast<long>(this->LastAddedFrameUid+1-this->LoopFirstFrameUid);
+    this->PrefetchGeneration++;
+    this->NumberOfPrefetchMisses=0;
+  }
+
+  // Set the flags before the thread is started, so that StopPrefetchThread waits for the thread even if it has not started running yet
+  this->PrefetchThreadActive=true;
+  this->PrefetchThreadAlive=true;
+  this->Threader->SpawnThread((vtkThreadFunctionType)&vtkPrefetchThread, this);
+}
+
+//----------------------------------------------------------------------------
+void vtkSavedDataSource::StopPrefetchThread()
+{
+  this->PrefetchThreadActive=false;
+  while ( this->PrefetchThreadAlive )
+  {
+    vtkAccurateTimer::Delay(PREFETCH_IDLE_DELAY_SEC);
+  }
+}
+
+//----------------------------------------------------------------------------
+void* vtkSavedDataSource::vtkPrefetchThread(vtkMultiThreader::ThreadInfo *data)
+{
+  vtkSavedDataSource *self = (vtkSavedDataSource *)(data->UserData);
+  while ( self->PrefetchThreadActive )
+  {
+    if (!self->PrefetchNextFrame())
+    {
+      // nothing to read now
+      vtkAccurateTimer::Delay(PREFETCH_IDLE_DELAY_SEC);
+    }
+  }
+  self->PrefetchThreadAlive = false; 
+  return NULL;
+}
@@ -7,9 +7,13 @@ See License.txt for details.
 #ifndef __vtkSavedDataSource_h
 #define __vtkSavedDataSource_h
 
+#include "PlusVideoFrame.h"
 #include "vtkPlusDevice.h"
+#include <vector>
 
+class vtkMetaImageSequenceIO;
 class vtkPlusBuffer; 
+class vtkRecursiveCriticalSection;
 
 class VTK_EXPORT vtkSavedDataSource;
 
@@ -25,6 +29,11 @@ Attributes:
 \li UseOriginalTimestamps: if true then the original timestamps (recorded originally in the source file) 
   will be replayed exactly, otherwise only the timestamp difference will be replayed exactly, 
   starting from the current time (TRUE|FALSE)
+\li StreamingPlayback: if true then the image data is not loaded into memory when connecting
+  but the frames are read from the file during playback. Frames are read ahead in a background thread,
+  therefore replay can start immediately and memory usage does not depend on the length of the sequence.
+  Only sequence metafiles with uncompressed pixel data can be streamed, compressed files are loaded into memory (TRUE|FALSE)
+\li PrefetchWindowSize: maximum number of frames that are read ahead in streaming playback mode (default: 30)
 
 */
 class VTK_EXPORT vtkSavedDataSource : public vtkPlusDevice
@@ -71,6 +80,21 @@ public:
   /*! Read the timestamps from the file and use provide them in the output (instead of the current time) */
   vtkBooleanMacro(UseOriginalTimestamps, bool);
 
+  /*! Read the frames from the file during playback instead of loading the whole sequence on connect /sa StreamingPlayback */
+  vtkGetMacro(StreamingPlayback, bool);
+  /*! Read the frames from the file during playback instead of loading the whole sequence on connect /sa StreamingPlayback */
+  vtkSetMacro(StreamingPlayback, bool);
+  /*! Read the frames from the file during playback instead of loading the whole sequence on connect /sa StreamingPlayback */
+  vtkBooleanMacro(StreamingPlayback, bool);
+
+  /*! Set the maximum number of frames that are read ahead in streaming playback mode. Takes effect on the next connect. */
+  vtkSetMacro(PrefetchWindowSize, int);
+  /*! Get the maximum number of frames that are read ahead in streaming playback mode */
+  vtkGetMacro(PrefetchWindowSize, int);
+
+  /*! Get the number of frames that were not read ahead in time in streaming playback mode (they had to be read when they were played) */
+  vtkGetMacro(NumberOfPrefetchMisses, int);
+
   /*! Get local video buffer */
   vtkGetObjectMacro(LocalVideoBuffer, vtkPlusBuffer); 
 
@@ -127,6 +151,47 @@ protected:
 
   void DeleteLocalBuffers(); 
 
+  /*! 
+    Get the video frame and custom fields that will be added to the output buffer.
+    If the whole sequence is loaded into memory then the frame is taken from the local buffer item,
+    in streaming playback mode the frame is read from the file (or taken from the prefetched frames).
+  */
+  PlusStatus GetVideoFrameToBeAdded(StreamBufferItem& localBufferItem, BufferItemUidType frameUid, int loopIndex, PlusVideoFrame*& frame, StreamBufferItem::FieldMapType& fieldMap);
+
+  /*!
+    Read the header of the sequence metafile for streaming playback. The pixel data of the first frame
+    is also read, because the video format is determined from the first frame.
+    Returns PLUS_FAIL if the file cannot be streamed (e.g., it contains compressed pixel data).
+  */
+  PlusStatus OpenStreamingReader();
+
+  /*! Delete the streaming reader and the prefetched frames */
+  void CloseStreamingReader();
+
+  /*! Fill the local video buffer with the timestamps of the frames (without image data) for streaming playback */
+  PlusStatus CreateStreamingLocalVideoBuffer(vtkTrackedFrameList* savedDataBuffer);
+
+  /*! Read the pixel data of the frame (identified by its UID in the local buffer) from the file */
+  PlusStatus ReadStreamedFrame(BufferItemUidType frameUid, PlusVideoFrame& frame);
+
+  /*! Get the frame from the prefetched frames (or read it from the file, if it has not been prefetched) into StreamedFrame */
+  PlusStatus GetStreamedFrame(BufferItemUidType frameUid, int loopIndex);
+
+  /*! Read the next frame that is not prefetched yet within the prefetch window. Returns false if there was nothing to read. */
+  bool PrefetchNextFrame();
+
+  /*! Discard all the prefetched frames (e.g., because the loop range has changed) */
+  void ResetPrefetchedFrames();
+
+  /*! Start the thread that reads the frames ahead in streaming playback mode */
+  void StartPrefetchThread();
+
+  /*! Stop the thread that reads the frames ahead and wait until it is terminated */
+  void StopPrefetchThread();
+
+  /*! Thread function for reading the frames ahead in streaming playback mode */
+  static void *vtkPrefetchThread(vtkMultiThreader::ThreadInfo *data);
+
 protected:
   /*! Byte alignment of each row in the framebuffer */
   int FrameBufferRowAlignment;
@@ -179,6 +244,58 @@ protected:
 
   SimulatedStreamType SimulatedStream;
 
+  /*! Read the frames from the file during playback instead of loading the whole sequence on connect */
+  bool StreamingPlayback;
+
+  /*! Maximum number of frames that are read ahead in streaming playback mode */
+  int PrefetchWindowSize;
+
+  /*! Reader of the sequence metafile in streaming playback mode (NULL if the whole sequence is loaded into memory) */
+  vtkMetaImageSequenceIO* StreamingReader;
+
+  /*! Serializes access to the streaming reader (it is used by the prefetch thread and the acquisition thread) */
+  vtkRecursiveCriticalSection* StreamingReaderMutex;
+
+  /*! Frame index in the sequence metafile for each item of the local video buffer in streaming playback mode */
+  std::vector<int> StreamedFrameIndexes;
+
+  /*! UID of the first item in the local video buffer in streaming playback mode */
+  BufferItemUidType StreamedFramesFirstUid;
+
+  /*! Frame that is added to the output buffer in streaming playback mode */
+  PlusVideoFrame StreamedFrame;
+
+  /*! 
+    Frames that have been read ahead. Each played frame is identified by its playback position
+    (number of frames played since the start of the first loop), the frame at position p is stored in
+    the slot p % (number of slots).
+  */
+  std::vector<PlusVideoFrame> PrefetchedFrames;
+
+  /*! Playback position of the frame in each prefetch slot (-1 if the slot is empty) */
+  std::vector<long> PrefetchedFramePositions;
+
+  /*! Playback position of the next frame to be played, the frames after this position are read ahead */
+  long PrefetchNextPosition;
+
+  /*! Incremented whenever the prefetched frames are discarded, to discard frames that were being read at that time */
+  int PrefetchGeneration;
+
+  /*! Frame used by the prefetch thread for reading (it is swapped with the frame in the slot) */
+  PlusVideoFrame PrefetchReadFrame;
+
+  /*! Protects the prefetched frames and the prefetch position */
+  vtkRecursiveCriticalSection* PrefetchMutex;
+
+  /*! Number of frames that were not read ahead in time */
+  int NumberOfPrefetchMisses;
+
+  /*! The prefetch thread keeps running while this flag is set */
+  bool PrefetchThreadActive;
+
+  /*! True while the prefetch thread is running */
+  bool PrefetchThreadAlive;
+
 private:
   static vtkSavedDataSource* Instance;
   vtkSavedDataSource(const vtkSavedDataSource&);  // Not implemented.
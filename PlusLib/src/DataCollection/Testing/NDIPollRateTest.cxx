@@ -0,0 +1,540 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file NDIPollRateTest.cxx
+  \brief This program polls a simulated NDI tracker through a pseudo-terminal with the TX and the binary BX
+  command, with and without pipelining the requests. The simulated device delays each reply by its
+  transmission time at the simulated baud rate. The program verifies the decoded transforms and frame numbers
+  and reports the achieved poll rate in each mode. Finally a vtkNDITracker device is configured to use the binary
+  replies with pipelined polling and it records the tool transforms from the simulated device.
+*/
+
+#include "PlusConfigure.h"
+#include "ndicapi.h"
+#include "vtkAccurateTimer.h"
+#include "vtkMultiThreader.h"
+#include "vtkNDITracker.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDataSource.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/select.h>
+#include <unistd.h>
+
+namespace
+{
+  const int NUMBER_OF_TOOLS = 4;
+  const int FIRST_PORT_HANDLE = 0x0A;
+
+  //----------------------------------------------------------------------------
+  // Running CRC16 of the NDI API
+  unsigned int CalculateCrc16(const char* data, int length)
+  {
+    static const int oddParity[16] = { 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 };
+    unsigned int crc = 0;
+    for (int i = 0; i < length; i++)
+    {
+      int value = (data[i] ^ (crc & 0xff)) & 0xff;
+      crc >>= 8;
+      if ( oddParity[value & 0x0f] ^ oddParity[value >> 4] )
+      {
+        crc ^= 0xc001;
+      }
+      value <<= 6;
+      crc ^= value;
+      value <<= 1;
+      crc ^= value;
+    }
+    return crc;
+  }
+
+  //----------------------------------------------------------------------------
+  // Translation of a simulated tool, derived from the frame number so that the received transforms can be verified
+  void GetSimulatedTranslation(int tool, unsigned long frameNumber, double translation[3])
+  {
+    translation[0] = (frameNumber % 1000) * 0.5;
+    translation[1] = tool * 10.25;
+    translation[2] = -20.5;
+  }
+
+  //----------------------------------------------------------------------------
+  void AppendBinary(std::string& reply, unsigned long value, int numberOfBytes)
+  {
+    for (int i = 0; i < numberOfBytes; i++)
+    {
+      reply.push_back(static_cast<char>((value >> (8*i)) & 0xff));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Simulated NDI tracker that replies to the commands received on the master side of a pseudo-terminal
+  struct SimulatedDevice
+  {
+    int MasterFileDescriptor;
+    double BaudRate;
+    volatile bool StopRequested;
+    unsigned long FrameNumber;
+
+    std::string CreateTextReply(const std::string& text)
+    {
+      char crc[5];
+      sprintf(crc, "%04X", CalculateCrc16(text.c_str(), text.size()));
+      return text + crc + "\r";
+    }
+
+    std::string CreateTxReply()
+    {
+      std::string text;
+      char field[128];
+      sprintf(field, "%02X", NUMBER_OF_TOOLS);
+      text += field;
+      for (int tool = 0; tool < NUMBER_OF_TOOLS; tool++)
+      {
+        double translation[3];
+        GetSimulatedTranslation(tool, this->FrameNumber, translation);
+        sprintf(field, "%02X+10000+00000+00000+00000%+07d%+07d%+07d+00123%08X%08lX\n", FIRST_PORT_HANDLE + tool,
+          static_cast<int>(translation[0]*100), static_cast<int>(translation[1]*100), static_cast<int>(translation[2]*100),
+          NDI_TOOL_IN_PORT | NDI_INITIALIZED | NDI_ENABLED, this->FrameNumber);
+        text += field;
+      }
+      text += "0000"; // system status
+      return CreateTextReply(text);
+    }
+
+    std::string CreateBxReply()
+    {
+      std::string body;
+      AppendBinary(body, NUMBER_OF_TOOLS, 1);
+      for (int tool = 0; tool < NUMBER_OF_TOOLS; tool++)
+      {
+        AppendBinary(body, FIRST_PORT_HANDLE + tool, 1);
+        AppendBinary(body, 0x01, 1); // valid
+        double translation[3];
+        GetSimulatedTranslation(tool, this->FrameNumber, translation);
+        float values[8] = { 1.0f, 0.0f, 0.0f, 0.0f, static_cast<float>(translation[0]), static_cast<float>(translation[1]),
+          static_cast<float>(translation[2]), 0.0123f };
+        for (int i = 0; i < 8; i++)
+        {
+          unsigned int bits = 0;
+          memcpy(&bits, &values[i], 4);
+          AppendBinary(body, bits, 4);
+        }
+        AppendBinary(body, NDI_TOOL_IN_PORT | NDI_INITIALIZED | NDI_ENABLED, 4);
+        AppendBinary(body, this->FrameNumber, 4);
+      }
+      AppendBinary(body, 0, 2); // system status
+
+      std::string reply;
+      AppendBinary(reply, 0xA5C4, 2);
+      AppendBinary(reply, body.size(), 2);
+      AppendBinary(reply, CalculateCrc16(reply.c_str(), 4), 2);
+      reply += body;
+      AppendBinary(reply, CalculateCrc16(body.c_str(), body.size()), 2);
+      return reply;
+    }
+
+    // Reply to PHSR:00 with all the port handles, there are no handles to be freed, initialized or enabled
+    std::string CreatePhsrReply(const std::string& command)
+    {
+      if ( command.compare(0, 7, "PHSR:00") != 0 )
+      {
+        return CreateTextReply("00");
+      }
+      std::string text;
+      char field[16];
+      sprintf(field, "%02X", NUMBER_OF_TOOLS);
+      text += field;
+      for (int tool = 0; tool < NUMBER_OF_TOOLS; tool++)
+      {
+        sprintf(field, "%02X%03X", FIRST_PORT_HANDLE + tool, NDI_TOOL_IN_PORT | NDI_INITIALIZED | NDI_ENABLED);
+        text += field;
+      }
+      return CreateTextReply(text);
+    }
+
+    // Reply to PHINF with the requested fields, each tool is in the wired port that has the number of the tool plus one
+    std::string CreatePhinfReply(const std::string& command)
+    {
+      int tool = strtol(command.substr(6, 2).c_str(), NULL, 16) - FIRST_PORT_HANDLE;
+      if ( tool < 0 || tool >= NUMBER_OF_TOOLS )
+      {
+        return CreateTextReply("UNOCCUPIED");
+      }
+      unsigned long replyMode = ( command.size() >= 16 ) ? strtoul(command.substr(8, 4).c_str(), NULL, 16) : NDI_BASIC;
+
+      std::string text;
+      char field[64];
+      if ( replyMode & NDI_BASIC )
+      {
+        sprintf(field, "02000000%-12s001%08X%02X", "NDI", 0x1000 + tool, NDI_TOOL_IN_PORT | NDI_INITIALIZED | NDI_ENABLED);
+        text += field;
+      }
+      if ( replyMode & NDI_PART_NUMBER )
+      {
+        sprintf(field, "SIMULATED-%-10d", tool);
+        text += field;
+      }
+      if ( replyMode & NDI_PORT_LOCATION )
+      {
+        sprintf(field, "0000000000%02d00", tool + 1);
+        text += field;
+      }
+      return CreateTextReply(text);
+    }
+
+    std::string CreateReply(const std::string& command)
+    {
+      if ( command.compare(0, 3, "TX:") == 0 )
+      {
+        this->FrameNumber++;
+        return CreateTxReply();
+      }
+      if ( command.compare(0, 3, "BX:") == 0 )
+      {
+        this->FrameNumber++;
+        return CreateBxReply();
+      }
+      if ( command.compare(0, 5, "PHSR:") == 0 )
+      {
+        return CreatePhsrReply(command);
+      }
+      if ( command.compare(0, 6, "PHINF:") == 0 )
+      {
+        return CreatePhinfReply(command);
+      }
+      if ( command.compare(0, 4, "VER:") == 0 )
+      {
+        return CreateTextReply("Simulated NDI tracker");
+      }
+      if ( command.compare(0, 5, "INIT:") == 0 || command.compare(0, 7, "TSTART:") == 0 || command.compare(0, 6, "TSTOP:") == 0
+        || command.compare(0, 5, "COMM:") == 0 || command.compare(0, 4, "PHF:") == 0 || command.compare(0, 6, "PINIT:") == 0
+        || command.compare(0, 5, "PENA:") == 0 || command.compare(0, 5, "PDIS:") == 0 )
+      {
+        return CreateTextReply("OKAY");
+      }
+      return CreateTextReply("ERROR01");
+    }
+
+    void Run()
+    {
+      std::string command;
+      while ( !this->StopRequested )
+      {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(this->MasterFileDescriptor, &readSet);
+        struct timeval timeout = { 0, 100000 };
+        if ( select(this->MasterFileDescriptor + 1, &readSet, NULL, NULL, &timeout) <= 0 )
+        {
+          continue;
+        }
+        char c = 0;
+        if ( read(this->MasterFileDescriptor, &c, 1) != 1 )
+        {
+          // The slave side is not open (e.g., while the device is reopened)
+          vtkAccurateTimer::Delay(0.001);
+          continue;
+        }
+        if ( c != '\r' )
+        {
+          command.push_back(c);
+          continue;
+        }
+
+        std::string reply = CreateReply(command);
+        command.clear();
+        // The reply is complete after its transmission time (10 bits per byte with 8N1)
+        vtkAccurateTimer::Delay(reply.size() * 10 / this->BaudRate);
+        if ( write(this->MasterFileDescriptor, reply.c_str(), reply.size()) != static_cast<ssize_t>(reply.size()) )
+        {
+          LOG_ERROR("Failed to write the reply of the simulated device");
+        }
+      }
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE SimulatedDeviceThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo *threadInfo = static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+    static_cast<SimulatedDevice*>(threadInfo->UserData)->Run();
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  // Poll the tool transforms for the given time and process each reply for the given time.
+  // Returns the number of errors.
+  int Poll(ndicapi* device, bool binaryReply, bool pipelined, double processingTimeSec, double testTimeSec, double &pollRate)
+  {
+    int numberOfErrors = 0;
+    ndiSetThreadMode(device, pipelined ? 1 : 0);
+    ndiCommand(device, "TSTART:");
+    if ( ndiGetError(device) != NDI_OKAY )
+    {
+      LOG_ERROR("Failed TSTART: " << ndiErrorString(ndiGetError(device)));
+      return 1;
+    }
+
+    int numberOfPolls = 0;
+    unsigned long lastFrameNumber = 0;
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    double currentTimeSec = startTimeSec;
+    while ( currentTimeSec - startTimeSec < testTimeSec && numberOfErrors < 10 )
+    {
+      ndiCommand(device, binaryReply ? "BX:0801" : "TX:0801");
+      if ( ndiGetError(device) != NDI_OKAY )
+      {
+        LOG_ERROR("Failed to get the tool transforms: " << ndiErrorString(ndiGetError(device)));
+        numberOfErrors++;
+        continue;
+      }
+      numberOfPolls++;
+
+      for (int tool = 0; tool < NUMBER_OF_TOOLS; tool++)
+      {
+        int portHandle = FIRST_PORT_HANDLE + tool;
+        double transform[8] = {0};
+        int absent = binaryReply ? ndiGetBXTransform(device, portHandle, transform) : ndiGetTXTransform(device, portHandle, transform);
+        int portStatus = binaryReply ? ndiGetBXPortStatus(device, portHandle) : ndiGetTXPortStatus(device, portHandle);
+        unsigned long frameNumber = binaryReply ? ndiGetBXFrame(device, portHandle) : ndiGetTXFrame(device, portHandle);
+        double expectedTranslation[3];
+        GetSimulatedTranslation(tool, frameNumber, expectedTranslation);
+        if ( absent != NDI_OKAY || portStatus != (NDI_TOOL_IN_PORT | NDI_INITIALIZED | NDI_ENABLED)
+          || fabs(transform[0] - 1.0) > 1e-4 || fabs(transform[7] - 0.0123) > 1e-4
+          || fabs(transform[4] - expectedTranslation[0]) > 0.01 || fabs(transform[5] - expectedTranslation[1]) > 0.01
+          || fabs(transform[6] - expectedTranslation[2]) > 0.01 )
+        {
+          LOG_ERROR("Unexpected data for port handle " << portHandle << " in frame " << frameNumber << ": translation = "
+            << transform[4] << " " << transform[5] << " " << transform[6] << ", port status = " << portStatus);
+          numberOfErrors++;
+        }
+        if ( tool == 0 )
+        {
+          if ( frameNumber <= lastFrameNumber )
+          {
+            LOG_ERROR("The frame number did not increase: " << lastFrameNumber << " -> " << frameNumber);
+            numberOfErrors++;
+          }
+          lastFrameNumber = frameNumber;
+        }
+      }
+
+      // Simulated processing of the received transforms
+      vtkAccurateTimer::Delay(processingTimeSec);
+      currentTimeSec = vtkAccurateTimer::GetSystemTime();
+    }
+    pollRate = numberOfPolls / (currentTimeSec - startTimeSec);
+
+    ndiCommand(device, "TSTOP:");
+    if ( ndiGetError(device) != NDI_OKAY )
+    {
+      LOG_ERROR("Failed TSTOP: " << ndiErrorString(ndiGetError(device)));
+      numberOfErrors++;
+    }
+    ndiSetThreadMode(device, 0);
+
+    LOG_INFO((binaryReply ? "BX" : "TX") << (pipelined ? " pipelined" : "") << ": poll rate: " << std::fixed << pollRate << " Hz");
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  // Record the tool transforms from the simulated device with a vtkNDITracker that uses the binary replies
+  // with pipelined polling. Returns the number of errors.
+  int RecordWithTracker(const std::string& deviceName, double testTimeSec)
+  {
+    std::ostringstream configString;
+    configString << "<PlusConfiguration version=\"2.1\">"
+      << "<DataCollection StartupDelaySec=\"1.0\">"
+      << "<Device Id=\"TrackerDevice\" Type=\"PolarisTracker\" ToolReferenceFrame=\"Tracker\" AcquisitionRate=\"20\""
+      << " BaudRate=\"115200\" UseBinaryReply=\"TRUE\" PipelinedPolling=\"TRUE\" >"
+      << "<DataSources>";
+    for (int tool = 0; tool < NUMBER_OF_TOOLS; tool++)
+    {
+      configString << "<DataSource Type=\"Tool\" Id=\"Tool" << tool << "\" PortName=\"" << tool << "\" BufferSize=\"500\" AveragedItemsForFiltering=\"20\" />";
+    }
+    configString << "</DataSources></Device></DataCollection></PlusConfiguration>";
+    vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take( vtkXMLUtilities::ReadElementFromString(configString.str().c_str()) );
+
+    vtkSmartPointer<vtkNDITracker> tracker = vtkSmartPointer<vtkNDITracker>::New();
+    tracker->SetDeviceId("TrackerDevice");
+    if ( tracker->ReadConfiguration(configRootElement) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to read the configuration of the tracker");
+      return 1;
+    }
+    if ( !tracker->GetUseBinaryReply() || !tracker->GetPipelinedPolling() || tracker->GetNumberOfTools() != NUMBER_OF_TOOLS )
+    {
+      LOG_ERROR("The tracker configuration is not applied: UseBinaryReply=" << tracker->GetUseBinaryReply()
+        << ", PipelinedPolling=" << tracker->GetPipelinedPolling() << ", number of tools: " << tracker->GetNumberOfTools());
+      return 1;
+    }
+    // The name of the pseudo-terminal is only known at runtime, so it is not in the configuration
+    tracker->SetSerialDevice(deviceName.c_str());
+
+    if ( tracker->Connect() != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to connect to the tracker");
+      return 1;
+    }
+    if ( tracker->StartRecording() != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to start recording with the tracker");
+      tracker->Disconnect();
+      return 1;
+    }
+    vtkAccurateTimer::Delay(testTimeSec);
+
+    int numberOfErrors = 0;
+    for ( DataSourceContainerConstIterator it = tracker->GetToolIteratorBegin(); it != tracker->GetToolIteratorEnd(); ++it)
+    {
+      vtkPlusDataSource* tool = it->second;
+      int toolIndex = atoi(tool->GetPortName());
+      StreamBufferItem bufferItem;
+      if ( tool->GetBuffer()->GetNumberOfItems() == 0 || tool->GetBuffer()->GetLatestStreamBufferItem(&bufferItem) != ITEM_OK )
+      {
+        LOG_ERROR("No transform has been recorded for tool " << tool->GetSourceId());
+        numberOfErrors++;
+        continue;
+      }
+      double matrixElements[16];
+      bufferItem.GetMatrixElements(matrixElements);
+      double expectedTranslation[3];
+      GetSimulatedTranslation(toolIndex, bufferItem.GetIndex(), expectedTranslation);
+      if ( bufferItem.GetStatus() != TOOL_OK || fabs(matrixElements[3] - expectedTranslation[0]) > 0.01
+        || fabs(matrixElements[7] - expectedTranslation[1]) > 0.01 || fabs(matrixElements[11] - expectedTranslation[2]) > 0.01 )
+      {
+        LOG_ERROR("Unexpected transform for tool " << tool->GetSourceId() << " in frame " << bufferItem.GetIndex() << ": translation = "
+          << matrixElements[3] << " " << matrixElements[7] << " " << matrixElements[11] << ", status = "
+          << vtkPlusDevice::ConvertToolStatusToString(bufferItem.GetStatus()));
+        numberOfErrors++;
+      }
+      LOG_INFO("Tracker: recorded " << tool->GetBuffer()->GetNumberOfItems() << " transforms for tool " << tool->GetSourceId());
+    }
+
+    if ( tracker->StopRecording() != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to stop recording with the tracker");
+      numberOfErrors++;
+    }
+    tracker->Disconnect();
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  double baudRate(115200);
+  double processingTimeSec(0.005);
+  double testTimeSec(1.5);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--baud-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &baudRate, "Simulated baud rate, determines the transmission time of the replies (Default: 115200).");
+  args.AddArgument("--processing-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &processingTimeSec, "Time spent with processing each reply (Default: 0.005).");
+  args.AddArgument("--test-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &testTimeSec, "Duration of polling in each mode (Default: 1.5).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( baudRate <= 0 || processingTimeSec < 0 || testTimeSec <= 0 )
+  {
+    std::cerr << "Invalid arguments" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // The simulated device is on the master side of the pseudo-terminal, the NDI library opens the slave side
+  SimulatedDevice simulatedDevice;
+  simulatedDevice.MasterFileDescriptor = posix_openpt(O_RDWR | O_NOCTTY);
+  simulatedDevice.BaudRate = baudRate;
+  simulatedDevice.StopRequested = false;
+  simulatedDevice.FrameNumber = 0;
+  if ( simulatedDevice.MasterFileDescriptor < 0 || grantpt(simulatedDevice.MasterFileDescriptor) != 0
+    || unlockpt(simulatedDevice.MasterFileDescriptor) != 0 || ptsname(simulatedDevice.MasterFileDescriptor) == NULL )
+  {
+    LOG_ERROR("Failed to create a pseudo-terminal");
+    exit(EXIT_FAILURE);
+  }
+  std::string slaveDeviceName = ptsname(simulatedDevice.MasterFileDescriptor);
+
+  ndicapi* device = ndiOpen(slaveDeviceName.c_str());
+  if ( device == NULL )
+  {
+    LOG_ERROR("Failed to open the simulated device: " << slaveDeviceName);
+    close(simulatedDevice.MasterFileDescriptor);
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  int threadId = threader->SpawnThread(SimulatedDeviceThreadFunction, &simulatedDevice);
+
+  int numberOfErrors(0);
+  ndiCommand(device, "INIT:");
+  if ( ndiGetError(device) != NDI_OKAY )
+  {
+    LOG_ERROR("Failed INIT: " << ndiErrorString(ndiGetError(device)));
+    numberOfErrors++;
+  }
+  else
+  {
+    double txPollRate = 0;
+    double bxPollRate = 0;
+    double txPipelinedPollRate = 0;
+    double bxPipelinedPollRate = 0;
+    numberOfErrors += Poll(device, false, false, processingTimeSec, testTimeSec, txPollRate);
+    numberOfErrors += Poll(device, true, false, processingTimeSec, testTimeSec, bxPollRate);
+    numberOfErrors += Poll(device, false, true, processingTimeSec, testTimeSec, txPipelinedPollRate);
+    numberOfErrors += Poll(device, true, true, processingTimeSec, testTimeSec, bxPipelinedPollRate);
+    LOG_INFO("Poll rate with TX: " << std::fixed << txPollRate << " Hz, with BX: " << bxPollRate << " Hz, with pipelined TX: "
+      << txPipelinedPollRate << " Hz, with pipelined BX: " << bxPipelinedPollRate << " Hz");
+  }
+  ndiClose(device);
+
+  if ( numberOfErrors == 0 )
+  {
+    // The tracker opens the simulated device again and initializes it the same way as a real device
+    numberOfErrors += RecordWithTracker(slaveDeviceName, testTimeSec);
+  }
+
+  simulatedDevice.StopRequested = true;
+  threader->TerminateThread(threadId);
+  close(simulatedDevice.MasterFileDescriptor);
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("NDIPollRateTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("NDIPollRateTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,366 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file OpenIGTLinkReceiveRateTest.cxx
+  \brief This program streams TRANSFORM and IMAGE messages from in-process OpenIGTLink servers to a
+  vtkOpenIGTLinkTracker and a vtkOpenIGTLinkVideoSource device through the loopback interface.
+  The devices are polled with a low acquisition rate to verify that the receiving does not depend on it.
+  The program reports the sustained receive rate and the latency between sending a message and
+  the availability of its data in the buffer, and verifies that the received rate matches the sent rate.
+*/
+
+#include "PlusConfigure.h"
+#include "igtlImageMessage.h"
+#include "igtlServerSocket.h"
+#include "igtlTransformMessage.h"
+#include "vtkAccurateTimer.h"
+#include "vtkMultiThreader.h"
+#include "vtkOpenIGTLinkTracker.h"
+#include "vtkOpenIGTLinkVideoSource.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <string.h>
+#include <string>
+
+namespace
+{
+  const char TOOL_TRANSFORM_NAME[] = "StylusToTracker";
+
+  // Number of messages that may be lost at the start and at the end of the streaming
+  // (sent before the receiver is started or after the measurement is completed)
+  const int ALLOWED_MISSING_MESSAGES = 5;
+
+  //----------------------------------------------------------------------------
+  struct SimulatedServer
+  {
+    int Port;
+    std::string MessageType;
+    double MessageRate;
+    int FrameSize[2];
+    double StreamingTimeSec;
+    bool Listening;
+    bool Connected;
+    bool Alive;
+    int NumberOfSentMessages;
+  };
+
+  //----------------------------------------------------------------------------
+  // Wait for a client and send TRANSFORM or IMAGE messages to it with the requested rate and the current time as timestamp
+  void* SimulatedServerThread(vtkMultiThreader::ThreadInfo *data)
+  {
+    SimulatedServer* server = static_cast<SimulatedServer*>(data->UserData);
+
+    igtl::ServerSocket::Pointer serverSocket = igtl::ServerSocket::New();
+    if ( serverSocket->CreateServer(server->Port) < 0 )
+    {
+      LOG_ERROR("Cannot create a server socket on port " << server->Port);
+      server->Alive = false;
+      return NULL;
+    }
+    server->Listening = true;
+
+    igtl::Socket::Pointer socket = serverSocket->WaitForConnection(10000);
+    if ( socket.IsNull() )
+    {
+      LOG_ERROR("No client connected to port " << server->Port);
+      serverSocket->CloseSocket();
+      server->Alive = false;
+      return NULL;
+    }
+    server->Connected = true;
+
+    // The messages are allocated once and reused, as a real device would do
+    igtl::TransformMessage::Pointer transformMessage = igtl::TransformMessage::New();
+    transformMessage->SetDeviceName(TOOL_TRANSFORM_NAME);
+    igtl::ImageMessage::Pointer imageMessage = igtl::ImageMessage::New();
+    imageMessage->SetDeviceName("Image");
+    imageMessage->SetDimensions(server->FrameSize[0], server->FrameSize[1], 1);
+    imageMessage->SetSpacing(1.0, 1.0, 1.0);
+    imageMessage->SetScalarType(igtl::ImageMessage::TYPE_UINT8);
+    imageMessage->AllocateScalars();
+    igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+
+    // Give the client time to start recording
+    vtkAccurateTimer::Delay(0.5);
+
+    const bool sendImages = ( server->MessageType.compare("IMAGE") == 0 );
+    const int numberOfMessages = static_cast<int>(server->StreamingTimeSec * server->MessageRate);
+    const double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    for ( int i = 0; i < numberOfMessages; i++ )
+    {
+      double delaySec = startTimeSec + i / server->MessageRate - vtkAccurateTimer::GetSystemTime();
+      if ( delaySec > 0 )
+      {
+        vtkAccurateTimer::Delay(delaySec);
+      }
+
+      timestamp->SetTime(vtkAccurateTimer::GetUniversalTime());
+      igtl::MessageBase* message = NULL;
+      if ( sendImages )
+      {
+        memset(imageMessage->GetScalarPointer(), i & 0xFF, imageMessage->GetImageSize());
+        imageMessage->SetTimeStamp(timestamp);
+        message = imageMessage;
+      }
+      else
+      {
+        igtl::Matrix4x4 matrix;
+        igtl::IdentityMatrix(matrix);
+        matrix[0][3] = static_cast<float>(i);
+        transformMessage->SetMatrix(matrix);
+        transformMessage->SetTimeStamp(timestamp);
+        message = transformMessage;
+      }
+      message->Pack();
+      if ( socket->Send(message->GetPackPointer(), message->GetPackSize()) == 0 )
+      {
+        LOG_ERROR("Failed to send " << server->MessageType << " message on port " << server->Port);
+        break;
+      }
+      server->NumberOfSentMessages++;
+    }
+
+    // Keep the connection open until the client has received all the messages
+    vtkAccurateTimer::Delay(0.5);
+    socket->CloseSocket();
+    serverSocket->CloseSocket();
+    server->Alive = false;
+    return NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  // Start the simulated server thread and wait until it is listening
+  PlusStatus StartSimulatedServer(vtkMultiThreader* threader, SimulatedServer& server)
+  {
+    server.Listening = false;
+    server.Connected = false;
+    server.Alive = true;
+    server.NumberOfSentMessages = 0;
+    threader->SpawnThread((vtkThreadFunctionType)&SimulatedServerThread, &server);
+    while ( !server.Listening )
+    {
+      if ( !server.Alive )
+      {
+        return PLUS_FAIL;
+      }
+      vtkAccurateTimer::Delay(0.01);
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Poll the buffer while the server is streaming. The latency is the time between the timestamp of the latest item
+  // (the time of sending, converted from the timestamp in the message) and the time when the item is seen in the buffer.
+  // Returns the number of errors.
+  int MeasureReceiveRate(vtkPlusDevice* device, vtkPlusBuffer* buffer, SimulatedServer& server)
+  {
+    while ( server.Alive && !server.Connected )
+    {
+      vtkAccurateTimer::Delay(0.01);
+    }
+    if ( !server.Alive )
+    {
+      return 1;
+    }
+
+    int numberOfLatencySamples = 0;
+    double sumLatencySec = 0;
+    double maxLatencySec = 0;
+    bool itemReceived = false;
+    BufferItemUidType firstItemUid = 0;
+    BufferItemUidType lastItemUid = 0;
+    double firstItemTimeSec = 0;
+    double lastItemTimeSec = 0;
+    while ( server.Alive )
+    {
+      if ( buffer->GetNumberOfItems() > 0 && buffer->GetLatestItemUidInBuffer() != lastItemUid )
+      {
+        double currentTimeSec = vtkAccurateTimer::GetSystemTime();
+        double latestTimestamp = 0;
+        if ( buffer->GetLatestTimeStamp(latestTimestamp) == ITEM_OK )
+        {
+          lastItemUid = buffer->GetLatestItemUidInBuffer();
+          lastItemTimeSec = currentTimeSec;
+          if ( !itemReceived )
+          {
+            itemReceived = true;
+            firstItemUid = lastItemUid;
+            firstItemTimeSec = currentTimeSec;
+          }
+          double latencySec = currentTimeSec - latestTimestamp;
+          sumLatencySec += latencySec;
+          maxLatencySec = std::max(maxLatencySec, latencySec);
+          numberOfLatencySamples++;
+        }
+      }
+      vtkAccurateTimer::Delay(0.001);
+    }
+
+    if ( !itemReceived )
+    {
+      LOG_ERROR(device->GetDeviceId() << ": no " << server.MessageType << " message has been received");
+      return 1;
+    }
+
+    int numberOfReceivedItems = static_cast<int>(lastItemUid - firstItemUid + 1);
+    double receiveRate = ( lastItemTimeSec > firstItemTimeSec ) ? (numberOfReceivedItems - 1) / (lastItemTimeSec - firstItemTimeSec) : 0;
+    LOG_INFO(device->GetDeviceId() << ": sent " << server.NumberOfSentMessages << " " << server.MessageType << " messages at " << server.MessageRate
+      << " Hz, received " << numberOfReceivedItems << " at " << std::fixed << receiveRate << " Hz (acquisition rate: " << device->GetAcquisitionRate()
+      << " Hz), latency: mean " << sumLatencySec / numberOfLatencySamples * 1000.0 << " ms, max " << maxLatencySec * 1000.0 << " ms");
+
+    if ( numberOfReceivedItems < server.NumberOfSentMessages - ALLOWED_MISSING_MESSAGES )
+    {
+      LOG_ERROR(device->GetDeviceId() << ": only " << numberOfReceivedItems << " of the " << server.NumberOfSentMessages << " sent messages have been received");
+      return 1;
+    }
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  int trackerPort(18950);
+  int videoPort(18951);
+  double transformRate(500.0);
+  double imageRate(60.0);
+  double acquisitionRate(10.0);
+  double streamingTimeSec(3.0);
+  int frameSize[2] = {640, 480};
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--tracker-port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &trackerPort, "Port of the simulated server that sends TRANSFORM messages (Default: 18950).");
+  args.AddArgument("--video-port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &videoPort, "Port of the simulated server that sends IMAGE messages (Default: 18951).");
+  args.AddArgument("--transform-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &transformRate, "Rate of the sent TRANSFORM messages (Default: 500).");
+  args.AddArgument("--image-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &imageRate, "Rate of the sent IMAGE messages (Default: 60).");
+  args.AddArgument("--acquisition-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionRate, "Acquisition rate of the devices (Default: 10).");
+  args.AddArgument("--streaming-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &streamingTimeSec, "Duration of the streaming (Default: 3.0).");
+  args.AddArgument("--frame-width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[0], "Width of the sent images in pixels (Default: 640).");
+  args.AddArgument("--frame-height", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[1], "Height of the sent images in pixels (Default: 480).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( transformRate <= 0 || imageRate <= 0 || acquisitionRate <= 0 || streamingTimeSec <= 0 || frameSize[0] < 1 || frameSize[1] < 1 )
+  {
+    std::cerr << "Invalid arguments" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  int numberOfErrors(0);
+
+  // Tracker
+  SimulatedServer trackerServer;
+  trackerServer.Port = trackerPort;
+  trackerServer.MessageType = "TRANSFORM";
+  trackerServer.MessageRate = transformRate;
+  trackerServer.FrameSize[0] = frameSize[0];
+  trackerServer.FrameSize[1] = frameSize[1];
+  trackerServer.StreamingTimeSec = streamingTimeSec;
+
+  vtkSmartPointer<vtkOpenIGTLinkTracker> tracker = vtkSmartPointer<vtkOpenIGTLinkTracker>::New();
+  tracker->SetDeviceId("TrackerDevice");
+  tracker->SetMessageType("TRANSFORM");
+  tracker->SetServerAddress("127.0.0.1");
+  tracker->SetServerPort(trackerPort);
+  tracker->SetToolReferenceFrameName("Tracker");
+  tracker->SetAcquisitionRate(acquisitionRate);
+  vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+  tool->SetSourceId(TOOL_TRANSFORM_NAME);
+  tool->SetPortName(TOOL_TRANSFORM_NAME);
+  tool->SetType(DATA_SOURCE_TYPE_TOOL);
+  tool->GetBuffer()->SetBufferSize(static_cast<int>(transformRate * streamingTimeSec) + 100);
+  tracker->AddTool(tool);
+
+  if ( StartSimulatedServer(threader, trackerServer) != PLUS_SUCCESS || tracker->StartRecording() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to start the tracker");
+    numberOfErrors++;
+  }
+  else
+  {
+    numberOfErrors += MeasureReceiveRate(tracker, tool->GetBuffer(), trackerServer);
+  }
+  tracker->StopRecording();
+  tracker->Disconnect();
+
+  // Video source
+  SimulatedServer videoServer;
+  videoServer.Port = videoPort;
+  videoServer.MessageType = "IMAGE";
+  videoServer.MessageRate = imageRate;
+  videoServer.FrameSize[0] = frameSize[0];
+  videoServer.FrameSize[1] = frameSize[1];
+  videoServer.StreamingTimeSec = streamingTimeSec;
+
+  vtkSmartPointer<vtkOpenIGTLinkVideoSource> videoDevice = vtkSmartPointer<vtkOpenIGTLinkVideoSource>::New();
+  videoDevice->SetDeviceId("VideoDevice");
+  videoDevice->SetMessageType("IMAGE");
+  videoDevice->SetServerAddress("127.0.0.1");
+  videoDevice->SetServerPort(videoPort);
+  videoDevice->SetAcquisitionRate(acquisitionRate);
+  vtkSmartPointer<vtkPlusDataSource> videoSource = vtkSmartPointer<vtkPlusDataSource>::New();
+  videoSource->SetSourceId("Video");
+  videoSource->SetType(DATA_SOURCE_TYPE_VIDEO);
+  videoSource->SetPortImageOrientation(US_IMG_ORIENT_MF);
+  videoSource->GetBuffer()->SetImageOrientation(US_IMG_ORIENT_MF);
+  videoSource->GetBuffer()->SetBufferSize(50);
+  videoDevice->AddVideo(videoSource);
+  vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+  channel->SetOwnerDevice(videoDevice);
+  channel->SetVideoSource(videoSource);
+  videoDevice->AddOutputChannel(channel);
+
+  if ( StartSimulatedServer(threader, videoServer) != PLUS_SUCCESS || videoDevice->StartRecording() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to start the video source");
+    numberOfErrors++;
+  }
+  else
+  {
+    numberOfErrors += MeasureReceiveRate(videoDevice, videoSource->GetBuffer(), videoServer);
+  }
+  videoDevice->StopRecording();
+  videoDevice->Disconnect();
+
+  while ( trackerServer.Alive || videoServer.Alive )
+  {
+    vtkAccurateTimer::Delay(0.01);
+  }
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("OpenIGTLinkReceiveRateTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("OpenIGTLinkReceiveRateTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,258 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file TimestampFilteringPerformanceTest.cxx
+  \brief This program verifies that the incremental timestamp filtering of vtkTimestampedCircularBuffer
+  computes the same filtered timestamps as the direct least-squares line fitting (on a recorded sequence and on
+  simulated sequences) and measures the filtering time for different numbers of averaged items.
+*/
+
+#include "PlusConfigure.h"
+#include "TrackedFrame.h"
+#include "vtkAccurateTimer.h"
+#include "vtkPlusDeviceTypes.h"
+#include "vtkSmartPointer.h"
+#include "vtkTimestampedCircularBuffer.h"
+#include "vtkTrackedFrameList.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <stdlib.h>
+#include <vector>
+
+namespace
+{
+  // Maximum allowed difference between the incrementally computed and the reference filtered timestamps
+  const double MAX_FILTERED_TIMESTAMP_DIFFERENCE_SEC = 1e-6;
+  // Same as the default maximum filtering time difference in vtkTimestampedCircularBuffer
+  const double MAX_ALLOWED_FILTERING_TIME_DIFFERENCE_SEC = 0.5;
+
+  //----------------------------------------------------------------------------
+  // Reference implementation: fit a line to the last averagedItemsForFiltering items directly for each item
+  void ComputeReferenceFilteredTimestamps(const std::vector<unsigned long> &frameIndexes, const std::vector<double> &unfilteredTimestamps,
+    unsigned int averagedItemsForFiltering, std::vector<double> &filteredTimestamps, std::vector<bool> &filteredTimestampsValid)
+  {
+    filteredTimestamps.resize(frameIndexes.size());
+    filteredTimestampsValid.resize(frameIndexes.size());
+    for ( unsigned int itemIndex = 0; itemIndex < frameIndexes.size(); ++itemIndex )
+    {
+      if ( averagedItemsForFiltering < 2 || itemIndex+1 < averagedItemsForFiltering )
+      {
+        filteredTimestamps[itemIndex] = unfilteredTimestamps[itemIndex];
+        filteredTimestampsValid[itemIndex] = true;
+        continue;
+      }
+      unsigned int firstItemIndex = itemIndex+1-averagedItemsForFiltering;
+      double xMean = 0;
+      double yMean = 0;
+      for ( unsigned int i = firstItemIndex; i <= itemIndex; ++i )
+      {
+        xMean += frameIndexes[i];
+        yMean += unfilteredTimestamps[i];
+      }
+      xMean /= averagedItemsForFiltering;
+      yMean /= averagedItemsForFiltering;
+      double covarianceXY = 0;
+      double varianceX = 0;
+      for ( unsigned int i = firstItemIndex; i <= itemIndex; ++i )
+      {
+        double xiMinusXmean = frameIndexes[i]-xMean;
+        covarianceXY += xiMinusXmean*(unfilteredTimestamps[i]-yMean);
+        varianceX += xiMinusXmean*xiMinusXmean;
+      }
+      double a = covarianceXY/varianceX;
+      double b = yMean-a*xMean;
+      filteredTimestamps[itemIndex] = a*frameIndexes[itemIndex]+b;
+      filteredTimestampsValid[itemIndex] = (fabs(filteredTimestamps[itemIndex]-unfilteredTimestamps[itemIndex]) <= MAX_ALLOWED_FILTERING_TIME_DIFFERENCE_SEC);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Compute filtered timestamps with vtkTimestampedCircularBuffer, compare them to the reference and measure the computation time
+  PlusStatus CompareFilteredTimestamps(const std::string &sequenceName, const std::vector<unsigned long> &frameIndexes, const std::vector<double> &unfilteredTimestamps,
+    unsigned int averagedItemsForFiltering)
+  {
+    std::vector<double> referenceFilteredTimestamps;
+    std::vector<bool> referenceFilteredTimestampsValid;
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    ComputeReferenceFilteredTimestamps(frameIndexes, unfilteredTimestamps, averagedItemsForFiltering, referenceFilteredTimestamps, referenceFilteredTimestampsValid);
+    double referenceTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+
+    vtkTimestampedCircularBuffer<StreamBufferItem>* buffer = vtkTimestampedCircularBuffer<StreamBufferItem>::New();
+    buffer->SetAveragedItemsForFiltering(averagedItemsForFiltering);
+    std::vector<double> filteredTimestamps(frameIndexes.size());
+    std::vector<bool> filteredTimestampsValid(frameIndexes.size());
+    startTimeSec = vtkAccurateTimer::GetSystemTime();
+    for ( unsigned int i = 0; i < frameIndexes.size(); ++i )
+    {
+      bool filteredTimestampProbablyValid = true;
+      buffer->CreateFilteredTimeStampForItem(frameIndexes[i], unfilteredTimestamps[i], filteredTimestamps[i], filteredTimestampProbablyValid);
+      filteredTimestampsValid[i] = filteredTimestampProbablyValid;
+    }
+    double incrementalTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+    buffer->Delete();
+
+    double maxDifferenceSec = 0;
+    int numberOfMismatches = 0;
+    for ( unsigned int i = 0; i < frameIndexes.size(); ++i )
+    {
+      double differenceSec = fabs(filteredTimestamps[i]-referenceFilteredTimestamps[i]);
+      if ( differenceSec > maxDifferenceSec )
+      {
+        maxDifferenceSec = differenceSec;
+      }
+      if ( differenceSec > MAX_FILTERED_TIMESTAMP_DIFFERENCE_SEC || filteredTimestampsValid[i] != referenceFilteredTimestampsValid[i] )
+      {
+        if ( numberOfMismatches == 0 )
+        {
+          LOG_ERROR(sequenceName << ", averaged items: " << averagedItemsForFiltering << ": filtered timestamp mismatch at item " << i
+            << " (frame index: " << frameIndexes[i] << "): " << std::fixed << filteredTimestamps[i] << " (valid: " << filteredTimestampsValid[i] << ")"
+            << ", expected: " << referenceFilteredTimestamps[i] << " (valid: " << referenceFilteredTimestampsValid[i] << ")");
+        }
+        numberOfMismatches++;
+      }
+    }
+
+    LOG_INFO(sequenceName << ", " << frameIndexes.size() << " items, averaged items: " << averagedItemsForFiltering
+      << ", maximum difference: " << std::scientific << maxDifferenceSec << " s"
+      << ", filtering time per item: " << std::fixed << 1e6*incrementalTimeSec/frameIndexes.size() << " us"
+      << " (direct line fitting: " << 1e6*referenceTimeSec/frameIndexes.size() << " us)");
+
+    if ( numberOfMismatches > 0 )
+    {
+      LOG_ERROR(sequenceName << ", averaged items: " << averagedItemsForFiltering << ": " << numberOfMismatches << " filtered timestamps are different from the expected value");
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus ReadRecordedTimestamps(const std::string &inputMetafile, std::vector<unsigned long> &frameIndexes, std::vector<double> &unfilteredTimestamps)
+  {
+    vtkSmartPointer<vtkTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkTrackedFrameList>::New();
+    if ( trackedFrameList->ReadFromSequenceMetafile(inputMetafile.c_str()) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to read sequence metafile from file: " << inputMetafile );
+      return PLUS_FAIL;
+    }
+    for ( unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i )
+    {
+      TrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(i);
+      unsigned long frameIndex = 0;
+      double unfilteredTimestamp = 0;
+      if ( PlusCommon::StringToLong(trackedFrame->GetCustomFrameField("FrameNumber"), frameIndex) != PLUS_SUCCESS
+        || PlusCommon::StringToDouble(trackedFrame->GetCustomFrameField("UnfilteredTimestamp"), unfilteredTimestamp) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("FrameNumber or UnfilteredTimestamp field is missing or invalid in frame " << i);
+        return PLUS_FAIL;
+      }
+      frameIndexes.push_back(frameIndex);
+      unfilteredTimestamps.push_back(unfilteredTimestamp);
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Simulate an acquisition with a constant frame rate, random transfer delays and dropped frames
+  void SimulateTimestamps(int numberOfItems, std::vector<unsigned long> &frameIndexes, std::vector<double> &unfilteredTimestamps)
+  {
+    const double framePeriodSec = 0.033;
+    const double startTimeSec = 1000.0;
+    srand(0);
+    unsigned long frameIndex = 12345;
+    for ( int i = 0; i < numberOfItems; ++i )
+    {
+      if ( rand() % 100 == 0 )
+      {
+        // dropped frames
+        frameIndex += 1 + rand() % 3;
+      }
+      double delaySec = 0.005 * rand() / RAND_MAX;
+      frameIndexes.push_back(frameIndex);
+      unfilteredTimestamps.push_back(startTimeSec + frameIndex * framePeriodSec + delaySec);
+      frameIndex++;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  std::string inputMetafile;
+  int numberOfSimulatedItems(20000);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputMetafile, "Input sequence metafile with FrameNumber and UnfilteredTimestamp frame fields.");
+  args.AddArgument("--number-of-simulated-items", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfSimulatedItems, "Number of items in the simulated sequence (Default: 20000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  int numberOfErrors(0);
+
+  // Recorded sequence
+  if ( !inputMetafile.empty() )
+  {
+    std::vector<unsigned long> frameIndexes;
+    std::vector<double> unfilteredTimestamps;
+    if ( ReadRecordedTimestamps(inputMetafile, frameIndexes, unfilteredTimestamps) != PLUS_SUCCESS )
+    {
+      numberOfErrors++;
+    }
+    else
+    {
+      const unsigned int averagedItemsForFilteringList[] = {2, 5, 20, 50};
+      for ( unsigned int i = 0; i < sizeof(averagedItemsForFilteringList)/sizeof(averagedItemsForFilteringList[0]); ++i )
+      {
+        if ( CompareFilteredTimestamps("Recorded sequence", frameIndexes, unfilteredTimestamps, averagedItemsForFilteringList[i]) != PLUS_SUCCESS )
+        {
+          numberOfErrors++;
+        }
+      }
+    }
+  }
+
+  // Simulated sequence
+  {
+    std::vector<unsigned long> frameIndexes;
+    std::vector<double> unfilteredTimestamps;
+    SimulateTimestamps(numberOfSimulatedItems, frameIndexes, unfilteredTimestamps);
+    const unsigned int averagedItemsForFilteringList[] = {20, 200, 2000};
+    for ( unsigned int i = 0; i < sizeof(averagedItemsForFilteringList)/sizeof(averagedItemsForFilteringList[0]); ++i )
+    {
+      if ( CompareFilteredTimestamps("Simulated sequence", frameIndexes, unfilteredTimestamps, averagedItemsForFilteringList[i]) != PLUS_SUCCESS )
+      {
+        numberOfErrors++;
+      }
+    }
+  }
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("TimestampFilteringPerformanceTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("TimestampFilteringPerformanceTest completed successfully");
+  return EXIT_SUCCESS;
+}
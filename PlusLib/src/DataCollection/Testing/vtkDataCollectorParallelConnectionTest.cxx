@@ -0,0 +1,154 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkDataCollectorParallelConnectionTest.cxx
+  \brief This program connects and starts the devices of a device set sequentially and in parallel
+  and compares the startup times. The device set contains fake trackers with simulated connection latency
+  and a virtual device that uses their output channels.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkAccurateTimer.h"
+#include "vtkDataCollector.h"
+#include "vtkFakeTracker.h"
+#include "vtkPlusDevice.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Connect and start the devices, return the startup time in sec (negative in case of failure)
+  double MeasureStartupTime(vtkXMLDataElement* configRootElement, bool parallelDeviceConnection, double& totalConnectionDelaySec)
+  {
+    const char* modeName = parallelDeviceConnection ? "Parallel" : "Sequential";
+
+    vtkSmartPointer<vtkDataCollector> dataCollector = vtkSmartPointer<vtkDataCollector>::New();
+    if ( dataCollector->ReadConfiguration( configRootElement ) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Configuration incorrect for vtkDataCollectorParallelConnectionTest.");
+      return -1;
+    }
+    dataCollector->SetParallelDeviceConnection(parallelDeviceConnection);
+
+    totalConnectionDelaySec = 0;
+    for ( DeviceCollectionConstIterator it = dataCollector->GetDeviceConstIteratorBegin(); it != dataCollector->GetDeviceConstIteratorEnd(); ++it )
+    {
+      vtkFakeTracker* fakeTracker = dynamic_cast<vtkFakeTracker*>(*it);
+      if ( fakeTracker != NULL )
+      {
+        totalConnectionDelaySec += fakeTracker->GetConnectionDelaySec();
+      }
+    }
+
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    if ( dataCollector->Connect() != PLUS_SUCCESS )
+    {
+      LOG_ERROR(modeName << ": failed to connect to devices");
+      return -1;
+    }
+    double connectTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+    if ( dataCollector->Start() != PLUS_SUCCESS )
+    {
+      LOG_ERROR(modeName << ": failed to start data collection");
+      dataCollector->Disconnect();
+      return -1;
+    }
+    double startupTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+
+    double result = startupTimeSec;
+    for ( DeviceCollectionConstIterator it = dataCollector->GetDeviceConstIteratorBegin(); it != dataCollector->GetDeviceConstIteratorEnd(); ++it )
+    {
+      if ( !(*it)->GetConnected() || !(*it)->IsRecording() )
+      {
+        LOG_ERROR(modeName << ": device " << (*it)->GetDeviceId() << " is not connected or not recording");
+        result = -1;
+      }
+    }
+
+    LOG_INFO(modeName << " device connection: connect time: " << std::fixed << connectTimeSec << " sec, total startup time: " << startupTimeSec << " sec");
+
+    dataCollector->Stop();
+    dataCollector->Disconnect();
+    return result;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  std::string inputConfigFileName;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Name of the input configuration file (fake trackers shall have ConnectionDelaySec set).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( inputConfigFileName.empty() )
+  {
+    std::cerr << "config-file is required" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+    vtkXMLUtilities::ReadElementFromFile(inputConfigFileName.c_str()));
+  if ( configRootElement == NULL )
+  {
+    std::cerr << "Unable to read configuration from file " << inputConfigFileName.c_str() << std::endl;
+    exit( EXIT_FAILURE );
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  int numberOfErrors(0);
+
+  double totalConnectionDelaySec = 0;
+  double sequentialStartupTimeSec = MeasureStartupTime(configRootElement, false, totalConnectionDelaySec);
+  double parallelStartupTimeSec = MeasureStartupTime(configRootElement, true, totalConnectionDelaySec);
+  if ( sequentialStartupTimeSec < 0 || parallelStartupTimeSec < 0 )
+  {
+    numberOfErrors++;
+  }
+  else
+  {
+    LOG_INFO("Sum of simulated connection latencies: " << std::fixed << totalConnectionDelaySec << " sec, startup time speedup: " << sequentialStartupTimeSec/parallelStartupTimeSec);
+    // The connection latencies overlap when the devices are connected in parallel
+    if ( totalConnectionDelaySec > 0 && parallelStartupTimeSec >= totalConnectionDelaySec )
+    {
+      LOG_ERROR("Parallel startup time (" << std::fixed << parallelStartupTimeSec << " sec) is not shorter than the sum of connection latencies (" << totalConnectionDelaySec << " sec)");
+      numberOfErrors++;
+    }
+  }
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("vtkDataCollectorParallelConnectionTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkDataCollectorParallelConnectionTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,287 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferPerformanceTest.cxx
+  \brief This program measures the time needed for adding video frames to a vtkPlusBuffer
+  (copy and reorientation of the image data) and verifies the content of the added frames.
+  It also verifies that frames that are added from multiple threads at the same time are not mixed up.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkAccurateTimer.h"
+#include "vtkMultiThreader.h"
+#include "vtkPlusBuffer.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+  // Pixel value of the synthetic test image
+  unsigned char GetTestPixelValue(int x, int y, int component)
+  {
+    return static_cast<unsigned char>( (x + 7*y + 31*component) & 0xFF );
+  }
+
+  //----------------------------------------------------------------------------
+  // Verify that the buffer item contains the test image flipped as expected
+  PlusStatus VerifyFrame(StreamBufferItem& bufferItem, const int frameSize[2], int numberOfComponents, bool hFlip, bool vFlip)
+  {
+    const unsigned char* pixels = static_cast<const unsigned char*>(bufferItem.GetFrame().GetScalarPointer());
+    for ( int y = 0; y < frameSize[1]; ++y )
+    {
+      int inY = vFlip ? frameSize[1]-1-y : y;
+      for ( int x = 0; x < frameSize[0]; ++x )
+      {
+        int inX = hFlip ? frameSize[0]-1-x : x;
+        for ( int c = 0; c < numberOfComponents; ++c )
+        {
+          if ( pixels[(y*frameSize[0]+x)*numberOfComponents+c] != GetTestPixelValue(inX, inY, c) )
+          {
+            LOG_ERROR("Pixel value mismatch at (" << x << ", " << y << ", " << c << ")");
+            return PLUS_FAIL;
+          }
+        }
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus RunTest(const unsigned char* inputImage, const int frameSize[2], int numberOfComponents, US_IMAGE_ORIENTATION inputOrientation, bool hFlip, bool vFlip, int numberOfFrames)
+  {
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetImageOrientation(US_IMG_ORIENT_MF);
+    buffer->SetImageType(numberOfComponents==3 ? US_IMG_RGB_COLOR : US_IMG_BRIGHTNESS);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(numberOfComponents);
+    buffer->SetFrameSize(frameSize[0], frameSize[1]);
+    buffer->SetBufferSize(10);
+
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    for ( int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex )
+    {
+      double timestamp = 1.0 + frameIndex * 0.033;
+      if ( buffer->AddItem(const_cast<unsigned char*>(inputImage), inputOrientation, frameSize, VTK_UNSIGNED_CHAR, numberOfComponents,
+        buffer->GetImageType(), 0, frameIndex, timestamp, timestamp) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to add frame " << frameIndex << " to the buffer");
+        return PLUS_FAIL;
+      }
+    }
+    double elapsedTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+
+    LOG_INFO("Input orientation: " << PlusVideoFrame::GetStringFromUsImageOrientation(inputOrientation)
+      << ", frame size: " << frameSize[0] << "x" << frameSize[1] << "x" << numberOfComponents
+      << ", average time for adding a frame: " << std::fixed << 1000.0*elapsedTimeSec/numberOfFrames << " ms");
+
+    if ( buffer->GetLatestItemUidInBuffer() != static_cast<BufferItemUidType>(numberOfFrames) )
+    {
+      LOG_ERROR("Unexpected latest item UID in the buffer: " << buffer->GetLatestItemUidInBuffer() << " (expected: " << numberOfFrames << ")");
+      return PLUS_FAIL;
+    }
+
+    StreamBufferItem bufferItem;
+    if ( buffer->GetLatestStreamBufferItem(&bufferItem) != ITEM_OK )
+    {
+      LOG_ERROR("Failed to get latest item from the buffer");
+      return PLUS_FAIL;
+    }
+    return VerifyFrame(bufferItem, frameSize, numberOfComponents, hFlip, vFlip);
+  }
+
+  //----------------------------------------------------------------------------
+  const int NUMBER_OF_CONCURRENT_WRITERS = 2;
+
+  struct ConcurrentWriterData
+  {
+    vtkPlusBuffer* Buffer;
+    int FrameSize[2];
+    int NumberOfFramesPerWriter;
+    int NumberOfAddedFrames[NUMBER_OF_CONCURRENT_WRITERS];
+  };
+
+  //----------------------------------------------------------------------------
+  // Add frames to the buffer. All the pixels of a frame are set to the frame index, the frame indices of the writers are interleaved.
+  VTK_THREAD_RETURN_TYPE ConcurrentWriterThread(void* ptr)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(ptr);
+    ConcurrentWriterData* data = static_cast<ConcurrentWriterData*>(threadInfo->UserData);
+    std::vector<unsigned char> image(data->FrameSize[0]*data->FrameSize[1]);
+    for ( int i = 0; i < data->NumberOfFramesPerWriter; ++i )
+    {
+      long frameIndex = i*NUMBER_OF_CONCURRENT_WRITERS + threadInfo->ThreadID;
+      std::fill(image.begin(), image.end(), static_cast<unsigned char>(frameIndex & 0xFF));
+      // The frame is skipped if the other writer has added a frame with the same or newer timestamp, it is not an error
+      double timestamp = vtkAccurateTimer::GetSystemTime();
+      if ( data->Buffer->AddItem(&image[0], US_IMG_ORIENT_MF, data->FrameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, frameIndex, timestamp, timestamp) == PLUS_SUCCESS )
+      {
+        data->NumberOfAddedFrames[threadInfo->ThreadID]++;
+      }
+    }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus RunConcurrentWritersTest(const int frameSize[2], int numberOfFrames)
+  {
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetImageOrientation(US_IMG_ORIENT_MF);
+    buffer->SetImageType(US_IMG_BRIGHTNESS);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(1);
+    buffer->SetFrameSize(frameSize[0], frameSize[1]);
+    buffer->SetBufferSize(10);
+
+    ConcurrentWriterData data;
+    data.Buffer = buffer;
+    data.FrameSize[0] = frameSize[0];
+    data.FrameSize[1] = frameSize[1];
+    data.NumberOfFramesPerWriter = numberOfFrames;
+    for ( int i = 0; i < NUMBER_OF_CONCURRENT_WRITERS; ++i )
+    {
+      data.NumberOfAddedFrames[i] = 0;
+    }
+
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(NUMBER_OF_CONCURRENT_WRITERS);
+    threader->SetSingleMethod(ConcurrentWriterThread, &data);
+    threader->SingleMethodExecute();
+
+    // Each frame in the buffer shall contain the pixels of only one input frame and the timestamps shall be increasing
+    double previousTimestamp(0);
+    for ( BufferItemUidType uid = buffer->GetOldestItemUidInBuffer(); uid <= buffer->GetLatestItemUidInBuffer(); ++uid )
+    {
+      StreamBufferItem bufferItem;
+      if ( buffer->GetStreamBufferItem(uid, &bufferItem) != ITEM_OK )
+      {
+        LOG_ERROR("Failed to get item " << uid << " from the buffer");
+        return PLUS_FAIL;
+      }
+      const unsigned char expectedPixelValue = static_cast<unsigned char>(bufferItem.GetIndex() & 0xFF);
+      const unsigned char* pixels = static_cast<const unsigned char*>(bufferItem.GetFrame().GetScalarPointer());
+      for ( int i = 0; i < frameSize[0]*frameSize[1]; ++i )
+      {
+        if ( pixels[i] != expectedPixelValue )
+        {
+          LOG_ERROR("Pixel value mismatch in frame " << bufferItem.GetIndex() << " at pixel " << i << ": " << static_cast<int>(pixels[i]) << " (expected: " << static_cast<int>(expectedPixelValue) << ")");
+          return PLUS_FAIL;
+        }
+      }
+      if ( bufferItem.GetFilteredTimestamp(0) <= previousTimestamp )
+      {
+        LOG_ERROR("Timestamps are not increasing at item " << uid);
+        return PLUS_FAIL;
+      }
+      previousTimestamp = bufferItem.GetFilteredTimestamp(0);
+    }
+
+    // Frames are skipped only if the other writer has added a newer frame in the meantime, so each writer shall be able to add frames
+    PlusStatus status = PLUS_SUCCESS;
+    for ( int i = 0; i < NUMBER_OF_CONCURRENT_WRITERS; ++i )
+    {
+      LOG_INFO("Concurrent writer " << i << ": " << data.NumberOfAddedFrames[i] << " of " << numberOfFrames << " frames are added");
+      if ( data.NumberOfAddedFrames[i] == 0 )
+      {
+        LOG_ERROR("Concurrent writer " << i << " could not add any frames");
+        status = PLUS_FAIL;
+      }
+    }
+    return status;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  int numberOfFrames(100);
+  int frameSize[2] = {1920, 1080};
+  int numberOfComponents(3);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames added to the buffer in each test (Default: 100).");
+  args.AddArgument("--frame-width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[0], "Frame width in pixels (Default: 1920).");
+  args.AddArgument("--frame-height", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[1], "Frame height in pixels (Default: 1080).");
+  args.AddArgument("--number-of-components", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfComponents, "Number of scalar components per pixel, 1 or 3 (Default: 3).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( numberOfFrames < 1 || frameSize[0] < 1 || frameSize[1] < 1 || numberOfComponents < 1 )
+  {
+    std::cerr << "Invalid arguments" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<unsigned char> inputImage(frameSize[0]*frameSize[1]*numberOfComponents);
+  for ( int y = 0; y < frameSize[1]; ++y )
+  {
+    for ( int x = 0; x < frameSize[0]; ++x )
+    {
+      for ( int c = 0; c < numberOfComponents; ++c )
+      {
+        inputImage[(y*frameSize[0]+x)*numberOfComponents+c] = GetTestPixelValue(x, y, c);
+      }
+    }
+  }
+
+  int numberOfFailures(0);
+  // no flip
+  if ( RunTest(&inputImage[0], frameSize, numberOfComponents, US_IMG_ORIENT_MF, false, false, numberOfFrames) != PLUS_SUCCESS )
+  {
+    numberOfFailures++;
+  }
+  // horizontal flip
+  if ( RunTest(&inputImage[0], frameSize, numberOfComponents, US_IMG_ORIENT_UF, true, false, numberOfFrames) != PLUS_SUCCESS )
+  {
+    numberOfFailures++;
+  }
+  // vertical flip
+  if ( RunTest(&inputImage[0], frameSize, numberOfComponents, US_IMG_ORIENT_MN, false, true, numberOfFrames) != PLUS_SUCCESS )
+  {
+    numberOfFailures++;
+  }
+  // horizontal and vertical flip
+  if ( RunTest(&inputImage[0], frameSize, numberOfComponents, US_IMG_ORIENT_UN, true, true, numberOfFrames) != PLUS_SUCCESS )
+  {
+    numberOfFailures++;
+  }
+
+  // concurrent writers
+  if ( RunConcurrentWritersTest(frameSize, numberOfFrames) != PLUS_SUCCESS )
+  {
+    numberOfFailures++;
+  }
+
+  if ( numberOfFailures > 0 )
+  {
+    LOG_ERROR("vtkPlusBufferPerformanceTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkPlusBufferPerformanceTest completed successfully");
+  return EXIT_SUCCESS;
+}
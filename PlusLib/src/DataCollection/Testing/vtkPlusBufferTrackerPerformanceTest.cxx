@@ -0,0 +1,165 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferTrackerPerformanceTest.cxx
+  \brief This program measures the memory usage and the pose lookup speed of a tracker buffer
+  (high-rate pose stream, large buffer) and verifies the interpolated poses.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkAccurateTimer.h"
+#include "vtkMath.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusBuffer.h"
+#include "vtkSmartPointer.h"
+#include "vtkTransform.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <stdlib.h>
+
+namespace
+{
+  const double SAMPLING_PERIOD_SEC = 0.001; // 1 kHz tracker
+  const double TRANSLATION_PER_SAMPLE_MM = 0.1;
+  const double ROTATION_PER_SAMPLE_DEG = 0.01;
+  const double START_TIME_SEC = 10.0;
+
+  //----------------------------------------------------------------------------
+  void GetPose(double sampleIndex, vtkMatrix4x4* pose)
+  {
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+    transform->Translate(sampleIndex*TRANSLATION_PER_SAMPLE_MM, 20.0, 30.0);
+    transform->RotateZ(sampleIndex*ROTATION_PER_SAMPLE_DEG);
+    pose->DeepCopy(transform->GetMatrix());
+  }
+
+  //----------------------------------------------------------------------------
+  // Verify that the pose is the expected pose at the specified (fractional) sample index
+  PlusStatus VerifyPose(StreamBufferItem& bufferItem, double sampleIndex)
+  {
+    double pose[16];
+    bufferItem.GetMatrixElements(pose);
+    double expectedTranslationX = sampleIndex*TRANSLATION_PER_SAMPLE_MM;
+    double expectedAngleDeg = sampleIndex*ROTATION_PER_SAMPLE_DEG;
+    double angleDeg = vtkMath::DegreesFromRadians(atan2(pose[4], pose[0]));
+    if ( fabs(pose[3]-expectedTranslationX) > 1e-6 || fabs(angleDeg-expectedAngleDeg) > 1e-6 )
+    {
+      LOG_ERROR("Pose mismatch at sample " << std::fixed << sampleIndex << ": translation x = " << pose[3] << " (expected " << expectedTranslationX
+        << "), rotation = " << angleDeg << " deg (expected " << expectedAngleDeg << ")");
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Measure the pose lookup speed (in lookups per second) and verify the results
+  double MeasureLookupSpeed(vtkPlusBuffer* buffer, int bufferSize, int numberOfLookups, vtkPlusBuffer::DataItemTemporalInterpolationType interpolation,
+    bool randomOrder, int& numberOfErrors)
+  {
+    StreamBufferItem bufferItem;
+    srand(0);
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    for ( int i = 0; i < numberOfLookups; ++i )
+    {
+      // Request poses between the samples (the interpolated pose is halfway between two samples)
+      int sampleIndex = randomOrder ? rand() % (bufferSize-1) : (i/4) % (bufferSize-1);
+      double requestedSampleIndex = (interpolation == vtkPlusBuffer::INTERPOLATED) ? sampleIndex + 0.5 : sampleIndex;
+      double time = START_TIME_SEC + requestedSampleIndex * SAMPLING_PERIOD_SEC;
+      if ( buffer->GetStreamBufferItemFromTime(time, &bufferItem, interpolation) != ITEM_OK )
+      {
+        LOG_ERROR("Failed to get pose for time " << std::fixed << time);
+        numberOfErrors++;
+        return 0;
+      }
+      if ( i % 1000 == 0 && VerifyPose(bufferItem, requestedSampleIndex) != PLUS_SUCCESS )
+      {
+        numberOfErrors++;
+        return 0;
+      }
+    }
+    double elapsedTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+    if ( elapsedTimeSec <= 0 )
+    {
+      return 0;
+    }
+    return numberOfLookups/elapsedTimeSec;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  int bufferSize(5000);
+  int numberOfLookups(100000);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &bufferSize, "Number of poses in the tracker buffer (Default: 5000).");
+  args.AddArgument("--number-of-lookups", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfLookups, "Number of pose lookups in each measurement (Default: 100000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( bufferSize < 2 || numberOfLookups < 1 )
+  {
+    std::cerr << "Invalid arguments" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // Fill a tracker buffer (no frame size is set, so the buffer items only store poses)
+  vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+  buffer->SetBufferSize(bufferSize);
+  vtkSmartPointer<vtkMatrix4x4> pose = vtkSmartPointer<vtkMatrix4x4>::New();
+  double startTimeSec = vtkAccurateTimer::GetSystemTime();
+  for ( int sampleIndex = 0; sampleIndex < bufferSize; ++sampleIndex )
+  {
+    GetPose(sampleIndex, pose);
+    double timestamp = START_TIME_SEC + sampleIndex * SAMPLING_PERIOD_SEC;
+    if ( buffer->AddTimeStampedItem(pose, TOOL_OK, sampleIndex, timestamp, timestamp) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to add pose " << sampleIndex << " to the buffer");
+      return EXIT_FAILURE;
+    }
+  }
+  double addTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+
+  LOG_INFO("Tracker buffer: " << bufferSize << " poses, memory per pose: " << sizeof(StreamBufferItem)
+    << " bytes (no heap allocation per pose), average time for adding a pose: " << std::fixed << 1e6*addTimeSec/bufferSize << " us");
+
+  int numberOfErrors(0);
+  double interpolatedSequentialSpeed = MeasureLookupSpeed(buffer, bufferSize, numberOfLookups, vtkPlusBuffer::INTERPOLATED, false, numberOfErrors);
+  double interpolatedRandomSpeed = MeasureLookupSpeed(buffer, bufferSize, numberOfLookups, vtkPlusBuffer::INTERPOLATED, true, numberOfErrors);
+  double closestRandomSpeed = MeasureLookupSpeed(buffer, bufferSize, numberOfLookups, vtkPlusBuffer::CLOSEST_TIME, true, numberOfErrors);
+
+  LOG_INFO("Pose lookup speed [lookups/s]: interpolated, increasing time: " << std::fixed << interpolatedSequentialSpeed
+    << ", interpolated, random time: " << interpolatedRandomSpeed << ", closest, random time: " << closestRandomSpeed);
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("vtkPlusBufferTrackerPerformanceTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkPlusBufferTrackerPerformanceTest completed successfully");
+  return EXIT_SUCCESS;
+}
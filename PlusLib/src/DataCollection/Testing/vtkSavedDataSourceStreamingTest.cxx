@@ -0,0 +1,209 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkSavedDataSourceStreamingTest.cxx
+  \brief This program replays a sequence metafile with vtkSavedDataSource in streaming playback mode and
+  with loading the whole sequence into memory. It verifies that the same frames are replayed in both modes
+  (with looping) and reports the time to the first replayed frame and the peak memory usage.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkAccurateTimer.h"
+#include "vtkDataCollector.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDataSource.h"
+#include "vtkSavedDataSource.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <vector>
+
+namespace
+{
+  const double MAX_WAIT_TIME_SEC = 30.0;
+
+  //----------------------------------------------------------------------------
+  // Simple checksum of the image pixels, for comparing replayed frames
+  unsigned long GetFrameChecksum(PlusVideoFrame& frame)
+  {
+    const unsigned char* pixels = static_cast<const unsigned char*>(frame.GetScalarPointer());
+    const unsigned long frameSizeInBytes = frame.GetFrameSizeInBytes();
+    unsigned long checksum = 0;
+    for ( unsigned long i = 0; i < frameSizeInBytes; ++i )
+    {
+      checksum = checksum*31 + pixels[i];
+    }
+    return checksum;
+  }
+
+  //----------------------------------------------------------------------------
+  // Replay the sequence and get the checksums of the first replayed frames
+  PlusStatus ReplaySequence(vtkXMLDataElement* configRootElement, const std::string &inputMetafile, bool streamingPlayback, int numberOfFrames,
+    std::vector<unsigned long> &frameChecksums)
+  {
+    const char* modeName = streamingPlayback ? "Streaming playback" : "Loading into memory";
+
+    vtkSmartPointer<vtkDataCollector> dataCollector = vtkSmartPointer<vtkDataCollector>::New();
+    if ( dataCollector->ReadConfiguration( configRootElement ) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Configuration incorrect for vtkSavedDataSourceStreamingTest.");
+      return PLUS_FAIL;
+    }
+    vtkPlusDevice* videoDevice = NULL;
+    if ( dataCollector->GetDevice(videoDevice, "VideoDevice") != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Unable to locate the device with Id=\"VideoDevice\". Check config file.");
+      return PLUS_FAIL;
+    }
+    vtkSavedDataSource* savedDataSource = dynamic_cast<vtkSavedDataSource*>(videoDevice);
+    if ( savedDataSource == NULL )
+    {
+      LOG_ERROR( "Unable to cast video device to vtkSavedDataSource." );
+      return PLUS_FAIL;
+    }
+    savedDataSource->SetSequenceMetafile(inputMetafile.c_str());
+    savedDataSource->SetRepeatEnabled(true);
+    savedDataSource->SetStreamingPlayback(streamingPlayback);
+
+    vtkPlusDataSource* videoSource = NULL;
+    if ( savedDataSource->GetVideoSource("Video", videoSource) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Unable to locate the video source with Id=\"Video\". Check config file.");
+      return PLUS_FAIL;
+    }
+    vtkPlusBuffer* outputBuffer = videoSource->GetBuffer();
+    if ( outputBuffer->GetBufferSize() < numberOfFrames )
+    {
+      outputBuffer->SetBufferSize(numberOfFrames);
+    }
+
+    // Measure the time until the first frame is replayed
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    if ( savedDataSource->StartRecording() != PLUS_SUCCESS )
+    {
+      LOG_ERROR(modeName << ": failed to start recording");
+      return PLUS_FAIL;
+    }
+    while ( outputBuffer->GetNumberOfItems() < 1 && vtkAccurateTimer::GetSystemTime() - startTimeSec < MAX_WAIT_TIME_SEC )
+    {
+      vtkAccurateTimer::Delay(0.001);
+    }
+    double timeToFirstFrameSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+
+    // Wait until all the requested frames are replayed
+    while ( outputBuffer->GetNumberOfItems() < numberOfFrames && vtkAccurateTimer::GetSystemTime() - startTimeSec < MAX_WAIT_TIME_SEC )
+    {
+      vtkAccurateTimer::Delay(0.01);
+    }
+    savedDataSource->StopRecording();
+
+    LOG_INFO(modeName << ": time to first frame: " << std::fixed << 1000.0*timeToFirstFrameSec << " ms, peak memory usage: " << PlusCommon::GetProcessPeakMemoryUsageMb() << " MB"
+      << ", frames not read ahead: " << savedDataSource->GetNumberOfPrefetchMisses());
+
+    PlusStatus status = PLUS_SUCCESS;
+    if ( outputBuffer->GetNumberOfItems() < numberOfFrames )
+    {
+      LOG_ERROR(modeName << ": only " << outputBuffer->GetNumberOfItems() << " frames were replayed in " << MAX_WAIT_TIME_SEC << " s, expected " << numberOfFrames);
+      status = PLUS_FAIL;
+    }
+    else
+    {
+      StreamBufferItem bufferItem;
+      for ( BufferItemUidType uid = outputBuffer->GetOldestItemUidInBuffer(); uid < outputBuffer->GetOldestItemUidInBuffer() + numberOfFrames; ++uid )
+      {
+        if ( outputBuffer->GetStreamBufferItem(uid, &bufferItem) != ITEM_OK || !bufferItem.GetFrame().IsImageValid() )
+        {
+          LOG_ERROR(modeName << ": failed to get replayed frame " << uid);
+          status = PLUS_FAIL;
+          break;
+        }
+        frameChecksums.push_back(GetFrameChecksum(bufferItem.GetFrame()));
+      }
+    }
+
+    savedDataSource->Disconnect();
+    return status;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  std::string inputConfigFileName;
+  std::string inputMetafile;
+  int numberOfFrames(12);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Name of the input configuration file (shall contain a SavedDataSource device with Id=\"VideoDevice\").");
+  args.AddArgument("--video-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputMetafile, "Sequence metafile that is replayed (pixel data shall not be compressed).");
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of replayed frames that are compared (Default: 12).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( inputConfigFileName.empty() || inputMetafile.empty() || numberOfFrames < 1 )
+  {
+    std::cerr << "config-file and video-seq-file are required" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+    vtkXMLUtilities::ReadElementFromFile(inputConfigFileName.c_str()));
+  if ( configRootElement == NULL )
+  {
+    std::cerr << "Unable to read configuration from file " << inputConfigFileName.c_str() << std::endl;
+    exit( EXIT_FAILURE );
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  int numberOfErrors(0);
+
+  // Streaming playback is tested first, so that its peak memory usage is not affected by loading the whole sequence
+  std::vector<unsigned long> streamedFrameChecksums;
+  if ( ReplaySequence(configRootElement, inputMetafile, true, numberOfFrames, streamedFrameChecksums) != PLUS_SUCCESS )
+  {
+    numberOfErrors++;
+  }
+  std::vector<unsigned long> loadedFrameChecksums;
+  if ( ReplaySequence(configRootElement, inputMetafile, false, numberOfFrames, loadedFrameChecksums) != PLUS_SUCCESS )
+  {
+    numberOfErrors++;
+  }
+
+  if ( numberOfErrors == 0 && streamedFrameChecksums != loadedFrameChecksums )
+  {
+    LOG_ERROR("Frames replayed in streaming playback mode are different from the frames replayed after loading the whole sequence");
+    numberOfErrors++;
+  }
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("vtkSavedDataSourceStreamingTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkSavedDataSourceStreamingTest completed successfully");
+  return EXIT_SUCCESS;
+}
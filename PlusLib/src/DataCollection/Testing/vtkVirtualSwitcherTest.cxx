@@ -0,0 +1,258 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkVirtualSwitcherTest.cxx
+  \brief This program tests the virtual switcher device with two fake trackers. It verifies that the output stream
+  of the switcher uses the data sources of the active tracker (the frames are not copied and the timestamps are the
+  same as in the input stream), that the input buffers are not modified by the switcher, and that the switcher
+  switches to the other tracker when the active tracker stops. The CPU time per forwarded frame is reported.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkAccurateTimer.h"
+#include "vtkDataCollector.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  const double MAX_WAIT_TIME_SEC = 5.0;
+
+  //----------------------------------------------------------------------------
+  // Returns true if the output stream uses exactly the same data sources as the input stream
+  bool IsForwarding(vtkPlusChannel* outputStream, vtkPlusChannel* inputStream)
+  {
+    // The switcher replaces the data sources of the output stream from its own thread
+    PlusLockGuard<vtkPlusChannel> outputStreamGuardedLock(outputStream);
+    if ( outputStream->ToolCount() == 0 || outputStream->ToolCount() != inputStream->ToolCount() )
+    {
+      return false;
+    }
+    for ( DataSourceContainerConstIterator outputIt = outputStream->GetToolsStartConstIterator(); outputIt != outputStream->GetToolsEndConstIterator(); ++outputIt )
+    {
+      bool found = false;
+      for ( DataSourceContainerConstIterator inputIt = inputStream->GetToolsStartConstIterator(); inputIt != inputStream->GetToolsEndConstIterator(); ++inputIt )
+      {
+        if ( outputIt->second == inputIt->second )
+        {
+          // Yes, compare pointers
+          found = true;
+          break;
+        }
+      }
+      if ( !found )
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Wait until the switcher forwards one of the input streams (other than the excluded one), return NULL if timed out
+  vtkPlusChannel* WaitForActiveStream(vtkPlusChannel* outputStream, vtkPlusChannel* inputStreams[2], vtkPlusChannel* excludedStream)
+  {
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    while ( vtkAccurateTimer::GetSystemTime() - startTimeSec < MAX_WAIT_TIME_SEC )
+    {
+      for ( int i = 0; i < 2; i++ )
+      {
+        if ( inputStreams[i] != excludedStream && IsForwarding(outputStream, inputStreams[i]) )
+        {
+          return inputStreams[i];
+        }
+      }
+      vtkAccurateTimer::Delay(0.01);
+    }
+    return NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  // Check that the output stream has the same timestamps as the active input stream and the input buffer
+  // is not cleared while the frames are forwarded. Returns the number of errors.
+  int CheckForwardedFrames(vtkPlusChannel* outputStream, vtkPlusChannel* activeStream, double measurementTimeSec, double &cpuTimePerFrameSec)
+  {
+    int numberOfErrors = 0;
+    vtkPlusBuffer* inputBuffer = activeStream->GetToolsStartConstIterator()->second->GetBuffer();
+    BufferItemUidType firstUid = inputBuffer->GetLatestItemUidInBuffer();
+    int previousNumberOfItems = inputBuffer->GetNumberOfItems();
+    double previousOutputTimestamp = 0;
+
+    double startCpuTimeSec = PlusCommon::GetProcessCpuTimeSec();
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    while ( vtkAccurateTimer::GetSystemTime() - startTimeSec < measurementTimeSec )
+    {
+      vtkAccurateTimer::Delay(0.01);
+
+      // A new frame may be acquired between the reads, compare the timestamps only if the input did not change
+      double inputTimestampBefore = 0;
+      double outputTimestamp = 0;
+      double inputTimestampAfter = 0;
+      if ( activeStream->GetLatestTimestamp(inputTimestampBefore) != PLUS_SUCCESS
+        || outputStream->GetLatestTimestamp(outputTimestamp) != PLUS_SUCCESS
+        || activeStream->GetLatestTimestamp(inputTimestampAfter) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Unable to retrieve the latest timestamps of the streams");
+        numberOfErrors++;
+        continue;
+      }
+      if ( inputTimestampBefore == inputTimestampAfter && outputTimestamp != inputTimestampBefore )
+      {
+        LOG_ERROR("Latest timestamp of the output stream (" << std::fixed << outputTimestamp << ") is different from the timestamp of the active stream (" << inputTimestampBefore << ")");
+        numberOfErrors++;
+      }
+      if ( outputTimestamp < previousOutputTimestamp )
+      {
+        LOG_ERROR("Latest timestamp of the output stream decreased from " << std::fixed << previousOutputTimestamp << " to " << outputTimestamp);
+        numberOfErrors++;
+      }
+      previousOutputTimestamp = outputTimestamp;
+
+      int numberOfItems = inputBuffer->GetNumberOfItems();
+      if ( numberOfItems < previousNumberOfItems )
+      {
+        LOG_ERROR("Items were removed from the input buffer while the frames were forwarded (" << previousNumberOfItems << " -> " << numberOfItems << ")");
+        numberOfErrors++;
+      }
+      previousNumberOfItems = numberOfItems;
+    }
+    double cpuTimeSec = PlusCommon::GetProcessCpuTimeSec() - startCpuTimeSec;
+
+    BufferItemUidType numberOfForwardedFrames = inputBuffer->GetLatestItemUidInBuffer() - firstUid;
+    if ( numberOfForwardedFrames == 0 )
+    {
+      LOG_ERROR("No frames were forwarded in " << measurementTimeSec << " sec");
+      return numberOfErrors + 1;
+    }
+    cpuTimePerFrameSec = cpuTimeSec / numberOfForwardedFrames;
+    LOG_INFO("Forwarded frames: " << numberOfForwardedFrames << ", process CPU time: " << std::fixed << cpuTimeSec << " sec, CPU time per forwarded frame: " << 1000.0*cpuTimePerFrameSec << " ms");
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  std::string inputConfigFileName;
+  double measurementTimeSec(2.0);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Name of the input configuration file (shall contain two trackers with output channels TrackerStream1 and TrackerStream2 and a switcher with output channel SwitchedTrackerStream).");
+  args.AddArgument("--measurement-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &measurementTimeSec, "Time while the forwarded frames are checked, for each active stream (Default: 2.0).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( inputConfigFileName.empty() )
+  {
+    std::cerr << "config-file is required" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+    vtkXMLUtilities::ReadElementFromFile(inputConfigFileName.c_str()));
+  if ( configRootElement == NULL )
+  {
+    std::cerr << "Unable to read configuration from file " << inputConfigFileName.c_str() << std::endl;
+    exit( EXIT_FAILURE );
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkDataCollector> dataCollector = vtkSmartPointer<vtkDataCollector>::New();
+  if ( dataCollector->ReadConfiguration( configRootElement ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Configuration incorrect for vtkVirtualSwitcherTest.");
+    exit( EXIT_FAILURE );
+  }
+
+  vtkPlusChannel* inputStreams[2] = {NULL, NULL};
+  vtkPlusChannel* outputStream = NULL;
+  if ( dataCollector->GetChannel(inputStreams[0], "TrackerStream1") != PLUS_SUCCESS
+    || dataCollector->GetChannel(inputStreams[1], "TrackerStream2") != PLUS_SUCCESS
+    || dataCollector->GetChannel(outputStream, "SwitchedTrackerStream") != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Unable to locate the tracker and switcher channels. Check config file.");
+    exit( EXIT_FAILURE );
+  }
+
+  if ( dataCollector->Connect() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to connect to devices");
+    exit( EXIT_FAILURE );
+  }
+  if ( dataCollector->Start() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to start data collection");
+    dataCollector->Disconnect();
+    exit( EXIT_FAILURE );
+  }
+
+  int numberOfErrors(0);
+
+  vtkPlusChannel* activeStream = WaitForActiveStream(outputStream, inputStreams, NULL);
+  if ( activeStream == NULL )
+  {
+    LOG_ERROR("The switcher did not select any of the input streams in " << MAX_WAIT_TIME_SEC << " sec");
+    numberOfErrors++;
+  }
+  else
+  {
+    LOG_INFO("Active stream: " << activeStream->GetChannelId());
+    double cpuTimePerFrameSec = 0;
+    numberOfErrors += CheckForwardedFrames(outputStream, activeStream, measurementTimeSec, cpuTimePerFrameSec);
+
+    // Stop the active tracker, the switcher shall switch to the other one
+    double stopTimeSec = vtkAccurateTimer::GetSystemTime();
+    activeStream->GetOwnerDevice()->StopRecording();
+    vtkPlusChannel* newActiveStream = WaitForActiveStream(outputStream, inputStreams, activeStream);
+    if ( newActiveStream == NULL )
+    {
+      LOG_ERROR("The switcher did not switch from " << activeStream->GetChannelId() << " in " << MAX_WAIT_TIME_SEC << " sec after it stopped");
+      numberOfErrors++;
+    }
+    else
+    {
+      LOG_INFO("Switched to stream " << newActiveStream->GetChannelId() << " in " << std::fixed << vtkAccurateTimer::GetSystemTime() - stopTimeSec << " sec");
+      numberOfErrors += CheckForwardedFrames(outputStream, newActiveStream, measurementTimeSec, cpuTimePerFrameSec);
+    }
+  }
+
+  dataCollector->Stop();
+  dataCollector->Disconnect();
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("vtkVirtualSwitcherTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkVirtualSwitcherTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkTemporalCalibrationEstimator.h"
+
+//----------------------------------------------------------------------------
+
+vtkCxxRevisionMacro(vtkTemporalCalibrationEstimator, "$Revision: 1.0$");
+
+//----------------------------------------------------------------------------
+vtkTemporalCalibrationEstimator::vtkTemporalCalibrationEstimator()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTemporalCalibrationEstimator::~vtkTemporalCalibrationEstimator()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTemporalCalibrationEstimator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
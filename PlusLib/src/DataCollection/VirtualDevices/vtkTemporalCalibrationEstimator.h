@@ -0,0 +1,66 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkTemporalCalibrationEstimator_h
+#define __vtkTemporalCalibrationEstimator_h
+
+#include "PlusConfigure.h"
+#include "vtkObject.h"
+#include <deque>
+
+class vtkTrackedFrameList;
+class vtkXMLDataElement;
+
+/*!
+\class vtkTemporalCalibrationEstimator
+\brief Interface of the time offset estimation that is used by vtkVirtualTemporalCalibrationMonitor
+
+The data collection library does not depend on the calibration algorithms, therefore the monitor device
+computes the position signals and the time offset through this interface. The implementation is set by the
+application (e.g., vtkTemporalCalibrationAlgoEstimator of the calibration algorithms library).
+
+ComputeFixedSignal is called from the internal update thread of the monitor, EstimateMovingLag is called
+from the estimator thread of the monitor, so the two methods may run at the same time. ReadConfiguration
+is only called while the monitor is not recording.
+
+\ingroup PlusLibDataCollection
+*/
+class VTK_EXPORT vtkTemporalCalibrationEstimator : public vtkObject
+{
+public:
+  vtkTypeRevisionMacro(vtkTemporalCalibrationEstimator, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+
+  /*! Read the estimation parameters from the element of the monitor device */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* deviceConfig) = 0;
+
+  /*!
+    Compute the position signal from the video (fixed) frames. Only the newly acquired frames are passed,
+    the signal values of the frames that are successfully processed are appended to the output.
+  */
+  virtual PlusStatus ComputeFixedSignal(vtkTrackedFrameList* fixedFrames, std::deque<double> &signalTimestamps, std::deque<double> &signalValues) = 0;
+
+  /*!
+    Compute the time [s] by which the tracker (moving) frames lag the fixed signal.
+    If the lag < 0, the moving frames lead the fixed signal.
+  */
+  virtual PlusStatus EstimateMovingLag(const std::deque<double> &fixedSignalTimestamps, const std::deque<double> &fixedSignalValues,
+    vtkTrackedFrameList* movingFrames, const char* movingProbeToReferenceTransformName, double maximumMovingLagSec,
+    double &movingLagSec, double &calibrationError) = 0;
+
+  /*! Estimation is skipped if the fixed signal varies less than this, as the lag cannot be computed if the probe is not moving */
+  virtual double GetMinimumFixedSignalPeakToPeak() = 0;
+
+protected:
+  vtkTemporalCalibrationEstimator();
+  virtual ~vtkTemporalCalibrationEstimator();
+
+private:
+  vtkTemporalCalibrationEstimator(const vtkTemporalCalibrationEstimator&);  // Not implemented.
+  void operator=(const vtkTemporalCalibrationEstimator&);  // Not implemented.
+};
+
+#endif
@@ -19,6 +19,7 @@ vtkStandardNewMacro(vtkVirtualDiscCapture);
 
 static const int MAX_ALLOWED_RECORDING_LAG_SEC = 3.0; // if the recording lags more than this then it'll skip frames to catch up
 static const int DISABLE_FRAME_BUFFER = -1;
+static const int MAX_NUMBER_OF_RECYCLED_FRAMES = 20; // recorded frames are kept for reuse after writing, to avoid image allocation for each recorded frame
 
 //----------------------------------------------------------------------------
 vtkVirtualDiscCapture::vtkVirtualDiscCapture()
@@ -44,6 +45,7 @@ vtkVirtualDiscCapture::vtkVirtualDiscCapture()
 {
   this->MissingInputGracePeriodSec=2.0;
   m_RecordedFrames->SetValidationRequirements(REQUIRE_UNIQUE_TIMESTAMP); 
+  m_RecordedFrames->SetMaxNumberOfRecycledFrames(MAX_NUMBER_OF_RECYCLED_FRAMES);
 
   // The data capture thread will be used to regularly read the frames and write to disk
   this->StartThreadForInternalUpdates = true;
@@ -296,6 +298,8 @@ PlusStatus vtkVirtualDiscCapture::CloseFile(const char* aFilename)
   m_HeaderPrepared = false;
   this->TotalFramesRecorded = 0;
   m_RecordedFrames->Clear();
+  // Recording of this file is completed, the image buffers are not kept until the next recording
+  m_RecordedFrames->ReleaseRecycledFrames();
 
   if ( OpenFile() != PLUS_SUCCESS )
   {
@@ -568,6 +572,7 @@ PlusStatus vtkVirtualDiscCapture::Reset()
     }
 
     this->ClearRecordedFrames();
+    m_RecordedFrames->ReleaseRecycledFrames();
     this->m_Writer->GetTrackedFrameList()->Clear();
     m_HeaderPrepared = false;
     TotalFramesRecorded = 0;
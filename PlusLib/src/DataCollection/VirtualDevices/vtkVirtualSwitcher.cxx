@@ -22,6 +22,7 @@ vtkVirtualSwitcher::vtkVirtualSwitcher()
 : vtkPlusDevice()
 , CurrentActiveInputStream(NULL)
 , OutputStream(NULL)
+, ForwardedInputStream(NULL)
 , FramesWhileInactive(0)
 {
   this->AcquisitionRate = vtkPlusDevice::VIRTUAL_DEVICE_FRAME_RATE;
@@ -73,46 +74,38 @@ PlusStatus vtkVirtualSwitcher::InternalUpdate()
   //    correctly detect this situation and wait a few frames before switching
       // if timestamp not changed within 'FRAME_COUNT_BEFORE_INACTIVE' frames, then do new stream check
 
+  if( this->CurrentActiveInputStream == NULL )
+  {
+    // No stream is active yet (or all of them stopped), check if any of them has new data
+    this->SelectActiveStream();
+    return PLUS_SUCCESS;
+  }
+
   double latestCurrentTimestamp(0);
-  if( this->CurrentActiveInputStream != NULL )
+  if( this->CurrentActiveInputStream->GetLatestTimestamp(latestCurrentTimestamp) != PLUS_SUCCESS )
   {
-    if( this->CurrentActiveInputStream->GetLatestTimestamp(latestCurrentTimestamp) != PLUS_SUCCESS )
-    {
-      LOG_ERROR("Unable to retrieve timestamp from active stream.");
-      return PLUS_FAIL;
-    }
-    if( this->LastRecordedTimestampMap[this->CurrentActiveInputStream] == 0 )
-    {
-      this->LastRecordedTimestampMap[this->CurrentActiveInputStream] = latestCurrentTimestamp;
-      return PLUS_SUCCESS;
-    }
+    LOG_ERROR("Unable to retrieve timestamp from active stream.");
+    return PLUS_FAIL;
+  }
 
-    if( latestCurrentTimestamp > this->LastRecordedTimestampMap[this->CurrentActiveInputStream] )
-    {
-      // Device is still active
-      return PLUS_SUCCESS;
-    }
-    else
-    {
-      if( FramesWhileInactive >= FRAME_COUNT_BEFORE_INACTIVE )
-      {
-        this->FramesWhileInactive = 0;
-        // Device is no longer active
-        if( this->SelectActiveStream() == PLUS_FAIL )
-        {
-          // No active devices, don't copy anything!
-          return PLUS_SUCCESS;
-        }
-      }
-      else
-      {
-        FramesWhileInactive++;
-      }
-    }
+  if( latestCurrentTimestamp > this->LastRecordedTimestampMap[this->CurrentActiveInputStream] )
+  {
+    // Device is still active
+    this->LastRecordedTimestampMap[this->CurrentActiveInputStream] = latestCurrentTimestamp;
+    this->FramesWhileInactive = 0;
+    return PLUS_SUCCESS;
+  }
 
-    this->CopyInputStreamToOutputStream();
+  if( this->FramesWhileInactive < FRAME_COUNT_BEFORE_INACTIVE )
+  {
+    this->FramesWhileInactive++;
+    return PLUS_SUCCESS;
   }
 
+  // Device is no longer active. If no other stream has new data then the output stream keeps the data sources of the last active stream.
+  this->FramesWhileInactive = 0;
+  this->SelectActiveStream();
+
   return PLUS_SUCCESS;
 }
 
@@ -127,7 +120,8 @@ PlusStatus vtkVirtualSwitcher::SelectActiveStream()
     double latestTimestamp(0);
     if( aStream->GetLatestTimestamp(latestTimestamp) != PLUS_SUCCESS )
     {
-      LOG_ERROR("Unable to retrieve latest timestamp from stream.");
+      // No data has been acquired yet
+      LOG_TRACE("Unable to retrieve latest timestamp from stream.");
       continue;
     }
     if( latestTimestamp > this->LastRecordedTimestampMap[aStream] )
@@ -193,6 +187,7 @@ PlusStatus vtkVirtualSwitcher::ReadConfiguration( vtkXMLDataElement* element)
 PlusStatus vtkVirtualSwitcher::NotifyConfigured()
 {
   this->LastRecordedTimestampMap.clear();
+  this->ForwardedInputStream = NULL;
 
   for( ChannelContainerConstIterator it = this->InputChannels.begin(); it != this->InputChannels.end(); ++it )
   {
@@ -206,12 +201,16 @@ PlusStatus vtkVirtualSwitcher::NotifyConfigured()
 //----------------------------------------------------------------------------
 PlusStatus vtkVirtualSwitcher::CopyInputStreamToOutputStream()
 {
-  // Only destroy if things have to change
-  if( this->CurrentActiveInputStream != NULL )
+  // Only change the output stream if the active stream has changed
+  if( this->CurrentActiveInputStream == NULL || this->OutputStream == NULL || this->CurrentActiveInputStream == this->ForwardedInputStream )
   {
-    // no need to do a deep copy, iterators are used to access data anyways
-    this->OutputStream->ShallowCopy(*this->CurrentActiveInputStream);
+    return PLUS_SUCCESS;
   }
 
+  // no need to do a deep copy, the output stream uses the data sources of the active stream,
+  // so consumers read the frames directly from the buffers of the input device
+  this->OutputStream->ShallowCopy(*this->CurrentActiveInputStream);
+  this->ForwardedInputStream = this->CurrentActiveInputStream;
+
   return PLUS_SUCCESS;
 }
\ No newline at end of file
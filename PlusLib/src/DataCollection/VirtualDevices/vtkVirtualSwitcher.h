@@ -13,7 +13,10 @@ See License.txt for details.
 
 /*!
 \class vtkVirtualSwitcher
-\brief 
+\brief Virtual device that outputs the input stream that is currently acquiring data
+
+The output stream uses the data sources of the active input stream (no frames are copied). When the active
+stream stops acquiring data, the first input stream with new data becomes the active stream.
 
 \ingroup PlusLibDataCollection
 */
@@ -46,6 +49,7 @@ protected:
 
   PlusStatus SelectActiveStream();
 
+  /*! Make the output stream use the data sources of the active input stream, if the active stream has changed */
   PlusStatus CopyInputStreamToOutputStream();
 
   vtkVirtualSwitcher();
@@ -59,6 +63,8 @@ protected:
   vtkPlusChannel*                    CurrentActiveInputStream;
   std::map<vtkPlusChannel*, double>  LastRecordedTimestampMap;
   vtkPlusChannel*                    OutputStream;
+  /*! Input stream whose data sources are currently used by the output stream (not reference counted) */
+  vtkPlusChannel*                    ForwardedInputStream;
 
   unsigned long FramesWhileInactive;
 
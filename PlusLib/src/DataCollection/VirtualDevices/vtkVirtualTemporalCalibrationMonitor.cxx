@@ -0,0 +1,587 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkVirtualTemporalCalibrationMonitor.h"
+#include "TrackedFrame.h"
+#include "vtkObjectFactory.h"
+#include "vtkTrackedFrameList.h"
+#include "vtkXMLDataElement.h"
+
+//----------------------------------------------------------------------------
+
+vtkCxxRevisionMacro(vtkVirtualTemporalCalibrationMonitor, "$Revision: 1.0$");
+vtkStandardNewMacro(vtkVirtualTemporalCalibrationMonitor);
+
+static const int MAX_NUMBER_OF_FIXED_FRAMES_ADDED_PER_UPDATE=50;
+static const int MAX_NUMBER_OF_MOVING_FRAMES_ADDED_PER_UPDATE=500;
+static const double ESTIMATOR_THREAD_IDLE_DELAY_SEC=0.05;
+
+//----------------------------------------------------------------------------
+// vtkPlusChannel::GetTrackedFrameList returns the frames starting from the last frame that was returned by
+// the previous call, so the first returned frame may already be in the window
+static void RemoveAlreadyAddedFrames(vtkTrackedFrameList* frames, int firstNewFrameIndex, double lastAddedFrameTimestamp)
+{
+  if (lastAddedFrameTimestamp <= 0)
+  {
+    // no frames were added yet
+    return;
+  }
+  int numberOfFrames = frames->GetNumberOfTrackedFrames();
+  int lastFrameIndexToRemove = firstNewFrameIndex-1;
+  while (lastFrameIndexToRemove+1 < numberOfFrames && frames->GetTrackedFrame(lastFrameIndexToRemove+1)->GetTimestamp() <= lastAddedFrameTimestamp)
+  {
+    lastFrameIndexToRemove++;
+  }
+  if (lastFrameIndexToRemove >= firstNewFrameIndex)
+  {
+    frames->RemoveTrackedFrameRange(firstNewFrameIndex, lastFrameIndexToRemove);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkVirtualTemporalCalibrationMonitor::vtkVirtualTemporalCalibrationMonitor()
+: vtkPlusDevice()
+, MovingProbeToReferenceTransformName(NULL)
+, WindowSec(10.0)
+, UpdatePeriodSec(5.0)
+, MaximumMovingLagSec(0.5)
+, MinimumLagChangeSec(0.005)
+, ApplyTimeOffset(false)
+, LastFixedFrameTimestamp(0)
+, LastMovingFrameTimestamp(0)
+, LastEstimationRequestTime(0.0)
+, EstimationRequested(false)
+, LatestEstimateValid(false)
+, LatestMovingLagSec(0.0)
+, LatestCalibrationError(0.0)
+, NumberOfEstimates(0)
+, WindowResetRequested(false)
+, EstimatorThreadId(-1)
+, EstimatorThreadAlive(false)
+, EstimatorThreadStopRequested(false)
+{
+  this->MovingWindowFrames=vtkSmartPointer<vtkTrackedFrameList>::New();
+  this->NewFrames=vtkSmartPointer<vtkTrackedFrameList>::New();
+  this->EstimatorMovingFrames=vtkSmartPointer<vtkTrackedFrameList>::New();
+  this->EstimatorMutex=vtkSmartPointer<vtkRecursiveCriticalSection>::New();
+
+  // The data capture thread is used for collecting the samples, the estimation runs in a separate thread
+  this->StartThreadForInternalUpdates = true;
+  this->AcquisitionRate = 10;
+}
+
+//----------------------------------------------------------------------------
+vtkVirtualTemporalCalibrationMonitor::~vtkVirtualTemporalCalibrationMonitor()
+{
+  if (this->EstimatorThreadAlive)
+  {
+    this->InternalStopRecording();
+  }
+  SetMovingProbeToReferenceTransformName(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkVirtualTemporalCalibrationMonitor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "MovingProbeToReferenceTransformName: " << (this->MovingProbeToReferenceTransformName ? this->MovingProbeToReferenceTransformName : "(none)") << std::endl;
+  os << indent << "WindowSec: " << this->WindowSec << std::endl;
+  os << indent << "UpdatePeriodSec: " << this->UpdatePeriodSec << std::endl;
+  os << indent << "MaximumMovingLagSec: " << this->MaximumMovingLagSec << std::endl;
+  os << indent << "MinimumLagChangeSec: " << this->MinimumLagChangeSec << std::endl;
+  os << indent << "ApplyTimeOffset: " << (this->ApplyTimeOffset ? "TRUE" : "FALSE") << std::endl;
+  if (this->Estimator.GetPointer() != NULL)
+  {
+    os << indent << "Estimator: " << std::endl;
+    this->Estimator->PrintSelf(os, indent.GetNextIndent());
+  }
+
+  PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+  os << indent << "NumberOfEstimates: " << this->NumberOfEstimates << std::endl;
+  if (this->LatestEstimateValid)
+  {
+    os << indent << "LatestMovingLagSec: " << this->LatestMovingLagSec << std::endl;
+    os << indent << "LatestCalibrationError: " << this->LatestCalibrationError << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::ReadConfiguration( vtkXMLDataElement* rootConfig)
+{
+  if( Superclass::ReadConfiguration(rootConfig) == PLUS_FAIL )
+  {
+    return PLUS_FAIL;
+  }
+
+  vtkXMLDataElement* deviceElement = this->FindThisDeviceElement(rootConfig);
+  if (deviceElement == NULL)
+  {
+    LOG_ERROR("Cannot find VirtualTemporalCalibrationMonitor element in XML tree!");
+    return PLUS_FAIL;
+  }
+
+  const char* movingProbeToReferenceTransformName = deviceElement->GetAttribute("MovingProbeToReferenceTransformName");
+  if (movingProbeToReferenceTransformName == NULL)
+  {
+    LOG_ERROR("MovingProbeToReferenceTransformName attribute is missing in VirtualTemporalCalibrationMonitor device configuration");
+    return PLUS_FAIL;
+  }
+  this->SetMovingProbeToReferenceTransformName(movingProbeToReferenceTransformName);
+
+  double windowSec = 0;
+  if ( deviceElement->GetScalarAttribute("WindowSec", windowSec) )
+  {
+    this->WindowSec = windowSec;
+  }
+
+  double updatePeriodSec = 0;
+  if ( deviceElement->GetScalarAttribute("UpdatePeriodSec", updatePeriodSec) )
+  {
+    this->UpdatePeriodSec = updatePeriodSec;
+  }
+
+  double maximumMovingLagSec = 0;
+  if ( deviceElement->GetScalarAttribute("MaximumMovingLagSec", maximumMovingLagSec) )
+  {
+    this->MaximumMovingLagSec = maximumMovingLagSec;
+  }
+
+  double minimumLagChangeSec = 0;
+  if ( deviceElement->GetScalarAttribute("MinimumLagChangeSec", minimumLagChangeSec) )
+  {
+    this->MinimumLagChangeSec = minimumLagChangeSec;
+  }
+
+  const char* applyTimeOffset = deviceElement->GetAttribute("ApplyTimeOffset");
+  if( applyTimeOffset != NULL )
+  {
+    this->ApplyTimeOffset = STRCASECMP(applyTimeOffset, "true") == 0 ? true : false;
+  }
+
+  if (this->WindowSec < 2*this->MaximumMovingLagSec)
+  {
+    LOG_WARNING("VirtualTemporalCalibrationMonitor WindowSec ("<<this->WindowSec<<") is too short compared to MaximumMovingLagSec ("<<this->MaximumMovingLagSec<<")");
+  }
+
+  // The estimator may be set after the configuration is read, so keep the configuration until the device is connected
+  this->EstimatorConfiguration = vtkSmartPointer<vtkXMLDataElement>::New();
+  this->EstimatorConfiguration->DeepCopy(deviceElement);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::WriteConfiguration( vtkXMLDataElement* rootConfig)
+{
+  if( Superclass::WriteConfiguration(rootConfig) == PLUS_FAIL )
+  {
+    return PLUS_FAIL;
+  }
+
+  vtkXMLDataElement* deviceElement = this->FindThisDeviceElement(rootConfig);
+  if (deviceElement == NULL)
+  {
+    LOG_ERROR("Cannot find VirtualTemporalCalibrationMonitor element in XML tree!");
+    return PLUS_FAIL;
+  }
+
+  deviceElement->SetAttribute("MovingProbeToReferenceTransformName", this->MovingProbeToReferenceTransformName);
+  deviceElement->SetDoubleAttribute("WindowSec", this->WindowSec);
+  deviceElement->SetDoubleAttribute("UpdatePeriodSec", this->UpdatePeriodSec);
+  deviceElement->SetDoubleAttribute("MaximumMovingLagSec", this->MaximumMovingLagSec);
+  deviceElement->SetDoubleAttribute("MinimumLagChangeSec", this->MinimumLagChangeSec);
+  deviceElement->SetAttribute("ApplyTimeOffset", this->ApplyTimeOffset ? "TRUE" : "FALSE" );
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::NotifyConfigured()
+{
+  if( this->InputChannels.size() != 2 )
+  {
+    LOG_ERROR("VirtualTemporalCalibrationMonitor requires exactly two input channels: a video (fixed) and a tracker (moving) channel");
+    this->SetCorrectlyConfigured(false);
+    return PLUS_FAIL;
+  }
+
+  if( !this->InputChannels[0]->HasVideoSource() )
+  {
+    LOG_ERROR("The first input channel of VirtualTemporalCalibrationMonitor ("<<this->InputChannels[0]->GetChannelId()<<") must contain video data");
+    this->SetCorrectlyConfigured(false);
+    return PLUS_FAIL;
+  }
+
+  if( this->InputChannels[1]->HasVideoSource() )
+  {
+    LOG_WARNING("The second input channel of VirtualTemporalCalibrationMonitor ("<<this->InputChannels[1]->GetChannelId()<<") contains video data. "
+      <<"Only tracking data is used from this channel, use a channel without video to reduce memory usage.");
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::InternalConnect()
+{
+  if (this->Estimator.GetPointer() == NULL)
+  {
+    LOG_ERROR("Failed to connect VirtualTemporalCalibrationMonitor: no estimator is set");
+    return PLUS_FAIL;
+  }
+  if (this->EstimatorConfiguration.GetPointer() != NULL && this->Estimator->ReadConfiguration(this->EstimatorConfiguration) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to connect VirtualTemporalCalibrationMonitor: invalid estimator configuration");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::InternalDisconnect()
+{
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::InternalStartRecording()
+{
+  this->ClearWindow();
+  this->LastEstimationRequestTime = vtkAccurateTimer::GetSystemTime();
+
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+    this->EstimationRequested = false;
+    this->WindowResetRequested = false;
+    this->LatestEstimateValid = false;
+    this->NumberOfEstimates = 0;
+  }
+
+  this->EstimatorThreadStopRequested = false;
+  this->EstimatorThreadAlive = true;
+  this->EstimatorThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&EstimatorThread, this);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::InternalStopRecording()
+{
+  LOG_DEBUG("Wait for temporal calibration estimator thread to terminate");
+  this->EstimatorThreadStopRequested = true;
+  while ( this->EstimatorThreadAlive )
+  {
+    vtkAccurateTimer::Delay(0.1);
+  }
+  this->EstimatorThreadId = -1;
+  LOG_DEBUG("Temporal calibration estimator thread terminated");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::InternalUpdate()
+{
+  PlusStatus status = PLUS_SUCCESS;
+  {
+    // The time offset of the moving device is only changed while the estimator mutex is held,
+    // so the moving frames cannot be requested with a timestamp that was valid before the change
+    PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+    if (this->WindowResetRequested)
+    {
+      // The time offset of the moving device has been changed, samples in the window are not consistent anymore
+      this->ClearWindow();
+      this->LastEstimationRequestTime = vtkAccurateTimer::GetSystemTime();
+      this->WindowResetRequested = false;
+    }
+    if (this->UpdateMovingWindow() != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+  if (this->UpdateFixedWindow() != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+  this->TrimWindow();
+
+  if (vtkAccurateTimer::GetSystemTime() - this->LastEstimationRequestTime >= this->UpdatePeriodSec)
+  {
+    this->RequestEstimation();
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::UpdateFixedWindow()
+{
+  this->NewFrames->Clear();
+  double lastAddedFrameTimestamp = this->LastFixedFrameTimestamp;
+  if ( this->InputChannels[0]->GetTrackedFrameList(this->LastFixedFrameTimestamp, this->NewFrames, MAX_NUMBER_OF_FIXED_FRAMES_ADDED_PER_UPDATE) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to get video frames for temporal calibration monitoring from channel " << this->InputChannels[0]->GetChannelId());
+    return PLUS_FAIL;
+  }
+  RemoveAlreadyAddedFrames(this->NewFrames, 0, lastAddedFrameTimestamp);
+  if (this->NewFrames->GetNumberOfTrackedFrames() == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // Only the new frames are processed, line positions of earlier frames are already in the window
+  if ( this->Estimator->ComputeFixedSignal(this->NewFrames, this->FixedWindowTimestamps, this->FixedWindowValues) != PLUS_SUCCESS )
+  {
+    LOG_DEBUG("Line detection failed on the new video frames, frames are skipped");
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::UpdateMovingWindow()
+{
+  int firstNewFrameIndex = this->MovingWindowFrames->GetNumberOfTrackedFrames();
+  double lastAddedFrameTimestamp = this->LastMovingFrameTimestamp;
+  if ( this->InputChannels[1]->GetTrackedFrameList(this->LastMovingFrameTimestamp, this->MovingWindowFrames, MAX_NUMBER_OF_MOVING_FRAMES_ADDED_PER_UPDATE) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to get tracker frames for temporal calibration monitoring from channel " << this->InputChannels[1]->GetChannelId());
+    return PLUS_FAIL;
+  }
+  RemoveAlreadyAddedFrames(this->MovingWindowFrames, firstNewFrameIndex, lastAddedFrameTimestamp);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkVirtualTemporalCalibrationMonitor::TrimWindow()
+{
+  double newestTimestamp = UNDEFINED_TIMESTAMP;
+  if (!this->FixedWindowTimestamps.empty())
+  {
+    newestTimestamp = this->FixedWindowTimestamps.back();
+  }
+  int numberOfMovingFrames = this->MovingWindowFrames->GetNumberOfTrackedFrames();
+  if (numberOfMovingFrames > 0)
+  {
+    double newestMovingTimestamp = this->MovingWindowFrames->GetTrackedFrame(numberOfMovingFrames-1)->GetTimestamp();
+    if (newestTimestamp == UNDEFINED_TIMESTAMP || newestMovingTimestamp > newestTimestamp)
+    {
+      newestTimestamp = newestMovingTimestamp;
+    }
+  }
+  if (newestTimestamp == UNDEFINED_TIMESTAMP)
+  {
+    // empty window
+    return;
+  }
+  double oldestTimestampToKeep = newestTimestamp - this->WindowSec;
+
+  while (!this->FixedWindowTimestamps.empty() && this->FixedWindowTimestamps.front() < oldestTimestampToKeep)
+  {
+    this->FixedWindowTimestamps.pop_front();
+    this->FixedWindowValues.pop_front();
+  }
+
+  int numberOfMovingFramesToRemove = 0;
+  while (numberOfMovingFramesToRemove < numberOfMovingFrames
+    && this->MovingWindowFrames->GetTrackedFrame(numberOfMovingFramesToRemove)->GetTimestamp() < oldestTimestampToKeep)
+  {
+    numberOfMovingFramesToRemove++;
+  }
+  if (numberOfMovingFramesToRemove > 0)
+  {
+    this->MovingWindowFrames->RemoveTrackedFrameRange(0, numberOfMovingFramesToRemove-1);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkVirtualTemporalCalibrationMonitor::ClearWindow()
+{
+  this->FixedWindowTimestamps.clear();
+  this->FixedWindowValues.clear();
+  this->MovingWindowFrames->Clear();
+  // Start from the most recent frames
+  this->LastFixedFrameTimestamp = 0;
+  this->LastMovingFrameTimestamp = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkVirtualTemporalCalibrationMonitor::RequestEstimation()
+{
+  if (this->FixedWindowTimestamps.empty() || this->MovingWindowFrames->GetNumberOfTrackedFrames() == 0)
+  {
+    LOG_DEBUG("Temporal calibration estimation is skipped: no data in the window");
+    return;
+  }
+  if (this->FixedWindowTimestamps.back() - this->FixedWindowTimestamps.front() < 0.5 * this->WindowSec)
+  {
+    LOG_DEBUG("Temporal calibration estimation is skipped: window is not filled yet");
+    return;
+  }
+
+  // If the probe was not moving then correlation is meaningless, don't waste time on computing it
+  double minValue = this->FixedWindowValues.front();
+  double maxValue = this->FixedWindowValues.front();
+  for (std::deque<double>::const_iterator it = this->FixedWindowValues.begin(); it != this->FixedWindowValues.end(); ++it)
+  {
+    if (*it < minValue)
+    {
+      minValue = *it;
+    }
+    if (*it > maxValue)
+    {
+      maxValue = *it;
+    }
+  }
+  if (maxValue - minValue < this->Estimator->GetMinimumFixedSignalPeakToPeak())
+  {
+    LOG_DEBUG("Temporal calibration estimation is skipped: not enough motion in the video signal");
+    this->LastEstimationRequestTime = vtkAccurateTimer::GetSystemTime();
+    return;
+  }
+
+  PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+  if (this->EstimationRequested || this->WindowResetRequested)
+  {
+    // Previous estimation is still in progress or its result has not been applied to the window yet, try again later
+    return;
+  }
+  this->EstimatorFixedTimestamps = this->FixedWindowTimestamps;
+  this->EstimatorFixedValues = this->FixedWindowValues;
+  this->EstimatorMovingFrames->Clear();
+  this->EstimatorMovingFrames->AddTrackedFrameList(this->MovingWindowFrames);
+  this->EstimationRequested = true;
+  this->LastEstimationRequestTime = vtkAccurateTimer::GetSystemTime();
+}
+
+//----------------------------------------------------------------------------
+void vtkVirtualTemporalCalibrationMonitor::RunEstimation()
+{
+  // The estimator inputs are only modified by RequestEstimation while EstimationRequested is false,
+  // so they can be used without holding the mutex during the computation
+  double movingLagSec = 0;
+  double calibrationError = 0;
+  PlusStatus status = this->Estimator->EstimateMovingLag(this->EstimatorFixedTimestamps, this->EstimatorFixedValues,
+    this->EstimatorMovingFrames, this->MovingProbeToReferenceTransformName, this->MaximumMovingLagSec, movingLagSec, calibrationError);
+  if (status != PLUS_SUCCESS)
+  {
+    LOG_DEBUG("Temporal calibration estimation failed");
+  }
+
+  bool applyTimeOffset = false;
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+    if (status == PLUS_SUCCESS)
+    {
+      this->LatestEstimateValid = true;
+      this->LatestMovingLagSec = movingLagSec;
+      this->LatestCalibrationError = calibrationError;
+      this->NumberOfEstimates++;
+      LOG_INFO("Temporal calibration monitor: moving lag = "<<movingLagSec<<" sec, calibration error = "<<calibrationError);
+      applyTimeOffset = this->ApplyTimeOffset && fabs(movingLagSec) >= this->MinimumLagChangeSec;
+    }
+    if (!applyTimeOffset)
+    {
+      this->EstimationRequested = false;
+      return;
+    }
+  }
+
+  // SetLocalTimeOffsetSec locks the update mutex of the moving device, so the offset is not changed while the
+  // device is adding items to its buffers. The estimator mutex is held, so the monitor does not read the moving
+  // frames while the offset is changed.
+  PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+  vtkPlusDevice* movingDevice = this->InputChannels[1]->GetOwnerDevice();
+  double currentOffsetSec = movingDevice->GetLocalTimeOffsetSec();
+  movingDevice->SetLocalTimeOffsetSec(currentOffsetSec - movingLagSec);
+  LOG_INFO("Local time offset of device "<<movingDevice->GetDeviceId()<<" is changed from "<<currentOffsetSec<<" to "<<currentOffsetSec - movingLagSec<<" sec");
+
+  // The window contains samples with the old offset, it is cleared before the next estimation is requested
+  this->WindowResetRequested = true;
+  this->EstimationRequested = false;
+}
+
+//----------------------------------------------------------------------------
+void* vtkVirtualTemporalCalibrationMonitor::EstimatorThread(vtkMultiThreader::ThreadInfo *data)
+{
+  vtkVirtualTemporalCalibrationMonitor *self = (vtkVirtualTemporalCalibrationMonitor *)(data->UserData);
+
+  while ( !self->EstimatorThreadStopRequested )
+  {
+    bool estimationRequested = false;
+    {
+      PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(self->EstimatorMutex);
+      estimationRequested = self->EstimationRequested;
+    }
+    if (estimationRequested)
+    {
+      self->RunEstimation();
+    }
+    else
+    {
+      vtkAccurateTimer::Delay(ESTIMATOR_THREAD_IDLE_DELAY_SEC);
+    }
+  }
+
+  self->EstimatorThreadAlive = false;
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::GetLatestMovingLagSec(double &lagSec)
+{
+  PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+  if (!this->LatestEstimateValid)
+  {
+    return PLUS_FAIL;
+  }
+  lagSec = this->LatestMovingLagSec;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkVirtualTemporalCalibrationMonitor::GetLatestCalibrationError(double &error)
+{
+  PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+  if (!this->LatestEstimateValid)
+  {
+    return PLUS_FAIL;
+  }
+  error = this->LatestCalibrationError;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int vtkVirtualTemporalCalibrationMonitor::GetNumberOfEstimates()
+{
+  PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+  return this->NumberOfEstimates;
+}
+
+//----------------------------------------------------------------------------
+void vtkVirtualTemporalCalibrationMonitor::ResetWindow()
+{
+  PlusLockGuard<vtkRecursiveCriticalSection> estimatorLock(this->EstimatorMutex);
+  this->WindowResetRequested = true;
+}
+
+//----------------------------------------------------------------------------
+void vtkVirtualTemporalCalibrationMonitor::SetEstimator(vtkTemporalCalibrationEstimator* estimator)
+{
+  if (this->IsRecording())
+  {
+    LOG_ERROR("The estimator of VirtualTemporalCalibrationMonitor cannot be changed while recording");
+    return;
+  }
+  this->Estimator = estimator;
+}
+
+//----------------------------------------------------------------------------
+vtkTemporalCalibrationEstimator* vtkVirtualTemporalCalibrationMonitor::GetEstimator()
+{
+  return this->Estimator;
+}
@@ -0,0 +1,219 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkVirtualTemporalCalibrationMonitor_h
+#define __vtkVirtualTemporalCalibrationMonitor_h
+
+#include "vtkPlusDevice.h"
+#include "vtkPlusChannel.h"
+#include "vtkTemporalCalibrationEstimator.h"
+#include <deque>
+#include <string>
+
+class vtkTrackedFrameList;
+
+/*!
+\class vtkVirtualTemporalCalibrationMonitor
+\brief Continuously estimates the time offset between a video and a tracker input channel
+
+The device keeps a sliding window of the most recent line positions detected on the video
+(fixed) channel and of the most recent probe poses of the tracker (moving) channel.
+Line detection is performed incrementally on the newly acquired frames in the internal update
+thread, so that the (expensive) image processing is not repeated for each estimation.
+Periodically the window contents are passed to the time offset estimation, which runs in a separate
+estimator thread, so that data acquisition is never blocked by the computation.
+
+The line detection and the time offset estimation are performed by a vtkTemporalCalibrationEstimator,
+which has to be set by the application before connecting the device (e.g., vtkTemporalCalibrationAlgoEstimator
+of the calibration algorithms library). The whole device element is passed to the ReadConfiguration method
+of the estimator.
+
+The data collection library cannot create the estimator, therefore the device is not registered in
+vtkPlusDeviceFactory. The application creates the device, reads its configuration from the Device element
+that has the same Id, adds the input channels and sets the estimator.
+
+The latest estimate can be queried at any time. If ApplyTimeOffset is enabled then the estimated
+lag is applied to the local time offset of the device that owns the moving channel. The offset is changed
+from the estimator thread, vtkPlusDevice::SetLocalTimeOffsetSec locks the update mutex of the device.
+
+Example configuration:
+\code
+<Device Id="TemporalCalibrationMonitor" Type="VirtualTemporalCalibrationMonitor"
+  MovingProbeToReferenceTransformName="ProbeToReference"
+  WindowSec="10" UpdatePeriodSec="5" MaximumMovingLagSec="0.5"
+  MinimumLagChangeSec="0.005" ApplyTimeOffset="FALSE" >
+  <InputChannels>
+    <InputChannel Id="VideoStream" />
+    <InputChannel Id="TrackerStream" />
+  </InputChannels>
+  <vtkTemporalCalibrationAlgo ClipRectangleOrigin="27 27" ClipRectangleSize="766 562" />
+</Device>
+\endcode
+
+\ingroup PlusLibDataCollection
+*/
+class VTK_EXPORT vtkVirtualTemporalCalibrationMonitor : public vtkPlusDevice
+{
+public:
+  static vtkVirtualTemporalCalibrationMonitor *New();
+  vtkTypeRevisionMacro(vtkVirtualTemporalCalibrationMonitor, vtkPlusDevice);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /*!
+    Get the most recent estimate of the moving (tracker) lag relative to the fixed (video) channel.
+    Returns PLUS_FAIL if no successful estimate is available yet.
+    This method is safe to be called from any thread.
+  */
+  PlusStatus GetLatestMovingLagSec(double &lagSec);
+
+  /*!
+    Get the alignment error of the most recent estimate.
+    Returns PLUS_FAIL if no successful estimate is available yet.
+    This method is safe to be called from any thread.
+  */
+  PlusStatus GetLatestCalibrationError(double &error);
+
+  /*!
+    Get the number of successful estimates since the recording has been started.
+    This method is safe to be called from any thread.
+  */
+  int GetNumberOfEstimates();
+
+  /*!
+    Discard all the collected samples and start filling the window again.
+    This method is safe to be called from any thread.
+  */
+  void ResetWindow();
+
+  /*! Set the algorithm that computes the fixed signal and the time offset. Must be set before connecting the device. */
+  void SetEstimator(vtkTemporalCalibrationEstimator* estimator);
+  vtkTemporalCalibrationEstimator* GetEstimator();
+
+  /*! Name of the transform that describes the position of the probe (moving) in the tracker channel */
+  vtkSetStringMacro(MovingProbeToReferenceTransformName);
+  vtkGetStringMacro(MovingProbeToReferenceTransformName);
+
+  /*! Length of the sliding window that is used for the estimation (in seconds) */
+  vtkSetMacro(WindowSec, double);
+  vtkGetMacro(WindowSec, double);
+
+  /*! Time between two subsequent estimations (in seconds) */
+  vtkSetMacro(UpdatePeriodSec, double);
+  vtkGetMacro(UpdatePeriodSec, double);
+
+  /*! Maximum expected time offset between the fixed and moving signal (in seconds) */
+  vtkSetMacro(MaximumMovingLagSec, double);
+  vtkGetMacro(MaximumMovingLagSec, double);
+
+  /*! Estimated lag changes smaller than this value are not applied to the moving device (in seconds) */
+  vtkSetMacro(MinimumLagChangeSec, double);
+  vtkGetMacro(MinimumLagChangeSec, double);
+
+  /*! If enabled, the estimated lag is applied to the local time offset of the device that owns the moving channel */
+  vtkSetMacro(ApplyTimeOffset, bool);
+  vtkGetMacro(ApplyTimeOffset, bool);
+  vtkBooleanMacro(ApplyTimeOffset, bool);
+
+  /*! Read main configuration from xml data */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement*);
+
+  /*! Write main configuration to xml data */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement*);
+
+  virtual PlusStatus NotifyConfigured();
+
+protected:
+  virtual PlusStatus InternalUpdate();
+
+  virtual int OutputChannelCount() const { return 0; }
+
+  virtual bool IsTracker() const { return false; }
+  virtual bool IsVirtual() const { return true; }
+
+  virtual PlusStatus InternalConnect();
+  virtual PlusStatus InternalDisconnect();
+
+  virtual PlusStatus InternalStartRecording();
+  virtual PlusStatus InternalStopRecording();
+
+  /*! Get new video frames from the fixed channel, detect the line position on them and append the results to the window */
+  PlusStatus UpdateFixedWindow();
+
+  /*! Get new tracker frames from the moving channel and append them to the window */
+  PlusStatus UpdateMovingWindow();
+
+  /*! Remove samples from the window that are older than WindowSec */
+  void TrimWindow();
+
+  /*! Clear the window contents (not thread-safe, only to be called from the internal update thread) */
+  void ClearWindow();
+
+  /*! Pass the current window contents to the estimator thread */
+  void RequestEstimation();
+
+  /*! Run the temporal calibration on the data that was passed by RequestEstimation */
+  void RunEstimation();
+
+  /*! Estimator thread function */
+  static void* EstimatorThread(vtkMultiThreader::ThreadInfo *data);
+
+  vtkVirtualTemporalCalibrationMonitor();
+  virtual ~vtkVirtualTemporalCalibrationMonitor();
+
+  char* MovingProbeToReferenceTransformName;
+  double WindowSec;
+  double UpdatePeriodSec;
+  double MaximumMovingLagSec;
+  double MinimumLagChangeSec;
+  bool ApplyTimeOffset;
+
+  /*! Computes the fixed signal (in the internal update thread) and the moving lag (in the estimator thread) */
+  vtkSmartPointer<vtkTemporalCalibrationEstimator> Estimator;
+
+  /*! Copy of the device configuration, it is passed to the estimator when the device is connected */
+  vtkSmartPointer<vtkXMLDataElement> EstimatorConfiguration;
+
+  /*! Timestamp of the most recent fixed and moving frames that are already in the window (0 if the window is empty) */
+  double LastFixedFrameTimestamp;
+  double LastMovingFrameTimestamp;
+
+  /*! Sliding window of the fixed signal: line positions detected on the video frames */
+  std::deque<double> FixedWindowTimestamps;
+  std::deque<double> FixedWindowValues;
+
+  /*! Sliding window of the moving signal: tracker frames */
+  vtkSmartPointer<vtkTrackedFrameList> MovingWindowFrames;
+
+  /*! Temporary storage for retrieving new frames from the input channels */
+  vtkSmartPointer<vtkTrackedFrameList> NewFrames;
+
+  double LastEstimationRequestTime;
+
+  /*! Input of the estimator thread (a snapshot of the window). Protected by EstimatorMutex. */
+  std::deque<double> EstimatorFixedTimestamps;
+  std::deque<double> EstimatorFixedValues;
+  vtkSmartPointer<vtkTrackedFrameList> EstimatorMovingFrames;
+  bool EstimationRequested;
+
+  /*! Results of the estimator thread. Protected by EstimatorMutex. */
+  bool LatestEstimateValid;
+  double LatestMovingLagSec;
+  double LatestCalibrationError;
+  int NumberOfEstimates;
+  bool WindowResetRequested;
+
+  vtkSmartPointer<vtkRecursiveCriticalSection> EstimatorMutex;
+
+  int EstimatorThreadId;
+  bool EstimatorThreadAlive;
+  bool EstimatorThreadStopRequested;
+
+private:
+  vtkVirtualTemporalCalibrationMonitor(const vtkVirtualTemporalCalibrationMonitor&);  // Not implemented.
+  void operator=(const vtkVirtualTemporalCalibrationMonitor&);  // Not implemented.
+};
+
+#endif
@@ -79,6 +79,9 @@ public:
   /*! Set the output volume's extent (xStart, xEnd, yStart, yEnd, zStart, zEnd) in voxels */
   void SetOutputExtent(int* extent);
 
+  /*! Get the number of frames that have been added to the volume reconstructor since the device was created */
+  vtkGetMacro(TotalFramesRecorded, long int);
+
 protected:
 
     /*! Read main configuration from xml data */
@@ -104,7 +107,6 @@ protected:
   vtkGetMacro(RequestedFrameRate, double);
 
   vtkGetMacro(ActualFrameRate, double);
-  vtkGetMacro(TotalFramesRecorded, long int);
 
   virtual vtkDataCollector* GetDataCollector() { return this->DataCollector; }
 
@@ -14,23 +14,75 @@ See License.txt for details.
 #include "vtkPlusDevice.h"
 #include "vtkPlusDeviceFactory.h"
 #include "vtkPlusBuffer.h"
+#include "vtkRecursiveCriticalSection.h"
 #include "vtkSavedDataSource.h"
 #include "vtkTrackedFrameList.h"
 #include "vtkXMLDataElement.h"
 #include "vtksys/SystemTools.hxx"
+#include <algorithm>
+#include <sstream>
 
 //----------------------------------------------------------------------------
 
 vtkCxxRevisionMacro(vtkDataCollector, "$Revision: 2.0$");
 vtkStandardNewMacro(vtkDataCollector);
 
+namespace
+{
+  // Period of checking the state of the devices that are connected or started in parallel
+  const double DEVICE_OPERATION_POLL_DELAY_SEC = 0.005;
+
+  enum DeviceTaskState
+  {
+    DEVICE_TASK_WAITING, // waiting for the devices that provide the input channels
+    DEVICE_TASK_RUNNING,
+    DEVICE_TASK_TIMED_OUT, // not completed in time, the operation is still in progress
+    DEVICE_TASK_SUCCEEDED,
+    DEVICE_TASK_FAILED,
+    DEVICE_TASK_SKIPPED // not attempted, because an input device failed
+  };
+}
+
+//----------------------------------------------------------------------------
+
+struct vtkDataCollector::DeviceTask
+{
+  vtkPlusDevice* Device;
+  DeviceCollection InputDevices;
+  bool StartRecording;
+  DeviceTaskState State;
+  int ThreadId;
+  double StartTimeSec;
+  std::string FailureReason;
+  // Members below are shared with the thread that performs the operation
+  vtkRecursiveCriticalSection* Mutex;
+  bool Finished;
+  PlusStatus Result;
+};
+
+//----------------------------------------------------------------------------
+
+void* vtkDataCollector::DeviceTaskThread(vtkMultiThreader::ThreadInfo* data)
+{
+  DeviceTask* task = static_cast<DeviceTask*>(data->UserData);
+  PlusStatus result = task->StartRecording ? task->Device->StartRecording() : task->Device->Connect();
+  PlusLockGuard<vtkRecursiveCriticalSection> taskGuardedLock(task->Mutex);
+  task->Result = result;
+  task->Finished = true;
+  return NULL;
+}
+
 //----------------------------------------------------------------------------
 
 vtkDataCollector::vtkDataCollector()
 : vtkObject()
 , StartupDelaySec(0.0)
+, ParallelDeviceConnection(false)
+, DeviceConnectionTimeoutSec(0.0)
 , Connected(false)
 , Started(false)
+, DeviceTaskThreader(vtkMultiThreader::New())
+, DeviceTaskMutex(vtkRecursiveCriticalSection::New())
 {
 }
 
@@ -43,8 +95,9 @@ vtkDataCollector::~vtkDataCollector()
   {
     this->Stop();
   }
-  if( this->Connected )
+  if( this->Connected || !this->PendingDeviceTasks.empty() )
   {
+    // The devices must not be deleted while a timed-out operation is still running on them
     this->Disconnect();
   }
 
@@ -53,6 +106,9 @@ vtkDataCollector::~vtkDataCollector()
     (*it)->Delete();
   }
   Devices.clear();
+
+  DELETE_IF_NOT_NULL(this->DeviceTaskThreader);
+  DELETE_IF_NOT_NULL(this->DeviceTaskMutex);
 }
 
 //----------------------------------------------------------------------------
@@ -83,6 +139,33 @@ PlusStatus vtkDataCollector::ReadConfiguration( vtkXMLDataElement* aConfig )
     LOG_DEBUG("StartupDelaySec: " << std::fixed << startupDelaySec ); 
   }
 
+  // Read ParallelDeviceConnection
+  const char* parallelDeviceConnection = dataCollectionElement->GetAttribute("ParallelDeviceConnection");
+  if ( parallelDeviceConnection != NULL )
+  {
+    if ( STRCASECMP(parallelDeviceConnection, "TRUE") == 0 )
+    {
+      this->SetParallelDeviceConnection(true);
+    }
+    else if ( STRCASECMP(parallelDeviceConnection, "FALSE") == 0 )
+    {
+      this->SetParallelDeviceConnection(false);
+    }
+    else
+    {
+      LOG_WARNING("Unable to recognize ParallelDeviceConnection attribute: " << parallelDeviceConnection << " - changed to false by default!");
+      this->SetParallelDeviceConnection(false);
+    }
+  }
+
+  // Read DeviceConnectionTimeoutSec
+  double deviceConnectionTimeoutSec(0.0); 
+  if ( dataCollectionElement->GetScalarAttribute("DeviceConnectionTimeoutSec", deviceConnectionTimeoutSec) )
+  {
+    this->SetDeviceConnectionTimeoutSec(deviceConnectionTimeoutSec); 
+    LOG_DEBUG("DeviceConnectionTimeoutSec: " << std::fixed << deviceConnectionTimeoutSec ); 
+  }
+
   vtkSmartPointer<vtkPlusDeviceFactory> factory = vtkSmartPointer<vtkPlusDeviceFactory>::New();
 
   for ( int i = 0; i < dataCollectionElement->GetNumberOfNestedElements(); ++i )
@@ -206,6 +289,33 @@ PlusStatus vtkDataCollector::WriteConfiguration( vtkXMLDataElement* aConfig )
 
   dataCollectionConfig->SetDoubleAttribute("StartupDelaySec", GetStartupDelaySec());
 
+  // The parallel connection attributes are only written if they are not at their defaults
+  if ( GetParallelDeviceConnection() )
+  {
+    dataCollectionConfig->SetAttribute("ParallelDeviceConnection", "TRUE");
+  }
+  else
+  {
+#if (VTK_MAJOR_VERSION < 6)
+    // Workaround for RemoveAttribute bug in VTK5 (https://www.assembla.com/spaces/plus/tickets/859)
+    PlusCommon::RemoveAttribute(dataCollectionConfig, "ParallelDeviceConnection");
+#else
+    dataCollectionConfig->RemoveAttribute("ParallelDeviceConnection");
+#endif
+  }
+  if ( GetDeviceConnectionTimeoutSec() > 0 )
+  {
+    dataCollectionConfig->SetDoubleAttribute("DeviceConnectionTimeoutSec", GetDeviceConnectionTimeoutSec());
+  }
+  else
+  {
+#if (VTK_MAJOR_VERSION < 6)
+    PlusCommon::RemoveAttribute(dataCollectionConfig, "DeviceConnectionTimeoutSec");
+#else
+    dataCollectionConfig->RemoveAttribute("DeviceConnectionTimeoutSec");
+#endif
+  }
+
   PlusStatus status = PLUS_SUCCESS;
 
   for( DeviceCollectionConstIterator it = Devices.begin(); it != Devices.end(); ++it )
@@ -232,16 +342,27 @@ PlusStatus vtkDataCollector::Start()
 
   const double startTime = vtkAccurateTimer::GetSystemTime(); 
 
-  for( DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it )
+  if( this->ParallelDeviceConnection )
   {
-    vtkPlusDevice* device = *it;
-
-    if( device->StartRecording() != PLUS_SUCCESS )
+    status = this->ExecuteDeviceOperationInParallel(DEVICE_START_RECORDING);
+    for( DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it )
     {
-      LOG_ERROR("Failed to start data acquisition for device " << device->GetDeviceId() << ".");
-      status = PLUS_FAIL;
+      (*it)->SetStartTime(startTime);
+    }
+  }
+  else
+  {
+    for( DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it )
+    {
+      vtkPlusDevice* device = *it;
+
+      if( device->StartRecording() != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to start data acquisition for device " << device->GetDeviceId() << ".");
+        status = PLUS_FAIL;
+      }
+      device->SetStartTime(startTime);
     }
-    device->SetStartTime(startTime);
   }
 
   LOG_DEBUG("vtkDataCollector::Start -- wait " << std::fixed << this->StartupDelaySec << " sec for buffer init..."); 
@@ -271,20 +392,28 @@ PlusStatus vtkDataCollector::Connect()
 
   PlusStatus status = PLUS_SUCCESS;
 
-  for( DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it )
+  if( this->ParallelDeviceConnection )
   {
-    vtkPlusDevice* device = *it;
-
-    if( device->Connect() != PLUS_SUCCESS )
+    status = this->ExecuteDeviceOperationInParallel(DEVICE_CONNECT);
+  }
+  else
+  {
+    for( DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it )
     {
-      LOG_ERROR("Unable to connect device: " << device->GetDeviceId() <<".");
-      status = PLUS_FAIL;
+      vtkPlusDevice* device = *it;
+
+      if( device->Connect() != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Unable to connect device: " << device->GetDeviceId() <<".");
+        status = PLUS_FAIL;
+      }
     }
   }
 
   if( status != PLUS_SUCCESS )
   {
-    this->Disconnect();
+    // Do not wait for the devices that timed out, they are disconnected by Disconnect()
+    this->DisconnectDevices();
     status = PLUS_FAIL;
   }
 
@@ -304,12 +433,34 @@ PlusStatus vtkDataCollector::Disconnect()
 {
   LOG_TRACE("vtkDataCollector::Disconnect()");
 
+  // The operations that timed out cannot be interrupted, wait for them before the devices are disconnected
+  this->ReleasePendingDeviceTasks(true);
+
+  PlusStatus status = this->DisconnectDevices();
+
+  Connected = false;
+  LOG_DEBUG("vtkDataCollector::Disconnect: All devices have been disconnected");
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+
+PlusStatus vtkDataCollector::DisconnectDevices()
+{
   PlusStatus status = PLUS_SUCCESS;
 
   for( DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it )
   {
     vtkPlusDevice* device = *it;
 
+    if( this->IsDeviceTaskPending(device) )
+    {
+      // The device is still used by the thread of the timed-out operation
+      LOG_DEBUG("Device " << device->GetDeviceId() << " is not disconnected yet, its connection or start is still in progress");
+      continue;
+    }
+
     if( device->Disconnect() != PLUS_SUCCESS )
     {
       LOG_ERROR("Unable to disconnect device: " << device->GetDeviceId() <<".");
@@ -317,8 +468,277 @@ PlusStatus vtkDataCollector::Disconnect()
     }
   }
 
-  Connected = false;
-  LOG_DEBUG("vtkDataCollector::Disconnect: All devices have been disconnected");
+  return status;
+}
+
+//----------------------------------------------------------------------------
+
+bool vtkDataCollector::IsDeviceTaskPending( vtkPlusDevice* aDevice ) const
+{
+  for( std::vector<DeviceTask*>::const_iterator taskIt = this->PendingDeviceTasks.begin(); taskIt != this->PendingDeviceTasks.end(); ++taskIt )
+  {
+    if( (*taskIt)->Device == aDevice )
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+
+void vtkDataCollector::ReleasePendingDeviceTasks( bool waitForCompletion )
+{
+  std::vector<DeviceTask*>::iterator taskIt = this->PendingDeviceTasks.begin();
+  while( taskIt != this->PendingDeviceTasks.end() )
+  {
+    DeviceTask* task = *taskIt;
+    bool finished = false;
+    {
+      PlusLockGuard<vtkRecursiveCriticalSection> taskGuardedLock(task->Mutex);
+      finished = task->Finished;
+    }
+    if( !finished )
+    {
+      if( !waitForCompletion )
+      {
+        ++taskIt;
+        continue;
+      }
+      LOG_INFO("Waiting for the " << ( task->StartRecording ? "start" : "connection" ) << " of device " << task->Device->GetDeviceId() << " to complete");
+    }
+    // Only the timed-out operations that run in their own thread are pending, wait for the termination of the thread
+    this->DeviceTaskThreader->TerminateThread(task->ThreadId);
+    LOG_DEBUG("Device " << task->Device->GetDeviceId() << ": timed-out operation completed");
+    delete task;
+    taskIt = this->PendingDeviceTasks.erase(taskIt);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+void vtkDataCollector::GetInputDevices( vtkPlusDevice* aDevice, DeviceCollection &inputDevices ) const
+{
+  inputDevices.clear();
+  for( ChannelContainerConstIterator it = aDevice->GetInputChannelsStart(); it != aDevice->GetInputChannelsEnd(); ++it )
+  {
+    vtkPlusDevice* inputDevice = (*it)->GetOwnerDevice();
+    if( inputDevice == NULL || inputDevice == aDevice )
+    {
+      continue;
+    }
+    if( std::find(inputDevices.begin(), inputDevices.end(), inputDevice) == inputDevices.end() )
+    {
+      inputDevices.push_back(inputDevice);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+
+PlusStatus vtkDataCollector::ExecuteDeviceOperationInParallel( DeviceOperationType operation )
+{
+  LOG_TRACE("vtkDataCollector::ExecuteDeviceOperationInParallel()");
+
+  const char* operationName = ( operation == DEVICE_CONNECT ? "connect" : "start" );
+
+  // Forget the operations that timed out previously but have completed since then
+  this->ReleasePendingDeviceTasks(false);
+
+  std::vector<DeviceTask*> tasks;
+  for( DeviceCollectionIterator deviceIt = this->Devices.begin(); deviceIt != this->Devices.end(); ++deviceIt )
+  {
+    DeviceTask* task = new DeviceTask;
+    task->Device = *deviceIt;
+    this->GetInputDevices(task->Device, task->InputDevices);
+    task->StartRecording = ( operation == DEVICE_START_RECORDING );
+    task->State = DEVICE_TASK_WAITING;
+    task->ThreadId = -1;
+    task->StartTimeSec = 0.0;
+    task->Mutex = this->DeviceTaskMutex;
+    task->Finished = false;
+    task->Result = PLUS_FAIL;
+    if( this->IsDeviceTaskPending(task->Device) )
+    {
+      // The device must not be used from another thread until the previous operation completes
+      task->State = DEVICE_TASK_SKIPPED;
+      task->FailureReason = "a previous operation that timed out is still in progress";
+    }
+    tasks.push_back(task);
+  }
+
+  const double operationStartTimeSec = vtkAccurateTimer::GetSystemTime();
+  bool tasksInProgress = true;
+  while( tasksInProgress )
+  {
+    // Timed-out tasks do not keep the loop running, the operation returns when only those remain
+    tasksInProgress = false;
+    bool taskStateChanged = false;
+    bool taskRunning = false;
+    const double currentTimeSec = vtkAccurateTimer::GetSystemTime();
+
+    for( std::vector<DeviceTask*>::iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt )
+    {
+      DeviceTask* task = *taskIt;
+      if( task->State == DEVICE_TASK_WAITING )
+      {
+        // A device can be processed when all its input devices are successfully processed
+        bool inputsReady = true;
+        vtkPlusDevice* failedInputDevice = NULL;
+        for( DeviceCollectionConstIterator inputIt = task->InputDevices.begin(); inputIt != task->InputDevices.end() && failedInputDevice == NULL; ++inputIt )
+        {
+          for( std::vector<DeviceTask*>::iterator inputTaskIt = tasks.begin(); inputTaskIt != tasks.end(); ++inputTaskIt )
+          {
+            DeviceTask* inputTask = *inputTaskIt;
+            if( inputTask->Device != *inputIt )
+            {
+              continue;
+            }
+            if( inputTask->State == DEVICE_TASK_FAILED || inputTask->State == DEVICE_TASK_SKIPPED || inputTask->State == DEVICE_TASK_TIMED_OUT )
+            {
+              failedInputDevice = inputTask->Device;
+            }
+            else if( inputTask->State != DEVICE_TASK_SUCCEEDED )
+            {
+              inputsReady = false;
+            }
+            break;
+          }
+        }
+        if( failedInputDevice != NULL )
+        {
+          task->State = DEVICE_TASK_SKIPPED;
+          task->FailureReason = std::string("input device ") + failedInputDevice->GetDeviceId() + " failed";
+          taskStateChanged = true;
+          continue;
+        }
+        if( !inputsReady )
+        {
+          tasksInProgress = true;
+          continue;
+        }
+
+        LOG_DEBUG("Device " << task->Device->GetDeviceId() << ": " << operationName << " started");
+        task->State = DEVICE_TASK_RUNNING;
+        task->StartTimeSec = currentTimeSec;
+        task->ThreadId = this->DeviceTaskThreader->SpawnThread((vtkThreadFunctionType)&DeviceTaskThread, task);
+        if( task->ThreadId < 0 )
+        {
+          // No more threads are available, perform the operation in this thread
+          vtkMultiThreader::ThreadInfo threadInfo;
+          threadInfo.UserData = task;
+          DeviceTaskThread(&threadInfo);
+        }
+        taskStateChanged = true;
+      }
+
+      if( task->State == DEVICE_TASK_RUNNING || task->State == DEVICE_TASK_TIMED_OUT )
+      {
+        bool finished = false;
+        PlusStatus result = PLUS_FAIL;
+        {
+          PlusLockGuard<vtkRecursiveCriticalSection> taskGuardedLock(task->Mutex);
+          finished = task->Finished;
+          result = task->Result;
+        }
+        if( finished )
+        {
+          if( task->ThreadId >= 0 )
+          {
+            // The thread has completed, wait for its termination
+            this->DeviceTaskThreader->TerminateThread(task->ThreadId);
+            task->ThreadId = -1;
+          }
+          if( task->State == DEVICE_TASK_RUNNING )
+          {
+            task->State = ( result == PLUS_SUCCESS ? DEVICE_TASK_SUCCEEDED : DEVICE_TASK_FAILED );
+            LOG_DEBUG("Device " << task->Device->GetDeviceId() << ": " << operationName << ( result == PLUS_SUCCESS ? " completed" : " failed" )
+              << " in " << std::fixed << vtkAccurateTimer::GetSystemTime() - task->StartTimeSec << " sec");
+          }
+          else
+          {
+            // Completed after the timeout, dependent devices are already skipped
+            task->State = DEVICE_TASK_FAILED;
+          }
+          taskStateChanged = true;
+          continue;
+        }
+
+        if( task->State == DEVICE_TASK_TIMED_OUT )
+        {
+          // Nothing waits for this task anymore
+          continue;
+        }
+
+        tasksInProgress = true;
+        taskRunning = true;
+        if( this->DeviceConnectionTimeoutSec > 0 && currentTimeSec - task->StartTimeSec > this->DeviceConnectionTimeoutSec )
+        {
+          // The operation cannot be interrupted, but the devices that depend on this device are not waiting for it anymore
+          LOG_WARNING("Device " << task->Device->GetDeviceId() << ": " << operationName << " did not complete in " << std::fixed << this->DeviceConnectionTimeoutSec << " sec");
+          task->State = DEVICE_TASK_TIMED_OUT;
+          std::ostringstream reason;
+          reason << "timed out after " << std::fixed << this->DeviceConnectionTimeoutSec << " sec";
+          task->FailureReason = reason.str();
+          taskStateChanged = true;
+        }
+      }
+    }
+
+    if( tasksInProgress && !taskStateChanged && !taskRunning )
+    {
+      // The remaining devices are waiting for each other
+      for( std::vector<DeviceTask*>::iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt )
+      {
+        if( (*taskIt)->State == DEVICE_TASK_WAITING )
+        {
+          (*taskIt)->State = DEVICE_TASK_SKIPPED;
+          (*taskIt)->FailureReason = "circular reference between input channels";
+        }
+      }
+      tasksInProgress = false;
+    }
+
+    if( tasksInProgress )
+    {
+      vtkAccurateTimer::Delay(DEVICE_OPERATION_POLL_DELAY_SEC);
+    }
+  }
+
+  // Report the errors of all the devices
+  PlusStatus status = PLUS_SUCCESS;
+  int numberOfFailedDevices = 0;
+  for( std::vector<DeviceTask*>::iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt )
+  {
+    DeviceTask* task = *taskIt;
+    if( task->State == DEVICE_TASK_SUCCEEDED )
+    {
+      continue;
+    }
+    numberOfFailedDevices++;
+    status = PLUS_FAIL;
+    LOG_ERROR("Unable to " << operationName << " device: " << task->Device->GetDeviceId() << " ("
+      << ( task->FailureReason.empty() ? std::string("device reported an error") : task->FailureReason ) << ").");
+  }
+  if( numberOfFailedDevices > 0 )
+  {
+    LOG_ERROR("Failed to " << operationName << " " << numberOfFailedDevices << " of " << tasks.size() << " devices.");
+  }
+  LOG_DEBUG("vtkDataCollector: " << operationName << " of " << tasks.size() << " devices in parallel completed in "
+    << std::fixed << vtkAccurateTimer::GetSystemTime() - operationStartTimeSec << " sec");
+
+  // The threads of the timed-out operations still use their tasks, those are released when the operation completes
+  for( std::vector<DeviceTask*>::iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt )
+  {
+    if( (*taskIt)->State == DEVICE_TASK_TIMED_OUT )
+    {
+      this->PendingDeviceTasks.push_back(*taskIt);
+    }
+    else
+    {
+      delete (*taskIt);
+    }
+  }
 
   return status;
 }
@@ -487,8 +907,8 @@ PlusStatus vtkDataCollector::GetTrackingData(vtkPlusChannel* aRequestedChannel,
       LOG_ERROR("Unable to get tracking data by time: " << std::fixed << itemTimestamp ); 
       status=PLUS_FAIL;
     }
-    // Add tracked frame to the list 
-    if ( aTrackedFrameList->AddTrackedFrame(&trackedFrame, vtkTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS )
+    // Add tracked frame to the list (the frame content is moved, not copied)
+    if ( aTrackedFrameList->AddTrackedFrameBySwap(&trackedFrame, vtkTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS )
     {
       LOG_ERROR("Unable to add tracking data to the list!" ); 
       status=PLUS_FAIL; 
@@ -556,8 +976,8 @@ PlusStatus vtkDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel, dou
       trackedFrame.SetCustomFrameField((*fieldIterator).first, (*fieldIterator).second);
     }
 
-    // Add tracked frame to the list 
-    if ( aTrackedFrameList->AddTrackedFrame(&trackedFrame, vtkTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS )
+    // Add tracked frame to the list (the frame content is moved, not copied)
+    if ( aTrackedFrameList->AddTrackedFrameBySwap(&trackedFrame, vtkTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS )
     {
       LOG_ERROR("Unable to add video data to the list!" ); 
       status=PLUS_FAIL; 
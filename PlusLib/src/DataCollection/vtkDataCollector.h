@@ -8,6 +8,7 @@ See License.txt for details.
 #define __vtkDataCollector_h
 
 #include "PlusCommon.h"
+#include "vtkMultiThreader.h"
 #include "vtkObject.h"
 #include "vtkPlusDeviceTypes.h"
 #include <vector>
@@ -18,6 +19,7 @@ class vtkTrackedFrameList;
 class vtkVirtualMixer;
 class vtkXMLDataElement;
 class vtkPlusDevice;
+class vtkRecursiveCriticalSection;
 
 /*!
 \class vtkDataCollector 
@@ -64,6 +66,8 @@ public:
   Disconnect from active device(s).
   This method must be called before application exit, or else the
   application might hang during exit.
+  If the connection or start of a device timed out (see DeviceConnectionTimeoutSec) then this method
+  waits for that operation to complete before it disconnects the device.
   */
   PlusStatus Disconnect();
 
@@ -129,18 +133,80 @@ public:
   /*! Get startup delay in sec to give some time to the buffers for proper initialization */
   vtkGetMacro(StartupDelaySec, double);
 
+  /*!
+    If enabled then devices are connected and started in parallel. A device that uses the output channels
+    of other devices (such as a virtual mixer) is connected and started after those devices.
+  */
+  vtkSetMacro(ParallelDeviceConnection, bool);
+  vtkGetMacro(ParallelDeviceConnection, bool);
+  vtkBooleanMacro(ParallelDeviceConnection, bool);
+
+  /*!
+    Maximum time in sec for connecting or starting one device in parallel mode (0 means no limit).
+    A timed-out device is reported as failed and Connect or Start returns once only timed-out devices remain.
+    The operation of the device cannot be interrupted, it completes in the background and Disconnect waits for it.
+  */
+  vtkSetMacro(DeviceConnectionTimeoutSec, double);
+  vtkGetMacro(DeviceConnectionTimeoutSec, double);
+
 protected:
   vtkDataCollector();
   virtual ~vtkDataCollector();
 
+  enum DeviceOperationType
+  {
+    DEVICE_CONNECT,
+    DEVICE_START_RECORDING
+  };
+
+  /*!
+    Connect or start all devices in parallel threads. Each device is processed when the devices that provide its
+    input channels are already processed successfully. Errors of all the devices are collected and reported together.
+  */
+  PlusStatus ExecuteDeviceOperationInParallel(DeviceOperationType operation);
+
+  /*! Get the devices that own the input channels of a device */
+  void GetInputDevices(vtkPlusDevice* aDevice, DeviceCollection &inputDevices) const;
+
+  /*! Connection or start of one device in a separate thread */
+  struct DeviceTask;
+
+  /*! Thread that connects or starts the device of a DeviceTask */
+  static void* DeviceTaskThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Returns true if an operation that timed out is still running on the device */
+  bool IsDeviceTaskPending(vtkPlusDevice* aDevice) const;
+
+  /*!
+    Release the timed-out device operations that have completed since they timed out.
+    If waitForCompletion is true then wait for all of them to complete.
+  */
+  void ReleasePendingDeviceTasks(bool waitForCompletion);
+
+  /*! Disconnect all devices, except those that still have a timed-out operation running */
+  PlusStatus DisconnectDevices();
+
   /*! The timestamp filtering methods require some time to initialize. Synchronization will ignore data that are acquired during startup delay. */
   double StartupDelaySec; 
 
+  /*! Connect and start the devices in parallel */
+  bool ParallelDeviceConnection;
+
+  /*! Maximum time for connecting or starting a device in parallel mode (0 means no limit) */
+  double DeviceConnectionTimeoutSec;
+
   DeviceCollection Devices;
 
   bool Connected;
   bool Started;
 
+  /*! Threads of the device operations in parallel mode, kept alive while a timed-out operation is running */
+  vtkMultiThreader* DeviceTaskThreader;
+  /*! Mutex for the completion status of the device operations */
+  vtkRecursiveCriticalSection* DeviceTaskMutex;
+  /*! Device operations that timed out and have not been released yet */
+  std::vector<DeviceTask*> PendingDeviceTasks;
+
 private:
   vtkDataCollector(const vtkDataCollector&);
   void operator=(const vtkDataCollector&);
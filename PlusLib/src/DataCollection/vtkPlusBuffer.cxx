@@ -16,12 +16,25 @@ See License.txt for details.
 #include "vtkObjectFactory.h"
 #include "vtkPlusDevice.h"
 #include "vtkPlusBuffer.h"
+#include "vtkPlusTracer.h"
 #include "vtkTrackedFrameList.h"
 #include "vtkUnsignedLongLongArray.h"
 
 static const double NEGLIGIBLE_TIME_DIFFERENCE=0.00001; // in seconds, used for comparing between exact timestamps
 static const double ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG=10; // if the interpolated orientation differs from both the interpolated orientation by more than this threshold then display a warning
 
+//----------------------------------------------------------------------------
+// Returns the angle of the rotation between two orientations (specified by unit quaternions), in degrees
+static double GetQuaternionAngleDifferenceDeg(const double quatA[4], const double quatB[4])
+{
+  double cosHalfAngle = fabs(quatA[0]*quatB[0]+quatA[1]*quatB[1]+quatA[2]*quatB[2]+quatA[3]*quatB[3]);
+  if (cosHalfAngle > 1.0)
+  {
+    cosHalfAngle = 1.0;
+  }
+  return vtkMath::DegreesFromRadians(2.0*acos(cosHalfAngle));
+}
+
 vtkCxxRevisionMacro(vtkPlusBuffer, "$Revision: 1.0 $");
 vtkStandardNewMacro(vtkPlusBuffer);
 
@@ -75,11 +88,10 @@ vtkStandardNewMacro(vtkPlusBuffer);
 //            DataBufferItem
 //----------------------------------------------------------------------------
 StreamBufferItem::StreamBufferItem()
-: Matrix(vtkSmartPointer<vtkMatrix4x4>::New())
-, Status(TOOL_OK)
+: Status(TOOL_OK)
 , ValidTransformData(false)
 {
-
+  vtkMatrix4x4::Identity(this->Matrix);
 }
 
 //----------------------------------------------------------------------------
@@ -90,7 +102,7 @@ StreamBufferItem::~StreamBufferItem()
 //----------------------------------------------------------------------------
 StreamBufferItem::StreamBufferItem(const StreamBufferItem &dataItem)
 {
-  this->Matrix = vtkSmartPointer<vtkMatrix4x4>::New(); 
+  vtkMatrix4x4::Identity(this->Matrix);
   this->Status = TOOL_OK;
   *this = dataItem; 
 }
@@ -111,7 +123,7 @@ StreamBufferItem& StreamBufferItem::operator=(StreamBufferItem const &dataItem)
   this->Uid = dataItem.Uid; 
   this->CustomFrameFields = dataItem.CustomFrameFields;
   this->Status = dataItem.Status; 
-  this->Matrix->DeepCopy( dataItem.Matrix ); 
+  memcpy(this->Matrix, dataItem.Matrix, sizeof(this->Matrix)); 
   this->ValidTransformData = dataItem.ValidTransformData;
 
   return *this;
@@ -142,7 +154,7 @@ PlusStatus StreamBufferItem::SetMatrix(vtkMatrix4x4* matrix)
 
   ValidTransformData = true;
 
-  this->Matrix->DeepCopy(matrix); 
+  vtkMatrix4x4::DeepCopy(this->Matrix, matrix); 
 
   return PLUS_SUCCESS; 
 }
@@ -161,6 +173,19 @@ PlusStatus StreamBufferItem::GetMatrix(vtkMatrix4x4* outputMatrix)
   return PLUS_SUCCESS; 
 }
 
+//----------------------------------------------------------------------------
+void StreamBufferItem::SetMatrixElements(const double matrixElements[16])
+{
+  ValidTransformData = true;
+  memcpy(this->Matrix, matrixElements, sizeof(this->Matrix)); 
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::GetMatrixElements(double matrixElements[16]) const
+{
+  memcpy(matrixElements, this->Matrix, sizeof(this->Matrix)); 
+}
+
 //----------------------------------------------------------------------------
 void StreamBufferItem::SetStatus( ToolStatus status )
 {
@@ -219,17 +244,35 @@ void vtkPlusBuffer::PrintSelf(ostream& os, vtkIndent indent)
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::AllocateMemoryForFrames()
 {
-  PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  // Frames are copied into the reserved item without holding the buffer lock, so wait until the copy is completed
+  this->StreamBuffer->LockWriting();
+  this->StreamBuffer->Lock();
   PlusStatus result = PLUS_SUCCESS;
 
-  for ( int i = 0; i < this->StreamBuffer->GetBufferSize(); ++i )
+  if ( this->GetFrameSize()[0] <= 0 || this->GetFrameSize()[1] <= 0 )
+  {
+    // Buffer without images (e.g., tracker buffer): items only store poses, so don't create
+    // an image object for each item (and release the images if the buffer had images before)
+    PlusVideoFrame emptyFrame;
+    for ( int i = 0; i < this->StreamBuffer->GetBufferSize(); ++i )
+    {
+      this->StreamBuffer->GetBufferItemFromBufferIndex(i)->GetFrame() = emptyFrame;
+    }
+  }
+  else
   {
-    if (this->StreamBuffer->GetBufferItemFromBufferIndex(i)->GetFrame().AllocateFrame(this->GetFrameSize(), this->GetPixelType(), this->GetNumberOfScalarComponents())!=PLUS_SUCCESS)
+    for ( int i = 0; i < this->StreamBuffer->GetBufferSize(); ++i )
     {
-      LOCAL_LOG_ERROR("Failed to allocate memory for frame "<<i);
-      result = PLUS_FAIL;
+      if (this->StreamBuffer->GetBufferItemFromBufferIndex(i)->GetFrame().AllocateFrame(this->GetFrameSize(), this->GetPixelType(), this->GetNumberOfScalarComponents())!=PLUS_SUCCESS)
+      {
+        LOCAL_LOG_ERROR("Failed to allocate memory for frame "<<i);
+        result = PLUS_FAIL;
+      }
     }
   }
+
+  this->StreamBuffer->Unlock();
+  this->StreamBuffer->UnlockWriting();
   return result;
 }
 
@@ -318,6 +361,8 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION  usIm
                                         double unfilteredTimestamp/*=UNDEFINED_TIMESTAMP*/, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/,
                                         const TrackedFrame::FieldMapType* customFields /*=NULL*/)
 {
+  PlusTraceScope traceScope("vtkPlusBuffer::AddItem");
+
   if (unfilteredTimestamp==UNDEFINED_TIMESTAMP)
   {
     unfilteredTimestamp = vtkAccurateTimer::GetSystemTime();
@@ -350,10 +395,11 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION  usIm
     return PLUS_FAIL; 
   }
 
+  // The buffer is locked only while the slot of the new item is reserved and while the item is published.
+  // The reserved slot is not visible to readers, so the image data can be copied without holding the lock,
+  // which allows readers to access the other items while a (potentially large) frame is being copied.
   int bufferIndex(0); 
-  BufferItemUidType itemUid; 
-  PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
-  if ( this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS )
+  if ( this->StreamBuffer->ReserveNewItem(filteredTimestamp, bufferIndex) != PLUS_SUCCESS )
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG( "vtkPlusBuffer: Failed to prepare for adding new frame to video buffer!"); 
@@ -365,6 +411,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION  usIm
   if ( newObjectInBuffer == NULL )
   {
     LOCAL_LOG_ERROR( "vtkPlusBuffer: Failed to get pointer to video buffer object from the video buffer for the new frame!"); 
+    this->StreamBuffer->CancelNewItem(); 
     return PLUS_FAIL; 
   }
 
@@ -376,6 +423,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION  usIm
   {
     LOCAL_LOG_ERROR("Input frame size is different from buffer frame size (input: " << frameSizeInPx[0] << "x" << frameSizeInPx[1]
     << ",   buffer: " << receivedFrameSize[0] << "x" << receivedFrameSize[1] << ")!"); 
+    this->StreamBuffer->CancelNewItem(); 
     return PLUS_FAIL; 
   }
 
@@ -386,13 +434,13 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION  usIm
   if (PlusVideoFrame::GetOrientedImage(byteImageDataPtr, usImageOrientation, imageType, pixelType, numberOfScalarComponents, frameSizeInPx, this->ImageOrientation, newObjectInBuffer->GetFrame()) != PLUS_SUCCESS)
   {
     LOCAL_LOG_ERROR("Failed to convert input US image to the requested orientation!"); 
+    this->StreamBuffer->CancelNewItem(); 
     return PLUS_FAIL; 
   }
 
   newObjectInBuffer->SetFilteredTimestamp(filteredTimestamp); 
   newObjectInBuffer->SetUnfilteredTimestamp(unfilteredTimestamp); 
   newObjectInBuffer->SetIndex(frameNumber); 
-  newObjectInBuffer->SetUid(itemUid); 
   newObjectInBuffer->GetFrame().SetImageType(imageType);
 
   // Add custom fields
@@ -409,6 +457,15 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION  usIm
     }
   }
 
+  // Make the new item available to readers
+  BufferItemUidType itemUid(0); 
+  if ( this->StreamBuffer->CommitNewItem(itemUid) != PLUS_SUCCESS )
+  {
+    LOCAL_LOG_DEBUG( "vtkPlusBuffer: Failed to add new frame to video buffer, the buffer has been cleared while the frame was copied"); 
+    return PLUS_FAIL; 
+  }
+  traceScope.SetFrameUid(itemUid);
+
   return PLUS_SUCCESS; 
 }
 
@@ -442,16 +499,10 @@ PlusStatus vtkPlusBuffer::AddItem(vtkImageData* frame, US_IMAGE_ORIENTATION usIm
     }
   }
 
-  vtkSmartPointer<vtkImageData> mfOrientedImage = vtkSmartPointer<vtkImageData>::New(); 
-  if ( PlusVideoFrame::GetOrientedImage(frame, usImageOrientation, imageType, this->ImageOrientation, mfOrientedImage) != PLUS_SUCCESS )
-  {
-    LOCAL_LOG_ERROR("Failed to add video item to buffer: couldn't get requested reoriented frame!"); 
-    return PLUS_FAIL; 
-  }
-
-  const int* frameExtent = mfOrientedImage->GetExtent(); 
+  // The reorientation is performed while the pixels are copied into the buffer, no intermediate image is needed
+  const int* frameExtent = frame->GetExtent(); 
   const int frameSize[2] = {(frameExtent[1] - frameExtent[0] + 1), (frameExtent[3] - frameExtent[2] + 1)}; 
-  return this->AddItem( reinterpret_cast<unsigned char*>(mfOrientedImage->GetScalarPointer()), this->ImageOrientation, frameSize, frame->GetScalarType(), this->NumberOfScalarComponents, this->ImageType, 0, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields); 
+  return this->AddItem( reinterpret_cast<unsigned char*>(frame->GetScalarPointer()), usImageOrientation, frameSize, frame->GetScalarType(), this->NumberOfScalarComponents, imageType, 0, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields); 
 }
 
 //----------------------------------------------------------------------------
@@ -494,6 +545,8 @@ PlusStatus vtkPlusBuffer::AddItem(const PlusVideoFrame* frame, long frameNumber,
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4 *matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/)
 {
+  PlusTraceScope traceScope("vtkPlusBuffer::AddTimeStampedItem");
+
   if ( matrix  == NULL )
   {
     LOCAL_LOG_ERROR( "vtkPlusBuffer: Unable to add NULL matrix to tracker buffer!"); 
@@ -518,11 +571,9 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4 *matrix, ToolStatus st
     }
   }
 
+  // The item is reserved, filled and published the same way as video items, so that the writers are serialized
   int bufferIndex(0); 
-  BufferItemUidType itemUid; 
-
-  PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
-  if ( this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS )
+  if ( this->StreamBuffer->ReserveNewItem(filteredTimestamp, bufferIndex) != PLUS_SUCCESS )
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG( "vtkPlusBuffer: Failed to prepare for adding new frame to tracker buffer!"); 
@@ -534,17 +585,29 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4 *matrix, ToolStatus st
   if ( newObjectInBuffer == NULL )
   {
     LOCAL_LOG_ERROR( "vtkPlusBuffer: Failed to get pointer to data buffer object from the tracker buffer for the new frame!"); 
+    this->StreamBuffer->CancelNewItem(); 
     return PLUS_FAIL; 
   }
 
-  PlusStatus itemStatus = newObjectInBuffer->SetMatrix(matrix);
+  if ( newObjectInBuffer->SetMatrix(matrix) != PLUS_SUCCESS )
+  {
+    this->StreamBuffer->CancelNewItem(); 
+    return PLUS_FAIL; 
+  }
   newObjectInBuffer->SetStatus( status ); 
   newObjectInBuffer->SetFilteredTimestamp( filteredTimestamp ); 
   newObjectInBuffer->SetUnfilteredTimestamp( unfilteredTimestamp ); 
   newObjectInBuffer->SetIndex( frameNumber ); 
-  newObjectInBuffer->SetUid( itemUid ); 
 
-  return itemStatus; 
+  BufferItemUidType itemUid(0); 
+  if ( this->StreamBuffer->CommitNewItem(itemUid) != PLUS_SUCCESS )
+  {
+    LOCAL_LOG_DEBUG( "vtkPlusBuffer: Failed to add new item to tracker buffer, the buffer has been cleared while the item was written"); 
+    return PLUS_FAIL; 
+  }
+  traceScope.SetFrameUid(itemUid);
+
+  return PLUS_SUCCESS; 
 }
 
 //----------------------------------------------------------------------------
@@ -688,9 +751,13 @@ PlusStatus vtkPlusBuffer::SetFrameSize(int x, int y)
     // no change
     return PLUS_SUCCESS;
   }
+  // The frame size is not changed while a frame is being copied into the buffer
+  this->StreamBuffer->LockWriting();
   this->FrameSize[0]=x;
   this->FrameSize[1]=y;
-  return AllocateMemoryForFrames();
+  PlusStatus result = AllocateMemoryForFrames();
+  this->StreamBuffer->UnlockWriting();
+  return result;
 }
 
 //----------------------------------------------------------------------------
@@ -974,8 +1041,9 @@ bool vtkPlusBuffer::GetTimeStampReporting()
 
 //----------------------------------------------------------------------------
 // Returns the two buffer items that are closest previous and next buffer items relative to the specified time.
-// itemA is the closest item
-PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBufferItem& itemA, StreamBufferItem& itemB)
+// itemA is the closest item. The returned pointers refer to items in the buffer, therefore the buffer must be locked
+// while the items are used.
+PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBufferItem*& itemA, StreamBufferItem*& itemB, double& itemAtime, double& itemBtime)
 {
   PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
 
@@ -1002,34 +1070,29 @@ PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBuffe
     }
     return PLUS_FAIL;
   }
-  status = this->GetStreamBufferItem(itemAuid, &itemA); 
-  if ( status != ITEM_OK )
+  itemA = this->StreamBuffer->GetBufferItemFromUid(itemAuid); 
+  if ( itemA == NULL )
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer item with Uid: " << itemAuid );
     return PLUS_FAIL;
   }
 
   // If tracker is out of view, etc. then we don't have a valid before and after the requested time, so we cannot do interpolation
-  if (itemA.GetStatus() != TOOL_OK)
+  if (itemA->GetStatus() != TOOL_OK)
   {
     // tracker is out of view, ...
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Cannot do data interpolation. The closest item to the requested time (time: " << std::fixed << time << ", uid: " << itemAuid << ") is invalid.");
     return PLUS_FAIL;
   }
 
-  double itemAtime(0);
-  status = this->StreamBuffer->GetTimeStamp(itemAuid, itemAtime); 
-  if ( status != ITEM_OK )
-  {
-    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time << ", uid: " << itemAuid << ")" ); 
-    return PLUS_FAIL;
-  }
+  itemAtime = itemA->GetFilteredTimestamp(this->StreamBuffer->GetLocalTimeOffsetSec());
 
   // If the time difference is negligible then don't interpolate, just return the closest item
   if (fabs(itemAtime - time) < NEGLIGIBLE_TIME_DIFFERENCE)
   {
     //No need for interpolation, it's very close to the closest element
-    itemB.DeepCopy(&itemA);
+    itemB = itemA;
+    itemBtime = itemAtime;
     return PLUS_SUCCESS;
   }  
 
@@ -1059,28 +1122,21 @@ PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBuffe
     return PLUS_FAIL;
   }
   // Get item B details
-  double itemBtime(0);
-  status = this->StreamBuffer->GetTimeStamp(itemBuid, itemBtime); 
-  if ( status != ITEM_OK )
+  itemB = this->StreamBuffer->GetBufferItemFromUid(itemBuid); 
+  if ( itemB == NULL )
   {
-    LOCAL_LOG_ERROR("Cannot do interpolation: Failed to get data buffer timestamp with Uid: " << itemBuid ); 
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer item with Uid: " << itemBuid ); 
     return PLUS_FAIL;
   }
+  itemBtime = itemB->GetFilteredTimestamp(this->StreamBuffer->GetLocalTimeOffsetSec());
   // If the next closest item is too far, then we don't do interpolation 
   if ( fabs(itemBtime - time) > this->GetMaxAllowedTimeDifference() )
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Cannot perform interpolation, time difference compared to itemB is too big " << std::fixed << fabs(itemBtime-time) << " ( itemBtime: " << itemBtime << ", requested time: " << time << ")." );
     return PLUS_FAIL;
   }
-  // Get the item
-  status = this->GetStreamBufferItem(itemBuid, &itemB); 
-  if ( status != ITEM_OK )
-  {
-    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer item with Uid: " << itemBuid ); 
-    return PLUS_FAIL;
-  }
   // If there is no valid element on the other side of the requested time, then we cannot do an interpolation
-  if ( itemB.GetStatus() != TOOL_OK )
+  if ( itemB->GetStatus() != TOOL_OK )
   {
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Cannot get a second element (uid="<<itemBuid<<") on the other side of the requested time ("<< std::fixed << time <<")");
     return PLUS_FAIL;
@@ -1172,12 +1228,18 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItemFromClosestTime( double time, Strea
 // The rotation is interpolated with SLERP interpolation, and the
 // position is interpolated with linear interpolation.
 // The flags correspond to the closest element.
+// The buffer is locked only once and the interpolation is computed directly from the items in the buffer,
+// only the resulting item is copied.
 ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime( double time, StreamBufferItem* bufferItem)
 {
-  StreamBufferItem itemA; 
-  StreamBufferItem itemB; 
+  PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
 
-  if (GetPrevNextBufferItemFromTime(time, itemA, itemB)!=PLUS_SUCCESS)
+  StreamBufferItem* itemA = NULL; 
+  StreamBufferItem* itemB = NULL; 
+  double itemAtime(0);
+  double itemBtime(0);   
+
+  if (GetPrevNextBufferItemFromTime(time, itemA, itemB, itemAtime, itemBtime)!=PLUS_SUCCESS)
   {
     // cannot get two neighbors, so cannot do interpolation
     // it may be normal (e.g., when tracker out of view), so don't return with an error   
@@ -1194,33 +1256,19 @@ ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime( double time,
     return ITEM_OK;
   }
 
-  if (itemA.GetUid()==itemB.GetUid())
+  if (itemA==itemB)
   {
     // exact match, no need for interpolation
-    bufferItem->DeepCopy(&itemA);
+    bufferItem->DeepCopy(itemA);
     return ITEM_OK;
   }
 
   //============== Get item weights ==================
 
-  double itemAtime(0);
-  if ( this->StreamBuffer->GetTimeStamp(itemA.GetUid(), itemAtime) != ITEM_OK )
-  {
-    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time <<", uid: "<<itemA.GetUid()<<")" ); 
-    return ITEM_UNKNOWN_ERROR;
-  }
-
-  double itemBtime(0);   
-  if ( this->StreamBuffer->GetTimeStamp(itemB.GetUid(), itemBtime) != ITEM_OK )
-  {
-    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time <<", uid: "<<itemB.GetUid()<<")" ); 
-    return ITEM_UNKNOWN_ERROR;
-  }
-
   if (fabs(itemAtime-itemBtime)<NEGLIGIBLE_TIME_DIFFERENCE)
   {
     // exact time match, no need for interpolation
-    bufferItem->DeepCopy(&itemA);
+    bufferItem->DeepCopy(itemA);
     bufferItem->SetFilteredTimestamp(time); 
     bufferItem->SetUnfilteredTimestamp(time);
     return ITEM_OK;    
@@ -1231,36 +1279,28 @@ ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime( double time,
 
   //============== Get transform matrices ==================
 
-  vtkSmartPointer<vtkMatrix4x4> itemAmatrix=vtkSmartPointer<vtkMatrix4x4>::New();
-  if (itemA.GetMatrix(itemAmatrix)!=PLUS_SUCCESS)
-  {
-    LOCAL_LOG_ERROR("Failed to get item A matrix"); 
-    return ITEM_UNKNOWN_ERROR;
-  }
+  double itemAmatrix[16];
+  itemA->GetMatrixElements(itemAmatrix);
   double matrixA[3][3]={{0,0,0},{0,0,0},{0,0,0}};
   double xyzA[3]={0,0,0};
   for (int i = 0; i < 3; i++)
   {
-    matrixA[i][0] = itemAmatrix->GetElement(i,0);
-    matrixA[i][1] = itemAmatrix->GetElement(i,1);
-    matrixA[i][2] = itemAmatrix->GetElement(i,2);
-    xyzA[i] = itemAmatrix->GetElement(i,3);
+    matrixA[i][0] = itemAmatrix[i*4+0];
+    matrixA[i][1] = itemAmatrix[i*4+1];
+    matrixA[i][2] = itemAmatrix[i*4+2];
+    xyzA[i] = itemAmatrix[i*4+3];
   }  
 
-  vtkSmartPointer<vtkMatrix4x4> itemBmatrix=vtkSmartPointer<vtkMatrix4x4>::New();
-  if (itemB.GetMatrix(itemBmatrix)!=PLUS_SUCCESS)
-  {
-    LOCAL_LOG_ERROR("Failed to get item B matrix"); 
-    return ITEM_UNKNOWN_ERROR;
-  }
+  double itemBmatrix[16];
+  itemB->GetMatrixElements(itemBmatrix);
   double matrixB[3][3] = {{0,0,0}, {0,0,0}, {0,0,0}};
   double xyzB[3] = {0,0,0};
   for (int i = 0; i < 3; i++)
   {
-    matrixB[i][0] = itemBmatrix->GetElement(i,0);
-    matrixB[i][1] = itemBmatrix->GetElement(i,1);
-    matrixB[i][2] = itemBmatrix->GetElement(i,2);
-    xyzB[i] = itemBmatrix->GetElement(i,3);
+    matrixB[i][0] = itemBmatrix[i*4+0];
+    matrixB[i][1] = itemBmatrix[i*4+1];
+    matrixB[i][2] = itemBmatrix[i*4+2];
+    xyzB[i] = itemBmatrix[i*4+3];
   }
 
   //============== Interpolate rotation ==================
@@ -1274,33 +1314,33 @@ ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime( double time,
   double interpolatedRotation[3][3] = {{0,0,0},{0,0,0},{0,0,0}};
   vtkMath::QuaternionToMatrix3x3(interpolatedRotationQuat, interpolatedRotation);
 
-  vtkSmartPointer<vtkMatrix4x4> interpolatedMatrix = vtkSmartPointer<vtkMatrix4x4>::New(); 
+  double interpolatedMatrix[16] = {0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,1};
   for (int i = 0; i < 3; i++)
   {
-    interpolatedMatrix->Element[i][0] = interpolatedRotation[i][0];
-    interpolatedMatrix->Element[i][1] = interpolatedRotation[i][1];
-    interpolatedMatrix->Element[i][2] = interpolatedRotation[i][2];
-    interpolatedMatrix->Element[i][3] = xyzA[i]*itemAweight + xyzB[i]*itemBweight;
+    interpolatedMatrix[i*4+0] = interpolatedRotation[i][0];
+    interpolatedMatrix[i*4+1] = interpolatedRotation[i][1];
+    interpolatedMatrix[i*4+2] = interpolatedRotation[i][2];
+    interpolatedMatrix[i*4+3] = xyzA[i]*itemAweight + xyzB[i]*itemBweight;
   } 
 
   //============== Interpolate time ==================
 
-  double itemAunfilteredTimestamp = itemA.GetUnfilteredTimestamp(0.0); // 0.0 because timestamps in the buffer are in local time
-  double itemBunfilteredTimestamp = itemB.GetUnfilteredTimestamp(0.0); // 0.0 because timestamps in the buffer are in local time
+  double itemAunfilteredTimestamp = itemA->GetUnfilteredTimestamp(0.0); // 0.0 because timestamps in the buffer are in local time
+  double itemBunfilteredTimestamp = itemB->GetUnfilteredTimestamp(0.0); // 0.0 because timestamps in the buffer are in local time
   double interpolatedUnfilteredTimestamp = itemAunfilteredTimestamp*itemAweight + itemBunfilteredTimestamp*itemBweight;
 
   //============== Write interpolated results into the bufferItem ==================
 
-  bufferItem->DeepCopy(&itemA);
-  bufferItem->SetMatrix(interpolatedMatrix); 
+  bufferItem->DeepCopy(itemA);
+  bufferItem->SetMatrixElements(interpolatedMatrix); 
   bufferItem->SetFilteredTimestamp(time-this->StreamBuffer->GetLocalTimeOffsetSec()); // global = local + offset => local = global - offset
   bufferItem->SetUnfilteredTimestamp(interpolatedUnfilteredTimestamp); 
 
-  double angleDiffA=PlusMath::GetOrientationDifference(interpolatedMatrix, itemAmatrix);
-  double angleDiffB=PlusMath::GetOrientationDifference(interpolatedMatrix, itemBmatrix);
-  if (fabs(angleDiffA)>ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG && fabs(angleDiffB)>ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG)
+  double angleDiffA=GetQuaternionAngleDifferenceDeg(interpolatedRotationQuat, matrixAquat);
+  double angleDiffB=GetQuaternionAngleDifferenceDeg(interpolatedRotationQuat, matrixBquat);
+  if (angleDiffA>ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG && angleDiffB>ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG)
   {
-    LOCAL_LOG_WARNING("Angle difference between interpolated orientations is large ("<<fabs(angleDiffA)<<" and "<<fabs(angleDiffB)<<" deg, warning threshold is "<<ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG<<"), interpolation may be inaccurate. Consider moving the tools slower.");
+    LOCAL_LOG_WARNING("Angle difference between interpolated orientations is large ("<<angleDiffA<<" and "<<angleDiffB<<" deg, warning threshold is "<<ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG<<"), interpolation may be inaccurate. Consider moving the tools slower.");
   }
 
   return ITEM_OK; 
@@ -241,8 +241,11 @@ protected:
   */
   virtual bool CheckFrameFormat( const int frameSizeInPx[2], PlusCommon::VTKScalarPixelType pixelType, US_IMAGE_TYPE imgType, int numberOfScalarComponents );
 
-  /*! Returns the two buffer items that are closest previous and next buffer items relative to the specified time. itemA is the closest item */
-  PlusStatus GetPrevNextBufferItemFromTime(double time, StreamBufferItem& itemA, StreamBufferItem& itemB);
+  /*!
+    Returns the two buffer items that are closest previous and next buffer items relative to the specified time. itemA is the closest item.
+    The returned pointers refer to items in the buffer, so the buffer must be kept locked while they are used.
+  */
+  PlusStatus GetPrevNextBufferItemFromTime(double time, StreamBufferItem*& itemA, StreamBufferItem*& itemB, double& itemAtime, double& itemBtime);
 
   /*! 
   Interpolate the matrix for the given timestamp from the two nearest transforms in the buffer.
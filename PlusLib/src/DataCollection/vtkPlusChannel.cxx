@@ -9,6 +9,8 @@ See License.txt for details.
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
+#include "vtkPlusTracer.h"
+#include "vtkRecursiveCriticalSection.h"
 
 //----------------------------------------------------------------------------
 
@@ -29,6 +31,7 @@ vtkPlusChannel::vtkPlusChannel(void)
 , RfProcessor(NULL)
 , BlankImage(vtkImageData::New())
 , SaveRfProcessingParameters(false)
+, ChannelMutex(vtkRecursiveCriticalSection::New())
 {
   // Default size for brightness frame
   this->BrightnessFrameSize[0] = 640;
@@ -59,6 +62,8 @@ vtkPlusChannel::~vtkPlusChannel(void)
   DELETE_IF_NOT_NULL(this->BlankImage);
 
   DELETE_IF_NOT_NULL(this->RfProcessor);
+
+  DELETE_IF_NOT_NULL(this->ChannelMutex);
 }
 
 //----------------------------------------------------------------------------
@@ -201,6 +206,7 @@ PlusStatus vtkPlusChannel::WriteConfiguration( vtkXMLDataElement* aChannelElemen
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetVideoSource( vtkPlusDataSource*& aVideoSource )
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   if( this->HasVideoSource() )
   {
     aVideoSource = this->VideoSource;
@@ -213,6 +219,7 @@ PlusStatus vtkPlusChannel::GetVideoSource( vtkPlusDataSource*& aVideoSource )
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetVideoSource( vtkPlusDataSource*& aVideoSource ) const
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   if( this->HasVideoSource() )
   {
     aVideoSource = this->VideoSource;
@@ -225,6 +232,7 @@ PlusStatus vtkPlusChannel::GetVideoSource( vtkPlusDataSource*& aVideoSource ) co
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTool(vtkPlusDataSource*& aTool, const char* toolName )
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   if( toolName == NULL )
   {
     LOG_ERROR("Null toolname sent to stream tool request.");
@@ -270,6 +278,7 @@ DataSourceContainerIterator vtkPlusChannel::GetToolsEndIterator()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::AddTool(vtkPlusDataSource* aTool )
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   if( aTool == NULL )
   {
     LOG_ERROR("Trying to add null tool to stream.");
@@ -294,6 +303,7 @@ PlusStatus vtkPlusChannel::AddTool(vtkPlusDataSource* aTool )
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::RemoveTool( const char* toolName )
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   if( toolName == NULL )
   {
     LOG_ERROR("Trying to remove null toolname from stream.");
@@ -315,6 +325,7 @@ PlusStatus vtkPlusChannel::RemoveTool( const char* toolName )
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::RemoveTools()
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   this->Tools.clear();
 
   return PLUS_SUCCESS;
@@ -323,6 +334,7 @@ PlusStatus vtkPlusChannel::RemoveTools()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::Clear()
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   for( DataSourceContainerIterator it = this->Tools.begin(); it != this->Tools.end(); ++it)
   {
     (it->second)->GetBuffer()->Clear();
@@ -337,6 +349,7 @@ PlusStatus vtkPlusChannel::Clear()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetLatestTimestamp(double& aTimestamp) const
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   aTimestamp = 0;
 
   if( this->HasVideoSource() )
@@ -366,21 +379,33 @@ PlusStatus vtkPlusChannel::GetLatestTimestamp(double& aTimestamp) const
 //----------------------------------------------------------------------------
 void vtkPlusChannel::ShallowCopy( const vtkPlusChannel& aChannel )
 {
-  this->Clear();
-
-  vtkPlusDataSource* aSource = NULL;
-  if( aChannel.HasVideoSource() && aChannel.GetVideoSource(aSource) )
+  // The data sources are shared with the copied channel, so their buffers must not be cleared here,
+  // only the references to the previous data sources are replaced.
+  // The new data sources are collected first and swapped in under the channel lock, so a consumer that
+  // reads the frames of this channel from another thread never sees a partially filled channel.
+  vtkPlusDataSource* newVideoSource = NULL;
+  DataSourceContainer newTools;
   {
-    this->VideoSource = aSource;
-  }
-  for( DataSourceContainerConstIterator it = aChannel.GetToolsStartConstIterator(); it != aChannel.GetToolsEndConstIterator(); ++it)
-  {
-    if( this->AddTool(it->second) != PLUS_SUCCESS )
+    PlusLockGuard<vtkRecursiveCriticalSection> sourceChannelGuardedLock(aChannel.ChannelMutex);
+    if( aChannel.HasVideoSource() )
     {
-      LOG_ERROR("Unable to add a tool when shallow copying a stream.");
-      continue;
+      newVideoSource = aChannel.VideoSource;
+    }
+    for( DataSourceContainerConstIterator it = aChannel.Tools.begin(); it != aChannel.Tools.end(); ++it)
+    {
+      if( it->second == NULL )
+      {
+        LOG_ERROR("Unable to add a tool when shallow copying a stream.");
+        continue;
+      }
+      newTools[it->second->GetSourceId()] = it->second;
+      it->second->Register(this);
     }
   }
+
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
+  this->Tools.swap(newTools);
+  this->VideoSource = newVideoSource;
 }
 
 //----------------------------------------------------------------------------
@@ -392,12 +417,16 @@ bool vtkPlusChannel::HasVideoSource() const
 //----------------------------------------------------------------------------
 void vtkPlusChannel::SetVideoSource( vtkPlusDataSource* aSource )
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   this->VideoSource = aSource;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrame( double timestamp, TrackedFrame& aTrackedFrame, bool enableImageData/*=true*/ )
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
+  PlusTraceScope traceScope("vtkPlusChannel::GetTrackedFrame");
+
   int numberOfErrors(0);
   double synchronizedTimestamp(0);
 
@@ -432,6 +461,7 @@ PlusStatus vtkPlusChannel::GetTrackedFrame( double timestamp, TrackedFrame& aTra
       LOG_ERROR("Couldn't get video buffer item by frame UID: " << frameUID); 
       return PLUS_FAIL; 
     }
+    traceScope.SetFrameUid(frameUID);
 
     // Copy frame 
     PlusVideoFrame frame = CurrentStreamBufferItem.GetFrame(); 
@@ -534,6 +564,7 @@ PlusStatus vtkPlusChannel::GetTrackedFrame( double timestamp, TrackedFrame& aTra
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrame(TrackedFrame* trackedFrame)
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   LOG_TRACE("vtkPlusDevice::GetTrackedFrame - TrackedFrame"); 
 
   double mostRecentFrameTimestamp(0);
@@ -555,6 +586,7 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(TrackedFrame* trackedFrame)
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrameList( double& aTimestampFrom, vtkTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd )
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   LOG_TRACE("vtkPlusDevice::GetTrackedFrameList(" << aTimestampFrom << ", " << aMaxNumberOfFramesToAdd << ")"); 
 
   if ( aTrackedFrameList == NULL )
@@ -755,8 +787,8 @@ PlusStatus vtkPlusChannel::GetTrackedFrameList( double& aTimestampFrom, vtkTrack
       return PLUS_FAIL;
     }
 
-    // Add tracked frame to the list 
-    if ( aTrackedFrameList->AddTrackedFrame(&trackedFrame, vtkTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS )
+    // Add tracked frame to the list (the frame content is moved, not copied)
+    if ( aTrackedFrameList->AddTrackedFrameBySwap(&trackedFrame, vtkTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS )
     {
       LOG_ERROR("Unable to add tracked frame to the list!" ); 
       return PLUS_FAIL; 
@@ -830,6 +862,7 @@ PlusStatus vtkPlusChannel::GetTrackedFrameList( double& aTimestampFrom, vtkTrack
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double &aTimestampOfLastFrameAlreadyGot, double& aTimestampOfNextFrameToBeAdded, vtkTrackedFrameList* aTrackedFrameList, double aSamplingPeriodSec, double maxTimeLimitSec/*=-1*/)
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   LOG_TRACE("vtkDataCollector::GetTrackedFrameListSampled: aTimestampOfLastFrameAlreadyGot="<<aTimestampOfLastFrameAlreadyGot<<", aTimestampOfNextFrameToBeAdded="<<aTimestampOfNextFrameToBeAdded<<", aSamplingPeriodSec="<< aSamplingPeriodSec); 
 
   if ( aTrackedFrameList == NULL )
@@ -895,8 +928,8 @@ PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double &aTimestampOfLastFr
       continue;
     }
     aTimestampOfLastFrameAlreadyGot=trackedFrame.GetTimestamp();
-    // Add tracked frame to the list 
-    if ( aTrackedFrameList->AddTrackedFrame(&trackedFrame, vtkTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS )
+    // Add tracked frame to the list (the frame content is moved, not copied)
+    if ( aTrackedFrameList->AddTrackedFrameBySwap(&trackedFrame, vtkTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS )
     {
       LOG_ERROR("vtkPlusChannel::GetTrackedFrameListSampled: Unable to add tracked frame to the list" ); 
       status=PLUS_FAIL; 
@@ -910,6 +943,7 @@ PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double &aTimestampOfLastFr
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetOldestTimestamp(double &ts)
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   LOG_TRACE("vtkPlusChannel::GetOldestTimestamp"); 
   ts=0;
 
@@ -1002,6 +1036,7 @@ PlusStatus vtkPlusChannel::GetOldestTimestamp(double &ts)
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetMostRecentTimestamp(double &ts)
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   LOG_TRACE("vtkPlusChannel::GetMostRecentTimestamp"); 
   ts=0;
 
@@ -1143,6 +1178,7 @@ PlusStatus vtkPlusChannel::GetMostRecentTimestamp(double &ts)
 //----------------------------------------------------------------------------
 bool vtkPlusChannel::GetTrackingDataAvailable()
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   vtkPlusDataSource* aSource = NULL;
   if( this->HasVideoSource() && this->GetVideoSource(aSource) == PLUS_SUCCESS )
   {
@@ -1174,6 +1210,7 @@ bool vtkPlusChannel::GetTrackingDataAvailable()
 //----------------------------------------------------------------------------
 bool vtkPlusChannel::GetVideoDataAvailable()
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   if( !this->HasVideoSource() )
   {
     return false;
@@ -1206,6 +1243,7 @@ bool vtkPlusChannel::GetVideoEnabled() const
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetFirstActiveTool(vtkPlusDataSource*& aTool)
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   if ( this->GetToolsStartConstIterator() == this->GetToolsEndConstIterator() )
   {
     LOG_ERROR("Failed to get first active tool - there is no active tool!"); 
@@ -1221,6 +1259,7 @@ PlusStatus vtkPlusChannel::GetFirstActiveTool(vtkPlusDataSource*& aTool)
 //----------------------------------------------------------------------------
 int vtkPlusChannel::GetNumberOfFramesBetweenTimestamps(double aTimestampFrom, double aTimestampTo)
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   LOG_TRACE("vtkPlusChannel::GetNumberOfFramesBetweenTimestamps(" << aTimestampFrom << ", " << aTimestampTo << ")");
 
   int numberOfFrames = 0;
@@ -1281,6 +1320,7 @@ int vtkPlusChannel::GetNumberOfFramesBetweenTimestamps(double aTimestampFrom, do
 //----------------------------------------------------------------------------
 double vtkPlusChannel::GetClosestTrackedFrameTimestampByTime(double time)
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   if ( this->GetVideoDataAvailable() )
   {
     BufferItemUidType uid=0;
@@ -1384,6 +1424,7 @@ vtkImageData* vtkPlusChannel::GetBrightnessOutput()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetCustomAttribute( const std::string& attributeId, std::string& output ) const
 {
+  PlusLockGuard<vtkRecursiveCriticalSection> channelGuardedLock(this->ChannelMutex);
   if( this->CustomAttributes.find(attributeId) != this->CustomAttributes.end() )
   {
     output = this->CustomAttributes.find(attributeId)->second;
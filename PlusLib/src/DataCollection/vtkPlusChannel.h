@@ -10,6 +10,7 @@
 #include "PlusConfigure.h"
 #include "vtkDataObject.h"
 #include "vtkPlusDevice.h"
+#include "vtkRecursiveCriticalSection.h"
 #include "vtkRfProcessor.h"
 
 class vtkPlusDevice;
@@ -103,6 +104,11 @@ public:
 
   virtual PlusStatus Clear();
 
+  /*!
+    Make this channel use the same data sources as the specified channel. The buffers are not copied,
+    the frames of the data sources can be read through both channels.
+    The data sources are replaced under the channel lock, see Lock().
+  */
   virtual void ShallowCopy(const vtkPlusChannel& aChannel);
 
   virtual PlusStatus GetLatestTimestamp(double& aTimestamp) const;
@@ -122,6 +128,15 @@ public:
 
   vtkSetMacro(SaveRfProcessingParameters, bool);
 
+  /*!
+    Lock the data sources of the channel. The frame and timestamp queries of the channel lock it internally,
+    the caller has to lock it only while iterating through the tools, if the data sources may be replaced
+    from another thread (e.g., by ShallowCopy in a switcher device).
+  */
+  void Lock() { this->ChannelMutex->Lock(); }
+  /*! Unlock the data sources of the channel */
+  void Unlock() { this->ChannelMutex->Unlock(); }
+
 protected:
   /*! Get number of tracked frames between two given timestamps (inclusive) */
   virtual int GetNumberOfFramesBetweenTimestamps(double aTimestampFrom, double aTimestampTo);
@@ -143,6 +158,9 @@ protected:
 
   CustomAttributeMap CustomAttributes;
 
+  /*! Protects Tools and VideoSource, which may be replaced by ShallowCopy while the frames are read */
+  vtkRecursiveCriticalSection* ChannelMutex;
+
   vtkPlusChannel(void);
   virtual ~vtkPlusChannel(void);
 
@@ -18,6 +18,7 @@ See License.txt for details.
 #include "vtkPlusDataSource.h"
 #include "vtkPlusDevice.h"
 #include "vtkPlusBuffer.h"
+#include "vtkPlusTracer.h"
 #include "vtkRecursiveCriticalSection.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkTrackedFrameList.h"
@@ -441,6 +442,8 @@ void vtkPlusDevice::SetToolsBufferSize( int aBufferSize )
 //----------------------------------------------------------------------------
 void vtkPlusDevice::SetLocalTimeOffsetSec( double aTimeOffsetSec )
 {
+  // The offset may be changed from another thread (e.g., by a virtual device) while the buffers are updated
+  PlusLockGuard<vtkRecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
   for( DataSourceContainerIterator it = this->VideoSources.begin(); it != this->VideoSources.end(); ++it )
   {
     vtkPlusDataSource* image = it->second;
@@ -1135,6 +1138,7 @@ void* vtkPlusDevice::vtkDataCaptureThread(vtkMultiThreader::ThreadInfo *data)
         // recording has been stopped
         break;
       }
+      PlusTraceScope traceScope("vtkPlusDevice::InternalUpdate");
       self->InternalUpdate();
       self->UpdateTime.Modified();
     }
@@ -1928,6 +1932,18 @@ ChannelContainerIterator vtkPlusDevice::GetOutputChannelsEnd()
   return this->OutputChannels.end();
 }
 
+//----------------------------------------------------------------------------
+ChannelContainerConstIterator vtkPlusDevice::GetInputChannelsStart() const
+{
+  return this->InputChannels.begin();
+}
+
+//----------------------------------------------------------------------------
+ChannelContainerConstIterator vtkPlusDevice::GetInputChannelsEnd() const
+{
+  return this->InputChannels.end();
+}
+
 //------------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::GetToolReferenceFrameFromTrackedFrame(TrackedFrame& aFrame, std::string &aToolReferenceFrameName)
 {
@@ -377,6 +377,10 @@ public:
   /*! Add an input channel */
   PlusStatus AddInputChannel(vtkPlusChannel* aChannel);
 
+  /*! Access the input channels (output channels of other devices that this device uses) */
+  ChannelContainerConstIterator GetInputChannelsStart() const;
+  ChannelContainerConstIterator GetInputChannelsEnd() const;
+
   /*!
   Perform any completion tasks once configured
   */
@@ -57,6 +57,7 @@ See License.txt for details.
 // Video sources
 #include "vtkSavedDataSource.h"
 #include "vtkUsSimulatorVideoSource.h"
+#include "vtkLoadGeneratorSource.h"
 
 #ifdef PLUS_USE_VFW_VIDEO
 #include "vtkWin32VideoSource2.h"
@@ -143,6 +144,7 @@ vtkPlusDeviceFactory::vtkPlusDeviceFactory(void)
   DeviceTypes["SavedDataSource"]=(PointerToDevice)&vtkSavedDataSource::New; 
   DeviceTypes["UsSimulator"]=(PointerToDevice)&vtkUsSimulatorVideoSource::New; 
   DeviceTypes["NoiseVideo"]=(PointerToDevice)&vtkPlusDevice::New; 
+  DeviceTypes["LoadGenerator"]=(PointerToDevice)&vtkLoadGeneratorSource::New; 
 #ifdef PLUS_USE_OpenIGTLink
   DeviceTypes["OpenIGTLinkVideo"]=(PointerToDevice)&vtkOpenIGTLinkVideoSource::New; 
 #endif
@@ -86,6 +86,10 @@ public:
   PlusStatus SetMatrix(vtkMatrix4x4* matrix); 
   /*! Get tracker matrix */
   PlusStatus GetMatrix(vtkMatrix4x4* outputMatrix);
+  /*! Set tracker matrix from 16 elements in row-major order */
+  void SetMatrixElements(const double matrixElements[16]);
+  /*! Get tracker matrix elements in row-major order (faster than GetMatrix, as no matrix object is needed) */
+  void GetMatrixElements(double matrixElements[16]) const;
 
   /*! Set tracker item status */
   void SetStatus(ToolStatus status);
@@ -110,7 +114,8 @@ public:
 private:
   bool ValidTransformData;
   PlusVideoFrame Frame;
-  vtkSmartPointer<vtkMatrix4x4> Matrix;
+  /*! Tracker matrix elements in row-major order. Stored in the item (not in a separate vtkMatrix4x4 object) to avoid a heap allocation for each pose. */
+  double Matrix[16];
   ToolStatus Status;
 };
 
@@ -19,7 +19,6 @@
 
 static const short BLACK            = 0; 
 static const short MIN_WINDOW_DIST  = 8;
-static const short MAX_CLUSTER_VALS = 16384;
 
 const int FidSegmentation::DEFAULT_NUMBER_OF_MAXIMUM_FIDUCIAL_POINT_CANDIDATES = 20;
 
@@ -1276,20 +1275,30 @@ void FidSegmentation::Suppress( PixelType *image, double percent_thresh )
 
 //-----------------------------------------------------------------------------
 
-inline void FidSegmentation::ClusteringAddNeighbors( PixelType *image, int r, int c, std::vector<Dot> &testPosition, std::vector<Dot> &setPosition, std::vector<PixelType>& valuesOfPosition)
+inline unsigned int FidSegmentation::FindClusterRoot( unsigned int label )
 {
-  //LOG_TRACE("FidSegmentation::ClusteringAddNeighbors");
+  while ( m_ClusterLabelParents[label] != label )
+  {
+    // path halving
+    m_ClusterLabelParents[label] = m_ClusterLabelParents[m_ClusterLabelParents[label]];
+    label = m_ClusterLabelParents[label];
+  }
+  return label;
+}
 
-  if ( image[r*m_FrameSize[0]+c] > 0 && testPosition.size() < MAX_CLUSTER_VALS && setPosition.size() < MAX_CLUSTER_VALS )
+//-----------------------------------------------------------------------------
+
+inline unsigned int FidSegmentation::MergeClusters( unsigned int label1, unsigned int label2 )
+{
+  unsigned int root1 = FindClusterRoot(label1);
+  unsigned int root2 = FindClusterRoot(label2);
+  if ( root1 < root2 )
   {
-    Dot dot;
-    dot.SetY(r);
-    dot.SetX(c);
-    testPosition.push_back(dot);
-    setPosition.push_back(dot);  
-    valuesOfPosition.push_back(image[r*m_FrameSize[0]+c]);
-    image[r*m_FrameSize[0]+c] = 0;
+    m_ClusterLabelParents[root2] = root1;
+    return root1;
   }
+  m_ClusterLabelParents[root1] = root2;
+  return root2;
 }
 
 //-----------------------------------------------------------------------------
@@ -1317,87 +1326,132 @@ inline bool FidSegmentation::AcceptDot( Dot &dot )
 void FidSegmentation::Cluster(PatternRecognitionError& patternRecognitionError)
 {
   LOG_TRACE("FidSegmentation::Cluster");
-  
-  std::vector<Dot> testPosition;
-  std::vector<Dot> setPosition;
-  std::vector<PixelType> valuesOfPosition;
 
-  for ( unsigned int r = m_RegionOfInterest[1]; r < m_RegionOfInterest[3]; r++ ) 
-  {
-    for ( unsigned int c = m_RegionOfInterest[0]; c < m_RegionOfInterest[2]; c++ ) 
+  const int rowMin = m_RegionOfInterest[1];
+  const int rowMax = m_RegionOfInterest[3];
+  const int colMin = m_RegionOfInterest[0];
+  const int colMax = m_RegionOfInterest[2];
+  const int cols = m_FrameSize[0];
+
+  // The labels are stored at the same position as the pixels (only the region of interest is used)
+  m_ClusterLabels.resize(m_FrameSize[0]*m_FrameSize[1]);
+  // Label 0 is reserved for the background
+  m_ClusterLabelParents.clear();
+  m_ClusterLabelParents.push_back(0);
+
+  // First pass: assign provisional labels and record the equivalences.
+  // Only the already visited neighbors are checked (W, NW, N, NE).
+  for ( int r = rowMin; r < rowMax; r++ ) 
+  {
+    PixelType* pixel = m_Working + r*cols + colMin;
+    unsigned int* label = &(m_ClusterLabels[r*cols + colMin]);
+    for ( int c = colMin; c < colMax; c++, pixel++, label++ ) 
     {
-      if ( m_Working[r*m_FrameSize[0]+c] > 0 ) 
+      if ( *pixel == 0 )
       {
-        testPosition.clear();
-
-        Dot dot;
-        dot.SetX(c);
-        dot.SetY(r);
-        testPosition.push_back(dot);
-
-        setPosition.clear();
-        setPosition.push_back(dot);
-
-        valuesOfPosition.clear();
-        valuesOfPosition.push_back(m_Working[r*m_FrameSize[0]+c]);
-
-        m_Working[r*m_FrameSize[0]+c] = 0;
+        *label = 0;
+        continue;
+      }
 
-        while ( testPosition.size() > 0 ) 
+      unsigned int neighborLabel = 0;
+      if ( c > colMin && label[-1] != 0 )
+      {
+        neighborLabel = label[-1];
+      }
+      if ( r > rowMin )
+      {
+        const unsigned int* labelAbove = label - cols;
+        if ( c > colMin && labelAbove[-1] != 0 )
+        {
+          neighborLabel = ( neighborLabel == 0 ) ? labelAbove[-1] : MergeClusters(neighborLabel, labelAbove[-1]);
+        }
+        if ( labelAbove[0] != 0 )
         {
-          Dot dot=testPosition.back();
-          testPosition.pop_back();
+          neighborLabel = ( neighborLabel == 0 ) ? labelAbove[0] : MergeClusters(neighborLabel, labelAbove[0]);
+        }
+        if ( c+1 < colMax && labelAbove[1] != 0 )
+        {
+          neighborLabel = ( neighborLabel == 0 ) ? labelAbove[1] : MergeClusters(neighborLabel, labelAbove[1]);
+        }
+      }
 
-          ClusteringAddNeighbors( m_Working, dot.GetY()-1, dot.GetX()-1, testPosition, setPosition, valuesOfPosition);
-          ClusteringAddNeighbors( m_Working, dot.GetY()-1, dot.GetX(), testPosition, setPosition, valuesOfPosition);
-          ClusteringAddNeighbors( m_Working, dot.GetY()-1, dot.GetX()+1, testPosition, setPosition, valuesOfPosition );
+      if ( neighborLabel == 0 )
+      {
+        // new cluster
+        neighborLabel = m_ClusterLabelParents.size();
+        m_ClusterLabelParents.push_back(neighborLabel);
+      }
+      *label = neighborLabel;
+    }
+  }
 
-          ClusteringAddNeighbors( m_Working, dot.GetY(), dot.GetX()-1, testPosition, setPosition, valuesOfPosition );
-          ClusteringAddNeighbors( m_Working, dot.GetY(), dot.GetX()+1, testPosition, setPosition, valuesOfPosition );
+  // Second pass: resolve the labels to the cluster roots and compute the moments of each cluster
+  ClusterMomentsType emptyMoments = { 0.0, 0.0, 0.0 };
+  m_ClusterMoments.assign(m_ClusterLabelParents.size(), emptyMoments);
+  for ( int r = rowMin; r < rowMax; r++ ) 
+  {
+    const PixelType* pixel = m_Working + r*cols + colMin;
+    unsigned int* label = &(m_ClusterLabels[r*cols + colMin]);
+    for ( int c = colMin; c < colMax; c++, pixel++, label++ ) 
+    {
+      if ( *label == 0 )
+      {
+        continue;
+      }
+      *label = FindClusterRoot(*label);
+      ClusterMomentsType &moments = m_ClusterMoments[*label];
+      double amount = (double)(*pixel) / (double)UCHAR_MAX;
+      moments.Total += amount;
+      moments.SumR += r * amount;
+      moments.SumC += c * amount;
+    }
+  }
 
-          ClusteringAddNeighbors( m_Working, dot.GetY()+1, dot.GetX()-1, testPosition, setPosition, valuesOfPosition );
-          ClusteringAddNeighbors( m_Working, dot.GetY()+1, dot.GetX(), testPosition, setPosition, valuesOfPosition );
-          ClusteringAddNeighbors( m_Working, dot.GetY()+1, dot.GetX()+1, testPosition, setPosition, valuesOfPosition );
-        }
+  // Create a dot from each cluster. The roots are visited in increasing label order, which is the raster order
+  // of the first pixel of the clusters.
+  for ( unsigned int clusterLabel = 1; clusterLabel < m_ClusterLabelParents.size(); clusterLabel++ )
+  {
+    if ( m_ClusterLabelParents[clusterLabel] != clusterLabel )
+    {
+      // not a root
+      continue;
+    }
+    const ClusterMomentsType &moments = m_ClusterMoments[clusterLabel];
 
-        double dest_r = 0, dest_c = 0, total = 0;
-        for ( int p = 0; p < setPosition.size(); p++ ) 
-        {
-          double amount = (double)valuesOfPosition[p] / (double)UCHAR_MAX;
-          dest_r += setPosition[p].GetY() * amount;
-          dest_c += setPosition[p].GetX() * amount;
-          total += amount;
-        }
+    Dot dot;
+    dot.SetY(moments.SumR / moments.Total);
+    dot.SetX(moments.SumC / moments.Total);
+    dot.SetDotIntensity(moments.Total);
 
-        dot.SetY(dest_r / total);
-        dot.SetX(dest_c / total);
-        dot.SetDotIntensity(total);
+    if ( !AcceptDot(dot) )
+    {
+      continue;
+    }
 
-        if ( AcceptDot(dot) )
+    if (m_UseOriginalImageIntensityForDotIntensityScore)
+    {
+      // Take into account intensities that are close to the dot center
+      const double dotRadius = 3.0;
+      const double dotRadius2 = dotRadius*dotRadius;
+      int neighborhoodRowMin = std::max<int>( rowMin, (int)ceil(dot.GetY()-dotRadius) );
+      int neighborhoodRowMax = std::min<int>( rowMax-1, (int)floor(dot.GetY()+dotRadius) );
+      int neighborhoodColMin = std::max<int>( colMin, (int)ceil(dot.GetX()-dotRadius) );
+      int neighborhoodColMax = std::min<int>( colMax-1, (int)floor(dot.GetX()+dotRadius) );
+      double total = 0;
+      for ( int r = neighborhoodRowMin; r <= neighborhoodRowMax; r++ )
+      {
+        for ( int c = neighborhoodColMin; c <= neighborhoodColMax; c++ )
         {
-          if (m_UseOriginalImageIntensityForDotIntensityScore)
+          if ( m_ClusterLabels[r*cols+c] == clusterLabel && (r-dot.GetY())*(r-dot.GetY())+(c-dot.GetX())*(c-dot.GetX()) <= dotRadius2 )
           {
-            // Take into account intensities that are close to the dot center
-            const double dotRadius2=3.0*3.0;
-            double dest_r = 0, dest_c = 0, total = 0;
-            for ( int p = 0; p < setPosition.size(); p++ ) 
-            {
-              if ( (setPosition[p].GetY()-dot.GetY())*(setPosition[p].GetY()-dot.GetY())+(setPosition[p].GetX()-dot.GetX())*(setPosition[p].GetX()-dot.GetX())<=dotRadius2)
-              {
-                //double amount = (double)vals[p] / (double)UCHAR_MAX;
-                double amount = (double)m_UnalteredImage[int(setPosition[p].GetY()*m_FrameSize[0]+setPosition[p].GetX())] / (double)UCHAR_MAX;
-                dest_r += setPosition[p].GetY() * amount;
-                dest_c += setPosition[p].GetX() * amount;
-                total += amount;
-              }
-            }
-            dot.SetDotIntensity(total);
+            total += (double)m_UnalteredImage[r*cols+c] / (double)UCHAR_MAX;
           }
-
-          m_DotsVector.push_back(dot);
         }
       }
+      dot.SetDotIntensity(total);
     }
+
+    m_DotsVector.push_back(dot);
   }
 
   std::sort(m_DotsVector.begin(), m_DotsVector.end(), Dot::IntensityLessThan);
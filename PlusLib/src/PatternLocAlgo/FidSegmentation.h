@@ -114,7 +114,11 @@ class FidSegmentation
     /*! Accept a dot as a possible fiducial */
     inline bool AcceptDot( Dot &dot );
 
-    /*! Cluster the dots */
+    /*!
+      Cluster the dots: find the connected components (8-connectivity) of the non-zero pixels in the
+      region of interest by a two-pass union-find labeling and compute the weighted center of each component.
+      The labeling buffers are reused between frames, so no memory is allocated in the steady state.
+    */
     void Cluster(PatternRecognitionError& patternRecognitionError);
 
     /*! Utility function to write image to file */
@@ -123,8 +127,11 @@ class FidSegmentation
     /*! Check if shape (structuring element) contains the new element (a point) */
     bool ShapeContains( std::vector<Coordinate2D>& shape, Coordinate2D point );
 
-    /*! Add neighbors to the cluster */
-    inline void ClusteringAddNeighbors(PixelType *image, int r, int c, std::vector<Dot> &m_Test, std::vector<Dot> &m_Set, std::vector<PixelType>&m_Vals);
+    /*! Get the root label of a cluster label (with path compression) */
+    inline unsigned int FindClusterRoot(unsigned int label);
+
+    /*! Merge the clusters of the two labels. The smaller label becomes the root, so the root is always the first label of the cluster in raster order. */
+    inline unsigned int MergeClusters(unsigned int label1, unsigned int label2);
     
     // Accessors and mutators
 
@@ -229,6 +236,21 @@ class FidSegmentation
     std::vector<Dot>      m_DotsVector;
 
     bool                  m_DebugOutput; 
+
+    /*! Sums for computing the weighted center of a cluster */
+    struct ClusterMomentsType
+    {
+      double Total;
+      double SumR;
+      double SumC;
+    };
+
+    /*! Cluster label of each pixel in the region of interest (0 means background). Reused between frames. */
+    std::vector<unsigned int> m_ClusterLabels;
+    /*! Union-find parent of each cluster label. Reused between frames. */
+    std::vector<unsigned int> m_ClusterLabelParents;
+    /*! Moments of each cluster, indexed by root label. Reused between frames. */
+    std::vector<ClusterMomentsType> m_ClusterMoments;
 };
 
 #endif // _FIDUCIAL_SEGMENTATION_H
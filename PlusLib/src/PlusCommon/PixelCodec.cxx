@@ -0,0 +1,515 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+#include "vtkMultiThreader.h"
+
+// SIMD converters are implemented with SSE4.1 intrinsics. With Visual Studio the intrinsics can be used without
+// any compiler option, with gcc and clang the functions that use them are compiled for the SSE4.1 target individually.
+// The SIMD code path is only used if the processor supports SSE4.1 (checked at runtime).
+// gcc older than 4.9 does not allow using the intrinsics in functions with a target attribute (only when the
+// whole file is compiled with -msse4.1), so with those compilers only the scalar converters are built.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #define PIXELCODEC_SIMD_AVAILABLE
+  #define PIXELCODEC_SIMD_FUNCTION
+  #include <intrin.h>
+  #include <smmintrin.h>
+#elif (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))) && (defined(__x86_64__) || defined(__i386__))
+  #define PIXELCODEC_SIMD_AVAILABLE
+  #define PIXELCODEC_SIMD_FUNCTION __attribute__((target("sse4.1")))
+  #include <smmintrin.h>
+#endif
+
+namespace
+{
+  // Conversion function that processes a contiguous range of pixels (or pixel pairs, for YUY2 input)
+  typedef void (*ConversionKernel)(PixelCodec::ComponentOrdering outputOrdering, int numberOfUnits, const unsigned char* s, unsigned char* d);
+
+  PixelCodec::ConversionMode ConversionModeSetting = PixelCodec::ConversionMode_Simd;
+  int NumberOfThreadsSetting = 1;
+
+  //----------------------------------------------------------------------------
+  // Scalar converters
+
+  //----------------------------------------------------------------------------
+  void Rgb24ToGrayScalar(PixelCodec::ComponentOrdering vtkNotUsed(outputOrdering), int numberOfPixels, const unsigned char* s, unsigned char* d)
+  {
+    for (int i=0; i<numberOfPixels; i++)
+    {
+      *d=((unsigned short)(s[0])+s[1]+s[2])/3;
+      d++;
+      s+=3;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void Bgr24ToRgb24Scalar(PixelCodec::ComponentOrdering vtkNotUsed(outputOrdering), int numberOfPixels, const unsigned char* s, unsigned char* d)
+  {
+    for (int i=0; i<numberOfPixels; i++)
+    {
+      // read all components first to allow in-place conversion
+      unsigned char c0=s[0];
+      unsigned char c1=s[1];
+      unsigned char c2=s[2];
+      d[0]=c2;
+      d[1]=c1;
+      d[2]=c0;
+      d+=3;
+      s+=3;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void Yuv422pToBmp24Scalar(PixelCodec::ComponentOrdering outputOrdering, int numberOfPixelPairs, const unsigned char* s, unsigned char* d)
+  {
+    unsigned char y1, u, y2, v;
+    int Y1, Y2, U, V;
+    unsigned char r, g, b;
+
+    for(int i = 0 ; i < numberOfPixelPairs ; i++)
+    {
+      y1 = s[0];
+      u = s[1];
+      y2 = s[2];
+      v = s[3];
+
+      Y1 = ICCIRY(y1);
+      U = ICCIRUV(u - 128);
+      Y2 = ICCIRY(y2);
+      V = ICCIRUV(v - 128);
+
+      r = CLIP(GET_R_FROM_YUV(Y1, U, V));
+      g = CLIP(GET_G_FROM_YUV(Y1, U, V));
+      b = CLIP(GET_B_FROM_YUV(Y1, U, V));
+
+      d[0] = (outputOrdering == PixelCodec::ComponentOrder_BGR ? b : r);
+      d[1] = g;
+      d[2] = (outputOrdering == PixelCodec::ComponentOrder_BGR ? r : b);
+
+      r = CLIP(GET_R_FROM_YUV(Y2, U, V));
+      g = CLIP(GET_G_FROM_YUV(Y2, U, V));
+      b = CLIP(GET_B_FROM_YUV(Y2, U, V));
+
+      d[3] = (outputOrdering == PixelCodec::ComponentOrder_BGR ? b : r);
+      d[4] = g;
+      d[5] = (outputOrdering == PixelCodec::ComponentOrder_BGR ? r : b);
+
+      d += 6;
+      s += 4;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void Yuv422pToGrayScalar(PixelCodec::ComponentOrdering vtkNotUsed(outputOrdering), int numberOfPixelPairs, const unsigned char* s, unsigned char* d)
+  {
+    unsigned char y1, u, y2, v;
+    int Y1, Y2, U, V;
+    unsigned char r, g, b;
+
+    for(int i = 0 ; i < numberOfPixelPairs ; i++)
+    {
+      y1 = s[0];
+      u = s[1];
+      y2 = s[2];
+      v = s[3];
+
+      Y1 = ICCIRY(y1);
+      U = ICCIRUV(u - 128);
+      Y2 = ICCIRY(y2);
+      V = ICCIRUV(v - 128);
+
+      r = CLIP(GET_R_FROM_YUV(Y1, U, V));
+      g = CLIP(GET_G_FROM_YUV(Y1, U, V));
+      b = CLIP(GET_B_FROM_YUV(Y1, U, V));
+
+      d[0] = (int(b)+g+r)/3;
+
+      r = CLIP(GET_R_FROM_YUV(Y2, U, V));
+      g = CLIP(GET_G_FROM_YUV(Y2, U, V));
+      b = CLIP(GET_B_FROM_YUV(Y2, U, V));
+
+      d[1] = (int(b)+g+r)/3;
+
+      d += 2;
+      s += 4;
+    }
+  }
+
+#ifdef PIXELCODEC_SIMD_AVAILABLE
+
+  //----------------------------------------------------------------------------
+  // SIMD converters
+  // Each function processes blocks of 16 pixels with SSE4.1 instructions and the remaining pixels with the scalar converter.
+  // The results are bit-exact with the scalar converters:
+  //  - integer division by 3 of a sum of three 8-bit values is computed as (sum*21846)>>16, which is exact for sum<=765
+  //  - the integer divisions in ICCIRY and ICCIRUV are computed in single precision floating point and truncated, which is
+  //    exact because the quotients are either integers or at least 1/224 away from the nearest integer
+
+  //----------------------------------------------------------------------------
+  // Pshufb masks for rearranging 48 bytes (3 SSE registers). Mask[k][j] selects the bytes of output register k from input register j.
+  struct ShuffleMasks48
+  {
+    unsigned char Mask[3][3][16];
+  };
+
+  //----------------------------------------------------------------------------
+  // sourceIndex[i] is the index of the input byte (0..47) that is written to output byte i
+  void BuildShuffleMasks48(const int sourceIndex[48], ShuffleMasks48 &masks)
+  {
+    for (int outputByte=0; outputByte<48; outputByte++)
+    {
+      int outputRegister=outputByte/16;
+      for (int inputRegister=0; inputRegister<3; inputRegister++)
+      {
+        // 0x80 means that the byte is set to zero by pshufb
+        masks.Mask[outputRegister][inputRegister][outputByte%16] =
+          (sourceIndex[outputByte]/16==inputRegister) ? static_cast<unsigned char>(sourceIndex[outputByte]%16) : 0x80;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  struct SimdShuffleTables
+  {
+    SimdShuffleTables()
+    {
+      int rgbToPlanes[48];
+      int swapFirstAndThirdComponent[48];
+      int planesToRgb[48];
+      int planesToBgr[48];
+      for (int i=0; i<48; i++)
+      {
+        // output: 16 first components, 16 second components, 16 third components
+        rgbToPlanes[i] = 3*(i%16) + i/16;
+        int pixel=i/3;
+        int component=i%3;
+        swapFirstAndThirdComponent[i] = 3*pixel + 2-component;
+        planesToRgb[i] = component*16 + pixel;
+        planesToBgr[i] = (2-component)*16 + pixel;
+      }
+      BuildShuffleMasks48(rgbToPlanes, this->RgbToPlanes);
+      BuildShuffleMasks48(swapFirstAndThirdComponent, this->SwapFirstAndThirdComponent);
+      BuildShuffleMasks48(planesToRgb, this->PlanesToRgb);
+      BuildShuffleMasks48(planesToBgr, this->PlanesToBgr);
+    }
+    ShuffleMasks48 RgbToPlanes;
+    ShuffleMasks48 SwapFirstAndThirdComponent;
+    ShuffleMasks48 PlanesToRgb;
+    ShuffleMasks48 PlanesToBgr;
+  };
+  const SimdShuffleTables ShuffleTables;
+
+  //----------------------------------------------------------------------------
+  bool DetectSimdSupport()
+  {
+#if defined(_MSC_VER)
+    int cpuInfo[4]={0,0,0,0};
+    __cpuid(cpuInfo, 1);
+    return (cpuInfo[2] & (1<<19)) != 0; // SSE4.1
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1") != 0;
+#endif
+  }
+  const bool SimdSupported = DetectSimdSupport();
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_SIMD_FUNCTION inline void Shuffle48(const __m128i in[3], const ShuffleMasks48 &masks, __m128i out[3])
+  {
+    for (int k=0; k<3; k++)
+    {
+      __m128i result = _mm_shuffle_epi8(in[0], _mm_loadu_si128((const __m128i*)masks.Mask[k][0]));
+      result = _mm_or_si128(result, _mm_shuffle_epi8(in[1], _mm_loadu_si128((const __m128i*)masks.Mask[k][1])));
+      out[k] = _mm_or_si128(result, _mm_shuffle_epi8(in[2], _mm_loadu_si128((const __m128i*)masks.Mask[k][2])));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Computes (a+b+c)/3 for 8 16-bit values (a, b, c <= 255)
+  PIXELCODEC_SIMD_FUNCTION inline __m128i AverageOfThree16(__m128i a, __m128i b, __m128i c)
+  {
+    return _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(a, b), c), _mm_set1_epi16(21846));
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_SIMD_FUNCTION void Rgb24ToGraySimd(PixelCodec::ComponentOrdering outputOrdering, int numberOfPixels, const unsigned char* s, unsigned char* d)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    int numberOfBlocks = numberOfPixels/16;
+    for (int block=0; block<numberOfBlocks; block++)
+    {
+      __m128i in[3] = { _mm_loadu_si128((const __m128i*)s), _mm_loadu_si128((const __m128i*)(s+16)), _mm_loadu_si128((const __m128i*)(s+32)) };
+      __m128i planes[3];
+      Shuffle48(in, ShuffleTables.RgbToPlanes, planes);
+      __m128i grayLow = AverageOfThree16(_mm_unpacklo_epi8(planes[0], zero), _mm_unpacklo_epi8(planes[1], zero), _mm_unpacklo_epi8(planes[2], zero));
+      __m128i grayHigh = AverageOfThree16(_mm_unpackhi_epi8(planes[0], zero), _mm_unpackhi_epi8(planes[1], zero), _mm_unpackhi_epi8(planes[2], zero));
+      _mm_storeu_si128((__m128i*)d, _mm_packus_epi16(grayLow, grayHigh));
+      s+=48;
+      d+=16;
+    }
+    Rgb24ToGrayScalar(outputOrdering, numberOfPixels-numberOfBlocks*16, s, d);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_SIMD_FUNCTION void Bgr24ToRgb24Simd(PixelCodec::ComponentOrdering outputOrdering, int numberOfPixels, const unsigned char* s, unsigned char* d)
+  {
+    int numberOfBlocks = numberOfPixels/16;
+    for (int block=0; block<numberOfBlocks; block++)
+    {
+      __m128i in[3] = { _mm_loadu_si128((const __m128i*)s), _mm_loadu_si128((const __m128i*)(s+16)), _mm_loadu_si128((const __m128i*)(s+32)) };
+      __m128i out[3];
+      Shuffle48(in, ShuffleTables.SwapFirstAndThirdComponent, out);
+      _mm_storeu_si128((__m128i*)d, out[0]);
+      _mm_storeu_si128((__m128i*)(d+16), out[1]);
+      _mm_storeu_si128((__m128i*)(d+32), out[2]);
+      s+=48;
+      d+=48;
+    }
+    Bgr24ToRgb24Scalar(outputOrdering, numberOfPixels-numberOfBlocks*16, s, d);
+  }
+
+  //----------------------------------------------------------------------------
+  // ICCIRY and ICCIRUV: ((value-offset)<<8)/divisor for 4 32-bit values
+  PIXELCODEC_SIMD_FUNCTION inline __m128i ScaleYuvComponent(__m128i value, int offset, float divisor)
+  {
+    __m128 shifted = _mm_cvtepi32_ps(_mm_slli_epi32(_mm_sub_epi32(value, _mm_set1_epi32(offset)), 8));
+    return _mm_cvttps_epi32(_mm_div_ps(shifted, _mm_set1_ps(divisor)));
+  }
+
+  //----------------------------------------------------------------------------
+  // Compute the R, G, B values (as 16-bit signed integers, not clipped yet) of 16 pixels from 32 bytes of YUY2 data
+  PIXELCODEC_SIMD_FUNCTION inline void Yuv422pToRgb16(const unsigned char* s, __m128i r16[2], __m128i g16[2], __m128i b16[2])
+  {
+    const __m128i round = _mm_set1_epi32(1<<(FIXNUM-1));
+    const __m128i coeffRV = _mm_set1_epi32(FIX(1.402, FIXNUM));
+    const __m128i coeffGU = _mm_set1_epi32(FIX(-0.344, FIXNUM));
+    const __m128i coeffGV = _mm_set1_epi32(FIX(-0.714, FIXNUM));
+    const __m128i coeffBU = _mm_set1_epi32(FIX(1.772, FIXNUM));
+    const __m128i lowByteMask = _mm_set1_epi16(0x00FF);
+
+    for (int half=0; half<2; half++)
+    {
+      __m128i in = _mm_loadu_si128((const __m128i*)(s+16*half));
+      // Y values of 8 pixels and U, V values of 4 pixel pairs (u0 v0 u1 v1 u2 v2 u3 v3) as 16-bit integers
+      __m128i y16 = _mm_and_si128(in, lowByteMask);
+      __m128i uv16 = _mm_srli_epi16(in, 8);
+      __m128i rgb32[3][2];
+      for (int quarter=0; quarter<2; quarter++)
+      {
+        // 4 pixels (2 pixel pairs)
+        __m128i y32 = _mm_cvtepu16_epi32(quarter==0 ? y16 : _mm_unpackhi_epi64(y16, y16));
+        __m128i uv32 = _mm_cvtepu16_epi32(quarter==0 ? uv16 : _mm_unpackhi_epi64(uv16, uv16));
+        __m128i Y = ScaleYuvComponent(y32, 16, 219.0f);
+        __m128i UV = ScaleYuvComponent(uv32, 128, 224.0f);
+        __m128i U = _mm_shuffle_epi32(UV, _MM_SHUFFLE(2,2,0,0));
+        __m128i V = _mm_shuffle_epi32(UV, _MM_SHUFFLE(3,3,1,1));
+        // UNFIX(FIX(1.0)*Y + c*X) = Y + UNFIX(c*X)
+        rgb32[0][quarter] = _mm_add_epi32(Y, _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(V, coeffRV), round), FIXNUM));
+        rgb32[1][quarter] = _mm_add_epi32(Y, _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(U, coeffGU), _mm_mullo_epi32(V, coeffGV)), round), FIXNUM));
+        rgb32[2][quarter] = _mm_add_epi32(Y, _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(U, coeffBU), round), FIXNUM));
+      }
+      r16[half] = _mm_packs_epi32(rgb32[0][0], rgb32[0][1]);
+      g16[half] = _mm_packs_epi32(rgb32[1][0], rgb32[1][1]);
+      b16[half] = _mm_packs_epi32(rgb32[2][0], rgb32[2][1]);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_SIMD_FUNCTION void Yuv422pToBmp24Simd(PixelCodec::ComponentOrdering outputOrdering, int numberOfPixelPairs, const unsigned char* s, unsigned char* d)
+  {
+    const ShuffleMasks48 &planesToOutput = (outputOrdering == PixelCodec::ComponentOrder_BGR ? ShuffleTables.PlanesToBgr : ShuffleTables.PlanesToRgb);
+    int numberOfBlocks = numberOfPixelPairs/8;
+    for (int block=0; block<numberOfBlocks; block++)
+    {
+      __m128i r16[2], g16[2], b16[2];
+      Yuv422pToRgb16(s, r16, g16, b16);
+      // packus clips the values to 0..255
+      __m128i planes[3] = { _mm_packus_epi16(r16[0], r16[1]), _mm_packus_epi16(g16[0], g16[1]), _mm_packus_epi16(b16[0], b16[1]) };
+      __m128i out[3];
+      Shuffle48(planes, planesToOutput, out);
+      _mm_storeu_si128((__m128i*)d, out[0]);
+      _mm_storeu_si128((__m128i*)(d+16), out[1]);
+      _mm_storeu_si128((__m128i*)(d+32), out[2]);
+      s+=32;
+      d+=48;
+    }
+    Yuv422pToBmp24Scalar(outputOrdering, numberOfPixelPairs-numberOfBlocks*8, s, d);
+  }
+
+  //----------------------------------------------------------------------------
+  PIXELCODEC_SIMD_FUNCTION void Yuv422pToGraySimd(PixelCodec::ComponentOrdering outputOrdering, int numberOfPixelPairs, const unsigned char* s, unsigned char* d)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maxValue = _mm_set1_epi16(255);
+    int numberOfBlocks = numberOfPixelPairs/8;
+    for (int block=0; block<numberOfBlocks; block++)
+    {
+      __m128i r16[2], g16[2], b16[2];
+      Yuv422pToRgb16(s, r16, g16, b16);
+      __m128i gray16[2];
+      for (int half=0; half<2; half++)
+      {
+        __m128i r = _mm_min_epi16(_mm_max_epi16(r16[half], zero), maxValue);
+        __m128i g = _mm_min_epi16(_mm_max_epi16(g16[half], zero), maxValue);
+        __m128i b = _mm_min_epi16(_mm_max_epi16(b16[half], zero), maxValue);
+        gray16[half] = AverageOfThree16(r, g, b);
+      }
+      _mm_storeu_si128((__m128i*)d, _mm_packus_epi16(gray16[0], gray16[1]));
+      s+=32;
+      d+=16;
+    }
+    Yuv422pToGrayScalar(outputOrdering, numberOfPixelPairs-numberOfBlocks*8, s, d);
+  }
+
+#endif // PIXELCODEC_SIMD_AVAILABLE
+
+  //----------------------------------------------------------------------------
+  bool UseSimd()
+  {
+#ifdef PIXELCODEC_SIMD_AVAILABLE
+    return ConversionModeSetting == PixelCodec::ConversionMode_Simd && SimdSupported;
+#else
+    return false;
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  // Conversion of an image. Rows are split between threads.
+  struct ConversionTask
+  {
+    ConversionKernel Kernel;
+    PixelCodec::ComponentOrdering OutputOrdering;
+    const unsigned char* Source;
+    unsigned char* Destination;
+    int NumberOfRows;
+    int UnitsPerRow;
+    int SourceBytesPerUnit;
+    int DestinationBytesPerUnit;
+  };
+
+  //----------------------------------------------------------------------------
+  void ConvertRows(const ConversionTask &task, int firstRow, int lastRow)
+  {
+    if (lastRow<firstRow)
+    {
+      return;
+    }
+    int firstUnit = firstRow*task.UnitsPerRow;
+    task.Kernel(task.OutputOrdering, (lastRow-firstRow+1)*task.UnitsPerRow,
+      task.Source+firstUnit*task.SourceBytesPerUnit, task.Destination+firstUnit*task.DestinationBytesPerUnit);
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE ConvertRowsThreadFunction(void *arg)
+  {
+    vtkMultiThreader::ThreadInfo *threadInfo = static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+    const ConversionTask *task = static_cast<const ConversionTask *>(threadInfo->UserData);
+    int firstRow = (task->NumberOfRows*threadInfo->ThreadID)/threadInfo->NumberOfThreads;
+    int lastRow = (task->NumberOfRows*(threadInfo->ThreadID+1))/threadInfo->NumberOfThreads - 1;
+    ConvertRows(*task, firstRow, lastRow);
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  void RunConversionTask(ConversionKernel scalarKernel, ConversionKernel simdKernel, PixelCodec::ComponentOrdering outputOrdering,
+    int unitsPerRow, int numberOfRows, int sourceBytesPerUnit, int destinationBytesPerUnit, const unsigned char* s, unsigned char* d)
+  {
+    ConversionTask task;
+    task.Kernel = (UseSimd() && simdKernel!=NULL) ? simdKernel : scalarKernel;
+    task.OutputOrdering = outputOrdering;
+    task.Source = s;
+    task.Destination = d;
+    task.NumberOfRows = numberOfRows;
+    task.UnitsPerRow = unitsPerRow;
+    task.SourceBytesPerUnit = sourceBytesPerUnit;
+    task.DestinationBytesPerUnit = destinationBytesPerUnit;
+
+    int numberOfThreads = (NumberOfThreadsSetting>0 ? NumberOfThreadsSetting : vtkMultiThreader::GetGlobalDefaultNumberOfThreads());
+    if (numberOfThreads>numberOfRows)
+    {
+      numberOfThreads = numberOfRows;
+    }
+    if (numberOfThreads<=1)
+    {
+      ConvertRows(task, 0, numberOfRows-1);
+      return;
+    }
+
+    vtkMultiThreader* threader = vtkMultiThreader::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(ConvertRowsThreadFunction, &task);
+    threader->SingleMethodExecute();
+    threader->Delete();
+  }
+}
+
+#ifdef PIXELCODEC_SIMD_AVAILABLE
+  #define PIXELCODEC_SIMD_KERNEL(kernel) kernel
+#else
+  #define PIXELCODEC_SIMD_KERNEL(kernel) NULL
+#endif
+
+//----------------------------------------------------------------------------
+void PixelCodec::SetConversionMode(ConversionMode mode)
+{
+  ConversionModeSetting = mode;
+}
+
+//----------------------------------------------------------------------------
+PixelCodec::ConversionMode PixelCodec::GetConversionMode()
+{
+  return ConversionModeSetting;
+}
+
+//----------------------------------------------------------------------------
+bool PixelCodec::IsSimdSupported()
+{
+#ifdef PIXELCODEC_SIMD_AVAILABLE
+  return SimdSupported;
+#else
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::SetNumberOfThreads(int numberOfThreads)
+{
+  NumberOfThreadsSetting = (numberOfThreads<0 ? 1 : numberOfThreads);
+}
+
+//----------------------------------------------------------------------------
+int PixelCodec::GetNumberOfThreads()
+{
+  return NumberOfThreadsSetting;
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::Rgb24ToGray(int width, int height, unsigned char *s,unsigned char *d)
+{
+  RunConversionTask(Rgb24ToGrayScalar, PIXELCODEC_SIMD_KERNEL(Rgb24ToGraySimd), ComponentOrder_RGB, width, height, 3, 1, s, d);
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::Bgr24ToRgb24(int width, int height, unsigned char *s,unsigned char *d)
+{
+  RunConversionTask(Bgr24ToRgb24Scalar, PIXELCODEC_SIMD_KERNEL(Bgr24ToRgb24Simd), ComponentOrder_RGB, width, height, 3, 3, s, d);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PixelCodec::Yuv422pToBmp24(ComponentOrdering outputOrdering, int width, int height, unsigned char *s,unsigned char *d)
+{
+  // Each unit is a pixel pair (4 bytes of YUY2 input, 6 bytes of output)
+  RunConversionTask(Yuv422pToBmp24Scalar, PIXELCODEC_SIMD_KERNEL(Yuv422pToBmp24Simd), outputOrdering, width/2, height, 4, 6, s, d);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PixelCodec::Yuv422pToGray(int width, int height, unsigned char *s,unsigned char *d)
+{
+  // Each unit is a pixel pair (4 bytes of YUY2 input, 2 bytes of output)
+  RunConversionTask(Yuv422pToGrayScalar, PIXELCODEC_SIMD_KERNEL(Yuv422pToGraySimd), ComponentOrder_RGB, width/2, height, 4, 2, s, d);
+}
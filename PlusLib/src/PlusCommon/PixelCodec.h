@@ -29,6 +29,14 @@ See License.txt for details.
 static const long VTK_BI_UYVY=0x59565955;
 static const long VTK_BI_YUY2=0x32595559;
 
+// Uncompressed and JPEG bitmap compression modes (defined in wingdi.h on Windows)
+#ifndef BI_RGB
+#define BI_RGB 0L
+#endif
+#ifndef BI_JPEG
+#define BI_JPEG 4L
+#endif
+
 /*!
 \class PixelCodec
 \brief A utility class that contains static functions for converting between various pixel encodings
@@ -51,6 +59,31 @@ public:
     PixelEncoding_MJPG
   };
 
+  /*!
+    Selects the implementation of the pixel conversion functions.
+    All implementations produce exactly the same output.
+  */
+  enum ConversionMode
+  {
+    ConversionMode_Simd, /*!< use SIMD instructions if the processor supports them, otherwise the scalar implementation (default) */
+    ConversionMode_Scalar /*!< always use the portable scalar implementation */
+  };
+
+  /*! Set the implementation that is used by the conversion functions. Should not be changed while a conversion is in progress. */
+  static void SetConversionMode(ConversionMode mode);
+  static ConversionMode GetConversionMode();
+
+  /*! Returns true if SIMD (SSE4.1) converters are compiled in and supported by the processor */
+  static bool IsSimdSupported();
+
+  /*!
+    Set the number of threads that are used for converting an image (the image rows are split between the threads).
+    The default is 1 (conversion is performed in the calling thread).
+    If 0 is set then the number of threads is vtkMultiThreader::GetGlobalDefaultNumberOfThreads().
+  */
+  static void SetNumberOfThreads(int numberOfThreads);
+  static int GetNumberOfThreads();
+
   //----------------------------------------------------------------------------
   static bool IsConvertToGraySupported(int inputCompression)
   {
@@ -190,16 +223,13 @@ public:
   Note that this method computes the intensity (simple averaging of the RGB components).
   This is not equivalent with the perceived luminance of color images (e.g., 0.21R + 0.72G + 0.07B or 0.30R + 0.59G + 0.11B)
   */
-  static inline void Rgb24ToGray(int width, int height, unsigned char *s,unsigned char *d)
-  {
-    int totalLen=width*height;
-    for (int i=0; i<totalLen; i++)
-    {
-      *d=((unsigned short)(s[0])+s[1]+s[2])/3;
-      d++;
-      s+=3;
-    }
-  } 
+  static void Rgb24ToGray(int width, int height, unsigned char *s,unsigned char *d);
+
+  //----------------------------------------------------------------------------
+  /*!
+  Swap the first and third component of each pixel of an RGB24 image (converts BGR24 to RGB24 and RGB24 to BGR24).
+  */
+  static void Bgr24ToRgb24(int width, int height, unsigned char *s,unsigned char *d);
 
   //----------------------------------------------------------------------------
   /*! Conversion from YUV to RGB space
@@ -254,56 +284,7 @@ public:
   YUY2 coding is typically used for webcams
   source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html
   */
-  static PlusStatus Yuv422pToBmp24(ComponentOrdering outputOrdering, int width, int height, unsigned char *s,unsigned char *d)
-  {
-    int i;
-    unsigned char *p_dest;
-    unsigned char y1, u, y2, v;
-    int Y1, Y2, U, V;
-    unsigned char r, g, b;
-
-    p_dest = d;
-
-    int size = height * (width / 2);
-    unsigned long srcIndex = 0;
-    unsigned long dstIndex = 0;
-
-    for(i = 0 ; i < size ; i++)
-    {
-      y1 = s[srcIndex];
-      u = s[srcIndex+ 1];
-      y2 = s[srcIndex+ 2];
-      v = s[srcIndex+ 3];
-
-      Y1 = ICCIRY(y1);
-      U = ICCIRUV(u - 128);
-      Y2 = ICCIRY(y2);
-      V = ICCIRUV(v - 128);
-
-      r = CLIP(GET_R_FROM_YUV(Y1, U, V));
-      g = CLIP(GET_G_FROM_YUV(Y1, U, V));
-      b = CLIP(GET_B_FROM_YUV(Y1, U, V));
-
-      p_dest[dstIndex] = (outputOrdering == ComponentOrder_BGR ? b : r);
-      p_dest[dstIndex + 1] = g;
-      p_dest[dstIndex + 2] = (outputOrdering == ComponentOrder_BGR ? r : b);
-
-      dstIndex += 3;
-
-      r = CLIP(GET_R_FROM_YUV(Y2, U, V));
-      g = CLIP(GET_G_FROM_YUV(Y2, U, V));
-      b = CLIP(GET_B_FROM_YUV(Y2, U, V));
-
-      p_dest[dstIndex] = (outputOrdering == ComponentOrder_BGR ? b : r);
-      p_dest[dstIndex + 1] = g;
-      p_dest[dstIndex + 2] = (outputOrdering == ComponentOrder_BGR ? r : b);
-
-      dstIndex += 3;
-      srcIndex += 4;
-    }
-
-    return PLUS_SUCCESS;
-  }
+  static PlusStatus Yuv422pToBmp24(ComponentOrdering outputOrdering, int width, int height, unsigned char *s,unsigned char *d);
 
   //----------------------------------------------------------------------------
   /*!
@@ -311,49 +292,7 @@ public:
   YUY2 coding is typically used for webcams
   source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html
   */
-  static void Yuv422pToGray(int width, int height, unsigned char *s,unsigned char *d)
-  {
-    int i;
-    unsigned char *p_dest;
-    unsigned char y1, u, y2, v;
-    int Y1, Y2, U, V;
-    unsigned char r, g, b;
-
-    p_dest = d;
-
-    int size = height * (width / 2);
-    unsigned long srcIndex = 0;
-    unsigned long dstIndex = 0;
-
-    for(i = 0 ; i < size ; i++)
-    {
-      y1 = s[srcIndex];
-      u = s[srcIndex+ 1];
-      y2 = s[srcIndex+ 2];
-      v = s[srcIndex+ 3];
-
-      Y1 = ICCIRY(y1);
-      U = ICCIRUV(u - 128);
-      Y2 = ICCIRY(y2);
-      V = ICCIRUV(v - 128);
-
-      r = CLIP(GET_R_FROM_YUV(Y1, U, V));
-      g = CLIP(GET_G_FROM_YUV(Y1, U, V));
-      b = CLIP(GET_B_FROM_YUV(Y1, U, V));
-
-      p_dest[dstIndex] = (int(b)+g+r)/3;
-      dstIndex ++;
-
-      r = CLIP(GET_R_FROM_YUV(Y2, U, V));
-      g = CLIP(GET_G_FROM_YUV(Y2, U, V));
-      b = CLIP(GET_B_FROM_YUV(Y2, U, V));
-
-      p_dest[dstIndex] = (int(b)+g+r)/3;
-
-      dstIndex ++;
-      srcIndex += 4;
-    }
-  }  
+  static void Yuv422pToGray(int width, int height, unsigned char *s,unsigned char *d);
 
 private:
   PixelCodec(); // prevent instantiation
@@ -4,6 +4,13 @@
 #include "vtkXMLDataElement.h"
 #include "PlusRevision.h"
 
+#ifdef _WIN32
+  #include <windows.h>
+  #include <psapi.h>
+#else
+  #include <sys/resource.h>
+#endif
+
 //-------------------------------------------------------
 PlusTransformName::PlusTransformName()
 {
@@ -451,6 +458,55 @@ std::string PlusCommon::GetPlusLibVersionString()
   return plusLibVersion;
 }
 
+//----------------------------------------------------------------------------
+double PlusCommon::GetProcessCpuTimeSec()
+{
+#ifdef _WIN32
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if ( !GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime) )
+  {
+    return 0;
+  }
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernelTime.dwLowDateTime;
+  kernel.HighPart = kernelTime.dwHighDateTime;
+  user.LowPart = userTime.dwLowDateTime;
+  user.HighPart = userTime.dwHighDateTime;
+  return (kernel.QuadPart + user.QuadPart)*1e-7; // 100 nanosecond units
+#else
+  struct rusage usage;
+  if ( getrusage(RUSAGE_SELF, &usage) != 0 )
+  {
+    return 0;
+  }
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)*1e-6;
+#endif
+}
+
+//----------------------------------------------------------------------------
+double PlusCommon::GetProcessPeakMemoryUsageMb()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS memoryCounters;
+  if ( !GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)) )
+  {
+    return 0;
+  }
+  return memoryCounters.PeakWorkingSetSize/1024.0/1024.0;
+#else
+  struct rusage usage;
+  if ( getrusage(RUSAGE_SELF, &usage) != 0 )
+  {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss/1024.0/1024.0; // bytes
+#else
+  return usage.ru_maxrss/1024.0; // kilobytes
+#endif
+#endif
+}
+
 //-------------------------------------------------------
 void PlusCommon::SplitStringIntoTokens(const std::string &s, char delim, std::vector<std::string> &elems)
 {
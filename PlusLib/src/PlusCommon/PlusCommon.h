@@ -238,6 +238,12 @@ namespace PlusCommon
 #endif
 
   VTK_EXPORT std::string GetPlusLibVersionString();
+
+  /*! Get the CPU time used by the process (all threads, user and kernel time) in seconds. Returns 0 if it cannot be determined. */
+  VTK_EXPORT double GetProcessCpuTimeSec();
+
+  /*! Get the peak resident memory size of the process in MB. Returns 0 if it cannot be determined. */
+  VTK_EXPORT double GetProcessPeakMemoryUsageMb();
 };
 
 /*!
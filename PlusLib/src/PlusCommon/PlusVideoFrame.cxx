@@ -13,6 +13,7 @@ See License.txt for details.
 #include "vtkObjectFactory.h"
 #include "vtkPNMReader.h"
 #include "vtkTIFFReader.h"
+#include <algorithm>
 
 #ifdef PLUS_USE_OpenIGTLink
 #include "igtlImageMessage.h"
@@ -84,6 +85,18 @@ namespace
           outputPixel += 2*width*numberOfScalarComponents;
         }
       }
+      else if (numberOfScalarComponents == 1)
+      {
+        // Single-component images (most common for ultrasound): reverse each row in one call
+        ScalarType* inputRow = (ScalarType*)inBuff;
+        ScalarType* outputRow = (ScalarType*)outBuff;
+        for (int y = height; y > 0; y--)
+        {
+          std::reverse_copy(inputRow, inputRow + width, outputRow);
+          inputRow += width;
+          outputRow += width;
+        }
+      }
       else
       {
         ScalarType* inputPixel = (ScalarType*)inBuff;
@@ -127,6 +140,12 @@ namespace
           outputPixel -= 2*numberOfScalarComponents;
         }
       }
+      else if (numberOfScalarComponents == 1)
+      {
+        // Single-component images: flipping both axes is reversing the whole pixel array
+        ScalarType* inputPixel = (ScalarType*)inBuff;
+        std::reverse_copy(inputPixel, inputPixel + width*height, (ScalarType*)outBuff);
+      }
       else
       {
         ScalarType* inputPixel = (ScalarType*)inBuff;
@@ -200,10 +219,23 @@ PlusVideoFrame& PlusVideoFrame::operator=(PlusVideoFrame const&videoItem)
       memcpy(this->GetScalarPointer(), videoItem.GetScalarPointer(), this->GetFrameSizeInBytes() ); 
     }
   }
+  else
+  {
+    // The source frame has no pixel data, don't keep the previous image content
+    DELETE_IF_NOT_NULL(this->Image);
+  }
 
   return *this;
 }
 
+//----------------------------------------------------------------------------
+void PlusVideoFrame::Swap(PlusVideoFrame& videoItem)
+{
+  std::swap(this->Image, videoItem.Image);
+  std::swap(this->ImageType, videoItem.ImageType);
+  std::swap(this->ImageOrientation, videoItem.ImageOrientation);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus PlusVideoFrame::DeepCopy(PlusVideoFrame* videoItem)
 {
@@ -236,18 +268,23 @@ PlusStatus PlusVideoFrame::FillBlank()
 //----------------------------------------------------------------------------
 PlusStatus PlusVideoFrame::AllocateFrame(vtkImageData* image, const int imageSize[2], PlusCommon::VTKScalarPixelType pixType, int numberOfScalarComponents)
 {  
-  if ( image != NULL )
-  {
-    int imageExtents[6] = {0,0,0,0,0,0};
-    image->GetExtent(imageExtents);
-    if (imageSize[0] == imageExtents[1]-1 &&
-      imageSize[1] == imageExtents[3]-1 &&
-      image->GetScalarType() == pixType &&
-      image->GetNumberOfScalarComponents() == numberOfScalarComponents)
-    {
-      // already allocated, no change
-      return PLUS_SUCCESS;
-    }        
+  if ( image == NULL )
+  {
+    LOG_ERROR("PlusVideoFrame::AllocateFrame failed: image is NULL");
+    return PLUS_FAIL;
+  }
+
+  int imageExtents[6] = {0,0,0,0,0,0};
+  image->GetExtent(imageExtents);
+  if (imageSize[0] == imageExtents[1]-imageExtents[0]+1 &&
+    imageSize[1] == imageExtents[3]-imageExtents[2]+1 &&
+    imageExtents[0] == 0 && imageExtents[2] == 0 &&
+    image->GetScalarType() == pixType &&
+    image->GetNumberOfScalarComponents() == numberOfScalarComponents &&
+    image->GetScalarPointer() != NULL)
+  {
+    // already allocated, no change
+    return PLUS_SUCCESS;
   }
 
   image->SetExtent(0, imageSize[0]-1, 0, imageSize[1]-1, 0, 0);
@@ -725,29 +762,41 @@ PlusStatus PlusVideoFrame::GetOrientedImage(  unsigned char* imageDataPtr,
     PlusVideoFrame::AllocateFrame(outUsOrientedImage, frameSizeInPx, pixType, numberOfScalarComponents);
   }
 
-  vtkImageData* inUsImage = vtkImageData::New();
-  PlusVideoFrame::AllocateFrame(inUsImage, frameSizeInPx, outUsOrientedImage->GetScalarType(), outUsOrientedImage->GetNumberOfScalarComponents());
-  
-  memcpy(inUsImage->GetScalarPointer(), imageDataPtr, frameSizeInPx[0]*frameSizeInPx[1]*PlusVideoFrame::GetNumberOfBytesPerScalar(pixType)*numberOfScalarComponents);
-
   FlipInfoType flipInfo;
   if (GetFlipAxes(inUsImageOrientation, inUsImageType, outUsImageOrientation, flipInfo) != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to convert image data to the requested orientation, from " << GetStringFromUsImageOrientation(inUsImageOrientation) << " to " << GetStringFromUsImageOrientation(outUsImageOrientation));
-    DELETE_IF_NOT_NULL(inUsImage);
     return PLUS_FAIL;
   }
+
+  // The input is copied (and flipped, if needed) directly into the output image, in a single pass
+  // without any intermediate image buffer.
   if ( !flipInfo.hFlip && !flipInfo.vFlip )
   {
     // no flip
-    outUsOrientedImage->DeepCopy(inUsImage);
-    DELETE_IF_NOT_NULL(inUsImage);
+    memcpy(outUsOrientedImage->GetScalarPointer(), imageDataPtr, frameSizeInPx[0]*frameSizeInPx[1]*PlusVideoFrame::GetNumberOfBytesPerScalar(pixType)*numberOfScalarComponents);
+    outUsOrientedImage->Modified();
     return PLUS_SUCCESS; 
   }
 
-  PlusStatus result = PlusVideoFrame::GetOrientedImage(inUsImage, inUsImageOrientation, inUsImageType, outUsImageOrientation, outUsOrientedImage); 
-  DELETE_IF_NOT_NULL(inUsImage);
-  return result;
+  int numberOfBytesPerScalar = PlusVideoFrame::GetNumberOfBytesPerScalar(pixType);
+  PlusStatus status=PLUS_FAIL;
+  switch (numberOfBytesPerScalar)
+  {
+  case 1:
+    status=FlipImageGeneric<vtkTypeUInt8>(imageDataPtr, numberOfScalarComponents, frameSizeInPx[0], frameSizeInPx[1], flipInfo, outUsOrientedImage->GetScalarPointer());
+    break;
+  case 2:
+    status=FlipImageGeneric<vtkTypeUInt16>(imageDataPtr, numberOfScalarComponents, frameSizeInPx[0], frameSizeInPx[1], flipInfo, outUsOrientedImage->GetScalarPointer());
+    break;
+  case 4:
+    status=FlipImageGeneric<vtkTypeUInt32>(imageDataPtr, numberOfScalarComponents, frameSizeInPx[0], frameSizeInPx[1], flipInfo, outUsOrientedImage->GetScalarPointer());
+    break;
+  default:
+    LOG_ERROR("Unsupported bit depth: "<<numberOfBytesPerScalar<<" bytes per scalar");
+  }
+  outUsOrientedImage->Modified();
+  return status;
 }
 
 //----------------------------------------------------------------------------
@@ -87,6 +87,12 @@ public:
   /*! Equality operator */
   PlusVideoFrame& operator=(PlusVideoFrame const&videoItem); 
 
+  /*!
+    Exchange the content of two video frames. Only the image object pointers are exchanged,
+    no pixel data is copied or allocated.
+  */
+  void Swap(PlusVideoFrame& videoItem);
+
   /*! Allocate memory for the image. The image object must be already created. */
   static PlusStatus AllocateFrame(vtkImageData* image, const int imageSize[2], PlusCommon::VTKScalarPixelType vtkScalarPixelType, int numberOfScalarComponents); 
   /*! Allocate memory for the image. */
@@ -179,7 +185,11 @@ public:
   /*! Convert oriented image to MF oriented ultrasound image */
   static PlusStatus GetOrientedImage( vtkImageData* inUsImage, US_IMAGE_ORIENTATION inUsImageOrientation, US_IMAGE_TYPE inUsImageType, US_IMAGE_ORIENTATION outUsImageOrientation, vtkImageData* outUsOrientedImage ); 
 
-  /*! Convert oriented image to MF oriented ultrasound image */
+  /*!
+    Convert oriented image to MF oriented ultrasound image.
+    The pixels are copied (and flipped, if needed) directly from imageDataPtr to the output image in a single pass.
+    The output image is only reallocated if its size or pixel type does not match the input.
+  */
   static PlusStatus GetOrientedImage( unsigned char* imageDataPtr, US_IMAGE_ORIENTATION  inUsImageOrientation, US_IMAGE_TYPE inUsImageType, PlusCommon::VTKScalarPixelType inUsImagePixelType, int numberOfScalarComponents, const int frameSizeInPx[2], US_IMAGE_ORIENTATION outUsImageOrientation, vtkImageData* outUsOrientedImage); 
 
   /*! Convert oriented image to MF oriented ultrasound image */
@@ -20,6 +20,7 @@ See License.txt for details.
 #include "vtkMatrix4x4.h"
 #include "vtkXMLUtilities.h"
 #include "vtkXMLDataElement.h"
+#include <vector>
 
 enum OperationType
 {
@@ -43,10 +44,10 @@ public:
   FrameFieldUpdate()
   {
     TrackedFrameList = NULL; 
-    FrameScalarStart = 0; 
+    FrameScalar = 0; 
     FrameScalarIncrement = 0; 
     FrameScalarDecimalDigits = 5; 
-    FrameTransformStart = NULL; 
+    FrameTransform = NULL; 
     FrameTransformIncrement = NULL; 
   }
 
@@ -54,20 +55,84 @@ public:
   std::string UpdatedFieldName; 
   std::string UpdatedFieldValue; 
   vtkTrackedFrameList* TrackedFrameList; 
-  double FrameScalarStart; 
+  // Scalar value of the next updated frame. It is incremented after each frame, so the update can be continued with the next batch of frames.
+  double FrameScalar; 
   double FrameScalarIncrement; 
   int FrameScalarDecimalDigits; 
-  vtkMatrix4x4* FrameTransformStart; 
+  // Transform of the next updated frame. It is concatenated with the increment after each frame.
+  vtkTransform* FrameTransform; 
   vtkMatrix4x4* FrameTransformIncrement; 
 }; 
 
+// Parameters of the operation that is performed on each frame
+class FrameOperation
+{
+public:
+  FrameOperation()
+  {
+    Operation = NO_OPERATION; 
+    FillGrayLevel = 0; 
+    UpdateReferenceTransform = false; 
+  }
+
+  OperationType Operation; 
+  FrameFieldUpdate FieldUpdate; // UPDATE_FRAME_FIELD_NAME, UPDATE_FRAME_FIELD_VALUE
+  std::string FieldName; // DELETE_FRAME_FIELD
+  std::string TransformNameToAdd; // ADD_TRANSFORM
+  std::string DeviceSetConfigurationFileName; // ADD_TRANSFORM
+  std::vector<int> RectOriginPix; // FILL_IMAGE_RECTANGLE, CROP
+  std::vector<int> RectSizePix; // FILL_IMAGE_RECTANGLE, CROP
+  int FillGrayLevel; // FILL_IMAGE_RECTANGLE
+  bool UpdateReferenceTransform; // change all ToolToReference transforms to ToolToTracker transforms
+  PlusTransformName ReferenceTransformName; 
+}; 
+
+// Reads the frames of the input sequence metafiles one by one. Only the header (frame fields) of the files
+// is kept in memory, the pixel data is read frame by frame.
+class InputFrameReader
+{
+public:
+  InputFrameReader()
+  {
+    NumberOfFrames = 0; 
+    IncrementTimestamps = false; 
+    CurrentFileIndex = 0; 
+  }
+
+  // Read the header of the input files
+  PlusStatus Open( const std::vector<std::string> &inputFileNames, bool incrementTimestamps ); 
+
+  // Read a frame, the frame index is counted from the first frame of the first file. Frames shall be read in increasing order.
+  PlusStatus ReadFrame( unsigned int frameIndex, TrackedFrame &trackedFrame ); 
+
+  unsigned int GetNumberOfFrames() { return NumberOfFrames; }
+
+protected:
+  struct InputFile
+  {
+    vtkSmartPointer<vtkMetaImageSequenceIO> Reader; 
+    unsigned int FirstFrameIndex; 
+    double TimestampOffset; 
+  }; 
+
+  std::vector<InputFile> InputFiles; 
+  unsigned int NumberOfFrames; 
+  bool IncrementTimestamps; 
+  unsigned int CurrentFileIndex; 
+}; 
+
 PlusStatus TrimSequenceMetafile( vtkTrackedFrameList* trackedFrameList, unsigned int firstFrameIndex, unsigned int lastFrameIndex ); 
+PlusStatus CheckTrimRange( unsigned int firstFrameIndex, unsigned int lastFrameIndex, unsigned int numberOfFrames ); 
+PlusStatus PerformFrameOperation( vtkTrackedFrameList* trackedFrameList, FrameOperation &frameOperation ); 
+PlusStatus EditFramesInBatches( InputFrameReader &inputFrameReader, unsigned int firstFrameIndex, unsigned int numberOfFrames, unsigned int batchSize, 
+  vtkTrackedFrameList* trackedFrameList, FrameOperation &frameOperation, vtkMetaImageSequenceIO* writer ); 
 PlusStatus UpdateFrameFieldValue( FrameFieldUpdate& fieldUpdate ); 
 PlusStatus DeleteFrameField( vtkTrackedFrameList* trackedFrameList, std::string fieldName ); 
 PlusStatus ConvertStringToMatrix( std::string &strMatrix, vtkMatrix4x4* matrix); 
 PlusStatus AddTransform( vtkTrackedFrameList* trackedFrameList, std::string transformNameToAdd, std::string deviceSetConfigurationFileName );
 PlusStatus FillRectangle( vtkTrackedFrameList* trackedFrameList, const std::vector<int> &fillRectOrigin, const std::vector<int> &fillRectSize, int fillGrayLevel);
 PlusStatus CropRectangle( vtkTrackedFrameList* trackedFrameList, const std::vector<int> &cropRectOrigin, const std::vector<int> &cropRectSize);
+PlusStatus UpdateReferenceTransform( vtkTrackedFrameList* trackedFrameList, const PlusTransformName &referenceTransformName ); 
 
 const char* FIELD_VALUE_FRAME_SCALAR="{frame-scalar}"; 
 const char* FIELD_VALUE_FRAME_TRANSFORM="{frame-transform}"; 
@@ -86,6 +151,8 @@ int main(int argc, char **argv)
   OperationType operation; 
   bool useCompression = false; 
   bool incrementTimestamps = false; 
+  bool readAllFrames = false; // Read all the input frames into memory before editing
+  int batchSize = 50; // Maximum number of frames kept in memory when the frames are edited in batches
 
   int firstFrameIndex = -1; // First frame index used for trimming the sequence metafile.
   int lastFrameIndex = -1; // Last frame index used for trimming the sequence metafile.
@@ -143,6 +210,8 @@ int main(int argc, char **argv)
  
   args.AddArgument("--use-compression", vtksys::CommandLineArguments::NO_ARGUMENT, &useCompression, "Compress sequence metafile images.");  
   args.AddArgument("--increment-timestamps", vtksys::CommandLineArguments::NO_ARGUMENT, &incrementTimestamps, "Increment timestamps in the order of the input-file-names");  
+  args.AddArgument("--read-all-frames", vtksys::CommandLineArguments::NO_ARGUMENT, &readAllFrames, "Read all the frames of the input files into memory before editing. By default the frames are read, edited and written in batches, so the memory usage does not depend on the length of the sequence.");  
+  args.AddArgument("--batch-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &batchSize, "Maximum number of frames kept in memory when the frames are edited in batches (Default: 50)");  
 
   args.AddArgument("--add-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &transformNameToAdd, "Name of the transform to add to each frame (eg. 'StylusTipToTracker')");  
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &deviceSetConfigurationFileName, "Used device set configuration file path and name");  
@@ -199,6 +268,12 @@ int main(int argc, char **argv)
     return EXIT_FAILURE; 
   }
 
+  if ( batchSize < 1 )
+  {
+    LOG_ERROR("Batch size shall be at least 1!"); 
+    return EXIT_FAILURE; 
+  }
+
   // Set operation
   if ( strOperation.empty() )
   {
@@ -269,111 +344,49 @@ int main(int argc, char **argv)
   }
 
   ///////////////////////////////////////////////////////////////////
-  // Read input files 
+  // Prepare the operation 
 
+  // Output frames (all the frames or the current batch of frames)
   vtkSmartPointer<vtkTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkTrackedFrameList>::New(); 
 
-  if ( !inputFileName.empty() )
-  {
-    // Insert file name to the beginning of the list 
-    inputFileNames.insert(inputFileNames.begin(), inputFileName); 
-  }
-
-  double lastTimestamp = 0; 
-  for ( unsigned int i = 0; i < inputFileNames.size(); i++ )
-  {
-    vtkSmartPointer<vtkMetaImageSequenceIO> reader = vtkSmartPointer<vtkMetaImageSequenceIO>::New();        
-    reader->SetFileName(inputFileNames[i].c_str());
-
-    LOG_INFO("Read input sequence metafile: " << inputFileNames[i] ); 
-
-    if (reader->Read()!=PLUS_SUCCESS)
-    {    
-      LOG_ERROR("Couldn't read sequence metafile: " <<  inputFileName ); 
-      return EXIT_FAILURE;
-    }  
-
-    if ( incrementTimestamps )
-    {
-      vtkTrackedFrameList * tfList = reader->GetTrackedFrameList(); 
-      for ( unsigned int f = 0; f < tfList->GetNumberOfTrackedFrames(); ++f )
-      {
-        TrackedFrame * tf = tfList->GetTrackedFrame(f); 
-        tf->SetTimestamp( lastTimestamp + tf->GetTimestamp() ); 
-      }
-
-      lastTimestamp = tfList->GetTrackedFrame(tfList->GetNumberOfTrackedFrames() - 1 )->GetTimestamp();
-    }
-
-    if ( trackedFrameList->AddTrackedFrameList(reader->GetTrackedFrameList()) != PLUS_SUCCESS )
-    {
-      LOG_ERROR("Failed to append tracked frame list!");
-      return EXIT_SUCCESS; 
-    }
-  }
-
-
-  ///////////////////////////////////////////////////////////////////
-  // Make the operation 
+  FrameOperation frameOperation; 
+  frameOperation.Operation = operation; 
+  vtkSmartPointer<vtkTransform> frameTransform = vtkSmartPointer<vtkTransform>::New(); 
 
   switch ( operation )
   {
   case NO_OPERATION:
   case MERGE: 
-    {
-      // No need to do anything just save into output file 
-    }
-    break; 
   case TRIM: 
     {
-      if ( TrimSequenceMetafile( trackedFrameList, firstFrameIndex, lastFrameIndex ) != PLUS_SUCCESS )
-      {
-        LOG_ERROR("Failed to trim sequence metafile!"); 
-        return EXIT_FAILURE; 
-      }
+      // No need to modify the frames, frames are selected when the input files are read
     }
     break; 
   case UPDATE_FRAME_FIELD_NAME:
     {
-      FrameFieldUpdate fieldUpdate; 
-      fieldUpdate.TrackedFrameList = trackedFrameList; 
-      fieldUpdate.FieldName = fieldName; 
-      fieldUpdate.UpdatedFieldName = updatedFieldName; 
-     
-      if ( UpdateFrameFieldValue( fieldUpdate ) != PLUS_SUCCESS )
-      {
-        LOG_ERROR("Failed to update frame field name '"<<fieldName<<"' to '"<<updatedFieldName<<"'"); 
-        return EXIT_FAILURE; 
-      }
+      LOG_INFO("Update frame field" ); 
+      frameOperation.FieldUpdate.FieldName = fieldName; 
+      frameOperation.FieldUpdate.UpdatedFieldName = updatedFieldName; 
     }
     break; 
   case UPDATE_FRAME_FIELD_VALUE:
     {
-      FrameFieldUpdate fieldUpdate; 
-      fieldUpdate.TrackedFrameList = trackedFrameList; 
-      fieldUpdate.FieldName = fieldName; 
-      fieldUpdate.UpdatedFieldName = updatedFieldName; 
-      fieldUpdate.UpdatedFieldValue = updatedFieldValue; 
-      fieldUpdate.FrameScalarDecimalDigits = frameScalarDecimalDigits; 
-      fieldUpdate.FrameScalarIncrement = frameScalarIncrement; 
-      fieldUpdate.FrameScalarStart = frameScalarStart; 
-      fieldUpdate.FrameTransformStart = frameTransformStart; 
-      fieldUpdate.FrameTransformIncrement = frameTransformIncrement; 
-
-      if ( UpdateFrameFieldValue( fieldUpdate ) != PLUS_SUCCESS )
-      {
-        LOG_ERROR("Failed to update frame field value!"); 
-        return EXIT_FAILURE; 
-      }
+      LOG_INFO("Update frame field" ); 
+      frameTransform->SetMatrix(frameTransformStart); 
+      frameOperation.FieldUpdate.FieldName = fieldName; 
+      frameOperation.FieldUpdate.UpdatedFieldName = updatedFieldName; 
+      frameOperation.FieldUpdate.UpdatedFieldValue = updatedFieldValue; 
+      frameOperation.FieldUpdate.FrameScalarDecimalDigits = frameScalarDecimalDigits; 
+      frameOperation.FieldUpdate.FrameScalarIncrement = frameScalarIncrement; 
+      frameOperation.FieldUpdate.FrameScalar = frameScalarStart; 
+      frameOperation.FieldUpdate.FrameTransform = frameTransform; 
+      frameOperation.FieldUpdate.FrameTransformIncrement = frameTransformIncrement; 
     }
     break; 
   case DELETE_FRAME_FIELD: 
     {
-      if ( DeleteFrameField( trackedFrameList, fieldName ) != PLUS_SUCCESS )
-      {
-        LOG_ERROR("Failed to delete frame field!"); 
-        return EXIT_FAILURE; 
-      }
+      LOG_INFO("Delete frame field: " << fieldName ); 
+      frameOperation.FieldName = fieldName; 
     }
     break; 
   case DELETE_FIELD: 
@@ -425,31 +438,16 @@ int main(int argc, char **argv)
     {
       // Add transform
       LOG_INFO("Add transform '" << transformNameToAdd << "' using device set configuration file '" << deviceSetConfigurationFileName << "'"); 
-      if ( AddTransform(trackedFrameList, transformNameToAdd, deviceSetConfigurationFileName ) != PLUS_SUCCESS )
-      {
-        LOG_ERROR("Failed to add transform '" << transformNameToAdd << "' using device set configuration file '" << deviceSetConfigurationFileName << "'"); 
-        return EXIT_FAILURE; 
-      }
+      frameOperation.TransformNameToAdd = transformNameToAdd; 
+      frameOperation.DeviceSetConfigurationFileName = deviceSetConfigurationFileName; 
     }
     break; 
   case FILL_IMAGE_RECTANGLE: 
-    {
-      // Fill a rectangular region in the image with a solid color
-      if (FillRectangle(trackedFrameList,rectOriginPix,rectSizePix,fillGrayLevel)!=PLUS_SUCCESS)
-      {
-        LOG_ERROR("Failed to fill rectangle");
-        return EXIT_FAILURE;
-      }
-    }
-    break;     
   case CROP: 
     {
-      // Crop a rectangular region from the image
-      if (CropRectangle(trackedFrameList,rectOriginPix,rectSizePix)!=PLUS_SUCCESS)
-      {
-        LOG_ERROR("Failed to fill rectangle");
-        return EXIT_FAILURE;
-      }
+      frameOperation.RectOriginPix = rectOriginPix; 
+      frameOperation.RectSizePix = rectSizePix; 
+      frameOperation.FillGrayLevel = fillGrayLevel; 
     }
     break;     
 
@@ -460,111 +458,117 @@ int main(int argc, char **argv)
     }
   }
 
-
-  //////////////////////////////////////////////////////////////////
   // Convert metafiles to the new metafile format 
-
   if ( !strUpdatedReferenceTransformName.empty() )
   {
-    PlusTransformName referenceTransformName; 
-    if ( referenceTransformName.SetTransformName(strUpdatedReferenceTransformName.c_str()) != PLUS_SUCCESS )
+    if ( frameOperation.ReferenceTransformName.SetTransformName(strUpdatedReferenceTransformName.c_str()) != PLUS_SUCCESS )
     {
       LOG_ERROR("Reference transform name is invalid: " << strUpdatedReferenceTransformName );
       return EXIT_FAILURE; 
     }
+    frameOperation.UpdateReferenceTransform = true; 
+  }
+
+  if ( !inputFileName.empty() )
+  {
+    // Insert file name to the beginning of the list 
+    inputFileNames.insert(inputFileNames.begin(), inputFileName); 
+  }
+
+  vtkSmartPointer<vtkMetaImageSequenceIO> writer=vtkSmartPointer<vtkMetaImageSequenceIO>::New();      
+  writer->SetFileName(outputFileName.c_str());
+  writer->SetUseCompression(useCompression);
+
+  if ( !readAllFrames )
+  {
+    ///////////////////////////////////////////////////////////////////
+    // Read, edit and write the frames in batches
 
-    for ( unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i )
+    InputFrameReader inputFrameReader; 
+    if ( inputFrameReader.Open(inputFileNames, incrementTimestamps) != PLUS_SUCCESS )
     {
-      TrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(i); 
+      return EXIT_FAILURE;
+    }
 
-      vtkSmartPointer<vtkMatrix4x4> referenceToTrackerMatrix = vtkSmartPointer<vtkMatrix4x4>::New(); 
-      if ( trackedFrame->GetCustomFrameTransform(referenceTransformName, referenceToTrackerMatrix) != PLUS_SUCCESS )
+    unsigned int firstOutputFrameIndex = 0; 
+    unsigned int numberOfOutputFrames = inputFrameReader.GetNumberOfFrames(); 
+    if ( operation == TRIM )
+    {
+      if ( CheckTrimRange( firstFrameIndex, lastFrameIndex, inputFrameReader.GetNumberOfFrames() ) != PLUS_SUCCESS )
       {
-        LOG_WARNING("Couldn't get reference transform with name: " << strUpdatedReferenceTransformName ); 
-        continue; 
+        LOG_ERROR("Failed to trim sequence metafile!"); 
+        return EXIT_FAILURE; 
       }
+      firstOutputFrameIndex = firstFrameIndex; 
+      numberOfOutputFrames = lastFrameIndex - firstFrameIndex + 1; 
+    }
 
-      std::vector<PlusTransformName> transformNameList; 
-      trackedFrame->GetCustomFrameTransformNameList(transformNameList); 
+    LOG_INFO("Save output sequence metafile to: " << outputFileName ); 
+    if ( EditFramesInBatches(inputFrameReader, firstOutputFrameIndex, numberOfOutputFrames, batchSize, trackedFrameList, frameOperation, writer) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Couldn't write sequence metafile: " <<  outputFileName ); 
+      return EXIT_FAILURE;
+    }
 
-      vtkSmartPointer<vtkTransform> toolToTrackerTransform = vtkSmartPointer<vtkTransform>::New(); 
-      vtkSmartPointer<vtkMatrix4x4> toolToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New(); 
-      for ( unsigned int n = 0; n < transformNameList.size(); ++n )
-      {
-        // No need to change the reference transform
-        if ( transformNameList[n] == referenceTransformName )
-        {
-          continue; 
-        }
+    LOG_INFO("Sequence metafile editing was successful!"); 
+    return EXIT_SUCCESS; 
+  }
 
-        TrackedFrameFieldStatus status = FIELD_INVALID; 
-        if ( trackedFrame->GetCustomFrameTransform(transformNameList[n], toolToReferenceMatrix) != PLUS_SUCCESS )
-        {
-          std::string strTransformName; 
-          transformNameList[i].GetTransformName(strTransformName); 
-          LOG_ERROR("Failed to get custom frame transform: " << strTransformName); 
-          continue; 
-        }
+  ///////////////////////////////////////////////////////////////////
+  // Read input files 
 
-        if (trackedFrame->GetCustomFrameTransformStatus(transformNameList[n], status) != PLUS_SUCCESS )
-        {
-          std::string strTransformName; 
-          transformNameList[i].GetTransformName(strTransformName); 
-          LOG_ERROR("Failed to get custom frame transform status: " << strTransformName); 
-          continue; 
-        }
+  double lastTimestamp = 0; 
+  for ( unsigned int i = 0; i < inputFileNames.size(); i++ )
+  {
+    vtkSmartPointer<vtkMetaImageSequenceIO> reader = vtkSmartPointer<vtkMetaImageSequenceIO>::New();        
+    reader->SetFileName(inputFileNames[i].c_str());
 
-        // Compute ToolToTracker transform from ToolToReference  
-        toolToTrackerTransform->Identity(); 
-        toolToTrackerTransform->Concatenate(referenceToTrackerMatrix); 
-        toolToTrackerTransform->Concatenate(toolToReferenceMatrix); 
+    LOG_INFO("Read input sequence metafile: " << inputFileNames[i] ); 
 
-        // Update the name to ToolToTracker
-        PlusTransformName toolToTracker(transformNameList[n].From().c_str(), "Tracker"); 
-        // Set the new custom transoform
-        if ( trackedFrame->SetCustomFrameTransform(toolToTracker, toolToTrackerTransform->GetMatrix()) != PLUS_SUCCESS )
-        {
-          std::string strTransformName; 
-          transformNameList[i].GetTransformName(strTransformName); 
-          LOG_ERROR("Failed to set custom frame transform: " << strTransformName); 
-          continue; 
-        }
-        
-        // Use the same status as it was before 
-        if ( trackedFrame->SetCustomFrameTransformStatus(toolToTracker, status) != PLUS_SUCCESS )
-        {
-          std::string strTransformName; 
-          transformNameList[i].GetTransformName(strTransformName); 
-          LOG_ERROR("Failed to set custom frame transform status: " << strTransformName); 
-          continue; 
-        }
-        
-        // Delete old transform and status fields 
-        std::string oldTransformName, oldTransformStatus; 
-        transformNameList[n].GetTransformName(oldTransformName); 
-        // Append Transform to the end of the transform name
-        vtksys::RegularExpression isTransform("Transform$"); 
-        if ( !isTransform.find(oldTransformName) )
-        {
-          oldTransformName.append("Transform"); 
-        }
-        oldTransformStatus = oldTransformName; 
-        oldTransformStatus.append("Status"); 
-        trackedFrame->DeleteCustomFrameField(oldTransformName.c_str());
-        trackedFrame->DeleteCustomFrameField(oldTransformStatus.c_str());
+    if (reader->Read()!=PLUS_SUCCESS)
+    {    
+      LOG_ERROR("Couldn't read sequence metafile: " <<  inputFileName ); 
+      return EXIT_FAILURE;
+    }  
 
+    if ( incrementTimestamps )
+    {
+      vtkTrackedFrameList * tfList = reader->GetTrackedFrameList(); 
+      for ( unsigned int f = 0; f < tfList->GetNumberOfTrackedFrames(); ++f )
+      {
+        TrackedFrame * tf = tfList->GetTrackedFrame(f); 
+        tf->SetTimestamp( lastTimestamp + tf->GetTimestamp() ); 
       }
+
+      lastTimestamp = tfList->GetTrackedFrame(tfList->GetNumberOfTrackedFrames() - 1 )->GetTimestamp();
+    }
+
+    if ( trackedFrameList->AddTrackedFrameList(reader->GetTrackedFrameList()) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to append tracked frame list!");
+      return EXIT_SUCCESS; 
     }
   }
 
+  ///////////////////////////////////////////////////////////////////
+  // Make the operation 
+
+  if ( operation == TRIM && TrimSequenceMetafile( trackedFrameList, firstFrameIndex, lastFrameIndex ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to trim sequence metafile!"); 
+    return EXIT_FAILURE; 
+  }
+
+  if ( PerformFrameOperation( trackedFrameList, frameOperation ) != PLUS_SUCCESS )
+  {
+    return EXIT_FAILURE; 
+  }
+
   ///////////////////////////////////////////////////////////////////
   // Save output file to metafile 
 
   LOG_INFO("Save output sequence metafile to: " << outputFileName ); 
-  vtkSmartPointer<vtkMetaImageSequenceIO> writer=vtkSmartPointer<vtkMetaImageSequenceIO>::New();      
-  writer->SetFileName(outputFileName.c_str());
   writer->SetTrackedFrameList(trackedFrameList); 
-  writer->SetUseCompression(useCompression);
 
   if (writer->Write() != PLUS_SUCCESS)
   {    
@@ -579,10 +583,8 @@ int main(int argc, char **argv)
 //-------------------------------------------------------
 PlusStatus TrimSequenceMetafile( vtkTrackedFrameList* aTrackedFrameList, unsigned int aFirstFrameIndex, unsigned int aLastFrameIndex )
 {
-  LOG_INFO("Trim sequence metafile from frame #: " << aFirstFrameIndex << " to frame #" << aLastFrameIndex ); 
-  if ( aFirstFrameIndex < 0 || aLastFrameIndex >= aTrackedFrameList->GetNumberOfTrackedFrames() || aFirstFrameIndex > aLastFrameIndex)
+  if ( CheckTrimRange( aFirstFrameIndex, aLastFrameIndex, aTrackedFrameList->GetNumberOfTrackedFrames() ) != PLUS_SUCCESS )
   {
-    LOG_ERROR("Invalid input range: (" << aFirstFrameIndex << ", " << aLastFrameIndex << ")" << " Permitted range within (0, " << aTrackedFrameList->GetNumberOfTrackedFrames() - 1 << ")");
     return PLUS_FAIL;
   }
 
@@ -599,6 +601,18 @@ PlusStatus TrimSequenceMetafile( vtkTrackedFrameList* aTrackedFrameList, unsigne
   return PLUS_SUCCESS; 
 }
 
+//-------------------------------------------------------
+PlusStatus CheckTrimRange( unsigned int aFirstFrameIndex, unsigned int aLastFrameIndex, unsigned int aNumberOfFrames )
+{
+  LOG_INFO("Trim sequence metafile from frame #: " << aFirstFrameIndex << " to frame #" << aLastFrameIndex ); 
+  if ( aFirstFrameIndex < 0 || aLastFrameIndex >= aNumberOfFrames || aFirstFrameIndex > aLastFrameIndex)
+  {
+    LOG_ERROR("Invalid input range: (" << aFirstFrameIndex << ", " << aLastFrameIndex << ")" << " Permitted range within (0, " << aNumberOfFrames - 1 << ")");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS; 
+}
+
 //-------------------------------------------------------
 PlusStatus DeleteFrameField( vtkTrackedFrameList* trackedFrameList, std::string fieldName )
 {
@@ -614,7 +628,6 @@ PlusStatus DeleteFrameField( vtkTrackedFrameList* trackedFrameList, std::string
     return PLUS_FAIL; 
   }
 
-  LOG_INFO("Delete frame field: " << fieldName ); 
   int numberOfErrors(0); 
   for ( unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i )
   {
@@ -638,19 +651,8 @@ PlusStatus DeleteFrameField( vtkTrackedFrameList* trackedFrameList, std::string
 //-------------------------------------------------------
 PlusStatus UpdateFrameFieldValue( FrameFieldUpdate& fieldUpdate )
 {
-  LOG_INFO("Update frame field" ); 
   int numberOfErrors(0);
 
-  // Set the start scalar value 
-  double scalarVariable = fieldUpdate.FrameScalarStart; 
-
-  // Set the start transform matrix 
-  vtkSmartPointer<vtkTransform> frameTransform = vtkSmartPointer<vtkTransform>::New(); 
-  if ( fieldUpdate.FrameTransformStart != NULL )
-  {
-    frameTransform->SetMatrix(fieldUpdate.FrameTransformStart); 
-  }
-
   for ( unsigned int i = 0; i < fieldUpdate.TrackedFrameList->GetNumberOfTrackedFrames(); ++i )
   {
     TrackedFrame* trackedFrame = fieldUpdate.TrackedFrameList->GetTrackedFrame(i); 
@@ -682,17 +684,22 @@ PlusStatus UpdateFrameFieldValue( FrameFieldUpdate& fieldUpdate )
       { // Update it as a scalar variable 
         
         std::ostringstream fieldValue; 
-        fieldValue << std::fixed << std::setprecision(fieldUpdate.FrameScalarDecimalDigits) << scalarVariable; 
+        fieldValue << std::fixed << std::setprecision(fieldUpdate.FrameScalarDecimalDigits) << fieldUpdate.FrameScalar; 
 
         trackedFrame->SetCustomFrameField(fieldName.c_str(), fieldValue.str().c_str() ); 
-        scalarVariable += fieldUpdate.FrameScalarIncrement; 
+        fieldUpdate.FrameScalar += fieldUpdate.FrameScalarIncrement; 
 
       }
       else if ( STRCASECMP(fieldUpdate.UpdatedFieldValue.c_str(), FIELD_VALUE_FRAME_TRANSFORM) == 0 )
       { // Update it as a transform variable 
 
+        if ( fieldUpdate.FrameTransform == NULL )
+        {
+          LOG_ERROR("Frame transform is not set!"); 
+          return PLUS_FAIL; 
+        }
         double transformMatrix[16]={0}; 
-        vtkMatrix4x4::DeepCopy(transformMatrix, frameTransform->GetMatrix()); 
+        vtkMatrix4x4::DeepCopy(transformMatrix, fieldUpdate.FrameTransform->GetMatrix()); 
         std::ostringstream strTransform; 
         strTransform  << std::fixed << std::setprecision(fieldUpdate.FrameScalarDecimalDigits) 
           << transformMatrix[0]  << " " << transformMatrix[1]  << " " << transformMatrix[2]  << " " << transformMatrix[3]  << " " 
@@ -702,7 +709,7 @@ PlusStatus UpdateFrameFieldValue( FrameFieldUpdate& fieldUpdate )
 
         trackedFrame->SetCustomFrameField(fieldName.c_str(), strTransform.str().c_str() ); 
         
-        frameTransform->Concatenate(fieldUpdate.FrameTransformIncrement); 
+        fieldUpdate.FrameTransform->Concatenate(fieldUpdate.FrameTransformIncrement); 
 
       }
       else // Update only as a string value 
@@ -945,3 +952,364 @@ PlusStatus CropRectangle(vtkTrackedFrameList* trackedFrameList, const std::vecto
 
   return PLUS_SUCCESS; 
 }
+
+//-------------------------------------------------------
+PlusStatus UpdateReferenceTransform( vtkTrackedFrameList* trackedFrameList, const PlusTransformName &referenceTransformName )
+{
+  std::string strReferenceTransformName; 
+  referenceTransformName.GetTransformName(strReferenceTransformName); 
+
+  for ( unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i )
+  {
+    TrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(i); 
+
+    vtkSmartPointer<vtkMatrix4x4> referenceToTrackerMatrix = vtkSmartPointer<vtkMatrix4x4>::New(); 
+    if ( trackedFrame->GetCustomFrameTransform(referenceTransformName, referenceToTrackerMatrix) != PLUS_SUCCESS )
+    {
+      LOG_WARNING("Couldn't get reference transform with name: " << strReferenceTransformName ); 
+      continue; 
+    }
+
+    std::vector<PlusTransformName> transformNameList; 
+    trackedFrame->GetCustomFrameTransformNameList(transformNameList); 
+
+    vtkSmartPointer<vtkTransform> toolToTrackerTransform = vtkSmartPointer<vtkTransform>::New(); 
+    vtkSmartPointer<vtkMatrix4x4> toolToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New(); 
+    for ( unsigned int n = 0; n < transformNameList.size(); ++n )
+    {
+      // No need to change the reference transform
+      if ( transformNameList[n] == referenceTransformName )
+      {
+        continue; 
+      }
+
+      TrackedFrameFieldStatus status = FIELD_INVALID; 
+      if ( trackedFrame->GetCustomFrameTransform(transformNameList[n], toolToReferenceMatrix) != PLUS_SUCCESS )
+      {
+        std::string strTransformName; 
+        transformNameList[i].GetTransformName(strTransformName); 
+        LOG_ERROR("Failed to get custom frame transform: " << strTransformName); 
+        continue; 
+      }
+
+      if (trackedFrame->GetCustomFrameTransformStatus(transformNameList[n], status) != PLUS_SUCCESS )
+      {
+        std::string strTransformName; 
+        transformNameList[i].GetTransformName(strTransformName); 
+        LOG_ERROR("Failed to get custom frame transform status: " << strTransformName); 
+        continue; 
+      }
+
+      // Compute ToolToTracker transform from ToolToReference  
+      toolToTrackerTransform->Identity(); 
+      toolToTrackerTransform->Concatenate(referenceToTrackerMatrix); 
+      toolToTrackerTransform->Concatenate(toolToReferenceMatrix); 
+
+      // Update the name to ToolToTracker
+      PlusTransformName toolToTracker(transformNameList[n].From().c_str(), "Tracker"); 
+      // Set the new custom transoform
+      if ( trackedFrame->SetCustomFrameTransform(toolToTracker, toolToTrackerTransform->GetMatrix()) != PLUS_SUCCESS )
+      {
+        std::string strTransformName; 
+        transformNameList[i].GetTransformName(strTransformName); 
+        LOG_ERROR("Failed to set custom frame transform: " << strTransformName); 
+        continue; 
+      }
+      
+      // Use the same status as it was before 
+      if ( trackedFrame->SetCustomFrameTransformStatus(toolToTracker, status) != PLUS_SUCCESS )
+      {
+        std::string strTransformName; 
+        transformNameList[i].GetTransformName(strTransformName); 
+        LOG_ERROR("Failed to set custom frame transform status: " << strTransformName); 
+        continue; 
+      }
+      
+      // Delete old transform and status fields 
+      std::string oldTransformName, oldTransformStatus; 
+      transformNameList[n].GetTransformName(oldTransformName); 
+      // Append Transform to the end of the transform name
+      vtksys::RegularExpression isTransform("Transform$"); 
+      if ( !isTransform.find(oldTransformName) )
+      {
+        oldTransformName.append("Transform"); 
+      }
+      oldTransformStatus = oldTransformName; 
+      oldTransformStatus.append("Status"); 
+      trackedFrame->DeleteCustomFrameField(oldTransformName.c_str());
+      trackedFrame->DeleteCustomFrameField(oldTransformStatus.c_str());
+
+    }
+  }
+
+  return PLUS_SUCCESS; 
+}
+
+//-------------------------------------------------------
+PlusStatus PerformFrameOperation( vtkTrackedFrameList* trackedFrameList, FrameOperation &frameOperation )
+{
+  switch ( frameOperation.Operation )
+  {
+  case UPDATE_FRAME_FIELD_NAME:
+    {
+      frameOperation.FieldUpdate.TrackedFrameList = trackedFrameList; 
+      if ( UpdateFrameFieldValue( frameOperation.FieldUpdate ) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to update frame field name '"<<frameOperation.FieldUpdate.FieldName<<"' to '"<<frameOperation.FieldUpdate.UpdatedFieldName<<"'"); 
+        return PLUS_FAIL; 
+      }
+    }
+    break; 
+  case UPDATE_FRAME_FIELD_VALUE:
+    {
+      frameOperation.FieldUpdate.TrackedFrameList = trackedFrameList; 
+      if ( UpdateFrameFieldValue( frameOperation.FieldUpdate ) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to update frame field value!"); 
+        return PLUS_FAIL; 
+      }
+    }
+    break; 
+  case DELETE_FRAME_FIELD: 
+    {
+      if ( DeleteFrameField( trackedFrameList, frameOperation.FieldName ) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to delete frame field!"); 
+        return PLUS_FAIL; 
+      }
+    }
+    break; 
+  case ADD_TRANSFORM: 
+    {
+      if ( AddTransform(trackedFrameList, frameOperation.TransformNameToAdd, frameOperation.DeviceSetConfigurationFileName ) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to add transform '" << frameOperation.TransformNameToAdd << "' using device set configuration file '" << frameOperation.DeviceSetConfigurationFileName << "'"); 
+        return PLUS_FAIL; 
+      }
+    }
+    break; 
+  case FILL_IMAGE_RECTANGLE: 
+    {
+      // Fill a rectangular region in the image with a solid color
+      if (FillRectangle(trackedFrameList,frameOperation.RectOriginPix,frameOperation.RectSizePix,frameOperation.FillGrayLevel)!=PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to fill rectangle");
+        return PLUS_FAIL;
+      }
+    }
+    break;     
+  case CROP: 
+    {
+      // Crop a rectangular region from the image
+      if (CropRectangle(trackedFrameList,frameOperation.RectOriginPix,frameOperation.RectSizePix)!=PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to fill rectangle");
+        return PLUS_FAIL;
+      }
+    }
+    break;     
+  default: 
+    {
+      // Other operations do not modify the frames
+    }
+  }
+
+  if ( frameOperation.UpdateReferenceTransform )
+  {
+    return UpdateReferenceTransform( trackedFrameList, frameOperation.ReferenceTransformName ); 
+  }
+
+  return PLUS_SUCCESS; 
+}
+
+//-------------------------------------------------------
+PlusStatus InputFrameReader::Open( const std::vector<std::string> &inputFileNames, bool incrementTimestamps )
+{
+  this->InputFiles.clear(); 
+  this->NumberOfFrames = 0; 
+  this->IncrementTimestamps = incrementTimestamps; 
+  this->CurrentFileIndex = 0; 
+
+  double lastTimestamp = 0; 
+  for ( unsigned int i = 0; i < inputFileNames.size(); i++ )
+  {
+    InputFile inputFile; 
+    inputFile.Reader = vtkSmartPointer<vtkMetaImageSequenceIO>::New();        
+    inputFile.Reader->SetFileName(inputFileNames[i].c_str());
+
+    LOG_INFO("Read input sequence metafile: " << inputFileNames[i] ); 
+
+    // Only the header is read now, the pixel data is read frame by frame
+    if (inputFile.Reader->ReadHeader()!=PLUS_SUCCESS)
+    {    
+      LOG_ERROR("Couldn't read sequence metafile: " <<  inputFileNames[i] ); 
+      return PLUS_FAIL;
+    }  
+
+    // The timestamps of this file are incremented by the (incremented) timestamp of the last frame of the previous file
+    vtkTrackedFrameList* tfList = inputFile.Reader->GetTrackedFrameList(); 
+    inputFile.FirstFrameIndex = this->NumberOfFrames; 
+    inputFile.TimestampOffset = lastTimestamp; 
+    if ( incrementTimestamps && tfList->GetNumberOfTrackedFrames() > 0 )
+    {
+      lastTimestamp = lastTimestamp + tfList->GetTrackedFrame(tfList->GetNumberOfTrackedFrames() - 1 )->GetTimestamp(); 
+    }
+
+    this->NumberOfFrames += tfList->GetNumberOfTrackedFrames(); 
+    this->InputFiles.push_back(inputFile); 
+  }
+
+  return PLUS_SUCCESS; 
+}
+
+//-------------------------------------------------------
+PlusStatus InputFrameReader::ReadFrame( unsigned int frameIndex, TrackedFrame &trackedFrame )
+{
+  // Find the file that contains the frame, the files that have been read completely are released
+  while ( this->CurrentFileIndex < this->InputFiles.size() 
+    && frameIndex >= this->InputFiles[this->CurrentFileIndex].FirstFrameIndex + this->InputFiles[this->CurrentFileIndex].Reader->GetTrackedFrameList()->GetNumberOfTrackedFrames() )
+  {
+    this->InputFiles[this->CurrentFileIndex].Reader = NULL; 
+    this->CurrentFileIndex++; 
+  }
+  if ( this->CurrentFileIndex >= this->InputFiles.size() || frameIndex < this->InputFiles[this->CurrentFileIndex].FirstFrameIndex )
+  {
+    LOG_ERROR("Cannot read frame #" << frameIndex << ", frames shall be read in increasing order"); 
+    return PLUS_FAIL; 
+  }
+
+  InputFile &inputFile = this->InputFiles[this->CurrentFileIndex]; 
+  int frameNumber = frameIndex - inputFile.FirstFrameIndex; 
+
+  // Frame fields and timestamp are copied from the header. The frame is not assigned as a whole,
+  // because that would release the image buffer that ReadFramePixels can reuse for the next frame.
+  TrackedFrame* headerFrame = inputFile.Reader->GetTrackedFrameList()->GetTrackedFrame(frameNumber); 
+  std::vector<std::string> previousFieldNames; 
+  trackedFrame.GetCustomFrameFieldNameList(previousFieldNames); 
+  for ( std::vector<std::string>::iterator fieldNameIt = previousFieldNames.begin(); fieldNameIt != previousFieldNames.end(); ++fieldNameIt )
+  {
+    trackedFrame.DeleteCustomFrameField(fieldNameIt->c_str()); 
+  }
+  const TrackedFrame::FieldMapType& headerFields = headerFrame->GetCustomFields(); 
+  for ( TrackedFrame::FieldMapType::const_iterator fieldIt = headerFields.begin(); fieldIt != headerFields.end(); ++fieldIt )
+  {
+    trackedFrame.SetCustomFrameField(fieldIt->first, fieldIt->second); 
+  }
+  trackedFrame.SetTimestamp(headerFrame->GetTimestamp()); 
+
+  bool imageRead = false; 
+  int* frameSize = inputFile.Reader->GetDimensions(); 
+  if ( frameSize[0] > 0 && frameSize[1] > 0 )
+  {
+    // Image status can be determined by trackedFrame->GetImageData()->IsImageValid(), so the field is not kept
+    bool imageValid = true; 
+    const char* imgStatus = trackedFrame.GetCustomFrameField("ImageStatus"); 
+    if ( imgStatus != NULL )
+    {
+      imageValid = ( STRCASECMP(imgStatus, "OK") == 0 ); 
+      trackedFrame.DeleteCustomFrameField("ImageStatus"); 
+    }
+    if ( imageValid && inputFile.Reader->ReadFramePixels(frameNumber, *trackedFrame.GetImageData()) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to read the image data of frame #" << frameNumber << " from the input sequence metafile"); 
+      return PLUS_FAIL; 
+    }
+    imageRead = imageValid; 
+  }
+  if ( !imageRead )
+  {
+    // The image of the previous frame must not be kept
+    *trackedFrame.GetImageData() = PlusVideoFrame(); 
+  }
+
+  if ( this->IncrementTimestamps )
+  {
+    trackedFrame.SetTimestamp( inputFile.TimestampOffset + trackedFrame.GetTimestamp() ); 
+  }
+
+  return PLUS_SUCCESS; 
+}
+
+//-------------------------------------------------------
+PlusStatus EditFramesInBatches( InputFrameReader &inputFrameReader, unsigned int firstFrameIndex, unsigned int numberOfFrames, unsigned int batchSize, 
+  vtkTrackedFrameList* trackedFrameList, FrameOperation &frameOperation, vtkMetaImageSequenceIO* writer )
+{
+  // The header is written when the first batch is available, so the total number of frames has to be specified in advance
+  writer->SetTrackedFrameList(trackedFrameList); 
+  writer->SetNumberOfFramesToWrite(numberOfFrames); 
+  trackedFrameList->SetMaxNumberOfRecycledFrames(batchSize); 
+
+  TrackedFrame trackedFrame; 
+  unsigned int frameIndex = firstFrameIndex; 
+  unsigned int numberOfWrittenFrames = 0; 
+  bool headerPrepared = false; 
+  while ( !headerPrepared || numberOfWrittenFrames < numberOfFrames )
+  {
+    // The image format in the header is determined from the first batch, therefore it is extended until it contains a valid image
+    trackedFrameList->Clear(); 
+    while ( frameIndex < firstFrameIndex + numberOfFrames 
+      && ( trackedFrameList->GetNumberOfTrackedFrames() < batchSize || ( !headerPrepared && !trackedFrameList->IsContainingValidImageData() ) ) )
+    {
+      if ( inputFrameReader.ReadFrame(frameIndex, trackedFrame) != PLUS_SUCCESS )
+      {
+        return PLUS_FAIL; 
+      }
+      if ( trackedFrameList->AddTrackedFrameBySwap(&trackedFrame) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to add tracked frame to the list!"); 
+        return PLUS_FAIL; 
+      }
+      frameIndex++; 
+    }
+
+    if ( PerformFrameOperation( trackedFrameList, frameOperation ) != PLUS_SUCCESS )
+    {
+      return PLUS_FAIL; 
+    }
+
+    if ( !headerPrepared )
+    {
+      if ( writer->PrepareHeader() != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Unable to prepare the header."); 
+        return PLUS_FAIL; 
+      }
+      headerPrepared = true; 
+    }
+    else
+    {
+      // All the images shall have the same size as the images in the first batch
+      int* frameSize = writer->GetDimensions(); 
+      for ( unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i )
+      {
+        int* currFrameSize = trackedFrameList->GetTrackedFrame(i)->GetFrameSize(); 
+        if ( trackedFrameList->GetTrackedFrame(i)->GetImageData()->IsImageValid() 
+          && ( frameSize[0] != currFrameSize[0] || frameSize[1] != currFrameSize[1] ) )
+        {
+          LOG_ERROR("Frame size mismatch: expected size (" << frameSize[0] << "x" << frameSize[1] 
+          << ") differ from actual size (" << currFrameSize[0] << "x" << currFrameSize[1] << ") for frame #" << numberOfWrittenFrames + i); 
+          return PLUS_FAIL; 
+        }
+      }
+    }
+
+    if ( writer->AppendImagesToHeader() != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Unable to append images to the header."); 
+      return PLUS_FAIL; 
+    }
+    if ( writer->AppendImages() != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Unable to append images."); 
+      return PLUS_FAIL; 
+    }
+    numberOfWrittenFrames += trackedFrameList->GetNumberOfTrackedFrames(); 
+  }
+
+  if ( writer->FinalizeHeader() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Unable to finalize the header."); 
+    return PLUS_FAIL; 
+  }
+  return writer->Close(); 
+}
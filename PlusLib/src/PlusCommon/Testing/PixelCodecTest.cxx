@@ -0,0 +1,179 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PixelCodecTest.cxx
+  \brief Test and benchmark for the PixelCodec pixel format converters.
+  Verifies that the SIMD and multi-threaded converters produce the same output as the scalar converters
+  and reports the conversion speed (in megapixels per second) for each conversion.
+*/
+
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+#include "vtkAccurateTimer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <stdlib.h>
+#include <vector>
+
+namespace
+{
+  enum ConversionType
+  {
+    CONVERSION_YUY2_TO_GRAY,
+    CONVERSION_YUY2_TO_RGB,
+    CONVERSION_BGR_TO_RGB,
+    CONVERSION_RGB_TO_GRAY,
+    CONVERSION_LAST
+  };
+
+  //----------------------------------------------------------------------------
+  const char* GetConversionName(ConversionType conversion)
+  {
+    switch (conversion)
+    {
+    case CONVERSION_YUY2_TO_GRAY: return "YUY2->Gray";
+    case CONVERSION_YUY2_TO_RGB: return "YUY2->RGB";
+    case CONVERSION_BGR_TO_RGB: return "BGR->RGB";
+    case CONVERSION_RGB_TO_GRAY: return "RGB->Gray";
+    default: return "Unknown";
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void Convert(ConversionType conversion, int width, int height, unsigned char* input, unsigned char* output)
+  {
+    switch (conversion)
+    {
+    case CONVERSION_YUY2_TO_GRAY: PixelCodec::Yuv422pToGray(width, height, input, output); break;
+    case CONVERSION_YUY2_TO_RGB: PixelCodec::Yuv422pToBmp24(PixelCodec::ComponentOrder_RGB, width, height, input, output); break;
+    case CONVERSION_BGR_TO_RGB: PixelCodec::Bgr24ToRgb24(width, height, input, output); break;
+    case CONVERSION_RGB_TO_GRAY: PixelCodec::Rgb24ToGray(width, height, input, output); break;
+    default: break;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns the conversion speed in megapixels per second
+  double MeasureConversionSpeed(ConversionType conversion, int width, int height, int numberOfRepetitions, unsigned char* input, unsigned char* output)
+  {
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    for (int i=0; i<numberOfRepetitions; i++)
+    {
+      Convert(conversion, width, height, input, output);
+    }
+    double elapsedTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+    if (elapsedTimeSec<=0)
+    {
+      return 0;
+    }
+    return 1e-6*width*height*numberOfRepetitions/elapsedTimeSec;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  int width(1920);
+  int height(1080);
+  int numberOfRepetitions(20);
+  int numberOfThreads(4);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &width, "Image width in pixels (Default: 1920).");
+  args.AddArgument("--height", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &height, "Image height in pixels (Default: 1080).");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of conversions for measuring the speed (Default: 20).");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads used in the multi-threaded measurement (Default: 4).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( width<2 || height<1 || numberOfRepetitions<1 )
+  {
+    std::cerr << "Invalid image size or number of repetitions" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  LOG_INFO("SIMD converters supported: " << (PixelCodec::IsSimdSupported() ? "yes" : "no"));
+
+  // Input buffer is large enough for both YUY2 (2 bytes/pixel) and RGB24 (3 bytes/pixel) images
+  std::vector<unsigned char> input(width*height*3);
+  srand(0);
+  for (unsigned int i=0; i<input.size(); i++)
+  {
+    input[i] = static_cast<unsigned char>(rand()%256);
+  }
+  std::vector<unsigned char> referenceOutput(width*height*3);
+  std::vector<unsigned char> output(width*height*3);
+
+  int numberOfErrors(0);
+  for (int conversionIndex=0; conversionIndex<CONVERSION_LAST; conversionIndex++)
+  {
+    ConversionType conversion = static_cast<ConversionType>(conversionIndex);
+
+    // Scalar, single thread
+    PixelCodec::SetConversionMode(PixelCodec::ConversionMode_Scalar);
+    PixelCodec::SetNumberOfThreads(1);
+    Convert(conversion, width, height, &input[0], &referenceOutput[0]);
+    double scalarSpeed = MeasureConversionSpeed(conversion, width, height, numberOfRepetitions, &input[0], &output[0]);
+
+    // SIMD, single thread
+    PixelCodec::SetConversionMode(PixelCodec::ConversionMode_Simd);
+    std::fill(output.begin(), output.end(), 0);
+    Convert(conversion, width, height, &input[0], &output[0]);
+    if (output != referenceOutput)
+    {
+      LOG_ERROR(GetConversionName(conversion) << ": SIMD conversion result is different from the scalar conversion result");
+      numberOfErrors++;
+    }
+    double simdSpeed = MeasureConversionSpeed(conversion, width, height, numberOfRepetitions, &input[0], &output[0]);
+
+    // SIMD, multiple threads
+    PixelCodec::SetNumberOfThreads(numberOfThreads);
+    std::fill(output.begin(), output.end(), 0);
+    Convert(conversion, width, height, &input[0], &output[0]);
+    if (output != referenceOutput)
+    {
+      LOG_ERROR(GetConversionName(conversion) << ": multi-threaded conversion result is different from the scalar conversion result");
+      numberOfErrors++;
+    }
+    double multiThreadedSpeed = MeasureConversionSpeed(conversion, width, height, numberOfRepetitions, &input[0], &output[0]);
+
+    LOG_INFO(GetConversionName(conversion) << " (" << width << "x" << height << ") speed [Mpixel/s]: scalar: " << std::fixed << scalarSpeed
+      << ", SIMD: " << simdSpeed << ", SIMD with " << numberOfThreads << " threads: " << multiThreadedSpeed);
+  }
+
+  // Restore defaults
+  PixelCodec::SetConversionMode(PixelCodec::ConversionMode_Simd);
+  PixelCodec::SetNumberOfThreads(1);
+
+  if (numberOfErrors>0)
+  {
+    LOG_ERROR("PixelCodecTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("PixelCodecTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusLoggerPerformanceTest.cxx
+  \brief Benchmark for the logger. Multiple threads (simulating device capture threads) log TRACE messages
+  and the time spent in the logging calls is measured, with synchronous and asynchronous logging.
+  The test also checks that an observer can log messages while a message is being written.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkAccurateTimer.h"
+#include "vtkCommand.h"
+#include "vtkMultiThreader.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <vector>
+
+namespace
+{
+  const char OBSERVED_MESSAGE[]="Observed test message";
+  const char OBSERVER_REPLY_MESSAGE[]="Observer reply test message";
+
+  //----------------------------------------------------------------------------
+  // Logs a message when it receives the observed message, i.e., while the logger is writing the messages
+  class LoggingObserver : public vtkCommand
+  {
+  public:
+    static LoggingObserver *New() { return new LoggingObserver; }
+    virtual void Execute(vtkObject *caller, unsigned long eventId, void *callData)
+    {
+      std::string message = static_cast<const char*>(callData);
+      if (message.find(OBSERVER_REPLY_MESSAGE) != std::string::npos)
+      {
+        this->NumberOfReceivedReplies++;
+      }
+      else if (message.find(OBSERVED_MESSAGE) != std::string::npos)
+      {
+        LOG_INFO(OBSERVER_REPLY_MESSAGE);
+      }
+    }
+    int NumberOfReceivedReplies;
+  protected:
+    LoggingObserver() : NumberOfReceivedReplies(0) {}
+  };
+
+  struct LoggingThreadData
+  {
+    int NumberOfMessages;
+    std::vector<double> TotalLoggingTimeSec;
+    std::vector<double> MaximumLoggingTimeSec;
+  };
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE LoggingThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo *threadInfo = static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+    LoggingThreadData* data = static_cast<LoggingThreadData*>(threadInfo->UserData);
+    int threadIndex = threadInfo->ThreadID;
+    double totalTimeSec = 0;
+    double maximumTimeSec = 0;
+    for (int i=0; i<data->NumberOfMessages; i++)
+    {
+      double startTimeSec = vtkAccurateTimer::GetSystemTime();
+      LOG_TRACE("Capture thread " << threadIndex << " acquired frame " << i);
+      double elapsedTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+      totalTimeSec += elapsedTimeSec;
+      if (elapsedTimeSec > maximumTimeSec)
+      {
+        maximumTimeSec = elapsedTimeSec;
+      }
+    }
+    data->TotalLoggingTimeSec[threadIndex] = totalTimeSec;
+    data->MaximumLoggingTimeSec[threadIndex] = maximumTimeSec;
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  void MeasureLoggingTime(bool asynchronous, int numberOfThreads, int numberOfMessages)
+  {
+    vtkPlusLogger::Instance()->SetAsynchronousLogging(asynchronous);
+
+    LoggingThreadData data;
+    data.NumberOfMessages = numberOfMessages;
+    data.TotalLoggingTimeSec.resize(numberOfThreads, 0);
+    data.MaximumLoggingTimeSec.resize(numberOfThreads, 0);
+
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(LoggingThreadFunction, &data);
+    threader->SingleMethodExecute();
+
+    // Write all the messages before the results are reported
+    vtkPlusLogger::Instance()->WriteQueuedMessages();
+
+    double totalTimeSec = 0;
+    double maximumTimeSec = 0;
+    for (int threadIndex=0; threadIndex<numberOfThreads; threadIndex++)
+    {
+      totalTimeSec += data.TotalLoggingTimeSec[threadIndex];
+      if (data.MaximumLoggingTimeSec[threadIndex] > maximumTimeSec)
+      {
+        maximumTimeSec = data.MaximumLoggingTimeSec[threadIndex];
+      }
+    }
+    LOG_INFO((asynchronous ? "Asynchronous" : "Synchronous") << " logging with " << numberOfThreads << " threads, time spent in logging a message [us]: average: "
+      << std::fixed << 1e6*totalTimeSec/(numberOfThreads*numberOfMessages) << ", maximum: " << 1e6*maximumTimeSec);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  int numberOfMessages(1000);
+  int numberOfThreads(2);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-messages", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfMessages, "Number of messages logged by each thread (Default: 1000).");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads that log messages simultaneously (Default: 2).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( numberOfMessages<1 || numberOfThreads<1 )
+  {
+    std::cerr << "Invalid number of messages or threads" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // The messages are only measured if they are actually logged
+  int logLevel = vtkPlusLogger::Instance()->GetLogLevel();
+  vtkPlusLogger::Instance()->SetLogLevel(vtkPlusLogger::LOG_LEVEL_TRACE);
+
+  MeasureLoggingTime(false, numberOfThreads, numberOfMessages);
+  MeasureLoggingTime(true, numberOfThreads, numberOfMessages);
+
+  // Repeated messages are logged only once, the logging time is measured to show the cost of a suppressed message
+  double startTimeSec = vtkAccurateTimer::GetSystemTime();
+  for (int i=0; i<numberOfMessages; i++)
+  {
+    LOG_TRACE("Repeated test message");
+  }
+  double repeatedMessageTimeSec = (vtkAccurateTimer::GetSystemTime() - startTimeSec) / numberOfMessages;
+  vtkPlusLogger::Instance()->WriteQueuedMessages();
+  LOG_INFO("Time spent in logging a repeated message [us]: " << std::fixed << 1e6*repeatedMessageTimeSec);
+
+  // Log a message from an observer while the logger is writing the messages
+  vtkPlusLogger::Instance()->SetAsynchronousLogging(false);
+  vtkSmartPointer<LoggingObserver> observer = vtkSmartPointer<LoggingObserver>::New();
+  unsigned long observerTag = vtkPlusLogger::Instance()->AddObserver(vtkCommand::UserEvent, observer);
+  LOG_INFO(OBSERVED_MESSAGE);
+  vtkPlusLogger::Instance()->RemoveObserver(observerTag);
+  if (observer->NumberOfReceivedReplies != 1)
+  {
+    std::cerr << "The message that was logged by the observer was written " << observer->NumberOfReceivedReplies << " times instead of once" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(logLevel);
+
+  LOG_INFO("vtkPlusLoggerPerformanceTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusTracerTest.cxx
+  \brief Test for the pipeline tracer. Multiple threads record trace events, then the statistics
+  and the Chrome trace file are generated and checked. The overhead of trace points is reported.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkMultiThreader.h"
+#include "vtkPlusTracer.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+  const char TEST_STAGE_NAME[] = "vtkPlusTracerTest::TestStage";
+
+  int NumberOfEventsPerThread = 0;
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE TracingThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo *threadInfo = static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+    for (int i=0; i<NumberOfEventsPerThread; i++)
+    {
+      PlusTraceScope traceScope(TEST_STAGE_NAME);
+      traceScope.SetFrameUid(threadInfo->ThreadID*NumberOfEventsPerThread+i);
+    }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns the average time needed for executing a trace point (in seconds)
+  double MeasureTracePointTime(int numberOfRepetitions)
+  {
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    for (int i=0; i<numberOfRepetitions; i++)
+    {
+      PlusTraceScope traceScope("vtkPlusTracerTest::Overhead");
+    }
+    return (vtkAccurateTimer::GetSystemTime() - startTimeSec) / numberOfRepetitions;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  int numberOfThreads(4);
+  int numberOfEventsPerThread(1000);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads that record events simultaneously (Default: 4).");
+  args.AddArgument("--number-of-events", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfEventsPerThread, "Number of events recorded by each thread (Default: 1000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( numberOfThreads<1 || numberOfEventsPerThread<1 )
+  {
+    std::cerr << "Invalid number of threads or events" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+
+  // Trace points shall not record anything while tracing is disabled
+  double disabledTracePointTimeSec = MeasureTracePointTime(numberOfEventsPerThread);
+
+  vtkPlusTracer* tracer = vtkPlusTracer::Instance();
+  tracer->SetEnabled(true);
+
+  NumberOfEventsPerThread = numberOfEventsPerThread;
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(TracingThreadFunction, NULL);
+  threader->SingleMethodExecute();
+
+  double enabledTracePointTimeSec = MeasureTracePointTime(numberOfEventsPerThread);
+
+  tracer->SetEnabled(false);
+
+  LOG_INFO("Average time of a trace point [us]: tracing disabled: " << std::fixed << 1e6*disabledTracePointTimeSec
+    << ", tracing enabled: " << 1e6*enabledTracePointTimeSec);
+
+  std::string statistics;
+  tracer->GetStatistics(statistics);
+  LOG_INFO("Trace statistics:\n" << statistics);
+
+  // Check the number of events in the statistics
+  std::ostringstream expectedStatistics;
+  expectedStatistics << TEST_STAGE_NAME << ": count=" << numberOfThreads*numberOfEventsPerThread << ",";
+  if ( statistics.find(expectedStatistics.str()) == std::string::npos )
+  {
+    LOG_ERROR("Statistics does not contain the expected number of events (expected: " << expectedStatistics.str() << ")");
+    numberOfErrors++;
+  }
+
+  // Check the Chrome trace file
+  std::string traceFilename = vtkPlusConfig::GetInstance()->GetOutputPath("vtkPlusTracerTest.json");
+  if ( tracer->WriteChromeTrace(traceFilename) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to write trace file");
+    numberOfErrors++;
+  }
+  else
+  {
+    std::ifstream traceFile(traceFilename.c_str());
+    std::string line;
+    int numberOfTestStageEvents(0);
+    while ( std::getline(traceFile, line) )
+    {
+      if ( line.find(TEST_STAGE_NAME) != std::string::npos )
+      {
+        numberOfTestStageEvents++;
+      }
+    }
+    // If the number of events is too large then only the most recent events are kept in the ring buffers
+    if ( numberOfTestStageEvents <= 0 || numberOfTestStageEvents > numberOfThreads*numberOfEventsPerThread )
+    {
+      LOG_ERROR("Unexpected number of events in the trace file: " << numberOfTestStageEvents);
+      numberOfErrors++;
+    }
+  }
+
+  if (numberOfErrors>0)
+  {
+    LOG_ERROR("vtkPlusTracerTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkPlusTracerTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,254 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkTrackedFrameListRecyclingTest.cxx
+  \brief Test for reusing frames and image buffers in vtkTrackedFrameList.
+  Records a large number of frames in batches (the list is cleared after each batch, as in the
+  acquisition and broadcasting loops) and verifies that after the first batch no new image buffers
+  are allocated and the number of frames kept in memory does not grow.
+*/
+
+#include "PlusConfigure.h"
+#include "TrackedFrame.h"
+#include "vtkAccurateTimer.h"
+#include "vtkSmartPointer.h"
+#include "vtkTrackedFrameList.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <string.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Allocate the image of the frame (if needed) and fill it with a pattern that identifies the frame
+  PlusStatus FillFrame(TrackedFrame& trackedFrame, const int frameSize[2], int frameIndex)
+  {
+    if ( trackedFrame.GetImageData()->AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("Failed to allocate frame " << frameIndex);
+      return PLUS_FAIL;
+    }
+    memset(trackedFrame.GetImageData()->GetScalarPointer(), frameIndex & 0xFF, trackedFrame.GetImageData()->GetFrameSizeInBytes());
+    trackedFrame.SetTimestamp(1.0 + frameIndex * 0.033);
+    std::ostringstream frameIndexStr;
+    frameIndexStr << frameIndex;
+    trackedFrame.SetCustomFrameField("FrameIndex", frameIndexStr.str());
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Verify that the frame in the list has the expected content
+  PlusStatus VerifyFrame(TrackedFrame* trackedFrame, const int frameSize[2], int frameIndex)
+  {
+    int actualFrameSize[2] = {0,0};
+    trackedFrame->GetImageData()->GetFrameSize(actualFrameSize);
+    if ( actualFrameSize[0] != frameSize[0] || actualFrameSize[1] != frameSize[1] )
+    {
+      LOG_ERROR("Frame " << frameIndex << " size mismatch: " << actualFrameSize[0] << "x" << actualFrameSize[1]);
+      return PLUS_FAIL;
+    }
+    const unsigned char* pixels = static_cast<const unsigned char*>(trackedFrame->GetImageData()->GetScalarPointer());
+    const unsigned long numberOfPixels = trackedFrame->GetImageData()->GetFrameSizeInBytes();
+    if ( pixels[0] != (frameIndex & 0xFF) || pixels[numberOfPixels-1] != (frameIndex & 0xFF) )
+    {
+      LOG_ERROR("Frame " << frameIndex << " pixel value mismatch");
+      return PLUS_FAIL;
+    }
+    std::ostringstream frameIndexStr;
+    frameIndexStr << frameIndex;
+    const char* frameIndexField = trackedFrame->GetCustomFrameField("FrameIndex");
+    if ( frameIndexField == NULL || frameIndexStr.str().compare(frameIndexField) != 0 )
+    {
+      LOG_ERROR("Frame " << frameIndex << " custom field mismatch");
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  int numberOfFrames(10000);
+  int batchSize(10);
+  int frameSize[2] = {320, 240};
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Total number of recorded frames (Default: 10000).");
+  args.AddArgument("--batch-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &batchSize, "Number of frames recorded before the list is cleared (Default: 10).");
+  args.AddArgument("--frame-width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[0], "Frame width in pixels (Default: 320).");
+  args.AddArgument("--frame-height", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[1], "Frame height in pixels (Default: 240).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( numberOfFrames < 1 || batchSize < 1 || frameSize[0] < 1 || frameSize[1] < 1 )
+  {
+    std::cerr << "Invalid arguments" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+
+  vtkSmartPointer<vtkTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkTrackedFrameList>::New();
+
+  // Recycling is disabled by default, cleared frames are not kept in memory
+  {
+    TrackedFrame frame;
+    FillFrame(frame, frameSize, 1);
+    trackedFrameList->AddTrackedFrame(&frame, vtkTrackedFrameList::ADD_INVALID_FRAME);
+    trackedFrameList->Clear();
+    if ( trackedFrameList->GetNumberOfRecycledFrames() != 0 )
+    {
+      LOG_ERROR("Cleared frames are kept in memory although recycling is not enabled");
+      numberOfErrors++;
+    }
+  }
+
+  trackedFrameList->SetMaxNumberOfRecycledFrames(batchSize);
+
+  // The source frame is reused for all the frames that are added by swapping
+  TrackedFrame sourceFrame;
+
+  // Pixel buffers that have been allocated during the warm-up. Image buffers are allocated in the first batch
+  // (nothing can be recycled yet) and the source frame may allocate a buffer in the second batch (it received
+  // an empty frame in exchange for the last frame of the first batch).
+  std::set<void*> allocatedImageBuffers;
+  const int numberOfWarmUpFrames = 2*batchSize;
+
+  double startTimeSec = vtkAccurateTimer::GetSystemTime();
+  for ( int batchStartFrameIndex = 0; batchStartFrameIndex < numberOfFrames; batchStartFrameIndex += batchSize )
+  {
+    const bool warmUp = (batchStartFrameIndex < numberOfWarmUpFrames);
+    const int batchEndFrameIndex = std::min(batchStartFrameIndex + batchSize, numberOfFrames);
+    for ( int frameIndex = batchStartFrameIndex; frameIndex < batchEndFrameIndex; ++frameIndex )
+    {
+      if ( FillFrame(sourceFrame, frameSize, frameIndex) != PLUS_SUCCESS )
+      {
+        numberOfErrors++;
+        continue;
+      }
+      // Add every other frame by copying and the others by swapping
+      PlusStatus addStatus = (frameIndex % 2 == 0)
+        ? trackedFrameList->AddTrackedFrame(&sourceFrame, vtkTrackedFrameList::ADD_INVALID_FRAME)
+        : trackedFrameList->AddTrackedFrameBySwap(&sourceFrame, vtkTrackedFrameList::ADD_INVALID_FRAME);
+      if ( addStatus != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to add frame " << frameIndex << " to the list");
+        numberOfErrors++;
+      }
+    }
+
+    // Check the recorded frames and their image buffers
+    for ( int frameIndex = batchStartFrameIndex; frameIndex < batchEndFrameIndex; ++frameIndex )
+    {
+      TrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(frameIndex - batchStartFrameIndex);
+      if ( trackedFrame == NULL || VerifyFrame(trackedFrame, frameSize, frameIndex) != PLUS_SUCCESS )
+      {
+        numberOfErrors++;
+        continue;
+      }
+      void* imageBuffer = trackedFrame->GetImageData()->GetScalarPointer();
+      if ( warmUp )
+      {
+        allocatedImageBuffers.insert(imageBuffer);
+      }
+      else if ( allocatedImageBuffers.find(imageBuffer) == allocatedImageBuffers.end() )
+      {
+        LOG_ERROR("Frame " << frameIndex << " uses a newly allocated image buffer");
+        numberOfErrors++;
+      }
+    }
+    if ( warmUp && sourceFrame.GetImageData()->IsImageValid() )
+    {
+      // The source frame may give its buffer to the list later
+      allocatedImageBuffers.insert(sourceFrame.GetImageData()->GetScalarPointer());
+    }
+
+    trackedFrameList->Clear();
+
+    if ( trackedFrameList->GetNumberOfRecycledFrames() > batchSize )
+    {
+      LOG_ERROR("Number of recycled frames (" << trackedFrameList->GetNumberOfRecycledFrames() << ") is larger than the maximum (" << batchSize << ")");
+      numberOfErrors++;
+    }
+
+    if ( numberOfErrors > 0 )
+    {
+      break;
+    }
+  }
+  double elapsedTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+
+  // Recycled frames, frames in the list and the source frame
+  if ( allocatedImageBuffers.size() > static_cast<unsigned int>(batchSize+1) )
+  {
+    LOG_ERROR("Too many image buffers were allocated: " << allocatedImageBuffers.size() << " (expected at most " << batchSize+1 << ")");
+    numberOfErrors++;
+  }
+
+  LOG_INFO("Recorded " << numberOfFrames << " frames (" << frameSize[0] << "x" << frameSize[1] << "), average time per frame: "
+    << std::fixed << 1000.0*elapsedTimeSec/numberOfFrames << " ms, number of allocated image buffers: " << allocatedImageBuffers.size());
+
+  // Check that frames that have a different size are not mixed up with the recycled frames
+  int otherFrameSize[2] = {frameSize[0]+1, frameSize[1]};
+  TrackedFrame otherSizeFrame;
+  FillFrame(otherSizeFrame, otherFrameSize, 123);
+  trackedFrameList->AddTrackedFrame(&otherSizeFrame, vtkTrackedFrameList::ADD_INVALID_FRAME);
+  if ( VerifyFrame(trackedFrameList->GetTrackedFrame(0), otherFrameSize, 123) != PLUS_SUCCESS )
+  {
+    numberOfErrors++;
+  }
+  trackedFrameList->Clear();
+
+  // Recycled frames can be released without disabling recycling
+  trackedFrameList->ReleaseRecycledFrames();
+  if ( trackedFrameList->GetNumberOfRecycledFrames() != 0 || trackedFrameList->GetMaxNumberOfRecycledFrames() != batchSize )
+  {
+    LOG_ERROR("Recycled frames are not released");
+    numberOfErrors++;
+  }
+
+  // Recycling can be disabled
+  trackedFrameList->AddTrackedFrame(&otherSizeFrame, vtkTrackedFrameList::ADD_INVALID_FRAME);
+  trackedFrameList->Clear();
+  trackedFrameList->SetMaxNumberOfRecycledFrames(0);
+  if ( trackedFrameList->GetNumberOfRecycledFrames() != 0 )
+  {
+    LOG_ERROR("Recycled frames are not released when recycling is disabled");
+    numberOfErrors++;
+  }
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("vtkTrackedFrameListRecyclingTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkTrackedFrameListRecyclingTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -7,6 +7,7 @@
 #include "vtkMatrix4x4.h"
 #include "vtkPoints.h"
 #include "vtkXMLUtilities.h"
+#include <algorithm>
 
 //----------------------------------------------------------------------------
 // ************************* TrackedFrame ************************************
@@ -61,6 +62,22 @@ TrackedFrame& TrackedFrame::operator=(TrackedFrame const&trackedFrame)
   return *this;
 }
 
+//----------------------------------------------------------------------------
+void TrackedFrame::Swap(TrackedFrame& trackedFrame)
+{
+  if (this == &trackedFrame)
+  {
+    return;
+  }
+  this->ImageData.Swap(trackedFrame.ImageData);
+  this->CustomFrameFields.swap(trackedFrame.CustomFrameFields);
+  std::swap(this->Timestamp, trackedFrame.Timestamp);
+  std::swap(this->FrameSize[0], trackedFrame.FrameSize[0]);
+  std::swap(this->FrameSize[1], trackedFrame.FrameSize[1]);
+  // Fiducial points are reference counted, swapping the pointers does not change ownership
+  std::swap(this->FiducialPointsCoordinatePx, trackedFrame.FiducialPointsCoordinatePx);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus TrackedFrame::GetTrackedFrameInXmlData( std::string& strXmlData )
 {
@@ -48,6 +48,12 @@ public:
   TrackedFrame(const TrackedFrame& frame); 
   TrackedFrame& operator=(TrackedFrame const&trackedFrame); 
 
+  /*!
+    Exchange the content of two tracked frames (image, fields, timestamp, fiducial points)
+    without copying or allocating pixel data
+  */
+  void Swap(TrackedFrame& trackedFrame);
+
 public:
   /*! Set image data */
   void SetImageData(const PlusVideoFrame &value); 
@@ -8,6 +8,7 @@
 #include "itk_zlib.h"
 #include "itksys/SystemTools.hxx"
 #include "vtkMetaImageSequenceIO.h"
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 
@@ -61,6 +62,15 @@ static const char* SEQMETA_FIELD_VALUE_ELEMENT_DATA_FILE_LOCAL = "LOCAL";
 static std::string SEQMETA_FIELD_FRAME_FIELD_PREFIX = "Seq_Frame"; 
 static std::string SEQMETA_FIELD_IMG_STATUS = "ImageStatus"; 
 
+// Size of the buffer for reading compressed pixel data and for writing the output of the compression
+static const int ZLIB_BUFFER_SIZE=16384;
+
+//----------------------------------------------------------------------------
+struct vtkMetaImageSequenceIO::ZlibStream
+{
+  z_stream Stream;
+};
+
 vtkCxxRevisionMacro(vtkMetaImageSequenceIO, "$Revision: 1.0 $");
 vtkStandardNewMacro(vtkMetaImageSequenceIO); 
 vtkCxxSetObjectMacro(vtkMetaImageSequenceIO, TrackedFrameList, vtkTrackedFrameList);
@@ -79,6 +89,13 @@ vtkMetaImageSequenceIO::vtkMetaImageSequenceIO()
 , ImageOrientationInMemory(US_IMG_ORIENT_XX)
 , ImageType(US_IMG_TYPE_XX)
 , PixelDataFileOffset(0)
+, FramePixelsReadStream(NULL)
+, DecompressionStream(NULL)
+, NextDecompressedFrameNumber(0)
+, RemainingCompressedDataSize(0)
+, CompressionStream(NULL)
+, AppendedCompressedDataSize(0)
+, NumberOfFramesToWrite(0)
 { 
   this->Dimensions[0]=0;
   this->Dimensions[1]=0;
@@ -88,6 +105,13 @@ vtkMetaImageSequenceIO::vtkMetaImageSequenceIO()
 //----------------------------------------------------------------------------
 vtkMetaImageSequenceIO::~vtkMetaImageSequenceIO()
 {
+  CloseFramePixelsReadStream();
+  if (this->CompressionStream!=NULL)
+  {
+    deflateEnd(&this->CompressionStream->Stream);
+    delete this->CompressionStream;
+    this->CompressionStream=NULL;
+  }
   SetTrackedFrameList(NULL);
 }
 
@@ -609,6 +633,187 @@ PlusStatus vtkMetaImageSequenceIO::Read()
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkMetaImageSequenceIO::ReadHeader()
+{
+  CloseFramePixelsReadStream();
+  this->TrackedFrameList->Clear();
+
+  if (ReadImageHeader()!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Could not load header from file: " << this->FileName);
+    return PLUS_FAIL;
+  }
+
+  // Make sure that there is a tracked frame for each frame in the sequence (even if it has no frame fields)
+  if (this->Dimensions[2]>0)
+  {
+    CreateTrackedFrameIfNonExisting(this->Dimensions[2]-1);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMetaImageSequenceIO::CanReadFramePixels()
+{
+  // Compressed pixel data can only be uncompressed sequentially
+  return !this->UseCompression;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkMetaImageSequenceIO::ReadFramePixels(int frameNumber, PlusVideoFrame &frame)
+{
+  if (frameNumber<0 || frameNumber>=this->Dimensions[2])
+  {
+    LOG_ERROR("Cannot read pixel data of frame "<<frameNumber<<", the sequence contains "<<this->Dimensions[2]<<" frames");
+    return PLUS_FAIL;
+  }
+  unsigned int frameSizeInBytes=0;
+  if (this->Dimensions[0]>0 && this->Dimensions[1]>0)
+  {
+    frameSizeInBytes=this->Dimensions[0]*this->Dimensions[1]*PlusVideoFrame::GetNumberOfBytesPerScalar(this->PixelType)*this->NumberOfScalarComponents;
+  }
+  if (frameSizeInBytes==0)
+  {
+    LOG_ERROR("No image data in the metafile: "<<this->FileName);
+    return PLUS_FAIL;
+  }
+
+  if (this->FramePixelsReadStream==NULL)
+  {
+    if ( FileOpen( &this->FramePixelsReadStream, GetPixelDataFilePath().c_str(), "rb" ) != PLUS_SUCCESS )
+    {
+      LOG_ERROR("The file "<<GetPixelDataFilePath()<<" could not be opened for reading");
+      return PLUS_FAIL;
+    }
+  }
+
+  this->FramePixelsReadBuffer.resize(frameSizeInBytes);
+  if (this->UseCompression)
+  {
+    if (ReadCompressedFramePixels(frameNumber, frameSizeInBytes)!=PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+  else
+  {
+    FilePositionOffsetType offset=this->PixelDataFileOffset+static_cast<FilePositionOffsetType>(frameNumber)*frameSizeInBytes;
+    FSEEK(this->FramePixelsReadStream, offset, SEEK_SET);
+    if (fread(&(this->FramePixelsReadBuffer[0]), 1, frameSizeInBytes, this->FramePixelsReadStream)!=frameSizeInBytes)
+    {
+      LOG_ERROR("Could not read "<<frameSizeInBytes<<" bytes of frame "<<frameNumber<<" from "<<GetPixelDataFilePath());
+      return PLUS_FAIL;
+    }
+  }
+
+  frame.SetImageOrientation(this->ImageOrientationInMemory);
+  frame.SetImageType(this->ImageType);
+  if (frame.AllocateFrame(this->Dimensions, this->PixelType, this->NumberOfScalarComponents)!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Cannot allocate memory for frame "<<frameNumber);
+    return PLUS_FAIL;
+  }
+  if ( PlusVideoFrame::GetOrientedImage(&(this->FramePixelsReadBuffer[0]), this->ImageOrientationInFile, this->ImageType, this->PixelType, this->NumberOfScalarComponents, this->Dimensions, this->ImageOrientationInMemory, frame) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to get oriented image from sequence metafile (frame number: " << frameNumber << ")!"); 
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkMetaImageSequenceIO::CloseFramePixelsReadStream()
+{
+  if (this->DecompressionStream!=NULL)
+  {
+    inflateEnd(&this->DecompressionStream->Stream);
+    delete this->DecompressionStream;
+    this->DecompressionStream=NULL;
+  }
+  if (this->FramePixelsReadStream!=NULL)
+  {
+    fclose(this->FramePixelsReadStream);
+    this->FramePixelsReadStream=NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkMetaImageSequenceIO::ReadCompressedFramePixels(int frameNumber, unsigned int frameSizeInBytes)
+{
+  if (this->DecompressionStream!=NULL && frameNumber<this->NextDecompressedFrameNumber)
+  {
+    // The pixel data can only be uncompressed sequentially, so restart from the first frame
+    LOG_DEBUG("Restart decompression of the pixel data to read frame "<<frameNumber);
+    inflateEnd(&this->DecompressionStream->Stream);
+    delete this->DecompressionStream;
+    this->DecompressionStream=NULL;
+  }
+
+  if (this->DecompressionStream==NULL)
+  {
+    this->RemainingCompressedDataSize=0;
+    PlusCommon::StringToInt(this->TrackedFrameList->GetCustomString("CompressedDataSize"), this->RemainingCompressedDataSize);
+    FSEEK(this->FramePixelsReadStream, this->PixelDataFileOffset, SEEK_SET);
+
+    this->DecompressionStream=new ZlibStream;
+    z_stream* strm=&this->DecompressionStream->Stream;
+    // use the default memory allocation routines
+    strm->zalloc = Z_NULL;
+    strm->zfree = Z_NULL;
+    strm->opaque = Z_NULL;
+    strm->next_in = Z_NULL;
+    strm->avail_in = 0;
+    int ret=inflateInit(strm);
+    if (ret!=Z_OK)
+    {
+      LOG_ERROR("Image decompression initialization failed (errorCode="<<ret<<")");
+      delete this->DecompressionStream;
+      this->DecompressionStream=NULL;
+      return PLUS_FAIL;
+    }
+    this->NextDecompressedFrameNumber=0;
+    this->CompressedPixelsReadBuffer.resize(ZLIB_BUFFER_SIZE);
+  }
+
+  z_stream* strm=&this->DecompressionStream->Stream;
+  // The frames that precede the requested frame are uncompressed into the same buffer (they are not needed)
+  while (this->NextDecompressedFrameNumber<=frameNumber)
+  {
+    strm->next_out=&(this->FramePixelsReadBuffer[0]);
+    strm->avail_out=frameSizeInBytes;
+    while (strm->avail_out>0)
+    {
+      if (strm->avail_in==0)
+      {
+        unsigned int numberOfBytesToRead=std::min<unsigned int>(ZLIB_BUFFER_SIZE, this->RemainingCompressedDataSize);
+        if (numberOfBytesToRead==0 
+          || fread(&(this->CompressedPixelsReadBuffer[0]), 1, numberOfBytesToRead, this->FramePixelsReadStream)!=numberOfBytesToRead)
+        {
+          LOG_ERROR("Cannot uncompress the pixel data of frame "<<this->NextDecompressedFrameNumber<<": unexpected end of compressed data in "<<GetPixelDataFilePath());
+          CloseFramePixelsReadStream();
+          return PLUS_FAIL;
+        }
+        this->RemainingCompressedDataSize-=numberOfBytesToRead;
+        strm->next_in=&(this->CompressedPixelsReadBuffer[0]);
+        strm->avail_in=numberOfBytesToRead;
+      }
+      int ret=inflate(strm, Z_NO_FLUSH);
+      if (ret!=Z_OK && !(ret==Z_STREAM_END && strm->avail_out==0))
+      {
+        LOG_ERROR("Cannot uncompress the pixel data of frame "<<this->NextDecompressedFrameNumber<<" (errorCode="<<ret<<")");
+        CloseFramePixelsReadStream();
+        return PLUS_FAIL;
+      }
+    }
+    this->NextDecompressedFrameNumber++;
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 /** Writes the spacing and dimentions of the image.
 * Assumes SetFileName has been called with a valid file name. */
@@ -653,7 +858,7 @@ PlusStatus vtkMetaImageSequenceIO::OpenImageHeader()
   std::ostringstream dimSizeStr; 
   this->Dimensions[0]=frameSize[0];
   this->Dimensions[1]=frameSize[1];
-  this->Dimensions[2]=this->TrackedFrameList->GetNumberOfTrackedFrames();
+  this->Dimensions[2]=(this->NumberOfFramesToWrite>0) ? this->NumberOfFramesToWrite : this->TrackedFrameList->GetNumberOfTrackedFrames();
   dimSizeStr << this->Dimensions[0] << " " << this->Dimensions[1] << " " << this->Dimensions[2];
   dimSizeStr << "                              ";  // add spaces so that later the field can be updated with larger values
   SetCustomString("DimSize", dimSizeStr.str().c_str());  
@@ -844,8 +1049,8 @@ PlusStatus vtkMetaImageSequenceIO::WriteImagePixels(const std::string& aFilename
   }
   else if( forceAppend && GetUseCompression())
   {
-    LOG_ERROR("Unable to append images when compression is used. You must write uncompressed and then post-compress.");
-    return PLUS_FAIL;
+    // The compressed data is appended to the data that was written by the previous AppendImages calls
+    fileOpenMode=(this->CompressionStream!=NULL) ? "ab+" : "wb";
   }
   if ( FileOpen( &stream, aFilename.c_str(), fileOpenMode.c_str() ) != PLUS_SUCCESS )
   {
@@ -894,14 +1099,26 @@ PlusStatus vtkMetaImageSequenceIO::WriteImagePixels(const std::string& aFilename
   {
     // compressed
     int compressedDataSize=0;
-    result = WriteCompressedImagePixelsToFile(stream, compressedDataSize);
-    if( result == PLUS_SUCCESS )
+    if (forceAppend)
+    {
+      // CompressedDataSize is set when the compression is finished
+      result = AppendCompressedImagePixelsToFile(stream, compressedDataSize);
+      if( result == PLUS_SUCCESS )
+      {
+        m_TotalBytesWritten += compressedDataSize;
+      }
+    }
+    else
     {
-      m_TotalBytesWritten += compressedDataSize;
+      result = WriteCompressedImagePixelsToFile(stream, compressedDataSize);
+      if( result == PLUS_SUCCESS )
+      {
+        m_TotalBytesWritten += compressedDataSize;
+      }
+      std::ostringstream compressedDataSizeStr; 
+      compressedDataSizeStr << compressedDataSize; 
+      SetCustomString("CompressedDataSize", compressedDataSizeStr.str().c_str());
     }
-    std::ostringstream compressedDataSizeStr; 
-    compressedDataSizeStr << compressedDataSize; 
-    SetCustomString("CompressedDataSize", compressedDataSizeStr.str().c_str());
   }
 
   fclose(stream);
@@ -1015,6 +1232,139 @@ PlusStatus vtkMetaImageSequenceIO::WriteCompressedImagePixelsToFile(FILE *output
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+// Run deflate() until the output buffer is not full and write the compressed data into the file
+static PlusStatus DeflateIntoFile(z_stream* strm, int flush, FILE *outputFileStream, int &compressedDataSize)
+{
+  unsigned char outputBuffer[ZLIB_BUFFER_SIZE];
+  do 
+  {
+    strm->avail_out = ZLIB_BUFFER_SIZE;
+    strm->next_out = outputBuffer;
+
+    int ret = deflate(strm, flush);
+    if (ret == Z_STREAM_ERROR)
+    {
+      // state clobbered
+      LOG_ERROR("Zlib state became invalid during the compression process (errorCode="<<ret<<")");
+      return PLUS_FAIL;
+    }
+
+    size_t numberOfBytesReadyForWriting = ZLIB_BUFFER_SIZE - strm->avail_out;
+    if (fwrite(outputBuffer, 1, numberOfBytesReadyForWriting, outputFileStream) != numberOfBytesReadyForWriting || ferror(outputFileStream))
+    {        
+      LOG_ERROR("Error writing compressed data into file");
+      return PLUS_FAIL;
+    }
+    compressedDataSize+=numberOfBytesReadyForWriting;
+
+  } while (strm->avail_out == 0);
+
+  if (strm->avail_in != 0)
+  {
+    // state clobbered (by now all input should have been consumed)
+    LOG_ERROR("Zlib state became invalid during the compression process");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkMetaImageSequenceIO::AppendCompressedImagePixelsToFile(FILE *outputFileStream, int &compressedDataSize)
+{
+  compressedDataSize=0;
+
+  if (this->CompressionStream==NULL)
+  {
+    this->CompressionStream=new ZlibStream;
+    z_stream* strm=&this->CompressionStream->Stream;
+    // use the default memory allocation routines
+    strm->zalloc = Z_NULL;
+    strm->zfree = Z_NULL;
+    strm->opaque = Z_NULL;
+    int ret=deflateInit(strm, Z_DEFAULT_COMPRESSION);
+    if (ret!=Z_OK)
+    {
+      LOG_ERROR("Image compression initialization failed (errorCode="<<ret<<")");
+      delete this->CompressionStream;
+      this->CompressionStream=NULL;
+      return PLUS_FAIL;
+    }
+    this->AppendedCompressedDataSize=0;
+  }
+  z_stream* strm=&this->CompressionStream->Stream;
+
+  // Create a blank frame if we have to write an invalid frame to metafile 
+  PlusVideoFrame blankFrame; 
+  if ( blankFrame.AllocateFrame(this->Dimensions, this->PixelType, this->NumberOfScalarComponents)!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate space for blank image."); 
+    return PLUS_FAIL; 
+  }
+  blankFrame.FillBlank(); 
+
+  for (unsigned int frameNumber=0; frameNumber<this->TrackedFrameList->GetNumberOfTrackedFrames(); frameNumber++)
+  {
+    TrackedFrame* trackedFrame=this->TrackedFrameList->GetTrackedFrame(frameNumber);
+    PlusVideoFrame* videoFrame = &blankFrame; 
+    if ( trackedFrame->GetImageData()->IsImageValid() ) 
+    {
+      videoFrame = trackedFrame->GetImageData(); 
+    }
+
+    strm->next_in=(Bytef*)videoFrame->GetScalarPointer();
+    strm->avail_in=videoFrame->GetFrameSizeInBytes();
+    // The stream is finished by FinishCompressedImagePixels, because here it is not known which frame is the last one
+    if (DeflateIntoFile(strm, Z_NO_FLUSH, outputFileStream, compressedDataSize)!=PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+
+  this->AppendedCompressedDataSize+=compressedDataSize;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkMetaImageSequenceIO::FinishCompressedImagePixels()
+{
+  if (this->CompressionStream==NULL)
+  {
+    return PLUS_SUCCESS;
+  }
+  z_stream* strm=&this->CompressionStream->Stream;
+
+  PlusStatus result=PLUS_SUCCESS;
+  FILE *stream=NULL;
+  if ( FileOpen( &stream, this->TempImageFileName.c_str(), "ab+" ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("The file " << this->TempImageFileName << " could not be opened for writing");
+    result=PLUS_FAIL;
+  }
+  else
+  {
+    int compressedDataSize=0;
+    strm->next_in=Z_NULL;
+    strm->avail_in=0;
+    if (DeflateIntoFile(strm, Z_FINISH, stream, compressedDataSize)!=PLUS_SUCCESS)
+    {
+      result=PLUS_FAIL;
+    }
+    fclose(stream);
+    this->AppendedCompressedDataSize+=compressedDataSize;
+    m_TotalBytesWritten += compressedDataSize;
+  }
+
+  deflateEnd(strm);
+  delete this->CompressionStream;
+  this->CompressionStream=NULL;
+
+  std::ostringstream compressedDataSizeStr; 
+  compressedDataSizeStr << this->AppendedCompressedDataSize; 
+  SetCustomString("CompressedDataSize", compressedDataSizeStr.str().c_str());
+  return result;
+}
+
 //----------------------------------------------------------------------------
 TrackedFrame* vtkMetaImageSequenceIO::GetTrackedFrame(int frameNumber)
 {
@@ -1366,12 +1716,6 @@ PlusStatus vtkMetaImageSequenceIO::WriteImages()
 //----------------------------------------------------------------------------
 PlusStatus vtkMetaImageSequenceIO::AppendImages()
 {
-  if( UseCompression )
-  {
-    LOG_ERROR("Unable to append images if compression is selected.");
-    return PLUS_FAIL;
-  }
-
   if (WriteImagePixels(this->TempImageFileName, true) != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
@@ -1386,6 +1730,10 @@ PlusStatus vtkMetaImageSequenceIO::Close()
   // Update fields that are known only at the end of the processing
   if (GetUseCompression())
   {
+    if (FinishCompressedImagePixels()!=PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
     if (UpdateFieldInImageHeader("CompressedDataSize")!=PLUS_SUCCESS)
     {
       return PLUS_FAIL;
@@ -18,6 +18,7 @@
 
 #include "itkImageIOBase.h"
 #include "vtkMatrix4x4.h"
+#include <vector>
 
 class vtkTrackedFrameList;
 class TrackedFrame;
@@ -64,6 +65,28 @@ public:
   /*! Read file contents into the object */
   virtual PlusStatus Read();
 
+  /*!
+    Read only the header of the file: the general fields and the frame fields (timestamps, transforms, etc.)
+    of all the frames are read into the tracked frame list, but the pixel data is not read.
+    The pixel data of individual frames can be read later by calling ReadFramePixels.
+  */
+  virtual PlusStatus ReadHeader();
+
+  /*!
+    Read the pixel data of a single frame. ReadHeader() must be called before this method.
+    The pixel data file remains open (so that subsequent frames can be read quickly) until the
+    header is read again or the object is deleted.
+    Compressed pixel data is uncompressed sequentially, therefore compressed frames shall be read in increasing
+    frame number order (reading an earlier frame restarts the decompression from the first frame).
+  */
+  virtual PlusStatus ReadFramePixels(int frameNumber, PlusVideoFrame &frame);
+
+  /*!
+    Returns true if the pixel data of individual frames can be read by ReadFramePixels in any order
+    without uncompressing all the preceding frames (the pixel data is not compressed)
+  */
+  virtual bool CanReadFramePixels();
+
   /*! Prepare the sequence for writing */
   virtual PlusStatus PrepareHeader();
 
@@ -76,7 +99,10 @@ public:
   /*! Write images to disc, compression allowed */
   virtual PlusStatus WriteImages();
 
-  /*! Append image data to the sequence, compression not allowed */
+  /*!
+    Append image data to the sequence. If compression is enabled then the compression stream
+    is kept open between the calls and finished when the sequence is closed.
+  */
   virtual PlusStatus AppendImages();
 
   /*! Close the sequence */
@@ -107,6 +133,16 @@ public:
   /*! Return the dimensions of the sequence */
   vtkGetMacro(Dimensions, int*);
 
+  /*!
+    Set the total number of frames that will be written into the sequence. It is needed if the frames are
+    written in multiple parts (PrepareHeader is called with only the first part of the frames in the tracked frame list),
+    so that the final number of frames can be stored in the header. If 0 (default) then the number of frames
+    in the tracked frame list is used.
+  */
+  vtkSetMacro(NumberOfFramesToWrite, int);
+  /*! Get the total number of frames that will be written into the sequence */
+  vtkGetMacro(NumberOfFramesToWrite, int);
+
 protected:
   vtkMetaImageSequenceIO();
   virtual ~vtkMetaImageSequenceIO();
@@ -162,10 +198,30 @@ protected:
   */
   virtual PlusStatus WriteCompressedImagePixelsToFile(FILE *outputFileStream, int &compressedDataSize);
 
+  /*!
+    Compresses the pixel data of the frames in the tracked frame list and appends it to the file.
+    The compression stream is kept open, so that the pixel data of more frames can be appended later.
+    \param outputFileStream the file stream where the compressed pixel data will be written to
+    \param compressedDataSize returns the size of the compressed data that is written to the file in this call.
+  */
+  virtual PlusStatus AppendCompressedImagePixelsToFile(FILE *outputFileStream, int &compressedDataSize);
+
+  /*! Finish the compression stream that was opened by AppendCompressedImagePixelsToFile and write the remaining compressed data into the image file */
+  PlusStatus FinishCompressedImagePixels();
+
+  /*! Uncompress the pixel data until the requested frame is uncompressed into FramePixelsReadBuffer */
+  PlusStatus ReadCompressedFramePixels(int frameNumber, unsigned int frameSizeInBytes);
+
   /*! Copy from file A to B */
   virtual PlusStatus MoveDataInFiles(const std::string& sourceFilename, const std::string& destFilename, bool append);
+
+  /*! Close the pixel data file that was opened by ReadFramePixels */
+  void CloseFramePixelsReadStream();
 private:
 
+  /*! zlib stream state (defined in the implementation file, so that zlib is not needed for including this header) */
+  struct ZlibStream;
+
 #ifdef _WIN32
   typedef __int64 FilePositionOffsetType;
 #elif defined __APPLE__
@@ -220,6 +276,28 @@ private:
   FilePositionOffsetType PixelDataFileOffset;
   /*! File name where the pixel data is stored */
   std::string PixelDataFileName;
+
+  /*! Pixel data file opened by ReadFramePixels, NULL if the file is not open */
+  FILE* FramePixelsReadStream;
+  /*! Buffer for reading the pixel data of a single frame (reused for all the frames) */
+  std::vector<unsigned char> FramePixelsReadBuffer;
+
+  /*! Decompression state of the compressed pixel data read by ReadFramePixels, NULL if decompression is not in progress */
+  ZlibStream* DecompressionStream;
+  /*! Number of the frame that is uncompressed next by ReadFramePixels */
+  int NextDecompressedFrameNumber;
+  /*! Number of compressed pixel data bytes that have not been read from the file yet */
+  unsigned int RemainingCompressedDataSize;
+  /*! Buffer for reading the compressed pixel data in chunks */
+  std::vector<unsigned char> CompressedPixelsReadBuffer;
+
+  /*! Compression state of the pixel data written by AppendImages, NULL if no compressed data is appended */
+  ZlibStream* CompressionStream;
+  /*! Size of the compressed pixel data that has been appended so far */
+  int AppendedCompressedDataSize;
+
+  /*! Total number of frames that will be written (0 if all the frames are in the tracked frame list) */
+  int NumberOfFramesToWrite;
   
   vtkMetaImageSequenceIO(const vtkMetaImageSequenceIO&); //purposely not implemented
   void operator=(const vtkMetaImageSequenceIO&); //purposely not implemented
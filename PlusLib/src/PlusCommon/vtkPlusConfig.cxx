@@ -245,6 +245,13 @@ PlusStatus vtkPlusConfig::LoadApplicationConfiguration()
     saveNeeded = true;
   }
 
+  // Read asynchronous logging (optional, disabled by default)
+  const char* asynchronousLogging = applicationConfigurationRoot->GetAttribute("AsynchronousLogging");
+  if (asynchronousLogging != NULL)
+  {
+    vtkPlusLogger::Instance()->SetAsynchronousLogging(STRCASECMP(asynchronousLogging, "TRUE") == 0);
+  }
+
   // Read last device set config file
   const char* lastDeviceSetConfigFile = applicationConfigurationRoot->GetAttribute("LastDeviceSetConfigurationFileName");
   if ((lastDeviceSetConfigFile != NULL) && (STRCASECMP(lastDeviceSetConfigFile, "") != 0))
@@ -396,6 +403,9 @@ PlusStatus vtkPlusConfig::WriteApplicationConfiguration()
   // Save log level
   applicationConfigurationRoot->SetIntAttribute("LogLevel", vtkPlusLogger::Instance()->GetLogLevel());
 
+  // Save asynchronous logging
+  applicationConfigurationRoot->SetAttribute("AsynchronousLogging", vtkPlusLogger::Instance()->GetAsynchronousLogging() ? "TRUE" : "FALSE");
+
   // Save device set directory
   applicationConfigurationRoot->SetAttribute("DeviceSetConfigurationDirectory", this->DeviceSetConfigurationDirectory.c_str());
 
@@ -12,6 +12,7 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "vtkCommand.h"
+#include "vtkMultiThreader.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusLogger.h"
 #include "vtkRecursiveCriticalSection.h"
@@ -23,6 +24,18 @@ See License.txt for details.
 
 vtkPlusLogger* vtkPlusLogger::m_pInstance = NULL;
 
+// Maximum number of messages waiting to be written. If the queue is full then messages are dropped.
+static const unsigned int MAX_NUMBER_OF_QUEUED_MESSAGES = 10000;
+
+// A repeated message is logged at most once in this period
+static const double REPEATED_MESSAGE_SUPPRESSION_PERIOD_SEC = 1.0;
+
+// The writer thread waits this much if there are no messages in the queue
+static const double WRITER_THREAD_IDLE_DELAY_SEC = 0.005;
+
+// Maximum time to wait for the writer thread to stop at process exit
+static const double WRITER_THREAD_STOP_TIMEOUT_SEC = 1.0;
+
 //-----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusLoggerOutputWindow);
@@ -132,9 +145,22 @@ void vtkPlusLoggerOutputWindow::PrintSelf(ostream& os, vtkIndent indent)
 vtkPlusLogger::vtkPlusLogger()
 {
   m_CriticalSection = vtkRecursiveCriticalSection::New();
+  m_QueueCriticalSection = vtkRecursiveCriticalSection::New();
 
   m_LogLevel = LOG_LEVEL_INFO;
 
+  m_NumberOfDroppedMessages = 0;
+  m_LastMessageLineNumber = 0;
+  m_LastMessageLevel = LOG_LEVEL_UNDEFINED;
+  m_LastMessageTime = 0;
+  m_NumberOfSuppressedRepetitions = 0;
+  m_WritingQueuedMessages = false;
+
+  m_Threader = vtkMultiThreader::New();
+  m_WriterThreadId = -1;
+  m_WriterThreadAlive = false;
+  m_WriterThreadStopRequested = false;
+
   // redirect VTK error logs to the Plus logger
   vtkSmartPointer<vtkPlusLoggerOutputWindow> vtkLogger = vtkSmartPointer<vtkPlusLoggerOutputWindow>::New();
   vtkOutputWindow::SetInstance(vtkLogger);
@@ -145,9 +171,23 @@ vtkPlusLogger::vtkPlusLogger()
 //-------------------------------------------------------
 vtkPlusLogger::~vtkPlusLogger()
 {
+  SetAsynchronousLogging(false);
+
   // Disconnect VTK error logging from the Plus logger (restore default VTK logging)
   vtkOutputWindow::SetInstance(NULL);
 
+  if ( this->m_Threader != NULL )
+  {
+    this->m_Threader->Delete();
+    this->m_Threader = NULL;
+  }
+
+  if ( this->m_QueueCriticalSection != NULL ) 
+  {
+    this->m_QueueCriticalSection->Delete(); 
+    this->m_QueueCriticalSection = NULL; 
+  } 
+
   if ( this->m_CriticalSection != NULL ) 
   {
     this->m_CriticalSection->Delete(); 
@@ -172,6 +212,8 @@ vtkPlusLogger* vtkPlusLogger::Instance()
     }
 
     m_pInstance = new vtkPlusLogger; 
+    // make sure all the messages are written before the process exits (if asynchronous logging is enabled later)
+    atexit(vtkPlusLogger::StopWriterThreadAtExit);
     vtkPlusConfig::GetInstance(); // set the log file name from the XML config
     std::string strPlusLibVersion = std::string(" Software version: ") + 
       PlusCommon::GetPlusLibVersionString(); 
@@ -247,6 +289,43 @@ void vtkPlusLogger::LogMessage(LogLevelType level, const char *msg, const char*
     return;
   }
 
+  double currentTime = vtkAccurateTimer::GetSystemTime(); 
+
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> queueGuard(this->m_QueueCriticalSection);
+    if (SuppressRepeatedMessage(level, msg, fileName, lineNumber, currentTime))
+    {
+      return;
+    }
+  }
+
+  // Format the message before locking the queue to keep the time while the queue is locked as short as possible
+  LogRecord record;
+  FormatLogRecord(level, msg, fileName, lineNumber, currentTime, record);
+
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> queueGuard(this->m_QueueCriticalSection);
+    if (this->m_QueuedRecords.size() < MAX_NUMBER_OF_QUEUED_MESSAGES)
+    {
+      this->m_QueuedRecords.push_back(record);
+    }
+    else
+    {
+      this->m_NumberOfDroppedMessages++;
+    }
+  }
+
+  if (!this->m_WriterThreadAlive || level <= LOG_LEVEL_WARNING)
+  {
+    // synchronous logging, write the message immediately
+    // errors and warnings are always written immediately, so that they are not lost if the process crashes
+    WriteQueuedMessages();
+  }
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::FormatLogRecord(int level, const char *msg, const char* fileName, int lineNumber, double currentTime, LogRecord &record)
+{
   std::string timestamp = vtkAccurateTimer::GetInstance()->GetDateAndTimeMSecString();
 
   std::ostringstream log; 
@@ -273,7 +352,6 @@ void vtkPlusLogger::LogMessage(LogLevelType level, const char *msg, const char*
   }
 
   // Add timestamp to the log message
-  double currentTime = vtkAccurateTimer::GetSystemTime(); 
   log << "|" << std::fixed << std::setw(10) << std::right << std::setfill('0') << currentTime; 
 
   log << "|" << msg;
@@ -283,77 +361,254 @@ void vtkPlusLogger::LogMessage(LogLevelType level, const char *msg, const char*
     log << "|in " << fileName << "(" << lineNumber << ")"; // add filename and line number
   }
 
+  record.Level = level;
+  record.DisplayText = log.str();
+
+  std::ostringstream fileLog;
+  fileLog << std::setw(17) << std::left << timestamp << record.DisplayText;
+  if ( !displayLineNumberAndFile )
   {
-    PlusLockGuard<vtkRecursiveCriticalSection> critSectionGuard(this->m_CriticalSection);
+    // filename and line number was skipped from displayed message, so add it to the log
+    fileLog << "|in " << fileName << "(" << lineNumber << ")";
+  }
+  record.FileText = fileLog.str();
+}
+
+//-------------------------------------------------------
+bool vtkPlusLogger::SuppressRepeatedMessage(int level, const char *msg, const char* fileName, int lineNumber, double currentTime)
+{
+  if ( level == m_LastMessageLevel && lineNumber == m_LastMessageLineNumber
+    && currentTime - m_LastMessageTime < REPEATED_MESSAGE_SUPPRESSION_PERIOD_SEC
+    && m_LastMessage.compare(msg) == 0 && m_LastMessageFileName.compare(fileName) == 0 )
+  {
+    m_NumberOfSuppressedRepetitions++;
+    return true;
+  }
+
+  QueueRepeatedMessageSummary(currentTime);
 
-    if (m_LogLevel >= level)
-    { 
+  m_LastMessage = msg;
+  m_LastMessageFileName = fileName;
+  m_LastMessageLineNumber = lineNumber;
+  m_LastMessageLevel = level;
+  m_LastMessageTime = currentTime;
+  return false;
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::QueueRepeatedMessageSummary(double currentTime)
+{
+  if (m_NumberOfSuppressedRepetitions <= 0)
+  {
+    return;
+  }
+  std::ostringstream msg;
+  msg << " Previous message was repeated " << m_NumberOfSuppressedRepetitions << " times";
+  LogRecord record;
+  FormatLogRecord(m_LastMessageLevel, msg.str().c_str(), m_LastMessageFileName.c_str(), m_LastMessageLineNumber, currentTime, record);
+  this->m_QueuedRecords.push_back(record);
+  m_NumberOfSuppressedRepetitions = 0;
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::WriteLogRecord(const LogRecord &record)
+{
+  int level = record.Level;
+  if (m_LogLevel < level)
+  {
+    return;
+  }
 
 #ifdef _WIN32
 
-      // Set the text color to highlight error and warning messages (supported only on windows)
-      switch (level)
-      {
-      case LOG_LEVEL_ERROR:  
-        {
-          HANDLE hStdout = GetStdHandle(STD_ERROR_HANDLE); 
-          SetConsoleTextAttribute(hStdout, FOREGROUND_RED|FOREGROUND_INTENSITY);
-        }
-        break;
-      case LOG_LEVEL_WARNING:
-        {
-          HANDLE hStdout = GetStdHandle(STD_ERROR_HANDLE); 
-          SetConsoleTextAttribute(hStdout, FOREGROUND_RED|FOREGROUND_GREEN|FOREGROUND_INTENSITY);
-        }
-        break;
-      default:
-        {
-          HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE); 
-          SetConsoleTextAttribute(hStdout, FOREGROUND_RED|FOREGROUND_GREEN|FOREGROUND_BLUE);
-        }
-        break;
-      }    
+  // Set the text color to highlight error and warning messages (supported only on windows)
+  switch (level)
+  {
+  case LOG_LEVEL_ERROR:  
+    {
+      HANDLE hStdout = GetStdHandle(STD_ERROR_HANDLE); 
+      SetConsoleTextAttribute(hStdout, FOREGROUND_RED|FOREGROUND_INTENSITY);
+    }
+    break;
+  case LOG_LEVEL_WARNING:
+    {
+      HANDLE hStdout = GetStdHandle(STD_ERROR_HANDLE); 
+      SetConsoleTextAttribute(hStdout, FOREGROUND_RED|FOREGROUND_GREEN|FOREGROUND_INTENSITY);
+    }
+    break;
+  default:
+    {
+      HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE); 
+      SetConsoleTextAttribute(hStdout, FOREGROUND_RED|FOREGROUND_GREEN|FOREGROUND_BLUE);
+    }
+    break;
+  }    
 #endif
 
-      if (level>LOG_LEVEL_WARNING)
-      {
-        std::cout << log.str() << std::endl; 
-      }
-      else
-      {
-        std::cerr << log.str() << std::endl; 
-      }
+  if (level>LOG_LEVEL_WARNING)
+  {
+    // std::cout is flushed after all the queued messages are written
+    std::cout << record.DisplayText << "\n"; 
+  }
+  else
+  {
+    std::cerr << record.DisplayText << std::endl; 
+  }
 
 #ifdef _WIN32
-      // Revert the text color (supported only on windows)
-      if (level==LOG_LEVEL_ERROR || level==LOG_LEVEL_WARNING)
-      {
-        HANDLE hStdout = GetStdHandle(STD_ERROR_HANDLE); 
-        SetConsoleTextAttribute(hStdout, FOREGROUND_RED|FOREGROUND_GREEN|FOREGROUND_BLUE);
-      }
+  // Revert the text color (supported only on windows)
+  if (level==LOG_LEVEL_ERROR || level==LOG_LEVEL_WARNING)
+  {
+    HANDLE hStdout = GetStdHandle(STD_ERROR_HANDLE); 
+    SetConsoleTextAttribute(hStdout, FOREGROUND_RED|FOREGROUND_GREEN|FOREGROUND_BLUE);
+  }
 #endif
 
-      // Call display message callbacks if higher priority than trace
-      if (level < LOG_LEVEL_TRACE)
-      {
-        std::ostringstream callDataStream;
-        callDataStream << level << "|" << log.str();
+  // Call display message callbacks if higher priority than trace
+  if (level < LOG_LEVEL_TRACE)
+  {
+    std::ostringstream callDataStream;
+    callDataStream << level << "|" << record.DisplayText;
 
-        InvokeEvent(vtkCommand::UserEvent, (void*)(callDataStream.str().c_str()));      
-      }
+    InvokeEvent(vtkCommand::UserEvent, (void*)(callDataStream.str().c_str()));      
+  }
+
+  // Add to log stream (file)
+  this->m_LogStream << record.FileText << std::endl; 
+}
 
-      // Add to log stream (file)
-      this->m_LogStream << std::setw(17) << std::left << timestamp << log.str();
-      if ( !displayLineNumberAndFile )
+//-------------------------------------------------------
+void vtkPlusLogger::WriteQueuedMessages()
+{
+  // Lock m_CriticalSection before getting the messages from the queue to make sure that
+  // the messages are written in the same order as they were added to the queue
+  PlusLockGuard<vtkRecursiveCriticalSection> critSectionGuard(this->m_CriticalSection);
+
+  if (this->m_WritingQueuedMessages)
+  {
+    // Called from a log message observer while the messages are written in this thread.
+    // The message stays in the queue and it is written by the outer call.
+    return;
+  }
+  this->m_WritingQueuedMessages = true;
+
+  bool messagesWritten = false;
+  while (true)
+  {
+    int numberOfDroppedMessages = 0;
+    {
+      PlusLockGuard<vtkRecursiveCriticalSection> queueGuard(this->m_QueueCriticalSection);
+      if ( m_NumberOfSuppressedRepetitions > 0
+        && vtkAccurateTimer::GetSystemTime() - m_LastMessageTime >= REPEATED_MESSAGE_SUPPRESSION_PERIOD_SEC )
       {
-        // filename and line number was skipped from displayed message, so add it to the log
-        this->m_LogStream << "|in " << fileName << "(" << lineNumber << ")";
+        // the message is not repeated anymore, so report the number of repetitions now
+        QueueRepeatedMessageSummary(vtkAccurateTimer::GetSystemTime());
+        m_LastMessage.clear();
+        m_LastMessageLevel = LOG_LEVEL_UNDEFINED;
       }
-      this->m_LogStream << std::endl; 
+      if (this->m_QueuedRecords.empty() && this->m_NumberOfDroppedMessages == 0)
+      {
+        break;
+      }
+      // swap the buffers, so that messages can be added to the queue while the messages are written
+      this->m_WrittenRecords.swap(this->m_QueuedRecords);
+      numberOfDroppedMessages = this->m_NumberOfDroppedMessages;
+      this->m_NumberOfDroppedMessages = 0;
+    }
+
+    // Observers may log messages while the records are written, these are added to the queue
+    // and written in the next iteration
+    for (std::vector<LogRecord>::iterator recordIt = this->m_WrittenRecords.begin(); recordIt != this->m_WrittenRecords.end(); ++recordIt)
+    {
+      WriteLogRecord(*recordIt);
+    }
+    // keep the allocated memory, it will be reused at the next swap
+    this->m_WrittenRecords.clear();
+
+    if (numberOfDroppedMessages > 0)
+    {
+      std::ostringstream msg;
+      msg << " " << numberOfDroppedMessages << " log messages were dropped because the log message queue was full";
+      LogRecord record;
+      FormatLogRecord(LOG_LEVEL_WARNING, msg.str().c_str(), __FILE__, __LINE__, vtkAccurateTimer::GetSystemTime(), record);
+      WriteLogRecord(record);
     }
+    messagesWritten = true;
   }
 
-  this->Flush();
+  if (messagesWritten)
+  {
+    std::cout.flush();
+    this->Flush();
+  }
+  this->m_WritingQueuedMessages = false;
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::SetAsynchronousLogging(bool enable)
+{
+  if (enable == this->m_WriterThreadAlive)
+  {
+    // no change
+    return;
+  }
+  if (enable)
+  {
+    this->m_WriterThreadStopRequested = false;
+    this->m_WriterThreadAlive = true;
+    this->m_WriterThreadId = this->m_Threader->SpawnThread((vtkThreadFunctionType)&WriterThread, this);
+  }
+  else
+  {
+    this->m_WriterThreadStopRequested = true;
+    while ( this->m_WriterThreadAlive )
+    {
+      vtkAccurateTimer::Delay(WRITER_THREAD_IDLE_DELAY_SEC);
+    }
+    this->m_WriterThreadId = -1;
+    // write the messages that were added to the queue while the writer thread was stopping
+    WriteQueuedMessages();
+  }
+}
+
+//-------------------------------------------------------
+bool vtkPlusLogger::GetAsynchronousLogging()
+{
+  return this->m_WriterThreadAlive;
+}
+
+//-------------------------------------------------------
+void* vtkPlusLogger::WriterThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusLogger *self = (vtkPlusLogger *)(data->UserData);
+
+  while ( !self->m_WriterThreadStopRequested )
+  {
+    self->WriteQueuedMessages();
+    vtkAccurateTimer::Delay(WRITER_THREAD_IDLE_DELAY_SEC);
+  }
+  self->WriteQueuedMessages();
+
+  self->m_WriterThreadAlive = false;
+  return NULL;
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::StopWriterThreadAtExit()
+{
+  if (m_pInstance == NULL)
+  {
+    return;
+  }
+  // The writer thread may have been already terminated by the operating system (e.g., when the
+  // logger is in a shared library on Windows), therefore only wait for a limited time for the thread to stop.
+  m_pInstance->m_WriterThreadStopRequested = true;
+  double startTime = vtkAccurateTimer::GetSystemTime();
+  while ( m_pInstance->m_WriterThreadAlive && vtkAccurateTimer::GetSystemTime() - startTime < WRITER_THREAD_STOP_TIMEOUT_SEC )
+  {
+    vtkAccurateTimer::Delay(WRITER_THREAD_IDLE_DELAY_SEC);
+  }
+  m_pInstance->WriteQueuedMessages();
 }
 
 //-------------------------------------------------------
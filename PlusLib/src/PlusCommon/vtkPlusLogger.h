@@ -8,9 +8,12 @@
 #define __PLUSLOGGER_H
 
 #include "vtkObject.h"
+#include "vtkMultiThreader.h"
 
 #include <fstream>
 #include <sstream>
+#include <string>
+#include <vector>
 
 class vtkRecursiveCriticalSection;
 
@@ -77,6 +80,15 @@ private:
   \class vtkPlusLogger
   \brief This singleton class provides logging into file and/or the console
   with adjustable verbosity.
+
+  Messages can be logged asynchronously (see SetAsynchronousLogging): the logging thread only formats the message
+  and adds it to a queue, the console and file output is performed by a background writer thread.
+  This way a burst of log messages in a device thread does not stall the data acquisition.
+  Errors and warnings are always written immediately.
+  Repeated messages (same text, level, and location) are logged at most once per second;
+  the number of suppressed repetitions is logged when the repetition stops.
+  If the queue is full then further messages are dropped (and the number of dropped messages is logged).
+
   \ingroup PlusLibCommon
 */
 class VTK_EXPORT vtkPlusLogger : public vtkObject
@@ -150,13 +162,62 @@ public:
   /*! Get the name of the file where the messages are logged to */
   std::string GetLogFileName(); 
 
+  /*!
+    Enable/disable asynchronous logging. If enabled then messages are written to the console and file
+    by a background thread. If disabled then messages are written immediately, in the thread that logs the message.
+    Errors and warnings are always written immediately. Disabled by default.
+    All the queued messages are written before this method returns.
+  */
+  void SetAsynchronousLogging(bool enable);
+  /*! Returns true if messages are written asynchronously, by a background thread */
+  bool GetAsynchronousLogging();
+
+  /*! Write all the queued messages to the console and the log file. Can be called from any thread. */
+  void WriteQueuedMessages();
+
 protected:
   vtkPlusLogger(); 
   ~vtkPlusLogger();
 
+  /*! A formatted log message that is ready to be written */
+  struct LogRecord
+  {
+    /*! Log level of the message */
+    int Level;
+    /*! Text that is displayed on the console */
+    std::string DisplayText;
+    /*! Text that is written to the log file */
+    std::string FileText;
+  };
+
+  /*! Create a log record from a message */
+  void FormatLogRecord(int level, const char *msg, const char* fileName, int lineNumber, double currentTime, LogRecord &record);
+
+  /*! Write a log record to the console and the log stream. The caller must hold m_CriticalSection. */
+  void WriteLogRecord(const LogRecord &record);
+
+  /*!
+    Returns true if the message is a repetition of the previously logged message and therefore it shall not be logged.
+    If the message is not a repetition then the message is stored as the previous message.
+    The caller must hold m_QueueCriticalSection.
+  */
+  bool SuppressRepeatedMessage(int level, const char *msg, const char* fileName, int lineNumber, double currentTime);
+
+  /*!
+    If repetitions of the previous message have been suppressed then add a message to the queue that reports the number of repetitions.
+    The caller must hold m_QueueCriticalSection.
+  */
+  void QueueRepeatedMessageSummary(double currentTime);
+
   /*! Writes the messages that are cached in memory to the log file and clears the cache. */
   void Flush(); 
 
+  /*! Writer thread function, it writes the queued messages until stop is requested */
+  static void* WriterThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Write the queued messages and stop the writer thread. Called at process exit. */
+  static void StopWriterThreadAtExit();
+
 private: 
   vtkPlusLogger(vtkPlusLogger const&);
   vtkPlusLogger& operator=(vtkPlusLogger const&);
@@ -172,12 +233,44 @@ private:
   /*! Name of the log output file */
   std::string m_LogFileName; 
 
+  /*! Messages that are waiting to be written. Protected by m_QueueCriticalSection. */
+  std::vector<LogRecord> m_QueuedRecords;
+  /*! Messages that are being written (swapped with m_QueuedRecords to minimize the time while the queue is locked). Protected by m_CriticalSection. */
+  std::vector<LogRecord> m_WrittenRecords;
+  /*! Number of messages that could not be added to the queue because it was full. Protected by m_QueueCriticalSection. */
+  int m_NumberOfDroppedMessages;
+
+  /*! Previously logged message, used for suppressing repeated messages. Protected by m_QueueCriticalSection. */
+  std::string m_LastMessage;
+  std::string m_LastMessageFileName;
+  int m_LastMessageLineNumber;
+  int m_LastMessageLevel;
+  /*! Time when the previous message was logged */
+  double m_LastMessageTime;
+  /*! Number of repetitions of the previous message that have not been logged */
+  int m_NumberOfSuppressedRepetitions;
+
+  /*! True while WriteQueuedMessages is writing the messages, prevents re-entrant calls from observers. Protected by m_CriticalSection. */
+  bool m_WritingQueuedMessages;
+
+  /*! Thread that writes the queued messages */
+  vtkMultiThreader* m_Threader;
+  int m_WriterThreadId;
+  bool m_WriterThreadAlive;
+  bool m_WriterThreadStopRequested;
+
   /*! 
     Critical section that is used to serialize output of messages.\
     It is necessary because the logging object may be used in multiple
     threads simultaneously.
   */
   vtkRecursiveCriticalSection* m_CriticalSection;
+
+  /*!
+    Critical section that protects the message queue. It is only held for a short time
+    (while adding a message to the queue or swapping the queue), never during writing of the messages.
+  */
+  vtkRecursiveCriticalSection* m_QueueCriticalSection;
 };
 
 #endif
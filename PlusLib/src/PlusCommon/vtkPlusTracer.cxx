@@ -0,0 +1,385 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkAccurateTimer.h"
+#include "vtkCriticalSection.h"
+#include "vtkMultiThreader.h"
+#include "vtkPlusTracer.h"
+#include <algorithm>
+#include <float.h> // for DBL_MAX
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+//-----------------------------------------------------------------------------
+
+vtkPlusTracer* vtkPlusTracer::m_pInstance = NULL;
+bool vtkPlusTracer::Enabled = false;
+
+// Threads are assigned to slots by their ID. Threads that are assigned to the same slot share
+// the same ring buffer and lock. The number of slots is larger than the typical number of threads
+// that add events (device threads, server threads, main thread), so collisions are rare.
+static const unsigned int NUMBER_OF_THREAD_SLOTS = 16;
+
+// Number of the most recent events that are kept for each thread slot
+static const unsigned int MAX_NUMBER_OF_EVENTS_PER_THREAD_SLOT = 4096;
+
+//-----------------------------------------------------------------------------
+namespace
+{
+  vtkSimpleCriticalSection TracerCreationCriticalSection;
+
+  //-----------------------------------------------------------------------------
+  unsigned long GetCurrentThreadHash()
+  {
+    // vtkMultiThreaderIDType may be an integer or a pointer (depending on the platform), so compute the hash from its bytes
+    vtkMultiThreaderIDType threadId = vtkMultiThreader::GetCurrentThreadID();
+    const unsigned char* threadIdBytes = reinterpret_cast<const unsigned char*>(&threadId);
+    unsigned long hash = 0;
+    for (unsigned int i=0; i<sizeof(threadId); i++)
+    {
+      hash = hash*31 + threadIdBytes[i];
+    }
+    return hash;
+  }
+
+  //-----------------------------------------------------------------------------
+  // Write a string as a JSON string value (with quotes and escaped special characters)
+  void WriteJsonString(std::ostream &os, const char* str)
+  {
+    os << "\"";
+    for (const char* c=str; *c!=0; c++)
+    {
+      if (*c=='"' || *c=='\\')
+      {
+        os << "\\";
+      }
+      os << *c;
+    }
+    os << "\"";
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkPlusTracer::LatencyHistogram::LatencyHistogram()
+: Count(0)
+, SumSec(0)
+, MinSec(0)
+, MaxSec(0)
+{
+  std::fill(this->BinCounts, this->BinCounts+NUMBER_OF_HISTOGRAM_BINS, 0);
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusTracer::LatencyHistogram::AddSample(double durationSec)
+{
+  if (this->Count==0 || durationSec<this->MinSec)
+  {
+    this->MinSec=durationSec;
+  }
+  if (this->Count==0 || durationSec>this->MaxSec)
+  {
+    this->MaxSec=durationSec;
+  }
+  this->Count++;
+  this->SumSec+=durationSec;
+  int binIndex=0;
+  while (binIndex<NUMBER_OF_HISTOGRAM_BINS-1 && durationSec>=GetHistogramBinUpperLimitSec(binIndex))
+  {
+    binIndex++;
+  }
+  this->BinCounts[binIndex]++;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusTracer::LatencyHistogram::Merge(const LatencyHistogram &other)
+{
+  if (other.Count==0)
+  {
+    return;
+  }
+  if (this->Count==0 || other.MinSec<this->MinSec)
+  {
+    this->MinSec=other.MinSec;
+  }
+  if (this->Count==0 || other.MaxSec>this->MaxSec)
+  {
+    this->MaxSec=other.MaxSec;
+  }
+  this->Count+=other.Count;
+  this->SumSec+=other.SumSec;
+  for (int binIndex=0; binIndex<NUMBER_OF_HISTOGRAM_BINS; binIndex++)
+  {
+    this->BinCounts[binIndex]+=other.BinCounts[binIndex];
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkPlusTracer::vtkPlusTracer()
+{
+  for (unsigned int slotIndex=0; slotIndex<NUMBER_OF_THREAD_SLOTS; slotIndex++)
+  {
+    ThreadSlot* slot=new ThreadSlot;
+    slot->Lock=new vtkSimpleCriticalSection;
+    slot->Events.resize(MAX_NUMBER_OF_EVENTS_PER_THREAD_SLOT);
+    slot->NextEventIndex=0;
+    slot->NumberOfEvents=0;
+    this->ThreadSlots.push_back(slot);
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkPlusTracer::~vtkPlusTracer()
+{
+  for (std::vector<ThreadSlot*>::iterator slotIt=this->ThreadSlots.begin(); slotIt!=this->ThreadSlots.end(); ++slotIt)
+  {
+    delete (*slotIt)->Lock;
+    delete (*slotIt);
+  }
+  this->ThreadSlots.clear();
+}
+
+//-----------------------------------------------------------------------------
+vtkPlusTracer* vtkPlusTracer::Instance()
+{
+  if (m_pInstance == NULL)
+  {
+    PlusLockGuard<vtkSimpleCriticalSection> tracerCreationGuard(&TracerCreationCriticalSection);
+    if( m_pInstance != NULL )
+    {
+      return m_pInstance;
+    }
+    m_pInstance = new vtkPlusTracer;
+  }
+  return m_pInstance;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusTracer::SetEnabled(bool enable)
+{
+  if (enable == Enabled)
+  {
+    return;
+  }
+  if (enable)
+  {
+    Clear();
+    LOG_INFO("Tracing enabled");
+  }
+  else
+  {
+    LOG_INFO("Tracing disabled");
+  }
+  Enabled = enable;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusTracer::Clear()
+{
+  for (std::vector<ThreadSlot*>::iterator slotIt=this->ThreadSlots.begin(); slotIt!=this->ThreadSlots.end(); ++slotIt)
+  {
+    ThreadSlot* slot=(*slotIt);
+    PlusLockGuard<vtkSimpleCriticalSection> slotGuard(slot->Lock);
+    slot->NextEventIndex=0;
+    slot->NumberOfEvents=0;
+    slot->Histograms.clear();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusTracer::AddEvent(const char* stageName, BufferItemUidType frameUid, double startTimeSec, double durationSec)
+{
+  unsigned long threadHash=GetCurrentThreadHash();
+  ThreadSlot* slot=this->ThreadSlots[threadHash % NUMBER_OF_THREAD_SLOTS];
+
+  PlusLockGuard<vtkSimpleCriticalSection> slotGuard(slot->Lock);
+  TraceEvent &traceEvent=slot->Events[slot->NextEventIndex];
+  traceEvent.StageName=stageName;
+  traceEvent.FrameUid=frameUid;
+  traceEvent.StartTimeSec=startTimeSec;
+  traceEvent.DurationSec=durationSec;
+  traceEvent.ThreadId=threadHash;
+  slot->NextEventIndex=(slot->NextEventIndex+1) % MAX_NUMBER_OF_EVENTS_PER_THREAD_SLOT;
+  if (slot->NumberOfEvents<MAX_NUMBER_OF_EVENTS_PER_THREAD_SLOT)
+  {
+    slot->NumberOfEvents++;
+  }
+  slot->Histograms[stageName].AddSample(durationSec);
+}
+
+//-----------------------------------------------------------------------------
+double vtkPlusTracer::GetHistogramBinUpperLimitSec(int binIndex)
+{
+  // Bin limits: 1us, 2us, 5us, 10us, 20us, 50us, ..., 1s, 2s, 5s, 10s; the last bin contains all longer times
+  if (binIndex>=NUMBER_OF_HISTOGRAM_BINS-1)
+  {
+    return DBL_MAX;
+  }
+  static const double multipliers[3]={1.0, 2.0, 5.0};
+  double limitSec=1e-6*multipliers[binIndex%3];
+  for (int i=0; i<binIndex/3; i++)
+  {
+    limitSec*=10.0;
+  }
+  return limitSec;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusTracer::GetMergedHistograms(std::map<std::string, LatencyHistogram> &histograms)
+{
+  histograms.clear();
+  for (std::vector<ThreadSlot*>::iterator slotIt=this->ThreadSlots.begin(); slotIt!=this->ThreadSlots.end(); ++slotIt)
+  {
+    ThreadSlot* slot=(*slotIt);
+    PlusLockGuard<vtkSimpleCriticalSection> slotGuard(slot->Lock);
+    // The same stage name may be stored at different addresses (string literals in different modules), so merge by name
+    for (std::map<const char*, LatencyHistogram>::iterator histogramIt=slot->Histograms.begin(); histogramIt!=slot->Histograms.end(); ++histogramIt)
+    {
+      histograms[histogramIt->first].Merge(histogramIt->second);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusTracer::GetStatistics(std::string &statistics)
+{
+  std::map<std::string, LatencyHistogram> histograms;
+  GetMergedHistograms(histograms);
+
+  std::ostringstream os;
+  for (std::map<std::string, LatencyHistogram>::iterator histogramIt=histograms.begin(); histogramIt!=histograms.end(); ++histogramIt)
+  {
+    const LatencyHistogram &histogram=histogramIt->second;
+    if (histogram.Count==0)
+    {
+      continue;
+    }
+
+    // Percentiles are estimated by the upper limit of the histogram bin that contains them
+    double medianSec=histogram.MaxSec;
+    double percentile99Sec=histogram.MaxSec;
+    bool medianFound=false;
+    unsigned int cumulativeCount=0;
+    for (int binIndex=0; binIndex<NUMBER_OF_HISTOGRAM_BINS; binIndex++)
+    {
+      cumulativeCount+=histogram.BinCounts[binIndex];
+      double binUpperLimitSec=std::min(GetHistogramBinUpperLimitSec(binIndex), histogram.MaxSec);
+      if (!medianFound && cumulativeCount*2>=histogram.Count)
+      {
+        medianSec=binUpperLimitSec;
+        medianFound=true;
+      }
+      if (cumulativeCount*100>=histogram.Count*99)
+      {
+        percentile99Sec=binUpperLimitSec;
+        break;
+      }
+    }
+
+    os << histogramIt->first << ": count=" << histogram.Count << std::fixed << std::setprecision(1)
+      << ", mean=" << 1e6*histogram.SumSec/histogram.Count << "us"
+      << ", min=" << 1e6*histogram.MinSec << "us"
+      << ", max=" << 1e6*histogram.MaxSec << "us"
+      << ", median<=" << 1e6*medianSec << "us"
+      << ", 99%<=" << 1e6*percentile99Sec << "us"
+      << ", histogram:";
+    double binLowerLimitSec=0;
+    for (int binIndex=0; binIndex<NUMBER_OF_HISTOGRAM_BINS; binIndex++)
+    {
+      double binUpperLimitSec=GetHistogramBinUpperLimitSec(binIndex);
+      if (histogram.BinCounts[binIndex]>0)
+      {
+        os << " [" << std::setprecision(0) << 1e6*binLowerLimitSec << "-";
+        if (binIndex<NUMBER_OF_HISTOGRAM_BINS-1)
+        {
+          os << 1e6*binUpperLimitSec;
+        }
+        os << "us]=" << histogram.BinCounts[binIndex];
+      }
+      binLowerLimitSec=binUpperLimitSec;
+    }
+    os << std::endl;
+  }
+  statistics=os.str();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusTracer::WriteChromeTrace(const std::string &filename)
+{
+  // Copy the events, so that the slots are locked only for a short time
+  std::vector<TraceEvent> events;
+  for (std::vector<ThreadSlot*>::iterator slotIt=this->ThreadSlots.begin(); slotIt!=this->ThreadSlots.end(); ++slotIt)
+  {
+    ThreadSlot* slot=(*slotIt);
+    PlusLockGuard<vtkSimpleCriticalSection> slotGuard(slot->Lock);
+    // oldest event is at NextEventIndex if the ring buffer is full, at 0 otherwise
+    unsigned int eventIndex=(slot->NumberOfEvents<MAX_NUMBER_OF_EVENTS_PER_THREAD_SLOT) ? 0 : slot->NextEventIndex;
+    for (unsigned int i=0; i<slot->NumberOfEvents; i++)
+    {
+      events.push_back(slot->Events[eventIndex]);
+      eventIndex=(eventIndex+1) % MAX_NUMBER_OF_EVENTS_PER_THREAD_SLOT;
+    }
+  }
+
+  std::ofstream traceFile(filename.c_str());
+  if (!traceFile.is_open())
+  {
+    LOG_ERROR("Failed to open trace file for writing: "<<filename);
+    return PLUS_FAIL;
+  }
+
+  // Thread hashes are large numbers, replace them by small numbers for better readability
+  std::map<unsigned long, int> threadIndices;
+  traceFile << "{\"traceEvents\":[" << std::endl;
+  traceFile << std::fixed << std::setprecision(3);
+  for (std::vector<TraceEvent>::iterator eventIt=events.begin(); eventIt!=events.end(); ++eventIt)
+  {
+    std::map<unsigned long, int>::iterator threadIndexIt=threadIndices.find(eventIt->ThreadId);
+    if (threadIndexIt==threadIndices.end())
+    {
+      int threadIndex=static_cast<int>(threadIndices.size());
+      threadIndexIt=threadIndices.insert(std::make_pair(eventIt->ThreadId, threadIndex)).first;
+    }
+    if (eventIt!=events.begin())
+    {
+      traceFile << "," << std::endl;
+    }
+    traceFile << "{\"name\":";
+    WriteJsonString(traceFile, eventIt->StageName);
+    traceFile << ",\"cat\":\"Plus\",\"ph\":\"X\",\"ts\":" << 1e6*eventIt->StartTimeSec << ",\"dur\":" << 1e6*eventIt->DurationSec
+      << ",\"pid\":1,\"tid\":" << threadIndexIt->second << ",\"args\":{\"frameUid\":" << eventIt->FrameUid << "}}";
+  }
+  traceFile << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+  traceFile.close();
+
+  LOG_INFO("Saved "<<events.size()<<" trace events to "<<filename);
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusTraceScope::PlusTraceScope(const char* stageName, BufferItemUidType frameUid /*=0*/)
+: StageName(stageName)
+, FrameUid(frameUid)
+, StartTimeSec(-1)
+{
+  if (vtkPlusTracer::IsEnabled())
+  {
+    this->StartTimeSec=vtkAccurateTimer::GetSystemTime();
+  }
+}
+
+//-----------------------------------------------------------------------------
+PlusTraceScope::~PlusTraceScope()
+{
+  if (this->StartTimeSec<0)
+  {
+    // tracing was disabled when the scope started
+    return;
+  }
+  double endTimeSec=vtkAccurateTimer::GetSystemTime();
+  vtkPlusTracer::Instance()->AddEvent(this->StageName, this->FrameUid, this->StartTimeSec, endTimeSec-this->StartTimeSec);
+}
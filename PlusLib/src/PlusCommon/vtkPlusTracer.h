@@ -0,0 +1,167 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusTracer_h
+#define __vtkPlusTracer_h
+
+#include "vtkObject.h"
+#include "vtkTimestampedCircularBuffer.h" // for BufferItemUidType
+
+#include <map>
+#include <string>
+#include <vector>
+
+class vtkSimpleCriticalSection;
+
+/*!
+  \class vtkPlusTracer
+  \brief This singleton class collects timing information of the data processing stages
+  (device update, adding items to buffers, getting tracked frames, sending data to clients, etc.)
+
+  Each traced stage execution is recorded as an event (stage name, start time, duration, frame UID, thread).
+  The most recent events are stored in ring buffers and for each stage a latency histogram is accumulated.
+  Events are stored in separate ring buffers for each thread (threads are assigned to a fixed number
+  of slots, so recording an event normally does not have to wait for other threads).
+
+  Tracing is disabled by default. When tracing is disabled, the cost of a trace point is a single
+  static boolean check, so trace points can be kept in production code.
+  The recorded events can be saved in Chrome trace JSON format (open it in chrome://tracing).
+
+  Trace points are added by creating a PlusTraceScope object at the beginning of the traced code block.
+
+  \ingroup PlusLibCommon
+*/
+class VTK_EXPORT vtkPlusTracer : public vtkObject
+{
+public:
+  /*! Get a pointer to the single existing object instance */
+  static vtkPlusTracer* Instance();
+
+  /*! Returns true if tracing is enabled. This is a fast check that does not require the tracer instance to be created. */
+  static bool IsEnabled() { return Enabled; }
+
+  /*! Enable/disable tracing. When tracing is enabled all the previously recorded events and histograms are cleared. */
+  void SetEnabled(bool enable);
+
+  /*! Remove all recorded events and histograms */
+  void Clear();
+
+  /*!
+    Record the execution of a stage
+    \param stageName Name of the stage. The pointer must remain valid until tracing is enabled (typically it is a string literal).
+    \param frameUid UID of the processed frame (0 if not known)
+    \param startTimeSec System time when the stage execution started
+    \param durationSec Execution time of the stage
+  */
+  void AddEvent(const char* stageName, BufferItemUidType frameUid, double startTimeSec, double durationSec);
+
+  /*!
+    Get the latency statistics of all stages as text. Each line contains: stage name, number of executions,
+    mean, minimum, maximum, median and 99th percentile (computed from the histogram) of the execution time,
+    and the histogram (number of executions in each time range).
+  */
+  void GetStatistics(std::string &statistics);
+
+  /*! Save the recorded events into a file in Chrome trace event format (JSON) */
+  PlusStatus WriteChromeTrace(const std::string &filename);
+
+protected:
+  vtkPlusTracer();
+  virtual ~vtkPlusTracer();
+
+  /*! Number of histogram bins */
+  enum { NUMBER_OF_HISTOGRAM_BINS = 23 };
+
+  /*! Execution time statistics of a stage */
+  struct LatencyHistogram
+  {
+    LatencyHistogram();
+    void AddSample(double durationSec);
+    void Merge(const LatencyHistogram &other);
+    unsigned int Count;
+    double SumSec;
+    double MinSec;
+    double MaxSec;
+    unsigned int BinCounts[NUMBER_OF_HISTOGRAM_BINS];
+  };
+
+  /*! A recorded stage execution */
+  struct TraceEvent
+  {
+    const char* StageName;
+    BufferItemUidType FrameUid;
+    double StartTimeSec;
+    double DurationSec;
+    unsigned long ThreadId;
+  };
+
+  /*! Recorded events and histograms of the threads that are assigned to the same slot */
+  struct ThreadSlot
+  {
+    vtkSimpleCriticalSection* Lock;
+    /*! Ring buffer of the most recent events */
+    std::vector<TraceEvent> Events;
+    /*! Index of the next event to be written in the ring buffer */
+    unsigned int NextEventIndex;
+    /*! Number of valid events in the ring buffer */
+    unsigned int NumberOfEvents;
+    /*! Histograms of the stages, keyed by the stage name pointer */
+    std::map<const char*, LatencyHistogram> Histograms;
+  };
+
+  /*! Get the upper limit of a histogram bin (in seconds) */
+  static double GetHistogramBinUpperLimitSec(int binIndex);
+
+  /*! Get all the histograms, merged by stage name */
+  void GetMergedHistograms(std::map<std::string, LatencyHistogram> &histograms);
+
+private:
+  vtkPlusTracer(const vtkPlusTracer&);  // Not implemented.
+  void operator=(const vtkPlusTracer&);  // Not implemented.
+
+  /*! Pointer to the singleton instance */
+  static vtkPlusTracer* m_pInstance;
+
+  /*! Tracing is enabled */
+  static bool Enabled;
+
+  std::vector<ThreadSlot*> ThreadSlots;
+};
+
+/*!
+  \class PlusTraceScope
+  \brief Helper class for recording the execution time of a code block with vtkPlusTracer
+
+  The execution time is measured from the construction until the destruction of the object.
+  If tracing is disabled then the object does nothing.
+
+  Usage:
+  \code
+  PlusTraceScope traceScope("vtkPlusBuffer::AddItem");
+  ...
+  traceScope.SetFrameUid(itemUid);
+  \endcode
+
+  \ingroup PlusLibCommon
+*/
+class VTK_EXPORT PlusTraceScope
+{
+public:
+  /*! The stageName pointer must remain valid while tracing is enabled (typically it is a string literal) */
+  PlusTraceScope(const char* stageName, BufferItemUidType frameUid = 0);
+  ~PlusTraceScope();
+  /*! Set the UID of the processed frame, if it was not known when the scope was created */
+  void SetFrameUid(BufferItemUidType frameUid) { this->FrameUid = frameUid; }
+private:
+  PlusTraceScope(const PlusTraceScope&);  // Not implemented.
+  void operator=(const PlusTraceScope&);  // Not implemented.
+  const char* StageName;
+  BufferItemUidType FrameUid;
+  /*! Start time of the scope, negative if tracing was disabled when the scope was created */
+  double StartTimeSec;
+};
+
+#endif
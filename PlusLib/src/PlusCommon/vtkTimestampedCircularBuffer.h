@@ -185,7 +185,9 @@ public:
 
   /*!
     Given a timestamp, compute the nearest frame UID
-    This assumes that the times motonically increase
+    This assumes that the times motonically increase.
+    The items around the previously found item are checked first, so that repeated queries
+    with the same or slowly increasing time do not require a full binary search.
   */
   virtual ItemStatus GetItemUidFromTime(const double time, BufferItemUidType& uid );
 
@@ -279,7 +281,33 @@ public:
   */
   virtual BufferItemType* GetBufferItemFromUid(const BufferItemUidType uid); 
 
-  virtual PlusStatus PrepareForNewItem(const double timestamp, BufferItemUidType& newFrameUid, int& bufferIndex); 
+  /*!
+    Reserve the next buffer item for writing, without making it visible to readers.
+    The item that is about to be overwritten is removed from the buffer immediately, therefore the
+    caller may fill the returned item without holding the buffer lock. When the item is filled,
+    CommitNewItem must be called to publish it (or CancelNewItem to discard it).
+    Writers are serialized: if an item is reserved by another thread then the call waits until that item
+    is committed or canceled. Must not be called while the buffer lock is held.
+  */
+  virtual PlusStatus ReserveNewItem(const double timestamp, int& bufferIndex); 
+
+  /*!
+    Publish the item reserved by ReserveNewItem: assign a UID to it and make it available to readers.
+    Must be called (or CancelNewItem) exactly once after each successful ReserveNewItem call.
+  */
+  virtual PlusStatus CommitNewItem(BufferItemUidType& newFrameUid); 
+
+  /*! Discard the item reserved by ReserveNewItem */
+  virtual void CancelNewItem(); 
+
+  /*!
+    Wait until the item that is being written is committed or canceled and prevent reserving new items
+    until UnlockWriting is called. Used for changing the memory of the items (that the writers may access
+    without holding the buffer lock). Must be called before locking the buffer.
+  */
+  virtual void LockWriting();
+  /*! Allow reserving new items again */
+  virtual void UnlockWriting();
 
   /*!
     Create filtered and unfiltered timestamp for accurate timing of the buffer item.
@@ -326,17 +354,36 @@ protected:
   */
   virtual ItemStatus GetBufferIndex( BufferItemUidType uid, int& bufferIndex ); 
 
+  /*!
+    Get the filtered timestamp of an item without checking the item status - internal use only,
+    the buffer should be locked and the UID must be between the oldest and latest UID in the buffer
+  */
+  double GetFilteredTimeStampOfValidItem(const BufferItemUidType uid);
+
+  /*!
+    Recompute the running sums used for timestamp filtering from the values stored in the filter containers.
+    The most recently added item becomes the anchor (the anchor values are subtracted from all values before summing
+    to keep the sums small and accurate). Called periodically to prevent accumulation of rounding errors.
+  */
+  void RecomputeFilterSums();
+
   /*! Add values to the timestamp report. If reporting is not enabled then no values will be added. */
   void AddToTimeStampReport(unsigned long itemIndex, double unfilteredTimestamp, double filteredTimestamp);
 
 protected:
   vtkRecursiveCriticalSection *Mutex;
 
+  /*! Held by the writer from ReserveNewItem until CommitNewItem or CancelNewItem (always locked before Mutex) */
+  vtkRecursiveCriticalSection *WriterMutex;
+
   int NumberOfItems;
 
   /*! Next image will be written here */
   int WritePointer;
 
+  /*! True if the item at WritePointer is reserved by ReserveNewItem and is being filled */
+  bool NewItemReserved;
+
   double CurrentTimeStamp;
 
   /*! Time offset of the buffer in seconds */
@@ -347,6 +394,9 @@ protected:
     The UID is monotonously increasing for each new frame.
   */
   BufferItemUidType LatestItemUid; 
+
+  /*! The lower UID of the bracketing item pair found by the last GetItemUidFromTime call (used as a starting point of the next search) */
+  BufferItemUidType LastItemUidFromTime;
   
   std::deque<BufferItemType> BufferItemContainer; 
 
@@ -362,6 +412,20 @@ protected:
   /*! Number of valid elements in the frame index and timestamp containers (maximum can be equal to AveragedItemsForFiltering) */
   int FilterContainersNumberOfValidElements; 
 
+  /*! Frame index and timestamp values that are subtracted from the stored values before adding them to the running sums */
+  double FilterAnchorIndex;
+  double FilterAnchorTimestamp;
+  /*!
+    Running sums of the (anchor-relative) frame indexes (x) and timestamps (y) in the filter containers.
+    The line fitting for timestamp filtering is computed from these sums, so its cost does not depend on the number of averaged items.
+  */
+  double FilterSumX;
+  double FilterSumY;
+  double FilterSumXX;
+  double FilterSumXY;
+  /*! Number of items added to the running sums since they were last recomputed from the containers */
+  unsigned int FilterItemsSinceSumsRecomputed;
+
   /*! Number of averaged items used for filtering - read from config files */
   unsigned int AveragedItemsForFiltering; 
 
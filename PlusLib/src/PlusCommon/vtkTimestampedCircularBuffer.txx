@@ -17,16 +17,26 @@ vtkTimestampedCircularBuffer<BufferItemType>::vtkTimestampedCircularBuffer()
 {
   this->BufferItemContainer.resize(0); 
   this->Mutex = vtkRecursiveCriticalSection::New();
+  this->WriterMutex = vtkRecursiveCriticalSection::New();
   this->NumberOfItems = 0;
   this->WritePointer = 0;
+  this->NewItemReserved = false;
   this->CurrentTimeStamp = 0.0;
   this->LocalTimeOffsetSec = 0.0; 
   this->LatestItemUid = 0; 
+  this->LastItemUidFromTime = 0;
 
   this->FilterContainerIndexVector.set_size(0); 
   this->FilterContainerTimestampVector.set_size(0); 
   this->FilterContainersOldestIndex = 0; 
   this->FilterContainersNumberOfValidElements = 0; 
+  this->FilterAnchorIndex = 0;
+  this->FilterAnchorTimestamp = 0;
+  this->FilterSumX = 0;
+  this->FilterSumY = 0;
+  this->FilterSumXX = 0;
+  this->FilterSumXY = 0;
+  this->FilterItemsSinceSumsRecomputed = 0;
 
   this->AveragedItemsForFiltering = 20;
   this->MaxAllowedFilteringTimeDifference=0.500; // sec
@@ -53,6 +63,12 @@ vtkTimestampedCircularBuffer<BufferItemType>::~vtkTimestampedCircularBuffer()
     this->Mutex = NULL; 
   }
 
+  if ( this->WriterMutex != NULL )
+  {
+    this->WriterMutex->Delete();
+    this->WriterMutex = NULL; 
+  }
+
   if ( this->TimeStampReportTable != NULL )
   {
     this->TimeStampReportTable->Delete();
@@ -93,33 +109,112 @@ void vtkTimestampedCircularBuffer<BufferItemType>::Unlock()
 
 //----------------------------------------------------------------------------
 template<class BufferItemType>
-PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::PrepareForNewItem(const double timestamp, BufferItemUidType& newFrameUid, int& bufferIndex)
+PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::ReserveNewItem(const double timestamp, int& bufferIndex)
 {
-  if ( timestamp <= this->CurrentTimeStamp )
+  // Writers are serialized: wait until the item that is reserved by another writer is committed or canceled.
+  // The writer lock is held until this item is committed or canceled.
+  this->WriterMutex->Lock();
+
   {
-    LOG_DEBUG("Need to skip newly added frame - new timestamp ("<< std::fixed << timestamp << ") is not newer than the last one (" << this->CurrentTimeStamp << ")!"); 
-    return PLUS_FAIL; 
+    PlusLockGuard< vtkTimestampedCircularBuffer<BufferItemType> > bufferGuardedLock(this);
+
+    if ( this->NewItemReserved )
+    {
+      // The writer lock is recursive, so this happens only if the same thread reserves two items
+      LOG_ERROR("Failed to reserve new buffer item - the previously reserved item has not been committed or canceled"); 
+    }
+    else if ( timestamp <= this->CurrentTimeStamp )
+    {
+      LOG_DEBUG("Need to skip newly added frame - new timestamp ("<< std::fixed << timestamp << ") is not newer than the last one (" << this->CurrentTimeStamp << ")!"); 
+    }
+    else if ( this->GetBufferSize() <= 0 )
+    {
+      LOG_ERROR("Failed to reserve new buffer item - buffer size is 0"); 
+    }
+    else
+    {
+      bufferIndex = this->WritePointer; 
+      this->CurrentTimeStamp = timestamp; 
+
+      // If the buffer is full then the oldest item is overwritten, so remove it from the valid range
+      // (oldest UID = LatestItemUid - (NumberOfItems - 1)) before the writer starts to modify it
+      if ( this->NumberOfItems >= this->GetBufferSize() )
+      {
+        this->NumberOfItems = this->GetBufferSize() - 1;
+      }
+
+      this->NewItemReserved = true; 
+      return PLUS_SUCCESS; 
+    }
   }
 
-  // Increase frame unique ID
-  this->Lock();
-  newFrameUid = ++this->LatestItemUid; 
-  bufferIndex = this->WritePointer; 
-  this->CurrentTimeStamp = timestamp; 
+  this->WriterMutex->Unlock();
+  return PLUS_FAIL; 
+}
 
-  this->NumberOfItems++;
-  if (this->NumberOfItems > this->GetBufferSize())
+//----------------------------------------------------------------------------
+template<class BufferItemType>
+PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::CommitNewItem(BufferItemUidType& newFrameUid)
+{
+  PlusStatus status = PLUS_SUCCESS;
   {
-    this->NumberOfItems = this->GetBufferSize();
+    PlusLockGuard< vtkTimestampedCircularBuffer<BufferItemType> > bufferGuardedLock(this);
+
+    if ( this->NewItemReserved )
+    {
+      newFrameUid = ++this->LatestItemUid; 
+      this->BufferItemContainer[this->WritePointer].SetUid(newFrameUid); 
+
+      this->NumberOfItems++;
+      if (this->NumberOfItems > this->GetBufferSize())
+      {
+        this->NumberOfItems = this->GetBufferSize();
+      }
+      // Increase the write pointer
+      if ( ++this->WritePointer >= this->GetBufferSize() )
+      {
+        this->WritePointer = 0; 
+      }
+
+      this->NewItemReserved = false; 
+    }
+    else
+    {
+      // The buffer may have been cleared while the item was written
+      LOG_DEBUG("Failed to commit new buffer item - no item is reserved"); 
+      status = PLUS_FAIL;
+    }
   }
-  // Increase the write pointer
-  if ( ++this->WritePointer >= this->GetBufferSize() )
+
+  // Let the next writer reserve an item
+  this->WriterMutex->Unlock();
+  return status; 
+}
+
+//----------------------------------------------------------------------------
+template<class BufferItemType>
+void vtkTimestampedCircularBuffer<BufferItemType>::CancelNewItem()
+{
   {
-    this->WritePointer = 0; 
+    // The overwritten item (if there was any) remains excluded from the valid range
+    PlusLockGuard< vtkTimestampedCircularBuffer<BufferItemType> > bufferGuardedLock(this);
+    this->NewItemReserved = false; 
   }
-  this->Unlock(); 
+  this->WriterMutex->Unlock();
+}
 
-  return PLUS_SUCCESS; 
+//----------------------------------------------------------------------------
+template<class BufferItemType>
+void vtkTimestampedCircularBuffer<BufferItemType>::LockWriting()
+{
+  this->WriterMutex->Lock();
+}
+
+//----------------------------------------------------------------------------
+template<class BufferItemType>
+void vtkTimestampedCircularBuffer<BufferItemType>::UnlockWriting()
+{
+  this->WriterMutex->Unlock();
 }
 
 //----------------------------------------------------------------------------
@@ -145,6 +240,8 @@ PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::SetBufferSize(int bufsi
     return PLUS_SUCCESS;
   }
 
+  // Wait until the item that is being written (without holding the buffer lock) is committed
+  this->LockWriting(); 
   this->Lock(); 
 
   if ( this->GetBufferSize() == 0 )
@@ -191,6 +288,7 @@ PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::SetBufferSize(int bufsi
   }
   
   this->Unlock(); 
+  this->UnlockWriting(); 
 
   this->Modified();
   
@@ -446,31 +544,32 @@ ItemStatus vtkTimestampedCircularBuffer<BufferItemType>::GetItemUidFromTime(cons
     return ITEM_NOT_AVAILABLE_YET;
   }
 
-  for (;;)
+  // Check the previously found item pair and the next pair first: consecutive requests
+  // usually ask for the same or a slightly later time
+  BufferItemUidType hint = this->LastItemUidFromTime;
+  for (int step = 0; step < 2 && hint >= lo && hint < hi; ++step, ++hint)
   {
-    if (hi-lo <= 1)
+    double thint = this->GetFilteredTimeStampOfValidItem(hint);
+    if (time < thint)
     {
-      if (time - tlo > thi - time)
-      {
-        uid = hi; 
-        return ITEM_OK;
-      }
-      else
-      {
-        uid = lo; 
-        return ITEM_OK;
-      }
+      break;
     }
-
-    int mid = (lo+hi)/2;
-    double tmid(0);
-    ItemStatus midStatus = this->GetTimeStamp(mid, tmid); 
-    if ( midStatus != ITEM_OK )
+    double tnext = this->GetFilteredTimeStampOfValidItem(hint+1);
+    if (time <= tnext)
     {
-      LOG_WARNING("Unable to get mid timestamp for frame UID: " << tmid ); 
-      return midStatus; 
+      lo = hint;
+      tlo = thint;
+      hi = hint+1;
+      thi = tnext;
+      break;
     }
+  }
 
+  // Binary search
+  while (hi-lo > 1)
+  {
+    BufferItemUidType mid = lo+(hi-lo)/2;
+    double tmid = this->GetFilteredTimeStampOfValidItem(mid);
     if (time < tmid)
     {
       hi = mid;
@@ -483,12 +582,37 @@ ItemStatus vtkTimestampedCircularBuffer<BufferItemType>::GetItemUidFromTime(cons
     }
   }
 
+  this->LastItemUidFromTime = lo;
+  if (time - tlo > thi - time)
+  {
+    uid = hi; 
+  }
+  else
+  {
+    uid = lo; 
+  }
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+template<class BufferItemType>
+double vtkTimestampedCircularBuffer<BufferItemType>::GetFilteredTimeStampOfValidItem(const BufferItemUidType uid)
+{
+  int bufferIndex = (this->WritePointer - 1) - static_cast<int>(this->LatestItemUid - uid); 
+  if ( bufferIndex < 0 )
+  {
+    bufferIndex += this->GetBufferSize(); 
+  }
+  return this->BufferItemContainer[bufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec); 
 }
 
 //----------------------------------------------------------------------------
 template<class BufferItemType>
 void vtkTimestampedCircularBuffer<BufferItemType>::DeepCopy(vtkTimestampedCircularBuffer<BufferItemType>* buffer)
 {
+  // Wait until the items that are being written into the buffers are committed
+  buffer->LockWriting(); 
+  this->LockWriting(); 
   buffer->Lock(); 
   this->Lock(); 
   this->WritePointer = buffer->WritePointer;
@@ -502,10 +626,13 @@ void vtkTimestampedCircularBuffer<BufferItemType>::DeepCopy(vtkTimestampedCircul
   this->FilterContainersOldestIndex = buffer->FilterContainersOldestIndex; 
   this->FilterContainerTimestampVector = buffer->FilterContainerTimestampVector; 
   this->FilterContainerIndexVector = buffer->FilterContainerIndexVector; 
+  this->RecomputeFilterSums();
 
   this->BufferItemContainer = buffer->BufferItemContainer; 
   this->Unlock(); 
   buffer->Unlock(); 
+  this->UnlockWriting(); 
+  buffer->UnlockWriting(); 
 }
 
 //----------------------------------------------------------------------------
@@ -514,6 +641,7 @@ void vtkTimestampedCircularBuffer<BufferItemType>::Clear()
 {
   this->Lock(); 
   this->WritePointer = 0; 
+  this->NewItemReserved = false; 
   this->NumberOfItems = 0; 
   this->CurrentTimeStamp = 0; 
   this->LatestItemUid = 0;
@@ -634,16 +762,41 @@ PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::CreateFilteredTimeStamp
     this->FilterContainerTimestampVector.set_size(this->AveragedItemsForFiltering); 
     this->FilterContainersOldestIndex = 0; 
     this->FilterContainersNumberOfValidElements = 0; 
+    this->RecomputeFilterSums();
   }
 
   // We store the last AveragedItemsForFiltering unfiltered timestamp and item indexes, because these are used for computing the filtered timestamp.
+  // The running sums are updated by removing the overwritten (oldest) item and adding the new one.
   if ( this->AveragedItemsForFiltering > 1 )
   {
+    if ( this->FilterContainersNumberOfValidElements == 0 )
+    {
+      this->FilterAnchorIndex = itemIndex;
+      this->FilterAnchorTimestamp = inUnfilteredTimestamp;
+    }
+    else if ( this->FilterContainersNumberOfValidElements >= this->AveragedItemsForFiltering )
+    {
+      double oldX = this->FilterContainerIndexVector(this->FilterContainersOldestIndex) - this->FilterAnchorIndex;
+      double oldY = this->FilterContainerTimestampVector(this->FilterContainersOldestIndex) - this->FilterAnchorTimestamp;
+      this->FilterSumX -= oldX;
+      this->FilterSumY -= oldY;
+      this->FilterSumXX -= oldX*oldX;
+      this->FilterSumXY -= oldX*oldY;
+    }
+
     this->FilterContainerIndexVector(this->FilterContainersOldestIndex) = itemIndex; 
     this->FilterContainerTimestampVector[this->FilterContainersOldestIndex] = inUnfilteredTimestamp; 
     this->FilterContainersNumberOfValidElements++; 
     this->FilterContainersOldestIndex++; 
 
+    double newX = itemIndex - this->FilterAnchorIndex;
+    double newY = inUnfilteredTimestamp - this->FilterAnchorTimestamp;
+    this->FilterSumX += newX;
+    this->FilterSumY += newY;
+    this->FilterSumXX += newX*newX;
+    this->FilterSumXY += newX*newY;
+    this->FilterItemsSinceSumsRecomputed++;
+
     if ( this->FilterContainersNumberOfValidElements > this->AveragedItemsForFiltering )
     {
       this->FilterContainersNumberOfValidElements = this->AveragedItemsForFiltering; 
@@ -653,6 +806,14 @@ PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::CreateFilteredTimeStamp
     {
       this->FilterContainersOldestIndex = 0; 
     }
+
+    // Re-anchor and recompute the sums after each full window of items. The recomputation is linear in the window
+    // size, but it is done only once per window, so the amortized cost of filtering an item remains constant, while
+    // rounding errors of the incremental updates cannot accumulate and the anchor-relative values remain small.
+    if ( this->FilterItemsSinceSumsRecomputed >= this->AveragedItemsForFiltering )
+    {
+      this->RecomputeFilterSums();
+    }
   }
   
   // If we don't have enough unfiltered timestamps or we don't want to use afiltering then just use the unfiltered timestamps
@@ -684,22 +845,21 @@ PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::CreateFilteredTimeStamp
   //   y(i) = a * x(i) + b;
   //   a = sum( (x(i)-xMean) * (y(i)-yMean) ) / sum( (x(i)-xMean) * (x(i)-xMean) )
   //   b = yMean - a*xMean
+  //
+  // The sums are computed from the running sums (all x and y values are relative to the anchor):
+  //   sum( (x(i)-xMean) * (y(i)-yMean) ) = sum( x(i)*y(i) ) - sum( x(i) ) * yMean
+  //   sum( (x(i)-xMean) * (x(i)-xMean) ) = sum( x(i)*x(i) ) - sum( x(i) ) * xMean
   // 
 
-  double xMean=this->FilterContainerIndexVector.mean();
-  double yMean=this->FilterContainerTimestampVector.mean();
-  double covarianceXY=0;
-  double varianceX=0;
-  for (int i=this->FilterContainerTimestampVector.size()-1; i>=0; i--)
-  {
-    double xiMinusXmean=(this->FilterContainerIndexVector(i)-xMean);
-    covarianceXY+=xiMinusXmean*(this->FilterContainerTimestampVector(i)-yMean);
-    varianceX+=xiMinusXmean*xiMinusXmean;    
-  }
+  const double numberOfItems = this->FilterContainersNumberOfValidElements;
+  double xMean=this->FilterSumX/numberOfItems;
+  double yMean=this->FilterSumY/numberOfItems;
+  double covarianceXY=this->FilterSumXY-this->FilterSumX*yMean;
+  double varianceX=this->FilterSumXX-this->FilterSumX*xMean;
   double a=covarianceXY/varianceX;
-  double b=yMean-a*xMean;
 
-  outFilteredTimestamp = a * itemIndex + b; 
+  // b = yMean - a*xMean => filtered timestamp = a * itemIndex + b = yMean + a * (itemIndex - xMean) (using anchor-relative values)
+  outFilteredTimestamp = this->FilterAnchorTimestamp + yMean + a * ((itemIndex - this->FilterAnchorIndex) - xMean); 
 
   if (this->TimeStampLogging)
   {
@@ -723,6 +883,43 @@ PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::CreateFilteredTimeStamp
   return PLUS_SUCCESS; 
 }
 
+//----------------------------------------------------------------------------
+template<class BufferItemType>
+void vtkTimestampedCircularBuffer<BufferItemType>::RecomputeFilterSums()
+{
+  this->FilterSumX = 0;
+  this->FilterSumY = 0;
+  this->FilterSumXX = 0;
+  this->FilterSumXY = 0;
+  this->FilterItemsSinceSumsRecomputed = 0;
+
+  const int numberOfItems = this->FilterContainersNumberOfValidElements;
+  if ( numberOfItems <= 0 || this->FilterContainerIndexVector.size() == 0 )
+  {
+    return;
+  }
+
+  // Use the most recently added item as anchor
+  int newestIndex = this->FilterContainersOldestIndex - 1;
+  if ( newestIndex < 0 )
+  {
+    newestIndex += this->FilterContainerIndexVector.size();
+  }
+  this->FilterAnchorIndex = this->FilterContainerIndexVector(newestIndex);
+  this->FilterAnchorTimestamp = this->FilterContainerTimestampVector(newestIndex);
+
+  // Items are stored from the beginning of the containers, so the valid items are the first numberOfItems elements
+  for ( int i = 0; i < numberOfItems; ++i )
+  {
+    double x = this->FilterContainerIndexVector(i) - this->FilterAnchorIndex;
+    double y = this->FilterContainerTimestampVector(i) - this->FilterAnchorTimestamp;
+    this->FilterSumX += x;
+    this->FilterSumY += y;
+    this->FilterSumXX += x*x;
+    this->FilterSumXY += x*y;
+  }
+}
+
 //----------------------------------------------------------------------------
 template<class BufferItemType>
 PlusStatus vtkTimestampedCircularBuffer<BufferItemType>::GetTimeStampReportTable(vtkTable* timeStampReportTable)
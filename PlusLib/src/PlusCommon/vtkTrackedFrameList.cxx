@@ -33,12 +33,14 @@ vtkTrackedFrameList::vtkTrackedFrameList()
   this->MaxAllowedRotationSpeedDegPerSec=0.0;
   this->ValidationRequirements = 0; 
 
+  this->MaxNumberOfRecycledFrames = 0;
 }
 
 //----------------------------------------------------------------------------
 vtkTrackedFrameList::~vtkTrackedFrameList()
 {
   this->Clear(); 
+  this->ReleaseRecycledFrames();
 }
 
 //----------------------------------------------------------------------------
@@ -50,7 +52,7 @@ PlusStatus vtkTrackedFrameList::RemoveTrackedFrame( int frameNumber )
     return PLUS_FAIL; 
   }
 
-  delete this->TrackedFrameList[frameNumber]; 
+  this->RecycleTrackedFrame(this->TrackedFrameList[frameNumber]); 
   this->TrackedFrameList.erase(this->TrackedFrameList.begin()+frameNumber); 
 
   return PLUS_SUCCESS;
@@ -67,7 +69,7 @@ PlusStatus vtkTrackedFrameList::RemoveTrackedFrameRange( int frameNumberFrom, in
 
   for (int i=frameNumberFrom; i<=frameNumberTo; ++i)
   {
-    delete this->TrackedFrameList[i];
+    this->RecycleTrackedFrame(this->TrackedFrameList[i]);
   }
 
   this->TrackedFrameList.erase(this->TrackedFrameList.begin()+frameNumberFrom, this->TrackedFrameList.begin()+frameNumberTo+1);
@@ -82,13 +84,92 @@ void vtkTrackedFrameList::Clear()
   {
     if (this->TrackedFrameList[i] != NULL )
     {
-      delete this->TrackedFrameList[i]; 
+      this->RecycleTrackedFrame(this->TrackedFrameList[i]); 
       this->TrackedFrameList[i] = NULL; 
     }
   }
   this->TrackedFrameList.clear(); 
 }
 
+//----------------------------------------------------------------------------
+void vtkTrackedFrameList::SetMaxNumberOfRecycledFrames(int maxNumberOfRecycledFrames)
+{
+  if (maxNumberOfRecycledFrames < 0)
+  {
+    maxNumberOfRecycledFrames = 0;
+  }
+  this->MaxNumberOfRecycledFrames = maxNumberOfRecycledFrames;
+  while ( this->RecycledFrames.size() > static_cast<unsigned int>(this->MaxNumberOfRecycledFrames) )
+  {
+    delete this->RecycledFrames.front();
+    this->RecycledFrames.pop_front();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedFrameList::ReleaseRecycledFrames()
+{
+  for ( TrackedFrameListType::iterator it = this->RecycledFrames.begin(); it != this->RecycledFrames.end(); ++it )
+  {
+    delete (*it);
+  }
+  this->RecycledFrames.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedFrameList::RecycleTrackedFrame(TrackedFrame* trackedFrame)
+{
+  if ( trackedFrame == NULL )
+  {
+    return;
+  }
+  if ( this->RecycledFrames.size() >= static_cast<unsigned int>(this->MaxNumberOfRecycledFrames) )
+  {
+    delete trackedFrame;
+    return;
+  }
+  this->RecycledFrames.push_back(trackedFrame);
+}
+
+//----------------------------------------------------------------------------
+TrackedFrame* vtkTrackedFrameList::AcquireTrackedFrame(TrackedFrame* referenceFrame)
+{
+  if ( this->RecycledFrames.empty() )
+  {
+    return new TrackedFrame;
+  }
+
+  TrackedFrameListType::iterator selectedFrameIt = this->RecycledFrames.end()-1;
+  PlusVideoFrame* referenceImage = referenceFrame->GetImageData();
+  if ( referenceImage->GetFrameSizeInBytes() > 0 )
+  {
+    // Look for a frame with the same image geometry, so that the image buffer can be reused
+    int referenceSize[2] = {0,0};
+    referenceImage->GetFrameSize(referenceSize);
+    for ( TrackedFrameListType::iterator it = this->RecycledFrames.begin(); it != this->RecycledFrames.end(); ++it )
+    {
+      PlusVideoFrame* image = (*it)->GetImageData();
+      if ( image->GetFrameSizeInBytes() == 0 )
+      {
+        continue;
+      }
+      int size[2] = {0,0};
+      image->GetFrameSize(size);
+      if ( size[0] == referenceSize[0] && size[1] == referenceSize[1]
+        && image->GetVTKScalarPixelType() == referenceImage->GetVTKScalarPixelType()
+        && image->GetNumberOfScalarComponents() == referenceImage->GetNumberOfScalarComponents() )
+      {
+        selectedFrameIt = it;
+        break;
+      }
+    }
+  }
+
+  TrackedFrame* selectedFrame = *selectedFrameIt;
+  this->RecycledFrames.erase(selectedFrameIt);
+  return selectedFrame;
+}
+
 //----------------------------------------------------------------------------
 void vtkTrackedFrameList::PrintSelf(std::ostream &os, vtkIndent indent)
 {
@@ -130,8 +211,9 @@ PlusStatus vtkTrackedFrameList::AddTrackedFrameList(vtkTrackedFrameList* inTrack
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkTrackedFrameList::AddTrackedFrame(TrackedFrame *trackedFrame, InvalidFrameAction action /*=ADD_INVALID_FRAME_AND_REPORT_ERROR*/ )
+PlusStatus vtkTrackedFrameList::ValidateFrameForAdding(TrackedFrame* trackedFrame, InvalidFrameAction action, bool &addFrame)
 {
+  addFrame = true;
   bool isFrameValid = true; 
   if ( action != ADD_INVALID_FRAME )
   {
@@ -150,15 +232,48 @@ PlusStatus vtkTrackedFrameList::AddTrackedFrame(TrackedFrame *trackedFrame, Inva
       break; 
     case SKIP_INVALID_FRAME_AND_REPORT_ERROR: 
       LOG_ERROR("A similar frame is already found in the tracked frame list, invalid frame skipped."); 
+      addFrame = false;
       return PLUS_FAIL;
     case SKIP_INVALID_FRAME: 
       LOG_DEBUG("A similar frame is already found in the tracked frame list, invalid frame skipped.");
+      addFrame = false;
       return PLUS_SUCCESS; 
     }
   }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkTrackedFrameList::AddTrackedFrame(TrackedFrame *trackedFrame, InvalidFrameAction action /*=ADD_INVALID_FRAME_AND_REPORT_ERROR*/ )
+{
+  bool addFrame = true;
+  PlusStatus status = this->ValidateFrameForAdding(trackedFrame, action, addFrame);
+  if ( !addFrame )
+  {
+    return status;
+  }
+
+  // Make a copy and add frame to the list. The copy reuses the image buffer of the recycled frame if the size matches.
+  TrackedFrame* pTrackedFrame = this->AcquireTrackedFrame(trackedFrame); 
+  *pTrackedFrame = *trackedFrame;
+  this->TrackedFrameList.push_back(pTrackedFrame); 
+  return PLUS_SUCCESS; 
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkTrackedFrameList::AddTrackedFrameBySwap(TrackedFrame *trackedFrame, InvalidFrameAction action /*=ADD_INVALID_FRAME_AND_REPORT_ERROR*/ )
+{
+  bool addFrame = true;
+  PlusStatus status = this->ValidateFrameForAdding(trackedFrame, action, addFrame);
+  if ( !addFrame )
+  {
+    return status;
+  }
 
-  // Make a copy and add frame to the list 
-  TrackedFrame* pTrackedFrame = new TrackedFrame(*trackedFrame); 
+  // Move the frame content into a frame object owned by the list, without copying the pixel data.
+  // The caller gets the content of the recycled frame (an image buffer that matches the frame geometry, if available).
+  TrackedFrame* pTrackedFrame = this->AcquireTrackedFrame(trackedFrame); 
+  pTrackedFrame->Swap(*trackedFrame);
   this->TrackedFrameList.push_back(pTrackedFrame); 
   return PLUS_SUCCESS; 
 }
@@ -58,9 +58,20 @@ public:
     SKIP_INVALID_FRAME /*!< Skip invalid frame wihout notification */
   }; 
 
-  /*! Add tracked frame to container. If the frame is invalid then it may not actually add it to the list. */
+  /*!
+    Add tracked frame to container. If the frame is invalid then it may not actually add it to the list.
+    The frame is copied into a recycled frame (if available), so that the image buffer can be reused.
+  */
   virtual PlusStatus AddTrackedFrame(TrackedFrame *trackedFrame, InvalidFrameAction action = ADD_INVALID_FRAME_AND_REPORT_ERROR); 
 
+  /*!
+    Add tracked frame to container by exchanging its content with a recycled frame instead of copying it.
+    No pixel data is copied. If the frame is added then the content of trackedFrame is unspecified after the call
+    (it may contain the image buffer and fields of a previously removed frame), so it must be completely
+    overwritten before it is used again.
+  */
+  virtual PlusStatus AddTrackedFrameBySwap(TrackedFrame *trackedFrame, InvalidFrameAction action = ADD_INVALID_FRAME_AND_REPORT_ERROR); 
+
   /*! Add all frames from a tracked frame list to the container. It adds all invalid frames as well, but an error is reported. */
   virtual PlusStatus AddTrackedFrameList(vtkTrackedFrameList* inTrackedFrameList, InvalidFrameAction action = ADD_INVALID_FRAME_AND_REPORT_ERROR); 
 
@@ -93,9 +104,28 @@ public:
   */
   virtual PlusStatus RemoveTrackedFrameRange( int frameNumberFrom, int frameNumberTo ); 
 
-  /*! Clear tracked frame list and free memory */
+  /*!
+    Clear tracked frame list. If recycling is enabled then up to MaxNumberOfRecycledFrames frames are
+    kept in memory for reuse by subsequent AddTrackedFrame calls, the others are deleted.
+  */
   virtual void Clear(); 
 
+  /*!
+    Set the maximum number of removed frames that are kept for reuse. Reusing frames avoids
+    memory allocation for each added frame, but the recycled frames keep their image buffers allocated.
+    If set to 0 then removed frames are deleted immediately. Default is 0 (recycling is disabled).
+  */
+  void SetMaxNumberOfRecycledFrames(int maxNumberOfRecycledFrames);
+
+  /*! Delete the removed frames that are kept for reuse. Recycling remains enabled for the frames that are removed later. */
+  void ReleaseRecycledFrames();
+
+  /*! Get the maximum number of removed frames that are kept for reuse */
+  vtkGetMacro(MaxNumberOfRecycledFrames, int); 
+
+  /*! Get the number of removed frames that are currently kept for reuse */
+  int GetNumberOfRecycledFrames() { return this->RecycledFrames.size(); }
+
   /*! Set the number of following unique frames needed in the tracked frame list */
   vtkSetMacro(NumberOfUniqueFrames, int); 
 
@@ -221,6 +251,22 @@ protected:
   */
   virtual bool ValidateData(TrackedFrame* trackedFrame); 
 
+  /*!
+    Validate a frame that is about to be added to the list and report the result as specified by the action.
+    \param addFrame Set to true if the frame has to be added to the list
+    \return Failure if the frame is invalid and it has to be reported as an error
+  */
+  PlusStatus ValidateFrameForAdding(TrackedFrame* trackedFrame, InvalidFrameAction action, bool &addFrame);
+
+  /*!
+    Get a frame object for adding to the list. A recycled frame is returned if available (preferably one that has an image
+    buffer with the same size and pixel type as the reference frame), otherwise a new frame is created.
+  */
+  TrackedFrame* AcquireTrackedFrame(TrackedFrame* referenceFrame);
+
+  /*! Keep a removed frame for reuse or delete it if the maximum number of recycled frames is reached */
+  void RecycleTrackedFrame(TrackedFrame* trackedFrame);
+
   /*! Helper class for saving to sequence metafile */
   template <class OutputPixelType>
   PlusStatus SaveToSequenceMetafileGeneric(const char* outputFolder, const char* sequenceDataFileName, SEQ_METAFILE_EXTENSION extension = SEQ_METAFILE_MHA, bool useCompression = true);
@@ -234,6 +280,10 @@ protected:
   TrackedFrameListType TrackedFrameList; 
   FieldMapType CustomFields;
 
+  /*! Removed frames that are kept for reuse (to avoid memory allocation when frames are added) */
+  TrackedFrameListType RecycledFrames;
+  int MaxNumberOfRecycledFrames;
+
   int NumberOfUniqueFrames;
 
   /*! Validation threshold value */
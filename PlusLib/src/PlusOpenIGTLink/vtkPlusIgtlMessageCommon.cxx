@@ -111,6 +111,19 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackTrackedFrameMessage( igtl::MessageHea
 
   socket->Receive(trackedFrameMsg->GetPackBodyPointer(), trackedFrameMsg->GetPackBodySize());
 
+  return vtkPlusIgtlMessageCommon::UnpackTrackedFrameMessage(trackedFrameMsg, trackedFrame, crccheck); 
+}
+
+//----------------------------------------------------------------------------
+// static 
+PlusStatus vtkPlusIgtlMessageCommon::UnpackTrackedFrameMessage( igtl::PlusTrackedFrameMessage::Pointer trackedFrameMsg, TrackedFrame& trackedFrame, int crccheck)
+{
+  if ( trackedFrameMsg.IsNull() )
+  {
+    LOG_ERROR("Unable to unpack tracked frame message - message is NULL!"); 
+    return PLUS_FAIL; 
+  }
+
   int c = trackedFrameMsg->Unpack(crccheck);
   if ( !(c & igtl::MessageHeader::UNPACK_BODY) )
   {
@@ -278,6 +291,19 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackImageMessage( igtl::MessageHeader::Po
 
   socket->Receive(imgMsg->GetPackBodyPointer(), imgMsg->GetPackBodySize());
 
+  return vtkPlusIgtlMessageCommon::UnpackImageMessage(imgMsg, trackedFrame, embeddedTransformName, crccheck); 
+}
+
+//----------------------------------------------------------------------------
+// static 
+PlusStatus vtkPlusIgtlMessageCommon::UnpackImageMessage( igtl::ImageMessage::Pointer imgMsg, TrackedFrame& trackedFrame, const PlusTransformName &embeddedTransformName, int crccheck)
+{
+  if ( imgMsg.IsNull() )
+  {
+    LOG_ERROR("Unable to unpack image message - message is NULL!"); 
+    return PLUS_FAIL; 
+  }
+
   int c = imgMsg->Unpack(crccheck);
   if (! (c & igtl::MessageHeader::UNPACK_BODY) ) 
   {
@@ -491,18 +517,32 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackTransformMessage(igtl::MessageHeader:
     return PLUS_FAIL; 
   }
 
-  if ( transformMatrix == NULL )
-  {
-    LOG_ERROR("Unable to unpack transform message - matrix is NULL!"); 
-    return PLUS_FAIL; 
-  }
-
   igtl::TransformMessage::Pointer transMsg = igtl::TransformMessage::New();
   transMsg->SetMessageHeader(headerMsg);
   transMsg->AllocatePack();
 
   socket->Receive(transMsg->GetPackBodyPointer(), transMsg->GetPackBodySize());
 
+  return vtkPlusIgtlMessageCommon::UnpackTransformMessage(transMsg, transformMatrix, transformName, timestamp, crccheck); 
+}
+
+//----------------------------------------------------------------------------
+// static 
+PlusStatus vtkPlusIgtlMessageCommon::UnpackTransformMessage(igtl::TransformMessage::Pointer transMsg, 
+                                                           vtkMatrix4x4* transformMatrix, std::string& transformName, double& timestamp, int crccheck )
+{
+  if ( transMsg.IsNull() )
+  {
+    LOG_ERROR("Unable to unpack transform message - message is NULL!"); 
+    return PLUS_FAIL; 
+  }
+
+  if ( transformMatrix == NULL )
+  {
+    LOG_ERROR("Unable to unpack transform message - matrix is NULL!"); 
+    return PLUS_FAIL; 
+  }
+
   int c = transMsg->Unpack(crccheck);
   if ( !(c & igtl::MessageHeader::UNPACK_BODY) )
   {
@@ -576,18 +616,32 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackPositionMessage(igtl::MessageHeader::
     return PLUS_FAIL; 
   }
 
-  if ( position == NULL )
-  {
-    LOG_ERROR("Unable to unpack position message - position is NULL!"); 
-    return PLUS_FAIL; 
-  }
-
   igtl::PositionMessage::Pointer posMsg = igtl::PositionMessage::New();
   posMsg->SetMessageHeader(headerMsg);
   posMsg->AllocatePack();
 
   socket->Receive(posMsg->GetPackBodyPointer(), posMsg->GetPackBodySize());
 
+  return vtkPlusIgtlMessageCommon::UnpackPositionMessage(posMsg, position, positionName, timestamp, crccheck); 
+}
+
+//----------------------------------------------------------------------------
+// static 
+PlusStatus vtkPlusIgtlMessageCommon::UnpackPositionMessage(igtl::PositionMessage::Pointer posMsg, 
+                                                            float position[3], std::string& positionName, double& timestamp, int crccheck )
+{
+  if ( posMsg.IsNull() )
+  {
+    LOG_ERROR("Unable to unpack position message - message is NULL!"); 
+    return PLUS_FAIL; 
+  }
+
+  if ( position == NULL )
+  {
+    LOG_ERROR("Unable to unpack position message - position is NULL!"); 
+    return PLUS_FAIL; 
+  }
+
   //  If crccheck is specified it performs CRC check and unpack the data only if CRC passes
   int c = posMsg->Unpack(crccheck);
   if ( !(c & igtl::MessageHeader::UNPACK_BODY) )
@@ -46,6 +46,9 @@ public:
   /*! Unpack tracked frame message to tracked frame */ 
   static PlusStatus UnpackTrackedFrameMessage( igtl::MessageHeader::Pointer headerMsg, igtl::Socket *socket, TrackedFrame& trackedFrame, int crccheck); 
 
+  /*! Unpack tracked frame message to tracked frame, the message body has been already received */ 
+  static PlusStatus UnpackTrackedFrameMessage( igtl::PlusTrackedFrameMessage::Pointer trackedFrameMsg, TrackedFrame& trackedFrame, int crccheck); 
+
   /*! Pack US message from tracked frame */ 
   static PlusStatus PackUsMessage( igtl::PlusUsMessage::Pointer usMessage, TrackedFrame& trackedFrame); 
 
@@ -58,6 +61,9 @@ public:
   /*! Unpack image message to tracked frame */ 
   static PlusStatus UnpackImageMessage( igtl::MessageHeader::Pointer headerMsg, igtl::Socket *socket, TrackedFrame& trackedFrame, const PlusTransformName &embeddedTransformName, int crccheck); 
 
+  /*! Unpack image message to tracked frame, the message body has been already received */ 
+  static PlusStatus UnpackImageMessage( igtl::ImageMessage::Pointer imgMsg, TrackedFrame& trackedFrame, const PlusTransformName &embeddedTransformName, int crccheck); 
+
   /*! Pack image message from vtkImageData volume */ 
   static PlusStatus PackImageMessage( igtl::ImageMessage::Pointer imageMessage, vtkImageData* volume, vtkMatrix4x4* volumeToReferenceTransform, double timestamp ); 
 
@@ -69,6 +75,10 @@ public:
   static PlusStatus UnpackTransformMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket *socket, 
     vtkMatrix4x4* transformMatrix, std::string& transformName, double& timestamp, int crccheck ); 
 
+  /*! Unpack transform message, the message body has been already received */ 
+  static PlusStatus UnpackTransformMessage(igtl::TransformMessage::Pointer transMsg, 
+    vtkMatrix4x4* transformMatrix, std::string& transformName, double& timestamp, int crccheck ); 
+
   /*! Pack position message from tracked frame */ 
   static PlusStatus PackPositionMessage(igtl::PositionMessage::Pointer positionMessage, PlusTransformName& transformName, 
     igtl::Matrix4x4& igtlMatrix, double timestamp ); 
@@ -77,6 +87,10 @@ public:
   static PlusStatus UnpackPositionMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, 
     float position[3], std::string& positionName, double& timestamp, int crccheck );
 
+  /*! Unpack position message, the message body has been already received */ 
+  static PlusStatus UnpackPositionMessage(igtl::PositionMessage::Pointer posMsg, 
+    float position[3], std::string& positionName, double& timestamp, int crccheck );
+
   /*! Generate igtl::Matrix4x4 with the selected transform name from the transform repository */ 
   static PlusStatus GetIgtlMatrix(igtl::Matrix4x4& igtlMatrix, vtkTransformRepository* transformRepository, PlusTransformName& transformName); 
 
@@ -0,0 +1,290 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "vtkPlusIgtlMessageReceiver.h"
+#include "igtlMessageHeader.h"
+#include "vtkObjectFactory.h"
+#include "vtkRecursiveCriticalSection.h"
+
+#ifdef _WIN32
+  #include <Winsock2.h>
+#endif
+
+// The worker thread polls the message queue, so this delay is added to the latency of processing a message at most
+static const double RECEIVER_IDLE_DELAY_SEC = 0.001;
+
+vtkCxxRevisionMacro(vtkPlusIgtlMessageReceiver, "$Revision: 1.0 $");
+vtkStandardNewMacro(vtkPlusIgtlMessageReceiver);
+
+//----------------------------------------------------------------------------
+vtkPlusIgtlMessageReceiver::vtkPlusIgtlMessageReceiver()
+: MessageHandler(NULL)
+, MessageHandlerClientData(NULL)
+, MessageQueueMutex(vtkRecursiveCriticalSection::New())
+, MaximumNumberOfQueuedMessages(100)
+, NumberOfDiscardedMessages(0)
+, LastMessageReceiveTimestamp(0)
+, SocketError(false)
+, Threader(vtkMultiThreader::New())
+, ReceiveThreadId(-1)
+, ReceiveThreadActive(false)
+, ReceiveThreadAlive(false)
+, ProcessThreadId(-1)
+, ProcessThreadActive(false)
+, ProcessThreadAlive(false)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIgtlMessageReceiver::~vtkPlusIgtlMessageReceiver()
+{
+  this->Stop();
+  DELETE_IF_NOT_NULL(this->Threader);
+  DELETE_IF_NOT_NULL(this->MessageQueueMutex);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageReceiver::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "Maximum number of queued messages: " << this->MaximumNumberOfQueuedMessages << "\n";
+  os << indent << "Number of discarded messages: " << this->NumberOfDiscardedMessages << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageReceiver::SetMessageHandler(MessageHandlerType handler, void* clientData)
+{
+  this->MessageHandler = handler;
+  this->MessageHandlerClientData = clientData;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageReceiver::AddAcceptedMessageType(const char* messageTypeName, vtkPlusIgtlMessageFactory::PointerToMessageBaseNew messageTypeNewPointer)
+{
+  if ( messageTypeName == NULL )
+  {
+    LOG_ERROR("Unable to add accepted message type - message type name is NULL!");
+    return;
+  }
+  this->AcceptedMessageTypes[messageTypeName] = messageTypeNewPointer;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageReceiver::SetSocket(igtl::Socket* socket)
+{
+  this->Socket = socket;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusIgtlMessageReceiver::GetLastMessageReceiveTimestamp()
+{
+  PlusLockGuard<vtkRecursiveCriticalSection> messageQueueGuardedLock(this->MessageQueueMutex);
+  return this->LastMessageReceiveTimestamp;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageReceiver::Start()
+{
+  this->Stop();
+
+  if ( this->Socket.IsNull() )
+  {
+    LOG_ERROR("Unable to start receiving OpenIGTLink messages - socket is NULL!");
+    return PLUS_FAIL;
+  }
+
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> messageQueueGuardedLock(this->MessageQueueMutex);
+    this->MessageQueue.clear();
+    this->NumberOfDiscardedMessages = 0;
+    this->LastMessageReceiveTimestamp = vtkAccurateTimer::GetSystemTime();
+  }
+  this->SocketError = false;
+
+  // Set the flags before the threads are started, so that Stop waits for the threads even if they have not started running yet
+  this->ReceiveThreadActive = true;
+  this->ReceiveThreadAlive = true;
+  this->ProcessThreadActive = true;
+  this->ProcessThreadAlive = true;
+  this->ReceiveThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&vtkReceiveThread, this);
+  if ( this->ReceiveThreadId == -1 )
+  {
+    this->ReceiveThreadAlive = false;
+  }
+  this->ProcessThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&vtkProcessThread, this);
+  if ( this->ProcessThreadId == -1 )
+  {
+    this->ProcessThreadAlive = false;
+  }
+  if ( this->ReceiveThreadId == -1 || this->ProcessThreadId == -1 )
+  {
+    LOG_ERROR("Unable to start receiving OpenIGTLink messages - failed to start the receiver threads!");
+    this->Stop();
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageReceiver::Stop()
+{
+  // The receive thread returns from waiting for data when the socket timeout expires
+  this->ReceiveThreadActive = false;
+  this->ProcessThreadActive = false;
+  while ( this->ReceiveThreadAlive || this->ProcessThreadAlive )
+  {
+    vtkAccurateTimer::Delay(RECEIVER_IDLE_DELAY_SEC);
+  }
+
+  // The threads have returned already, terminating them releases their slots in the threader,
+  // so the receiver can be restarted any number of times (e.g., on reconnect)
+  if ( this->ReceiveThreadId != -1 )
+  {
+    this->Threader->TerminateThread(this->ReceiveThreadId);
+    this->ReceiveThreadId = -1;
+  }
+  if ( this->ProcessThreadId != -1 )
+  {
+    this->Threader->TerminateThread(this->ProcessThreadId);
+    this->ProcessThreadId = -1;
+  }
+
+  PlusLockGuard<vtkRecursiveCriticalSection> messageQueueGuardedLock(this->MessageQueueMutex);
+  this->MessageQueue.clear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlMessageReceiver::ReceiveNextMessage()
+{
+  igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
+  headerMsg->InitPack();
+
+  int numOfBytesReceived = this->Socket->Receive( headerMsg->GetPackPointer(), headerMsg->GetPackSize() );
+  if ( numOfBytesReceived == 0 )
+  {
+    // No data has been received
+    return false;
+  }
+  if ( numOfBytesReceived < 0 ) /* -1 == SOCKET_ERROR */
+  {
+#ifdef _WIN32
+    if ( WSAGetLastError() == WSAETIMEDOUT )
+    {
+      // timeout, it just means that no data was received, no need to reconnect
+      return false;
+    }
+#endif
+    LOG_DEBUG("Socket error while receiving OpenIGTLink message header");
+    this->SocketError = true;
+    return false;
+  }
+  if ( numOfBytesReceived != headerMsg->GetPackSize() )
+  {
+    LOG_ERROR("Couldn't receive OpenIGTLink message (unexpected header size)");
+    this->SocketError = true;
+    return false;
+  }
+
+  double receiveTimestamp = vtkAccurateTimer::GetSystemTime();
+  headerMsg->Unpack();
+
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> messageQueueGuardedLock(this->MessageQueueMutex);
+    this->LastMessageReceiveTimestamp = receiveTimestamp;
+  }
+
+  std::map<std::string, vtkPlusIgtlMessageFactory::PointerToMessageBaseNew>::iterator messageTypeIt = this->AcceptedMessageTypes.find(headerMsg->GetDeviceType());
+  if ( messageTypeIt == this->AcceptedMessageTypes.end() || messageTypeIt->second == NULL )
+  {
+    // if the data type is unknown, skip reading.
+    this->Socket->Skip(headerMsg->GetBodySizeToRead(), 0);
+    return true;
+  }
+
+  // Receive the body directly into the message that will be unpacked, so that the (possibly large) body is not copied
+  ReceivedMessage receivedMessage;
+  receivedMessage.Message = (*messageTypeIt->second)();
+  receivedMessage.Message->SetMessageHeader(headerMsg);
+  receivedMessage.Message->AllocatePack();
+  receivedMessage.ReceiveTimestamp = receiveTimestamp;
+  int bodySize = receivedMessage.Message->GetPackBodySize();
+  if ( bodySize > 0 && this->Socket->Receive(receivedMessage.Message->GetPackBodyPointer(), bodySize) != bodySize )
+  {
+    LOG_ERROR("Couldn't receive the body of the " << headerMsg->GetDeviceType() << " OpenIGTLink message");
+    this->SocketError = true;
+    return false;
+  }
+
+  PlusLockGuard<vtkRecursiveCriticalSection> messageQueueGuardedLock(this->MessageQueueMutex);
+  if ( static_cast<int>(this->MessageQueue.size()) >= this->MaximumNumberOfQueuedMessages && !this->MessageQueue.empty() )
+  {
+    if ( this->NumberOfDiscardedMessages == 0 )
+    {
+      LOG_WARNING("OpenIGTLink messages are received faster than they can be processed, the oldest messages are discarded");
+    }
+    this->MessageQueue.pop_front();
+    this->NumberOfDiscardedMessages++;
+  }
+  this->MessageQueue.push_back(receivedMessage);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlMessageReceiver::ProcessNextMessage()
+{
+  ReceivedMessage receivedMessage;
+  {
+    PlusLockGuard<vtkRecursiveCriticalSection> messageQueueGuardedLock(this->MessageQueueMutex);
+    if ( this->MessageQueue.empty() )
+    {
+      return false;
+    }
+    receivedMessage = this->MessageQueue.front();
+    this->MessageQueue.pop_front();
+  }
+
+  if ( this->MessageHandler != NULL )
+  {
+    // Errors are reported by the handler
+    (*this->MessageHandler)(receivedMessage.Message, receivedMessage.ReceiveTimestamp, this->MessageHandlerClientData);
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusIgtlMessageReceiver::vtkReceiveThread(vtkMultiThreader::ThreadInfo *data)
+{
+  vtkPlusIgtlMessageReceiver *self = (vtkPlusIgtlMessageReceiver *)(data->UserData);
+  while ( self->ReceiveThreadActive && !self->SocketError )
+  {
+    if ( !self->ReceiveNextMessage() )
+    {
+      // nothing to receive now
+      vtkAccurateTimer::Delay(RECEIVER_IDLE_DELAY_SEC);
+    }
+  }
+  self->ReceiveThreadAlive = false;
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusIgtlMessageReceiver::vtkProcessThread(vtkMultiThreader::ThreadInfo *data)
+{
+  vtkPlusIgtlMessageReceiver *self = (vtkPlusIgtlMessageReceiver *)(data->UserData);
+  while ( self->ProcessThreadActive )
+  {
+    if ( !self->ProcessNextMessage() )
+    {
+      // nothing to process now
+      vtkAccurateTimer::Delay(RECEIVER_IDLE_DELAY_SEC);
+    }
+  }
+  self->ProcessThreadAlive = false;
+  return NULL;
+}
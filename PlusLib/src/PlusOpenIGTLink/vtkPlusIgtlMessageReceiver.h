@@ -0,0 +1,136 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusIgtlMessageReceiver_h
+#define __vtkPlusIgtlMessageReceiver_h
+
+#include "PlusConfigure.h"
+#include "vtkObject.h"
+#include "vtkMultiThreader.h"
+#include "vtkPlusIgtlMessageFactory.h"
+#include "igtlMessageBase.h"
+#include "igtlSocket.h"
+#include <deque>
+#include <map>
+
+class vtkRecursiveCriticalSection;
+
+/*!
+\class vtkPlusIgtlMessageReceiver
+\brief Receives OpenIGTLink messages on a dedicated thread and processes them on a worker thread
+
+The receive thread reads the messages from the socket as soon as they arrive: the header and the still packed
+body of the accepted message types are read and queued, the other messages are skipped.
+The worker thread passes the queued messages to the message handler function in the order of reception,
+so the unpacking and conversion of a large message (e.g., an image) does not delay the reception of the next messages.
+
+The owner of the socket shall stop the receiver before it sends messages to the socket or closes it.
+
+\ingroup PlusLibOpenIGTLink
+*/
+class VTK_EXPORT vtkPlusIgtlMessageReceiver: public vtkObject
+{
+public:
+  static vtkPlusIgtlMessageReceiver *New();
+  vtkTypeRevisionMacro(vtkPlusIgtlMessageReceiver,vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+
+  /*!
+    Function that processes (unpacks, converts and stores) a received message. The message body is received but not unpacked yet.
+    The receiveTimestamp is the system time when the message header was received.
+  */
+  typedef PlusStatus (*MessageHandlerType)(igtl::MessageBase::Pointer message, double receiveTimestamp, void* clientData);
+
+  /*! Set the function that processes the received messages. It is called from the worker thread. */
+  void SetMessageHandler(MessageHandlerType handler, void* clientData);
+
+  /*!
+    Accept messages of the given type. The body of the accepted messages is received into a new message
+    created by the messageTypeNewPointer function, the messages of any other type are skipped.
+  */
+  void AddAcceptedMessageType(const char* messageTypeName, vtkPlusIgtlMessageFactory::PointerToMessageBaseNew messageTypeNewPointer);
+
+  /*! Set the connected socket to receive the messages from. A receive timeout shall be set for the socket. */
+  void SetSocket(igtl::Socket* socket);
+
+  /*! Start the receive and the worker thread. Returns PLUS_FAIL if any of the threads cannot be started. */
+  PlusStatus Start();
+
+  /*! Stop the receive thread and the worker thread, the messages that are not processed yet are discarded */
+  void Stop();
+
+  /*! Returns true if the receive thread stopped because of a socket error. The socket shall be reconnected and the receiver restarted then. */
+  vtkGetMacro(SocketError, bool);
+
+  /*! Get the system time when the last message header was received (or when the receiver was started, if no message has been received since then) */
+  double GetLastMessageReceiveTimestamp();
+
+  /*! Set the maximum number of received messages that wait for processing. If the queue is full then the oldest message is discarded. */
+  vtkSetMacro(MaximumNumberOfQueuedMessages, int);
+  /*! Get the maximum number of received messages that wait for processing */
+  vtkGetMacro(MaximumNumberOfQueuedMessages, int);
+
+  /*! Get the number of messages that have been discarded since the receiver was started, because the queue was full */
+  vtkGetMacro(NumberOfDiscardedMessages, int);
+
+protected:
+  vtkPlusIgtlMessageReceiver();
+  virtual ~vtkPlusIgtlMessageReceiver();
+
+  /*! Receive the next message from the socket and queue it. Returns false if no message was received. */
+  bool ReceiveNextMessage();
+
+  /*! Process the oldest queued message. Returns false if there was no message in the queue. */
+  bool ProcessNextMessage();
+
+  /*! Thread that receives the messages from the socket */
+  static void* vtkReceiveThread(vtkMultiThreader::ThreadInfo *data);
+
+  /*! Thread that processes the received messages */
+  static void* vtkProcessThread(vtkMultiThreader::ThreadInfo *data);
+
+  /*! A received message with the time of reception */
+  struct ReceivedMessage
+  {
+    igtl::MessageBase::Pointer Message;
+    double ReceiveTimestamp;
+  };
+
+  /*! Socket to receive the messages from */
+  igtl::Socket::Pointer Socket;
+
+  /*! Accepted message types and the New() static methods of their classes */
+  std::map<std::string, vtkPlusIgtlMessageFactory::PointerToMessageBaseNew> AcceptedMessageTypes;
+
+  MessageHandlerType MessageHandler;
+  void* MessageHandlerClientData;
+
+  /*! Received messages that are not processed yet, in the order of reception */
+  std::deque<ReceivedMessage> MessageQueue;
+  /*! Mutex for the message queue and the last receive timestamp */
+  vtkRecursiveCriticalSection* MessageQueueMutex;
+
+  int MaximumNumberOfQueuedMessages;
+  int NumberOfDiscardedMessages;
+  double LastMessageReceiveTimestamp;
+  bool SocketError;
+
+  vtkMultiThreader* Threader;
+  /*! Id of the receive thread in the threader, -1 if the thread is not running */
+  int ReceiveThreadId;
+  bool ReceiveThreadActive;
+  bool ReceiveThreadAlive;
+  /*! Id of the worker thread in the threader, -1 if the thread is not running */
+  int ProcessThreadId;
+  bool ProcessThreadActive;
+  bool ProcessThreadAlive;
+
+private:
+  vtkPlusIgtlMessageReceiver(const vtkPlusIgtlMessageReceiver&);
+  void operator=(const vtkPlusIgtlMessageReceiver&);
+};
+
+#endif
@@ -0,0 +1,556 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusPipelineBenchmark.cxx
+  \brief This program measures the end-to-end throughput of the data collection pipelines with synthetic load.
+  A LoadGenerator device generates frames and tool transforms, which are recorded to disk by a VirtualDiscCapture device,
+  reconstructed into a volume by a VirtualVolumeReconstructor device and broadcast by a Plus OpenIGTLink server
+  to an OpenIGTLink client in the same process. Everything runs locally, no hardware or input file is needed.
+  The load parameters are read from the configuration file and can be overridden from the command line.
+  For each stage the number of processed and dropped frames, the throughput and (where the individual frames can be
+  observed) the latency percentiles are reported. The results are appended to a CSV file for regression tracking.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkDataCollector.h"
+#include "vtkLoadGeneratorSource.h"
+#include "vtkOpenIGTLinkVideoSource.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusOpenIGTLinkServer.h"
+#include "vtkSmartPointer.h"
+#include "vtkTransformRepository.h"
+#include "vtkVirtualDiscCapture.h"
+#include "vtkVirtualVolumeReconstructor.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include "vtksys/SystemTools.hxx"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  const char RESULTS_HEADER[] = "Date,Stage,FrameWidth,FrameHeight,PixelType,AcquisitionRate,NumberOfTools,NumberOfCustomFields,TimestampJitterSec,"
+    "DurationSec,GeneratedFrames,ProcessedFrames,DroppedFrames,FramesPerSec,LatencyMeanMs,LatencyP50Ms,LatencyP95Ms,LatencyP99Ms,LatencyMaxMs";
+
+  //----------------------------------------------------------------------------
+  // Frames observed in a buffer during the measurement
+  struct BufferMonitor
+  {
+    BufferMonitor() : Buffer(NULL), Started(false), FirstItemUid(0), LastItemUid(0) {}
+    vtkPlusBuffer* Buffer;
+    bool Started;
+    BufferItemUidType FirstItemUid;
+    BufferItemUidType LastItemUid;
+    std::vector<double> LatenciesSec;
+  };
+
+  //----------------------------------------------------------------------------
+  // Results of a stage of the pipeline
+  struct StageResult
+  {
+    std::string Stage;
+    long GeneratedFrames;
+    long ProcessedFrames;
+    // Latency of the individual frames, empty if the frames of the stage cannot be observed
+    std::vector<double> LatenciesSec;
+  };
+
+  //----------------------------------------------------------------------------
+  vtkXMLDataElement* FindNestedElementWithAttribute(vtkXMLDataElement* parentElement, const char* elementName, const char* attributeName, const char* attributeValue)
+  {
+    if ( parentElement == NULL )
+    {
+      return NULL;
+    }
+    for ( int i = 0; i < parentElement->GetNumberOfNestedElements(); i++ )
+    {
+      vtkXMLDataElement* element = parentElement->GetNestedElement(i);
+      if ( element->GetName() != NULL && STRCASECMP(element->GetName(), elementName) == 0
+        && element->GetAttribute(attributeName) != NULL && STRCASECMP(element->GetAttribute(attributeName), attributeValue) == 0 )
+      {
+        return element;
+      }
+    }
+    return NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  // Override the load parameters in the device set configuration. Parameters that are not specified (negative or empty) are left unchanged.
+  PlusStatus OverrideLoadParameters(vtkXMLDataElement* configRootElement, const int frameSize[2], const std::string& pixelType, double acquisitionRate,
+    int numberOfTools, int numberOfCustomFields, double timestampJitterSec)
+  {
+    vtkXMLDataElement* dataCollectionElement = configRootElement->FindNestedElementWithName("DataCollection");
+    vtkXMLDataElement* generatorElement = FindNestedElementWithAttribute(dataCollectionElement, "Device", "Type", "LoadGenerator");
+    if ( generatorElement == NULL )
+    {
+      LOG_ERROR("LoadGenerator device is not found in the configuration");
+      return PLUS_FAIL;
+    }
+
+    if ( frameSize[0] > 0 && frameSize[1] > 0 )
+    {
+      generatorElement->SetVectorAttribute("FrameSize", 2, frameSize);
+    }
+    if ( !pixelType.empty() )
+    {
+      generatorElement->SetAttribute("PixelType", pixelType.c_str());
+    }
+    if ( numberOfCustomFields >= 0 )
+    {
+      generatorElement->SetIntAttribute("NumberOfCustomFields", numberOfCustomFields);
+    }
+    if ( timestampJitterSec >= 0 )
+    {
+      generatorElement->SetDoubleAttribute("TimestampJitterSec", timestampJitterSec);
+    }
+    if ( acquisitionRate > 0 )
+    {
+      generatorElement->SetDoubleAttribute("AcquisitionRate", acquisitionRate);
+      // Record all the generated frames
+      vtkXMLDataElement* captureElement = FindNestedElementWithAttribute(dataCollectionElement, "Device", "Type", "VirtualDiscCapture");
+      if ( captureElement != NULL )
+      {
+        captureElement->SetDoubleAttribute("RequestedFrameRate", acquisitionRate);
+      }
+    }
+
+    if ( numberOfTools >= 0 )
+    {
+      vtkXMLDataElement* dataSourcesElement = generatorElement->FindNestedElementWithName("DataSources");
+      vtkXMLDataElement* outputChannelsElement = generatorElement->FindNestedElementWithName("OutputChannels");
+      vtkXMLDataElement* outputChannelElement = ( outputChannelsElement != NULL ) ? outputChannelsElement->FindNestedElementWithName("OutputChannel") : NULL;
+      if ( dataSourcesElement == NULL || outputChannelElement == NULL )
+      {
+        LOG_ERROR("DataSources or OutputChannel element of the LoadGenerator device is not found in the configuration");
+        return PLUS_FAIL;
+      }
+      int numberOfConfiguredTools = 0;
+      for ( int i = 0; i < dataSourcesElement->GetNumberOfNestedElements(); i++ )
+      {
+        const char* type = dataSourcesElement->GetNestedElement(i)->GetAttribute("Type");
+        if ( type != NULL && STRCASECMP(type, "Tool") == 0 )
+        {
+          numberOfConfiguredTools++;
+        }
+      }
+      if ( numberOfTools < numberOfConfiguredTools )
+      {
+        LOG_ERROR("The number of tools (" << numberOfTools << ") cannot be less than the number of tools in the configuration (" << numberOfConfiguredTools << ")");
+        return PLUS_FAIL;
+      }
+      // Add the extra tools to the data sources and to the output channel
+      for ( int toolIndex = numberOfConfiguredTools; toolIndex < numberOfTools; toolIndex++ )
+      {
+        std::ostringstream toolId;
+        toolId << "Tool" << toolIndex;
+        std::ostringstream portName;
+        portName << toolIndex;
+
+        vtkSmartPointer<vtkXMLDataElement> dataSourceElement = vtkSmartPointer<vtkXMLDataElement>::New();
+        dataSourceElement->SetName("DataSource");
+        dataSourceElement->SetAttribute("Type", "Tool");
+        dataSourceElement->SetAttribute("Id", toolId.str().c_str());
+        dataSourceElement->SetAttribute("PortName", portName.str().c_str());
+        dataSourceElement->SetIntAttribute("BufferSize", 500);
+        dataSourcesElement->AddNestedElement(dataSourceElement);
+
+        vtkSmartPointer<vtkXMLDataElement> channelDataSourceElement = vtkSmartPointer<vtkXMLDataElement>::New();
+        channelDataSourceElement->SetName("DataSource");
+        channelDataSourceElement->SetAttribute("Id", toolId.str().c_str());
+        outputChannelElement->AddNestedElement(channelDataSourceElement);
+      }
+    }
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Start observing the buffer. The frames that are already in the buffer are not counted.
+  void StartMonitoring(BufferMonitor& monitor)
+  {
+    monitor.Started = ( monitor.Buffer->GetNumberOfItems() > 0 );
+    monitor.FirstItemUid = monitor.Started ? monitor.Buffer->GetLatestItemUidInBuffer() : 0;
+    monitor.LastItemUid = monitor.FirstItemUid;
+    monitor.LatenciesSec.clear();
+  }
+
+  //----------------------------------------------------------------------------
+  // Record the latency of the frames that have been added to the buffer since the previous call. The latency is the time between
+  // the timestamp of the frame (the time of generation, in the case of the OpenIGTLink client converted from the timestamp in the message)
+  // and the time when the frame is seen in the buffer.
+  void UpdateMonitoring(BufferMonitor& monitor)
+  {
+    if ( monitor.Buffer->GetNumberOfItems() == 0 )
+    {
+      return;
+    }
+    double currentTimeSec = vtkAccurateTimer::GetSystemTime();
+    BufferItemUidType latestItemUid = monitor.Buffer->GetLatestItemUidInBuffer();
+    if ( !monitor.Started )
+    {
+      // The first frames arrived after the measurement was started
+      monitor.Started = true;
+      monitor.FirstItemUid = monitor.Buffer->GetOldestItemUidInBuffer() - 1;
+      monitor.LastItemUid = monitor.FirstItemUid;
+    }
+    BufferItemUidType firstNewItemUid = std::max(monitor.LastItemUid + 1, monitor.Buffer->GetOldestItemUidInBuffer());
+    for ( BufferItemUidType itemUid = firstNewItemUid; itemUid <= latestItemUid; itemUid++ )
+    {
+      double timestamp = 0;
+      if ( monitor.Buffer->GetTimeStamp(itemUid, timestamp) == ITEM_OK )
+      {
+        monitor.LatenciesSec.push_back(currentTimeSec - timestamp);
+      }
+    }
+    monitor.LastItemUid = std::max(monitor.LastItemUid, latestItemUid);
+  }
+
+  //----------------------------------------------------------------------------
+  // Value at the given percentile (0-100) of sorted values
+  double GetPercentile(const std::vector<double>& sortedValues, double percentile)
+  {
+    if ( sortedValues.empty() )
+    {
+      return 0;
+    }
+    int index = static_cast<int>(percentile / 100.0 * (sortedValues.size() - 1) + 0.5);
+    return sortedValues[index];
+  }
+
+  //----------------------------------------------------------------------------
+  // Log the results and append them to the results file. Returns the number of errors.
+  int ReportResults(const std::vector<StageResult>& results, vtkLoadGeneratorSource* generator, double durationSec, const std::string& resultsFilePath)
+  {
+    int numberOfErrors = 0;
+
+    bool writeHeader = !vtksys::SystemTools::FileExists(resultsFilePath.c_str(), true);
+    std::ofstream resultsFile(resultsFilePath.c_str(), std::ios::out | std::ios::app);
+    if ( !resultsFile.is_open() )
+    {
+      LOG_ERROR("Failed to open the results file: " << resultsFilePath);
+      numberOfErrors++;
+    }
+    else if ( writeHeader )
+    {
+      resultsFile << RESULTS_HEADER << std::endl;
+    }
+
+    const std::string date = vtksys::SystemTools::GetCurrentDateTime("%Y-%m-%d %H:%M:%S");
+    const int numberOfTools = static_cast<int>(std::distance(generator->GetToolIteratorBegin(), generator->GetToolIteratorEnd()));
+    for ( std::vector<StageResult>::const_iterator result = results.begin(); result != results.end(); ++result )
+    {
+      long droppedFrames = std::max(0L, result->GeneratedFrames - result->ProcessedFrames);
+      double framesPerSec = result->ProcessedFrames / durationSec;
+
+      std::ostringstream latencyColumns;
+      std::ostringstream latencySummary;
+      if ( result->LatenciesSec.empty() )
+      {
+        latencyColumns << ",,,,";
+        latencySummary << "latency: n/a";
+      }
+      else
+      {
+        std::vector<double> sortedLatenciesMs(result->LatenciesSec);
+        std::sort(sortedLatenciesMs.begin(), sortedLatenciesMs.end());
+        double sumLatencyMs = 0;
+        for ( std::vector<double>::iterator latency = sortedLatenciesMs.begin(); latency != sortedLatenciesMs.end(); ++latency )
+        {
+          *latency *= 1000.0;
+          sumLatencyMs += *latency;
+        }
+        double meanLatencyMs = sumLatencyMs / sortedLatenciesMs.size();
+        latencyColumns << std::fixed << std::setprecision(3) << meanLatencyMs << "," << GetPercentile(sortedLatenciesMs, 50) << "," << GetPercentile(sortedLatenciesMs, 95)
+          << "," << GetPercentile(sortedLatenciesMs, 99) << "," << sortedLatenciesMs.back();
+        latencySummary << std::fixed << std::setprecision(1) << "latency: mean " << meanLatencyMs << " ms, p50 " << GetPercentile(sortedLatenciesMs, 50)
+          << " ms, p95 " << GetPercentile(sortedLatenciesMs, 95) << " ms, p99 " << GetPercentile(sortedLatenciesMs, 99) << " ms, max " << sortedLatenciesMs.back() << " ms";
+      }
+
+      LOG_INFO(result->Stage << ": processed " << result->ProcessedFrames << " of " << result->GeneratedFrames << " generated frames (" << std::fixed << std::setprecision(1)
+        << framesPerSec << " fps, dropped " << droppedFrames << "), " << latencySummary.str());
+
+      if ( resultsFile.is_open() )
+      {
+        resultsFile << date << "," << result->Stage << "," << generator->GetFrameSize()[0] << "," << generator->GetFrameSize()[1] << ","
+          << vtkImageScalarTypeNameMacro(generator->GetPixelType()) << "," << generator->GetAcquisitionRate() << "," << numberOfTools << ","
+          << generator->GetNumberOfCustomFields() << "," << generator->GetTimestampJitterSec() << "," << std::fixed << std::setprecision(3) << durationSec << ","
+          << result->GeneratedFrames << "," << result->ProcessedFrames << "," << droppedFrames << "," << framesPerSec << "," << latencyColumns.str() << std::endl;
+      }
+
+      if ( result->ProcessedFrames <= 0 )
+      {
+        LOG_ERROR(result->Stage << ": no frames have been processed");
+        numberOfErrors++;
+      }
+    }
+
+    LOG_INFO("Benchmark results are written to " << resultsFilePath);
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  std::string inputConfigFileName;
+  std::string resultsFileName("PlusPipelineBenchmarkResults.csv");
+  double warmupTimeSec(1.0);
+  double durationSec(5.0);
+  bool keepRecording(false);
+  int frameSize[2] = {-1, -1};
+  std::string pixelType;
+  double acquisitionRate(-1);
+  int numberOfTools(-1);
+  int numberOfCustomFields(-1);
+  double timestampJitterSec(-1);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Name of the device set configuration file that contains a LoadGenerator device.");
+  args.AddArgument("--results-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &resultsFileName, "Name of the CSV file in the output directory that the results are appended to (Default: PlusPipelineBenchmarkResults.csv).");
+  args.AddArgument("--warmup-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &warmupTimeSec, "Time between starting the pipelines and starting the measurement (Default: 1.0).");
+  args.AddArgument("--duration-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &durationSec, "Duration of the measurement (Default: 5.0).");
+  args.AddArgument("--keep-recording", vtksys::CommandLineArguments::NO_ARGUMENT, &keepRecording, "Keep the file recorded by the disc capture device.");
+  args.AddArgument("--frame-width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[0], "Override the width of the generated frames in pixels.");
+  args.AddArgument("--frame-height", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameSize[1], "Override the height of the generated frames in pixels.");
+  args.AddArgument("--pixel-type", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &pixelType, "Override the pixel type of the generated frames (UnsignedChar, Char, UnsignedShort, Short, Float).");
+  args.AddArgument("--acquisition-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionRate, "Override the frame rate of the load generator.");
+  args.AddArgument("--number-of-tools", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfTools, "Override the number of generated tools. Tools are added to the configured ones.");
+  args.AddArgument("--number-of-custom-fields", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfCustomFields, "Override the number of custom fields of the generated frames.");
+  args.AddArgument("--timestamp-jitter-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &timestampJitterSec, "Override the maximum random delay of the generated frames.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( inputConfigFileName.empty() )
+  {
+    LOG_ERROR("--config-file argument is required!");
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if ( durationSec <= 0 || warmupTimeSec < 0 )
+  {
+    std::cerr << "Invalid arguments" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // Read and adjust the configuration
+  std::string configFilePath = vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationPath(inputConfigFileName);
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+    vtkXMLUtilities::ReadElementFromFile(configFilePath.c_str()));
+  if ( configRootElement == NULL )
+  {
+    LOG_ERROR("Unable to read configuration from file " << configFilePath);
+    exit(EXIT_FAILURE);
+  }
+  if ( OverrideLoadParameters(configRootElement, frameSize, pixelType, acquisitionRate, numberOfTools, numberOfCustomFields, timestampJitterSec) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to override the load parameters");
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  // Start the pipelines, in the same way as vtkPlusOpenIGTLinkServer::Start does, but from the adjusted configuration
+  vtkSmartPointer<vtkDataCollector> dataCollector = vtkSmartPointer<vtkDataCollector>::New();
+  vtkSmartPointer<vtkTransformRepository> transformRepository = vtkSmartPointer<vtkTransformRepository>::New();
+  if ( dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS || transformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to read the configuration");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkLoadGeneratorSource* generator = NULL;
+  vtkVirtualDiscCapture* capture = NULL;
+  vtkVirtualVolumeReconstructor* volumeReconstructor = NULL;
+  for ( DeviceCollectionConstIterator it = dataCollector->GetDeviceConstIteratorBegin(); it != dataCollector->GetDeviceConstIteratorEnd(); ++it )
+  {
+    if ( generator == NULL ) { generator = vtkLoadGeneratorSource::SafeDownCast(*it); }
+    if ( capture == NULL ) { capture = vtkVirtualDiscCapture::SafeDownCast(*it); }
+    if ( volumeReconstructor == NULL ) { volumeReconstructor = vtkVirtualVolumeReconstructor::SafeDownCast(*it); }
+  }
+  if ( generator == NULL || generator->OutputChannelCount() == 0 )
+  {
+    LOG_ERROR("LoadGenerator device with an output channel is not found in the configuration");
+    exit(EXIT_FAILURE);
+  }
+
+  if ( dataCollector->Connect() != PLUS_SUCCESS || dataCollector->Start() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to start the data collection");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkPlusOpenIGTLinkServer> server = vtkSmartPointer<vtkPlusOpenIGTLinkServer>::New();
+  server->SetDataCollector(dataCollector);
+  if ( server->ReadConfiguration(configRootElement, configFilePath.c_str()) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to read PlusOpenIGTLinkServer configuration");
+    server->Stop();
+    exit(EXIT_FAILURE);
+  }
+  server->SetTransformRepository(transformRepository);
+  if ( server->StartOpenIGTLinkService() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to start Plus OpenIGTLink server");
+    server->Stop();
+    exit(EXIT_FAILURE);
+  }
+
+  if ( volumeReconstructor != NULL )
+  {
+    volumeReconstructor->UpdateTransformRepository(transformRepository);
+    volumeReconstructor->SetEnableReconstruction(true);
+  }
+
+  // OpenIGTLink loopback client
+  vtkSmartPointer<vtkOpenIGTLinkVideoSource> client = vtkSmartPointer<vtkOpenIGTLinkVideoSource>::New();
+  client->SetDeviceId("BenchmarkClientDevice");
+  client->SetMessageType("TrackedFrame");
+  client->SetServerAddress("127.0.0.1");
+  client->SetServerPort(server->GetListeningPort());
+  client->SetAcquisitionRate(generator->GetAcquisitionRate());
+  vtkSmartPointer<vtkPlusDataSource> clientVideoSource = vtkSmartPointer<vtkPlusDataSource>::New();
+  clientVideoSource->SetSourceId("Video");
+  clientVideoSource->SetType(DATA_SOURCE_TYPE_VIDEO);
+  clientVideoSource->SetPortImageOrientation(US_IMG_ORIENT_MF);
+  clientVideoSource->GetBuffer()->SetImageOrientation(US_IMG_ORIENT_MF);
+  clientVideoSource->GetBuffer()->SetBufferSize(100);
+  client->AddVideo(clientVideoSource);
+  vtkSmartPointer<vtkPlusChannel> clientChannel = vtkSmartPointer<vtkPlusChannel>::New();
+  clientChannel->SetOwnerDevice(client);
+  clientChannel->SetVideoSource(clientVideoSource);
+  client->AddOutputChannel(clientChannel);
+  if ( client->StartRecording() != PLUS_SUCCESS )
+  {
+    LOG_ERROR("Failed to connect the OpenIGTLink client to the server");
+    client->Disconnect();
+    server->Stop();
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusChannel* generatorChannel = *(generator->GetOutputChannelsStart());
+  vtkPlusDataSource* generatorVideoSource = NULL;
+  if ( generatorChannel->GetVideoSource(generatorVideoSource) != PLUS_SUCCESS )
+  {
+    LOG_ERROR("The output channel of the LoadGenerator device has no video source");
+    client->StopRecording();
+    client->Disconnect();
+    server->Stop();
+    exit(EXIT_FAILURE);
+  }
+
+  vtkAccurateTimer::Delay(warmupTimeSec);
+
+  // Measurement
+  LOG_INFO("Measuring for " << durationSec << " sec...");
+  BufferMonitor channelMonitor;
+  channelMonitor.Buffer = generatorVideoSource->GetBuffer();
+  BufferMonitor clientMonitor;
+  clientMonitor.Buffer = clientVideoSource->GetBuffer();
+  StartMonitoring(channelMonitor);
+  StartMonitoring(clientMonitor);
+  const long generatedFramesAtStart = generator->GetNumberOfGeneratedFrames();
+  const long capturedFramesAtStart = ( capture != NULL ) ? capture->GetTotalFramesRecorded() : 0;
+  const long reconstructedFramesAtStart = ( volumeReconstructor != NULL ) ? volumeReconstructor->GetTotalFramesRecorded() : 0;
+
+  const double startTimeSec = vtkAccurateTimer::GetSystemTime();
+  while ( vtkAccurateTimer::GetSystemTime() - startTimeSec < durationSec )
+  {
+    UpdateMonitoring(channelMonitor);
+    UpdateMonitoring(clientMonitor);
+    vtkAccurateTimer::Delay(0.001);
+  }
+  UpdateMonitoring(channelMonitor);
+  UpdateMonitoring(clientMonitor);
+  const double measuredDurationSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+
+  const long generatedFrames = generator->GetNumberOfGeneratedFrames() - generatedFramesAtStart;
+  std::vector<StageResult> results;
+  StageResult channelResult;
+  channelResult.Stage = "Channel";
+  channelResult.GeneratedFrames = generatedFrames;
+  channelResult.ProcessedFrames = static_cast<long>(channelMonitor.LastItemUid - channelMonitor.FirstItemUid);
+  channelResult.LatenciesSec = channelMonitor.LatenciesSec;
+  results.push_back(channelResult);
+  if ( capture != NULL )
+  {
+    StageResult captureResult;
+    captureResult.Stage = "DiscCapture";
+    captureResult.GeneratedFrames = generatedFrames;
+    captureResult.ProcessedFrames = capture->GetTotalFramesRecorded() - capturedFramesAtStart;
+    results.push_back(captureResult);
+  }
+  if ( volumeReconstructor != NULL )
+  {
+    StageResult reconstructionResult;
+    reconstructionResult.Stage = "VolumeReconstruction";
+    reconstructionResult.GeneratedFrames = generatedFrames;
+    reconstructionResult.ProcessedFrames = volumeReconstructor->GetTotalFramesRecorded() - reconstructedFramesAtStart;
+    results.push_back(reconstructionResult);
+  }
+  StageResult clientResult;
+  clientResult.Stage = "OpenIGTLinkLoopback";
+  clientResult.GeneratedFrames = generatedFrames;
+  clientResult.ProcessedFrames = static_cast<long>(clientMonitor.LastItemUid - clientMonitor.FirstItemUid);
+  clientResult.LatenciesSec = clientMonitor.LatenciesSec;
+  results.push_back(clientResult);
+
+  int numberOfErrors = ReportResults(results, generator, measuredDurationSec, vtkPlusConfig::GetInstance()->GetOutputPath(resultsFileName));
+
+  // Stop the pipelines
+  std::string recordingFilePath = ( capture != NULL ) ? capture->GetOutputFileName() : "";
+  client->StopRecording();
+  client->Disconnect();
+  if ( volumeReconstructor != NULL )
+  {
+    volumeReconstructor->SetEnableReconstruction(false);
+  }
+  server->Stop();
+
+  if ( !keepRecording && !recordingFilePath.empty() )
+  {
+    // The disc capture device writes the device set configuration next to the recording
+    std::string recordingConfigFilePath = vtksys::SystemTools::GetFilenamePath(recordingFilePath) + "/"
+      + vtksys::SystemTools::GetFilenameWithoutExtension(recordingFilePath) + "_config.xml";
+    vtksys::SystemTools::RemoveFile(recordingFilePath.c_str());
+    vtksys::SystemTools::RemoveFile(recordingConfigFilePath.c_str());
+  }
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("PlusPipelineBenchmark failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("PlusPipelineBenchmark completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -16,6 +16,7 @@ See License.txt for details.
 #endif
 #include "vtkPlusRequestIdsCommand.h"
 #include "vtkPlusSaveConfigCommand.h"
+#include "vtkPlusTraceCommand.h"
 #include "vtkPlusStartStopRecordingCommand.h"
 #include "vtkPlusUpdateTransformCommand.h"
 #include "vtkRecursiveCriticalSection.h"
@@ -57,6 +58,11 @@ vtkPlusCommandProcessor::vtkPlusCommandProcessor()
     RegisterPlusCommand(cmd);
     cmd->Delete();
   }
+  {
+    vtkPlusCommand* cmd = vtkPlusTraceCommand::New();
+    RegisterPlusCommand(cmd);
+    cmd->Delete();
+  }
 #ifdef PLUS_USE_STEALTHLINK
   {
     vtkPlusCommand* cmd = vtkPlusStealthLinkCommand::New();
@@ -13,11 +13,14 @@ See License.txt for details.
 #include "vtkDataCollector.h"
 #include "vtkImageData.h"
 #include "vtkObjectFactory.h"
+#include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusCommandProcessor.h"
+#include "vtkPlusDataSource.h"
 #include "vtkPlusIgtlMessageCommon.h"
 #include "vtkPlusIgtlMessageFactory.h" 
 #include "vtkPlusOpenIGTLinkServer.h"
+#include "vtkPlusTracer.h"
 #include "vtkRecursiveCriticalSection.h"
 #include "vtkTrackedFrameList.h"
 #include "vtkTransformRepository.h" 
@@ -652,6 +655,20 @@ void* vtkPlusOpenIGTLinkServer::DataReceiverThread( vtkMultiThreader::ThreadInfo
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame( TrackedFrame& trackedFrame )
 {
+  PlusTraceScope traceScope("vtkPlusOpenIGTLinkServer::SendTrackedFrame");
+
+  // The tracked frame is made of the video buffer item that has the same timestamp. Its UID is added to the trace event,
+  // so that the sending can be correlated with the acquisition of the frame (the lookup is skipped if tracing is disabled).
+  vtkPlusDataSource* videoSource = NULL;
+  if ( vtkPlusTracer::IsEnabled() && this->BroadcastChannel != NULL && this->BroadcastChannel->GetVideoSource(videoSource) == PLUS_SUCCESS )
+  {
+    BufferItemUidType frameUid = 0;
+    if ( videoSource->GetBuffer()->GetItemUidFromTime(trackedFrame.GetTimestamp(), frameUid) == ITEM_OK )
+    {
+      traceScope.SetFrameUid(frameUid);
+    }
+  }
+
   int numberOfErrors = 0; 
 
   // Update transform repository with the tracked frame 
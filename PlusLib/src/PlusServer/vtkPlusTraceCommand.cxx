@@ -0,0 +1,158 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/ 
+
+#include "PlusConfigure.h"
+#include "vtkPlusTraceCommand.h"
+#include "vtkPlusTracer.h"
+#include "vtksys/SystemTools.hxx"
+
+vtkStandardNewMacro( vtkPlusTraceCommand );
+
+static const char START_TRACING_CMD[]="StartTracing";
+static const char STOP_TRACING_CMD[]="StopTracing";
+static const char REQUEST_TRACE_STATISTICS_CMD[]="RequestTraceStatistics";
+static const char SAVE_TRACE_CMD[]="SaveTrace";
+
+static const char DEFAULT_TRACE_FILENAME[]="PlusTrace.json";
+
+//----------------------------------------------------------------------------
+vtkPlusTraceCommand::vtkPlusTraceCommand()
+: Filename(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusTraceCommand::~vtkPlusTraceCommand()
+{
+  this->SetFilename(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTraceCommand::SetNameToStartTracing() { SetName(START_TRACING_CMD); }
+void vtkPlusTraceCommand::SetNameToStopTracing() { SetName(STOP_TRACING_CMD); }
+void vtkPlusTraceCommand::SetNameToRequestTraceStatistics() { SetName(REQUEST_TRACE_STATISTICS_CMD); }
+void vtkPlusTraceCommand::SetNameToSaveTrace() { SetName(SAVE_TRACE_CMD); }
+
+//----------------------------------------------------------------------------
+void vtkPlusTraceCommand::GetCommandNames(std::list<std::string> &cmdNames)
+{ 
+  cmdNames.clear(); 
+  cmdNames.push_back(START_TRACING_CMD);
+  cmdNames.push_back(STOP_TRACING_CMD);
+  cmdNames.push_back(REQUEST_TRACE_STATISTICS_CMD);
+  cmdNames.push_back(SAVE_TRACE_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusTraceCommand::GetDescription(const char* commandName)
+{ 
+  std::string desc;
+  if (commandName == NULL || STRCASECMP(commandName, START_TRACING_CMD) == 0)
+  {
+    desc += START_TRACING_CMD;
+    desc += ": Clear the previously recorded trace events and start recording the execution time of the processing stages.";
+  }
+  if (commandName == NULL || STRCASECMP(commandName, STOP_TRACING_CMD) == 0)
+  {
+    desc += STOP_TRACING_CMD;
+    desc += ": Stop recording the execution time of the processing stages.";
+  }
+  if (commandName == NULL || STRCASECMP(commandName, REQUEST_TRACE_STATISTICS_CMD) == 0)
+  {
+    desc += REQUEST_TRACE_STATISTICS_CMD;
+    desc += ": Request the execution time statistics and histogram of each traced processing stage.";
+  }
+  if (commandName == NULL || STRCASECMP(commandName, SAVE_TRACE_CMD) == 0)
+  {
+    desc += SAVE_TRACE_CMD;
+    desc += ": Save the recorded trace events in Chrome trace format (JSON). Attributes: Filename: name of the output file (default: ";
+    desc += DEFAULT_TRACE_FILENAME;
+    desc += " in the output directory)";
+  }
+  return desc;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTraceCommand::PrintSelf( ostream& os, vtkIndent indent )
+{
+  this->Superclass::PrintSelf( os, indent );
+  os << indent << "Filename: " << (this->Filename ? this->Filename : "(none)") << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTraceCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
+{  
+  if (vtkPlusCommand::ReadConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->SetFilename(aConfig->GetAttribute("Filename"));
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTraceCommand::WriteConfiguration(vtkXMLDataElement* aConfig)
+{  
+  if (vtkPlusCommand::WriteConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (this->Filename != NULL)
+  {
+    aConfig->SetAttribute("Filename", this->Filename);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTraceCommand::Execute()
+{
+  ResetResponse();
+
+  if (this->Name == NULL)
+  {
+    this->ResponseMessage="Command failed, no command name specified";
+    return PLUS_FAIL;
+  }
+
+  vtkPlusTracer* tracer = vtkPlusTracer::Instance();
+
+  if (STRCASECMP(this->Name, START_TRACING_CMD) == 0)
+  {
+    tracer->SetEnabled(true);
+    this->ResponseMessage="Tracing started";
+    return PLUS_SUCCESS;
+  }
+  else if (STRCASECMP(this->Name, STOP_TRACING_CMD) == 0)
+  {
+    tracer->SetEnabled(false);
+    this->ResponseMessage="Tracing stopped";
+    return PLUS_SUCCESS;
+  }
+  else if (STRCASECMP(this->Name, REQUEST_TRACE_STATISTICS_CMD) == 0)
+  {
+    tracer->GetStatistics(this->ResponseMessage);
+    return PLUS_SUCCESS;
+  }
+  else if (STRCASECMP(this->Name, SAVE_TRACE_CMD) == 0)
+  {
+    std::string filename = (this->Filename != NULL) ? this->Filename : DEFAULT_TRACE_FILENAME;
+    if (!vtksys::SystemTools::FileIsFullPath(filename.c_str()))
+    {
+      filename = vtkPlusConfig::GetInstance()->GetOutputPath(filename);
+    }
+    if (tracer->WriteChromeTrace(filename) != PLUS_SUCCESS)
+    {
+      this->ResponseMessage = std::string("Failed to save trace to ") + filename;
+      return PLUS_FAIL;
+    }
+    this->ResponseMessage = std::string("Trace saved to ") + filename;
+    return PLUS_SUCCESS;
+  }
+
+  this->ResponseMessage="Unknown command, failed";
+  return PLUS_FAIL;    
+}
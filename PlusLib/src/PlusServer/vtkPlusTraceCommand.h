@@ -0,0 +1,63 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/ 
+
+#ifndef __vtkPlusTraceCommand_h
+#define __vtkPlusTraceCommand_h
+
+#include "vtkPlusCommand.h"
+
+/*!
+  \class vtkPlusTraceCommand 
+  \brief This command controls the pipeline tracing (see vtkPlusTracer): start/stop tracing,
+  get the latency statistics of the traced stages, save the recorded events in Chrome trace format
+  \ingroup PlusLibPlusServer
+ */ 
+class VTK_EXPORT vtkPlusTraceCommand : public vtkPlusCommand
+{
+public:
+
+  static vtkPlusTraceCommand *New();
+  vtkTypeMacro(vtkPlusTraceCommand, vtkPlusCommand);
+  virtual void PrintSelf( ostream& os, vtkIndent indent );
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  /*! Executes the command  */
+  virtual PlusStatus Execute();
+
+  /*! Read command parameters from XML */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Write command parameters to XML */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Get all the command names that this class can execute */
+  virtual void GetCommandNames(std::list<std::string> &cmdNames);
+
+  /*! Gets the description for the specified command name. */
+  virtual std::string GetDescription(const char* commandName);
+
+  /*! Name of the file where the trace is saved (used by the SaveTrace command). If the path is relative then it is relative to the output directory. */
+  vtkGetStringMacro(Filename);
+  vtkSetStringMacro(Filename);
+
+  void SetNameToStartTracing();
+  void SetNameToStopTracing();
+  void SetNameToRequestTraceStatistics();
+  void SetNameToSaveTrace();
+
+protected:
+  vtkPlusTraceCommand();
+  virtual ~vtkPlusTraceCommand();
+
+private:
+  char* Filename;
+
+  vtkPlusTraceCommand( const vtkPlusTraceCommand& );
+  void operator=( const vtkPlusTraceCommand& );
+};
+
+
+#endif
@@ -6,18 +6,41 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "TrackedFrame.h"
+#include "vtkAccurateTimer.h"
 #include "vtkImageData.h" 
 #include "vtkMetaImageSequenceIO.h"
 #include "vtkRfProcessor.h"
 #include "vtkSmartPointer.h"
 #include "vtkTrackedFrameList.h"
 #include "vtkTransform.h"
+#include "vtkUsScanConvert.h"
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
 #include "vtksys/SystemTools.hxx"
 #include <iomanip>
 #include <iostream>
 
+//-----------------------------------------------------------------------------
+// Measure the average time of scan converting the current input of the scan converter, using one thread and using all threads
+void BenchmarkScanConversion(vtkUsScanConvert* scanConverter, int numberOfRepetitions)
+{
+  int defaultNumberOfThreads=scanConverter->GetNumberOfThreads();
+  int numberOfThreadsToTest[2]={1, defaultNumberOfThreads};
+  for (int i=0; i<2; i++)
+  {
+    scanConverter->SetNumberOfThreads(numberOfThreadsToTest[i]);
+    double startTimeSec=vtkAccurateTimer::GetSystemTime();
+    for (int repetition=0; repetition<numberOfRepetitions; repetition++)
+    {
+      scanConverter->Modified();
+      scanConverter->Update();
+    }
+    double elapsedTimeSec=vtkAccurateTimer::GetSystemTime()-startTimeSec;
+    LOG_INFO("Average scan conversion time with "<<numberOfThreadsToTest[i]<<" thread(s): "<<std::fixed<<std::setprecision(3)
+      <<1000.0*elapsedTimeSec/numberOfRepetitions<<" ms");
+  }
+  scanConverter->SetNumberOfThreads(defaultNumberOfThreads);
+}
 
 //-----------------------------------------------------------------------------
 int main(int argc, char **argv)
@@ -26,6 +49,7 @@ int main(int argc, char **argv)
   std::string inputConfigFile;
   std::string outputImgFile;
   std::string operation="BRIGHTNESS_SCAN_CONVERT";
+  int benchmarkRepetitions=0;
 
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -36,6 +60,7 @@ int main(int argc, char **argv)
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFile, "Config file containing processing parameters");
   args.AddArgument("--output-img-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputImgFile, "File name of the generated output brightness image");
   args.AddArgument("--operation", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &operation, "Processing operation to be applied on the input file (BRIGHTNESS_CONVERT, BRIGHTNESS_SCAN_CONVERT, default: BRIGHTNESS_SCAN_CONVERT");
+  args.AddArgument("--benchmark-repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &benchmarkRepetitions, "If larger than 0 then the scan conversion of the first frame is repeated the specified number of times and the average computation time is reported (default: 0)");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
 
@@ -140,6 +165,10 @@ int main(int argc, char **argv)
       {
         // do brightness and scan conversion
         vtkImageData* brightnessImage = rfProcessor->GetBrightessScanConvertedImage();
+        if (j==0 && benchmarkRepetitions>0 && rfProcessor->GetScanConverter()!=NULL)
+        {
+          BenchmarkScanConversion(rfProcessor->GetScanConverter(), benchmarkRepetitions);
+        }
         // Update the pixel data in the frame
         rfFrame->GetImageData()->DeepCopyFrom(brightnessImage);    
         rfFrame->GetImageData()->SetImageOrientation(US_IMG_ORIENT_MF); 
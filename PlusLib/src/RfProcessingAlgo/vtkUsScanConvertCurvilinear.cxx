@@ -31,6 +31,7 @@ non-commercial terms in your toolbox and distribute it."
 #include <math.h>
 #include <string.h>
 #include <ctype.h>
+#include <algorithm>
 
 vtkStandardNewMacro(vtkUsScanConvertCurvilinear);
 
@@ -44,7 +45,7 @@ vtkUsScanConvertCurvilinear::vtkUsScanConvertCurvilinear()
   this->ThetaStopDeg=30.0;
   this->OutputIntensityScaling=1.0;
 
-  // Values that are used for computing the InterpolatedPointArray
+  // Values that are used for computing the InterpolationTable
   this->InterpInputImageExtent[0]=0;
   this->InterpInputImageExtent[1]=-1;
   this->InterpInputImageExtent[2]=0;
@@ -67,6 +68,7 @@ vtkUsScanConvertCurvilinear::vtkUsScanConvertCurvilinear()
   this->InterpTransducerCenterPixel[0]=0.0;
   this->InterpTransducerCenterPixel[1]=0.0;
   this->InterpIntensityScaling=0.0;
+  this->InterpolationTable.IntensityScaling=1.0;
 }
 
 //----------------------------------------------------------------------------
@@ -75,11 +77,11 @@ vtkUsScanConvertCurvilinear::~vtkUsScanConvertCurvilinear()
 }
 
 //----------------------------------------------------------------------------
-void vtkUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
+void vtkUsScanConvertCurvilinear::ComputeInterpolationTable(
   int *inputImageExtent, double radiusStartMm, double radiusStopMm, double thetaStartDeg, double thetaStopDeg,
   int *outputImageExtent, double *outputImageSpacing, double* transducerCenterPixel, double intensityScaling)
 {
-  // Computing the point array is a costly operation, so perform it only if a scan conversion parameter has been changed
+  // Computing the interpolation table is a costly operation, so perform it only if a scan conversion parameter has been changed
 
   // Check if any scan conversion parameter has been changed
   bool modifiedScanConversionParams=false;
@@ -89,7 +91,7 @@ void vtkUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
     {
       modifiedScanConversionParams=true;
     }
-    if (this->OutputImageExtent[i]!=outputImageExtent[i])
+    if (this->InterpOutputImageExtent[i]!=outputImageExtent[i])
     {
       modifiedScanConversionParams=true;
     }
@@ -114,16 +116,16 @@ void vtkUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
 
   if (!modifiedScanConversionParams)
   {
-    // scan conversion parameters haven't been modified since the InterpolatedPointArray was last computed
+    // scan conversion parameters haven't been modified since the InterpolationTable was last computed
     // there is no need to recompute, just return
     return;
   }
 
-  // remember the current scan conversion parameters that are used to compute the interpolated point array
+  // remember the current scan conversion parameters that are used to compute the interpolation table
   for (int i=0; i<6; i++)
   {
     this->InterpInputImageExtent[i]=inputImageExtent[i];
-    this->OutputImageExtent[i]=outputImageExtent[i];
+    this->InterpOutputImageExtent[i]=outputImageExtent[i];
   }
   for (int i=0; i<3; i++)
   {
@@ -137,9 +139,10 @@ void vtkUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
   this->InterpTransducerCenterPixel[1]=transducerCenterPixel[1];
   this->InterpIntensityScaling=intensityScaling;
 
-  // Compute the interpolated point array now
+  // Compute the interpolation table now
 
-  this->InterpolatedPointArray.clear();
+  InterpolationTableType table;
+  table.IntensityScaling=intensityScaling;
 
   int numberOfSamples=inputImageExtent[1]-inputImageExtent[0]+1;
   int numberOfLines=inputImageExtent[3]-inputImageExtent[2]+1;
@@ -157,12 +160,16 @@ void vtkUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
   double dx = outputImageSpacing[0];
   double dz = outputImageSpacing[1];  
 
+  table.RowFirstRunIndices.reserve(outputImageSizePixelsY+1);
+
   // Starting depth in image coordinates in mm
   double z = radiusStartMm-this->InterpTransducerCenterPixel[1]*dz;
   for (int i=0; i<outputImageSizePixelsY; i++)
   {
     double x=-(this->InterpTransducerCenterPixel[0]-0.5)*dx; // image coordinate, in mm
     double z2 = z*z;
+    bool previousPixelInside=false;
+    table.RowFirstRunIndices.push_back(table.RunOutputPixelIndices.size());
 
     for (int j=0; j<outputImageSizePixelsX; j++)
     {
@@ -178,27 +185,37 @@ void vtkUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
         (index_line >= 0) && (index_line+1 < numberOfLines))
       {
         // The sample is inside the input image, so it can be computed
-        InterpolatedPoint ip;
-        double samp_val = samp - index_samp; // Sub-sample fraction for interpolation
-        double line_val = line - index_line; // Sub-line fraction for interpolation
-
-        //  Calculate the coefficients
-        ip.weightCoefficients[0] = (1-samp_val)*(1-line_val)*intensityScaling;
-        ip.weightCoefficients[1] =    samp_val *(1-line_val)*intensityScaling;
-        ip.weightCoefficients[2] = (1-samp_val)* line_val   *intensityScaling;
-        ip.weightCoefficients[3] =    samp_val * line_val   *intensityScaling;
-
-        ip.inputPixelIndex = index_samp + index_line*numberOfSamples;
-        ip.outputPixelIndex = j + outputImageSizePixelsX*i;
-        
-        this->InterpolatedPointArray.push_back(ip);
+        if (!previousPixelInside)
+        {
+          // Start a new run of consecutive output pixels
+          table.RunOutputPixelIndices.push_back(j + outputImageSizePixelsX*i);
+          table.RunFirstPointIndices.push_back(table.InputPixelIndices.size());
+        }
+        table.SampleFractions.push_back(samp - index_samp); // Sub-sample fraction for interpolation
+        table.LineFractions.push_back(line - index_line); // Sub-line fraction for interpolation
+        table.InputPixelIndices.push_back(index_samp + index_line*numberOfSamples);
+        previousPixelInside=true;
+      }
+      else
+      {
+        previousPixelInside=false;
       }
 
       x = x + dx;
     }
     z = z + dz;
   }
-
+  table.RowFirstRunIndices.push_back(table.RunOutputPixelIndices.size());
+  table.RunFirstPointIndices.push_back(table.InputPixelIndices.size());
+
+  // Copy the arrays to release the unused capacity
+  std::vector<double>(table.SampleFractions).swap(this->InterpolationTable.SampleFractions);
+  std::vector<double>(table.LineFractions).swap(this->InterpolationTable.LineFractions);
+  std::vector<int>(table.InputPixelIndices).swap(this->InterpolationTable.InputPixelIndices);
+  std::vector<int>(table.RunOutputPixelIndices).swap(this->InterpolationTable.RunOutputPixelIndices);
+  std::vector<int>(table.RunFirstPointIndices).swap(this->InterpolationTable.RunFirstPointIndices);
+  std::vector<int>(table.RowFirstRunIndices).swap(this->InterpolationTable.RowFirstRunIndices);
+  this->InterpolationTable.IntensityScaling=table.IntensityScaling;
 }
 
 //----------------------------------------------------------------------------
@@ -222,7 +239,7 @@ int vtkUsScanConvertCurvilinear::RequestInformation (vtkInformation * vtkNotUsed
   //inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),inExtent, 6);
 
   // Create the interpolation table. It is recomputed only if the scan conversion parameters change.
-  ComputeInterpolatedPointArray(inExtent, this->RadiusStartMm, this->RadiusStopMm, this->ThetaStartDeg, this->ThetaStopDeg,
+  ComputeInterpolationTable(inExtent, this->RadiusStartMm, this->RadiusStopMm, this->ThetaStartDeg, this->ThetaStopDeg,
     this->OutputImageExtent, this->OutputImageSpacing, this->TransducerCenterPixel, this->OutputIntensityScaling);
 
   return 1;
@@ -290,32 +307,54 @@ void vtkUsScanConvertCurvilinear::AllocateOutputData(vtkImageData *output, vtkIn
 //----------------------------------------------------------------------------
 // The templated execute function handles all the data types.
 // T: originally developed for unsigned int 
+// rowExt[2] and rowExt[3] define the range of output image rows that this thread computes.
 template <class T>
 void vtkUsScanConvertExecute(vtkUsScanConvertCurvilinear *self,
                              vtkImageData *inData, T *inPtr,
                              vtkImageData *outData, T *outPtr,
-                             int interpolationTableExt[6], int id)
+                             int rowExt[6], int id)
 {
-  T *envelope_data=inPtr; // The envelope detected and log-compressed data
+  const vtkUsScanConvertCurvilinear::InterpolationTableType& table=self->GetInterpolationTable();
+  if (table.InputPixelIndices.empty())
+  {
+    // the scanned area does not overlap with the output image
+    return;
+  }
+
+  const T *envelope_data=inPtr; // The envelope detected and log-compressed data
 #if (VTK_MAJOR_VERSION < 6)
   int numberOfSamples=inData->GetWholeExtent()[1]-inData->GetWholeExtent()[0]+1; // Number of samples in one envelope line
 #else
   int numberOfSamples=inData->GetExtent()[1]-inData->GetExtent()[0]+1; // Number of samples in one envelope line
 #endif
 
-  T *image=outPtr; // The resulting image
+  // Access the table through raw pointers to keep the inner loop simple enough for the compiler to vectorize
+  const double *sampleFractions=&(table.SampleFractions[0]);
+  const double *lineFractions=&(table.LineFractions[0]);
+  const int *inputPixelIndices=&(table.InputPixelIndices[0]);
+  const int *runFirstPointIndices=&(table.RunFirstPointIndices[0]);
+  const double intensityScaling=table.IntensityScaling;
 
-  std::vector<vtkUsScanConvertCurvilinear::InterpolatedPoint>::const_iterator firstPoint=self->GetInterpolatedPointArray().begin()+interpolationTableExt[0];
-  std::vector<vtkUsScanConvertCurvilinear::InterpolatedPoint>::const_iterator afterLastPoint=self->GetInterpolatedPointArray().begin()+interpolationTableExt[1]+1;
-  for (std::vector<vtkUsScanConvertCurvilinear::InterpolatedPoint>::const_iterator it=firstPoint; it!=afterLastPoint; ++it)
+  int firstRun=table.RowFirstRunIndices[rowExt[2]];
+  int afterLastRun=table.RowFirstRunIndices[rowExt[3]+1];
+  for (int run=firstRun; run<afterLastRun; ++run)
   {
-    T *env_pointer = (T*) &(envelope_data[it->inputPixelIndex]); // Pointer to the envelope data
-    image[it->outputPixelIndex] =
-      it->weightCoefficients[0] * env_pointer[0] // (+0, +0)
-    + it->weightCoefficients[1] * env_pointer[1] // (+1, +0)
-    + it->weightCoefficients[2] * env_pointer[numberOfSamples] // (+0, +1)
-    + it->weightCoefficients[3] * env_pointer[numberOfSamples+1] // (+1, +1)
-    + 0.5; // for rounding
+    T *image=outPtr+table.RunOutputPixelIndices[run]; // The resulting image
+    int afterLastPoint=runFirstPointIndices[run+1];
+    for (int point=runFirstPointIndices[run]; point<afterLastPoint; ++point, ++image)
+    {
+      double samp_val=sampleFractions[point]; // Sub-sample fraction for interpolation
+      double line_val=lineFractions[point]; // Sub-line fraction for interpolation
+      const T *env_pointer=envelope_data+inputPixelIndices[point]; // Pointer to the envelope data
+      // The weighting coefficients are computed with the same operations as in the original
+      // precomputed table, so that the output is exactly the same.
+      *image =
+        (1-samp_val)*(1-line_val)*intensityScaling * env_pointer[0] // (+0, +0)
+      +    samp_val *(1-line_val)*intensityScaling * env_pointer[1] // (+1, +0)
+      + (1-samp_val)* line_val   *intensityScaling * env_pointer[numberOfSamples] // (+0, +1)
+      +    samp_val * line_val   *intensityScaling * env_pointer[numberOfSamples+1] // (+1, +1)
+      + 0.5; // for rounding
+    }
   }
 }
 
@@ -366,14 +405,18 @@ void vtkUsScanConvertCurvilinear::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "ThetaStartDeg: "<< this->ThetaStartDeg << "\n";
   os << indent << "ThetaStopDeg: "<< this->ThetaStopDeg << "\n";
   os << indent << "OutputIntensityScaling: "<< this->OutputIntensityScaling << "\n";
-  os << indent << "InterpolatedPointArraySize: "<< this->InterpolatedPointArray.size() << "\n";
+  os << indent << "InterpolationTableNumberOfPoints: "<< this->InterpolationTable.InputPixelIndices.size() << "\n";
+  os << indent << "InterpolationTableNumberOfRuns: "<< this->InterpolationTable.RunOutputPixelIndices.size() << "\n";
 
 }
 
 //----------------------------------------------------------------------------
 // Splits data into num pieces for processing by each thread.
 // Usually the output extent is split into pieces, but in our case
-// we need to split the interpolation table.
+// we split the rows of the interpolation table so that each piece
+// contains approximately the same number of interpolated points
+// (rows near the top of the image contain much less points than the others).
+// The row range is returned in splitExt[2] and splitExt[3].
 // This method returns the number of pieces resulting from a successful split.
 // This can be from 1 to "total".  
 // If 1 is returned, the extent cannot be split.
@@ -381,42 +424,59 @@ int vtkUsScanConvertCurvilinear::SplitExtent(int splitExt[6], int startExt[6], i
 {
   // startExt is not used, because we split the interpolation table
 
-  // Starting extent
-  int min = 0;
-  int max = this->InterpolatedPointArray.size()-1;
+  const std::vector<int> &rowFirstRunIndices=this->InterpolationTable.RowFirstRunIndices;
+  const std::vector<int> &runFirstPointIndices=this->InterpolationTable.RunFirstPointIndices;
+  int numberOfRows=static_cast<int>(rowFirstRunIndices.size())-1;
 
-  splitExt[0]=min;
-  splitExt[1]=max;
+  splitExt[0]=0;
+  splitExt[1]=0;
   splitExt[2]=0;
-  splitExt[3]=0;
+  splitExt[3]=numberOfRows-1;
   splitExt[4]=0;
   splitExt[5]=0;
 
-  if (min>=max)
+  if (numberOfRows<=1 || total<=1)
   {
-    // Cannot split interpolation table, as it's empty or has only one element
+    // Cannot split interpolation table, as it's empty or has only one row
     return 1;
   }
 
   // determine the actual number of pieces that will be generated
-  int range = max - min + 1;
-  int valuesPerThread = static_cast<int>(ceil(range/static_cast<double>(total)));
-  int maxThreadIdUsed = static_cast<int>(ceil(range/static_cast<double>(valuesPerThread))) - 1;
-  if (num < maxThreadIdUsed)
+  int numberOfPieces = std::min(total, numberOfRows);
+  if (num >= numberOfPieces)
+  {
+    return numberOfPieces;
+  }
+
+  // Index of the first interpolated point of each row
+  std::vector<int> rowFirstPointIndices(numberOfRows+1);
+  for (int row=0; row<=numberOfRows; row++)
+  {
+    rowFirstPointIndices[row]=runFirstPointIndices[rowFirstRunIndices[row]];
+  }
+  double numberOfPoints=rowFirstPointIndices[numberOfRows];
+
+  // A piece starts at the first row that has at least num/numberOfPieces of all the points before it
+  int firstRow = 0;
+  if (num > 0)
   {
-    splitExt[0] = splitExt[0] + num*valuesPerThread;
-    splitExt[1] = splitExt[0] + valuesPerThread - 1;
+    firstRow = std::lower_bound(rowFirstPointIndices.begin(), rowFirstPointIndices.begin()+numberOfRows,
+      static_cast<int>(numberOfPoints*num/numberOfPieces)) - rowFirstPointIndices.begin();
   }
-  if (num == maxThreadIdUsed)
+  int afterLastRow = numberOfRows;
+  if (num+1 < numberOfPieces)
   {
-    splitExt[0] = splitExt[0] + num*valuesPerThread;
+    afterLastRow = std::lower_bound(rowFirstPointIndices.begin(), rowFirstPointIndices.begin()+numberOfRows,
+      static_cast<int>(numberOfPoints*(num+1)/numberOfPieces)) - rowFirstPointIndices.begin();
   }
+  splitExt[2] = firstRow;
+  splitExt[3] = afterLastRow-1; // if the piece is empty then splitExt[3]<splitExt[2] and the piece is skipped
 
   vtkDebugMacro("  Split Piece: ( " <<splitExt[0]<< ", " <<splitExt[1]<< ", "
     << splitExt[2] << ", " << splitExt[3] << ", "
     << splitExt[4] << ", " << splitExt[5] << ")");
 
-  return maxThreadIdUsed + 1;
+  return numberOfPieces;
 } 
 
 //-----------------------------------------------------------------------------
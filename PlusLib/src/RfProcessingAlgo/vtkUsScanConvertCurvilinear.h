@@ -32,18 +32,33 @@ public:
   /*! Get the scan converted image */
   virtual vtkImageData* GetOutput();
 
-  struct InterpolatedPoint
+  /*!
+    Lookup table that defines the computation of the output pixels that are inside the scanned area.
+    The table is stored as a structure of arrays, which requires much less memory than storing the weights
+    and the input and output pixel indices for each output pixel. Each output pixel is computed from 4 input pixels.
+    The interpolated points of an image row are grouped into runs of consecutive output pixels, therefore
+    the output pixel index is only stored once per run.
+  */
+  struct InterpolationTableType
   {
-    /*! Weighting coefficients that used to construct the output pixel from 4 input pixels */
-    double weightCoefficients[4];
+    /*! Sub-sample fraction of each interpolated point (the 4 weighting coefficients are computed from this and the sub-line fraction) */
+    std::vector<double> SampleFractions;
+    /*! Sub-line fraction of each interpolated point */
+    std::vector<double> LineFractions;
     /*! Position of the first input pixel that is used to construct the output point (in the sample line matrix). The 3 others are one row/column away. */
-    int inputPixelIndex;
-    // Position of the output pixel (in the image matrix) */
-    int outputPixelIndex;
+    std::vector<int> InputPixelIndices;
+    /*! Position of the first output pixel of each run (in the image matrix) */
+    std::vector<int> RunOutputPixelIndices;
+    /*! Index of the first interpolated point of each run. Contains one more element than the number of runs (the total number of points). */
+    std::vector<int> RunFirstPointIndices;
+    /*! Index of the first run of each output image row. Contains one more element than the number of rows (the total number of runs). */
+    std::vector<int> RowFirstRunIndices;
+    /*! Intensity scaling factor from envelope to image */
+    double IntensityScaling;
   };
 
-  /*! Retrieve the InterpolatedPointArray (used internally by the thread function) */
-  const std::vector<InterpolatedPoint> & GetInterpolatedPointArray() { return this->InterpolatedPointArray; };
+  /*! Retrieve the interpolation table (used internally by the thread function) */
+  const InterpolationTableType& GetInterpolationTable() { return this->InterpolationTable; };
 
   /*! Initialize the parameters used in reconstruction. These are for the cases when video source can obtain them from the hardware */
   vtkSetMacro(RadiusStartMm, double);
@@ -106,8 +121,8 @@ protected:
   /*! Intensity scaling factor from envelope to image */
   double OutputIntensityScaling;
 
-  /*! Each element of this array defines the computation of a pixel in the output (scan converted) image.  */
-  std::vector<InterpolatedPoint> InterpolatedPointArray;
+  /*! Defines the computation of the pixels in the output (scan converted) image. */
+  InterpolationTableType InterpolationTable;
 
   int InterpInputImageExtent[6];
   double InterpRadiusStartMm;
@@ -120,10 +135,10 @@ protected:
   double InterpIntensityScaling;
 
   /*! 
-    Computes the InterpolatedPointArray from the method arguments. The array is not recomputed if
+    Computes the InterpolationTable from the method arguments. The table is not recomputed if
     the input arguments are the same as last time.
   */  
-  void ComputeInterpolatedPointArray(
+  void ComputeInterpolationTable(
     int *inputImageExtent, double radiusStartMm, double radiusStopMm, double thetaStartDeg, double thetaStopDeg,
     int *outputImageExtent, double *outputImageSpacing, double* transducerCenterPixel, double intensityScaling
   );
@@ -16,7 +16,7 @@ See License.txt for details.
 #include "vtkProbeFilter.h"
 #include "vtkPointData.h"
 #include "vtkIdList.h"
-#include "vtkTriangle.h"
+#include "vtkCellType.h"
 
 // If fraction of the transmitted beam intensity is smaller then this value then we consider the beam to be completely absorbed
 const double MINIMUM_BEAM_INTENSITY=1e-9;
@@ -41,6 +41,8 @@ SpatialModel::SpatialModel()
   this->PolyData=NULL;
   this->ModelFileNeedsUpdate=false;
   this->TransducerSpatialModelMaxOverlapMm=10.0;
+  vtkMatrix4x4::Identity(this->ReferenceToModelMatrix);
+  vtkMatrix4x4::Identity(this->ModelToReferenceMatrix);
 }
 
 //-----------------------------------------------------------------------------
@@ -77,6 +79,9 @@ SpatialModel::SpatialModel(const SpatialModel& model)
   this->ModelFileNeedsUpdate=model.ModelFileNeedsUpdate;
   this->PrecomputedAttenuations=model.PrecomputedAttenuations;
   this->TransducerSpatialModelMaxOverlapMm=model.TransducerSpatialModelMaxOverlapMm;
+  memcpy(this->ReferenceToModelMatrix, model.ReferenceToModelMatrix, sizeof(this->ReferenceToModelMatrix));
+  memcpy(this->ModelToReferenceMatrix, model.ModelToReferenceMatrix, sizeof(this->ModelToReferenceMatrix));
+  this->LineIntersectionWorkspaces=model.LineIntersectionWorkspaces;
 }
 
 //-----------------------------------------------------------------------------
@@ -100,6 +105,9 @@ void SpatialModel::operator=(const SpatialModel& model)
   this->ModelFileNeedsUpdate=model.ModelFileNeedsUpdate;
   this->PrecomputedAttenuations=model.PrecomputedAttenuations;
   this->TransducerSpatialModelMaxOverlapMm=model.TransducerSpatialModelMaxOverlapMm;
+  memcpy(this->ReferenceToModelMatrix, model.ReferenceToModelMatrix, sizeof(this->ReferenceToModelMatrix));
+  memcpy(this->ModelToReferenceMatrix, model.ModelToReferenceMatrix, sizeof(this->ModelToReferenceMatrix));
+  this->LineIntersectionWorkspaces=model.LineIntersectionWorkspaces;
 }
 
 //-----------------------------------------------------------------------------
@@ -317,9 +325,8 @@ void SpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensity, i
   }
 
   // Compute attenuation within this model
-  double intensityAttenuationCoefficientdBPerPixel = this->AttenuationCoefficientDbPerCmMhz*(distanceBetweenScanlineSamplePointsMm/10.0)*this->ImagingFrequencyMhz;
   // intensityAttenuationCoefficientPerPixel: should be close to 1, as it's the ratio of (transmitted beam intensity / incident beam intensity) after traversing through a single pixel
-  double intensityAttenuationCoefficientPerPixel = pow(10.0,-intensityAttenuationCoefficientdBPerPixel/10.0);
+  double intensityAttenuationCoefficientPerPixel = GetIntensityAttenuationCoefficientPerPixel(distanceBetweenScanlineSamplePointsMm);
   // intensityAttenuatedFractionPerPixel: how big fraction of the intensity is attenuated during traversing through one voxel
   double intensityAttenuatedFractionPerPixel = (1-intensityAttenuationCoefficientPerPixel);
   // intensityTransmittedFractionPerPixelTwoWay: how big fraction of the intensity is transmitted during traversing through one voxel; takes into account both propagation directions
@@ -327,10 +334,9 @@ void SpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensity, i
 
   transmittedIntensity = surfaceTransmittedBeamIntensity * intensityTransmittedFractionPerPixelTwoWay;
 
-  if (numberOfFilledPixels>0 && this->PrecomputedAttenuations.size()<numberOfFilledPixels || intensityTransmittedFractionPerPixelTwoWay!=this->PrecomputedAttenuations[0])
-  {
-    UpdatePrecomputedAttenuations(intensityTransmittedFractionPerPixelTwoWay, numberOfFilledPixels);
-  }
+  // The precomputed attenuations are normally up-to-date (computed in PrepareForSimulation). If not, then the attenuations are computed here
+  // without modifying the precomputed values, as this method may be called from multiple threads at the same time.
+  bool precomputedAttenuationsValid = (this->PrecomputedAttenuations.size()>=numberOfFilledPixels && intensityTransmittedFractionPerPixelTwoWay==this->PrecomputedAttenuations[0]);
 
   // We iterate until transmittedIntensity * intensityTransmittedFractionPerPixelTwoWay^n > MINIMUM_BEAM_INTENSITY
   // So, n = log(MINIMUM_BEAM_INTENSITY/transmittedIntensity) / log(intensityTransmittedFractionPerPixelTwoWay)
@@ -339,11 +345,22 @@ void SpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensity, i
   {
     numberOfIterationsToReachMinimumBeamIntensity=std::min<int>(numberOfFilledPixels, floor(log(MINIMUM_BEAM_INTENSITY/transmittedIntensity) / log(intensityTransmittedFractionPerPixelTwoWay))+1);
     double backScatterFactor = transmittedIntensity * intensityAttenuatedFractionPerPixel * this->BackscatterDiffuseReflectionCoefficient / intensityTransmittedFractionPerPixelTwoWay;
-    for(int currentPixelInFilledPixels = 0; currentPixelInFilledPixels<numberOfIterationsToReachMinimumBeamIntensity; currentPixelInFilledPixels++)  
+    if (precomputedAttenuationsValid)
     {
-      // a fraction of the attenuation is caused by backscattering, the backscattering is sensed by the transducer
-      //reflectedIntensity[currentPixelInFilledPixels] = *(attenuation++) * backScatterFactor;
-      reflectedIntensity[currentPixelInFilledPixels] = this->PrecomputedAttenuations[currentPixelInFilledPixels] * backScatterFactor;
+      for(int currentPixelInFilledPixels = 0; currentPixelInFilledPixels<numberOfIterationsToReachMinimumBeamIntensity; currentPixelInFilledPixels++)  
+      {
+        // a fraction of the attenuation is caused by backscattering, the backscattering is sensed by the transducer
+        reflectedIntensity[currentPixelInFilledPixels] = this->PrecomputedAttenuations[currentPixelInFilledPixels] * backScatterFactor;
+      }
+    }
+    else
+    {
+      double attenuation = intensityTransmittedFractionPerPixelTwoWay;
+      for(int currentPixelInFilledPixels = 0; currentPixelInFilledPixels<numberOfIterationsToReachMinimumBeamIntensity; currentPixelInFilledPixels++)  
+      {
+        reflectedIntensity[currentPixelInFilledPixels] = attenuation * backScatterFactor;
+        attenuation *= intensityTransmittedFractionPerPixelTwoWay;
+      }
     }
     transmittedIntensity*=pow(intensityTransmittedFractionPerPixelTwoWay,numberOfIterationsToReachMinimumBeamIntensity);
   }
@@ -375,10 +392,56 @@ void SpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensity, i
 }
 
 //-----------------------------------------------------------------------------
-void SpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference)
+PlusStatus SpatialModel::PrepareForSimulation(double distanceBetweenScanlineSamplePointsMm, int numberOfSamplesPerScanline, int numberOfThreads)
 {
-  UpdateModelFile();
+  PlusStatus status=UpdateModelFile();
+
+  // The transforms are the same for all the scanlines, so compute them only once per frame
+  double objectToModelMatrix[16]={0};
+  vtkMatrix4x4::Invert(*this->ModelToObjectTransform->Element, objectToModelMatrix);
+  vtkMatrix4x4::Multiply4x4(objectToModelMatrix, *this->ReferenceToObjectTransform->Element, this->ReferenceToModelMatrix);
+  vtkMatrix4x4::Invert(this->ReferenceToModelMatrix, this->ModelToReferenceMatrix);
+
+  double intensityAttenuationCoefficientPerPixel = GetIntensityAttenuationCoefficientPerPixel(distanceBetweenScanlineSamplePointsMm);
+  double intensityTransmittedFractionPerPixelTwoWay = intensityAttenuationCoefficientPerPixel*intensityAttenuationCoefficientPerPixel;
+  if (numberOfSamplesPerScanline>0 && (this->PrecomputedAttenuations.size()<numberOfSamplesPerScanline || intensityTransmittedFractionPerPixelTwoWay!=this->PrecomputedAttenuations[0]))
+  {
+    UpdatePrecomputedAttenuations(intensityTransmittedFractionPerPixelTwoWay, numberOfSamplesPerScanline);
+  }
+
+  if (this->PolyData==NULL)
+  {
+    // no surface model, there is no need for line intersection computation
+    return status;
+  }
+  while (this->LineIntersectionWorkspaces.size()<numberOfThreads)
+  {
+    LineIntersectionWorkspace workspace;
+    if (this->LineIntersectionWorkspaces.empty())
+    {
+      // the first thread can use the localizer that has been already built
+      workspace.ModelLocalizer=this->ModelLocalizer;
+    }
+    else
+    {
+      workspace.ModelLocalizer=vtkSmartPointer<vtkModifiedBSPTree>::New();
+      workspace.ModelLocalizer->SetDataSet(this->PolyData); 
+      workspace.ModelLocalizer->SetMaxLevel(this->ModelLocalizer->GetMaxLevel()); 
+      workspace.ModelLocalizer->SetNumberOfCellsPerNode(this->ModelLocalizer->GetNumberOfCellsPerNode());
+      workspace.ModelLocalizer->BuildLocator();
+    }
+    workspace.IntersectionPoints_Model=vtkSmartPointer<vtkPoints>::New();
+    workspace.IntersectionCellIds=vtkSmartPointer<vtkIdList>::New();
+    workspace.Cell=vtkSmartPointer<vtkGenericCell>::New();
+    this->LineIntersectionWorkspaces.push_back(workspace);
+  }
+
+  return status;
+}
 
+//-----------------------------------------------------------------------------
+void SpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference, int threadIndex)
+{
   if (this->ModelFile.empty())
   {
     // no model is defined, which means that the model is everywhere
@@ -391,6 +454,19 @@ void SpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIn
     return;
   }
 
+  if (this->PolyData==NULL)
+  {
+    // the model could not be loaded, there are no intersections
+    return;
+  }
+
+  if (threadIndex<0 || threadIndex>=this->LineIntersectionWorkspaces.size())
+  {
+    LOG_ERROR("SpatialModel::GetLineIntersections failed: no workspace is available for thread "<<threadIndex<<". PrepareForSimulation has to be called before computing line intersections.");
+    return;
+  }
+  LineIntersectionWorkspace& workspace=this->LineIntersectionWorkspaces[threadIndex];
+
   // non-normalized direction vector of the scanline
   double scanLineDirectionVector_Reference[4] =
   {
@@ -406,19 +482,16 @@ void SpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIn
     searchLineStartPoint_Reference[i]=scanLineStartPoint_Reference[i]-this->TransducerSpatialModelMaxOverlapMm*scanLineDirectionVector_Reference[i]/scanLineDirectionVectorNorm_Reference;
   }
 
-  vtkSmartPointer<vtkMatrix4x4> objectToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Invert(this->ModelToObjectTransform, objectToModelMatrix);
-  vtkSmartPointer<vtkMatrix4x4> referenceToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Multiply4x4(objectToModelMatrix,this->ReferenceToObjectTransform,referenceToModelMatrix);
-
   double searchLineStartPoint_Model[4] = {0,0,0,1};
   double scanLineEndPoint_Model[4] = {0,0,0,1};
-  referenceToModelMatrix->MultiplyPoint(searchLineStartPoint_Reference,searchLineStartPoint_Model);
-  referenceToModelMatrix->MultiplyPoint(scanLineEndPoint_Reference,scanLineEndPoint_Model);
+  vtkMatrix4x4::MultiplyPoint(this->ReferenceToModelMatrix,searchLineStartPoint_Reference,searchLineStartPoint_Model);
+  vtkMatrix4x4::MultiplyPoint(this->ReferenceToModelMatrix,scanLineEndPoint_Reference,scanLineEndPoint_Model);
 
-  vtkSmartPointer<vtkPoints> intersectionPoints_Model=vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkIdList> intersectionCellIds=vtkSmartPointer<vtkIdList>::New();
-  this->ModelLocalizer->IntersectWithLine(searchLineStartPoint_Model, scanLineEndPoint_Model, 0.0, intersectionPoints_Model, intersectionCellIds);
+  vtkPoints* intersectionPoints_Model=workspace.IntersectionPoints_Model;
+  vtkIdList* intersectionCellIds=workspace.IntersectionCellIds;
+  intersectionPoints_Model->Reset();
+  intersectionCellIds->Reset();
+  workspace.ModelLocalizer->IntersectWithLine(searchLineStartPoint_Model, scanLineEndPoint_Model, 0.0, intersectionPoints_Model, intersectionCellIds);
 
   if (intersectionPoints_Model->GetNumberOfPoints()<1)
   {
@@ -426,9 +499,6 @@ void SpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIn
     return;
   }
 
-  vtkSmartPointer<vtkMatrix4x4> modelToReferenceMatrix= vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Invert(referenceToModelMatrix, modelToReferenceMatrix);
-
   // Measure the distance from the starting point in the reference coordinate system
   double intersectionPoint_Model[4] = {0,0,0,1};
   double intersectionPoint_Reference[4] = {0,0,0,1};
@@ -439,7 +509,7 @@ void SpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIn
   for (; intersectionPointIndex<intersectionPoints_Model->GetNumberOfPoints(); intersectionPointIndex++)
   {
     intersectionPoints_Model->GetPoint(intersectionPointIndex,intersectionPoint_Model);
-    modelToReferenceMatrix->MultiplyPoint(intersectionPoint_Model,intersectionPoint_Reference);
+    vtkMatrix4x4::MultiplyPoint(this->ModelToReferenceMatrix,intersectionPoint_Model,intersectionPoint_Reference);
     double intersectionDistanceFromSearchLineStartPointMm = sqrt(vtkMath::Distance2BetweenPoints(searchLineStartPoint_Reference, intersectionPoint_Reference));
     if (intersectionDistanceFromSearchLineStartPointMm<=this->TransducerSpatialModelMaxOverlapMm)
     {
@@ -469,16 +539,18 @@ void SpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIn
   }
 
   double scanLineDirectionVector_Model[4]={0,0,0,0};
-  referenceToModelMatrix->MultiplyPoint(scanLineDirectionVector_Reference, scanLineDirectionVector_Model);
+  vtkMatrix4x4::MultiplyPoint(this->ReferenceToModelMatrix, scanLineDirectionVector_Reference, scanLineDirectionVector_Model);
   vtkMath::Normalize(scanLineDirectionVector_Model);
 
+  // The cell is retrieved into the thread's own generic cell object, as GetCell(cellId) would return an object that is shared between threads
+  vtkGenericCell* cell=workspace.Cell;
   for (; intersectionPointIndex<intersectionPoints_Model->GetNumberOfPoints(); intersectionPointIndex++)
   {
     intersectionPoints_Model->GetPoint(intersectionPointIndex,intersectionPoint_Model);
-    modelToReferenceMatrix->MultiplyPoint(intersectionPoint_Model,intersectionPoint_Reference);
+    vtkMatrix4x4::MultiplyPoint(this->ModelToReferenceMatrix,intersectionPoint_Model,intersectionPoint_Reference);
     intersectionInfo.IntersectionDistanceFromStartPointMm = sqrt(vtkMath::Distance2BetweenPoints(scanLineStartPoint_Reference, intersectionPoint_Reference));
-    vtkTriangle* cell=vtkTriangle::SafeDownCast(this->PolyData->GetCell(intersectionCellIds->GetId(intersectionPointIndex)));
-    if (cell!=NULL && normals_Model!=NULL)
+    this->PolyData->GetCell(intersectionCellIds->GetId(intersectionPointIndex), cell);
+    if (cell->GetCellType()==VTK_TRIANGLE && normals_Model!=NULL)
     {
       const int NUMBER_OF_POINTS_PER_CELL=3; // triangle cell
       double pcoords[NUMBER_OF_POINTS_PER_CELL]={0,0,0};
@@ -490,12 +562,8 @@ void SpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIn
       double interpolatedNormal_Model[3]={0,0,0};
       for (int pointIndex=0; pointIndex<NUMBER_OF_POINTS_PER_CELL; pointIndex++)
       {
-        double* normalAtCellCorner=normals_Model->GetTuple3(cell->GetPointId(pointIndex));
-        if (normalAtCellCorner==NULL)
-        {
-          LOG_ERROR("SpatialModel::GetLineIntersections error: invalid normal");
-          continue;
-        }
+        double normalAtCellCorner[3]={0,0,0};
+        normals_Model->GetTuple(cell->GetPointId(pointIndex), normalAtCellCorner);
         interpolatedNormal_Model[0] += normalAtCellCorner[0]*weights[pointIndex];
         interpolatedNormal_Model[1] += normalAtCellCorner[1]*weights[pointIndex];
         interpolatedNormal_Model[2] += normalAtCellCorner[2]*weights[pointIndex];
@@ -528,6 +596,8 @@ PlusStatus SpatialModel::UpdateModelFile()
     this->PolyData->Delete();
     this->PolyData=NULL;
   }
+  // The localizers of the workspaces have been built for the previous model
+  this->LineIntersectionWorkspaces.clear();
 
   if (this->ModelFile.empty())
   {
@@ -604,3 +674,10 @@ void SpatialModel::UpdatePrecomputedAttenuations(double intensityTransmittedFrac
     attenuation*=intensityTransmittedFractionPerPixelTwoWay;
   }
 }
+
+//-----------------------------------------------------------------------------
+double SpatialModel::GetIntensityAttenuationCoefficientPerPixel(double distanceBetweenScanlineSamplePointsMm)
+{
+  double intensityAttenuationCoefficientdBPerPixel = this->AttenuationCoefficientDbPerCmMhz*(distanceBetweenScanlineSamplePointsMm/10.0)*this->ImagingFrequencyMhz;
+  return pow(10.0,-intensityAttenuationCoefficientdBPerPixel/10.0);
+}
@@ -8,11 +8,15 @@
 
 #include <deque>
 #include <string>
+#include <vector>
 
 #include "vtkSmartPointer.h"
+#include "vtkGenericCell.h"
+#include "vtkIdList.h"
 #include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
 #include "vtkModifiedBSPTree.h"
+#include "vtkPoints.h"
 
 /*!
   \class SpatialModel 
@@ -60,13 +64,25 @@ public:
 
   void SetReferenceToObjectTransform(vtkMatrix4x4* referenceToObjectTransform);
 
+  /*!
+    Prepare the model for simulating a frame: read the model file (if it has been changed), compute the transforms
+    between the Reference and Model coordinate systems and precompute the attenuation values.
+    Must be called after SetReferenceToObjectTransform and before GetLineIntersections and CalculateIntensity.
+    After this method is called GetLineIntersections and CalculateIntensity do not modify the model,
+    so they can be called from multiple threads at the same time.
+    \param numberOfSamplesPerScanline Maximum number of pixels that CalculateIntensity will be called with
+    \param numberOfThreads Number of threads that will call GetLineIntersections
+  */
+  PlusStatus PrepareForSimulation(double distanceBetweenScanlineSamplePointsMm, int numberOfSamplesPerScanline, int numberOfThreads);
+
   /*!
     Get all the intersection points of the model and a line. Input and output points are all in Model coordinate system.
     The results are appended to the lineIntersections structure.
     If the line starts inside the model then the first intersection position is 0.
     The unit of the reference coordinate system must be in mm.
+    \param threadIndex Index of the calling thread (0 <= threadIndex < numberOfThreads specified in PrepareForSimulation)
   */
-  void GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference);
+  void GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference, int threadIndex=0);
 
   double GetAcousticImpedanceMegarayls();
   
@@ -88,8 +104,23 @@ protected:
   PlusStatus UpdateModelFile();
   void UpdatePrecomputedAttenuations(double intensityTransmittedFractionPerPixelTwoWay, int numberOfElements);
 
+  /*! Ratio of (transmitted beam intensity / incident beam intensity) after traversing through a single pixel */
+  double GetIntensityAttenuationCoefficientPerPixel(double distanceBetweenScanlineSamplePointsMm);
+
 private:
 
+  /*!
+    Objects used by one thread for computing line intersections. The model localizer (BSP tree)
+    uses an internal cell object for the intersection computation, therefore each thread needs its own localizer.
+  */
+  struct LineIntersectionWorkspace
+  {
+    vtkSmartPointer<vtkModifiedBSPTree> ModelLocalizer;
+    vtkSmartPointer<vtkPoints> IntersectionPoints_Model;
+    vtkSmartPointer<vtkIdList> IntersectionCellIds;
+    vtkSmartPointer<vtkGenericCell> Cell;
+  };
+
   //PlusStatus LoadModel(const std::string& absoluteImagePath);
 
   /*! Identifying name of Model*/
@@ -180,6 +211,15 @@ private:
   /*! List of attenuations: intensityTransmittedFractionPerPixelTwoWay, intensityTransmittedFractionPerPixelTwoWay^2, intensityTransmittedFractionPerPixelTwoWay^3, ... */
   std::vector<double> PrecomputedAttenuations;
 
+  /*! Transformation matrix from the Reference to the Model coordinate system. Computed in PrepareForSimulation. */
+  double ReferenceToModelMatrix[16];
+
+  /*! Transformation matrix from the Model to the Reference coordinate system. Computed in PrepareForSimulation. */
+  double ModelToReferenceMatrix[16];
+
+  /*! One workspace for each thread that computes line intersections. Created in PrepareForSimulation. */
+  std::vector<LineIntersectionWorkspace> LineIntersectionWorkspaces;
+
 };
 
 #endif
@@ -32,10 +32,15 @@ See License.txt for details.
 #include "vtkUsScanConvert.h"
 
 // For noise generation
-#include "vtkLineSource.h"
 #include "vtkPerlinNoise.h"
-#include "vtkProbeFilter.h"
-#include "vtkSampleFunction.h"
+
+// Number of noise texture voxels along one unit of the noise function lattice (1/NoiseFrequency mm).
+// Perlin noise has features in the size of the lattice unit, so it can be accurately approximated by trilinear interpolation
+// from a few samples per unit.
+static const int NOISE_TEXTURE_VOXELS_PER_NOISE_LATTICE_UNIT=4;
+// Maximum size of the noise texture along each axis. The texture of the maximum size takes 64MB of memory
+// and the number of voxels fits in an int.
+static const int NOISE_TEXTURE_MAX_SIZE_VOXELS=256;
 
 //-----------------------------------------------------------------------------
 
@@ -54,6 +59,8 @@ vtkUsSimulatorAlgo::vtkUsSimulatorAlgo()
 
   this->NumberOfScanlines=256;
   this->NumberOfSamplesPerScanline=1000;
+  this->NumberOfThreads=0;
+  this->Threader=vtkMultiThreader::New();
   this->IncomingIntensityMwPerCm2 = 100;
   this->ImagingFrequencyMhz = 2.5;
   this->BrightnessConversionGamma = 0.333;
@@ -69,6 +76,15 @@ vtkUsSimulatorAlgo::vtkUsSimulatorAlgo()
   this->NoisePhase[0]=0;
   this->NoisePhase[1]=0;
   this->NoisePhase[2]=0;
+  this->NoiseTextureSizeVoxels=0;
+  this->NoiseTextureVoxelSizeMm[0]=1.0;
+  this->NoiseTextureVoxelSizeMm[1]=1.0;
+  this->NoiseTextureVoxelSizeMm[2]=1.0;
+  this->NoiseTextureOutdated=false;
+
+  this->ScanLinePixels=NULL;
+  this->DistanceBetweenScanlineSamplePointsMm=1.0;
+  this->NoiseFunction=NULL;
 
   // this->TransducerSpatialModel doesn't have to be initialized, as the default parameters of SpatialModel
   // are for soft tissue that should match the transducer material in acoustic impedance
@@ -84,6 +100,11 @@ vtkUsSimulatorAlgo::~vtkUsSimulatorAlgo()
     this->RfProcessor->Delete();
     this->RfProcessor=NULL;
   }
+  if (this->Threader!=NULL)
+  {
+    this->Threader->Delete();
+    this->Threader=NULL;
+  }
   this->SetTransformRepository(NULL);
 }
 
@@ -141,9 +162,6 @@ int vtkUsSimulatorAlgo::RequestData(vtkInformation* request,vtkInformationVector
   scanLines->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
 #endif
 
-  // Create BSPTree for fast scanline-model intersection computation
-  vtkSmartPointer<vtkPoints> scanLineIntersectionWithModel = vtkSmartPointer<vtkPoints>::New(); 
-
   vtkUsScanConvert* scanConverter=this->RfProcessor->GetScanConverter();
   if (scanConverter==NULL)
   {
@@ -154,22 +172,23 @@ int vtkUsSimulatorAlgo::RequestData(vtkInformation* request,vtkInformationVector
   // GetScanLineEndPoints or GetDistanceBetweenScanlineSamplePointsMm methods
   scanConverter->SetInputImageExtent(scanLines->GetExtent());
 
-  double outputImageSpacingMm[3]={1.0,1.0,1.0};
-  scanConverter->GetOutputImageSpacing(outputImageSpacingMm);
+  this->DistanceBetweenScanlineSamplePointsMm=scanConverter->GetDistanceBetweenScanlineSamplePointsMm();
 
-  double distanceBetweenScanlineSamplePointsMm=scanConverter->GetDistanceBetweenScanlineSamplePointsMm();
+  if (this->NoiseTextureOutdated)
+  {
+    // The noise parameters have been changed by the setters since the configuration was read
+    UpdateNoiseTexture();
+  }
 
   // Initialize noise generator  
-  vtkSmartPointer<vtkLineSource> noiseSamplerLine_Reference = vtkSmartPointer<vtkLineSource>::New();
   vtkSmartPointer<vtkPerlinNoise> noiseFunction=vtkSmartPointer<vtkPerlinNoise>::New();
-  double samplePointPosition_Reference[3]={0,0,0};
   if (this->NoiseAmplitude>0)
   {
-    noiseSamplerLine_Reference->SetResolution(this->NumberOfSamplesPerScanline-1);
     noiseFunction->SetAmplitude(this->NoiseAmplitude);
     noiseFunction->SetFrequency(this->NoiseFrequency);
     noiseFunction->SetPhase(this->NoisePhase);
   }
+  this->NoiseFunction=noiseFunction;
 
   PlusTransformName imageToReferenceTransformName(this->GetImageCoordinateFrame(), this->GetReferenceCoordinateFrame());
   vtkSmartPointer<vtkMatrix4x4> imageToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();   
@@ -180,19 +199,18 @@ int vtkUsSimulatorAlgo::RequestData(vtkInformation* request,vtkInformationVector
     LOG_ERROR("Failed to get transform from repository: " << strTransformName ); 
     return 0;
   }
-  vtkSmartPointer<vtkMatrix4x4> referenceToImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Invert(imageToReferenceMatrix, referenceToImageMatrix);
 
-  // Create a few variables outside the loop to avoid reallocations and to make the code easier to read
-  vtkPoints* samplePointPositions_Reference=0;
-  // Create a buffer outside the for loop to allow reusing it
-  std::vector<double> intensities;
-  // scanline start/end positions in Image and Reference coordinate systems
-  double scanLineStartPoint_Image[4] = {0,0,0,1}; 
-  double scanLineEndPoint_Image[4] = {0,0,0,1};
-  double scanLineStartPoint_Reference[4] = {0,0,0,1};
-  double scanLineEndPoint_Reference[4] = {0,0,0,1};
+  int numberOfThreads=(this->NumberOfThreads>0 ? this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads());
+  if (numberOfThreads>this->NumberOfScanlines)
+  {
+    numberOfThreads=this->NumberOfScanlines;
+  }
+  if (numberOfThreads<1)
+  {
+    numberOfThreads=1;
+  }
 
+  // Compute the model transforms and attenuations once per frame, as they are the same for all scanlines
   for (std::vector<SpatialModel>::iterator spatialModelIt=this->SpatialModels.begin(); spatialModelIt!=this->SpatialModels.end(); ++spatialModelIt)
   {
     vtkSmartPointer<vtkMatrix4x4> referenceToObjectMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
@@ -207,41 +225,105 @@ int vtkUsSimulatorAlgo::RequestData(vtkInformation* request,vtkInformationVector
       }
     }
     spatialModelIt->SetReferenceToObjectTransform(referenceToObjectMatrix);
+    spatialModelIt->PrepareForSimulation(this->DistanceBetweenScanlineSamplePointsMm, this->NumberOfSamplesPerScanline, numberOfThreads);
   }
 
+  // Compute the scanline start/end positions in the Reference coordinate system
+  this->ScanLineStartPoints_Reference.resize(this->NumberOfScanlines*4);
+  this->ScanLineEndPoints_Reference.resize(this->NumberOfScanlines*4);
+  double scanLineStartPoint_Image[4] = {0,0,0,1}; 
+  double scanLineEndPoint_Image[4] = {0,0,0,1};
   for(int scanLineIndex=0;scanLineIndex<this->NumberOfScanlines; scanLineIndex++)
   {    
     scanConverter->GetScanLineEndPoints(scanLineIndex, scanLineStartPoint_Image, scanLineEndPoint_Image);     
-    imageToReferenceMatrix->MultiplyPoint(scanLineStartPoint_Image,scanLineStartPoint_Reference);
-    imageToReferenceMatrix->MultiplyPoint(scanLineEndPoint_Image,scanLineEndPoint_Reference);
+    imageToReferenceMatrix->MultiplyPoint(scanLineStartPoint_Image,&(this->ScanLineStartPoints_Reference[scanLineIndex*4]));
+    imageToReferenceMatrix->MultiplyPoint(scanLineEndPoint_Image,&(this->ScanLineEndPoints_Reference[scanLineIndex*4]));
+  }
 
-    if (this->NoiseAmplitude>0)
+  // Simulate the scanlines
+  this->ScanLinePixels=static_cast<unsigned char*>(scanLines->GetScalarPointer());
+  this->ThreadStatus.assign(numberOfThreads, PLUS_SUCCESS);
+  if (numberOfThreads==1)
+  {
+    this->ThreadStatus[0]=SimulateScanlines(0, 1, 0);
+  }
+  else
+  {
+    this->Threader->SetNumberOfThreads(numberOfThreads);
+    this->Threader->SetSingleMethod(SimulateScanlinesThreadFunction, this);
+    this->Threader->SingleMethodExecute();
+  }
+  this->ScanLinePixels=NULL;
+  this->NoiseFunction=NULL;
+  for (int threadIndex=0; threadIndex<numberOfThreads; threadIndex++)
+  {
+    if (this->ThreadStatus[threadIndex]!=PLUS_SUCCESS)
     {
-      noiseSamplerLine_Reference->SetPoint1(scanLineStartPoint_Reference);
-      noiseSamplerLine_Reference->SetPoint2(scanLineEndPoint_Reference);
-      noiseSamplerLine_Reference->Update();
-      samplePointPositions_Reference=noiseSamplerLine_Reference->GetOutput()->GetPoints();            
+      return 0;
     }
+  }
+
+  vtkImageData* simulatedUsImage = vtkImageData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT())); 
+  if (simulatedUsImage == NULL)
+  {
+    LOG_ERROR("vtkUsSimulatorAlgo output type is invalid");
+    return 0; 
+  }
+  this->RfProcessor->SetRfFrame(scanLines, US_IMG_BRIGHTNESS);
+  simulatedUsImage->DeepCopy(this->RfProcessor->GetBrightessScanConvertedImage());
+  return 1; 
+}
+
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkUsSimulatorAlgo::SimulateScanlinesThreadFunction( void *arg )
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+  vtkUsSimulatorAlgo* self = static_cast<vtkUsSimulatorAlgo*>(threadInfo->UserData);
+  // Scanlines are interleaved between the threads, as the computation time of neighbor scanlines is similar
+  self->ThreadStatus[threadInfo->ThreadID] = self->SimulateScanlines(threadInfo->ThreadID, threadInfo->NumberOfThreads, threadInfo->ThreadID);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkUsSimulatorAlgo::SimulateScanlines(int firstScanlineIndex, int scanlineIndexIncrement, int threadIndex)
+{
+  // Create buffers outside the for loop to allow reusing them
+  std::vector<double> intensities;
+  std::deque<SpatialModel::LineIntersectionInfo> lineIntersectionsWithModels;
+  // Noise sample points are placed along the scanline the same way as by vtkLineSource, which stores the point coordinates in float
+  int noiseSamplerLineResolution=std::max(this->NumberOfSamplesPerScanline-1, 1);
+  double samplePointPosition_Reference[3]={0,0,0};
+  bool useNoiseTexture=!this->NoiseTexture.empty();
+
+  for(int scanLineIndex=firstScanlineIndex; scanLineIndex<this->NumberOfScanlines; scanLineIndex+=scanlineIndexIncrement)
+  {
+    double* scanLineStartPoint_Reference=&(this->ScanLineStartPoints_Reference[scanLineIndex*4]);
+    double* scanLineEndPoint_Reference=&(this->ScanLineEndPoints_Reference[scanLineIndex*4]);
+    double scanLineDirectionVector_Reference[3]=
+    {
+      scanLineEndPoint_Reference[0]-scanLineStartPoint_Reference[0],
+      scanLineEndPoint_Reference[1]-scanLineStartPoint_Reference[1],
+      scanLineEndPoint_Reference[2]-scanLineStartPoint_Reference[2]
+    };
 
     // Get model intersection positions along the scanline for all the models
-    std::deque<SpatialModel::LineIntersectionInfo> lineIntersectionsWithModels;    
+    lineIntersectionsWithModels.clear();
     for (std::vector<SpatialModel>::iterator spatialModelIt=this->SpatialModels.begin(); spatialModelIt!=this->SpatialModels.end(); ++spatialModelIt)
     {
       // Append line intersections found with this model to lineIntersectionsWithModels
-      spatialModelIt->GetLineIntersections(lineIntersectionsWithModels, scanLineStartPoint_Reference, scanLineEndPoint_Reference);
+      spatialModelIt->GetLineIntersections(lineIntersectionsWithModels, scanLineStartPoint_Reference, scanLineEndPoint_Reference, threadIndex);
     }
 
     ConvertLineModelIntersectionsToSegmentDescriptor(lineIntersectionsWithModels);
 
     int currentPixelIndex=0;
-    int scanLineExtent[6]={0,this->NumberOfSamplesPerScanline-1,scanLineIndex,scanLineIndex,0,0};
-    unsigned char* dstPixelAddress=(unsigned char*)scanLines->GetScalarPointerForExtent(scanLineExtent);
+    unsigned char* dstPixelAddress=this->ScanLinePixels+scanLineIndex*this->NumberOfSamplesPerScanline;
     double incomingBeamIntensity=this->IncomingIntensityMwPerCm2*1000;
     int numIntersectionPoints=lineIntersectionsWithModels.size();
     if (numIntersectionPoints<1)
     {
       LOG_ERROR("No intersections with any SpatialObjects. Probably no background object is specified.");
-      return 0;
+      return PLUS_FAIL;
     }
     SpatialModel *previousModel=&this->TransducerSpatialModel;
     for(vtkIdType intersectionIndex=0;(intersectionIndex<=numIntersectionPoints)&&(currentPixelIndex<this->NumberOfSamplesPerScanline); intersectionIndex++)
@@ -252,7 +334,7 @@ int vtkUsSimulatorAlgo::RequestData(vtkInformation* request,vtkInformationVector
       if(intersectionIndex+1<numIntersectionPoints)
       {
         distanceOfIntersectionPointFromScanLineStartPointMm=lineIntersectionsWithModels[intersectionIndex+1].IntersectionDistanceFromStartPointMm;
-        endOfSegmentPixelIndex=distanceOfIntersectionPointFromScanLineStartPointMm/distanceBetweenScanlineSamplePointsMm;
+        endOfSegmentPixelIndex=distanceOfIntersectionPointFromScanLineStartPointMm/this->DistanceBetweenScanlineSamplePointsMm;
         if (endOfSegmentPixelIndex>this->NumberOfSamplesPerScanline-1)
         {
           // the next intersection point is out of the image
@@ -283,15 +365,19 @@ int vtkUsSimulatorAlgo::RequestData(vtkInformation* request,vtkInformationVector
       }
       
       double outgoingBeamIntensity=0;
-      currentModel->CalculateIntensity(intensities, numberOfFilledPixels, distanceBetweenScanlineSamplePointsMm, previousModel->GetAcousticImpedanceMegarayls(), incomingBeamIntensity, outgoingBeamIntensity,lineIntersectionsWithModels[intersectionIndex].IntersectionIncidenceAngleRad);
+      currentModel->CalculateIntensity(intensities, numberOfFilledPixels, this->DistanceBetweenScanlineSamplePointsMm, previousModel->GetAcousticImpedanceMegarayls(), incomingBeamIntensity, outgoingBeamIntensity,lineIntersectionsWithModels[intersectionIndex].IntersectionIncidenceAngleRad);
       previousModel=currentModel;
 
       if (this->NoiseAmplitude>0)
       {
         for (int pixelIndex=0; pixelIndex<numberOfFilledPixels; pixelIndex++)
         { 
-          samplePointPositions_Reference->GetPoint(currentPixelIndex+pixelIndex, samplePointPosition_Reference);
-          double noise=noiseFunction->EvaluateFunction(samplePointPosition_Reference);
+          double t=static_cast<double>(currentPixelIndex+pixelIndex)/noiseSamplerLineResolution;
+          for (int i=0; i<3; i++)
+          {
+            samplePointPosition_Reference[i]=static_cast<float>(scanLineStartPoint_Reference[i]+t*scanLineDirectionVector_Reference[i]);
+          }
+          double noise=useNoiseTexture ? GetNoiseFromTexture(samplePointPosition_Reference) : this->NoiseFunction->EvaluateFunction(samplePointPosition_Reference);
           // Noise is multiplicative: NoisySignal = signal + noise * (signal-SignalMean) = signal*(1+noise) - noise*SignalMean;
           (*dstPixelAddress++)=std::max(std::min(this->BrightnessConversionOffset+this->BrightnessConversionScale*fastPow(intensities[pixelIndex],this->BrightnessConversionGamma)+noise,255.0),0.0);
         }
@@ -309,16 +395,7 @@ int vtkUsSimulatorAlgo::RequestData(vtkInformation* request,vtkInformationVector
       currentPixelIndex+=numberOfFilledPixels;
     }
   }
-
-  vtkImageData* simulatedUsImage = vtkImageData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT())); 
-  if (simulatedUsImage == NULL)
-  {
-    LOG_ERROR("vtkUsSimulatorAlgo output type is invalid");
-    return 0; 
-  }
-  this->RfProcessor->SetRfFrame(scanLines, US_IMG_BRIGHTNESS);
-  simulatedUsImage->DeepCopy(this->RfProcessor->GetBrightessScanConvertedImage());
-  return 1; 
+  return PLUS_SUCCESS;
 }
 
 bool lineIntersectionLessThan(SpatialModel::LineIntersectionInfo a, SpatialModel::LineIntersectionInfo b)
@@ -437,6 +514,12 @@ PlusStatus vtkUsSimulatorAlgo::ReadConfiguration(vtkXMLDataElement* config)
     this->SetBrightnessConversionScale(brightnessConversionScale);
   }
   
+  int numberOfThreads = 0;
+  if ( usSimulatorAlgoElement->GetScalarAttribute("NumberOfThreads", numberOfThreads )) 
+  {
+    this->SetNumberOfThreads(numberOfThreads);
+  }
+
   double incomingIntensityMwPerCm2 = -1;
   if ( usSimulatorAlgoElement->GetScalarAttribute("IncomingIntensityMwPerCm2", incomingIntensityMwPerCm2 )) 
   {
@@ -446,6 +529,16 @@ PlusStatus vtkUsSimulatorAlgo::ReadConfiguration(vtkXMLDataElement* config)
   usSimulatorAlgoElement->GetScalarAttribute("NoiseAmplitude", this->NoiseAmplitude);
   usSimulatorAlgoElement->GetVectorAttribute("NoiseFrequency", 3, this->NoiseFrequency);
   usSimulatorAlgoElement->GetVectorAttribute("NoisePhase", 3, this->NoisePhase);
+  int noiseTextureSizeVoxels = 0;
+  if ( usSimulatorAlgoElement->GetScalarAttribute("NoiseTextureSizeVoxels", noiseTextureSizeVoxels )) 
+  {
+    if (this->SetNoiseTextureSizeVoxels(noiseTextureSizeVoxels) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+  // Compute the texture now, so that the first frame is not delayed
+  UpdateNoiseTexture();
 
   const char* imageCoordinateFrame = usSimulatorAlgoElement->GetAttribute("ImageCoordinateFrame");
   if (imageCoordinateFrame == NULL)
@@ -491,6 +584,173 @@ PlusStatus vtkUsSimulatorAlgo::ReadConfiguration(vtkXMLDataElement* config)
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+void vtkUsSimulatorAlgo::SetNoiseAmplitude(double amplitude)
+{
+  if (this->NoiseAmplitude == amplitude)
+  {
+    return;
+  }
+  this->NoiseAmplitude=amplitude;
+  this->NoiseTextureOutdated=true;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkUsSimulatorAlgo::SetNoiseFrequency(double frequency[3])
+{
+  if (this->NoiseFrequency[0] == frequency[0] && this->NoiseFrequency[1] == frequency[1] && this->NoiseFrequency[2] == frequency[2])
+  {
+    return;
+  }
+  this->NoiseFrequency[0]=frequency[0];
+  this->NoiseFrequency[1]=frequency[1];
+  this->NoiseFrequency[2]=frequency[2];
+  this->NoiseTextureOutdated=true;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkUsSimulatorAlgo::SetNoisePhase(double phase[3])
+{
+  if (this->NoisePhase[0] == phase[0] && this->NoisePhase[1] == phase[1] && this->NoisePhase[2] == phase[2])
+  {
+    return;
+  }
+  this->NoisePhase[0]=phase[0];
+  this->NoisePhase[1]=phase[1];
+  this->NoisePhase[2]=phase[2];
+  this->NoiseTextureOutdated=true;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkUsSimulatorAlgo::SetNoiseTextureSizeVoxels(int sizeVoxels)
+{
+  if (sizeVoxels<0 || sizeVoxels>NOISE_TEXTURE_MAX_SIZE_VOXELS)
+  {
+    LOG_ERROR("Invalid NoiseTextureSizeVoxels: "<<sizeVoxels<<" (it shall be between 0 and "<<NOISE_TEXTURE_MAX_SIZE_VOXELS<<")");
+    return PLUS_FAIL;
+  }
+  if (this->NoiseTextureSizeVoxels == sizeVoxels)
+  {
+    return PLUS_SUCCESS;
+  }
+  this->NoiseTextureSizeVoxels=sizeVoxels;
+  this->NoiseTextureOutdated=true;
+  this->Modified();
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void vtkUsSimulatorAlgo::UpdateNoiseTexture()
+{
+  this->NoiseTextureOutdated=false;
+  this->NoiseTexture.clear();
+  if (this->NoiseTextureSizeVoxels<=0 || this->NoiseAmplitude<=0)
+  {
+    return;
+  }
+
+  vtkSmartPointer<vtkPerlinNoise> noiseFunction=vtkSmartPointer<vtkPerlinNoise>::New();
+  noiseFunction->SetAmplitude(this->NoiseAmplitude);
+  noiseFunction->SetFrequency(this->NoiseFrequency);
+  noiseFunction->SetPhase(this->NoisePhase);
+
+  const int size=this->NoiseTextureSizeVoxels;
+  double textureSizeMm[3]={0,0,0};
+  for (int axis=0; axis<3; axis++)
+  {
+    // If the frequency is 0 then the noise is constant along this axis, so any voxel size can be used
+    this->NoiseTextureVoxelSizeMm[axis] = (this->NoiseFrequency[axis]>0) ? 1.0/(this->NoiseFrequency[axis]*NOISE_TEXTURE_VOXELS_PER_NOISE_LATTICE_UNIT) : 1.0;
+    textureSizeMm[axis]=this->NoiseTextureVoxelSizeMm[axis]*size;
+  }
+
+  // The noise function is not periodic, therefore the texture is made periodic by blending the noise function with its copies
+  // shifted by the texture size (the weight of a copy linearly decreases with the distance from the copy).
+  // The blended value is normalized to keep the variance of the noise the same as the original noise.
+  this->NoiseTexture.resize(size*size*size);
+  double position[3]={0,0,0};
+  double shiftedPosition[3]={0,0,0};
+  std::vector<float>::iterator textureIt=this->NoiseTexture.begin();
+  for (int k=0; k<size; k++)
+  {
+    position[2]=k*this->NoiseTextureVoxelSizeMm[2];
+    for (int j=0; j<size; j++)
+    {
+      position[1]=j*this->NoiseTextureVoxelSizeMm[1];
+      for (int i=0; i<size; i++)
+      {
+        position[0]=i*this->NoiseTextureVoxelSizeMm[0];
+        double weightedSum=0;
+        double sumOfSquaredWeights=0;
+        for (int shift=0; shift<8; shift++)
+        {
+          double weight=1.0;
+          for (int axis=0; axis<3; axis++)
+          {
+            double positionRatio=position[axis]/textureSizeMm[axis];
+            if (shift & (1<<axis))
+            {
+              shiftedPosition[axis]=position[axis]-textureSizeMm[axis];
+              weight*=positionRatio;
+            }
+            else
+            {
+              shiftedPosition[axis]=position[axis];
+              weight*=1.0-positionRatio;
+            }
+          }
+          if (weight<=0)
+          {
+            continue;
+          }
+          weightedSum+=weight*noiseFunction->EvaluateFunction(shiftedPosition);
+          sumOfSquaredWeights+=weight*weight;
+        }
+        *(textureIt++)=weightedSum/sqrt(sumOfSquaredWeights);
+      }
+    }
+  }
+  LOG_DEBUG("Noise texture computed ("<<size<<"x"<<size<<"x"<<size<<" voxels)");
+}
+
+//-----------------------------------------------------------------------------
+double vtkUsSimulatorAlgo::GetNoiseFromTexture(const double position_Reference[3])
+{
+  const int size=this->NoiseTextureSizeVoxels;
+  int index0[3]={0,0,0};
+  int index1[3]={0,0,0};
+  double fraction[3]={0,0,0};
+  for (int axis=0; axis<3; axis++)
+  {
+    double voxelPosition=position_Reference[axis]/this->NoiseTextureVoxelSizeMm[axis];
+    double voxelPositionFloor=floor(voxelPosition);
+    fraction[axis]=voxelPosition-voxelPositionFloor;
+    // the texture is periodic, so wrap around the index
+    int index=static_cast<int>(voxelPositionFloor) % size;
+    if (index<0)
+    {
+      index+=size;
+    }
+    index0[axis]=index;
+    index1[axis]=(index+1<size) ? index+1 : 0;
+  }
+  const float* texture=&(this->NoiseTexture[0]);
+  const int sliceSize=size*size;
+  const float* row00=texture+index0[2]*sliceSize+index0[1]*size; // z0, y0
+  const float* row01=texture+index0[2]*sliceSize+index1[1]*size; // z0, y1
+  const float* row10=texture+index1[2]*sliceSize+index0[1]*size; // z1, y0
+  const float* row11=texture+index1[2]*sliceSize+index1[1]*size; // z1, y1
+  double c00=row00[index0[0]]+fraction[0]*(row00[index1[0]]-row00[index0[0]]);
+  double c01=row01[index0[0]]+fraction[0]*(row01[index1[0]]-row01[index0[0]]);
+  double c10=row10[index0[0]]+fraction[0]*(row10[index1[0]]-row10[index0[0]]);
+  double c11=row11[index0[0]]+fraction[0]*(row11[index1[0]]-row11[index0[0]]);
+  double c0=c00+fraction[1]*(c01-c00);
+  double c1=c10+fraction[1]*(c11-c10);
+  return c0+fraction[2]*(c1-c0);
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkUsSimulatorAlgo::GetFrameSize(int frameSize[2])
 {
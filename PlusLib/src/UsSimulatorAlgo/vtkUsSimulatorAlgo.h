@@ -11,6 +11,7 @@
 #include "vtkSmartPointer.h"
 #include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
+#include "vtkMultiThreader.h"
 
 #include "SpatialModel.h"
 #include "vtkTransformRepository.h"
@@ -19,6 +20,7 @@ class vtkPolyDataNormals;
 class vtkTriangleFilter;
 class vtkStripper;
 class vtkModifiedBSPTree;
+class vtkPerlinNoise;
 class vtkRfProcessor;
 
 /*!
@@ -84,8 +86,29 @@ public:
   /*! Set the length of scanlines in pixels */
   vtkSetMacro(NumberOfSamplesPerScanline, int); 
 
+  /*! Set the number of threads used for simulating the scanlines. If 0 then the default number of threads is used. */
+  vtkSetMacro(NumberOfThreads, int); 
+  /*! Get the number of threads used for simulating the scanlines. If 0 then the default number of threads is used. */
+  vtkGetMacro(NumberOfThreads, int); 
+
   PlusStatus GetFrameSize(int frameSize[2]);
 
+  /*! Set the amplitude of the noise that is added to the intensities. If 0 then no noise is added. */
+  void SetNoiseAmplitude(double amplitude);
+  vtkGetMacro(NoiseAmplitude, double);
+  /*! Set the frequency of the noise function along each axis, in 1/mm */
+  void SetNoiseFrequency(double frequency[3]);
+  vtkGetVector3Macro(NoiseFrequency, double);
+  /*! Set the phase of the noise function along each axis */
+  void SetNoisePhase(double phase[3]);
+  vtkGetVector3Macro(NoisePhase, double);
+  /*!
+    Set the size of the precomputed noise texture along each axis, in voxels. If the noise parameters are changed
+    after the configuration is read then the texture is recomputed when the next frame is simulated.
+  */
+  PlusStatus SetNoiseTextureSizeVoxels(int sizeVoxels);
+  vtkGetMacro(NoiseTextureSizeVoxels, int);
+
 protected:
   virtual int FillOutputPortInformation(int port, vtkInformation* info);
   virtual int RequestData(vtkInformation *request,
@@ -94,6 +117,26 @@ protected:
 
   void ConvertLineModelIntersectionsToSegmentDescriptor(std::deque<SpatialModel::LineIntersectionInfo> &lineIntersectionsWithModels);
 
+  /*!
+    Simulate the scanlines firstScanlineIndex, firstScanlineIndex+scanlineIndexIncrement, firstScanlineIndex+2*scanlineIndexIncrement, ...
+    and write the results into the ScanLinePixels buffer. Uses the scanline end points and noise function that are set up by RequestData.
+    \param threadIndex Index of the calling thread, used for selecting the line intersection workspace of the spatial models
+  */
+  PlusStatus SimulateScanlines(int firstScanlineIndex, int scanlineIndexIncrement, int threadIndex);
+
+  /*! Thread function for simulating scanlines. Called by vtkMultiThreader, the user data is the algorithm object. */
+  static VTK_THREAD_RETURN_TYPE SimulateScanlinesThreadFunction( void *arg );
+
+  /*!
+    Compute the noise texture from the noise parameters. The texture is periodic (it can be tiled seamlessly),
+    so that it can be used for sampling the noise at any position in the Reference coordinate system.
+    If NoiseTextureSizeVoxels is 0 then the texture is cleared.
+  */
+  void UpdateNoiseTexture();
+
+  /*! Get the noise value at the specified position from the noise texture by trilinear interpolation */
+  double GetNoiseFromTexture(const double position_Reference[3]);
+
 protected:
   vtkUsSimulatorAlgo();
   ~vtkUsSimulatorAlgo(); 
@@ -115,6 +158,11 @@ private:
   /*! Number of samples in one scanline */
   int NumberOfSamplesPerScanline;
 
+  /*! Number of threads used for simulating the scanlines. If 0 then the default number of threads is used. */
+  int NumberOfThreads;
+
+  vtkMultiThreader* Threader;
+
   vtkRfProcessor *RfProcessor;
 
   /*! Frequency of the ultrasound image to be generated*/
@@ -143,6 +191,32 @@ private:
   double NoiseAmplitude;
   double NoiseFrequency[3];
   double NoisePhase[3];
+
+  /*!
+    Size of the precomputed noise texture along each axis, in voxels. If 0 then the noise function is evaluated
+    at each sample point. Otherwise the noise is computed once (when the configuration is read) into a periodic 3D texture
+    and sampled by trilinear interpolation during simulation, which is much faster. The maximum size is 256 voxels.
+  */
+  int NoiseTextureSizeVoxels;
+  /*! Size of a noise texture voxel along each axis, in mm */
+  double NoiseTextureVoxelSizeMm[3];
+  /*! Precomputed noise values. The texture is repeated periodically in the Reference coordinate system. */
+  std::vector<float> NoiseTexture;
+  /*! True if the noise parameters have been changed since the noise texture was computed */
+  bool NoiseTextureOutdated;
+
+  // Data used by SimulateScanlines, set up in RequestData for each frame
+
+  /*! Start point of each scanline in the Reference coordinate system (4 values per scanline) */
+  std::vector<double> ScanLineStartPoints_Reference;
+  /*! End point of each scanline in the Reference coordinate system (4 values per scanline) */
+  std::vector<double> ScanLineEndPoints_Reference;
+  /*! Output buffer, contains the scanlines in rows */
+  unsigned char* ScanLinePixels;
+  double DistanceBetweenScanlineSamplePointsMm;
+  vtkPerlinNoise* NoiseFunction;
+  /*! Result of SimulateScanlines in each thread */
+  std::vector<PlusStatus> ThreadStatus;
 };
 
 #endif // __vtkUsSimulatorAlgo_h
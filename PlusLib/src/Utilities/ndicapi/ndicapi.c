@@ -92,6 +92,7 @@ struct ndicapi {
   char *thread_command;                   /* last command sent from thread */
   char *thread_reply;                     /* reply from the ndicapi */
   char *thread_buffer;                    /* buffer for previous reply */
+  int thread_buffer_length;               /* number of bytes in buffer */
   int thread_error;                       /* error code to go with buffer */
 
   /* command reply -- this is the return value from plCommand() */
@@ -178,6 +179,16 @@ struct ndicapi {
   int tx_npassive_stray;
   char tx_passive_stray_oov[14];
   char tx_passive_stray[1052];
+
+  /* BX command reply data, already decoded from the binary reply */
+
+  int bx_nhandles;
+  unsigned char bx_handles[NDI_MAX_HANDLES];
+  unsigned char bx_handle_status[NDI_MAX_HANDLES];
+  float bx_transforms[NDI_MAX_HANDLES][8];
+  unsigned long bx_port_status[NDI_MAX_HANDLES];
+  unsigned long bx_frame[NDI_MAX_HANDLES];
+  int bx_system_status;
 };
 
 /*---------------------------------------------------------------------
@@ -784,12 +795,96 @@ static void ndi_PHINF_helper(ndicapi *pol, const char *cp, const char *crp);
 static void ndi_PHSR_helper(ndicapi *pol, const char *cp, const char *crp);
 static void ndi_TX_helper(ndicapi *pol, const char *cp, const char *crp);
 static void ndi_GX_helper(ndicapi *pol, const char *cp, const char *crp);
+static void ndi_BX_helper(ndicapi *pol, const char *cp,
+                          const unsigned char *dp, int n);
 static void ndi_INIT_helper(ndicapi *pol, const char *cp, const char *crp);
 static void ndi_IRCHK_helper(ndicapi *pol, const char *cp, const char *crp);
 static void ndi_PSTAT_helper(ndicapi *pol, const char *cp, const char *crp);
 static void ndi_SSTAT_helper(ndicapi *pol, const char *cp, const char *crp);
 static void ndi_PHRQ_helper(ndicapi *pol, const char *cp, const char *crp);
 
+/*---------------------------------------------------------------------
+  Read exactly n bytes from the serial port.  The ndiSerialRead()
+  function returns early when a chunk of data ends with a carriage
+  return, which can be any byte of a binary reply, so keep reading
+  until all the bytes have arrived.
+
+  The return value is n if successful, zero if a timeout occurred,
+  or negative if an IO error occurred.
+*/
+static int ndi_read_binary(NDIFileHandle serial_port, char *rp, int n)
+{
+  int i = 0;
+  int m;
+
+  while (i < n) {
+    m = ndiSerialRead(serial_port, &rp[i], n - i);
+    if (m <= 0) {
+      return m;
+    }
+    i += m;
+  }
+
+  return i;
+}
+
+/*---------------------------------------------------------------------
+  Read a reply from the Measurement System into rp, which must have
+  space for 2048 bytes.
+
+  If 'binary' is set then the reply to a BX command is expected: the
+  length of a binary reply is given in its header, rather than by a
+  terminating carriage return.  Error replies are sent as text even
+  for the BX command, these are recognized by the missing start sequence.
+
+  The return value is the number of bytes read, zero if a timeout
+  occurred, or negative if an IO error occurred.  If the header of a
+  binary reply is corrupt, then only the header is read and the
+  caller will detect the bad CRC.
+*/
+static int ndi_read_reply(NDIFileHandle serial_port, char *rp, int binary)
+{
+  unsigned int CRC16 = 0;
+  int i, m, n;
+
+  if (!binary) {
+    return ndiSerialRead(serial_port, rp, 2047);
+  }
+
+  /* read the start sequence, the reply length and the header CRC */
+  m = ndi_read_binary(serial_port, rp, 6);
+  if (m <= 0) {
+    return m;
+  }
+
+  /* read the rest of a text reply */
+  if ((rp[0] & 0xff) != 0xc4 || (rp[1] & 0xff) != 0xa5) {
+    m = ndiSerialRead(serial_port, &rp[6], 2041);
+    if (m <= 0) {
+      return m;
+    }
+    return 6 + m;
+  }
+
+  /* don't trust the reply length unless the header CRC is good */
+  for (i = 0; i < 4; i++) {
+    CalcCRC16(rp[i], &CRC16);
+  }
+  n = (rp[2] & 0xff) | ((rp[3] & 0xff) << 8);
+  if (CRC16 != (unsigned int)((rp[4] & 0xff) | ((rp[5] & 0xff) << 8)) ||
+      n + 8 > 2047) {
+    return 6;
+  }
+
+  /* read the reply body and the body CRC */
+  m = ndi_read_binary(serial_port, &rp[6], n + 2);
+  if (m <= 0) {
+    return m;
+  }
+
+  return 6 + m;
+}
+
 /*---------------------------------------------------------------------*/
 char *ndiCommand(ndicapi *pol, const char *format, ...)
 {
@@ -807,7 +902,7 @@ char *ndiCommand(ndicapi *pol, const char *format, ...)
 /*---------------------------------------------------------------------*/
 char *ndiCommandVA(ndicapi *pol, const char *format, va_list ap)
 {
-  int i, m, nc;
+  int i, m, n, nc;
   unsigned int CRC16 = 0;
   int use_crc = 0;
   int in_command = 1;
@@ -910,11 +1005,11 @@ char *ndiCommandVA(ndicapi *pol, const char *format, va_list ap)
       ndi_set_error(pol, NDI_TIMEOUT);
       return crp;
     }
-    /* copy the thread's reply buffer into the main reply buffer */
+    /* copy the thread's reply buffer into the main reply buffer, the
+       length is used because a binary BX reply may contain '\0' bytes */
     ndiMutexLock(pol->thread_buffer_mutex);
-    for (m = 0; pol->thread_buffer[m] != '\0'; m++) {
-      rp[m] = pol->thread_buffer[m];
-    }
+    m = pol->thread_buffer_length;
+    memcpy(rp, pol->thread_buffer, m);
     rp[m] = '\0';   /* terminate string */
     errcode = pol->thread_error;
     ndiMutexUnlock(pol->thread_buffer_mutex);
@@ -970,7 +1065,8 @@ char *ndiCommandVA(ndicapi *pol, const char *format, va_list ap)
     /* read the reply from the Measurement System */
     m = 0;
     if (errcode == 0) {
-      m = ndiSerialRead(pol->serial_device, rp, 2047);
+      m = ndi_read_reply(pol->serial_device, rp,
+                         (nc == 2 && cp[0] == 'B' && cp[1] == 'X'));
       if (m < 0) {
         errcode = NDI_WRITE_ERROR;
         m = 0;
@@ -994,6 +1090,36 @@ char *ndiCommandVA(ndicapi *pol, const char *format, va_list ap)
     }
   }
 
+  /* the BX command replies in binary, unless an error occurred */
+  if (nc == 2 && cp[0] == 'B' && cp[1] == 'X' &&
+      m >= 6 && (rp[0] & 0xff) == 0xc4 && (rp[1] & 0xff) == 0xa5) {
+    /* check the header CRC and the reply length */
+    CRC16 = 0;
+    for (i = 0; i < 4; i++) {
+      CalcCRC16(rp[i], &CRC16);
+    }
+    n = (rp[2] & 0xff) | ((rp[3] & 0xff) << 8);
+    if (CRC16 != (unsigned int)((rp[4] & 0xff) | ((rp[5] & 0xff) << 8)) ||
+        m < n + 8) {
+      ndi_set_error(pol, NDI_BAD_CRC);
+      return crp;
+    }
+
+    /* check the CRC of the reply body */
+    CRC16 = 0;
+    for (i = 6; i < n + 6; i++) {
+      CalcCRC16(rp[i], &CRC16);
+    }
+    if (CRC16 != (unsigned int)((rp[n+6] & 0xff) | ((rp[n+7] & 0xff) << 8))) {
+      ndi_set_error(pol, NDI_BAD_CRC);
+      return crp;
+    }
+
+    /* decode the reply, there is no text reply to return */
+    ndi_BX_helper(pol, cp, (const unsigned char *)&rp[6], n);
+    return crp;
+  }
+
   /* back up to before the CRC */
   m -= 5;
   if (m < 0) {
@@ -1411,6 +1537,69 @@ int ndiGetTXSystemStatus(ndicapi *pol)
   return (int)ndiHexToUnsignedLong(dp, 4);
 }
 
+/*---------------------------------------------------------------------*/
+int ndiGetBXTransform(ndicapi *pol, int ph, double transform[8])
+{
+  float *fp;
+  int i, n;
+
+  n = pol->bx_nhandles;
+  for (i = 0; i < n; i++) {
+    if (pol->bx_handles[i] == ph) {
+      break;
+    }
+  }
+  if (i == n || (pol->bx_handle_status[i] & 0x04) != 0) {
+    return NDI_DISABLED;
+  }
+  else if (pol->bx_handle_status[i] != 0x01) {
+    return NDI_MISSING;
+  }
+
+  fp = pol->bx_transforms[i];
+  for (i = 0; i < 8; i++) {
+    transform[i] = fp[i];
+  }
+
+  return NDI_OKAY;
+}
+
+/*---------------------------------------------------------------------*/
+int ndiGetBXPortStatus(ndicapi *pol, int ph)
+{
+  int i, n;
+
+  n = pol->bx_nhandles;
+  for (i = 0; i < n; i++) {
+    if (pol->bx_handles[i] == ph) {
+      return (int)pol->bx_port_status[i];
+    }
+  }
+
+  return 0;
+}
+
+/*---------------------------------------------------------------------*/
+unsigned long ndiGetBXFrame(ndicapi *pol, int ph)
+{
+  int i, n;
+
+  n = pol->bx_nhandles;
+  for (i = 0; i < n; i++) {
+    if (pol->bx_handles[i] == ph) {
+      return pol->bx_frame[i];
+    }
+  }
+
+  return 0;
+}
+
+/*---------------------------------------------------------------------*/
+int ndiGetBXSystemStatus(ndicapi *pol)
+{
+  return pol->bx_system_status;
+}
+
 /*---------------------------------------------------------------------*/
 int ndiGetGXTransform(ndicapi *pol, int port, double transform[8])
 {
@@ -2235,6 +2424,100 @@ static void ndi_TX_helper(ndicapi *pol, const char *cp, const char *crp)
   }
 }
 
+/*---------------------------------------------------------------------
+  Decode the binary BX reply into the ndicapi structure.  The reply body
+  is little-endian, the transforms are 32-bit IEEE floats.  All the data
+  is stored in preallocated arrays, so no memory is allocated and no
+  text is parsed while tracking.
+
+  This function is called every time a BX command is sent to the
+  Measurement System.  Only the NDI_XFORMS_AND_STATUS (0x0001) handle
+  data is decoded, if other per-handle data is requested then the
+  handles are skipped and only the system status is stored.
+
+  This information can be later extracted through one of the ndiGetBXxx()
+  functions.
+
+  dp -> the reply body, without the header and the CRCs
+  n  -> the number of bytes in the reply body
+*/
+static void ndi_BX_helper(ndicapi *pol, const char *cp,
+                          const unsigned char *dp, int n)
+{
+  unsigned long mode = 0x0001; /* the default reply mode */
+  const unsigned char *ep;
+  unsigned int bits;
+  float f;
+  int i, j, nhandles, status;
+
+  /* if the BX command had a reply mode, read it */
+  if ((cp[2] == ':' && cp[7] != '\r') || (cp[2] == ' ' && cp[3] != '\r')) { 
+    mode = ndiHexToUnsignedLong(&cp[3], 4);
+  }
+
+  pol->bx_nhandles = 0;
+  pol->bx_system_status = 0;
+
+  /* the system status is always the last two bytes of the reply */
+  if (n < 3) {
+    return;
+  }
+  ep = dp + n - 2;
+  pol->bx_system_status = ep[0] | (ep[1] << 8);
+
+  if ((mode & (NDI_ADDITIONAL_INFO | NDI_SINGLE_STRAY | 0x0008)) != 0) {
+    return;
+  }
+
+  /* get the number of handles */
+  nhandles = *dp++;
+  if (nhandles > NDI_MAX_HANDLES) {
+    nhandles = NDI_MAX_HANDLES;
+  }
+
+  /* go through the information for each handle */
+  for (i = 0; i < nhandles && dp + 2 <= ep; i++) {
+    pol->bx_handles[i] = *dp++;
+    status = *dp++;
+    pol->bx_handle_status[i] = (unsigned char)status;
+    pol->bx_port_status[i] = 0;
+    pol->bx_frame[i] = 0;
+
+    /* there is no more information for a disabled handle */
+    if ((status & 0x04) != 0 || (mode & NDI_XFORMS_AND_STATUS) == 0) {
+      continue;
+    }
+
+    /* the transform is only sent if it is valid (i.e. not missing) */
+    if (status == 0x01) {
+      if (dp + 32 > ep) {
+        break;
+      }
+      for (j = 0; j < 8; j++) {
+        bits = (unsigned int)dp[0] | ((unsigned int)dp[1] << 8) |
+               ((unsigned int)dp[2] << 16) | ((unsigned int)dp[3] << 24);
+        memcpy(&f, &bits, 4);   /* reinterpret the bits as an IEEE float */
+        pol->bx_transforms[i][j] = f;
+        dp += 4;
+      }
+    }
+
+    /* get the port status and the frame number */
+    if (dp + 8 > ep) {
+      break;
+    }
+    pol->bx_port_status[i] = (unsigned long)dp[0] | ((unsigned long)dp[1] << 8) |
+      ((unsigned long)dp[2] << 16) | ((unsigned long)dp[3] << 24);
+    dp += 4;
+    pol->bx_frame[i] = (unsigned long)dp[0] | ((unsigned long)dp[1] << 8) |
+      ((unsigned long)dp[2] << 16) | ((unsigned long)dp[3] << 24);
+    dp += 4;
+  }
+
+  /* save the number of handles that were completely decoded */
+  pol->bx_nhandles = i;
+}
+
 /*---------------------------------------------------------------------
   Copy all the GX reply information into the ndicapi structure, according
   to the GX reply mode that was requested.
@@ -2760,8 +3043,9 @@ static void *ndi_thread(void *userdata)
     }
     
     /* read the reply from the Measurement System */
+    m = 0;
     if (errcode == 0) {
-      m = ndiSerialRead(pol->serial_device, rp, 2047);
+      m = ndi_read_reply(pol->serial_device, rp, (cp[0] == 'B'));
       if (m < 0) {
         errcode = NDI_READ_ERROR;
         m = 0;
@@ -2776,7 +3060,8 @@ static void *ndi_thread(void *userdata)
     /* lock the buffer */
     ndiMutexLock(pol->thread_buffer_mutex);
     /* copy the reply into the buffer, also copy the error code */
-    strcpy(pol->thread_buffer, rp);
+    memcpy(pol->thread_buffer, rp, m + 1);
+    pol->thread_buffer_length = m;
     pol->thread_error = errcode;
     /* signal the main thread that a new data record is ready */
     ndiEventSignal(pol->thread_buffer_event);
@@ -2801,6 +3086,7 @@ static void ndi_spawn_thread(ndicapi *pol)
   pol->thread_reply[0] = '\0';
   pol->thread_buffer = (char *)malloc(2048);
   pol->thread_buffer[0] = '\0';
+  pol->thread_buffer_length = 0;
   pol->thread_error = 0;
 
   pol->thread_buffer_mutex = ndiMutexCreate();
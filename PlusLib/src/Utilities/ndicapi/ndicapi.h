@@ -189,6 +189,9 @@ void ndiSetThreadMode(ndicapi *pol, int mode);
            be retrieved though the ndiGetTX() functions.
   - "GX:"   - The information returned by the GX command is stored and can
            be retrieved though the ndiGetGX() functions.
+  - "BX:"   - The binary reply to the BX command is decoded and stored and
+           can be retrieved though the ndiGetBX() functions.  There is no
+           text reply, so an empty string is returned.
   - "PSTAT:" - The information returned by the PSTAT command is stored and
            can be retrieved through one of the ndiGetPSTAT() functions.
   - "SSTAT:" - The information returned by the SSTAT command is stored and
@@ -640,6 +643,24 @@ void ndiSetErrorCallback(ndicapi *pol, NDIErrorCallback callback,
 */
 #define ndiTX(p,mode) ndiCommand((p),"TX:%04X",(mode))
 
+/*!
+  Request tracking information from the device in binary format.  This
+  command is only available in tracking mode.  The binary reply is
+  shorter than the TX reply and it is decoded without parsing text,
+  so it allows a higher update rate.
+
+  \param mode a reply mode containing the following bits:
+  - NDI_XFORMS_AND_STATUS  0x0001 - transforms and status
+
+  <p>The BX command with the appropriate reply mode is used to update the
+  data that is returned by the following functions:
+  - int \ref ndiGetBXTransform(ndicapi *pol, int ph, double transform[8])
+  - int \ref ndiGetBXPortStatus(ndicapi *pol, int ph)
+  - unsigned long \ref ndiGetBXFrame(ndicapi *pol, int ph)
+  - int \ref ndiGetBXSystemStatus(ndicapi *pol)
+*/
+#define ndiBX(p,mode) ndiCommand((p),"BX:%04X",(mode))
+
 /*!
   Get a string that describes the device firmware version.
 
@@ -1098,6 +1119,59 @@ int ndiGetTXPassiveStray(ndicapi *pol, int i, double coord[3]);
 */
 int ndiGetTXSystemStatus(ndicapi *pol);
 
+/*! \ingroup GetMethods
+  Get the transformation for the specified port handle from the
+  reply to the latest BX command.  The values are the same as for
+  ndiGetTXTransform(), but they have single float precision.
+
+  \param pol       valid NDI device handle
+  \param ph        valid port handle in range 0x01 to 0xFF
+  \param transform space for the 8 numbers in the transformation
+  
+  \return one of the following: 
+  - NDI_OKAY if successful
+  - NDI_DISABLED if tool port is nonexistent or disabled
+  - NDI_MISSING if tool transform cannot be computed
+
+  <p>If NDI_DISABLED or NDI_MISSING is returned, then the values in the
+  supplied transform array will be left unchanged.
+*/ 
+int ndiGetBXTransform(ndicapi *pol, int ph, double transform[8]);
+
+/*! \ingroup GetMethods
+  Get the status value for the specified port handle from the
+  reply to the latest BX command.  The status bits are the same
+  as for ndiGetTXPortStatus().
+
+  \param pol       valid NDI device handle
+  \param ph        valid port handle in range 0x01 to 0xFF
+
+  \return status bits or zero if there is no information
+*/
+int ndiGetBXPortStatus(ndicapi *pol, int ph);
+
+/*! \ingroup GetMethods
+  Get the camera frame number for the latest transform from the
+  reply to the latest BX command.
+
+  \param pol       valid NDI device handle
+  \param ph        valid port handle in range 0x01 to 0xFF
+
+  \return a 32-bit frame number, or zero if no information was available
+*/
+unsigned long ndiGetBXFrame(ndicapi *pol, int ph);
+
+/*! \ingroup GetMethods
+  Get the 16-bit status bitfield for the system from the reply
+  to the latest BX command.  The status bits are the same as for
+  ndiGetTXSystemStatus().
+
+  \param pol       valid NDI device handle
+
+  \return status bits or zero if there is no information
+*/
+int ndiGetBXSystemStatus(ndicapi *pol);
+
 /*! \ingroup GetMethods
   Get the transformation for the specified port.
   The first four numbers are a quaternion, the next three numbers are
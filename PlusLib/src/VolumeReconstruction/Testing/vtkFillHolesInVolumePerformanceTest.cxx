@@ -0,0 +1,189 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkFillHolesInVolumePerformanceTest.cxx
+  \brief This program fills the holes in a synthetic sparse volume with each type of hole filling element,
+  with and without optimization. It verifies that the results are identical and reports the computation times.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkAccurateTimer.h"
+#include "vtkFillHolesInVolume.h"
+#include "vtkImageData.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Create a sparse volume similar to a reconstructed freehand sweep: parallel slices in a sphere with a few
+  // randomly hit voxels between them, a densely filled region and large empty regions around
+  void CreateSparseVolume(int volumeSize, vtkImageData* volume, vtkImageData* accumulationBuffer)
+  {
+    int extent[6]={0, volumeSize-1, 0, volumeSize-1, 0, volumeSize-1};
+    volume->SetExtent(extent);
+    accumulationBuffer->SetExtent(extent);
+#if (VTK_MAJOR_VERSION < 6)
+    volume->SetScalarTypeToUnsignedChar();
+    volume->SetNumberOfScalarComponents(2); // intensity and alpha
+    volume->AllocateScalars();
+    accumulationBuffer->SetScalarTypeToUnsignedShort();
+    accumulationBuffer->SetNumberOfScalarComponents(1);
+    accumulationBuffer->AllocateScalars();
+#else
+    volume->AllocateScalars(VTK_UNSIGNED_CHAR, 2);
+    accumulationBuffer->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+#endif
+
+    unsigned char* volumePtr = static_cast<unsigned char*>(volume->GetScalarPointer());
+    unsigned short* accPtr = static_cast<unsigned short*>(accumulationBuffer->GetScalarPointer());
+    const double center = volumeSize/2.0;
+    const double sweepRadius = 0.35*volumeSize;
+    unsigned int randomSeed = 1;
+    for (int z = 0; z < volumeSize; z++)
+    {
+      for (int y = 0; y < volumeSize; y++)
+      {
+        for (int x = 0; x < volumeSize; x++)
+        {
+          // simple linear congruential generator, so that the volume is the same on all platforms
+          randomSeed = randomSeed*1103515245 + 12345;
+          double distanceSquare = (x-center)*(x-center) + (y-center)*(y-center) + (z-center)*(z-center);
+          bool insideSweep = ( distanceSquare < sweepRadius*sweepRadius );
+          bool hit = ( insideSweep && z%4 == 0 ) // slices
+            || ( insideSweep && (randomSeed>>16)%997 == 0 ) // scattered voxels
+            || ( x >= volumeSize*2/3 && y >= volumeSize*2/3 && z >= volumeSize*2/3 && x < volumeSize-2 && y < volumeSize-2 && z < volumeSize-2 ); // dense region
+          if (hit)
+          {
+            accPtr[0] = 1 + (randomSeed>>8)%3;
+            volumePtr[0] = (randomSeed>>12)&255;
+            volumePtr[1] = 255;
+          }
+          else
+          {
+            accPtr[0] = 0;
+            volumePtr[0] = 0;
+            volumePtr[1] = 0;
+          }
+          accPtr++;
+          volumePtr += 2;
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Fill the holes and return the computation time in sec
+  double FillHoles(vtkImageData* volume, vtkImageData* accumulationBuffer, FillHolesInVolumeElement& element,
+    vtkFillHolesInVolume::OptimizationType optimization, vtkImageData* filledVolume)
+  {
+    vtkSmartPointer<vtkFillHolesInVolume> holeFiller = vtkSmartPointer<vtkFillHolesInVolume>::New();
+    holeFiller->SetNumHFElements(1);
+    holeFiller->AllocateHFElements();
+    holeFiller->SetHFElement(0, element);
+    holeFiller->SetOptimization(optimization);
+    holeFiller->SetReconstructedVolume(volume);
+    holeFiller->SetAccumulationBuffer(accumulationBuffer);
+
+    double startTimeSec = vtkAccurateTimer::GetSystemTime();
+    holeFiller->Update();
+    double computationTimeSec = vtkAccurateTimer::GetSystemTime() - startTimeSec;
+
+    filledVolume->DeepCopy(holeFiller->GetOutput());
+    return computationTimeSec;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  bool printHelp(false);
+  int volumeSize(128);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--volume-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &volumeSize, "Size of the synthetic volume along each axis, in voxels (Default: 128).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if ( printHelp )
+  {
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  if ( volumeSize < 1 )
+  {
+    std::cerr << "volume-size shall be positive" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkImageData> accumulationBuffer = vtkSmartPointer<vtkImageData>::New();
+  CreateSparseVolume(volumeSize, volume, accumulationBuffer);
+
+  const int numberOfElementTypes = 5;
+  FillHolesInVolumeElement elements[numberOfElementTypes];
+  const char* elementNames[numberOfElementTypes] = { "GAUSSIAN", "GAUSSIAN_ACCUMULATION", "DISTANCE_WEIGHT_INVERSE", "NEAREST_NEIGHBOR", "STICK" };
+  elements[0].type = FillHolesInVolumeElement::HFTYPE_GAUSSIAN;
+  elements[0].size = 5;
+  elements[0].stdev = 1.0f;
+  elements[0].minRatio = 0.05f;
+  elements[1].type = FillHolesInVolumeElement::HFTYPE_GAUSSIAN_ACCUMULATION;
+  elements[1].size = 5;
+  elements[1].stdev = 1.5f;
+  elements[1].minRatio = 0.0f;
+  elements[2].type = FillHolesInVolumeElement::HFTYPE_DISTANCE_WEIGHT_INVERSE;
+  elements[2].size = 3;
+  elements[2].minRatio = 0.1f;
+  elements[3].type = FillHolesInVolumeElement::HFTYPE_NEAREST_NEIGHBOR;
+  elements[3].size = 5;
+  elements[3].minRatio = 0.0f;
+  elements[4].type = FillHolesInVolumeElement::HFTYPE_STICK;
+  elements[4].stickLengthLimit = 9;
+  elements[4].numSticksToUse = 1;
+
+  int numberOfErrors(0);
+  for (int i = 0; i < numberOfElementTypes; i++)
+  {
+    vtkSmartPointer<vtkImageData> referenceVolume = vtkSmartPointer<vtkImageData>::New();
+    double referenceTimeSec = FillHoles(volume, accumulationBuffer, elements[i], vtkFillHolesInVolume::NO_OPTIMIZATION, referenceVolume);
+    vtkSmartPointer<vtkImageData> optimizedVolume = vtkSmartPointer<vtkImageData>::New();
+    double optimizedTimeSec = FillHoles(volume, accumulationBuffer, elements[i], vtkFillHolesInVolume::FULL_OPTIMIZATION, optimizedVolume);
+
+    LOG_INFO(elementNames[i] << ": computation time without optimization: " << std::fixed << referenceTimeSec << " sec, with optimization: " << optimizedTimeSec
+      << " sec, speedup: " << referenceTimeSec/optimizedTimeSec);
+
+    const int volumeSizeInBytes = volumeSize*volumeSize*volumeSize*referenceVolume->GetNumberOfScalarComponents()*referenceVolume->GetScalarSize();
+    if ( referenceVolume->GetScalarPointer() == NULL || optimizedVolume->GetScalarPointer() == NULL
+      || memcmp(referenceVolume->GetScalarPointer(), optimizedVolume->GetScalarPointer(), volumeSizeInBytes) != 0 )
+    {
+      LOG_ERROR(elementNames[i] << ": hole filling results are different with and without optimization");
+      numberOfErrors++;
+    }
+  }
+
+  if ( numberOfErrors > 0 )
+  {
+    LOG_ERROR("vtkFillHolesInVolumePerformanceTest failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("vtkFillHolesInVolumePerformanceTest completed successfully");
+  return EXIT_SUCCESS;
+}
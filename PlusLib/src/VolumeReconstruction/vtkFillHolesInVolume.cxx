@@ -55,6 +55,7 @@ POSSIBILITY OF SUCH DAMAGES.
 #include "vtkImageExtractComponents.h"
 #include "vtkMetaImageWriter.h"
 
+#include <algorithm>
 #include <math.h>
 
 static const int INPUT_PORT_RECONSTRUCTED_VOLUME=0;
@@ -64,6 +65,28 @@ static const int INPUT_PORT_ACCUMULATION_BUFFER=1;
 static const unsigned char OPAQUE_ALPHA=255;
 #endif
 
+// Number of stick orientations used by the STICK element
+static const int NUMBER_OF_STICKS=13;
+
+// Size of the blocks (along each axis, in voxels) that are processed together if optimization is enabled
+static const int FILL_HOLES_BLOCK_SIZE=8;
+
+enum FillHolesBlockType
+{
+  BLOCK_PARTIALLY_FILLED=0, // the kernels have to be evaluated for the holes in the block
+  BLOCK_FILLED, // there are no holes in the block, the voxels are just copied
+  BLOCK_EMPTY_NEIGHBORHOOD // there are no known voxels in and around the block, so the holes cannot be filled
+};
+
+//----------------------------------------------------------------------------
+// Returns true if all the voxels within the radius of the voxel are inside the extent
+static inline bool IsNeighborhoodInsideExtent(int* pixel, int radius, int* extent)
+{
+  return pixel[0]-radius >= extent[0] && pixel[0]+radius <= extent[1]
+    && pixel[1]-radius >= extent[2] && pixel[1]+radius <= extent[3]
+    && pixel[2]-radius >= extent[4] && pixel[2]+radius <= extent[5];
+}
+
 ///////////
 
 vtkStandardNewMacro(vtkFillHolesInVolume);
@@ -194,6 +217,110 @@ void FillHolesInVolumeElement::allocateDistanceWeightInverse()
 
 //----------------------------------------------------------------------------
 
+int FillHolesInVolumeElement::getNeighborhoodRadius()
+{
+  if (type == FillHolesInVolumeElement::HFTYPE_STICK)
+  {
+    // the sticks are traversed until the (stickLengthLimit-1)th voxel in each direction
+    return (stickLengthLimit > 1) ? stickLengthLimit-1 : 0;
+  }
+  return (size-1)/2;
+}
+
+//----------------------------------------------------------------------------
+
+void FillHolesInVolumeElement::clearKernelOffsets()
+{
+  kernelInputOffsets.clear();
+  kernelAccOffsets.clear();
+  kernelWeights.clear();
+}
+
+//----------------------------------------------------------------------------
+
+void FillHolesInVolumeElement::computeKernelOffsets(vtkIdType* inputOffsets, vtkIdType* accOffsets)
+{
+  clearKernelOffsets();
+  switch (type) 
+  {
+  case FillHolesInVolumeElement::HFTYPE_GAUSSIAN:
+  case FillHolesInVolumeElement::HFTYPE_GAUSSIAN_ACCUMULATION:
+  case FillHolesInVolumeElement::HFTYPE_DISTANCE_WEIGHT_INVERSE:
+    {
+      if (kernel == NULL)
+      {
+        return;
+      }
+      // use the same order as the evaluation with boundary checks (x is the outermost loop), so that
+      // the weighted sums are computed in the same order and the results are exactly the same
+      int range = (size-1)/2;
+      for (int x = 0; x <= 2*range; x++)
+      {
+        for (int y = 0; y <= 2*range; y++)
+        {
+          for (int z = 0; z <= 2*range; z++)
+          {
+            kernelInputOffsets.push_back(inputOffsets[0]*(x-range)+inputOffsets[1]*(y-range)+inputOffsets[2]*(z-range));
+            kernelAccOffsets.push_back(accOffsets[0]*(x-range)+accOffsets[1]*(y-range)+accOffsets[2]*(z-range));
+            kernelWeights.push_back(kernel[size*size*z+size*y+x]);
+          }
+        }
+      }
+    }
+    break;
+  case FillHolesInVolumeElement::HFTYPE_STICK:
+    {
+      if (sticksList == NULL)
+      {
+        return;
+      }
+      for (int i = 0; i < numSticksInList; i++)
+      {
+        int baseStickIndex = i * 3;
+        kernelInputOffsets.push_back(inputOffsets[0]*sticksList[baseStickIndex]+inputOffsets[1]*sticksList[baseStickIndex+1]+inputOffsets[2]*sticksList[baseStickIndex+2]);
+        kernelAccOffsets.push_back(accOffsets[0]*sticksList[baseStickIndex]+accOffsets[1]*sticksList[baseStickIndex+1]+accOffsets[2]*sticksList[baseStickIndex+2]);
+      }
+    }
+    break;
+  default:
+    // offsets are not used
+    break;
+  }
+}
+
+//----------------------------------------------------------------------------
+
+template <class T>
+void FillHolesInVolumeElement::sumKnownVoxelsInKernel(
+                        T* inputData,            // contains the dataset being interpolated between
+                        unsigned short* accData, // contains the weights of each voxel
+                        vtkIdType* inputOffsets, // contains the indexing offsets between adjacent x,y,z
+                        vtkIdType* accOffsets,
+                        const int& inputComp,     // the component index of interest
+                        int* thisPixel,           // The x,y,z coordinates of the voxel being calculated
+                        bool weightByAccumulation, // multiply the kernel weights by the accumulation buffer values
+                        double& sumIntensities, double& sumAccumulator, int& numKnownVoxels)
+{
+  const vtkIdType accBaseIndex = accOffsets[0]*thisPixel[0]+accOffsets[1]*thisPixel[1]+accOffsets[2]*thisPixel[2];
+  const vtkIdType volBaseIndex = inputOffsets[0]*thisPixel[0]+inputOffsets[1]*thisPixel[1]+inputOffsets[2]*thisPixel[2]+inputComp;
+  const vtkIdType* kernelAccOffsetsPtr = &(kernelAccOffsets[0]);
+  const vtkIdType* kernelInputOffsetsPtr = &(kernelInputOffsets[0]);
+  const float* kernelWeightsPtr = &(kernelWeights[0]);
+  const int numberOfKernelVoxels = kernelAccOffsets.size();
+  for (int i = 0; i < numberOfKernelVoxels; i++)
+  {
+    unsigned short currentAccumulation = accData[accBaseIndex+kernelAccOffsetsPtr[i]];
+    if (currentAccumulation) { // if the accumulation buffer for the voxel is non-zero
+      double weight = weightByAccumulation ? currentAccumulation * kernelWeightsPtr[i] : kernelWeightsPtr[i];
+      sumIntensities += inputData[volBaseIndex+kernelInputOffsetsPtr[i]] * weight;
+      sumAccumulator += weight;
+      numKnownVoxels++;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+
 template <class T>
 bool FillHolesInVolumeElement::applyDistanceWeightInverse(
                         T* inputData,            // contains the dataset being interpolated between
@@ -221,30 +348,38 @@ bool FillHolesInVolumeElement::applyDistanceWeightInverse(
   unsigned short currentAccumulation(0);
   int numKnownVoxels(0);
 
-  for (int x = minX; x <= maxX; x++)
+  if (!kernelAccOffsets.empty() && IsNeighborhoodInsideExtent(thisPixel, range, wholeExtent))
   {
-    for (int y = minY; y <= maxY; y++)
+    // the kernel is completely inside the volume, so the precomputed offsets can be used without boundary checks
+    sumKnownVoxelsInKernel(inputData, accData, inputOffsets, accOffsets, inputComp, thisPixel, false, sumIntensities, sumAccumulator, numKnownVoxels);
+  }
+  else
+  {
+    for (int x = minX; x <= maxX; x++)
     {
-      for (int z = minZ; z <= maxZ; z++)
+      for (int y = minY; y <= maxY; y++)
       {
-        if (x <= wholeExtent[1] && x >= wholeExtent[0] &&
-          y <= wholeExtent[3] && y >= wholeExtent[2] &&
-          z <= wholeExtent[5] && z >= wholeExtent[4] ) // check bounds
+        for (int z = minZ; z <= maxZ; z++)
         {
-          int accIndex =   accOffsets[0]*x+  accOffsets[1]*y+  accOffsets[2]*z;
-          currentAccumulation = accData[accIndex];
-          if (currentAccumulation) { // if the accumulation buffer for the voxel is non-zero
-            int volIndex = inputOffsets[0]*x+inputOffsets[1]*y+inputOffsets[2]*z+inputComp;
-            int kerIndex = size*size*(z-minZ)+size*(y-minY)+(x-minX);
-            double weight = kernel[kerIndex];
-            sumIntensities += inputData[volIndex] * weight;
-            sumAccumulator += weight;
-            numKnownVoxels++;
-          }
-        } // end boundary check
-      } // end z loop
-    } // end y loop
-  } // end x loop
+          if (x <= wholeExtent[1] && x >= wholeExtent[0] &&
+            y <= wholeExtent[3] && y >= wholeExtent[2] &&
+            z <= wholeExtent[5] && z >= wholeExtent[4] ) // check bounds
+          {
+            int accIndex =   accOffsets[0]*x+  accOffsets[1]*y+  accOffsets[2]*z;
+            currentAccumulation = accData[accIndex];
+            if (currentAccumulation) { // if the accumulation buffer for the voxel is non-zero
+              int volIndex = inputOffsets[0]*x+inputOffsets[1]*y+inputOffsets[2]*z+inputComp;
+              int kerIndex = size*size*(z-minZ)+size*(y-minY)+(x-minX);
+              double weight = kernel[kerIndex];
+              sumIntensities += inputData[volIndex] * weight;
+              sumAccumulator += weight;
+              numKnownVoxels++;
+            }
+          } // end boundary check
+        } // end z loop
+      } // end y loop
+    } // end x loop
+  }
 
   if (sumAccumulator == 0) { // no voxels set in the area
     returnVal = (T)0;
@@ -359,30 +494,38 @@ bool FillHolesInVolumeElement::applyGaussian(
   unsigned short currentAccumulation(0);
   int numKnownVoxels(0);
 
-  for (int x = minX; x <= maxX; x++)
+  if (!kernelAccOffsets.empty() && IsNeighborhoodInsideExtent(thisPixel, range, wholeExtent))
+  {
+    // the kernel is completely inside the volume, so the precomputed offsets can be used without boundary checks
+    sumKnownVoxelsInKernel(inputData, accData, inputOffsets, accOffsets, inputComp, thisPixel, false, sumIntensities, sumAccumulator, numKnownVoxels);
+  }
+  else
   {
-    for (int y = minY; y <= maxY; y++)
+    for (int x = minX; x <= maxX; x++)
     {
-      for (int z = minZ; z <= maxZ; z++)
+      for (int y = minY; y <= maxY; y++)
       {
-        if (x <= wholeExtent[1] && x >= wholeExtent[0] &&
-          y <= wholeExtent[3] && y >= wholeExtent[2] &&
-          z <= wholeExtent[5] && z >= wholeExtent[4] ) // check bounds
+        for (int z = minZ; z <= maxZ; z++)
         {
-          int accIndex =   accOffsets[0]*x+  accOffsets[1]*y+  accOffsets[2]*z;
-          currentAccumulation = accData[accIndex];
-          if (currentAccumulation) { // if the accumulation buffer for the voxel is non-zero
-            int volIndex = inputOffsets[0]*x+inputOffsets[1]*y+inputOffsets[2]*z+inputComp;
-            int kerIndex = size*size*(z-minZ)+size*(y-minY)+(x-minX);
-            double weight = kernel[kerIndex];
-            sumIntensities += inputData[volIndex] * weight;
-            sumAccumulator += weight;
-            numKnownVoxels++;
-          }
-        } // end boundary check
-      } // end z loop
-    } // end y loop
-  } // end x loop
+          if (x <= wholeExtent[1] && x >= wholeExtent[0] &&
+            y <= wholeExtent[3] && y >= wholeExtent[2] &&
+            z <= wholeExtent[5] && z >= wholeExtent[4] ) // check bounds
+          {
+            int accIndex =   accOffsets[0]*x+  accOffsets[1]*y+  accOffsets[2]*z;
+            currentAccumulation = accData[accIndex];
+            if (currentAccumulation) { // if the accumulation buffer for the voxel is non-zero
+              int volIndex = inputOffsets[0]*x+inputOffsets[1]*y+inputOffsets[2]*z+inputComp;
+              int kerIndex = size*size*(z-minZ)+size*(y-minY)+(x-minX);
+              double weight = kernel[kerIndex];
+              sumIntensities += inputData[volIndex] * weight;
+              sumAccumulator += weight;
+              numKnownVoxels++;
+            }
+          } // end boundary check
+        } // end z loop
+      } // end y loop
+    } // end x loop
+  }
 
   if (sumAccumulator == 0) { // no voxels set in the area
     returnVal = (T)0;
@@ -430,30 +573,38 @@ bool FillHolesInVolumeElement::applyGaussianAccumulation(
   unsigned short currentAccumulation(0);
   int numKnownVoxels(0);
 
-  for (int x = minX; x <= maxX; x++)
+  if (!kernelAccOffsets.empty() && IsNeighborhoodInsideExtent(thisPixel, range, wholeExtent))
   {
-    for (int y = minY; y <= maxY; y++)
+    // the kernel is completely inside the volume, so the precomputed offsets can be used without boundary checks
+    sumKnownVoxelsInKernel(inputData, accData, inputOffsets, accOffsets, inputComp, thisPixel, true, sumIntensities, sumAccumulator, numKnownVoxels);
+  }
+  else
+  {
+    for (int x = minX; x <= maxX; x++)
     {
-      for (int z = minZ; z <= maxZ; z++)
+      for (int y = minY; y <= maxY; y++)
       {
-        if (x <= wholeExtent[1] && x >= wholeExtent[0] &&
-          y <= wholeExtent[3] && y >= wholeExtent[2] &&
-          z <= wholeExtent[5] && z >= wholeExtent[4] ) // check bounds
+        for (int z = minZ; z <= maxZ; z++)
         {
-          int accIndex =   accOffsets[0]*x+  accOffsets[1]*y+  accOffsets[2]*z;
-          currentAccumulation = accData[accIndex];
-          if (currentAccumulation) { // if the accumulation buffer for the voxel is non-zero
-            int volIndex = inputOffsets[0]*x+inputOffsets[1]*y+inputOffsets[2]*z+inputComp;
-            int kerIndex = size*size*(z-minZ)+size*(y-minY)+(x-minX);
-            double weight = currentAccumulation * kernel[kerIndex];
-            sumIntensities += inputData[volIndex] * weight;
-            sumAccumulator += weight;
-            numKnownVoxels++;
-          }
-        } // end boundary check
-      } // end z loop
-    } // end y loop
-  } // end x loop
+          if (x <= wholeExtent[1] && x >= wholeExtent[0] &&
+            y <= wholeExtent[3] && y >= wholeExtent[2] &&
+            z <= wholeExtent[5] && z >= wholeExtent[4] ) // check bounds
+          {
+            int accIndex =   accOffsets[0]*x+  accOffsets[1]*y+  accOffsets[2]*z;
+            currentAccumulation = accData[accIndex];
+            if (currentAccumulation) { // if the accumulation buffer for the voxel is non-zero
+              int volIndex = inputOffsets[0]*x+inputOffsets[1]*y+inputOffsets[2]*z+inputComp;
+              int kerIndex = size*size*(z-minZ)+size*(y-minY)+(x-minX);
+              double weight = currentAccumulation * kernel[kerIndex];
+              sumIntensities += inputData[volIndex] * weight;
+              sumAccumulator += weight;
+              numKnownVoxels++;
+            }
+          } // end boundary check
+        } // end z loop
+      } // end y loop
+    } // end x loop
+  }
 
   if (sumAccumulator == 0) { // no voxels set in the area
     returnVal = (T)0;
@@ -485,8 +636,8 @@ void FillHolesInVolumeElement::setupAsStick(int stickLengthLimit, int numberOfSt
 //----------------------------------------------------------------------------
 
 void FillHolesInVolumeElement::allocateSticks() {
-  numSticksInList = 13;
-  sticksList = new int[39];
+  numSticksInList = NUMBER_OF_STICKS;
+  sticksList = new int[NUMBER_OF_STICKS*3];
 
   // 1x1, 2x0
   sticksList[ 0] = 1; sticksList[ 1] = 0; sticksList[ 2] = 0; // x, y, z
@@ -532,8 +683,13 @@ bool FillHolesInVolumeElement::applySticks(
   int fwdTrav, rvsTrav; // store the number of voxels that have been searched
   T fwdVal, rvsVal; // store the values at each end of the stick
 
-  T* values = new T[numSticksInList];
-  double* weights = new double[numSticksInList];
+  T values[NUMBER_OF_STICKS];
+  double weights[NUMBER_OF_STICKS];
+
+  // if the sticks are completely inside the volume then the precomputed step offsets can be used without boundary checks
+  bool insideVolume = !kernelAccOffsets.empty() && IsNeighborhoodInsideExtent(thisPixel, getNeighborhoodRadius(), wholeExtent);
+  vtkIdType accBaseIndex = accOffsets[0]*x+accOffsets[1]*y+accOffsets[2]*z;
+  vtkIdType volBaseIndex = inputOffsets[0]*x+inputOffsets[1]*y+inputOffsets[2]*z+inputComp;
 
   // try each stick direction
   for (int i = 0; i < numSticksInList; i++) {
@@ -543,23 +699,39 @@ bool FillHolesInVolumeElement::applySticks(
     // evaluate forward direction to nearest filled voxel
     xtemp = x; ytemp = y; ztemp = z;
     valid = false;
-    for (int j = 1; j + 1 <= stickLengthLimit; j++) {
-      // traverse in forward direction
-      xtemp = xtemp + sticksList[baseStickIndex  ];
-      ytemp = ytemp + sticksList[baseStickIndex+1];
-      ztemp = ztemp + sticksList[baseStickIndex+2];
-      // check boundaries
-      if (xtemp > wholeExtent[1] || xtemp < wholeExtent[0] ||
-        ytemp > wholeExtent[3] || ytemp < wholeExtent[2] ||
-        ztemp > wholeExtent[5] || ztemp < wholeExtent[4] ) // check bounds
-        break;
-      int accIndex =   accOffsets[0]*xtemp+  accOffsets[1]*ytemp+  accOffsets[2]*ztemp;
-      if (accData[accIndex] != 0) { // this is a filled voxel
-        fwdTrav = j;
-        int volIndex = inputOffsets[0]*xtemp+inputOffsets[1]*ytemp+inputOffsets[2]*ztemp+inputComp;
-        fwdVal = inputData[volIndex];
-        valid = true;
-        break;
+    if (insideVolume) {
+      vtkIdType accIndex = accBaseIndex;
+      vtkIdType volIndex = volBaseIndex;
+      for (int j = 1; j + 1 <= stickLengthLimit; j++) {
+        // traverse in forward direction
+        accIndex += kernelAccOffsets[i];
+        volIndex += kernelInputOffsets[i];
+        if (accData[accIndex] != 0) { // this is a filled voxel
+          fwdTrav = j;
+          fwdVal = inputData[volIndex];
+          valid = true;
+          break;
+        }
+      }
+    } else {
+      for (int j = 1; j + 1 <= stickLengthLimit; j++) {
+        // traverse in forward direction
+        xtemp = xtemp + sticksList[baseStickIndex  ];
+        ytemp = ytemp + sticksList[baseStickIndex+1];
+        ztemp = ztemp + sticksList[baseStickIndex+2];
+        // check boundaries
+        if (xtemp > wholeExtent[1] || xtemp < wholeExtent[0] ||
+          ytemp > wholeExtent[3] || ytemp < wholeExtent[2] ||
+          ztemp > wholeExtent[5] || ztemp < wholeExtent[4] ) // check bounds
+          break;
+        int accIndex =   accOffsets[0]*xtemp+  accOffsets[1]*ytemp+  accOffsets[2]*ztemp;
+        if (accData[accIndex] != 0) { // this is a filled voxel
+          fwdTrav = j;
+          int volIndex = inputOffsets[0]*xtemp+inputOffsets[1]*ytemp+inputOffsets[2]*ztemp+inputComp;
+          fwdVal = inputData[volIndex];
+          valid = true;
+          break;
+        }
       }
     } // end searching fwd direction
 
@@ -572,23 +744,39 @@ bool FillHolesInVolumeElement::applySticks(
     // evaluate reverse direction to nearest filled voxel
     xtemp = x; ytemp = y; ztemp = z;
     valid = false;
-    for (int j = 1; j + fwdTrav + 1 <= stickLengthLimit; j++) {
-      // traverse in reverse direction
-      xtemp = xtemp - sticksList[baseStickIndex  ];
-      ytemp = ytemp - sticksList[baseStickIndex+1];
-      ztemp = ztemp - sticksList[baseStickIndex+2];
-      // check boundaries
-      if (xtemp > wholeExtent[1] || xtemp < wholeExtent[0] ||
-        ytemp > wholeExtent[3] || ytemp < wholeExtent[2] ||
-        ztemp > wholeExtent[5] || ztemp < wholeExtent[4] ) // check bounds
-        break;
-      int accIndex =   accOffsets[0]*xtemp+  accOffsets[1]*ytemp+  accOffsets[2]*ztemp;
-      if (accData[accIndex] != 0) { // this is a filled voxel
-        rvsTrav = j;
-        int volIndex = inputOffsets[0]*xtemp+inputOffsets[1]*ytemp+inputOffsets[2]*ztemp+inputComp;
-        rvsVal = inputData[volIndex];
-        valid = true;
-        break;
+    if (insideVolume) {
+      vtkIdType accIndex = accBaseIndex;
+      vtkIdType volIndex = volBaseIndex;
+      for (int j = 1; j + fwdTrav + 1 <= stickLengthLimit; j++) {
+        // traverse in reverse direction
+        accIndex -= kernelAccOffsets[i];
+        volIndex -= kernelInputOffsets[i];
+        if (accData[accIndex] != 0) { // this is a filled voxel
+          rvsTrav = j;
+          rvsVal = inputData[volIndex];
+          valid = true;
+          break;
+        }
+      }
+    } else {
+      for (int j = 1; j + fwdTrav + 1 <= stickLengthLimit; j++) {
+        // traverse in reverse direction
+        xtemp = xtemp - sticksList[baseStickIndex  ];
+        ytemp = ytemp - sticksList[baseStickIndex+1];
+        ztemp = ztemp - sticksList[baseStickIndex+2];
+        // check boundaries
+        if (xtemp > wholeExtent[1] || xtemp < wholeExtent[0] ||
+          ytemp > wholeExtent[3] || ytemp < wholeExtent[2] ||
+          ztemp > wholeExtent[5] || ztemp < wholeExtent[4] ) // check bounds
+          break;
+        int accIndex =   accOffsets[0]*xtemp+  accOffsets[1]*ytemp+  accOffsets[2]*ztemp;
+        if (accData[accIndex] != 0) { // this is a filled voxel
+          rvsTrav = j;
+          int volIndex = inputOffsets[0]*xtemp+inputOffsets[1]*ytemp+inputOffsets[2]*ztemp+inputComp;
+          rvsVal = inputData[volIndex];
+          valid = true;
+          break;
+        }
       }
     } // end searching rvs direction
 
@@ -641,9 +829,6 @@ bool FillHolesInVolumeElement::applySticks(
 
   }
 
-  delete[] weights;
-  delete[] values;
-
   if (sumWeights != 0) {
     returnVal = (T)(sumWeightedValues/sumWeights);
     return true; // at least one stick was good, = success
@@ -694,7 +879,14 @@ vtkFillHolesInVolume::vtkFillHolesInVolume()
   this->SetNumberOfInputPorts(2);
   this->SetNumberOfOutputPorts(1);
   this->Compounding=0;
+  NumHFElements = 0;
   HFElements = NULL;
+  this->Optimization=FULL_OPTIMIZATION;
+  for (int i=0; i<3; i++)
+  {
+    this->BlockGridSize[i]=0;
+    this->BlockGridOrigin[i]=0;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -709,6 +901,7 @@ void vtkFillHolesInVolume::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
   os << indent << "Compounding: " << this->Compounding<< "\n";
+  os << indent << "Optimization: " << (this->Optimization==FULL_OPTIMIZATION ? "FULL" : "NONE") << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -751,53 +944,138 @@ int vtkFillHolesInVolume::RequestUpdateExtent (vtkInformation* vtkNotUsed(reques
   return 1;
 }
 //----------------------------------------------------------------------------
-template <class T>
-void vtkFillHolesInVolume::vtkFillHolesInVolumeExecute(vtkImageData *inVolData,
-                             T *inVolPtr, 
-                             vtkImageData *accData,
-                             unsigned short *accPtr, 
-                             vtkImageData *outData, 
-                             T *outPtr,
-                             int outExt[6], 
-                             int id)
+int vtkFillHolesInVolume::RequestData(vtkInformation *request, 
+  vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  this->BlockTypes.clear();
+  for (int k = 0; k < NumHFElements; k++)
+  {
+    HFElements[k].clearKernelOffsets();
+  }
 
-  if (outData==NULL || outData->GetScalarPointer()==NULL)
+  if (this->Optimization != NO_OPTIMIZATION)
   {
-    LOG_ERROR("vtkPasteSliceIntoVolumeFillHolesInOutput outData is invalid");
-    return;
+    vtkImageData* inVolData = vtkImageData::GetData(inputVector[INPUT_PORT_RECONSTRUCTED_VOLUME]);
+    vtkImageData* accData = vtkImageData::GetData(inputVector[INPUT_PORT_ACCUMULATION_BUFFER]);
+    if (inVolData!=NULL && accData!=NULL && accData->GetScalarPointer()!=NULL)
+    {
+      // the output has the same extent and number of components as the input volume, so the same offsets can be used
+      vtkIdType byteIncVol[3]={0}; //x,y,z
+      inVolData->GetIncrements(byteIncVol[0],byteIncVol[1],byteIncVol[2]);
+      vtkIdType byteIncAcc[3]={0}; //x,y,z
+      accData->GetIncrements(byteIncAcc[0],byteIncAcc[1],byteIncAcc[2]);
+      for (int k = 0; k < NumHFElements; k++)
+      {
+        HFElements[k].computeKernelOffsets(byteIncVol, byteIncAcc);
+      }
+      ClassifyBlocks(inVolData->GetExtent(), static_cast<unsigned short *>(accData->GetScalarPointer()), byteIncAcc);
+    }
   }
-  if (outPtr==NULL)
+
+  return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
+//----------------------------------------------------------------------------
+void vtkFillHolesInVolume::ClassifyBlocks(int volumeExtent[6], unsigned short *accPtr, vtkIdType accIncrements[3])
+{
+  for (int i=0; i<3; i++)
   {
-    LOG_ERROR("vtkPasteSliceIntoVolumeFillHolesInOutput outPtr is invalid");
-    return;
+    this->BlockGridOrigin[i]=volumeExtent[2*i];
+    this->BlockGridSize[i]=(volumeExtent[2*i+1]-volumeExtent[2*i]+FILL_HOLES_BLOCK_SIZE)/FILL_HOLES_BLOCK_SIZE;
   }
-  if (accPtr==NULL)
+  if (this->BlockGridSize[0]<=0 || this->BlockGridSize[1]<=0 || this->BlockGridSize[2]<=0)
   {
-    LOG_ERROR("vtkPasteSliceIntoVolumeFillHolesInOutput accPtr is invalid");
     return;
   }
+  const int numberOfBlocks=this->BlockGridSize[0]*this->BlockGridSize[1]*this->BlockGridSize[2];
 
-  // get increments for volume and for accumulation buffer
-  vtkIdType byteIncVol[3]={0}; //x,y,z
-  outData->GetIncrements(byteIncVol[0],byteIncVol[1],byteIncVol[2]);
-  vtkIdType byteIncAcc[3]={0}; //x,y,z
-  accData->GetIncrements(byteIncAcc[0],byteIncAcc[1],byteIncAcc[2]);
+  // count the known voxels (that were hit during vtkPasteSliceIntoVolume) in each block
+  std::vector<int> numberOfKnownVoxels(numberOfBlocks, 0);
+  int pos[3]; //x,y,z
+  for (pos[2] = volumeExtent[4]; pos[2] <= volumeExtent[5]; pos[2]++)
+  {
+    int blockIndexZ = (pos[2]-volumeExtent[4])/FILL_HOLES_BLOCK_SIZE*this->BlockGridSize[1];
+    for (pos[1] = volumeExtent[2]; pos[1] <= volumeExtent[3]; pos[1]++)
+    {
+      int blockIndexYZ = (blockIndexZ+(pos[1]-volumeExtent[2])/FILL_HOLES_BLOCK_SIZE)*this->BlockGridSize[0];
+      vtkIdType accIndex = pos[1]*accIncrements[1]+pos[2]*accIncrements[2];
+      for (pos[0] = volumeExtent[0]; pos[0] <= volumeExtent[1]; pos[0]++)
+      {
+        if (accPtr[accIndex+pos[0]*accIncrements[0]])
+        {
+          numberOfKnownVoxels[blockIndexYZ+(pos[0]-volumeExtent[0])/FILL_HOLES_BLOCK_SIZE]++;
+        }
+      }
+    }
+  }
 
-  // this will store the position of the pixel being looked at currently
-  int currentPos[3]; //x,y,z
+  // holes cannot be filled if there are no known voxels within the radius of any of the elements
+  int neighborhoodRadius=0;
+  for (int k = 0; k < NumHFElements; k++)
+  {
+    neighborhoodRadius=std::max(neighborhoodRadius, HFElements[k].getNeighborhoodRadius());
+  }
+  const int neighborhoodRadiusInBlocks=(neighborhoodRadius+FILL_HOLES_BLOCK_SIZE-1)/FILL_HOLES_BLOCK_SIZE;
 
-  int numVolumeComponents = outData->GetNumberOfScalarComponents() - 1; // subtract 1 because of the alpha channel
+  this->BlockTypes.resize(numberOfBlocks);
+  int block[3]; //x,y,z
+  for (block[2]=0; block[2]<this->BlockGridSize[2]; block[2]++)
+  {
+    for (block[1]=0; block[1]<this->BlockGridSize[1]; block[1]++)
+    {
+      for (block[0]=0; block[0]<this->BlockGridSize[0]; block[0]++)
+      {
+        int blockIndex=(block[2]*this->BlockGridSize[1]+block[1])*this->BlockGridSize[0]+block[0];
 
-  int* wholeExtent;
-  wholeExtent = outData->GetExtent();
+        // number of voxels in the block (blocks at the boundary may be smaller)
+        int numberOfVoxelsInBlock=1;
+        for (int i=0; i<3; i++)
+        {
+          int blockStart=volumeExtent[2*i]+block[i]*FILL_HOLES_BLOCK_SIZE;
+          numberOfVoxelsInBlock*=std::min(blockStart+FILL_HOLES_BLOCK_SIZE-1, volumeExtent[2*i+1])-blockStart+1;
+        }
+        if (numberOfKnownVoxels[blockIndex]==numberOfVoxelsInBlock)
+        {
+          this->BlockTypes[blockIndex]=BLOCK_FILLED;
+          continue;
+        }
+
+        bool emptyNeighborhood=true;
+        for (int z=std::max(block[2]-neighborhoodRadiusInBlocks,0); z<=std::min(block[2]+neighborhoodRadiusInBlocks,this->BlockGridSize[2]-1) && emptyNeighborhood; z++)
+        {
+          for (int y=std::max(block[1]-neighborhoodRadiusInBlocks,0); y<=std::min(block[1]+neighborhoodRadiusInBlocks,this->BlockGridSize[1]-1) && emptyNeighborhood; y++)
+          {
+            for (int x=std::max(block[0]-neighborhoodRadiusInBlocks,0); x<=std::min(block[0]+neighborhoodRadiusInBlocks,this->BlockGridSize[0]-1); x++)
+            {
+              if (numberOfKnownVoxels[(z*this->BlockGridSize[1]+y)*this->BlockGridSize[0]+x]>0)
+              {
+                emptyNeighborhood=false;
+                break;
+              }
+            }
+          }
+        }
+        this->BlockTypes[blockIndex]=emptyNeighborhood ? BLOCK_EMPTY_NEIGHBORHOOD : BLOCK_PARTIALLY_FILLED;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkFillHolesInVolume::FillHolesInExtent(T *inVolPtr, unsigned short *accPtr, T *outPtr, 
+                             vtkIdType byteIncVol[3], vtkIdType byteIncAcc[3],
+                             int numVolumeComponents, int* wholeExtent, int extent[6])
+{
+  // this will store the position of the pixel being looked at currently
+  int currentPos[3]; //x,y,z
 
   // iterate through each voxel. When the accumulation buffer is 0, fill that hole, and continue.
-  for (currentPos[2] = outExt[4]; currentPos[2] <= outExt[5]; currentPos[2]++)
+  for (currentPos[2] = extent[4]; currentPos[2] <= extent[5]; currentPos[2]++)
   {
-    for (currentPos[1] = outExt[2]; currentPos[1] <= outExt[3]; currentPos[1]++)
+    for (currentPos[1] = extent[2]; currentPos[1] <= extent[3]; currentPos[1]++)
     {
-      for (currentPos[0] = outExt[0]; currentPos[0] <= outExt[1]; currentPos[0]++)
+      for (currentPos[0] = extent[0]; currentPos[0] <= extent[1]; currentPos[0]++)
       {
         // accumulator index and volume alpha index should not depend on which individual component is being interpolated
         int accIndex = (currentPos[0]*byteIncAcc[0])+(currentPos[1]*byteIncAcc[1])+(currentPos[2]*byteIncAcc[2]);
@@ -813,19 +1091,19 @@ void vtkFillHolesInVolume::vtkFillHolesInVolumeExecute(vtkImageData *inVolData,
             {
               switch (HFElements[k].type) {
               case FillHolesInVolumeElement::HFTYPE_GAUSSIAN:
-                result = HFElements[k].applyGaussian(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
+                result = HFElements[k].applyGaussian(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,extent,wholeExtent,currentPos,outPtr[volCompIndex]);
                 break;
               case FillHolesInVolumeElement::HFTYPE_GAUSSIAN_ACCUMULATION:
-                result = HFElements[k].applyGaussianAccumulation(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
+                result = HFElements[k].applyGaussianAccumulation(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,extent,wholeExtent,currentPos,outPtr[volCompIndex]);
                 break;
               case FillHolesInVolumeElement::HFTYPE_STICK:
-                result = HFElements[k].applySticks(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
+                result = HFElements[k].applySticks(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,extent,wholeExtent,currentPos,outPtr[volCompIndex]);
                 break;
               case FillHolesInVolumeElement::HFTYPE_NEAREST_NEIGHBOR:
-                result = HFElements[k].applyNearestNeighbor(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
+                result = HFElements[k].applyNearestNeighbor(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,extent,wholeExtent,currentPos,outPtr[volCompIndex]);
                 break;
               case FillHolesInVolumeElement::HFTYPE_DISTANCE_WEIGHT_INVERSE:
-                result = HFElements[k].applyDistanceWeightInverse(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
+                result = HFElements[k].applyDistanceWeightInverse(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,extent,wholeExtent,currentPos,outPtr[volCompIndex]);
                 break;
               }
               if (result) {
@@ -847,7 +1125,127 @@ void vtkFillHolesInVolume::vtkFillHolesInVolumeExecute(vtkImageData *inVolData,
       } // end x loop
     } // end y loop
   } // end z loop
+}
 
+//----------------------------------------------------------------------------
+template <class T>
+void vtkFillHolesInVolume::vtkFillHolesInVolumeExecute(vtkImageData *inVolData,
+                             T *inVolPtr, 
+                             vtkImageData *accData,
+                             unsigned short *accPtr, 
+                             vtkImageData *outData, 
+                             T *outPtr,
+                             int outExt[6], 
+                             int id)
+{
+
+  if (outData==NULL || outData->GetScalarPointer()==NULL)
+  {
+    LOG_ERROR("vtkPasteSliceIntoVolumeFillHolesInOutput outData is invalid");
+    return;
+  }
+  if (outPtr==NULL)
+  {
+    LOG_ERROR("vtkPasteSliceIntoVolumeFillHolesInOutput outPtr is invalid");
+    return;
+  }
+  if (accPtr==NULL)
+  {
+    LOG_ERROR("vtkPasteSliceIntoVolumeFillHolesInOutput accPtr is invalid");
+    return;
+  }
+
+  // get increments for volume and for accumulation buffer
+  vtkIdType byteIncVol[3]={0}; //x,y,z
+  outData->GetIncrements(byteIncVol[0],byteIncVol[1],byteIncVol[2]);
+  vtkIdType byteIncAcc[3]={0}; //x,y,z
+  accData->GetIncrements(byteIncAcc[0],byteIncAcc[1],byteIncAcc[2]);
+
+  int numVolumeComponents = outData->GetNumberOfScalarComponents() - 1; // subtract 1 because of the alpha channel
+
+  int* wholeExtent;
+  wholeExtent = outData->GetExtent();
+
+  if (this->BlockTypes.empty()
+    || outExt[0]<this->BlockGridOrigin[0] || outExt[1]>=this->BlockGridOrigin[0]+this->BlockGridSize[0]*FILL_HOLES_BLOCK_SIZE
+    || outExt[2]<this->BlockGridOrigin[1] || outExt[3]>=this->BlockGridOrigin[1]+this->BlockGridSize[1]*FILL_HOLES_BLOCK_SIZE
+    || outExt[4]<this->BlockGridOrigin[2] || outExt[5]>=this->BlockGridOrigin[2]+this->BlockGridSize[2]*FILL_HOLES_BLOCK_SIZE)
+  {
+    // blocks are not classified (optimization is disabled), evaluate each voxel
+    FillHolesInExtent(inVolPtr, accPtr, outPtr, byteIncVol, byteIncAcc, numVolumeComponents, wholeExtent, outExt);
+    return;
+  }
+
+  // process the extent of the thread block by block, kernels are evaluated only in blocks that contain holes that may be filled
+  int firstBlock[3]={0}, lastBlock[3]={0};
+  for (int i=0; i<3; i++)
+  {
+    firstBlock[i]=(outExt[2*i]-this->BlockGridOrigin[i])/FILL_HOLES_BLOCK_SIZE;
+    lastBlock[i]=(outExt[2*i+1]-this->BlockGridOrigin[i])/FILL_HOLES_BLOCK_SIZE;
+  }
+  int block[3]; //x,y,z
+  int blockExt[6];
+  int currentPos[3]; //x,y,z
+  for (block[2]=firstBlock[2]; block[2]<=lastBlock[2]; block[2]++)
+  {
+    for (block[1]=firstBlock[1]; block[1]<=lastBlock[1]; block[1]++)
+    {
+      for (block[0]=firstBlock[0]; block[0]<=lastBlock[0]; block[0]++)
+      {
+        // intersection of the block and the extent of the thread
+        for (int i=0; i<3; i++)
+        {
+          blockExt[2*i]=std::max(this->BlockGridOrigin[i]+block[i]*FILL_HOLES_BLOCK_SIZE, outExt[2*i]);
+          blockExt[2*i+1]=std::min(this->BlockGridOrigin[i]+(block[i]+1)*FILL_HOLES_BLOCK_SIZE-1, outExt[2*i+1]);
+        }
+        
+        switch (this->BlockTypes[(block[2]*this->BlockGridSize[1]+block[1])*this->BlockGridSize[0]+block[0]])
+        {
+        case BLOCK_FILLED:
+          // no holes, just use the apparent values
+          for (currentPos[2] = blockExt[4]; currentPos[2] <= blockExt[5]; currentPos[2]++)
+          {
+            for (currentPos[1] = blockExt[2]; currentPos[1] <= blockExt[3]; currentPos[1]++)
+            {
+              vtkIdType volIndex = (blockExt[0]*byteIncVol[0])+(currentPos[1]*byteIncVol[1])+(currentPos[2]*byteIncVol[2]);
+              for (currentPos[0] = blockExt[0]; currentPos[0] <= blockExt[1]; currentPos[0]++, volIndex+=byteIncVol[0])
+              {
+                for (int c = 0; c < numVolumeComponents; c++)
+                {
+                  outPtr[volIndex+c] = inVolPtr[volIndex+c];
+                }
+                outPtr[volIndex+numVolumeComponents] = (T)OPAQUE_ALPHA;
+              }
+            }
+          }
+          break;
+        case BLOCK_EMPTY_NEIGHBORHOOD:
+          // only holes that none of the elements can fill (each element sets the value to 0 if it fails)
+          for (currentPos[2] = blockExt[4]; currentPos[2] <= blockExt[5]; currentPos[2]++)
+          {
+            for (currentPos[1] = blockExt[2]; currentPos[1] <= blockExt[3]; currentPos[1]++)
+            {
+              vtkIdType volIndex = (blockExt[0]*byteIncVol[0])+(currentPos[1]*byteIncVol[1])+(currentPos[2]*byteIncVol[2]);
+              for (currentPos[0] = blockExt[0]; currentPos[0] <= blockExt[1]; currentPos[0]++, volIndex+=byteIncVol[0])
+              {
+                if (NumHFElements > 0)
+                {
+                  for (int c = 0; c < numVolumeComponents; c++)
+                  {
+                    outPtr[volIndex+c] = (T)0;
+                  }
+                }
+                outPtr[volIndex+numVolumeComponents] = (T)0;
+              }
+            }
+          }
+          break;
+        default:
+          FillHolesInExtent(inVolPtr, accPtr, outPtr, byteIncVol, byteIncAcc, numVolumeComponents, wholeExtent, blockExt);
+        }
+      }
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
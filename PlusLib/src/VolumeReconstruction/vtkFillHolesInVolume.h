@@ -43,6 +43,7 @@ POSSIBILITY OF SUCH DAMAGES.
 #define __vtkFillHolesInVolume_h
 
 #include "vtkThreadedImageAlgorithm.h"
+#include <vector>
 
 /*!
   /struct vtkFillHolesInVolumeKernel
@@ -57,7 +58,6 @@ struct vtkFillHolesInVolumeKernel {
 
 };
 
-// TODO: This needs massive optimization
 class FillHolesInVolumeElement 
 {
 public:
@@ -169,6 +169,25 @@ public:
   int numSticksInList;         // the number of sticks in sticksList
   int* sticksList; // triples each corresponding to a stick orientation
 
+  // Maximum distance (along each axis, in voxels) between the hole voxel and the voxels that are used for filling it
+  int getNeighborhoodRadius();
+
+  // Precompute the memory offsets of the kernel voxels (relative to the hole voxel), so that the kernel
+  // can be applied without boundary checks at voxels that are not close to the boundary of the volume
+  void computeKernelOffsets(vtkIdType* inputOffsets, vtkIdType* accOffsets);
+  void clearKernelOffsets();
+  // GAUSSIAN, GAUSSIAN_ACCUMULATION, DISTANCE_WEIGHT_INVERSE: offsets of the kernel voxels, in the order of evaluation
+  // STICK: offsets of one step along each stick
+  std::vector<vtkIdType> kernelInputOffsets;
+  std::vector<vtkIdType> kernelAccOffsets;
+  std::vector<float> kernelWeights; // kernel weights in the same order as the offsets
+
+  // Sum the weighted intensities of the known voxels in the kernel using the precomputed kernel offsets
+  template <class T>
+  void sumKnownVoxelsInKernel(T* inputData, unsigned short* accData, vtkIdType* inputOffsets, vtkIdType* accOffsets,
+                     const int& inputComp, int* thisPixel, bool weightByAccumulation,
+                     double& sumIntensities, double& sumAccumulator, int& numKnownVoxels);
+
 //private: 
   //double computeAngle(int* v1, int* v2);
 
@@ -199,6 +218,12 @@ public:
   static vtkFillHolesInVolume *New();
   vtkTypeMacro(vtkFillHolesInVolume,vtkThreadedImageAlgorithm);
   void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum OptimizationType
+  {
+    NO_OPTIMIZATION,
+    FULL_OPTIMIZATION
+  };
     
   /*! Get current compounding setting */
   vtkGetMacro(Compounding,int);
@@ -210,6 +235,17 @@ public:
   */
   vtkSetMacro(Compounding,int);
 
+  /*!
+    Set optimization method (results are the same, turn off optimization only for comparing the results and performance).
+    NO_OPTIMIZATION: the kernels are evaluated voxel by voxel, with boundary checks
+    FULL_OPTIMIZATION: the kernels are applied using precomputed offsets (without boundary checks
+      inside the volume) and the volume is processed in blocks: voxels in blocks that contain no holes are copied,
+      holes in blocks that have no known voxels in their neighborhood are left empty without evaluating the kernels
+  */
+  vtkSetMacro(Optimization,OptimizationType);
+  /*! Get the current optimization method */
+  vtkGetMacro(Optimization,OptimizationType);
+
   /*!
     Get the index'th kernel that is to be tried, index ranging from 0 (first kernel)
   up to NumKernels-1 (last kernel).
@@ -268,6 +304,14 @@ protected:
                                   vtkInformationVector**,
                                   vtkInformationVector*);
 
+  /*! Prepare the kernel offsets and the block classification before the threaded execution */
+  virtual int RequestData(vtkInformation *request, 
+                          vtkInformationVector **inputVector, 
+                          vtkInformationVector *outputVector);
+
+  /*! Compute the type of each block of the volume from the accumulation buffer */
+  void ClassifyBlocks(int volumeExtent[6], unsigned short *accPtr, vtkIdType accIncrements[3]);
+
   template <class T>
   void vtkFillHolesInVolumeExecute(vtkImageData *inVolData,
                    T *inVolPtr,
@@ -278,6 +322,12 @@ protected:
                    int outExt[6],
                    int id);
 
+  /*! Fill the holes voxel by voxel in the specified extent */
+  template <class T>
+  void FillHolesInExtent(T *inVolPtr, unsigned short *accPtr, T *outPtr, 
+                   vtkIdType byteIncVol[3], vtkIdType byteIncAcc[3],
+                   int numVolumeComponents, int* wholeExtent, int extent[6]);
+
   /*!
     This method contains a switch statement that calls the correct
     templated function for the input data type.  The output data
@@ -295,6 +345,17 @@ protected:
   int Compounding;
   int NumHFElements;
   FillHolesInVolumeElement* HFElements;
+  OptimizationType Optimization;
+
+  /*! 
+    Type of each block of the volume (block size is defined in the implementation file), 
+    computed before the threaded execution if optimization is enabled. Empty if not computed.
+  */
+  std::vector<unsigned char> BlockTypes;
+  /*! Number of blocks along each axis */
+  int BlockGridSize[3];
+  /*! Voxel index of the first voxel of the first block */
+  int BlockGridOrigin[3];
 
 private:
   vtkFillHolesInVolume(const vtkFillHolesInVolume&);  // Not implemented.